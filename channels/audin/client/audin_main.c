@@ -882,6 +882,10 @@ BOOL audin_process_addin_args(AUDIN_PLUGIN* audin, const ADDIN_ARGV* args)
 		{ "format", COMMAND_LINE_VALUE_REQUIRED, "<format>", NULL, NULL, -1, NULL, "format" },
 		{ "rate", COMMAND_LINE_VALUE_REQUIRED, "<rate>", NULL, NULL, -1, NULL, "rate" },
 		{ "channel", COMMAND_LINE_VALUE_REQUIRED, "<channel>", NULL, NULL, -1, NULL, "channel" },
+		{ "bitrate", COMMAND_LINE_VALUE_REQUIRED, "<bitrate>", NULL, NULL, -1, NULL,
+		  "encoder bitrate in bits per second" },
+		{ "complexity", COMMAND_LINE_VALUE_REQUIRED, "<0-10>", NULL, NULL, -1, NULL,
+		  "encoder complexity" },
 		{ NULL, 0, NULL, NULL, NULL, -1, NULL, NULL }
 	};
 
@@ -947,6 +951,32 @@ BOOL audin_process_addin_args(AUDIN_PLUGIN* audin, const ADDIN_ARGV* args)
 			if ((errno != 0) || (val < UINT16_MAX))
 				audin->fixed_format->nChannels = val;
 		}
+		CommandLineSwitchCase(arg, "bitrate")
+		{
+			unsigned long val = strtoul(arg->Value, NULL, 0);
+
+			if ((errno != 0) || (val > UINT32_MAX) ||
+			    !freerdp_dsp_context_set_option(audin->dsp_context, FREERDP_DSP_OPTION_BITRATE,
+			                                    (UINT32)val))
+			{
+				WLog_Print(audin->log, WLOG_ERROR, "invalid or unsupported bitrate %s",
+				           arg->Value);
+				return FALSE;
+			}
+		}
+		CommandLineSwitchCase(arg, "complexity")
+		{
+			unsigned long val = strtoul(arg->Value, NULL, 0);
+
+			if ((errno != 0) || (val > UINT32_MAX) ||
+			    !freerdp_dsp_context_set_option(audin->dsp_context,
+			                                    FREERDP_DSP_OPTION_COMPLEXITY, (UINT32)val))
+			{
+				WLog_Print(audin->log, WLOG_ERROR, "invalid or unsupported complexity %s",
+				           arg->Value);
+				return FALSE;
+			}
+		}
 		CommandLineSwitchDefault(arg)
 		{
 		}
@@ -41,6 +41,7 @@
 #include <freerdp/crypto/crypto.h>
 
 #include "../printer.h"
+#include "printer_spool.h"
 
 #include <freerdp/client/printer.h>
 
@@ -54,6 +55,7 @@ struct _PRINTER_DEVICE
 	DEVICE device;
 
 	rdpPrinter* printer;
+	PRINTER_SPOOL* spool;
 
 	WINPR_PSLIST_HEADER pIrpList;
 
@@ -464,6 +466,15 @@ static UINT printer_process_irp_close(PRINTER_DEVICE* printer_dev, IRP* irp)
 	}
 	else
 	{
+		/* The job must not be closed before the backend got all its data */
+		const UINT error = printer_spool_flush(printer_dev->spool, printjob);
+
+		if (error)
+		{
+			WLog_ERR(TAG, "printer_spool_flush failed with error %" PRIu32 "!", error);
+			irp->IoStatus = STATUS_UNSUCCESSFUL;
+		}
+
 		printjob->Close(printjob);
 	}
 
@@ -502,12 +513,12 @@ static UINT printer_process_irp_write(PRINTER_DEVICE* printer_dev, IRP* irp)
 	}
 	else
 	{
-		error = printjob->Write(printjob, ptr, Length);
+		error = printer_spool_write(printer_dev->spool, printjob, ptr, Length);
 	}
 
 	if (error)
 	{
-		WLog_ERR(TAG, "printjob->Write failed with error %" PRIu32 "!", error);
+		WLog_ERR(TAG, "printer_spool_write failed with error %" PRIu32 "!", error);
 		return error;
 	}
 
@@ -848,6 +859,8 @@ static UINT printer_free(DEVICE* device)
 	while ((irp = (IRP*)InterlockedPopEntrySList(printer_dev->pIrpList)) != NULL)
 		irp->Discard(irp);
 
+	/* Completed writes are passed to the backend before the printer closes open jobs */
+	printer_spool_free(printer_dev->spool);
 	CloseHandle(printer_dev->thread);
 	CloseHandle(printer_dev->stopEvent);
 	CloseHandle(printer_dev->event);
@@ -861,6 +874,17 @@ static UINT printer_free(DEVICE* device)
 	return CHANNEL_RC_OK;
 }
 
+static size_t printer_get_spool_limit(const rdpSettings* settings)
+{
+	/* FreeRDP_PrinterSpoolLimit is in KiB, 0 selects the default */
+	const UINT32 limit = freerdp_settings_get_uint32(settings, FreeRDP_PrinterSpoolLimit);
+
+	if ((limit == 0) || (limit > SIZE_MAX / 1024))
+		return PRINTER_SPOOL_LIMIT;
+
+	return (size_t)limit * 1024;
+}
+
 /**
  * Function description
  *
@@ -906,6 +930,15 @@ static UINT printer_register(PDEVICE_SERVICE_ENTRY_POINTS pEntryPoints, rdpPrint
 
 	InitializeSListHead(printer_dev->pIrpList);
 
+	if (!(printer_dev->spool =
+	          printer_spool_new(PRINTER_SPOOL_MEMORY_LIMIT,
+	                            printer_get_spool_limit(pEntryPoints->rdpcontext->settings))))
+	{
+		WLog_ERR(TAG, "printer_spool_new failed!");
+		error = CHANNEL_RC_NO_MEMORY;
+		goto error_out;
+	}
+
 	if (!(printer_dev->event = CreateEvent(NULL, TRUE, FALSE, NULL)))
 	{
 		WLog_ERR(TAG, "CreateEvent failed!");
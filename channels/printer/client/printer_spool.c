@@ -0,0 +1,437 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * Print Virtual Channel
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <winpr/crt.h>
+#include <winpr/synch.h>
+#include <winpr/thread.h>
+#include <winpr/stream.h>
+
+#include <freerdp/channels/log.h>
+
+#include "printer_spool.h"
+
+#define TAG CHANNELS_TAG("printer.client")
+
+/* Size of the reads from the spool file */
+#define PRINTER_SPOOL_FILE_CHUNK (64 * 1024)
+
+typedef struct _PRINTER_SPOOL_JOB PRINTER_SPOOL_JOB;
+typedef struct _PRINTER_SPOOL_CHUNK PRINTER_SPOOL_CHUNK;
+
+struct _PRINTER_SPOOL_JOB
+{
+	rdpPrintJob* printjob;
+	size_t pending; /* spooled bytes not written yet */
+	UINT error;
+	PRINTER_SPOOL_JOB* next;
+};
+
+/* The data of a write, either in memory or at offset of the spool file */
+struct _PRINTER_SPOOL_CHUNK
+{
+	PRINTER_SPOOL_JOB* job;
+	wStream* s;
+	INT64 offset;
+	size_t size;
+	PRINTER_SPOOL_CHUNK* next;
+};
+
+struct _PRINTER_SPOOL
+{
+	size_t memoryLimit;
+	size_t limit;
+
+	CRITICAL_SECTION lock;
+	HANDLE event;   /* chunks queued or stop requested */
+	HANDLE written; /* a chunk was written */
+	HANDLE thread;
+	BOOL stop;
+
+	PRINTER_SPOOL_JOB* jobs;
+	PRINTER_SPOOL_CHUNK* head;
+	PRINTER_SPOOL_CHUNK* tail;
+
+	size_t queued;
+	size_t memoryQueued;
+	size_t fileQueued;
+
+	wStreamPool* pool;
+	FILE* file;
+	INT64 fileEnd;
+	BOOL fileFailed;
+	BYTE* buffer;
+};
+
+static BOOL printer_spool_fits(size_t queued, size_t size, size_t limit)
+{
+	/* A single chunk larger than limit is accepted once everything else is written */
+	if (queued == 0)
+		return TRUE;
+
+	return (queued < limit) && (size <= limit - queued);
+}
+
+static PRINTER_SPOOL_JOB* printer_spool_find_job(PRINTER_SPOOL* spool, rdpPrintJob* printjob,
+                                                 BOOL create)
+{
+	PRINTER_SPOOL_JOB* job;
+
+	for (job = spool->jobs; job; job = job->next)
+	{
+		if (job->printjob == printjob)
+			return job;
+	}
+
+	if (!create)
+		return NULL;
+
+	job = (PRINTER_SPOOL_JOB*)calloc(1, sizeof(PRINTER_SPOOL_JOB));
+
+	if (!job)
+		return NULL;
+
+	job->printjob = printjob;
+	job->next = spool->jobs;
+	spool->jobs = job;
+	return job;
+}
+
+static BOOL printer_spool_file_append(PRINTER_SPOOL* spool, PRINTER_SPOOL_CHUNK* chunk,
+                                      const BYTE* data)
+{
+	if (spool->fileFailed)
+		return FALSE;
+
+	if (!spool->file)
+	{
+		spool->file = tmpfile();
+
+		if (!spool->file)
+		{
+			WLog_WARN(TAG, "no spool file, spooling in memory only");
+			spool->fileFailed = TRUE;
+			return FALSE;
+		}
+	}
+
+	if ((_fseeki64(spool->file, spool->fileEnd, SEEK_SET) != 0) ||
+	    (fwrite(data, 1, chunk->size, spool->file) != chunk->size))
+	{
+		WLog_WARN(TAG, "writing the spool file failed, spooling in memory only");
+		spool->fileFailed = TRUE;
+		return FALSE;
+	}
+
+	chunk->offset = spool->fileEnd;
+	spool->fileEnd += chunk->size;
+	spool->fileQueued += chunk->size;
+	return TRUE;
+}
+
+/* Returns FALSE if the chunk has to wait for the spooled data to be written */
+static BOOL printer_spool_store(PRINTER_SPOOL* spool, PRINTER_SPOOL_CHUNK* chunk,
+                                const BYTE* data, UINT* error)
+{
+	if (printer_spool_fits(spool->memoryQueued, chunk->size, spool->memoryLimit))
+	{
+		chunk->s = StreamPool_Take(spool->pool, chunk->size);
+
+		if (!chunk->s)
+		{
+			*error = CHANNEL_RC_NO_MEMORY;
+			return FALSE;
+		}
+
+		Stream_Write(chunk->s, data, chunk->size);
+		spool->memoryQueued += chunk->size;
+		return TRUE;
+	}
+
+	return printer_spool_file_append(spool, chunk, data);
+}
+
+/* Called with the lock held, the lock is released while the backend writes */
+static UINT printer_spool_write_chunk(PRINTER_SPOOL* spool, const PRINTER_SPOOL_CHUNK* chunk)
+{
+	UINT error = CHANNEL_RC_OK;
+	size_t offset = 0;
+	rdpPrintJob* printjob = chunk->job->printjob;
+
+	if (chunk->s)
+	{
+		LeaveCriticalSection(&spool->lock);
+		error = printjob->Write(printjob, Stream_Buffer(chunk->s), chunk->size);
+		EnterCriticalSection(&spool->lock);
+		return error;
+	}
+
+	while (!error && (offset < chunk->size))
+	{
+		const size_t length = MIN(chunk->size - offset, PRINTER_SPOOL_FILE_CHUNK);
+
+		if ((_fseeki64(spool->file, chunk->offset + (INT64)offset, SEEK_SET) != 0) ||
+		    (fread(spool->buffer, 1, length, spool->file) != length))
+			return ERROR_READ_FAULT;
+
+		LeaveCriticalSection(&spool->lock);
+		error = printjob->Write(printjob, spool->buffer, length);
+		EnterCriticalSection(&spool->lock);
+		offset += length;
+	}
+
+	return error;
+}
+
+static DWORD WINAPI printer_spool_thread_func(LPVOID arg)
+{
+	PRINTER_SPOOL* spool = (PRINTER_SPOOL*)arg;
+
+	EnterCriticalSection(&spool->lock);
+
+	while (1)
+	{
+		PRINTER_SPOOL_JOB* job;
+		PRINTER_SPOOL_CHUNK* chunk = spool->head;
+
+		if (!chunk)
+		{
+			if (spool->stop)
+				break;
+
+			ResetEvent(spool->event);
+			LeaveCriticalSection(&spool->lock);
+			WaitForSingleObject(spool->event, INFINITE);
+			EnterCriticalSection(&spool->lock);
+			continue;
+		}
+
+		spool->head = chunk->next;
+
+		if (!spool->head)
+			spool->tail = NULL;
+
+		job = chunk->job;
+
+		if (!job->error)
+		{
+			job->error = printer_spool_write_chunk(spool, chunk);
+
+			if (job->error)
+				WLog_ERR(TAG, "print job %" PRIu32 " write failed with error %" PRIu32 "!",
+				         job->printjob->id, job->error);
+		}
+
+		job->pending -= chunk->size;
+		spool->queued -= chunk->size;
+
+		if (chunk->s)
+		{
+			spool->memoryQueued -= chunk->size;
+			Stream_Release(chunk->s);
+		}
+		else
+		{
+			spool->fileQueued -= chunk->size;
+
+			/* Start over at the beginning of the file once it was read */
+			if (spool->fileQueued == 0)
+				spool->fileEnd = 0;
+		}
+
+		free(chunk);
+		SetEvent(spool->written);
+	}
+
+	LeaveCriticalSection(&spool->lock);
+	ExitThread(0);
+	return 0;
+}
+
+UINT printer_spool_write(PRINTER_SPOOL* spool, rdpPrintJob* printjob, const BYTE* data,
+                         size_t size)
+{
+	UINT error = CHANNEL_RC_OK;
+	PRINTER_SPOOL_JOB* job;
+	PRINTER_SPOOL_CHUNK* chunk;
+
+	if (!spool || !printjob || (!data && (size > 0)))
+		return ERROR_INVALID_PARAMETER;
+
+	if (size == 0)
+		return CHANNEL_RC_OK;
+
+	chunk = (PRINTER_SPOOL_CHUNK*)calloc(1, sizeof(PRINTER_SPOOL_CHUNK));
+
+	if (!chunk)
+		return CHANNEL_RC_NO_MEMORY;
+
+	chunk->size = size;
+	EnterCriticalSection(&spool->lock);
+
+	while (1)
+	{
+		job = printer_spool_find_job(spool, printjob, TRUE);
+
+		if (!job)
+		{
+			error = CHANNEL_RC_NO_MEMORY;
+			goto out;
+		}
+
+		if ((error = job->error))
+			goto out;
+
+		if (printer_spool_fits(spool->queued, size, spool->limit) &&
+		    printer_spool_store(spool, chunk, data, &error))
+			break;
+
+		if (error)
+			goto out;
+
+		ResetEvent(spool->written);
+		LeaveCriticalSection(&spool->lock);
+		WaitForSingleObject(spool->written, INFINITE);
+		EnterCriticalSection(&spool->lock);
+	}
+
+	chunk->job = job;
+	job->pending += size;
+	spool->queued += size;
+
+	if (spool->tail)
+		spool->tail->next = chunk;
+	else
+		spool->head = chunk;
+
+	spool->tail = chunk;
+	chunk = NULL;
+	SetEvent(spool->event);
+out:
+	LeaveCriticalSection(&spool->lock);
+	free(chunk);
+	return error;
+}
+
+UINT printer_spool_flush(PRINTER_SPOOL* spool, rdpPrintJob* printjob)
+{
+	UINT error = CHANNEL_RC_OK;
+	PRINTER_SPOOL_JOB* job;
+	PRINTER_SPOOL_JOB** prev;
+
+	if (!spool || !printjob)
+		return ERROR_INVALID_PARAMETER;
+
+	EnterCriticalSection(&spool->lock);
+
+	while ((job = printer_spool_find_job(spool, printjob, FALSE)) && (job->pending > 0))
+	{
+		ResetEvent(spool->written);
+		LeaveCriticalSection(&spool->lock);
+		WaitForSingleObject(spool->written, INFINITE);
+		EnterCriticalSection(&spool->lock);
+	}
+
+	for (prev = &spool->jobs; *prev; prev = &(*prev)->next)
+	{
+		if (*prev == job)
+		{
+			*prev = job->next;
+			error = job->error;
+			free(job);
+			break;
+		}
+	}
+
+	LeaveCriticalSection(&spool->lock);
+	return error;
+}
+
+PRINTER_SPOOL* printer_spool_new(size_t memoryLimit, size_t limit)
+{
+	PRINTER_SPOOL* spool = (PRINTER_SPOOL*)calloc(1, sizeof(PRINTER_SPOOL));
+
+	if (!spool)
+		return NULL;
+
+	spool->memoryLimit = MIN(memoryLimit, limit);
+	spool->limit = limit;
+
+	if (!InitializeCriticalSectionAndSpinCount(&spool->lock, 4000))
+	{
+		free(spool);
+		return NULL;
+	}
+
+	spool->event = CreateEvent(NULL, TRUE, FALSE, NULL);
+	spool->written = CreateEvent(NULL, TRUE, FALSE, NULL);
+	spool->pool = StreamPool_New(TRUE, 0);
+	spool->buffer = (BYTE*)malloc(PRINTER_SPOOL_FILE_CHUNK);
+
+	if (!spool->event || !spool->written || !spool->pool || !spool->buffer)
+		goto fail;
+
+	spool->thread = CreateThread(NULL, 0, printer_spool_thread_func, spool, 0, NULL);
+
+	if (!spool->thread)
+		goto fail;
+
+	return spool;
+fail:
+	printer_spool_free(spool);
+	return NULL;
+}
+
+void printer_spool_free(PRINTER_SPOOL* spool)
+{
+	if (!spool)
+		return;
+
+	if (spool->thread)
+	{
+		EnterCriticalSection(&spool->lock);
+		spool->stop = TRUE;
+		SetEvent(spool->event);
+		LeaveCriticalSection(&spool->lock);
+
+		WaitForSingleObject(spool->thread, INFINITE);
+		CloseHandle(spool->thread);
+	}
+
+	while (spool->jobs)
+	{
+		PRINTER_SPOOL_JOB* job = spool->jobs;
+		spool->jobs = job->next;
+		free(job);
+	}
+
+	if (spool->file)
+		fclose(spool->file);
+
+	StreamPool_Free(spool->pool);
+	CloseHandle(spool->event);
+	CloseHandle(spool->written);
+	DeleteCriticalSection(&spool->lock);
+	free(spool->buffer);
+	free(spool);
+}
@@ -0,0 +1,48 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * Print Virtual Channel
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FREERDP_CHANNEL_PRINTER_CLIENT_SPOOL_H
+#define FREERDP_CHANNEL_PRINTER_CLIENT_SPOOL_H
+
+#include <winpr/wtypes.h>
+
+#include <freerdp/client/printer.h>
+
+/* Spooled bytes kept in memory, the rest goes to a temporary file */
+#define PRINTER_SPOOL_MEMORY_LIMIT (1024 * 1024)
+
+/* Spooled bytes above which writes wait for the backend, unless FreeRDP_PrinterSpoolLimit
+ * is set */
+#define PRINTER_SPOOL_LIMIT (64 * 1024 * 1024)
+
+typedef struct _PRINTER_SPOOL PRINTER_SPOOL;
+
+/* The spool owns a worker thread that passes the spooled data to the print jobs.
+ * printer_spool_free waits until everything spooled was written. */
+PRINTER_SPOOL* printer_spool_new(size_t memoryLimit, size_t limit);
+void printer_spool_free(PRINTER_SPOOL* spool);
+
+/* Spool data for printjob. Returns once the data is copied, unless more than limit bytes
+ * are spooled. A failed write of the worker is returned by the following calls of the job. */
+UINT printer_spool_write(PRINTER_SPOOL* spool, rdpPrintJob* printjob, const BYTE* data,
+                         size_t size);
+
+/* Wait until everything spooled for printjob was written, the job can be closed afterwards.
+ * Returns the error of the first failed write of the job. */
+UINT printer_spool_flush(PRINTER_SPOOL* spool, rdpPrintJob* printjob);
+
+#endif /* FREERDP_CHANNEL_PRINTER_CLIENT_SPOOL_H */
@@ -0,0 +1,356 @@
+#include <stdio.h>
+
+#include <winpr/crt.h>
+#include <winpr/synch.h>
+#include <winpr/thread.h>
+
+#include "../printer_spool.h"
+
+#define TEST_CHUNK 4096
+
+/* A backend that writes slowly: writes wait for the gate and sleep delay ms */
+typedef struct
+{
+	rdpPrintJob printjob;
+	HANDLE gate;
+	DWORD delay;
+	size_t failAt;
+	volatile LONG writes;
+
+	BYTE* data;
+	size_t size;
+	size_t capacity;
+} TestPrintJob;
+
+typedef struct
+{
+	PRINTER_SPOOL* spool;
+	TestPrintJob* job;
+	const BYTE* data;
+	size_t size;
+	UINT error;
+} TestWriter;
+
+static UINT test_write(rdpPrintJob* printjob, const BYTE* data, size_t size)
+{
+	TestPrintJob* job = (TestPrintJob*)printjob;
+	const LONG writes = InterlockedIncrement(&job->writes);
+
+	WaitForSingleObject(job->gate, INFINITE);
+
+	if (job->delay)
+		Sleep(job->delay);
+
+	if ((size_t)writes == job->failAt)
+		return ERROR_WRITE_FAULT;
+
+	if (job->size + size > job->capacity)
+		return ERROR_INTERNAL_ERROR;
+
+	memcpy(&job->data[job->size], data, size);
+	job->size += size;
+	return CHANNEL_RC_OK;
+}
+
+static void test_close(rdpPrintJob* printjob)
+{
+	WINPR_UNUSED(printjob);
+}
+
+static BOOL test_job_init(TestPrintJob* job, UINT32 id, size_t capacity)
+{
+	ZeroMemory(job, sizeof(TestPrintJob));
+	job->printjob.id = id;
+	job->printjob.Write = test_write;
+	job->printjob.Close = test_close;
+	job->gate = CreateEvent(NULL, TRUE, FALSE, NULL);
+	job->data = malloc(capacity);
+	job->capacity = capacity;
+	return job->gate && job->data;
+}
+
+static void test_job_uninit(TestPrintJob* job)
+{
+	CloseHandle(job->gate);
+	free(job->data);
+}
+
+static void test_fill(BYTE* data, size_t size)
+{
+	size_t i;
+
+	for (i = 0; i < size; i++)
+		data[i] = (BYTE)((i * 31 + i / 251) & 0xFF);
+}
+
+static BOOL test_data(const TestPrintJob* job, const BYTE* expected, size_t size)
+{
+	if ((job->size != size) || (memcmp(job->data, expected, size) != 0))
+	{
+		printf("job %" PRIu32 " got %" PRIuz " bytes out of order, expected %" PRIuz "\n",
+		       job->printjob.id, job->size, size);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+static DWORD WINAPI test_writer_thread(LPVOID arg)
+{
+	TestWriter* writer = (TestWriter*)arg;
+
+	writer->error = printer_spool_write(writer->spool, &writer->job->printjob, writer->data,
+	                                    writer->size);
+	ExitThread(0);
+	return 0;
+}
+
+/* Writes return while the backend is stuck in the first write */
+static BOOL test_async(const BYTE* data, size_t size)
+{
+	size_t offset;
+	BOOL rc = FALSE;
+	TestPrintJob job = { 0 };
+	PRINTER_SPOOL* spool = printer_spool_new(PRINTER_SPOOL_MEMORY_LIMIT, PRINTER_SPOOL_LIMIT);
+
+	if (!test_job_init(&job, 1, size) || !spool)
+		goto fail;
+
+	for (offset = 0; offset < size; offset += TEST_CHUNK)
+	{
+		if (printer_spool_write(spool, &job.printjob, &data[offset], TEST_CHUNK) !=
+		    CHANNEL_RC_OK)
+			goto fail;
+	}
+
+	if (job.writes > 1)
+	{
+		printf("writes waited for the backend\n");
+		goto fail;
+	}
+
+	SetEvent(job.gate);
+
+	if ((printer_spool_flush(spool, &job.printjob) != CHANNEL_RC_OK) ||
+	    !test_data(&job, data, size))
+		goto fail;
+
+	rc = TRUE;
+fail:
+	SetEvent(job.gate);
+	printer_spool_free(spool);
+	test_job_uninit(&job);
+	return rc;
+}
+
+/* A write over the limit waits until the backend catches up, spooled data goes to the file
+ * once the memory is used up */
+static BOOL test_backpressure(const BYTE* data, size_t size)
+{
+	size_t offset;
+	BOOL rc = FALSE;
+	TestPrintJob job = { 0 };
+	TestWriter writer = { 0 };
+	HANDLE thread = NULL;
+	const size_t limit = size - TEST_CHUNK;
+	PRINTER_SPOOL* spool = printer_spool_new(2 * TEST_CHUNK, limit);
+
+	if (!test_job_init(&job, 2, size) || !spool)
+		goto fail;
+
+	for (offset = 0; offset < limit; offset += TEST_CHUNK)
+	{
+		if (printer_spool_write(spool, &job.printjob, &data[offset], TEST_CHUNK) !=
+		    CHANNEL_RC_OK)
+			goto fail;
+	}
+
+	writer.spool = spool;
+	writer.job = &job;
+	writer.data = &data[limit];
+	writer.size = size - limit;
+	thread = CreateThread(NULL, 0, test_writer_thread, &writer, 0, NULL);
+
+	if (!thread)
+		goto fail;
+
+	if (WaitForSingleObject(thread, 100) != WAIT_TIMEOUT)
+	{
+		printf("write over the limit did not wait\n");
+		goto fail;
+	}
+
+	job.delay = 1;
+	SetEvent(job.gate);
+
+	if ((WaitForSingleObject(thread, INFINITE) != WAIT_OBJECT_0) ||
+	    (writer.error != CHANNEL_RC_OK))
+		goto fail;
+
+	if ((printer_spool_flush(spool, &job.printjob) != CHANNEL_RC_OK) ||
+	    !test_data(&job, data, size))
+		goto fail;
+
+	rc = TRUE;
+fail:
+	SetEvent(job.gate);
+
+	if (thread)
+	{
+		WaitForSingleObject(thread, INFINITE);
+		CloseHandle(thread);
+	}
+
+	printer_spool_free(spool);
+	test_job_uninit(&job);
+	return rc;
+}
+
+/* Writes larger than the limits and the file reads, interleaved with a second job */
+static BOOL test_large(const BYTE* data, size_t size)
+{
+	size_t offset;
+	size_t length;
+	BOOL rc = FALSE;
+	TestPrintJob job1 = { 0 };
+	TestPrintJob job2 = { 0 };
+	PRINTER_SPOOL* spool = printer_spool_new(8 * TEST_CHUNK, 64 * TEST_CHUNK);
+
+	if (!test_job_init(&job1, 3, size) || !test_job_init(&job2, 4, size) || !spool)
+		goto fail;
+
+	job1.delay = 1;
+	SetEvent(job1.gate);
+	SetEvent(job2.gate);
+
+	for (offset = 0, length = 1; offset < size; offset += length, length = length * 3 + 7)
+	{
+		length = MIN(length, size - offset);
+
+		if ((printer_spool_write(spool, &job1.printjob, &data[offset], length) !=
+		     CHANNEL_RC_OK) ||
+		    (printer_spool_write(spool, &job2.printjob, &data[offset], length) != CHANNEL_RC_OK))
+			goto fail;
+	}
+
+	if ((printer_spool_flush(spool, &job2.printjob) != CHANNEL_RC_OK) ||
+	    (printer_spool_flush(spool, &job1.printjob) != CHANNEL_RC_OK) ||
+	    !test_data(&job1, data, size) || !test_data(&job2, data, size))
+		goto fail;
+
+	rc = TRUE;
+fail:
+	printer_spool_free(spool);
+	test_job_uninit(&job1);
+	test_job_uninit(&job2);
+	return rc;
+}
+
+/* A failed write drops the rest of the job and is reported by the spool */
+static BOOL test_error(const BYTE* data, size_t size)
+{
+	size_t offset;
+	UINT error = CHANNEL_RC_OK;
+	BOOL rc = FALSE;
+	TestPrintJob job = { 0 };
+	PRINTER_SPOOL* spool = printer_spool_new(PRINTER_SPOOL_MEMORY_LIMIT, PRINTER_SPOOL_LIMIT);
+
+	if (!test_job_init(&job, 5, size) || !spool)
+		goto fail;
+
+	job.failAt = 2;
+
+	for (offset = 0; offset < size; offset += TEST_CHUNK)
+	{
+		if (printer_spool_write(spool, &job.printjob, &data[offset], TEST_CHUNK) !=
+		    CHANNEL_RC_OK)
+			goto fail;
+	}
+
+	SetEvent(job.gate);
+
+	/* Once the failure was seen writes of the job fail */
+	while (error == CHANNEL_RC_OK)
+	{
+		error = printer_spool_write(spool, &job.printjob, data, TEST_CHUNK);
+		Sleep(1);
+	}
+
+	if ((error != ERROR_WRITE_FAULT) ||
+	    (printer_spool_flush(spool, &job.printjob) != ERROR_WRITE_FAULT) || (job.writes != 2))
+		goto fail;
+
+	/* The job is gone after the flush */
+	if (printer_spool_flush(spool, &job.printjob) != CHANNEL_RC_OK)
+		goto fail;
+
+	rc = TRUE;
+fail:
+	SetEvent(job.gate);
+	printer_spool_free(spool);
+	test_job_uninit(&job);
+	return rc;
+}
+
+/* Freeing the spool writes what was spooled */
+static BOOL test_free(const BYTE* data, size_t size)
+{
+	size_t offset;
+	TestPrintJob job = { 0 };
+	BOOL rc = FALSE;
+	PRINTER_SPOOL* spool = printer_spool_new(2 * TEST_CHUNK, PRINTER_SPOOL_LIMIT);
+
+	if (!test_job_init(&job, 6, size) || !spool)
+		goto fail;
+
+	for (offset = 0; offset < size; offset += TEST_CHUNK)
+	{
+		if (printer_spool_write(spool, &job.printjob, &data[offset], TEST_CHUNK) !=
+		    CHANNEL_RC_OK)
+			goto fail;
+	}
+
+	SetEvent(job.gate);
+	printer_spool_free(spool);
+	spool = NULL;
+	rc = test_data(&job, data, size);
+fail:
+	printer_spool_free(spool);
+	test_job_uninit(&job);
+	return rc;
+}
+
+int TestPrinterSpool(int argc, char* argv[])
+{
+	int rc = -1;
+	const size_t size = 64 * TEST_CHUNK;
+	BYTE* data = malloc(size);
+
+	WINPR_UNUSED(argc);
+	WINPR_UNUSED(argv);
+
+	if (!data)
+		return -1;
+
+	test_fill(data, size);
+
+	if (!test_async(data, size))
+		goto fail;
+
+	if (!test_backpressure(data, 16 * TEST_CHUNK))
+		goto fail;
+
+	if (!test_large(data, size))
+		goto fail;
+
+	if (!test_error(data, 16 * TEST_CHUNK))
+		goto fail;
+
+	if (!test_free(data, 16 * TEST_CHUNK))
+		goto fail;
+
+	rc = 0;
+fail:
+	free(data);
+	return rc;
+}
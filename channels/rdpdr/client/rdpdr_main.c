@@ -715,7 +715,7 @@ static void handle_mountpoint(hotplug_dev* dev_array, size_t* size, const char*
 	if (isAutomountLocation(mountpoint) && (*size < MAX_USB_DEVICES))
 	{
 		dev_array[*size].path = _strdup(mountpoint);
-		dev_array[*size + 1].to_add = TRUE;
+		dev_array[*size].to_add = TRUE;
 		(*size)++;
 	}
 }
@@ -766,23 +766,38 @@ static UINT handle_platform_mounts_bsd(hotplug_dev* dev_array, size_t* size)
 #endif
 
 #if defined(__LINUX__) || defined(__linux__)
-#include <mntent.h>
+#include "rdpdr_mounts.h"
+
+struct hotplug_mounts_arg
+{
+	hotplug_dev* dev_array;
+	size_t* size;
+};
+
+static BOOL hotplug_mounts_add(void* context, const char* mountpoint, BOOL added)
+{
+	struct hotplug_mounts_arg* arg = (struct hotplug_mounts_arg*)context;
+
+	WINPR_ASSERT(arg);
+
+	if (added)
+		handle_mountpoint(arg->dev_array, arg->size, mountpoint);
+	return TRUE;
+}
+
 static UINT handle_platform_mounts_linux(hotplug_dev* dev_array, size_t* size)
 {
-	FILE* f;
-	struct mntent* ent;
-	f = winpr_fopen("/proc/mounts", "r");
-	if (f == NULL)
-	{
-		WLog_ERR(TAG, "fopen failed!");
-		return ERROR_OPEN_FAILED;
-	}
-	while ((ent = getmntent(f)) != NULL)
-	{
-		handle_mountpoint(dev_array, size, ent->mnt_dir);
-	}
-	fclose(f);
-	return ERROR_SUCCESS;
+	UINT error;
+	struct hotplug_mounts_arg arg = { dev_array, size };
+	rdpdrMountWatch* watch = rdpdr_mount_watch_new(RDPDR_MOUNTS_FILE, -1, 0);
+
+	if (!watch)
+		return CHANNEL_RC_NO_MEMORY;
+
+	/* The first update reports all mount points as added */
+	error = rdpdr_mount_watch_update(watch, hotplug_mounts_add, &arg);
+	rdpdr_mount_watch_free(watch);
+	return error;
 }
 #endif
 
@@ -907,6 +922,23 @@ static BOOL hotplug_delete_foreach(ULONG_PTR key, void* element, void* data)
 	return TRUE;
 }
 
+static UINT hotplug_add_device(rdpdrPlugin* rdpdr, char* path)
+{
+	UINT error;
+	RDPDR_DRIVE drive = { 0 };
+
+	drive.Type = RDPDR_DTYP_FILESYSTEM;
+	drive.Path = path;
+	drive.automount = TRUE;
+	drive.Name = strrchr(drive.Path, '/') + 1;
+
+	if ((error = devman_load_device_service(rdpdr->devman, (const RDPDR_DEVICE*)&drive,
+	                                        rdpdr->rdpcontext)))
+		WLog_ERR(TAG, "devman_load_device_service failed!");
+
+	return error;
+}
+
 static UINT handle_hotplug(rdpdrPlugin* rdpdr)
 {
 	hotplug_dev dev_array[MAX_USB_DEVICES] = { 0 };
@@ -929,28 +961,8 @@ static UINT handle_hotplug(rdpdrPlugin* rdpdr)
 		hotplug_dev* cur = &dev_array[i];
 		if (!device_already_plugged(rdpdr, cur))
 		{
-			RDPDR_DRIVE drive = { 0 };
-			char* name;
-
-			drive.Type = RDPDR_DTYP_FILESYSTEM;
-			drive.Path = cur->path;
-			drive.automount = TRUE;
-			name = strrchr(drive.Path, '/') + 1;
-			drive.Name = name;
-
-			if (!drive.Name)
-			{
-				WLog_ERR(TAG, "_strdup failed!");
-				error = CHANNEL_RC_NO_MEMORY;
+			if ((error = hotplug_add_device(rdpdr, cur->path)))
 				goto cleanup;
-			}
-
-			if ((error = devman_load_device_service(rdpdr->devman, (const RDPDR_DEVICE*)&drive,
-			                                        rdpdr->rdpcontext)))
-			{
-				WLog_ERR(TAG, "devman_load_device_service failed!");
-				goto cleanup;
-			}
 			error = ERROR_DISK_CHANGE;
 		}
 	}
@@ -984,11 +996,132 @@ static void first_hotplug(rdpdrPlugin* rdpdr)
 	}
 }
 
+#if defined(__LINUX__) || defined(__linux__)
+struct hotplug_changes_arg
+{
+	rdpdrPlugin* rdpdr;
+	BOOL added;
+};
+
+struct hotplug_remove_arg
+{
+	rdpdrPlugin* rdpdr;
+	const WCHAR* path;
+};
+
+static BOOL hotplug_remove_foreach(ULONG_PTR key, void* element, void* data)
+{
+	UINT error;
+	UINT32 ids[1];
+	struct hotplug_remove_arg* arg = (struct hotplug_remove_arg*)data;
+	DEVICE_DRIVE_EXT* device_ext = (DEVICE_DRIVE_EXT*)element;
+
+	WINPR_ASSERT(arg);
+	WINPR_ASSERT(arg->rdpdr);
+
+	if (!device_ext || (device_ext->device.type != RDPDR_DTYP_FILESYSTEM) || !device_ext->path ||
+	    !device_ext->automount || (_wcscmp(device_ext->path, arg->path) != 0))
+		return TRUE;
+
+	WINPR_ASSERT(arg->rdpdr->devman);
+	WINPR_ASSERT(key <= UINT32_MAX);
+	ids[0] = (UINT32)key;
+	devman_unregister_device(arg->rdpdr->devman, (void*)key);
+
+	error = rdpdr_send_device_list_remove_request(arg->rdpdr, 1, ids);
+	if (error)
+	{
+		WLog_ERR(TAG, "rdpdr_send_device_list_remove_request failed with error %" PRIu32 "!",
+		         error);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+static BOOL hotplug_mount_changed(void* context, const char* mountpoint, BOOL added)
+{
+	BOOL rc = TRUE;
+	WCHAR* path = NULL;
+	struct hotplug_changes_arg* arg = (struct hotplug_changes_arg*)context;
+
+	WINPR_ASSERT(arg);
+
+	if (!isAutomountLocation(mountpoint))
+		return TRUE;
+
+	if (ConvertToUnicode(CP_UTF8, 0, mountpoint, -1, &path, 0) <= 0)
+		return FALSE;
+
+	if (added)
+	{
+		/* first_hotplug might have added the drive already */
+		if (device_foreach(arg->rdpdr, TRUE, device_not_plugged, path))
+		{
+			char* drivePath = _strdup(mountpoint);
+
+			rc = drivePath && (hotplug_add_device(arg->rdpdr, drivePath) == CHANNEL_RC_OK);
+			arg->added |= rc;
+			free(drivePath);
+		}
+	}
+	else
+	{
+		struct hotplug_remove_arg remove = { arg->rdpdr, path };
+		/* Ignore result */ device_foreach(arg->rdpdr, FALSE, hotplug_remove_foreach, &remove);
+	}
+
+	free(path);
+	return rc;
+}
+
+/* Updates the drives for the mount points changed since the last call */
+static UINT handle_hotplug_changes(rdpdrPlugin* rdpdr, rdpdrMountWatch* watch)
+{
+	UINT error;
+	struct hotplug_changes_arg arg = { rdpdr, FALSE };
+
+	WINPR_ASSERT(rdpdr);
+	WINPR_ASSERT(rdpdr->devman);
+
+	error = rdpdr_mount_watch_update(watch, hotplug_mount_changed, &arg);
+
+	if (error && arg.added)
+	{
+		WLog_ERR(TAG, "rdpdr_mount_watch_update failed with error %" PRIu32 "!", error);
+		return ERROR_DISK_CHANGE;
+	}
+
+	return arg.added ? ERROR_DISK_CHANGE : error;
+}
+#endif
+
+static BOOL handle_hotplug_result(rdpdrPlugin* rdpdr, UINT error)
+{
+	switch (error)
+	{
+		case ERROR_DISK_CHANGE:
+			rdpdr_send_device_list_announce_request(rdpdr, TRUE);
+			break;
+		case CHANNEL_RC_OK:
+		case ERROR_OPEN_FAILED:
+		case ERROR_CALL_NOT_IMPLEMENTED:
+			break;
+		default:
+			WLog_ERR(TAG, "handle_hotplug failed with error %" PRIu32 "!", error);
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
 static DWORD WINAPI drive_hotplug_thread_func(LPVOID arg)
 {
 	rdpdrPlugin* rdpdr;
 	UINT error = 0;
-	DWORD status;
+#if defined(__LINUX__) || defined(__linux__)
+	rdpdrMountWatch* watch = NULL;
+#endif
 	rdpdr = (rdpdrPlugin*)arg;
 
 	WINPR_ASSERT(rdpdr);
@@ -998,29 +1131,34 @@ static DWORD WINAPI drive_hotplug_thread_func(LPVOID arg)
 	if (!rdpdr->stopEvent)
 		goto out;
 
-	while ((status = WaitForSingleObject(rdpdr->stopEvent, 1000)) == WAIT_TIMEOUT)
+#if defined(__LINUX__) || defined(__linux__)
+	watch = rdpdr_mount_watch_new(RDPDR_MOUNTS_FILE, -1, 0);
+	if (!watch)
+		goto out;
+
+	/* Sleep until the kernel signals a mount table change */
+	do
 	{
-		error = handle_hotplug(rdpdr);
-		switch (error)
-		{
-			case ERROR_DISK_CHANGE:
-				rdpdr_send_device_list_announce_request(rdpdr, TRUE);
-				break;
-			case CHANNEL_RC_OK:
-			case ERROR_OPEN_FAILED:
-			case ERROR_CALL_NOT_IMPLEMENTED:
-				break;
-			default:
-				WLog_ERR(TAG, "handle_hotplug failed with error %" PRIu32 "!", error);
-				goto out;
-		}
+		if (!handle_hotplug_result(rdpdr, handle_hotplug_changes(rdpdr, watch)))
+			goto out;
+	} while (rdpdr_mount_watch_wait(watch, rdpdr->stopEvent, INFINITE) == WAIT_OBJECT_0);
+#else
+	while (WaitForSingleObject(rdpdr->stopEvent, 1000) == WAIT_TIMEOUT)
+	{
+		if (!handle_hotplug_result(rdpdr, handle_hotplug(rdpdr)))
+			goto out;
 	}
+#endif
 
 out:
 	error = GetLastError();
 	if (error && rdpdr->rdpcontext)
 		setChannelError(rdpdr->rdpcontext, error, "%s reported an error", __FUNCTION__);
 
+#if defined(__LINUX__) || defined(__linux__)
+	rdpdr_mount_watch_free(watch);
+#endif
+
 	if (rdpdr->stopEvent)
 	{
 		CloseHandle(rdpdr->stopEvent);
@@ -0,0 +1,270 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * Device Redirection Virtual Channel
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <mntent.h>
+#include <unistd.h>
+
+#include <winpr/crt.h>
+#include <winpr/file.h>
+#include <winpr/synch.h>
+#include <winpr/wtsapi.h>
+
+#include <freerdp/channels/log.h>
+
+#include "rdpdr_mounts.h"
+
+#define TAG CHANNELS_TAG("rdpdr.client")
+
+struct rdpdr_mount_watch
+{
+	char* file;
+	int fd;
+	short events;
+	BOOL ownsFd;
+
+	/* sorted mount points of the last update */
+	char** mountpoints;
+	size_t count;
+};
+
+static int mountpoint_compare(const void* a, const void* b)
+{
+	return strcmp(*(const char* const*)a, *(const char* const*)b);
+}
+
+static void mountpoints_free(char** mountpoints, size_t count)
+{
+	size_t x;
+
+	for (x = 0; x < count; x++)
+		free(mountpoints[x]);
+
+	free(mountpoints);
+}
+
+static UINT mountpoints_read(const char* file, char*** pMountpoints, size_t* pCount)
+{
+	FILE* f;
+	struct mntent ent;
+	char buffer[4096];
+	size_t x, count = 0, unique = 0;
+	size_t size = 32;
+	char** mountpoints = calloc(size, sizeof(char*));
+
+	if (!mountpoints)
+		return CHANNEL_RC_NO_MEMORY;
+
+	f = winpr_fopen(file, "r");
+
+	if (!f)
+	{
+		WLog_ERR(TAG, "fopen %s failed!", file);
+		free(mountpoints);
+		return ERROR_OPEN_FAILED;
+	}
+
+	/* getmntent_r as the table is read from the channel and the hotplug thread */
+	while (getmntent_r(f, &ent, buffer, sizeof(buffer)))
+	{
+		if (count == size)
+		{
+			char** tmp = realloc(mountpoints, size * 2 * sizeof(char*));
+
+			if (!tmp)
+				goto fail;
+
+			mountpoints = tmp;
+			size *= 2;
+		}
+
+		mountpoints[count] = _strdup(ent.mnt_dir);
+
+		if (!mountpoints[count])
+			goto fail;
+
+		count++;
+	}
+
+	fclose(f);
+	qsort(mountpoints, count, sizeof(char*), mountpoint_compare);
+
+	/* Stacked mounts list a mount point more than once */
+	for (x = 0; x < count; x++)
+	{
+		if ((unique > 0) && (strcmp(mountpoints[unique - 1], mountpoints[x]) == 0))
+			free(mountpoints[x]);
+		else
+			mountpoints[unique++] = mountpoints[x];
+	}
+
+	*pMountpoints = mountpoints;
+	*pCount = unique;
+	return CHANNEL_RC_OK;
+fail:
+	fclose(f);
+	mountpoints_free(mountpoints, count);
+	return CHANNEL_RC_NO_MEMORY;
+}
+
+rdpdrMountWatch* rdpdr_mount_watch_new(const char* file, int fd, short events)
+{
+	rdpdrMountWatch* watch = calloc(1, sizeof(rdpdrMountWatch));
+
+	if (!watch)
+		return NULL;
+
+	watch->file = _strdup(file);
+
+	if (!watch->file)
+		goto fail;
+
+	watch->fd = fd;
+	watch->events = events;
+
+	if (fd < 0)
+	{
+		watch->fd = open(file, O_RDONLY | O_CLOEXEC);
+		watch->events = POLLPRI;
+		watch->ownsFd = TRUE;
+
+		if (watch->fd < 0)
+			WLog_WARN(TAG, "open %s failed with %s, polling for changes", file, strerror(errno));
+	}
+
+	return watch;
+fail:
+	rdpdr_mount_watch_free(watch);
+	return NULL;
+}
+
+void rdpdr_mount_watch_free(rdpdrMountWatch* watch)
+{
+	if (!watch)
+		return;
+
+	if (watch->ownsFd && (watch->fd >= 0))
+		close(watch->fd);
+
+	mountpoints_free(watch->mountpoints, watch->count);
+	free(watch->file);
+	free(watch);
+}
+
+DWORD rdpdr_mount_watch_wait(rdpdrMountWatch* watch, HANDLE stopEvent, DWORD timeout)
+{
+	int status;
+	nfds_t nfds = 1;
+	struct pollfd fds[2] = { 0 };
+
+	if (!watch)
+		return WAIT_FAILED;
+
+	fds[0].fd = GetEventFileDescriptor(stopEvent);
+	fds[0].events = POLLIN;
+
+	if (fds[0].fd < 0)
+		return WAIT_FAILED;
+
+	if (watch->fd >= 0)
+	{
+		fds[1].fd = watch->fd;
+		fds[1].events = watch->events;
+		nfds++;
+	}
+	else if (timeout > 1000)
+		timeout = 1000;
+
+	do
+	{
+		status = poll(fds, nfds, (timeout == INFINITE) ? -1 : (int)timeout);
+	} while ((status < 0) && (errno == EINTR));
+
+	if (status < 0)
+		return WAIT_FAILED;
+
+	if (fds[0].revents & POLLIN)
+		return WAIT_OBJECT_0 + 1;
+
+	/* The kernel reports a mount table change as POLLERR | POLLPRI */
+	if (fds[1].revents & (watch->events | POLLERR))
+		return WAIT_OBJECT_0;
+
+	return (watch->fd < 0) ? WAIT_OBJECT_0 : WAIT_TIMEOUT;
+}
+
+UINT rdpdr_mount_watch_update(rdpdrMountWatch* watch, pcMountChanged fkt, void* context)
+{
+	size_t x = 0;
+	size_t y = 0;
+	size_t count = 0;
+	char** mountpoints = NULL;
+	BOOL rc = TRUE;
+	UINT error;
+
+	if (!watch || !fkt)
+		return ERROR_INVALID_PARAMETER;
+
+	error = mountpoints_read(watch->file, &mountpoints, &count);
+
+	if (error)
+		return error;
+
+	/* Both tables are sorted, so a single merge finds all changes */
+	while ((x < watch->count) || (y < count))
+	{
+		int cmp;
+
+		if (x == watch->count)
+			cmp = 1;
+		else if (y == count)
+			cmp = -1;
+		else
+			cmp = strcmp(watch->mountpoints[x], mountpoints[y]);
+
+		if (cmp < 0)
+			rc = fkt(context, watch->mountpoints[x++], FALSE);
+		else if (cmp > 0)
+			rc = fkt(context, mountpoints[y++], TRUE);
+		else
+		{
+			x++;
+			y++;
+		}
+
+		/* Keep the old table, the changes are reported again on the next update */
+		if (!rc)
+		{
+			mountpoints_free(mountpoints, count);
+			return ERROR_INTERNAL_ERROR;
+		}
+	}
+
+	mountpoints_free(watch->mountpoints, watch->count);
+	watch->mountpoints = mountpoints;
+	watch->count = count;
+	return CHANNEL_RC_OK;
+}
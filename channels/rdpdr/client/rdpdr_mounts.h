@@ -0,0 +1,43 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * Device Redirection Virtual Channel
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FREERDP_CHANNEL_RDPDR_CLIENT_MOUNTS_H
+#define FREERDP_CHANNEL_RDPDR_CLIENT_MOUNTS_H
+
+#include <winpr/wtypes.h>
+
+#define RDPDR_MOUNTS_FILE "/proc/self/mounts"
+
+typedef struct rdpdr_mount_watch rdpdrMountWatch;
+
+typedef BOOL (*pcMountChanged)(void* context, const char* mountpoint, BOOL added);
+
+/* Watches the mount table in file. Changes are signalled by fd becoming ready for events,
+ * a negative fd polls file itself for POLLPRI as supported by /proc/self/mounts.
+ * The watch does not take ownership of fd. */
+rdpdrMountWatch* rdpdr_mount_watch_new(const char* file, int fd, short events);
+void rdpdr_mount_watch_free(rdpdrMountWatch* watch);
+
+/* Returns WAIT_OBJECT_0 on a change and WAIT_OBJECT_0 + 1 if stopEvent is set.
+ * Without change notification the mount table is checked once a second. */
+DWORD rdpdr_mount_watch_wait(rdpdrMountWatch* watch, HANDLE stopEvent, DWORD timeout);
+
+/* Reports the mount points added or removed since the last update. If fkt fails the update
+ * is aborted and the changes are reported again by the next one. */
+UINT rdpdr_mount_watch_update(rdpdrMountWatch* watch, pcMountChanged fkt, void* context);
+
+#endif /* FREERDP_CHANNEL_RDPDR_CLIENT_MOUNTS_H */
@@ -0,0 +1,222 @@
+#include <stdio.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+
+#include <winpr/crt.h>
+#include <winpr/file.h>
+#include <winpr/path.h>
+#include <winpr/synch.h>
+#include <winpr/thread.h>
+
+#include "../rdpdr_mounts.h"
+
+#define MAX_CHANGES 8
+
+typedef struct
+{
+	const char* added[MAX_CHANGES];
+	size_t addedCount;
+	const char* removed[MAX_CHANGES];
+	size_t removedCount;
+	BOOL fail;
+} TestChanges;
+
+static BOOL test_mount_changed(void* context, const char* mountpoint, BOOL added)
+{
+	TestChanges* changes = (TestChanges*)context;
+
+	if (changes->fail)
+		return FALSE;
+
+	if (added && (changes->addedCount < MAX_CHANGES))
+		changes->added[changes->addedCount++] = _strdup(mountpoint);
+	else if (!added && (changes->removedCount < MAX_CHANGES))
+		changes->removed[changes->removedCount++] = _strdup(mountpoint);
+
+	return TRUE;
+}
+
+static void test_changes_reset(TestChanges* changes)
+{
+	size_t x;
+
+	for (x = 0; x < changes->addedCount; x++)
+		free((char*)changes->added[x]);
+
+	for (x = 0; x < changes->removedCount; x++)
+		free((char*)changes->removed[x]);
+
+	ZeroMemory(changes, sizeof(TestChanges));
+}
+
+static BOOL test_write_mounts(const char* file, const char* content)
+{
+	FILE* f = winpr_fopen(file, "w");
+
+	if (!f)
+		return FALSE;
+
+	fputs(content, f);
+	fclose(f);
+	return TRUE;
+}
+
+static BOOL test_signal(int fd)
+{
+	const UINT64 value = 1;
+	return write(fd, &value, sizeof(value)) == sizeof(value);
+}
+
+static void test_drain(int fd)
+{
+	UINT64 value;
+	WINPR_UNUSED(read(fd, &value, sizeof(value)));
+}
+
+static BOOL test_expect(const TestChanges* changes, const char* added, const char* removed)
+{
+	if (changes->addedCount != (added ? 1 : 0) || changes->removedCount != (removed ? 1 : 0))
+	{
+		fprintf(stderr, "got %" PRIuz " added and %" PRIuz " removed mount points\n",
+		        changes->addedCount, changes->removedCount);
+		return FALSE;
+	}
+
+	if ((added && (strcmp(changes->added[0], added) != 0)) ||
+	    (removed && (strcmp(changes->removed[0], removed) != 0)))
+	{
+		fprintf(stderr, "unexpected mount point change\n");
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+int TestRdpdrMounts(int argc, char* argv[])
+{
+	int rc = -1;
+	int fd = -1;
+	char name[64];
+	char* file = NULL;
+	HANDLE stopEvent = NULL;
+	rdpdrMountWatch* watch = NULL;
+	rdpdrMountWatch* proc = NULL;
+	TestChanges changes = { 0 };
+
+	WINPR_UNUSED(argc);
+	WINPR_UNUSED(argv);
+
+	sprintf_s(name, sizeof(name), "TestRdpdrMounts-%" PRIu32, GetCurrentProcessId());
+	file = GetKnownSubPath(KNOWN_PATH_TEMP, name);
+	fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	stopEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+
+	if (!file || (fd < 0) || !stopEvent)
+		goto fail;
+
+	if (!test_write_mounts(file, "/dev/sda1 / ext4 rw 0 0\n"
+	                             "proc /proc proc rw 0 0\n"
+	                             "/dev/sdb1 /media/user/USB vfat rw 0 0\n"
+	                             "/dev/sdb1 /media/user/USB vfat rw 0 0\n"))
+		goto fail;
+
+	watch = rdpdr_mount_watch_new(file, fd, POLLIN);
+
+	if (!watch)
+		goto fail;
+
+	/* The first update reports every mount point once */
+	if ((rdpdr_mount_watch_update(watch, test_mount_changed, &changes) != 0) ||
+	    (changes.addedCount != 3) || (changes.removedCount != 0))
+	{
+		fprintf(stderr, "initial mount table not reported\n");
+		goto fail;
+	}
+
+	test_changes_reset(&changes);
+
+	/* No wakeup without a change */
+	if (rdpdr_mount_watch_wait(watch, stopEvent, 10) != WAIT_TIMEOUT)
+	{
+		fprintf(stderr, "wait returned without a change\n");
+		goto fail;
+	}
+
+	/* Replace the USB drive, an escaped space must be decoded */
+	if (!test_write_mounts(file, "/dev/sda1 / ext4 rw 0 0\n"
+	                             "proc /proc proc rw 0 0\n"
+	                             "/dev/sdc1 /media/user/My\\040Disk vfat rw 0 0\n") ||
+	    !test_signal(fd))
+		goto fail;
+
+	if (rdpdr_mount_watch_wait(watch, stopEvent, INFINITE) != WAIT_OBJECT_0)
+	{
+		fprintf(stderr, "mount table change not signalled\n");
+		goto fail;
+	}
+
+	test_drain(fd);
+
+	/* A failing callback keeps the old table */
+	changes.fail = TRUE;
+
+	if (rdpdr_mount_watch_update(watch, test_mount_changed, &changes) == 0)
+		goto fail;
+
+	test_changes_reset(&changes);
+
+	if ((rdpdr_mount_watch_update(watch, test_mount_changed, &changes) != 0) ||
+	    !test_expect(&changes, "/media/user/My Disk", "/media/user/USB"))
+		goto fail;
+
+	test_changes_reset(&changes);
+
+	if ((rdpdr_mount_watch_update(watch, test_mount_changed, &changes) != 0) ||
+	    !test_expect(&changes, NULL, NULL))
+		goto fail;
+
+	/* The stop event takes precedence over a pending change */
+	if (!test_signal(fd) || !SetEvent(stopEvent))
+		goto fail;
+
+	if (rdpdr_mount_watch_wait(watch, stopEvent, INFINITE) != WAIT_OBJECT_0 + 1)
+	{
+		fprintf(stderr, "stop event not signalled\n");
+		goto fail;
+	}
+
+	/* The real mount table does not signal a change until one happens */
+	if (!ResetEvent(stopEvent))
+		goto fail;
+
+	proc = rdpdr_mount_watch_new(RDPDR_MOUNTS_FILE, -1, 0);
+
+	if (!proc || (rdpdr_mount_watch_update(proc, test_mount_changed, &changes) != 0))
+		goto fail;
+
+	if (winpr_PathFileExists(RDPDR_MOUNTS_FILE) &&
+	    (rdpdr_mount_watch_wait(proc, stopEvent, 10) != WAIT_TIMEOUT))
+	{
+		fprintf(stderr, "spurious change of %s\n", RDPDR_MOUNTS_FILE);
+		goto fail;
+	}
+
+	rc = 0;
+fail:
+	test_changes_reset(&changes);
+	rdpdr_mount_watch_free(watch);
+	rdpdr_mount_watch_free(proc);
+
+	if (stopEvent)
+		CloseHandle(stopEvent);
+
+	if (fd >= 0)
+		close(fd);
+
+	if (file)
+		winpr_DeleteFile(file);
+
+	free(file);
+	return rc;
+}
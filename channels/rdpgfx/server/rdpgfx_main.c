@@ -92,11 +92,18 @@ static INLINE BOOL rdpgfx_server_packet_complete_header(wStream* s, size_t start
  *
  * @return 0 on success, otherwise a Win32 error code
  */
+static void rdpgfx_server_packet_free(void* context, BYTE* buffer)
+{
+	WINPR_UNUSED(context);
+	free(buffer);
+}
+
 static UINT rdpgfx_server_packet_send(RdpgfxServerContext* context, wStream* s)
 {
 	UINT error;
 	UINT32 flags = 0;
-	ULONG written;
+	size_t length;
+	BYTE* buffer;
 	BYTE* pSrcData = Stream_Buffer(s);
 	UINT32 SrcSize = Stream_GetPosition(s);
 	wStream* fs;
@@ -119,20 +126,20 @@ static UINT rdpgfx_server_packet_send(RdpgfxServerContext* context, wStream* s)
 		goto out;
 	}
 
-	if (!WTSVirtualChannelWrite(context->priv->rdpgfx_channel, (PCHAR)Stream_Buffer(fs),
-	                            Stream_GetPosition(fs), &written))
+	/* The channel sends the compressed PDU in place and frees it once it is sent */
+	length = Stream_GetPosition(fs);
+	buffer = Stream_Buffer(fs);
+	Stream_Free(fs, FALSE);
+	fs = NULL;
+
+	if (!WTSVirtualChannelWriteBuffer(context->priv->rdpgfx_channel, buffer, (ULONG)length,
+	                                  rdpgfx_server_packet_free, NULL))
 	{
-		WLog_ERR(TAG, "WTSVirtualChannelWrite failed!");
+		WLog_ERR(TAG, "WTSVirtualChannelWriteBuffer failed!");
 		error = ERROR_INTERNAL_ERROR;
 		goto out;
 	}
 
-	if (written < Stream_GetPosition(fs))
-	{
-		WLog_WARN(TAG, "Unexpected bytes written: %" PRIu32 "/%" PRIuz "", written,
-		          Stream_GetPosition(fs));
-	}
-
 	error = CHANNEL_RC_OK;
 out:
 	Stream_Free(fs, TRUE);
@@ -1461,6 +1468,10 @@ static BOOL rdpgfx_server_open(RdpgfxServerContext* context)
 			return FALSE;
 		}
 
+		/* Surface data is bulk, other channels must not wait behind whole frames */
+		if (!WTSVirtualChannelSetPriority(priv->rdpgfx_channel, WTS_CHANNEL_PRIORITY_LOW))
+			WLog_WARN(TAG, "WTSVirtualChannelSetPriority failed!");
+
 		/* Query for channel event handle */
 		if (!WTSVirtualChannelQuery(priv->rdpgfx_channel, WTSVirtualEventHandle, &buffer,
 		                            &BytesReturned) ||
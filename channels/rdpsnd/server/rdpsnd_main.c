@@ -894,6 +894,16 @@ HANDLE rdpsnd_server_get_event_handle(RdpsndServerContext* context)
 	return context->priv->channelEvent;
 }
 
+/* The encoder options survive the reset done for every selected format */
+BOOL rdpsnd_server_set_dsp_option(RdpsndServerContext* context, FREERDP_DSP_OPTION option,
+                                  UINT32 value)
+{
+	if (!context || !context->priv)
+		return FALSE;
+
+	return freerdp_dsp_context_set_option(context->priv->dsp_context, option, value);
+}
+
 /*
  * Handle rpdsnd messages - server side
  *
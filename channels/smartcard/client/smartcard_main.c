@@ -57,9 +57,8 @@ static SMARTCARD_DEVICE* cast_device_from(DEVICE* device, const char* fkt, const
 	return (SMARTCARD_DEVICE*)device;
 }
 
-static DWORD WINAPI smartcard_context_thread(LPVOID arg)
+static DWORD smartcard_context_process(SMARTCARD_CONTEXT* pContext, wMessageQueue* queue)
 {
-	SMARTCARD_CONTEXT* pContext = (SMARTCARD_CONTEXT*)arg;
 	DWORD nCount;
 	LONG status = 0;
 	DWORD waitStatus;
@@ -70,7 +69,7 @@ static DWORD WINAPI smartcard_context_thread(LPVOID arg)
 	UINT error = CHANNEL_RC_OK;
 	smartcard = pContext->smartcard;
 	nCount = 0;
-	hEvents[nCount++] = MessageQueue_Event(pContext->IrpQueue);
+	hEvents[nCount++] = MessageQueue_Event(queue);
 
 	while (1)
 	{
@@ -83,7 +82,7 @@ static DWORD WINAPI smartcard_context_thread(LPVOID arg)
 			break;
 		}
 
-		waitStatus = WaitForSingleObject(MessageQueue_Event(pContext->IrpQueue), 0);
+		waitStatus = WaitForSingleObject(MessageQueue_Event(queue), 0);
 
 		if (waitStatus == WAIT_FAILED)
 		{
@@ -94,7 +93,7 @@ static DWORD WINAPI smartcard_context_thread(LPVOID arg)
 
 		if (waitStatus == WAIT_OBJECT_0)
 		{
-			if (!MessageQueue_Peek(pContext->IrpQueue, &message, TRUE))
+			if (!MessageQueue_Peek(queue, &message, TRUE))
 			{
 				WLog_ERR(TAG, "MessageQueue_Peek failed!");
 				status = ERROR_INTERNAL_ERROR;
@@ -134,6 +133,18 @@ static DWORD WINAPI smartcard_context_thread(LPVOID arg)
 	return error;
 }
 
+static DWORD WINAPI smartcard_context_thread(LPVOID arg)
+{
+	SMARTCARD_CONTEXT* pContext = (SMARTCARD_CONTEXT*)arg;
+	return smartcard_context_process(pContext, pContext->IrpQueue);
+}
+
+static DWORD WINAPI smartcard_status_change_thread(LPVOID arg)
+{
+	SMARTCARD_CONTEXT* pContext = (SMARTCARD_CONTEXT*)arg;
+	return smartcard_context_process(pContext, pContext->StatusChangeQueue);
+}
+
 SMARTCARD_CONTEXT* smartcard_context_new(SMARTCARD_DEVICE* smartcard, SCARDCONTEXT hContext)
 {
 	SMARTCARD_CONTEXT* pContext;
@@ -155,6 +166,14 @@ SMARTCARD_CONTEXT* smartcard_context_new(SMARTCARD_DEVICE* smartcard, SCARDCONTE
 		goto error_irpqueue;
 	}
 
+	pContext->StatusChangeQueue = MessageQueue_New(NULL);
+
+	if (!pContext->StatusChangeQueue)
+	{
+		WLog_ERR(TAG, "MessageQueue_New failed!");
+		goto error_statuschangequeue;
+	}
+
 	pContext->thread = CreateThread(NULL, 0, smartcard_context_thread, pContext, 0, NULL);
 
 	if (!pContext->thread)
@@ -163,8 +182,25 @@ SMARTCARD_CONTEXT* smartcard_context_new(SMARTCARD_DEVICE* smartcard, SCARDCONTE
 		goto error_thread;
 	}
 
+	pContext->statusChangeThread =
+	    CreateThread(NULL, 0, smartcard_status_change_thread, pContext, 0, NULL);
+
+	if (!pContext->statusChangeThread)
+	{
+		WLog_ERR(TAG, "CreateThread failed!");
+		goto error_statuschangethread;
+	}
+
 	return pContext;
+error_statuschangethread:
+	if (MessageQueue_PostQuit(pContext->IrpQueue, 0) &&
+	    (WaitForSingleObject(pContext->thread, INFINITE) == WAIT_FAILED))
+		WLog_ERR(TAG, "WaitForSingleObject failed with error %" PRIu32 "!", GetLastError());
+
+	CloseHandle(pContext->thread);
 error_thread:
+	MessageQueue_Free(pContext->StatusChangeQueue);
+error_statuschangequeue:
 	MessageQueue_Free(pContext->IrpQueue);
 error_irpqueue:
 	free(pContext);
@@ -186,8 +222,14 @@ void smartcard_context_free(void* pCtx)
 	    (WaitForSingleObject(pContext->thread, INFINITE) == WAIT_FAILED))
 		WLog_ERR(TAG, "WaitForSingleObject failed with error %" PRIu32 "!", GetLastError());
 
+	if (MessageQueue_PostQuit(pContext->StatusChangeQueue, 0) &&
+	    (WaitForSingleObject(pContext->statusChangeThread, INFINITE) == WAIT_FAILED))
+		WLog_ERR(TAG, "WaitForSingleObject failed with error %" PRIu32 "!", GetLastError());
+
 	CloseHandle(pContext->thread);
+	CloseHandle(pContext->statusChangeThread);
 	MessageQueue_Free(pContext->IrpQueue);
+	MessageQueue_Free(pContext->StatusChangeQueue);
 	free(pContext);
 }
 
@@ -360,6 +402,32 @@ static UINT smartcard_complete_irp(SMARTCARD_DEVICE* smartcard, IRP* irp)
  * http://musclecard.996296.n3.nabble.com/Multiple-threads-and-SCardGetStatusChange-td4430.html
  */
 
+/**
+ * SCardGetStatusChange may wait for a long time, it is processed on a separate thread so it does
+ * not hold up the other calls of the context.
+ */
+static wMessageQueue* smartcard_context_queue(SMARTCARD_CONTEXT* pContext,
+                                              const SMARTCARD_OPERATION* operation)
+{
+	switch (operation->ioControlCode)
+	{
+		case SCARD_IOCTL_GETSTATUSCHANGEA:
+			if (operation->call.getStatusChangeA.dwTimeOut != 0)
+				return pContext->StatusChangeQueue;
+			break;
+
+		case SCARD_IOCTL_GETSTATUSCHANGEW:
+			if (operation->call.getStatusChangeW.dwTimeOut != 0)
+				return pContext->StatusChangeQueue;
+			break;
+
+		default:
+			break;
+	}
+
+	return pContext->IrpQueue;
+}
+
 /**
  * Function description
  *
@@ -496,7 +564,8 @@ static UINT smartcard_process_irp(SMARTCARD_DEVICE* smartcard, IRP* irp)
 		{
 			if (pContext)
 			{
-				if (!MessageQueue_Post(pContext->IrpQueue, NULL, 0, (void*)operation, NULL))
+				if (!MessageQueue_Post(smartcard_context_queue(pContext, operation), NULL, 0,
+				                       (void*)operation, NULL))
 				{
 					WLog_ERR(TAG, "MessageQueue_Post failed!");
 					return ERROR_INTERNAL_ERROR;
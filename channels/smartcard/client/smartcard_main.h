@@ -44,6 +44,10 @@ struct _SMARTCARD_CONTEXT
 	SCARDCONTEXT hContext;
 	wMessageQueue* IrpQueue;
 	SMARTCARD_DEVICE* smartcard;
+
+	/* blocking SCardGetStatusChange calls are processed separately */
+	HANDLE statusChangeThread;
+	wMessageQueue* StatusChangeQueue;
 };
 typedef struct _SMARTCARD_CONTEXT SMARTCARD_CONTEXT;
 
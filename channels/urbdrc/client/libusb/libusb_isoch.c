@@ -0,0 +1,486 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * RemoteFX USB Redirection
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+
+#include <winpr/crt.h>
+#include <winpr/synch.h>
+#include <winpr/collections.h>
+
+#include "libusb_isoch.h"
+
+typedef struct _ISOCH_PENDING ISOCH_PENDING;
+
+/* Isochronous IN transfers are submitted ahead of the server URBs. Completed transfers are
+ * matched in submission order with the URBs as they arrive, a URB is only waiting for the
+ * device if no transfer completed since the last one. At most depth transfers are submitted
+ * or completed and unclaimed, a stalled server stops the pipeline instead of buffering. */
+struct _ISOCH_PIPELINE
+{
+	CRITICAL_SECTION lock;
+	ISOCH_PIPELINE_OPS ops;
+	void* context;
+	wStreamPool* pool;
+	UINT32 depth;
+
+	/* geometry of the last request, new transfers are submitted with it */
+	UINT32 NumberOfPackets;
+	UINT32 BufferSize;
+
+	wArrayList* submitted; /* ISOCH_TRANSFER in submission order */
+	wArrayList* requests;  /* ISOCH_PENDING in arrival order */
+	wArrayList* idle;      /* ISOCH_TRANSFER for reuse */
+	BOOL closed;
+
+	/* answered requests, sent by the delivering thread once the lock is released */
+	ISOCH_PENDING* completedHead;
+	ISOCH_PENDING* completedTail;
+	BOOL delivering;
+	HANDLE delivered; /* set while no thread is delivering */
+	BOOL freeing;     /* isoch_pipeline_free waits for the delivering thread */
+};
+
+/* A waiting request, the completion is allocated with it so that answering can not fail */
+struct _ISOCH_PENDING
+{
+	ISOCH_COMPLETION completion;
+	ISOCH_PENDING* next;
+};
+
+static void isoch_pipeline_discard_completed(ISOCH_PIPELINE* pipeline)
+{
+	while (pipeline->completedHead)
+	{
+		ISOCH_PENDING* pending = pipeline->completedHead;
+		pipeline->completedHead = pending->next;
+
+		if (pending->completion.data)
+			Stream_Release(pending->completion.data);
+
+		free(pending);
+	}
+
+	pipeline->completedTail = NULL;
+}
+
+static void isoch_pipeline_destroy(ISOCH_PIPELINE* pipeline)
+{
+	size_t x;
+
+	if (!pipeline)
+		return;
+
+	for (x = 0; x < ArrayList_Count(pipeline->idle); x++)
+	{
+		ISOCH_TRANSFER* transfer = ArrayList_GetItem(pipeline->idle, x);
+		pipeline->ops.release(transfer);
+		free(transfer);
+	}
+
+	for (x = 0; x < ArrayList_Count(pipeline->requests); x++)
+		free(ArrayList_GetItem(pipeline->requests, x));
+
+	isoch_pipeline_discard_completed(pipeline);
+	ArrayList_Free(pipeline->idle);
+	ArrayList_Free(pipeline->requests);
+	ArrayList_Free(pipeline->submitted);
+	StreamPool_Free(pipeline->pool);
+
+	if (pipeline->delivered)
+		CloseHandle(pipeline->delivered);
+
+	DeleteCriticalSection(&pipeline->lock);
+	free(pipeline);
+}
+
+/* Answers a request removed from the request list, must be called with the lock held. The
+ * transfer data moves to the completion, a NULL transfer answers the request as cancelled. */
+static void isoch_pipeline_answer(ISOCH_PIPELINE* pipeline, ISOCH_PENDING* pending,
+                                  ISOCH_TRANSFER* transfer)
+{
+	ISOCH_COMPLETION* completion = &pending->completion;
+
+	if (transfer)
+	{
+		completion->data = transfer->data;
+		completion->NumberOfPackets = transfer->NumberOfPackets;
+		completion->status = transfer->status;
+		completion->ErrorCount = transfer->ErrorCount;
+		transfer->data = NULL;
+	}
+
+	pending->next = NULL;
+
+	if (pipeline->completedTail)
+		pipeline->completedTail->next = pending;
+	else
+		pipeline->completedHead = pending;
+
+	pipeline->completedTail = pending;
+}
+
+/* Leaves the lock taken by the caller. Answered requests are sent first with the lock released,
+ * by one thread at a time so that they keep their order. Returns TRUE if the caller has to
+ * destroy the closed pipeline. */
+static BOOL isoch_pipeline_unlock(ISOCH_PIPELINE* pipeline)
+{
+	BOOL destroy;
+
+	if (!pipeline->delivering && pipeline->completedHead)
+	{
+		pipeline->delivering = TRUE;
+		ResetEvent(pipeline->delivered);
+
+		while (pipeline->completedHead)
+		{
+			ISOCH_PENDING* pending = pipeline->completedHead;
+			pipeline->completedHead = pending->next;
+
+			if (!pipeline->completedHead)
+				pipeline->completedTail = NULL;
+
+			LeaveCriticalSection(&pipeline->lock);
+			pipeline->ops.complete(pipeline->context, &pending->completion);
+			free(pending);
+			EnterCriticalSection(&pipeline->lock);
+		}
+
+		pipeline->delivering = FALSE;
+		SetEvent(pipeline->delivered);
+	}
+
+	destroy = pipeline->closed && !pipeline->delivering && !pipeline->freeing &&
+	          (ArrayList_Count(pipeline->submitted) == 0);
+	LeaveCriticalSection(&pipeline->lock);
+	return destroy;
+}
+
+static void isoch_transfer_recycle(ISOCH_PIPELINE* pipeline, ISOCH_TRANSFER* transfer)
+{
+	if (transfer->data)
+		Stream_Release(transfer->data);
+
+	transfer->data = NULL;
+
+	if (pipeline->closed || !ArrayList_Append(pipeline->idle, transfer))
+	{
+		pipeline->ops.release(transfer);
+		free(transfer);
+	}
+}
+
+static ISOCH_TRANSFER* isoch_transfer_take(ISOCH_PIPELINE* pipeline)
+{
+	ISOCH_TRANSFER* transfer;
+	const size_t size = ISOCH_DATA_OFFSET(pipeline->NumberOfPackets) + pipeline->BufferSize;
+
+	if (ArrayList_Count(pipeline->idle) > 0)
+	{
+		transfer = ArrayList_GetItem(pipeline->idle, 0);
+		ArrayList_RemoveAt(pipeline->idle, 0);
+	}
+	else
+	{
+		transfer = calloc(1, sizeof(ISOCH_TRANSFER));
+
+		if (!transfer)
+			return NULL;
+
+		transfer->pipeline = pipeline;
+	}
+
+	transfer->data = StreamPool_Take(pipeline->pool, size);
+
+	if (!transfer->data)
+	{
+		isoch_transfer_recycle(pipeline, transfer);
+		return NULL;
+	}
+
+	transfer->NumberOfPackets = pipeline->NumberOfPackets;
+	transfer->BufferSize = pipeline->BufferSize;
+	transfer->status = 0;
+	transfer->ErrorCount = 0;
+	transfer->done = FALSE;
+	transfer->stale = FALSE;
+	Stream_SetPosition(transfer->data, ISOCH_DATA_OFFSET(transfer->NumberOfPackets));
+	return transfer;
+}
+
+static void isoch_pipeline_stop_locked(ISOCH_PIPELINE* pipeline, BOOL complete)
+{
+	size_t x;
+
+	for (x = 0; x < ArrayList_Count(pipeline->submitted); x++)
+	{
+		ISOCH_TRANSFER* transfer = ArrayList_GetItem(pipeline->submitted, x);
+
+		if (!transfer->done && !transfer->stale)
+			pipeline->ops.cancel(pipeline->context, transfer);
+
+		transfer->stale = TRUE;
+	}
+
+	while (ArrayList_Count(pipeline->requests) > 0)
+	{
+		ISOCH_PENDING* pending = ArrayList_GetItem(pipeline->requests, 0);
+		ArrayList_RemoveAt(pipeline->requests, 0);
+
+		if (complete)
+			isoch_pipeline_answer(pipeline, pending, NULL);
+		else
+			free(pending);
+	}
+
+	pipeline->NumberOfPackets = 0;
+	pipeline->BufferSize = 0;
+}
+
+/* Answer requests with completed transfers from the head of the pipeline */
+static void isoch_pipeline_dispatch(ISOCH_PIPELINE* pipeline)
+{
+	while (ArrayList_Count(pipeline->submitted) > 0)
+	{
+		ISOCH_PENDING* pending;
+		const ISOCH_REQUEST* request;
+		ISOCH_TRANSFER* transfer = ArrayList_GetItem(pipeline->submitted, 0);
+
+		if (!transfer->done)
+			break;
+
+		if (transfer->stale)
+		{
+			ArrayList_RemoveAt(pipeline->submitted, 0);
+			isoch_transfer_recycle(pipeline, transfer);
+			continue;
+		}
+
+		if (ArrayList_Count(pipeline->requests) == 0)
+			break;
+
+		pending = ArrayList_GetItem(pipeline->requests, 0);
+		request = &pending->completion.request;
+
+		if ((request->NumberOfPackets != transfer->NumberOfPackets) ||
+		    (request->BufferSize != transfer->BufferSize))
+		{
+			/* A request older than the current geometry can not be served anymore */
+			if ((transfer->NumberOfPackets == pipeline->NumberOfPackets) &&
+			    (transfer->BufferSize == pipeline->BufferSize))
+			{
+				ArrayList_RemoveAt(pipeline->requests, 0);
+				isoch_pipeline_answer(pipeline, pending, NULL);
+			}
+			else
+			{
+				ArrayList_RemoveAt(pipeline->submitted, 0);
+				isoch_transfer_recycle(pipeline, transfer);
+			}
+
+			continue;
+		}
+
+		ArrayList_RemoveAt(pipeline->requests, 0);
+		ArrayList_RemoveAt(pipeline->submitted, 0);
+		isoch_pipeline_answer(pipeline, pending, transfer);
+		isoch_transfer_recycle(pipeline, transfer);
+	}
+}
+
+/* Keep depth transfers of the current geometry submitted or waiting for a request */
+static void isoch_pipeline_fill(ISOCH_PIPELINE* pipeline)
+{
+	while (!pipeline->closed && (pipeline->NumberOfPackets > 0) &&
+	       (ArrayList_Count(pipeline->submitted) < pipeline->depth))
+	{
+		ISOCH_TRANSFER* transfer = isoch_transfer_take(pipeline);
+
+		if (!transfer)
+			break;
+
+		if (!ArrayList_Append(pipeline->submitted, transfer))
+		{
+			isoch_transfer_recycle(pipeline, transfer);
+			break;
+		}
+
+		if (!pipeline->ops.submit(pipeline->context, transfer))
+		{
+			/* The device does not accept transfers, fail the waiting requests */
+			transfer->done = TRUE;
+			isoch_pipeline_stop_locked(pipeline, TRUE);
+			isoch_pipeline_dispatch(pipeline);
+			break;
+		}
+	}
+}
+
+ISOCH_PIPELINE* isoch_pipeline_new(UINT32 depth, const ISOCH_PIPELINE_OPS* ops, void* context)
+{
+	ISOCH_PIPELINE* pipeline;
+
+	if (!ops || !ops->submit || !ops->cancel || !ops->release || !ops->complete || (depth == 0))
+		return NULL;
+
+	pipeline = calloc(1, sizeof(ISOCH_PIPELINE));
+
+	if (!pipeline)
+		return NULL;
+
+	if (!InitializeCriticalSectionAndSpinCount(&pipeline->lock, 4000))
+	{
+		free(pipeline);
+		return NULL;
+	}
+
+	pipeline->ops = *ops;
+	pipeline->context = context;
+	pipeline->depth = depth;
+	pipeline->pool = StreamPool_New(TRUE, 0);
+	pipeline->submitted = ArrayList_New(FALSE);
+	pipeline->requests = ArrayList_New(FALSE);
+	pipeline->idle = ArrayList_New(FALSE);
+	pipeline->delivered = CreateEvent(NULL, TRUE, TRUE, NULL);
+
+	if (!pipeline->pool || !pipeline->submitted || !pipeline->requests || !pipeline->idle ||
+	    !pipeline->delivered)
+	{
+		isoch_pipeline_destroy(pipeline);
+		return NULL;
+	}
+
+	return pipeline;
+}
+
+/* Submitted transfers are cancelled, the pipeline is gone once the last one is reported. No
+ * completion is delivered once this returns. */
+void isoch_pipeline_free(ISOCH_PIPELINE* pipeline)
+{
+	BOOL destroy;
+
+	if (!pipeline)
+		return;
+
+	EnterCriticalSection(&pipeline->lock);
+	isoch_pipeline_stop_locked(pipeline, FALSE);
+	isoch_pipeline_discard_completed(pipeline);
+	pipeline->closed = TRUE;
+	pipeline->freeing = TRUE;
+	isoch_pipeline_dispatch(pipeline);
+	LeaveCriticalSection(&pipeline->lock);
+
+	/* Another thread might still be sending a completion, the context must outlive it */
+	WaitForSingleObject(pipeline->delivered, INFINITE);
+
+	EnterCriticalSection(&pipeline->lock);
+	pipeline->freeing = FALSE;
+	destroy = isoch_pipeline_unlock(pipeline);
+
+	if (destroy)
+		isoch_pipeline_destroy(pipeline);
+}
+
+BOOL isoch_pipeline_request(ISOCH_PIPELINE* pipeline, const ISOCH_REQUEST* request)
+{
+	ISOCH_PENDING* pending;
+
+	if (!pipeline || !request || (request->NumberOfPackets == 0))
+		return FALSE;
+
+	pending = calloc(1, sizeof(ISOCH_PENDING));
+
+	if (!pending)
+		return FALSE;
+
+	pending->completion.request = *request;
+	pending->completion.NumberOfPackets = request->NumberOfPackets;
+	EnterCriticalSection(&pipeline->lock);
+
+	if (pipeline->closed || !ArrayList_Append(pipeline->requests, pending))
+	{
+		LeaveCriticalSection(&pipeline->lock);
+		free(pending);
+		return FALSE;
+	}
+
+	pipeline->NumberOfPackets = request->NumberOfPackets;
+	pipeline->BufferSize = request->BufferSize;
+	isoch_pipeline_dispatch(pipeline);
+	isoch_pipeline_fill(pipeline);
+	isoch_pipeline_unlock(pipeline);
+	return TRUE;
+}
+
+/* A waiting request is completed as cancelled, returns FALSE if RequestId is not waiting */
+BOOL isoch_pipeline_cancel(ISOCH_PIPELINE* pipeline, UINT32 RequestId)
+{
+	size_t x;
+	BOOL found = FALSE;
+
+	if (!pipeline)
+		return FALSE;
+
+	EnterCriticalSection(&pipeline->lock);
+
+	for (x = 0; x < ArrayList_Count(pipeline->requests); x++)
+	{
+		ISOCH_PENDING* pending = ArrayList_GetItem(pipeline->requests, x);
+
+		if (pending->completion.request.RequestId == RequestId)
+		{
+			ArrayList_RemoveAt(pipeline->requests, x);
+			isoch_pipeline_answer(pipeline, pending, NULL);
+			found = TRUE;
+			break;
+		}
+	}
+
+	isoch_pipeline_unlock(pipeline);
+	return found;
+}
+
+/* Cancel the submitted transfers and waiting requests, the next request restarts streaming */
+void isoch_pipeline_stop(ISOCH_PIPELINE* pipeline)
+{
+	if (!pipeline)
+		return;
+
+	EnterCriticalSection(&pipeline->lock);
+	isoch_pipeline_stop_locked(pipeline, TRUE);
+	isoch_pipeline_dispatch(pipeline);
+	isoch_pipeline_unlock(pipeline);
+}
+
+/* Called by the backend once transfer is completed, failed or cancelled */
+void isoch_pipeline_transfer_done(ISOCH_TRANSFER* transfer)
+{
+	BOOL destroy;
+	ISOCH_PIPELINE* pipeline;
+
+	if (!transfer || !transfer->pipeline)
+		return;
+
+	pipeline = transfer->pipeline;
+	EnterCriticalSection(&pipeline->lock);
+	transfer->done = TRUE;
+	isoch_pipeline_dispatch(pipeline);
+	isoch_pipeline_fill(pipeline);
+	destroy = isoch_pipeline_unlock(pipeline);
+
+	if (destroy)
+		isoch_pipeline_destroy(pipeline);
+}
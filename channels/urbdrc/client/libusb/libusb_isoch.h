@@ -0,0 +1,96 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * RemoteFX USB Redirection
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FREERDP_CHANNEL_URBDRC_CLIENT_LIBUSB_ISOCH_H
+#define FREERDP_CHANNEL_URBDRC_CLIENT_LIBUSB_ISOCH_H
+
+#include <winpr/wtypes.h>
+#include <winpr/stream.h>
+
+/* Number of isochronous IN transfers kept in flight per endpoint */
+#define ISOCH_PIPELINE_DEPTH 4
+
+/* TS_URB_ISOCH_TRANSFER_RESULT layout of the outgoing URB completion */
+#define ISOCH_PACKET_OFFSET 40
+#define ISOCH_DATA_OFFSET(NumberOfPackets) (48 + (size_t)(NumberOfPackets)*12)
+
+typedef struct _ISOCH_PIPELINE ISOCH_PIPELINE;
+typedef struct _ISOCH_TRANSFER ISOCH_TRANSFER;
+typedef struct _ISOCH_REQUEST ISOCH_REQUEST;
+
+/* A transfer submitted before the server asked for it. The device writes to the
+ * outgoing URB completion in data, the backend fills the packet descriptors and
+ * compacts the data in place when the transfer is done. */
+struct _ISOCH_TRANSFER
+{
+	ISOCH_PIPELINE* pipeline;
+	wStream* data;
+	UINT32 NumberOfPackets;
+	UINT32 BufferSize;
+	UINT32 status;
+	UINT32 ErrorCount;
+	BOOL done;
+	BOOL stale;
+	void* transfer; /* backend transfer, kept for reuse */
+};
+
+/* A URB of the server waiting for a completed transfer */
+struct _ISOCH_REQUEST
+{
+	UINT32 MessageId;
+	UINT32 RequestId;
+	BOOL NoAck;
+	UINT32 StartFrame;
+	UINT32 ErrorCount;
+	UINT32 NumberOfPackets;
+	UINT32 BufferSize;
+	void* callback;
+};
+
+/* An answered request, the transfer data is handed over without the pipeline lock held */
+typedef struct
+{
+	ISOCH_REQUEST request;
+	wStream* data; /* the URB completion, NULL for a cancelled request */
+	UINT32 NumberOfPackets;
+	UINT32 status;
+	UINT32 ErrorCount;
+} ISOCH_COMPLETION;
+
+typedef struct
+{
+	/* Submit transfer->data to the device, isoch_pipeline_transfer_done is called on completion */
+	BOOL (*submit)(void* context, ISOCH_TRANSFER* transfer);
+	/* Cancel a submitted transfer, it is still reported with isoch_pipeline_transfer_done */
+	void (*cancel)(void* context, ISOCH_TRANSFER* transfer);
+	/* Free transfer->transfer, called without a context once the pipeline is gone */
+	void (*release)(ISOCH_TRANSFER* transfer);
+	/* Answer a request, the callee takes ownership of completion->data. Called without the
+	 * pipeline lock, completions are delivered one at a time in order */
+	void (*complete)(void* context, ISOCH_COMPLETION* completion);
+} ISOCH_PIPELINE_OPS;
+
+ISOCH_PIPELINE* isoch_pipeline_new(UINT32 depth, const ISOCH_PIPELINE_OPS* ops, void* context);
+void isoch_pipeline_free(ISOCH_PIPELINE* pipeline);
+
+BOOL isoch_pipeline_request(ISOCH_PIPELINE* pipeline, const ISOCH_REQUEST* request);
+BOOL isoch_pipeline_cancel(ISOCH_PIPELINE* pipeline, UINT32 RequestId);
+void isoch_pipeline_stop(ISOCH_PIPELINE* pipeline);
+
+void isoch_pipeline_transfer_done(ISOCH_TRANSFER* transfer);
+
+#endif /* FREERDP_CHANNEL_URBDRC_CLIENT_LIBUSB_ISOCH_H */
@@ -28,6 +28,7 @@
 #include <errno.h>
 
 #include "libusb_udevice.h"
+#include "libusb_isoch.h"
 #include "../common/urbdrc_types.h"
 
 #define BASIC_STATE_FUNC_DEFINED(_arg, _type)             \
@@ -82,6 +83,7 @@ struct _ASYNC_TRANSFER_USER_DATA
 };
 
 static void request_free(void* value);
+static int func_cancel_xact_request(URBDRC_PLUGIN* urbdrc, struct libusb_transfer* transfer);
 
 static struct libusb_transfer* list_contains(wArrayList* list, UINT32 streamID)
 {
@@ -248,6 +250,40 @@ static void async_transfer_user_data_free(ASYNC_TRANSFER_USER_DATA* user_data)
 	}
 }
 
+/* Write the packet descriptors of the TS_URB_ISOCH_TRANSFER_RESULT and move the packet data
+ * together in place, the data starts at the stream pointer. Returns the failed packets. */
+static UINT32 func_iso_write_packets(struct libusb_transfer* transfer, wStream* s)
+{
+	int i;
+	UINT32 index = 0;
+	UINT32 ErrorCount = 0;
+	BYTE* dataStart = Stream_Pointer(s);
+	Stream_SetPosition(s, ISOCH_PACKET_OFFSET);
+
+	for (i = 0; i < transfer->num_iso_packets; i++)
+	{
+		const UINT32 act_len = transfer->iso_packet_desc[i].actual_length;
+		Stream_Write_UINT32(s, index);
+		Stream_Write_UINT32(s, act_len);
+		Stream_Write_UINT32(s, transfer->iso_packet_desc[i].status);
+
+		if (transfer->iso_packet_desc[i].status != USBD_STATUS_SUCCESS)
+			ErrorCount++;
+		else
+		{
+			const unsigned char* packetBuffer = libusb_get_iso_packet_buffer_simple(transfer, i);
+			BYTE* data = dataStart + index;
+
+			if (data != packetBuffer)
+				memmove(data, packetBuffer, act_len);
+
+			index += act_len;
+		}
+	}
+
+	return ErrorCount;
+}
+
 static void func_iso_callback(struct libusb_transfer* transfer)
 {
 	ASYNC_TRANSFER_USER_DATA* user_data = (ASYNC_TRANSFER_USER_DATA*)transfer->user_data;
@@ -258,35 +294,7 @@ static void func_iso_callback(struct libusb_transfer* transfer)
 	switch (transfer->status)
 	{
 		case LIBUSB_TRANSFER_COMPLETED:
-		{
-			int i;
-			UINT32 index = 0;
-			BYTE* dataStart = Stream_Pointer(user_data->data);
-			Stream_SetPosition(user_data->data,
-			                   40); /* TS_URB_ISOCH_TRANSFER_RESULT IsoPacket offset */
-
-			for (i = 0; i < transfer->num_iso_packets; i++)
-			{
-				const UINT32 act_len = transfer->iso_packet_desc[i].actual_length;
-				Stream_Write_UINT32(user_data->data, index);
-				Stream_Write_UINT32(user_data->data, act_len);
-				Stream_Write_UINT32(user_data->data, transfer->iso_packet_desc[i].status);
-
-				if (transfer->iso_packet_desc[i].status != USBD_STATUS_SUCCESS)
-					user_data->ErrorCount++;
-				else
-				{
-					const unsigned char* packetBuffer =
-					    libusb_get_iso_packet_buffer_simple(transfer, i);
-					BYTE* data = dataStart + index;
-
-					if (data != packetBuffer)
-						memmove(data, packetBuffer, act_len);
-
-					index += act_len;
-				}
-			}
-		}
+			user_data->ErrorCount += func_iso_write_packets(transfer, user_data->data);
 			/* fallthrough */
 
 		case LIBUSB_TRANSFER_CANCELLED:
@@ -318,6 +326,175 @@ static void func_iso_callback(struct libusb_transfer* transfer)
 	ArrayList_Unlock(list);
 }
 
+static void func_iso_pipeline_callback(struct libusb_transfer* transfer)
+{
+	ISOCH_TRANSFER* isoch = (ISOCH_TRANSFER*)transfer->user_data;
+
+	isoch->status = transfer->status;
+
+	if (transfer->status == LIBUSB_TRANSFER_COMPLETED)
+		isoch->ErrorCount = func_iso_write_packets(transfer, isoch->data);
+
+	isoch_pipeline_transfer_done(isoch);
+}
+
+static BOOL isoch_endpoint_submit(void* context, ISOCH_TRANSFER* isoch)
+{
+	int rc;
+	ISOCH_ENDPOINT* endpoint = (ISOCH_ENDPOINT*)context;
+	UDEVICE* pdev = (UDEVICE*)endpoint->idev;
+	struct libusb_transfer* transfer = (struct libusb_transfer*)isoch->transfer;
+
+	/* The libusb transfer is reused as long as the number of packets does not change */
+	if (transfer && (transfer->num_iso_packets != (int)isoch->NumberOfPackets))
+	{
+		libusb_free_transfer(transfer);
+		transfer = NULL;
+	}
+
+	if (!transfer)
+	{
+		transfer = libusb_alloc_transfer((int)isoch->NumberOfPackets);
+
+		if (!transfer)
+		{
+			WLog_Print(pdev->urbdrc->log, WLOG_ERROR, "Error: libusb_alloc_transfer.");
+			isoch->transfer = NULL;
+			return FALSE;
+		}
+	}
+
+	isoch->transfer = transfer;
+	libusb_fill_iso_transfer(transfer, pdev->libusb_handle, endpoint->EndpointAddress,
+	                         Stream_Pointer(isoch->data), (int)isoch->BufferSize,
+	                         (int)isoch->NumberOfPackets, func_iso_pipeline_callback, isoch,
+	                         endpoint->Timeout);
+	libusb_set_iso_packet_lengths(transfer, isoch->BufferSize / isoch->NumberOfPackets);
+	rc = libusb_submit_transfer(transfer);
+	return !log_libusb_result(pdev->urbdrc->log, WLOG_WARN, "libusb_submit_transfer", rc);
+}
+
+static void isoch_endpoint_cancel(void* context, ISOCH_TRANSFER* isoch)
+{
+	ISOCH_ENDPOINT* endpoint = (ISOCH_ENDPOINT*)context;
+	UDEVICE* pdev = (UDEVICE*)endpoint->idev;
+
+	func_cancel_xact_request(pdev->urbdrc, (struct libusb_transfer*)isoch->transfer);
+}
+
+static void isoch_endpoint_release(ISOCH_TRANSFER* isoch)
+{
+	libusb_free_transfer((struct libusb_transfer*)isoch->transfer);
+	isoch->transfer = NULL;
+}
+
+/* The completed transfer already is the URB completion, the header is written in front of
+ * the packet descriptors and data and it is sent as is */
+static void isoch_endpoint_complete(void* context, ISOCH_COMPLETION* completion)
+{
+	wStream* out = completion->data;
+	const ISOCH_REQUEST* request = &completion->request;
+	ISOCH_ENDPOINT* endpoint = (ISOCH_ENDPOINT*)context;
+	IUDEVICE* idev = endpoint->idev;
+	const UINT32 InterfaceId = ((STREAM_ID_PROXY << 30) | idev->get_ReqCompletion(idev));
+	UINT32 status = LIBUSB_TRANSFER_CANCELLED;
+	UINT32 ErrorCount = request->ErrorCount;
+
+	if (request->NoAck)
+	{
+		if (out)
+			Stream_Release(out);
+
+		return;
+	}
+
+	if (out)
+	{
+		status = completion->status;
+		ErrorCount += completion->ErrorCount;
+	}
+	else
+	{
+		const size_t size = ISOCH_DATA_OFFSET(request->NumberOfPackets) + request->BufferSize;
+
+		out = Stream_New(NULL, size);
+
+		if (!out)
+			return;
+
+		ZeroMemory(Stream_Buffer(out), size);
+	}
+
+	endpoint->cb(idev, (URBDRC_CHANNEL_CALLBACK*)request->callback, out, InterfaceId,
+	             request->NoAck, request->MessageId, request->RequestId, request->NumberOfPackets,
+	             status, request->StartFrame, ErrorCount, request->BufferSize);
+}
+
+static const ISOCH_PIPELINE_OPS isoch_endpoint_ops = { isoch_endpoint_submit,
+	                                                   isoch_endpoint_cancel,
+	                                                   isoch_endpoint_release,
+	                                                   isoch_endpoint_complete };
+
+static ISOCH_ENDPOINT* udev_get_isoch_endpoint(UDEVICE* pdev, UINT32 EndpointAddress)
+{
+	ISOCH_ENDPOINT* endpoint;
+	const size_t index = EndpointAddress & 0x0F;
+
+	if (!(EndpointAddress & LIBUSB_ENDPOINT_IN))
+		return NULL;
+
+	endpoint = pdev->isoch_endpoints[index];
+
+	if (endpoint)
+		return endpoint;
+
+	endpoint = calloc(1, sizeof(ISOCH_ENDPOINT));
+
+	if (!endpoint)
+		return NULL;
+
+	endpoint->idev = &pdev->iface;
+	endpoint->EndpointAddress = (BYTE)EndpointAddress;
+	endpoint->pipeline = isoch_pipeline_new(ISOCH_PIPELINE_DEPTH, &isoch_endpoint_ops, endpoint);
+
+	if (!endpoint->pipeline)
+	{
+		free(endpoint);
+		return NULL;
+	}
+
+	pdev->isoch_endpoints[index] = endpoint;
+	return endpoint;
+}
+
+static void udev_stop_isoch_endpoints(UDEVICE* pdev)
+{
+	size_t x;
+
+	for (x = 0; x < ARRAYSIZE(pdev->isoch_endpoints); x++)
+	{
+		if (pdev->isoch_endpoints[x])
+			isoch_pipeline_stop(pdev->isoch_endpoints[x]->pipeline);
+	}
+}
+
+static void udev_free_isoch_endpoints(UDEVICE* pdev)
+{
+	size_t x;
+
+	for (x = 0; x < ARRAYSIZE(pdev->isoch_endpoints); x++)
+	{
+		ISOCH_ENDPOINT* endpoint = pdev->isoch_endpoints[x];
+
+		if (!endpoint)
+			continue;
+
+		isoch_pipeline_free(endpoint->pipeline);
+		free(endpoint);
+		pdev->isoch_endpoints[x] = NULL;
+	}
+}
+
 static const LIBUSB_ENDPOINT_DESCEIPTOR* func_get_ep_desc(LIBUSB_CONFIG_DESCRIPTOR* LibusbConfig,
                                                           MSUSB_CONFIG_DESCRIPTOR* MsConfig,
                                                           UINT32 EndpointAddress)
@@ -567,6 +744,7 @@ static int libusb_udev_select_interface(IUDEVICE* idev, BYTE InterfaceNumber, BY
 
 		if (diff)
 		{
+			udev_stop_isoch_endpoints(pdev);
 			error = libusb_set_interface_alt_setting(pdev->libusb_handle, InterfaceNumber,
 			                                         AlternateSetting);
 
@@ -749,6 +927,7 @@ static int libusb_udev_select_configuration(IUDEVICE* idev, UINT32 bConfiguratio
 	libusb_handle = pdev->libusb_handle;
 	libusb_dev = pdev->libusb_dev;
 	LibusbConfig = &pdev->LibusbConfig;
+	udev_stop_isoch_endpoints(pdev);
 
 	if (MsConfig->InitCompleted)
 	{
@@ -1213,6 +1392,32 @@ static int libusb_udev_isoch_transfer(IUDEVICE* idev, URBDRC_CHANNEL_CALLBACK* c
 		return -1;
 
 	urbdrc = pdev->urbdrc;
+
+	/* Data of IN endpoints is streamed from transfers submitted ahead of the request */
+	if (!Buffer && (NumberOfPackets > 0))
+	{
+		ISOCH_ENDPOINT* endpoint = udev_get_isoch_endpoint(pdev, EndpointAddress);
+
+		if (endpoint)
+		{
+			ISOCH_REQUEST request = { 0 };
+
+			request.MessageId = MessageId;
+			request.RequestId = RequestId;
+			request.NoAck = NoAck;
+			request.StartFrame = StartFrame;
+			request.ErrorCount = ErrorCount;
+			request.NumberOfPackets = NumberOfPackets;
+			request.BufferSize = BufferSize;
+			request.callback = callback;
+			endpoint->cb = cb;
+			endpoint->Timeout = Timeout;
+
+			if (isoch_pipeline_request(endpoint->pipeline, &request))
+				return 0;
+		}
+	}
+
 	user_data = async_transfer_user_data_new(idev, MessageId, 48, BufferSize, Buffer,
 	                                         outSize + 1024, NoAck, cb, callback);
 
@@ -1391,6 +1596,7 @@ static void libusb_udev_cancel_all_transfer_request(IUDEVICE* idev)
 	if (!pdev || !pdev->request_queue || !pdev->urbdrc)
 		return;
 
+	udev_stop_isoch_endpoints(pdev);
 	ArrayList_Lock(pdev->request_queue);
 	count = ArrayList_Count(pdev->request_queue);
 
@@ -1405,6 +1611,7 @@ static void libusb_udev_cancel_all_transfer_request(IUDEVICE* idev)
 
 static int libusb_udev_cancel_transfer_request(IUDEVICE* idev, UINT32 RequestId)
 {
+	size_t x;
 	int rc = -1;
 	UDEVICE* pdev = (UDEVICE*)idev;
 	struct libusb_transfer* transfer;
@@ -1414,6 +1621,13 @@ static int libusb_udev_cancel_transfer_request(IUDEVICE* idev, UINT32 RequestId)
 	if (!idev || !pdev->urbdrc || !pdev->request_queue)
 		return -1;
 
+	for (x = 0; x < ARRAYSIZE(pdev->isoch_endpoints); x++)
+	{
+		if (pdev->isoch_endpoints[x] &&
+		    isoch_pipeline_cancel(pdev->isoch_endpoints[x]->pipeline, RequestId))
+			return 1;
+	}
+
 	ArrayList_Lock(pdev->request_queue);
 	transfer = list_contains(pdev->request_queue, cancelID1);
 	if (!transfer)
@@ -1472,6 +1686,7 @@ static void udev_free(IUDEVICE* idev)
 
 	urbdrc = udev->urbdrc;
 
+	udev_free_isoch_endpoints(udev);
 	libusb_udev_cancel_all_transfer_request(&udev->iface);
 	if (udev->libusb_handle)
 	{
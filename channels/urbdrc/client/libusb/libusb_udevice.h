@@ -26,6 +26,7 @@
 
 #include "urbdrc_types.h"
 #include "urbdrc_main.h"
+#include "libusb_isoch.h"
 
 typedef struct libusb_device LIBUSB_DEVICE;
 typedef struct libusb_device_handle LIBUSB_DEVICE_HANDLE;
@@ -35,6 +36,17 @@ typedef struct libusb_interface LIBUSB_INTERFACE;
 typedef struct libusb_interface_descriptor LIBUSB_INTERFACE_DESCRIPTOR;
 typedef struct libusb_endpoint_descriptor LIBUSB_ENDPOINT_DESCEIPTOR;
 
+typedef struct _ISOCH_ENDPOINT ISOCH_ENDPOINT;
+
+struct _ISOCH_ENDPOINT
+{
+	IUDEVICE* idev;
+	BYTE EndpointAddress;
+	UINT32 Timeout;
+	t_isoch_transfer_cb cb;
+	ISOCH_PIPELINE* pipeline;
+};
+
 typedef struct _UDEVICE UDEVICE;
 
 struct _UDEVICE
@@ -64,6 +76,7 @@ struct _UDEVICE
 	LIBUSB_CONFIG_DESCRIPTOR* LibusbConfig;
 
 	wArrayList* request_queue;
+	ISOCH_ENDPOINT* isoch_endpoints[16]; /* pipelined IN endpoints by endpoint number */
 
 	URBDRC_PLUGIN* urbdrc;
 };
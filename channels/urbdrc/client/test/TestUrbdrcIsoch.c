@@ -0,0 +1,428 @@
+#include <stdio.h>
+
+#include <winpr/crt.h>
+#include <winpr/synch.h>
+#include <winpr/thread.h>
+#include <winpr/stream.h>
+#include <winpr/collections.h>
+
+#include "../libusb/libusb_isoch.h"
+
+#define TEST_PACKETS 8
+#define TEST_PACKET_SIZE 32
+#define TEST_ROUNDS 1000
+
+/* A mock of the libusb backend, transfers are completed by the test in any order */
+typedef struct
+{
+	wArrayList* submitted;
+	ISOCH_PIPELINE* pipeline;
+	BOOL lockHeld;
+	UINT32 sequence;
+	size_t live;
+	size_t cancels;
+	BOOL failSubmit;
+
+	/* answered requests */
+	UINT32 messageIds[TEST_ROUNDS + 64];
+	INT64 sequences[TEST_ROUNDS + 64];
+	size_t answered;
+} TestDevice;
+
+typedef struct
+{
+	UINT32 sequence;
+} TestTransfer;
+
+static BOOL test_submit(void* context, ISOCH_TRANSFER* transfer)
+{
+	TestDevice* dev = (TestDevice*)context;
+	TestTransfer* t = (TestTransfer*)transfer->transfer;
+
+	if (dev->failSubmit)
+		return FALSE;
+
+	if (!t)
+	{
+		t = calloc(1, sizeof(TestTransfer));
+
+		if (!t)
+			return FALSE;
+
+		transfer->transfer = t;
+		dev->live++;
+	}
+
+	if (Stream_GetRemainingCapacity(transfer->data) < transfer->BufferSize)
+		return FALSE;
+
+	t->sequence = dev->sequence++;
+	return ArrayList_Append(dev->submitted, transfer);
+}
+
+static void test_cancel(void* context, ISOCH_TRANSFER* transfer)
+{
+	TestDevice* dev = (TestDevice*)context;
+	WINPR_UNUSED(transfer);
+	dev->cancels++;
+}
+
+static TestDevice* test_release_device = NULL;
+
+static void test_release(ISOCH_TRANSFER* transfer)
+{
+	if (transfer->transfer)
+		test_release_device->live--;
+
+	free(transfer->transfer);
+	transfer->transfer = NULL;
+}
+
+static DWORD WINAPI test_lock_thread(LPVOID arg)
+{
+	TestDevice* dev = (TestDevice*)arg;
+	isoch_pipeline_cancel(dev->pipeline, UINT32_MAX);
+	return 0;
+}
+
+/* Another thread must be able to use the pipeline while a completion is sent */
+static BOOL test_lock_released(TestDevice* dev)
+{
+	DWORD status;
+	HANDLE thread = CreateThread(NULL, 0, test_lock_thread, dev, 0, NULL);
+
+	if (!thread)
+		return FALSE;
+
+	status = WaitForSingleObject(thread, 5000);
+
+	if (status != WAIT_OBJECT_0)
+		return FALSE;
+
+	CloseHandle(thread);
+	return TRUE;
+}
+
+static void test_complete(void* context, ISOCH_COMPLETION* completion)
+{
+	TestDevice* dev = (TestDevice*)context;
+	const ISOCH_REQUEST* request = &completion->request;
+	INT64 sequence = -1;
+
+	if ((dev->answered == 0) && !test_lock_released(dev))
+		dev->lockHeld = TRUE;
+
+	if (completion->data)
+	{
+		UINT32 offset, length, status;
+		wStream* s = completion->data;
+
+		/* The first packet descriptor and the data are where the URB completion expects them */
+		Stream_SetPosition(s, ISOCH_PACKET_OFFSET);
+		Stream_Read_UINT32(s, offset);
+		Stream_Read_UINT32(s, length);
+		Stream_Read_UINT32(s, status);
+		Stream_SetPosition(s, ISOCH_DATA_OFFSET(completion->NumberOfPackets) + offset);
+
+		if ((length >= 4) && (status == 0))
+			Stream_Read_UINT32(s, sequence);
+
+		if (request->NumberOfPackets != completion->NumberOfPackets)
+			sequence = -2;
+
+		Stream_Release(s);
+	}
+
+	if (dev->answered < ARRAYSIZE(dev->messageIds))
+	{
+		dev->messageIds[dev->answered] = request->MessageId;
+		dev->sequences[dev->answered] = sequence;
+	}
+
+	dev->answered++;
+}
+
+static const ISOCH_PIPELINE_OPS test_ops = { test_submit, test_cancel, test_release,
+	                                         test_complete };
+
+/* Complete the index'th submitted transfer like func_iso_callback does */
+static BOOL test_device_complete(TestDevice* dev, size_t index, BOOL cancelled)
+{
+	UINT32 x;
+	ISOCH_TRANSFER* transfer;
+	TestTransfer* t;
+	wStream* s;
+
+	if (index >= ArrayList_Count(dev->submitted))
+		return FALSE;
+
+	transfer = ArrayList_GetItem(dev->submitted, index);
+	ArrayList_RemoveAt(dev->submitted, index);
+	t = (TestTransfer*)transfer->transfer;
+	s = transfer->data;
+
+	if (cancelled)
+		transfer->status = 3;
+	else
+	{
+		Stream_SetPosition(s, ISOCH_PACKET_OFFSET);
+
+		for (x = 0; x < transfer->NumberOfPackets; x++)
+		{
+			Stream_Write_UINT32(s, x * TEST_PACKET_SIZE);
+			Stream_Write_UINT32(s, TEST_PACKET_SIZE);
+			Stream_Write_UINT32(s, 0);
+		}
+
+		Stream_SetPosition(s, ISOCH_DATA_OFFSET(transfer->NumberOfPackets));
+		Stream_Write_UINT32(s, t->sequence);
+	}
+
+	isoch_pipeline_transfer_done(transfer);
+	return TRUE;
+}
+
+static BOOL test_request(ISOCH_PIPELINE* pipeline, UINT32 MessageId, UINT32 NumberOfPackets)
+{
+	ISOCH_REQUEST request = { 0 };
+
+	request.MessageId = MessageId;
+	request.RequestId = MessageId;
+	request.NumberOfPackets = NumberOfPackets;
+	request.BufferSize = NumberOfPackets * TEST_PACKET_SIZE;
+	return isoch_pipeline_request(pipeline, &request);
+}
+
+static BOOL test_answered(const TestDevice* dev, size_t index, UINT32 MessageId, INT64 sequence)
+{
+	if ((dev->answered <= index) || (dev->messageIds[index] != MessageId) ||
+	    (dev->sequences[index] != sequence))
+	{
+		printf("request %" PRIuz " not answered with message %" PRIu32 " sequence %" PRId64 "\n",
+		       index, MessageId, sequence);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+static BOOL test_counts(const TestDevice* dev, size_t submitted, size_t answered)
+{
+	if ((ArrayList_Count(dev->submitted) != submitted) || (dev->answered != answered))
+	{
+		printf("%" PRIuz " transfers submitted and %" PRIuz " requests answered, expected %" PRIuz
+		       " and %" PRIuz "\n",
+		       ArrayList_Count(dev->submitted), dev->answered, submitted, answered);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+/* Out of order completions are delivered in submission order, later requests do not wait */
+static BOOL test_ordering(ISOCH_PIPELINE* pipeline, TestDevice* dev)
+{
+	if (!test_request(pipeline, 1, TEST_PACKETS) || !test_counts(dev, ISOCH_PIPELINE_DEPTH, 0))
+		return FALSE;
+
+	if (!test_device_complete(dev, 2, FALSE) || !test_device_complete(dev, 1, FALSE) ||
+	    !test_counts(dev, ISOCH_PIPELINE_DEPTH - 2, 0))
+		return FALSE;
+
+	/* Two completed transfers wait for requests, one is submitted in place of the answered one */
+	if (!test_device_complete(dev, 0, FALSE) || !test_answered(dev, 0, 1, 0) ||
+	    !test_counts(dev, ISOCH_PIPELINE_DEPTH - 2, 1))
+		return FALSE;
+
+	if (!test_request(pipeline, 2, TEST_PACKETS) || !test_request(pipeline, 3, TEST_PACKETS) ||
+	    !test_answered(dev, 1, 2, 1) || !test_answered(dev, 2, 3, 2) ||
+	    !test_counts(dev, ISOCH_PIPELINE_DEPTH, 3))
+		return FALSE;
+
+	return TRUE;
+}
+
+/* In a steady stream every request is answered on arrival from a completed transfer */
+static BOOL test_throughput(ISOCH_PIPELINE* pipeline, TestDevice* dev)
+{
+	size_t x;
+	size_t immediate = 0;
+	const size_t start = dev->answered;
+	const INT64 first = dev->sequences[start - 1] + 1;
+
+	for (x = 0; x < TEST_ROUNDS; x++)
+	{
+		const size_t answered = dev->answered;
+
+		if (!test_device_complete(dev, 0, FALSE) ||
+		    !test_request(pipeline, 100 + (UINT32)x, TEST_PACKETS))
+			return FALSE;
+
+		if (dev->answered == answered + 1)
+			immediate++;
+
+		if (ArrayList_Count(dev->submitted) > ISOCH_PIPELINE_DEPTH)
+		{
+			printf("more than %d transfers submitted\n", ISOCH_PIPELINE_DEPTH);
+			return FALSE;
+		}
+	}
+
+	for (x = 0; x < TEST_ROUNDS; x++)
+	{
+		if (!test_answered(dev, start + x, 100 + (UINT32)x, first + (INT64)x))
+			return FALSE;
+	}
+
+	printf("%" PRIuz " of %d requests answered without waiting for the device\n", immediate,
+	       TEST_ROUNDS);
+	return immediate == TEST_ROUNDS;
+}
+
+/* Without requests the pipeline holds depth completed transfers and submits no more */
+static BOOL test_backpressure(ISOCH_PIPELINE* pipeline, TestDevice* dev)
+{
+	const size_t answered = dev->answered;
+
+	while (ArrayList_Count(dev->submitted) > 0)
+	{
+		if (!test_device_complete(dev, 0, FALSE))
+			return FALSE;
+	}
+
+	if (!test_counts(dev, 0, answered))
+		return FALSE;
+
+	/* Each request frees a slot for a new transfer */
+	if (!test_request(pipeline, 5000, TEST_PACKETS) || !test_counts(dev, 1, answered + 1))
+		return FALSE;
+
+	return TRUE;
+}
+
+/* Transfers of the previous geometry are dropped, not sent to a request of the new one */
+static BOOL test_geometry(ISOCH_PIPELINE* pipeline, TestDevice* dev)
+{
+	const size_t answered = dev->answered;
+
+	/* The completed transfers are dropped and replaced */
+	if (!test_request(pipeline, 6000, TEST_PACKETS / 2) ||
+	    !test_counts(dev, ISOCH_PIPELINE_DEPTH, answered))
+		return FALSE;
+
+	/* The submitted transfer of the old geometry completes, the slot goes to the new one */
+	if (!test_device_complete(dev, 0, FALSE) || !test_counts(dev, ISOCH_PIPELINE_DEPTH, answered))
+		return FALSE;
+
+	if (!test_device_complete(dev, 0, FALSE) ||
+	    !test_counts(dev, ISOCH_PIPELINE_DEPTH, answered + 1))
+		return FALSE;
+
+	return dev->sequences[answered] >= 0;
+}
+
+static BOOL test_cancel_stop(ISOCH_PIPELINE* pipeline, TestDevice* dev)
+{
+	size_t answered;
+	UINT32 id = 7000;
+
+	/* Claim the completed transfers until a request has to wait */
+	do
+	{
+		answered = dev->answered;
+
+		if (!test_request(pipeline, ++id, TEST_PACKETS / 2))
+			return FALSE;
+	} while (dev->answered != answered);
+
+	if (isoch_pipeline_cancel(pipeline, id + 1) || !isoch_pipeline_cancel(pipeline, id) ||
+	    !test_answered(dev, answered, id, -1))
+		return FALSE;
+
+	/* Stopping cancels the submitted transfers and fails waiting requests */
+	if (!test_request(pipeline, ++id, TEST_PACKETS / 2))
+		return FALSE;
+
+	dev->cancels = 0;
+	isoch_pipeline_stop(pipeline);
+
+	if ((dev->cancels != ArrayList_Count(dev->submitted)) ||
+	    !test_answered(dev, answered + 1, id, -1))
+		return FALSE;
+
+	while (ArrayList_Count(dev->submitted) > 0)
+	{
+		if (!test_device_complete(dev, 0, TRUE))
+			return FALSE;
+	}
+
+	if (!test_counts(dev, 0, answered + 2))
+		return FALSE;
+
+	/* A request restarts streaming, a failing submission answers it */
+	dev->failSubmit = TRUE;
+
+	if (!test_request(pipeline, ++id, TEST_PACKETS) || !test_answered(dev, answered + 2, id, -1))
+		return FALSE;
+
+	dev->failSubmit = FALSE;
+
+	if (!test_request(pipeline, ++id, TEST_PACKETS) ||
+	    !test_counts(dev, ISOCH_PIPELINE_DEPTH, answered + 3) ||
+	    !test_device_complete(dev, 0, FALSE) ||
+	    !test_answered(dev, answered + 3, id, dev->sequence - ISOCH_PIPELINE_DEPTH - 1))
+		return FALSE;
+
+	return TRUE;
+}
+
+int TestUrbdrcIsoch(int argc, char* argv[])
+{
+	int rc = -1;
+	TestDevice dev = { 0 };
+	ISOCH_PIPELINE* pipeline = NULL;
+
+	WINPR_UNUSED(argc);
+	WINPR_UNUSED(argv);
+
+	test_release_device = &dev;
+	dev.submitted = ArrayList_New(FALSE);
+	pipeline = isoch_pipeline_new(ISOCH_PIPELINE_DEPTH, &test_ops, &dev);
+	dev.pipeline = pipeline;
+
+	if (!dev.submitted || !pipeline)
+		goto fail;
+
+	if (!test_ordering(pipeline, &dev) || !test_throughput(pipeline, &dev) ||
+	    !test_backpressure(pipeline, &dev) || !test_geometry(pipeline, &dev) ||
+	    !test_cancel_stop(pipeline, &dev))
+		goto fail;
+
+	if (dev.lockHeld)
+	{
+		printf("completion sent with the pipeline lock held\n");
+		goto fail;
+	}
+
+	/* The pipeline is gone once the backend reported the cancelled transfers */
+	isoch_pipeline_free(pipeline);
+	pipeline = NULL;
+
+	while (ArrayList_Count(dev.submitted) > 0)
+	{
+		if (!test_device_complete(&dev, 0, TRUE))
+			goto fail;
+	}
+
+	if (dev.live != 0)
+	{
+		printf("%" PRIuz " backend transfers not released\n", dev.live);
+		goto fail;
+	}
+
+	rc = 0;
+fail:
+	isoch_pipeline_free(pipeline);
+	ArrayList_Free(dev.submitted);
+	return rc;
+}
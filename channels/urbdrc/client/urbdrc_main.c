@@ -994,6 +994,15 @@ fail:
 	return status;
 }
 
+/* Streams of the isochronous pipeline belong to a pool */
+static void stream_free(wStream* out)
+{
+	if (out->pool)
+		Stream_Release(out);
+	else
+		Stream_Free(out, TRUE);
+}
+
 UINT stream_write_and_free(IWTSPlugin* plugin, IWTSVirtualChannel* channel, wStream* out)
 {
 	UINT rc;
@@ -1004,18 +1013,18 @@ UINT stream_write_and_free(IWTSPlugin* plugin, IWTSVirtualChannel* channel, wStr
 
 	if (!channel || !out || !urbdrc)
 	{
-		Stream_Free(out, TRUE);
+		stream_free(out);
 		return ERROR_INVALID_PARAMETER;
 	}
 
 	if (!channel->Write)
 	{
-		Stream_Free(out, TRUE);
+		stream_free(out);
 		return ERROR_INTERNAL_ERROR;
 	}
 
 	urbdrc_dump_message(urbdrc->log, TRUE, TRUE, out);
 	rc = channel->Write(channel, Stream_GetPosition(out), Stream_Buffer(out), NULL);
-	Stream_Free(out, TRUE);
+	stream_free(out);
 	return rc;
 }
@@ -0,0 +1,771 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * Headless Session Replay Load Generator
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include <winpr/crt.h>
+#include <winpr/assert.h>
+#include <winpr/synch.h>
+#include <winpr/thread.h>
+#include <winpr/sysinfo.h>
+
+#include <freerdp/freerdp.h>
+#include <freerdp/gdi/gdi.h>
+#include <freerdp/gdi/gfx.h>
+#include <freerdp/utils/pcap.h>
+#include <freerdp/client/cmdline.h>
+#include <freerdp/client/rdpgfx.h>
+#include <freerdp/client/channels.h>
+#include <freerdp/log.h>
+
+#if defined(__linux__)
+#include <unistd.h>
+#include <sys/resource.h>
+#endif
+
+#define TAG CLIENT_TAG("loadgen")
+
+/* Latency bucket i counts responses within [2^i, 2^(i+1)) microseconds */
+#define LG_BUCKETS 25
+
+typedef struct
+{
+	UINT64 offset; /* microseconds since the first recorded PDU */
+	BYTE* data;
+	size_t length;
+} LG_PDU;
+
+typedef struct
+{
+	UINT64 count;
+	UINT64 sum;
+	UINT64 min;
+	UINT64 max;
+	UINT64 buckets[LG_BUCKETS];
+} LG_HISTOGRAM;
+
+typedef struct
+{
+	LG_PDU* pdus;
+	size_t count;
+	double timeScale;
+	UINT32 loops;
+	UINT32 lingerMs;
+	int argc;
+	char** argv;
+} LG_CONFIG;
+
+typedef struct
+{
+	const LG_CONFIG* config;
+	UINT32 index;
+	HANDLE thread;
+	BOOL connected;
+	UINT64 connectUs;
+	UINT64 sent;
+	UINT64 failed;
+	LG_HISTOGRAM latency;
+} LG_SESSION;
+
+typedef struct
+{
+	rdpContext context;
+	LG_SESSION* session;
+} lgContext;
+
+static UINT64 lg_now_us(void)
+{
+#ifdef _WIN32
+	LARGE_INTEGER count, freq;
+	QueryPerformanceFrequency(&freq);
+	QueryPerformanceCounter(&count);
+	return (UINT64)count.QuadPart * 1000000ull / (UINT64)freq.QuadPart;
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (UINT64)ts.tv_sec * 1000000ull + (UINT64)ts.tv_nsec / 1000ull;
+#endif
+}
+
+static void lg_histogram_add(LG_HISTOGRAM* h, UINT64 value)
+{
+	size_t bucket = 0;
+
+	while ((bucket + 1 < LG_BUCKETS) && ((value >> (bucket + 1)) != 0))
+		bucket++;
+
+	if ((h->count == 0) || (value < h->min))
+		h->min = value;
+
+	if (value > h->max)
+		h->max = value;
+
+	h->count++;
+	h->sum += value;
+	h->buckets[bucket]++;
+}
+
+static void lg_histogram_merge(LG_HISTOGRAM* h, const LG_HISTOGRAM* other)
+{
+	size_t x;
+
+	if (other->count == 0)
+		return;
+
+	if ((h->count == 0) || (other->min < h->min))
+		h->min = other->min;
+
+	if (other->max > h->max)
+		h->max = other->max;
+
+	h->count += other->count;
+	h->sum += other->sum;
+
+	for (x = 0; x < LG_BUCKETS; x++)
+		h->buckets[x] += other->buckets[x];
+}
+
+/* Estimates a percentile with the upper bound of the bucket it falls into */
+static UINT64 lg_histogram_percentile(const LG_HISTOGRAM* h, UINT32 percent)
+{
+	size_t x;
+	UINT64 seen = 0;
+	const UINT64 rank = (h->count * percent + 99) / 100;
+
+	if (h->count == 0)
+		return 0;
+
+	for (x = 0; x < LG_BUCKETS; x++)
+	{
+		seen += h->buckets[x];
+
+		if (seen >= rank)
+			return MIN(h->max, (2ull << x) - 1);
+	}
+
+	return h->max;
+}
+
+static void lg_histogram_print(FILE* fp, const LG_HISTOGRAM* h, const char* indent)
+{
+	size_t x, last = 0;
+
+	fprintf(fp, "{\n");
+	fprintf(fp, "%s  \"count\": %" PRIu64 ",\n", indent, h->count);
+	fprintf(fp, "%s  \"min\": %" PRIu64 ",\n", indent, h->min);
+	fprintf(fp, "%s  \"mean\": %" PRIu64 ",\n", indent, h->count ? h->sum / h->count : 0);
+	fprintf(fp, "%s  \"p50\": %" PRIu64 ",\n", indent, lg_histogram_percentile(h, 50));
+	fprintf(fp, "%s  \"p90\": %" PRIu64 ",\n", indent, lg_histogram_percentile(h, 90));
+	fprintf(fp, "%s  \"p99\": %" PRIu64 ",\n", indent, lg_histogram_percentile(h, 99));
+	fprintf(fp, "%s  \"max\": %" PRIu64 ",\n", indent, h->max);
+
+	for (x = 0; x < LG_BUCKETS; x++)
+	{
+		if (h->buckets[x] != 0)
+			last = x + 1;
+	}
+
+	fprintf(fp, "%s  \"buckets\": [", indent);
+
+	for (x = 0; x < last; x++)
+		fprintf(fp, "%s%" PRIu64, (x > 0) ? ", " : "", h->buckets[x]);
+
+	fprintf(fp, "]\n%s}", indent);
+}
+
+static void lg_free_pdus(LG_CONFIG* config)
+{
+	size_t x;
+
+	for (x = 0; x < config->count; x++)
+		free(config->pdus[x].data);
+
+	free(config->pdus);
+	config->pdus = NULL;
+	config->count = 0;
+}
+
+/* Fast path input PDUs start with action 0, slow path PDUs with a TPKT header */
+static BOOL lg_is_input_pdu(const BYTE* data, size_t length)
+{
+	return (length > 0) && ((data[0] & 0x03) == 0);
+}
+
+static BOOL lg_load_pdus(LG_CONFIG* config, const char* file, BOOL inputOnly)
+{
+	BOOL rc = FALSE;
+	size_t capacity = 0;
+	UINT64 first = 0;
+	pcap_record record = { 0 };
+	rdpPcap* pcap = pcap_open(file, FALSE);
+
+	if (!pcap)
+	{
+		WLog_ERR(TAG, "failed to open %s", file);
+		return FALSE;
+	}
+
+	while (pcap_get_next_record_header(pcap, &record))
+	{
+		LG_PDU* pdu;
+		const UINT64 ts = record.header.ts_sec * 1000000ull + record.header.ts_usec;
+
+		if (record.length == 0)
+			continue;
+
+		record.data = malloc(record.length);
+
+		if (!record.data || !pcap_get_next_record_content(pcap, &record))
+			goto fail;
+
+		if (inputOnly && !lg_is_input_pdu(record.data, record.length))
+		{
+			free(record.data);
+			record.data = NULL;
+			continue;
+		}
+
+		if (config->count == capacity)
+		{
+			const size_t size = (capacity > 0) ? capacity * 2 : 256;
+			LG_PDU* pdus = realloc(config->pdus, size * sizeof(LG_PDU));
+
+			if (!pdus)
+				goto fail;
+
+			config->pdus = pdus;
+			capacity = size;
+		}
+
+		if (config->count == 0)
+			first = ts;
+
+		pdu = &config->pdus[config->count++];
+		pdu->offset = (ts > first) ? ts - first : 0;
+		pdu->data = record.data;
+		pdu->length = record.length;
+		record.data = NULL;
+	}
+
+	rc = config->count > 0;
+
+	if (!rc)
+		WLog_ERR(TAG, "%s does not contain PDUs to replay", file);
+
+fail:
+	free(record.data);
+	pcap_close(pcap);
+	return rc;
+}
+
+static void lg_on_channel_connected(void* ctx, ChannelConnectedEventArgs* e)
+{
+	rdpContext* context = (rdpContext*)ctx;
+
+	if (strcmp(e->name, RDPGFX_DVC_CHANNEL_NAME) == 0)
+		gdi_graphics_pipeline_init(context->gdi, (RdpgfxClientContext*)e->pInterface);
+}
+
+static void lg_on_channel_disconnected(void* ctx, ChannelDisconnectedEventArgs* e)
+{
+	rdpContext* context = (rdpContext*)ctx;
+
+	if (strcmp(e->name, RDPGFX_DVC_CHANNEL_NAME) == 0)
+		gdi_graphics_pipeline_uninit(context->gdi, (RdpgfxClientContext*)e->pInterface);
+}
+
+static BOOL lg_pre_connect(freerdp* instance)
+{
+	WINPR_ASSERT(instance);
+
+	PubSub_SubscribeChannelConnected(instance->context->pubSub, lg_on_channel_connected);
+	PubSub_SubscribeChannelDisconnected(instance->context->pubSub, lg_on_channel_disconnected);
+
+	/* Replayed channel PDUs need the channels of the recorded session */
+	return freerdp_client_load_addins(instance->context->channels, instance->settings);
+}
+
+static BOOL lg_post_connect(freerdp* instance)
+{
+	if (!gdi_init(instance, PIXEL_FORMAT_BGRX32))
+		return FALSE;
+
+	/* The server does the work that is measured, updates are only parsed here */
+	return freerdp_settings_set_bool(instance->settings, FreeRDP_DeactivateClientDecoding, TRUE);
+}
+
+static void lg_post_disconnect(freerdp* instance)
+{
+	if (!instance || !instance->context)
+		return;
+
+	PubSub_UnsubscribeChannelConnected(instance->context->pubSub, lg_on_channel_connected);
+	PubSub_UnsubscribeChannelDisconnected(instance->context->pubSub, lg_on_channel_disconnected);
+	gdi_free(instance);
+}
+
+static BOOL lg_client_new(freerdp* instance, rdpContext* context)
+{
+	if (!instance || !context)
+		return FALSE;
+
+	instance->PreConnect = lg_pre_connect;
+	instance->PostConnect = lg_post_connect;
+	instance->PostDisconnect = lg_post_disconnect;
+	return TRUE;
+}
+
+static int lg_client_entry(RDP_CLIENT_ENTRY_POINTS* pEntryPoints)
+{
+	ZeroMemory(pEntryPoints, sizeof(RDP_CLIENT_ENTRY_POINTS));
+	pEntryPoints->Version = RDP_CLIENT_INTERFACE_VERSION;
+	pEntryPoints->Size = sizeof(RDP_CLIENT_ENTRY_POINTS_V1);
+	pEntryPoints->ContextSize = sizeof(lgContext);
+	pEntryPoints->ClientNew = lg_client_new;
+	return 0;
+}
+
+/* Dispatches incoming data until the deadline. Latency is the time from the oldest unanswered
+ * replayed PDU to the next PDU received from the server. */
+static BOOL lg_pump(LG_SESSION* session, rdpContext* context, UINT64 deadline, UINT64* pending,
+                    UINT64* inPackets)
+{
+	for (;;)
+	{
+		DWORD nCount, status;
+		UINT64 packets, now;
+		HANDLE handles[MAXIMUM_WAIT_OBJECTS] = { 0 };
+
+		if (freerdp_shall_disconnect(context->instance))
+			return FALSE;
+
+		now = lg_now_us();
+
+		if (now >= deadline)
+			return TRUE;
+
+		nCount = freerdp_get_event_handles(context, handles, ARRAYSIZE(handles));
+
+		if (nCount == 0)
+			return FALSE;
+
+		status = WaitForMultipleObjects(nCount, handles, FALSE,
+		                                (DWORD)MIN(100, (deadline - now + 999) / 1000));
+
+		if (status == WAIT_FAILED)
+			return FALSE;
+
+		if (!freerdp_check_event_handles(context))
+			return FALSE;
+
+		if (!freerdp_get_stats(context->rdp, NULL, NULL, &packets, NULL))
+			return FALSE;
+
+		if (packets != *inPackets)
+		{
+			*inPackets = packets;
+
+			if (*pending != 0)
+			{
+				lg_histogram_add(&session->latency, lg_now_us() - *pending);
+				*pending = 0;
+			}
+		}
+	}
+}
+
+static BOOL lg_replay(LG_SESSION* session, rdpContext* context)
+{
+	UINT32 loop;
+	UINT64 pending = 0;
+	UINT64 inPackets = 0;
+	const LG_CONFIG* config = session->config;
+
+	if (!freerdp_get_stats(context->rdp, NULL, NULL, &inPackets, NULL))
+		return FALSE;
+
+	for (loop = 0; loop < config->loops; loop++)
+	{
+		size_t x;
+		const UINT64 start = lg_now_us();
+
+		for (x = 0; x < config->count; x++)
+		{
+			const LG_PDU* pdu = &config->pdus[x];
+			UINT64 deadline = start;
+
+			if (config->timeScale > 0.0)
+				deadline += (UINT64)((double)pdu->offset / config->timeScale);
+
+			if (!lg_pump(session, context, deadline, &pending, &inPackets))
+				return FALSE;
+
+			if (!freerdp_send_pdu(context, pdu->data, pdu->length))
+			{
+				session->failed++;
+				continue;
+			}
+
+			session->sent++;
+
+			if (pending == 0)
+				pending = lg_now_us();
+		}
+	}
+
+	/* Collect the responses to the last PDUs */
+	return lg_pump(session, context, lg_now_us() + config->lingerMs * 1000ull, &pending,
+	               &inPackets);
+}
+
+static DWORD WINAPI lg_session_thread(LPVOID arg)
+{
+	DWORD status;
+	UINT64 start;
+	LG_SESSION* session = (LG_SESSION*)arg;
+	const LG_CONFIG* config = session->config;
+	RDP_CLIENT_ENTRY_POINTS clientEntryPoints;
+	rdpContext* context;
+
+	lg_client_entry(&clientEntryPoints);
+	context = freerdp_client_context_new(&clientEntryPoints);
+
+	if (!context)
+		return 1;
+
+	((lgContext*)context)->session = session;
+	status = freerdp_client_settings_parse_command_line(context->settings, config->argc,
+	                                                    config->argv, FALSE);
+
+	if ((status != 0) || (freerdp_client_start(context) != 0))
+		goto fail;
+
+	start = lg_now_us();
+
+	if (!freerdp_connect(context->instance))
+	{
+		WLog_ERR(TAG, "session %" PRIu32 ": connection failure 0x%08" PRIx32, session->index,
+		         freerdp_get_last_error(context));
+		goto stop;
+	}
+
+	session->connected = TRUE;
+	session->connectUs = lg_now_us() - start;
+
+	if (!lg_replay(session, context))
+		WLog_WARN(TAG, "session %" PRIu32 ": connection closed during replay", session->index);
+
+	freerdp_disconnect(context->instance);
+stop:
+	freerdp_client_stop(context);
+fail:
+	freerdp_client_context_free(context);
+	return 0;
+}
+
+/* Returns the CPU time of a process in seconds or a negative value if not available */
+static double lg_process_cpu(UINT32 pid)
+{
+#if defined(__linux__)
+	char path[64];
+	char buffer[1024];
+	const char* pos;
+	unsigned long utime, stime;
+	size_t length;
+	FILE* fp;
+
+	if (pid == 0)
+		return -1.0;
+
+	sprintf_s(path, sizeof(path), "/proc/%" PRIu32 "/stat", pid);
+	fp = fopen(path, "r");
+
+	if (!fp)
+		return -1.0;
+
+	length = fread(buffer, 1, sizeof(buffer) - 1, fp);
+	fclose(fp);
+	buffer[length] = '\0';
+
+	/* The command name may contain spaces, fields are counted after it */
+	pos = strrchr(buffer, ')');
+
+	if (!pos || (sscanf(pos + 1, " %*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu", &utime,
+	                    &stime) != 2))
+		return -1.0;
+
+	return (double)(utime + stime) / (double)sysconf(_SC_CLK_TCK);
+#else
+	WINPR_UNUSED(pid);
+	return -1.0;
+#endif
+}
+
+static double lg_self_cpu(void)
+{
+#if defined(__linux__)
+	struct rusage usage;
+
+	if (getrusage(RUSAGE_SELF, &usage) != 0)
+		return -1.0;
+
+	return (double)(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) +
+	       (double)(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1000000.0;
+#else
+	return -1.0;
+#endif
+}
+
+static void lg_print_cpu(FILE* fp, const char* name, double seconds, BOOL last)
+{
+	if (seconds < 0.0)
+		fprintf(fp, "  \"%s\": null%s\n", name, last ? "" : ",");
+	else
+		fprintf(fp, "  \"%s\": %.3f%s\n", name, seconds, last ? "" : ",");
+}
+
+static void lg_report(FILE* fp, const LG_CONFIG* config, const LG_SESSION* sessions,
+                      UINT32 count, UINT64 wallUs, double serverCpu, double selfCpu)
+{
+	UINT32 x;
+	UINT32 connected = 0;
+	LG_HISTOGRAM total = { 0 };
+
+	for (x = 0; x < count; x++)
+	{
+		if (sessions[x].connected)
+			connected++;
+
+		lg_histogram_merge(&total, &sessions[x].latency);
+	}
+
+	fprintf(fp, "{\n");
+	fprintf(fp, "  \"sessions\": %" PRIu32 ",\n", count);
+	fprintf(fp, "  \"connected\": %" PRIu32 ",\n", connected);
+	fprintf(fp, "  \"pdus\": %" PRIuz ",\n", config->count);
+	fprintf(fp, "  \"loops\": %" PRIu32 ",\n", config->loops);
+	fprintf(fp, "  \"time_scale\": %.3f,\n", config->timeScale);
+	fprintf(fp, "  \"wall_seconds\": %.3f,\n", (double)wallUs / 1000000.0);
+	lg_print_cpu(fp, "server_cpu_seconds", serverCpu, FALSE);
+	lg_print_cpu(fp, "server_cpu_seconds_per_session",
+	             ((serverCpu < 0.0) || (connected == 0)) ? -1.0 : serverCpu / connected, FALSE);
+	lg_print_cpu(fp, "loadgen_cpu_seconds", selfCpu, FALSE);
+	fprintf(fp, "  \"latency_us\": ");
+	lg_histogram_print(fp, &total, "  ");
+	fprintf(fp, ",\n  \"results\": [");
+
+	for (x = 0; x < count; x++)
+	{
+		const LG_SESSION* session = &sessions[x];
+
+		fprintf(fp, "%s\n    {\n", (x > 0) ? "," : "");
+		fprintf(fp, "      \"session\": %" PRIu32 ",\n", session->index);
+		fprintf(fp, "      \"connected\": %s,\n", session->connected ? "true" : "false");
+		fprintf(fp, "      \"connect_ms\": %.3f,\n", (double)session->connectUs / 1000.0);
+		fprintf(fp, "      \"sent\": %" PRIu64 ",\n", session->sent);
+		fprintf(fp, "      \"failed\": %" PRIu64 ",\n", session->failed);
+		fprintf(fp, "      \"latency_us\": ");
+		lg_histogram_print(fp, &session->latency, "      ");
+		fprintf(fp, "\n    }");
+	}
+
+	fprintf(fp, "\n  ]\n}\n");
+}
+
+static void lg_usage(const char* name)
+{
+	printf("Usage: %s -r <pcap-file> [options] -- <client arguments>\n", name);
+	printf("Replays the PDUs recorded with /dump-pdus from concurrent headless sessions.\n\n");
+	printf("  -r <file>     PDUs recorded by a client with /dump-pdus:<file>\n");
+	printf("  -n <count>    number of concurrent sessions (default 1)\n");
+	printf("  -t <scale>    time scale, 2 replays twice as fast, 0 without delays (default 1)\n");
+	printf("  -d <ms>       delay between session starts (default 100)\n");
+	printf("  -l <count>    number of times each session replays the recording (default 1)\n");
+	printf("  -w <ms>       time to wait for responses after the last PDU (default 1000)\n");
+	printf("  -p <pid>      server process to measure the CPU time of (Linux only)\n");
+	printf("  -i            replay fast path input only, skipping channel and control PDUs\n");
+	printf("  -o <file>     write the JSON report to a file instead of stdout\n\n");
+	printf("The client arguments must set up the channels of the recorded session, e.g.\n");
+	printf("  %s -r session.pcap -n 20 -- /v:localhost /u:user /p:pass /cert:ignore\n", name);
+}
+
+int main(int argc, char* argv[])
+{
+	int x;
+	int rc = 1;
+	UINT32 index;
+	UINT32 count = 1;
+	UINT32 rampMs = 100;
+	UINT32 pid = 0;
+	BOOL inputOnly = FALSE;
+	const char* file = NULL;
+	const char* output = NULL;
+	double serverCpu, selfCpu;
+	UINT64 start, wallUs;
+	LG_CONFIG config = { 0 };
+	LG_SESSION* sessions = NULL;
+	FILE* fp = stdout;
+	wLog* root = WLog_GetRoot();
+
+	config.timeScale = 1.0;
+	config.loops = 1;
+	config.lingerMs = 1000;
+
+	for (x = 1; x < argc; x++)
+	{
+		const char* arg = argv[x];
+		const char* value = (x + 1 < argc) ? argv[x + 1] : NULL;
+
+		if (strcmp(arg, "--") == 0)
+		{
+			x++;
+			break;
+		}
+		else if (strcmp(arg, "-i") == 0)
+		{
+			inputOnly = TRUE;
+			continue;
+		}
+		else if ((strcmp(arg, "-h") == 0) || (strcmp(arg, "--help") == 0) || !value)
+		{
+			lg_usage(argv[0]);
+			return (strcmp(arg, "-h") == 0) || (strcmp(arg, "--help") == 0) ? 0 : 1;
+		}
+
+		if (strcmp(arg, "-r") == 0)
+			file = value;
+		else if (strcmp(arg, "-o") == 0)
+			output = value;
+		else if (strcmp(arg, "-n") == 0)
+			count = strtoul(value, NULL, 0);
+		else if (strcmp(arg, "-t") == 0)
+			config.timeScale = atof(value);
+		else if (strcmp(arg, "-d") == 0)
+			rampMs = strtoul(value, NULL, 0);
+		else if (strcmp(arg, "-l") == 0)
+			config.loops = strtoul(value, NULL, 0);
+		else if (strcmp(arg, "-w") == 0)
+			config.lingerMs = strtoul(value, NULL, 0);
+		else if (strcmp(arg, "-p") == 0)
+			pid = strtoul(value, NULL, 0);
+		else
+		{
+			lg_usage(argv[0]);
+			return 1;
+		}
+
+		x++;
+	}
+
+	if (!file || (count == 0) || (config.timeScale < 0.0))
+	{
+		lg_usage(argv[0]);
+		return 1;
+	}
+
+	/* Client arguments are parsed for each session, argv[0] is the program name */
+	config.argc = argc - x + 1;
+	config.argv = &argv[x - 1];
+
+	/* Keep stdout for the report */
+	if (!WLog_SetLogAppenderType(root, WLOG_APPENDER_CONSOLE) ||
+	    !WLog_ConfigureAppender(WLog_GetLogAppender(root), "outputstream", (void*)"stderr"))
+		return 1;
+
+	if (!lg_load_pdus(&config, file, inputOnly))
+		goto fail;
+
+	sessions = calloc(count, sizeof(LG_SESSION));
+
+	if (!sessions)
+		goto fail;
+
+	serverCpu = lg_process_cpu(pid);
+	start = lg_now_us();
+
+	for (index = 0; index < count; index++)
+	{
+		LG_SESSION* session = &sessions[index];
+		session->config = &config;
+		session->index = index;
+
+		if ((index > 0) && (rampMs > 0))
+			Sleep(rampMs);
+
+		session->thread = CreateThread(NULL, 0, lg_session_thread, session, 0, NULL);
+
+		if (!session->thread)
+		{
+			WLog_ERR(TAG, "failed to start session %" PRIu32, index);
+			break;
+		}
+	}
+
+	for (index = 0; index < count; index++)
+	{
+		if (!sessions[index].thread)
+			continue;
+
+		WaitForSingleObject(sessions[index].thread, INFINITE);
+		CloseHandle(sessions[index].thread);
+	}
+
+	wallUs = lg_now_us() - start;
+
+	if (serverCpu >= 0.0)
+	{
+		const double end = lg_process_cpu(pid);
+		serverCpu = (end >= serverCpu) ? end - serverCpu : -1.0;
+	}
+
+	selfCpu = lg_self_cpu();
+
+	if (output)
+	{
+		fp = winpr_fopen(output, "w");
+
+		if (!fp)
+		{
+			WLog_ERR(TAG, "failed to create %s", output);
+			goto fail;
+		}
+	}
+
+	lg_report(fp, &config, sessions, count, wallUs, serverCpu, selfCpu);
+
+	if (fp != stdout)
+		fclose(fp);
+
+	rc = 0;
+
+	for (index = 0; index < count; index++)
+	{
+		if (!sessions[index].connected)
+			rc = 1;
+	}
+
+fail:
+	free(sessions);
+	lg_free_pdus(&config);
+	return rc;
+}
@@ -44,9 +44,12 @@
 
 #define TAG CLIENT_TAG("wayland")
 
+/* The GDI primary surface may be a uwac buffer, it is only swapped or reallocated while
+ * holding the critical section that is kept from BeginPaint to EndPaint. */
 static BOOL wl_begin_paint(rdpContext* context)
 {
 	rdpGdi* gdi;
+	wlfContext* context_w;
 
 	if (!context || !context->gdi)
 		return FALSE;
@@ -56,10 +59,98 @@ static BOOL wl_begin_paint(rdpContext* context)
 	if (!gdi->primary)
 		return FALSE;
 
+	context_w = (wlfContext*)context;
+	EnterCriticalSection(&context_w->critical);
 	gdi->primary->hdc->hwnd->invalid->null = TRUE;
 	return TRUE;
 }
 
+/* Lets GDI draw directly into the uwac drawing buffer if the window shows the desktop
+ * unscaled, the primary bitmap then follows the drawing buffer after every submit. The GDI
+ * primary is only rebuilt when the shared buffer layout changes.
+ * Otherwise GDI draws into a buffer of its own that is copied to the window. */
+static BOOL wl_update_primary(wlfContext* context)
+{
+	BYTE* data;
+	BYTE* buffer;
+	size_t stride;
+	UINT32 bufferStride;
+	UwacSize geometry;
+	RECTANGLE_16 area;
+	UwacReturnCode rc;
+	rdpGdi* gdi = context->context.gdi;
+
+	if (!gdi || !gdi->primary || !context->window)
+		return FALSE;
+
+	rc = UwacWindowGetDrawingBufferGeometry(context->window, &geometry, &stride);
+	data = UwacWindowGetDrawingBuffer(context->window);
+
+	if ((rc != UWAC_SUCCESS) || !data)
+		return FALSE;
+
+	if (!context->context.settings->SmartSizing && (geometry.width == gdi->width) &&
+	    (geometry.height == gdi->height) && (stride <= UINT32_MAX))
+	{
+		if (gdi->primary_buffer == data)
+			return TRUE;
+
+		/* Another buffer of the window, only the pixels of the primary bitmap move */
+		if (context->sharedPrimary && (gdi->stride == stride))
+		{
+			gdi->primary->bitmap->data = data;
+			gdi->primary_buffer = data;
+			return TRUE;
+		}
+
+		if (!context->sharedPrimary)
+		{
+			/* The drawing buffer gets the current frame once, GDI keeps it up to date */
+			area.left = area.top = 0;
+			area.right = (UINT16)gdi->width;
+			area.bottom = (UINT16)gdi->height;
+
+			if (!wlf_copy_image(gdi->primary_buffer, gdi->stride, gdi->width, gdi->height, data,
+			                    stride, geometry.width, geometry.height, &area, FALSE))
+				return FALSE;
+
+			if (UwacWindowAddDamage(context->window, 0, 0, gdi->width, gdi->height) !=
+			    UWAC_SUCCESS)
+				return FALSE;
+		}
+
+		/* The previous primary is released by the resize, it is not shared after a failure */
+		context->sharedPrimary = gdi_resize_ex(gdi, gdi->width, gdi->height, (UINT32)stride,
+		                                       gdi->dstFormat, data, NULL);
+		return context->sharedPrimary;
+	}
+
+	if (!context->sharedPrimary)
+		return TRUE;
+
+	/* The uwac buffer of the primary surface may be gone already, keep what the window shows */
+	bufferStride = gdi->width * GetBytesPerPixel(gdi->dstFormat);
+	buffer = _aligned_malloc(bufferStride * 1ULL * gdi->height, 16);
+
+	if (!buffer)
+		return FALSE;
+
+	ZeroMemory(buffer, bufferStride * 1ULL * gdi->height);
+	area.left = area.top = 0;
+	area.right = (UINT16)MIN(gdi->width, geometry.width);
+	area.bottom = (UINT16)MIN(gdi->height, geometry.height);
+
+	if (!context->context.settings->SmartSizing)
+		wlf_copy_image(data, stride, geometry.width, geometry.height, buffer, bufferStride,
+		               gdi->width, gdi->height, &area, FALSE);
+
+	context->sharedPrimary = FALSE;
+
+	/* The primary bitmap owns the buffer, it is released with it on failure as well */
+	return gdi_resize_ex(gdi, gdi->width, gdi->height, bufferStride, gdi->dstFormat, buffer,
+	                     _aligned_free);
+}
+
 static BOOL wl_update_buffer(wlfContext* context_w, INT32 ix, INT32 iy, INT32 iw, INT32 ih)
 {
 	BOOL res = FALSE;
@@ -105,7 +196,8 @@ static BOOL wl_update_buffer(wlfContext* context_w, INT32 ix, INT32 iy, INT32 iw
 	area.right = x + w;
 	area.bottom = y + h;
 
-	if (!wlf_copy_image(gdi->primary_buffer, gdi->stride, gdi->width, gdi->height, data, stride,
+	if ((gdi->primary_buffer != (BYTE*)data) &&
+	    !wlf_copy_image(gdi->primary_buffer, gdi->stride, gdi->width, gdi->height, data, stride,
 	                    geometry.width, geometry.height, &area,
 	                    context_w->context.settings->SmartSizing))
 		goto fail;
@@ -119,10 +211,10 @@ static BOOL wl_update_buffer(wlfContext* context_w, INT32 ix, INT32 iy, INT32 iw
 	if (UwacWindowAddDamage(context_w->window, x, y, w, h) != UWAC_SUCCESS)
 		goto fail;
 
-	if (UwacWindowSubmitBuffer(context_w->window, false) != UWAC_SUCCESS)
+	if (UwacWindowSubmitBuffer(context_w->window, context_w->sharedPrimary) != UWAC_SUCCESS)
 		goto fail;
 
-	res = TRUE;
+	res = wl_update_primary(context_w);
 fail:
 	LeaveCriticalSection(&context_w->critical);
 	return res;
@@ -130,6 +222,7 @@ fail:
 
 static BOOL wl_end_paint(rdpContext* context)
 {
+	BOOL rc = TRUE;
 	rdpGdi* gdi;
 	wlfContext* context_w;
 	INT32 x, y;
@@ -139,16 +232,19 @@ static BOOL wl_end_paint(rdpContext* context)
 		return FALSE;
 
 	gdi = context->gdi;
+	context_w = (wlfContext*)context;
 
-	if (gdi->primary->hdc->hwnd->invalid->null)
-		return TRUE;
+	if (!gdi->primary->hdc->hwnd->invalid->null)
+	{
+		x = gdi->primary->hdc->hwnd->invalid->x;
+		y = gdi->primary->hdc->hwnd->invalid->y;
+		w = gdi->primary->hdc->hwnd->invalid->w;
+		h = gdi->primary->hdc->hwnd->invalid->h;
+		rc = wl_update_buffer(context_w, x, y, w, h);
+	}
 
-	x = gdi->primary->hdc->hwnd->invalid->x;
-	y = gdi->primary->hdc->hwnd->invalid->y;
-	w = gdi->primary->hdc->hwnd->invalid->w;
-	h = gdi->primary->hdc->hwnd->invalid->h;
-	context_w = (wlfContext*)context;
-	return wl_update_buffer(context_w, x, y, w, h);
+	LeaveCriticalSection(&context_w->critical);
+	return rc;
 }
 
 static BOOL wl_refresh_display(wlfContext* context)
@@ -164,11 +260,20 @@ static BOOL wl_refresh_display(wlfContext* context)
 
 static BOOL wl_resize_display(rdpContext* context)
 {
+	BOOL rc;
 	wlfContext* wlc = (wlfContext*)context;
 	rdpGdi* gdi = context->gdi;
 	rdpSettings* settings = context->settings;
 
-	if (!gdi_resize(gdi, settings->DesktopWidth, settings->DesktopHeight))
+	EnterCriticalSection(&wlc->critical);
+	rc = gdi_resize(gdi, settings->DesktopWidth, settings->DesktopHeight);
+
+	if (rc && (gdi->primary_buffer != UwacWindowGetDrawingBuffer(wlc->window)))
+		wlc->sharedPrimary = FALSE;
+
+	LeaveCriticalSection(&wlc->critical);
+
+	if (!rc)
 		return FALSE;
 
 	return wl_refresh_display(wlc);
@@ -296,6 +401,7 @@ static void wl_post_disconnect(freerdp* instance)
 
 	context = (wlfContext*)instance->context;
 	gdi_free(instance);
+	context->sharedPrimary = FALSE;
 	wlf_clipboard_free(context->clipboard);
 	wlf_disp_free(context->disp);
 
@@ -306,14 +412,24 @@ static void wl_post_disconnect(freerdp* instance)
 static BOOL handle_uwac_events(freerdp* instance, UwacDisplay* display)
 {
 	BOOL rc;
+	int status;
 	UwacEvent event;
 	wlfContext* context;
 
-	if (UwacDisplayDispatch(display, 1) < 0)
-		return FALSE;
-
 	context = (wlfContext*)instance->context;
 
+	/* A configure may replace the window buffers, GDI must not draw into them meanwhile */
+	EnterCriticalSection(&context->critical);
+	status = UwacDisplayDispatch(display, 1);
+
+	if (context->sharedPrimary && !wl_update_primary(context))
+		status = -1;
+
+	LeaveCriticalSection(&context->critical);
+
+	if (status < 0)
+		return FALSE;
+
 	while (UwacHasEvent(display))
 	{
 		if (UwacNextEvent(display, &event) != UWAC_SUCCESS)
@@ -332,9 +448,14 @@ static BOOL handle_uwac_events(freerdp* instance, UwacDisplay* display)
 
 			case UWAC_EVENT_FRAME_DONE:
 				EnterCriticalSection(&context->critical);
-				rc = UwacWindowSubmitBuffer(context->window, false);
+				rc = UwacWindowSubmitBuffer(context->window, context->sharedPrimary) ==
+				     UWAC_SUCCESS;
+
+				if (rc && context->sharedPrimary)
+					rc = wl_update_primary(context);
+
 				LeaveCriticalSection(&context->critical);
-				if (rc != UWAC_SUCCESS)
+				if (!rc)
 					return FALSE;
 				break;
 
@@ -54,6 +54,7 @@ struct wlf_context
 	BOOL fullscreen;
 	BOOL closed;
 	BOOL focusing;
+	BOOL sharedPrimary; /* GDI draws directly into the uwac drawing buffer */
 
 	/* Channels */
 	RdpeiClientContext* rdpei;
@@ -150,6 +150,7 @@ struct xf_clipboard
 	BOOL data_raw_format;
 	UINT32 data_format_id;
 	const char* data_format_name;
+	Atom data_target;
 	int data_length;
 	int data_raw_length;
 	XSelectionEvent* respond;
@@ -304,6 +305,22 @@ static const xfCliprdrFormat* xf_cliprdr_get_client_format_by_atom(xfClipboard*
 	return NULL;
 }
 
+static const CLIPRDR_FORMAT* xf_cliprdr_get_server_format_by_name(xfClipboard* clipboard,
+                                                                   const char* name)
+{
+	int j;
+
+	for (j = 0; j < clipboard->numServerFormats; j++)
+	{
+		const CLIPRDR_FORMAT* server_format = &(clipboard->serverFormats[j]);
+
+		if (server_format->formatName && (strcmp(server_format->formatName, name) == 0))
+			return server_format;
+	}
+
+	return NULL;
+}
+
 static const CLIPRDR_FORMAT* xf_cliprdr_get_server_format_by_atom(xfClipboard* clipboard, Atom atom)
 {
 	int i;
@@ -315,6 +332,16 @@ static const CLIPRDR_FORMAT* xf_cliprdr_get_server_format_by_atom(xfClipboard* c
 		if (client_format->atom == atom)
 		{
 			int j;
+
+			/* Prefer the compressed image, the bitmap is synthesized locally */
+			if (client_format->formatId == CF_DIB)
+			{
+				const CLIPRDR_FORMAT* png = xf_cliprdr_get_server_format_by_name(clipboard, "PNG");
+
+				if (png)
+					return png;
+			}
+
 			for (j = 0; j < clipboard->numServerFormats; j++)
 			{
 				const CLIPRDR_FORMAT* server_format = &(clipboard->serverFormats[j]);
@@ -738,6 +765,10 @@ static void xf_cliprdr_process_requested_data(xfClipboard* clipboard, BOOL hasDa
 			srcFormatId = ClipboardGetFormatId(clipboard->system, "image/bmp");
 			break;
 
+		case CB_FORMAT_PNG:
+			srcFormatId = ClipboardGetFormatId(clipboard->system, "image/png");
+			break;
+
 		case CB_FORMAT_HTML:
 			srcFormatId = ClipboardGetFormatId(clipboard->system, "text/html");
 			break;
@@ -1086,7 +1117,8 @@ static BOOL xf_cliprdr_process_selection_request(xfClipboard* clipboard,
 			/* We can compare format names by pointer value here as they are both
 			 * taken from the same clipboard->serverFormats array */
 			matchingFormat = (formatId == clipboard->data_format_id) &&
-			                 (formatName == clipboard->data_format_name);
+			                 (formatName == clipboard->data_format_name) &&
+			                 (xevent->target == clipboard->data_target);
 
 			if (matchingFormat && (clipboard->data != 0) && !rawTransfer)
 			{
@@ -1117,6 +1149,7 @@ static BOOL xf_cliprdr_process_selection_request(xfClipboard* clipboard,
 				clipboard->respond = respond;
 				clipboard->data_format_id = formatId;
 				clipboard->data_format_name = formatName;
+				clipboard->data_target = xevent->target;
 				clipboard->data_raw_format = rawTransfer;
 				delayRespond = TRUE;
 				xf_cliprdr_send_data_request(clipboard, formatId);
@@ -2020,6 +2053,18 @@ xf_cliprdr_server_format_data_response(CliprdrClientContext* context,
 			nullTerminated = TRUE;
 		}
 
+		if (strcmp(clipboard->data_format_name, "PNG") == 0)
+		{
+			srcFormatId = ClipboardGetFormatId(clipboard->system, "PNG");
+			dstTargetFormat =
+			    xf_cliprdr_get_client_format_by_atom(clipboard, clipboard->respond->target);
+
+			if (dstTargetFormat && (dstTargetFormat->formatId == CF_DIB))
+				dstFormatId = ClipboardGetFormatId(clipboard->system, "image/bmp");
+			else
+				dstFormatId = ClipboardGetFormatId(clipboard->system, "image/png");
+		}
+
 		if (strcmp(clipboard->data_format_name, "FileGroupDescriptorW") == 0)
 		{
 #ifdef WITH_FUSE
@@ -2834,6 +2879,10 @@ xfClipboard* xf_clipboard_new(xfContext* xfc)
 	clientFormat = &clipboard->clientFormats[n++];
 	clientFormat->atom = XInternAtom(xfc->display, "image/png", False);
 	clientFormat->formatId = CB_FORMAT_PNG;
+	clientFormat->formatName = _strdup("PNG");
+
+	if (!clientFormat->formatName)
+		goto error;
 
 	clientFormat = &clipboard->clientFormats[n++];
 	clientFormat->atom = XInternAtom(xfc->display, "image/jpeg", False);
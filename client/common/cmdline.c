@@ -2547,6 +2547,13 @@ int freerdp_client_settings_parse_command_line_arguments(rdpSettings* settings,
 		{
 			settings->DisableThemes = !enable;
 		}
+		CommandLineSwitchCase(arg, "printer-spool-limit")
+		{
+			ULONGLONG val;
+			if (!value_to_uint(arg->Value, &val, 1, UINT32_MAX))
+				return COMMAND_LINE_ERROR_UNEXPECTED_VALUE;
+			settings->PrinterSpoolLimit = (UINT32)val;
+		}
 		CommandLineSwitchCase(arg, "timeout")
 		{
 			ULONGLONG val;
@@ -2645,6 +2652,10 @@ int freerdp_client_settings_parse_command_line_arguments(rdpSettings* settings,
 				settings->SupportGraphicsPipeline = TRUE;
 		}
 #ifdef WITH_GFX_H264
+		CommandLineSwitchCase(arg, "gfx-avc444-independent")
+		{
+			settings->GfxAVC444IndependentAux = enable;
+		}
 		CommandLineSwitchCase(arg, "gfx-h264")
 		{
 			settings->SupportGraphicsPipeline = TRUE;
@@ -3161,6 +3172,13 @@ int freerdp_client_settings_parse_command_line_arguments(rdpSettings* settings,
 
 			settings->PlayRemoteFx = TRUE;
 		}
+		CommandLineSwitchCase(arg, "dump-pdus")
+		{
+			if (!copy_value(arg->Value, &settings->TransportDumpFile))
+				return COMMAND_LINE_ERROR_MEMORY;
+
+			settings->TransportDump = TRUE;
+		}
 		CommandLineSwitchCase(arg, "auth-only")
 		{
 			settings->AuthenticationOnly = enable;
@@ -125,6 +125,8 @@ static const COMMAND_LINE_ARGUMENT_A args[] = {
 	  "later\" option in MSTSC." },
 	{ "drives", COMMAND_LINE_VALUE_BOOL, NULL, BoolValueFalse, NULL, -1, NULL,
 	  "Redirect all mount points as shares" },
+	{ "dump-pdus", COMMAND_LINE_VALUE_REQUIRED, "<pcap-file>", NULL, NULL, -1, NULL,
+	  "Record the client to server PDUs of the session to a pcap file (see freerdp-loadgen)" },
 	{ "dvc", COMMAND_LINE_VALUE_REQUIRED, "<channel>[,<options>]", NULL, NULL, -1, NULL,
 	  "Dynamic virtual channel" },
 	{ "dynamic-resolution", COMMAND_LINE_VALUE_FLAG, NULL, NULL, NULL, -1, NULL,
@@ -163,6 +165,8 @@ static const COMMAND_LINE_ARGUMENT_A args[] = {
 #ifdef WITH_GFX_H264
 	{ "gfx", COMMAND_LINE_VALUE_OPTIONAL, "[[RFX|AVC420|AVC444],mask:<value>]", NULL, NULL, -1,
 	  NULL, "RDP8 graphics pipeline" },
+	{ "gfx-avc444-independent", COMMAND_LINE_VALUE_BOOL, NULL, BoolValueFalse, NULL, -1, NULL,
+	  "Decode the AVC444 chroma stream with a separate decoder, the server must encode it so" },
 #if defined(WITH_FREERDP_DEPRECATED)
 	{ "gfx-h264", COMMAND_LINE_VALUE_OPTIONAL,
 	  "[[AVC420|AVC444],mask:<value>] [DEPRECATED] use /gfx:avc420 instead", NULL, NULL, -1, NULL,
@@ -237,8 +241,9 @@ static const COMMAND_LINE_ARGUMENT_A args[] = {
 	{ "menu-anims", COMMAND_LINE_VALUE_BOOL, NULL, BoolValueFalse, NULL, -1, NULL,
 	  "menu animations" },
 	{ "microphone", COMMAND_LINE_VALUE_OPTIONAL,
-	  "[sys:<sys>,][dev:<dev>,][format:<format>,][rate:<rate>,][channel:<channel>]", NULL, NULL, -1,
-	  "mic", "Audio input (microphone)" },
+	  "[sys:<sys>,][dev:<dev>,][format:<format>,][rate:<rate>,][channel:<channel>,][bitrate:<"
+	  "bitrate>,][complexity:<0-10>]",
+	  NULL, NULL, -1, "mic", "Audio input (microphone)" },
 	{ "monitor-list", COMMAND_LINE_VALUE_FLAG | COMMAND_LINE_PRINT, NULL, NULL, NULL, -1, NULL,
 	  "List detected monitors" },
 	{ "monitors", COMMAND_LINE_VALUE_REQUIRED, "<id>[,<id>[,...]]", NULL, NULL, -1, NULL,
@@ -287,6 +292,8 @@ static const COMMAND_LINE_ARGUMENT_A args[] = {
 	  "Print base64 reconnect cookie after connecting" },
 	{ "printer", COMMAND_LINE_VALUE_OPTIONAL, "<name>[,<driver>]", NULL, NULL, -1, NULL,
 	  "Redirect printer device" },
+	{ "printer-spool-limit", COMMAND_LINE_VALUE_REQUIRED, "<size in KiB>", NULL, NULL, -1, NULL,
+	  "Printer data spooled for the print backend before the server has to wait" },
 	{ "proxy", COMMAND_LINE_VALUE_REQUIRED, "[<proto>://][<user>:<password>@]<host>:<port>", NULL,
 	  NULL, -1, NULL,
 	  "Proxy settings: override env. var (see also environment variable below). Protocol "
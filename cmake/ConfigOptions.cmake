@@ -66,6 +66,8 @@ CMAKE_DEPENDENT_OPTION(TESTS_WTSAPI_EXTRA "Build extra WTSAPI tests (interactive
 CMAKE_DEPENDENT_OPTION(BUILD_COMM_TESTS "Build comm related tests (require comm port)" OFF "BUILD_TESTING" OFF)
 
 option(WITH_SAMPLE "Build sample code" OFF)
+option(WITH_LOADGEN "Build the freerdp-loadgen session replay load generator" OFF)
+option(WITH_CODEC_BENCH "Build the freerdp-codec-bench codec benchmark" OFF)
 
 option(WITH_CLIENT_COMMON "Build client common library" ON)
 CMAKE_DEPENDENT_OPTION(WITH_CLIENT "Build client binaries" ON "WITH_CLIENT_COMMON" OFF)
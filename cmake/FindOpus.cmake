@@ -0,0 +1,38 @@
+# - Find Opus
+# Find the Opus audio codec library
+#
+#  This module defines the following variables:
+#     OPUS_FOUND        - true if OPUS_INCLUDE_DIR & OPUS_LIBRARY are found
+#     OPUS_LIBRARIES    - Set when OPUS_LIBRARY is found
+#     OPUS_INCLUDE_DIRS - Set when OPUS_INCLUDE_DIR is found
+#
+#     OPUS_INCLUDE_DIR  - where to find opus/opus.h
+#     OPUS_LIBRARY      - the Opus library
+#
+
+#=============================================================================
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#=============================================================================
+
+find_path(OPUS_INCLUDE_DIR opus/opus.h)
+
+find_library(OPUS_LIBRARY opus)
+
+find_package_handle_standard_args(Opus DEFAULT_MSG OPUS_INCLUDE_DIR OPUS_LIBRARY)
+
+if(OPUS_FOUND)
+	set(OPUS_LIBRARIES ${OPUS_LIBRARY})
+	set(OPUS_INCLUDE_DIRS ${OPUS_INCLUDE_DIR})
+endif()
+
+mark_as_advanced(OPUS_INCLUDE_DIR OPUS_LIBRARY)
@@ -64,6 +64,30 @@ extern "C"
 	FREERDP_API BOOL WTSVirtualChannelManagerIsChannelJoined(HANDLE hServer, const char* name);
 	FREERDP_API BYTE WTSVirtualChannelManagerGetDrdynvcState(HANDLE hServer);
 
+	/** Limits the bytes a single CheckFileDescriptor call sends, 0 (default) sends all. */
+	FREERDP_API void WTSVirtualChannelManagerSetSendCredits(HANDLE hServer, size_t credits);
+
+	/**
+	 * Outgoing channel data is sent chunk by chunk, the channels share the bandwidth according
+	 * to their priority. A channel with priority 4 gets four times the bytes of a channel with
+	 * priority 1 while both have data pending.
+	 */
+#define WTS_CHANNEL_PRIORITY_LOW 1
+#define WTS_CHANNEL_PRIORITY_NORMAL 4
+#define WTS_CHANNEL_PRIORITY_HIGH 16
+
+	typedef void (*psWTSVirtualChannelBufferFree)(void* context, BYTE* buffer);
+
+	FREERDP_API BOOL WTSVirtualChannelSetPriority(HANDLE hChannelHandle, UINT32 priority);
+	/**
+	 * Like WTSVirtualChannelWrite but the buffer is sent without copying it. The channel takes
+	 * ownership of the buffer, fnFree is called once it is not needed anymore or the write failed.
+	 */
+	FREERDP_API BOOL WTSVirtualChannelWriteBuffer(HANDLE hChannelHandle, BYTE* Buffer,
+	                                              ULONG Length,
+	                                              psWTSVirtualChannelBufferFree fnFree,
+	                                              void* context);
+
 	/**
 	 * Extended FreeRDP WTS functions for channel handling
 	 */
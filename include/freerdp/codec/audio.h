@@ -186,6 +186,17 @@ typedef struct AUDIO_FORMAT AUDIO_FORMAT;
 #define WAVE_FORMAT_DVM 0x2000
 #endif /* !__MINGW32__ */
 #define WAVE_FORMAT_AAC_MS 0xA106
+/**
+ * Opus as implemented by the FreeRDP DSP, not a format of MS-RDPEA. A wave PDU carries 20ms Opus
+ * packets back to back, each prefixed with its length in bytes as UINT16 little endian:
+ *
+ *   UINT16 length | length bytes of Opus packet | UINT16 length | ...
+ *
+ * Only FreeRDP peers decode this framing, the format is negotiated like any other.
+ */
+#ifndef WAVE_FORMAT_OPUS
+#define WAVE_FORMAT_OPUS 0x704F
+#endif
 
 /**
  * Audio Format Functions
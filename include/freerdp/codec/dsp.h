@@ -27,6 +27,13 @@
 
 typedef struct _FREERDP_DSP_CONTEXT FREERDP_DSP_CONTEXT;
 
+enum _FREERDP_DSP_OPTION
+{
+	FREERDP_DSP_OPTION_BITRATE = 1,   /* bits per second, 0 derives it from the target format */
+	FREERDP_DSP_OPTION_COMPLEXITY = 2 /* encoder complexity, 0 (fastest) to 10 */
+};
+typedef enum _FREERDP_DSP_OPTION FREERDP_DSP_OPTION;
+
 #ifdef __cplusplus
 extern "C"
 {
@@ -42,6 +49,8 @@ extern "C"
 	FREERDP_API BOOL freerdp_dsp_context_reset(FREERDP_DSP_CONTEXT* context,
 	                                           const AUDIO_FORMAT* targetFormat,
 	                                           UINT32 FramesPerPacket);
+	FREERDP_API BOOL freerdp_dsp_context_set_option(FREERDP_DSP_CONTEXT* context,
+	                                                FREERDP_DSP_OPTION option, UINT32 value);
 
 #ifdef __cplusplus
 }
@@ -37,6 +37,16 @@ enum _H264_RATECONTROL_MODE
 };
 typedef enum _H264_RATECONTROL_MODE H264_RATECONTROL_MODE;
 
+enum _H264_CONTEXT_OPTION
+{
+	/* Use a second encoder (decoder) instance for the AVC444 chroma stream. The luma and
+	 * chroma streams are then encoded in parallel, but the peer must decode them with
+	 * separate decoders as well. [MS-RDPEGFX] has no capability for this, so only enable it
+	 * for peers known to support it. Set before the first frame. */
+	H264_CONTEXT_OPTION_INDEPENDENT_AUX_STREAM
+};
+typedef enum _H264_CONTEXT_OPTION H264_CONTEXT_OPTION;
+
 struct _H264_CONTEXT
 {
 	BOOL Compressor;
@@ -113,6 +123,10 @@ extern "C"
 
 	FREERDP_API BOOL h264_context_reset(H264_CONTEXT* h264, UINT32 width, UINT32 height);
 
+	FREERDP_API BOOL h264_context_set_option(H264_CONTEXT* h264, H264_CONTEXT_OPTION option,
+	                                         UINT32 value);
+	FREERDP_API UINT32 h264_context_get_option(H264_CONTEXT* h264, H264_CONTEXT_OPTION option);
+
 	FREERDP_API H264_CONTEXT* h264_context_new(BOOL Compressor);
 	FREERDP_API void h264_context_free(H264_CONTEXT* h264);
 
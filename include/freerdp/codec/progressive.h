@@ -55,6 +55,10 @@ extern "C"
 	FREERDP_API int progressive_delete_surface_context(PROGRESSIVE_CONTEXT* progressive,
 	                                                   UINT16 surfaceId);
 
+	FREERDP_API BOOL progressive_context_set_passes(PROGRESSIVE_CONTEXT* progressive,
+	                                                UINT32 numPasses);
+	FREERDP_API BOOL progressive_compress_pending(PROGRESSIVE_CONTEXT* progressive);
+
 	FREERDP_API BOOL progressive_context_reset(PROGRESSIVE_CONTEXT* progressive);
 
 	FREERDP_API PROGRESSIVE_CONTEXT* progressive_context_new(BOOL Compressor);
@@ -122,6 +122,44 @@ extern "C"
 	FREERDP_API BOOL region16_union_rect(REGION16* dst, const REGION16* src,
 	                                     const RECTANGLE_16* rect);
 
+	/** adds the rectangles in src and stores the resulting region in dst. The rectangles may
+	 * overlap, they are banded in a single sweep instead of being added one by one.
+	 * @param dst destination region
+	 * @param src source region
+	 * @param rects the rectangles to add
+	 * @param count the number of rectangles
+	 * @return if the operation was successful (false meaning out-of-memory)
+	 */
+	FREERDP_API BOOL region16_union_rects(REGION16* dst, const REGION16* src,
+	                                      const RECTANGLE_16* rects, UINT32 count);
+
+	/** computes the union of two regions
+	 * @param dst destination region
+	 * @param src1 first region
+	 * @param src2 second region
+	 * @return if the operation was successful (false meaning out-of-memory)
+	 */
+	FREERDP_API BOOL region16_union_region(REGION16* dst, const REGION16* src1,
+	                                       const REGION16* src2);
+
+	/** removes a rectangle from src and stores the resulting region in dst
+	 * @param dst destination region
+	 * @param src source region
+	 * @param rect the rectangle to remove
+	 * @return if the operation was successful (false meaning out-of-memory)
+	 */
+	FREERDP_API BOOL region16_subtract_rect(REGION16* dst, const REGION16* src,
+	                                        const RECTANGLE_16* rect);
+
+	/** removes the region src2 from src1 and stores the resulting region in dst
+	 * @param dst destination region
+	 * @param src1 the region to subtract from
+	 * @param src2 the region to remove
+	 * @return if the operation was successful (false meaning out-of-memory)
+	 */
+	FREERDP_API BOOL region16_subtract_region(REGION16* dst, const REGION16* src1,
+	                                          const REGION16* src2);
+
 	/** returns if a rectangle intersects the region
 	 * @param src the region
 	 * @param arg2 the rectangle
@@ -517,6 +517,10 @@ fingerprint. DEPRECATED: Use VerifyChangedCertificateEx */
 	FREERDP_API BOOL freerdp_get_stats(rdpRdp* rdp, UINT64* inBytes, UINT64* outBytes,
 	                                   UINT64* inPackets, UINT64* outPackets);
 
+	/** Sends a PDU recorded with FreeRDP_TransportDump on an active connection.
+	 *  Only sessions without standard RDP security can be replayed. */
+	FREERDP_API BOOL freerdp_send_pdu(rdpContext* context, const BYTE* data, size_t length);
+
 	FREERDP_API void freerdp_get_version(int* major, int* minor, int* revision);
 	FREERDP_API const char* freerdp_get_version_string(void);
 	FREERDP_API const char* freerdp_get_build_revision(void);
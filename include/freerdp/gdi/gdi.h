@@ -471,6 +471,7 @@ struct _GDI_DC
 	HGDI_WND hwnd;
 	INT32 drawMode;
 	INT32 bkMode;
+	INT32 polyFillMode;
 };
 typedef struct _GDI_DC GDI_DC;
 typedef GDI_DC* HGDI_DC;
@@ -495,6 +496,8 @@ struct gdi_glyph
 };
 typedef struct gdi_glyph gdiGlyph;
 
+typedef struct gdi_glyph_run gdiGlyphRun;
+
 struct rdp_gdi
 {
 	rdpContext* context;
@@ -526,6 +529,7 @@ struct rdp_gdi
 	GeometryClientContext* geometry;
 
 	wLog* log;
+	gdiGlyphRun* glyphRun;
 };
 
 #ifdef __cplusplus
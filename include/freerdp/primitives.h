@@ -83,9 +83,16 @@ typedef pstatus_t (*__copy_8u_t)(const BYTE* pSrc, BYTE* pDst, INT32 len);
 typedef pstatus_t (*__copy_8u_AC4r_t)(const BYTE* pSrc, INT32 srcStep, /* bytes */
                                       BYTE* pDst, INT32 dstStep,       /* bytes */
                                       INT32 width, INT32 height);      /* pixels */
+typedef pstatus_t (*__copy_convert_8u_t)(const BYTE* pSrc, UINT32 SrcFormat, INT32 srcStep,
+                                         BYTE* pDst, UINT32 DstFormat, INT32 dstStep,
+                                         UINT32 width, UINT32 height);
+typedef pstatus_t (*__scale_8u_C4R_t)(const BYTE* pSrc, INT32 srcStep, UINT32 srcWidth,
+                                      UINT32 srcHeight, BYTE* pDst, INT32 dstStep,
+                                      UINT32 dstWidth, UINT32 dstHeight);
 typedef pstatus_t (*__set_8u_t)(BYTE val, BYTE* pDst, UINT32 len);
 typedef pstatus_t (*__set_32s_t)(INT32 val, INT32* pDst, UINT32 len);
 typedef pstatus_t (*__set_32u_t)(UINT32 val, UINT32* pDst, UINT32 len);
+typedef pstatus_t (*__set_32u_masked_t)(UINT32 val, const BYTE* pMask, UINT32* pDst, UINT32 len);
 typedef pstatus_t (*__zero_t)(void* pDst, size_t bytes);
 typedef pstatus_t (*__alphaComp_argb_t)(const BYTE* pSrc1, UINT32 src1Step, const BYTE* pSrc2,
                                         UINT32 src2Step, BYTE* pDst, UINT32 dstStep, UINT32 width,
@@ -188,6 +195,12 @@ typedef struct
 	/* flags */
 	DWORD flags;
 	primitives_uninit_t uninit;
+	/* Pixel format conversion, returns -1 if the format pair is not supported */
+	__copy_convert_8u_t copy_convert_8u;
+	/* Bilinear magnification / area minification of 32 bpp images */
+	__scale_8u_C4R_t scale_8u_C4R;
+	/* Set the pixels with a non zero mask byte, used for glyphs */
+	__set_32u_masked_t set_32u_masked;
 } primitives_t;
 
 typedef enum
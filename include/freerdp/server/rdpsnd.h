@@ -24,6 +24,7 @@
 
 #include <freerdp/channels/wtsvc.h>
 #include <freerdp/channels/rdpsnd.h>
+#include <freerdp/codec/dsp.h>
 
 typedef struct _rdpsnd_server_context RdpsndServerContext;
 typedef struct _rdpsnd_server_context rdpsnd_server_context;
@@ -131,6 +132,8 @@ extern "C"
 	FREERDP_API void rdpsnd_server_context_free(RdpsndServerContext* context);
 	FREERDP_API HANDLE rdpsnd_server_get_event_handle(RdpsndServerContext* context);
 	FREERDP_API UINT rdpsnd_server_handle_messages(RdpsndServerContext* context);
+	FREERDP_API BOOL rdpsnd_server_set_dsp_option(RdpsndServerContext* context,
+	                                              FREERDP_DSP_OPTION option, UINT32 value);
 
 #ifdef __cplusplus
 }
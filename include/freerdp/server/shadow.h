@@ -152,6 +152,10 @@ struct rdp_shadow_server
 	char* PrivateKeyFile;
 	CRITICAL_SECTION lock;
 	freerdp_listener* listener;
+
+	UINT32 audioBitRate;
+	UINT32 audioComplexity;
+	UINT32 progressivePasses;
 };
 
 struct rdp_shadow_surface
@@ -741,6 +741,8 @@ typedef struct _RDPDR_PARALLEL RDPDR_PARALLEL;
 #define FreeRDP_PlayRemoteFx (1857)
 #define FreeRDP_DumpRemoteFxFile (1858)
 #define FreeRDP_PlayRemoteFxFile (1859)
+#define FreeRDP_TransportDump (1860)
+#define FreeRDP_TransportDumpFile (1861)
 #define FreeRDP_DeactivateClientDecoding (1863)
 #define FreeRDP_GatewayUsageMethod (1984)
 #define FreeRDP_GatewayPort (1985)
@@ -864,6 +866,7 @@ typedef struct _RDPDR_PARALLEL RDPDR_PARALLEL;
 #define FreeRDP_GfxAVC444v2 (3847)
 #define FreeRDP_GfxCapsFilter (3848)
 #define FreeRDP_GfxPlanar (3849)
+#define FreeRDP_GfxAVC444IndependentAux (3850)
 #define FreeRDP_BitmapCacheV3CodecId (3904)
 #define FreeRDP_DrawNineGridEnabled (3968)
 #define FreeRDP_DrawNineGridCacheSize (3969)
@@ -879,6 +882,7 @@ typedef struct _RDPDR_PARALLEL RDPDR_PARALLEL;
 #define FreeRDP_DrivesToRedirect (4290)
 #define FreeRDP_RedirectSmartCards (4416)
 #define FreeRDP_RedirectPrinters (4544)
+#define FreeRDP_PrinterSpoolLimit (4545)
 #define FreeRDP_RedirectSerialPorts (4672)
 #define FreeRDP_RedirectParallelPorts (4673)
 #define FreeRDP_PreferIPv6OverIPv4 (4674)
@@ -1247,7 +1251,9 @@ struct rdp_settings
 	ALIGN64 BOOL PlayRemoteFx;       /* 1857 */
 	ALIGN64 char* DumpRemoteFxFile;  /* 1858 */
 	ALIGN64 char* PlayRemoteFxFile;  /* 1859 */
-	UINT64 padding1860[1863 - 1860]; /* 1860 */
+	ALIGN64 BOOL TransportDump;      /* 1860 */
+	ALIGN64 char* TransportDumpFile; /* 1861 */
+	UINT64 padding1862[1863 - 1862]; /* 1862 */
 	ALIGN64 BOOL DeactivateClientDecoding; /* 1863 */
 	UINT64 padding1920[1920 - 1864];       /* 1864 */
 	UINT64 padding1984[1984 - 1920]; /* 1920 */
@@ -1470,17 +1476,18 @@ struct rdp_settings
 	ALIGN64 UINT32 JpegQuality;      /* 3778 */
 	UINT64 padding3840[3840 - 3779]; /* 3779 */
 
-	ALIGN64 BOOL GfxThinClient;      /* 3840 */
-	ALIGN64 BOOL GfxSmallCache;      /* 3841 */
-	ALIGN64 BOOL GfxProgressive;     /* 3842 */
-	ALIGN64 BOOL GfxProgressiveV2;   /* 3843 */
-	ALIGN64 BOOL GfxH264;            /* 3844 */
-	ALIGN64 BOOL GfxAVC444;          /* 3845 */
-	ALIGN64 BOOL GfxSendQoeAck;      /* 3846 */
-	ALIGN64 BOOL GfxAVC444v2;        /* 3847 */
-	ALIGN64 UINT32 GfxCapsFilter;    /* 3848 */
-	ALIGN64 BOOL GfxPlanar;          /* 3849 */
-	UINT64 padding3904[3904 - 3850]; /* 3850 */
+	ALIGN64 BOOL GfxThinClient;           /* 3840 */
+	ALIGN64 BOOL GfxSmallCache;           /* 3841 */
+	ALIGN64 BOOL GfxProgressive;          /* 3842 */
+	ALIGN64 BOOL GfxProgressiveV2;        /* 3843 */
+	ALIGN64 BOOL GfxH264;                 /* 3844 */
+	ALIGN64 BOOL GfxAVC444;               /* 3845 */
+	ALIGN64 BOOL GfxSendQoeAck;           /* 3846 */
+	ALIGN64 BOOL GfxAVC444v2;             /* 3847 */
+	ALIGN64 UINT32 GfxCapsFilter;         /* 3848 */
+	ALIGN64 BOOL GfxPlanar;               /* 3849 */
+	ALIGN64 BOOL GfxAVC444IndependentAux; /* 3850 */
+	UINT64 padding3904[3904 - 3851];      /* 3851 */
 
 	/**
 	 * Caches
@@ -1524,8 +1531,9 @@ struct rdp_settings
 	UINT64 padding4544[4544 - 4417]; /* 4417 */
 
 	/* Printer Redirection */
-	ALIGN64 BOOL RedirectPrinters;   /* 4544 */
-	UINT64 padding4672[4672 - 4545]; /* 4545 */
+	ALIGN64 BOOL RedirectPrinters;    /* 4544 */
+	ALIGN64 UINT32 PrinterSpoolLimit; /* 4545 */
+	UINT64 padding4672[4672 - 4546];  /* 4546 */
 
 	/* Serial and Parallel Port Redirection */
 	ALIGN64 BOOL RedirectSerialPorts;   /* 4672 */
@@ -0,0 +1,1239 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * Codec Benchmark
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * Runs the encoders and decoders of the library over a synthetic corpus generated from a seed
+ * and reports throughput, compression ratio and PSNR as JSON. The corpus only depends on the
+ * seed and the frame size, so results of different builds or machines can be compared.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <time.h>
+
+#include <winpr/crt.h>
+#include <winpr/stream.h>
+#include <winpr/sysinfo.h>
+#include <winpr/wlog.h>
+
+#include <freerdp/codec/color.h>
+#include <freerdp/codec/region.h>
+#include <freerdp/codec/rfx.h>
+#include <freerdp/codec/nsc.h>
+#include <freerdp/codec/planar.h>
+#include <freerdp/codec/interleaved.h>
+#include <freerdp/codec/progressive.h>
+#include <freerdp/codec/clear.h>
+#include <freerdp/codec/h264.h>
+
+#define BENCH_FORMAT PIXEL_FORMAT_BGRX32
+#define BENCH_TILE 64
+#define BENCH_SCROLL_STEP 8
+
+typedef struct
+{
+	const char* name;
+	UINT32 width;
+	UINT32 height;
+	UINT32 stride;
+	UINT32 frameCount;
+	BYTE** frames;
+} BENCH_CORPUS;
+
+typedef struct
+{
+	const char* name;
+	/* 64x64 tile based codecs split the frame themselves */
+	void* (*create)(UINT32 width, UINT32 height);
+	void (*free)(void* context);
+	BOOL (*encode)(void* context, const BYTE* src, UINT32 stride, UINT32 width, UINT32 height,
+	               wStream* s);
+	BOOL (*decode)(void* context, const BYTE* data, size_t length, BYTE* dst, UINT32 stride,
+	               UINT32 width, UINT32 height);
+	/* Encoding is done by the benchmark itself and not reported */
+	BOOL decodeOnly;
+} BENCH_CODEC;
+
+typedef struct
+{
+	UINT64 encodeTime;
+	UINT64 decodeTime;
+	UINT64 rawBytes;
+	UINT64 encodedBytes;
+	UINT64 tiles;
+	double squaredError;
+	UINT64 samples;
+} BENCH_RESULT;
+
+static UINT64 bench_time_ns(void)
+{
+#ifdef _WIN32
+	return GetTickCount64() * 1000000ull;
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (UINT64)ts.tv_sec * 1000000000ull + (UINT64)ts.tv_nsec;
+#endif
+}
+
+static UINT32 bench_rand(UINT32* state)
+{
+	*state ^= *state << 13;
+	*state ^= *state >> 17;
+	*state ^= *state << 5;
+	return *state;
+}
+
+static void bench_put_pixel(BYTE* frame, UINT32 stride, UINT32 x, UINT32 y, BYTE r, BYTE g, BYTE b)
+{
+	WriteColor(&frame[y * stride + x * 4], BENCH_FORMAT,
+	                  FreeRDPGetColor(BENCH_FORMAT, r, g, b, 0xFF));
+}
+
+/* Lines of glyphs taken from a random 5x7 font on a light background */
+static void bench_draw_text(BYTE* frame, UINT32 stride, UINT32 width, UINT32 height, UINT32 seed)
+{
+	UINT32 x, y, i;
+	UINT32 font[64];
+	UINT32 state = seed | 1;
+
+	for (i = 0; i < ARRAYSIZE(font); i++)
+		font[i] = bench_rand(&state) & 0x7FFFFFFF;
+
+	for (y = 0; y < height; y++)
+	{
+		for (x = 0; x < width; x++)
+			bench_put_pixel(frame, stride, x, y, 0xF4, 0xF4, 0xF0);
+	}
+
+	for (y = 4; y + 12 <= height; y += 12)
+	{
+		UINT32 lineEnd = width - 8 - bench_rand(&state) % (width / 4 + 1);
+
+		for (x = 8; x + 6 <= lineEnd; x += 6)
+		{
+			const UINT32 glyph = font[bench_rand(&state) % ARRAYSIZE(font)];
+			const BOOL link = (bench_rand(&state) % 16) == 0;
+			UINT32 gx, gy;
+
+			/* word breaks */
+			if ((bench_rand(&state) % 6) == 0)
+				continue;
+
+			for (gy = 0; gy < 7; gy++)
+			{
+				for (gx = 0; gx < 5; gx++)
+				{
+					if (glyph & (1u << (gy * 4 + gx)))
+					{
+						if (link)
+							bench_put_pixel(frame, stride, x + gx, y + gy, 0x10, 0x40, 0xC0);
+						else
+							bench_put_pixel(frame, stride, x + gx, y + gy, 0x20, 0x20, 0x20);
+					}
+				}
+			}
+		}
+	}
+}
+
+static void bench_draw_gradient(BYTE* frame, UINT32 stride, UINT32 width, UINT32 height)
+{
+	UINT32 x, y;
+
+	for (y = 0; y < height; y++)
+	{
+		for (x = 0; x < width; x++)
+		{
+			const double dx = (double)x - width / 2.0;
+			const double dy = (double)y - height / 2.0;
+			const double radial = sqrt(dx * dx + dy * dy) / sqrt(width * width / 2.0);
+			bench_put_pixel(frame, stride, x, y, (BYTE)(x * 255 / width),
+			                (BYTE)(y * 255 / height), (BYTE)(255.0 * (1.0 - radial)));
+		}
+	}
+}
+
+static double bench_lattice(const BYTE* lattice, UINT32 size, double x, double y)
+{
+	const UINT32 x0 = (UINT32)x;
+	const UINT32 y0 = (UINT32)y;
+	double fx = x - x0;
+	double fy = y - y0;
+	const double v00 = lattice[(y0 % size) * size + (x0 % size)];
+	const double v10 = lattice[(y0 % size) * size + ((x0 + 1) % size)];
+	const double v01 = lattice[((y0 + 1) % size) * size + (x0 % size)];
+	const double v11 = lattice[((y0 + 1) % size) * size + ((x0 + 1) % size)];
+
+	fx = fx * fx * (3.0 - 2.0 * fx);
+	fy = fy * fy * (3.0 - 2.0 * fy);
+	return (v00 * (1.0 - fx) + v10 * fx) * (1.0 - fy) + (v01 * (1.0 - fx) + v11 * fx) * fy;
+}
+
+/* Smooth value noise over four octaves with a little grain, close to natural images */
+static BOOL bench_draw_photo(BYTE* frame, UINT32 stride, UINT32 width, UINT32 height, UINT32 seed)
+{
+	const UINT32 size = 64;
+	UINT32 x, y, c, i;
+	UINT32 state = seed | 1;
+	BYTE* lattice = malloc(3ull * size * size);
+
+	if (!lattice)
+		return FALSE;
+
+	for (i = 0; i < 3 * size * size; i++)
+		lattice[i] = (BYTE)bench_rand(&state);
+
+	for (y = 0; y < height; y++)
+	{
+		for (x = 0; x < width; x++)
+		{
+			BYTE rgb[3];
+
+			for (c = 0; c < 3; c++)
+			{
+				double value = 0.0;
+				double scale = 96.0;
+				double weight = 0.5;
+				UINT32 octave;
+
+				for (octave = 0; octave < 4; octave++)
+				{
+					value += weight * bench_lattice(&lattice[c * size * size], size, x / scale,
+					                                y / scale);
+					scale /= 2.0;
+					weight /= 2.0;
+				}
+
+				value = value / 0.9375 + (double)(bench_rand(&state) % 9) - 4.0;
+				rgb[c] = (BYTE)MAX(0.0, MIN(255.0, value));
+			}
+
+			bench_put_pixel(frame, stride, x, y, rgb[0], rgb[1], rgb[2]);
+		}
+	}
+
+	free(lattice);
+	return TRUE;
+}
+
+static void bench_corpus_free(BENCH_CORPUS* corpus)
+{
+	UINT32 i;
+
+	if (!corpus->frames)
+		return;
+
+	for (i = 0; i < corpus->frameCount; i++)
+		_aligned_free(corpus->frames[i]);
+
+	free(corpus->frames);
+	corpus->frames = NULL;
+}
+
+static BOOL bench_corpus_alloc(BENCH_CORPUS* corpus, const char* name, UINT32 width,
+                               UINT32 height, UINT32 frameCount)
+{
+	UINT32 i;
+
+	corpus->name = name;
+	corpus->width = width;
+	corpus->height = height;
+	corpus->stride = width * 4;
+	corpus->frameCount = frameCount;
+	corpus->frames = calloc(frameCount, sizeof(BYTE*));
+
+	if (!corpus->frames)
+		return FALSE;
+
+	for (i = 0; i < frameCount; i++)
+	{
+		corpus->frames[i] = _aligned_malloc(1ull * corpus->stride * height, 16);
+
+		if (!corpus->frames[i])
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+/* The scrolling sequence moves a text page up by a few lines every frame */
+static BOOL bench_corpus_scroll(BENCH_CORPUS* corpus, UINT32 width, UINT32 height,
+                                UINT32 frameCount, UINT32 seed)
+{
+	UINT32 i;
+	const UINT32 stride = width * 4;
+	const UINT32 pageHeight = height + frameCount * BENCH_SCROLL_STEP;
+	BYTE* page = malloc(1ull * stride * pageHeight);
+
+	if (!page)
+		return FALSE;
+
+	bench_draw_text(page, stride, width, pageHeight, seed);
+
+	if (!bench_corpus_alloc(corpus, "scroll", width, height, frameCount))
+	{
+		free(page);
+		return FALSE;
+	}
+
+	for (i = 0; i < frameCount; i++)
+		memcpy(corpus->frames[i], &page[i * BENCH_SCROLL_STEP * stride], 1ull * stride * height);
+
+	free(page);
+	return TRUE;
+}
+
+static BOOL bench_corpus_init(BENCH_CORPUS corpus[4], UINT32 width, UINT32 height,
+                              UINT32 frameCount, UINT32 seed)
+{
+	if (!bench_corpus_alloc(&corpus[0], "text", width, height, 1) ||
+	    !bench_corpus_alloc(&corpus[1], "gradient", width, height, 1) ||
+	    !bench_corpus_alloc(&corpus[2], "photo", width, height, 1))
+		return FALSE;
+
+	bench_draw_text(corpus[0].frames[0], corpus[0].stride, width, height, seed);
+	bench_draw_gradient(corpus[1].frames[0], corpus[1].stride, width, height);
+
+	if (!bench_draw_photo(corpus[2].frames[0], corpus[2].stride, width, height, seed))
+		return FALSE;
+
+	return bench_corpus_scroll(&corpus[3], width, height, frameCount, seed);
+}
+
+/* Tile based codecs store every tile prefixed by its size */
+typedef BOOL (*bench_tile_encode_fn)(void* context, const BYTE* src, UINT32 stride, UINT32 width,
+                                     UINT32 height, BYTE* dst, UINT32* size);
+typedef BOOL (*bench_tile_decode_fn)(void* context, const BYTE* data, UINT32 size, BYTE* dst,
+                                     UINT32 stride, UINT32 width, UINT32 height);
+
+static BOOL bench_encode_tiles(void* context, bench_tile_encode_fn fn, const BYTE* src,
+                               UINT32 stride, UINT32 width, UINT32 height, wStream* s)
+{
+	UINT32 x, y;
+
+	for (y = 0; y < height; y += BENCH_TILE)
+	{
+		for (x = 0; x < width; x += BENCH_TILE)
+		{
+			const UINT32 w = MIN(BENCH_TILE, width - x);
+			const UINT32 h = MIN(BENCH_TILE, height - y);
+			UINT32 size = BENCH_TILE * BENCH_TILE * 4 + 1024;
+
+			if (!Stream_EnsureRemainingCapacity(s, 4ull + size))
+				return FALSE;
+
+			if (!fn(context, &src[y * stride + x * 4], stride, w, h, Stream_Pointer(s) + 4,
+			        &size))
+				return FALSE;
+
+			Stream_Write_UINT32(s, size);
+			Stream_Seek(s, size);
+		}
+	}
+
+	return TRUE;
+}
+
+static BOOL bench_decode_tiles(void* context, bench_tile_decode_fn fn, const BYTE* data,
+                               size_t length, BYTE* dst, UINT32 stride, UINT32 width,
+                               UINT32 height)
+{
+	UINT32 x, y;
+	wStream sbuffer = { 0 };
+	wStream* s = &sbuffer;
+
+	Stream_StaticInit(s, (BYTE*)data, length);
+
+	for (y = 0; y < height; y += BENCH_TILE)
+	{
+		for (x = 0; x < width; x += BENCH_TILE)
+		{
+			UINT32 size;
+
+			if (Stream_GetRemainingLength(s) < 4)
+				return FALSE;
+
+			Stream_Read_UINT32(s, size);
+
+			if (Stream_GetRemainingLength(s) < size)
+				return FALSE;
+
+			if (!fn(context, Stream_Pointer(s), size, &dst[y * stride + x * 4], stride,
+			        MIN(BENCH_TILE, width - x), MIN(BENCH_TILE, height - y)))
+				return FALSE;
+
+			Stream_Seek(s, size);
+		}
+	}
+
+	return TRUE;
+}
+
+/* RemoteFX ------------------------------------------------------------------ */
+typedef struct
+{
+	RFX_CONTEXT* encoder;
+	RFX_CONTEXT* decoder;
+} BENCH_RFX;
+
+static void bench_rfx_free(void* context)
+{
+	BENCH_RFX* rfx = context;
+
+	if (!rfx)
+		return;
+
+	rfx_context_free(rfx->encoder);
+	rfx_context_free(rfx->decoder);
+	free(rfx);
+}
+
+static void* bench_rfx_new(UINT32 width, UINT32 height)
+{
+	BENCH_RFX* rfx = calloc(1, sizeof(BENCH_RFX));
+
+	if (!rfx)
+		return NULL;
+
+	rfx->encoder = rfx_context_new(TRUE);
+	rfx->decoder = rfx_context_new(FALSE);
+
+	if (!rfx->encoder || !rfx->decoder || !rfx_context_reset(rfx->encoder, width, height) ||
+	    !rfx_context_reset(rfx->decoder, width, height))
+	{
+		bench_rfx_free(rfx);
+		return NULL;
+	}
+
+	rfx_context_set_pixel_format(rfx->encoder, BENCH_FORMAT);
+	rfx_context_set_pixel_format(rfx->decoder, BENCH_FORMAT);
+	return rfx;
+}
+
+static BOOL bench_rfx_encode(void* context, const BYTE* src, UINT32 stride, UINT32 width,
+                             UINT32 height, wStream* s)
+{
+	BENCH_RFX* rfx = context;
+	const RFX_RECT rect = { 0, 0, (UINT16)width, (UINT16)height };
+	return rfx_compose_message(rfx->encoder, s, &rect, 1, src, width, height, stride);
+}
+
+static BOOL bench_rfx_decode(void* context, const BYTE* data, size_t length, BYTE* dst,
+                             UINT32 stride, UINT32 width, UINT32 height)
+{
+	BOOL rc;
+	REGION16 region;
+	BENCH_RFX* rfx = context;
+
+	WINPR_UNUSED(width);
+	region16_init(&region);
+	rc = rfx_process_message(rfx->decoder, data, (UINT32)length, 0, 0, dst, BENCH_FORMAT, stride,
+	                         height, &region);
+	region16_uninit(&region);
+	return rc;
+}
+
+/* NSCodec ------------------------------------------------------------------- */
+typedef struct
+{
+	NSC_CONTEXT* encoder;
+	NSC_CONTEXT* decoder;
+} BENCH_NSC;
+
+static void bench_nsc_free(void* context)
+{
+	BENCH_NSC* nsc = context;
+
+	if (!nsc)
+		return;
+
+	nsc_context_free(nsc->encoder);
+	nsc_context_free(nsc->decoder);
+	free(nsc);
+}
+
+static void* bench_nsc_new(UINT32 width, UINT32 height)
+{
+	BENCH_NSC* nsc = calloc(1, sizeof(BENCH_NSC));
+
+	if (!nsc)
+		return NULL;
+
+	nsc->encoder = nsc_context_new();
+	nsc->decoder = nsc_context_new();
+
+	if (!nsc->encoder || !nsc->decoder || !nsc_context_reset(nsc->encoder, width, height) ||
+	    !nsc_context_reset(nsc->decoder, width, height) ||
+	    !nsc_context_set_parameters(nsc->encoder, NSC_COLOR_FORMAT, BENCH_FORMAT))
+	{
+		bench_nsc_free(nsc);
+		return NULL;
+	}
+
+	return nsc;
+}
+
+static BOOL bench_nsc_encode(void* context, const BYTE* src, UINT32 stride, UINT32 width,
+                             UINT32 height, wStream* s)
+{
+	BENCH_NSC* nsc = context;
+	return nsc_compose_message(nsc->encoder, s, src, width, height, stride);
+}
+
+static BOOL bench_nsc_decode(void* context, const BYTE* data, size_t length, BYTE* dst,
+                             UINT32 stride, UINT32 width, UINT32 height)
+{
+	BENCH_NSC* nsc = context;
+
+	/* The encoder stores the rows bottom up, like surface bits do */
+	return nsc_process_message(nsc->decoder, 32, width, height, data, (UINT32)length, dst,
+	                           BENCH_FORMAT, stride, 0, 0, width, height, FREERDP_FLIP_VERTICAL);
+}
+
+/* Planar, as used by the graphics pipeline for full surfaces ----------------- */
+typedef struct
+{
+	BITMAP_PLANAR_CONTEXT* encoder;
+	BITMAP_PLANAR_CONTEXT* decoder;
+} BENCH_PLANAR;
+
+static void bench_planar_free(void* context)
+{
+	BENCH_PLANAR* planar = context;
+
+	if (!planar)
+		return;
+
+	freerdp_bitmap_planar_context_free(planar->encoder);
+	freerdp_bitmap_planar_context_free(planar->decoder);
+	free(planar);
+}
+
+static void* bench_planar_new(UINT32 width, UINT32 height)
+{
+	const DWORD flags = PLANAR_FORMAT_HEADER_NA | PLANAR_FORMAT_HEADER_RLE;
+	BENCH_PLANAR* planar = calloc(1, sizeof(BENCH_PLANAR));
+
+	if (!planar)
+		return NULL;
+
+	planar->encoder = freerdp_bitmap_planar_context_new(flags, width, height);
+	planar->decoder = freerdp_bitmap_planar_context_new(flags, width, height);
+
+	if (!planar->encoder || !planar->decoder)
+	{
+		bench_planar_free(planar);
+		return NULL;
+	}
+
+	freerdp_planar_topdown_image(planar->encoder, TRUE);
+	return planar;
+}
+
+static BOOL bench_planar_encode(void* context, const BYTE* src, UINT32 stride, UINT32 width,
+                                UINT32 height, wStream* s)
+{
+	BYTE* data;
+	UINT32 size = 0;
+	BENCH_PLANAR* planar = context;
+
+	data = freerdp_bitmap_compress_planar(planar->encoder, src, BENCH_FORMAT, width, height, stride,
+	                                      NULL, &size);
+
+	if (!data)
+		return FALSE;
+
+	if (!Stream_EnsureRemainingCapacity(s, size))
+	{
+		free(data);
+		return FALSE;
+	}
+
+	Stream_Write(s, data, size);
+	free(data);
+	return TRUE;
+}
+
+static BOOL bench_planar_decode(void* context, const BYTE* data, size_t length, BYTE* dst,
+                                UINT32 stride, UINT32 width, UINT32 height)
+{
+	BENCH_PLANAR* planar = context;
+	return planar_decompress(planar->decoder, data, (UINT32)length, width, height, dst,
+	                         BENCH_FORMAT, stride, 0, 0, width, height, FALSE);
+}
+
+/* Interleaved RLE, 24 bpp bitmap updates of 64x64 tiles --------------------- */
+typedef struct
+{
+	BITMAP_INTERLEAVED_CONTEXT* encoder;
+	BITMAP_INTERLEAVED_CONTEXT* decoder;
+} BENCH_INTERLEAVED;
+
+static void bench_interleaved_free(void* context)
+{
+	BENCH_INTERLEAVED* interleaved = context;
+
+	if (!interleaved)
+		return;
+
+	bitmap_interleaved_context_free(interleaved->encoder);
+	bitmap_interleaved_context_free(interleaved->decoder);
+	free(interleaved);
+}
+
+static void* bench_interleaved_new(UINT32 width, UINT32 height)
+{
+	BENCH_INTERLEAVED* interleaved = calloc(1, sizeof(BENCH_INTERLEAVED));
+
+	WINPR_UNUSED(width);
+	WINPR_UNUSED(height);
+
+	if (!interleaved)
+		return NULL;
+
+	interleaved->encoder = bitmap_interleaved_context_new(TRUE);
+	interleaved->decoder = bitmap_interleaved_context_new(FALSE);
+
+	if (!interleaved->encoder || !interleaved->decoder)
+	{
+		bench_interleaved_free(interleaved);
+		return NULL;
+	}
+
+	return interleaved;
+}
+
+static BOOL bench_interleaved_encode_tile(void* context, const BYTE* src, UINT32 stride,
+                                          UINT32 width, UINT32 height, BYTE* dst, UINT32* size)
+{
+	BENCH_INTERLEAVED* interleaved = context;
+	return interleaved_compress(interleaved->encoder, dst, size, width, height, src, BENCH_FORMAT,
+	                            stride, 0, 0, NULL, 24);
+}
+
+static BOOL bench_interleaved_decode_tile(void* context, const BYTE* data, UINT32 size, BYTE* dst,
+                                          UINT32 stride, UINT32 width, UINT32 height)
+{
+	BENCH_INTERLEAVED* interleaved = context;
+	return interleaved_decompress(interleaved->decoder, data, size, width, height, 24, dst,
+	                              BENCH_FORMAT, stride, 0, 0, width, height, NULL);
+}
+
+static BOOL bench_interleaved_encode(void* context, const BYTE* src, UINT32 stride, UINT32 width,
+                                     UINT32 height, wStream* s)
+{
+	return bench_encode_tiles(context, bench_interleaved_encode_tile, src, stride, width, height,
+	                          s);
+}
+
+static BOOL bench_interleaved_decode(void* context, const BYTE* data, size_t length, BYTE* dst,
+                                     UINT32 stride, UINT32 width, UINT32 height)
+{
+	return bench_decode_tiles(context, bench_interleaved_decode_tile, data, length, dst, stride,
+	                          width, height);
+}
+
+/* Progressive --------------------------------------------------------------- */
+typedef struct
+{
+	PROGRESSIVE_CONTEXT* encoder;
+	PROGRESSIVE_CONTEXT* decoder;
+	UINT32 frameId;
+} BENCH_PROGRESSIVE;
+
+static void bench_progressive_free(void* context)
+{
+	BENCH_PROGRESSIVE* progressive = context;
+
+	if (!progressive)
+		return;
+
+	progressive_context_free(progressive->encoder);
+	progressive_context_free(progressive->decoder);
+	free(progressive);
+}
+
+static void* bench_progressive_new(UINT32 width, UINT32 height)
+{
+	BENCH_PROGRESSIVE* progressive = calloc(1, sizeof(BENCH_PROGRESSIVE));
+
+	if (!progressive)
+		return NULL;
+
+	progressive->encoder = progressive_context_new(TRUE);
+	progressive->decoder = progressive_context_new(FALSE);
+
+	if (!progressive->encoder || !progressive->decoder ||
+	    (progressive_create_surface_context(progressive->decoder, 0, width, height) <= 0))
+	{
+		bench_progressive_free(progressive);
+		return NULL;
+	}
+
+	return progressive;
+}
+
+static BOOL bench_progressive_encode(void* context, const BYTE* src, UINT32 stride, UINT32 width,
+                                     UINT32 height, wStream* s)
+{
+	BYTE* data = NULL;
+	UINT32 size = 0;
+	BENCH_PROGRESSIVE* progressive = context;
+
+	if (progressive_compress(progressive->encoder, src, stride * height, BENCH_FORMAT, width,
+	                         height, stride, NULL, &data, &size) < 0)
+		return FALSE;
+
+	if (!Stream_EnsureRemainingCapacity(s, size))
+		return FALSE;
+
+	Stream_Write(s, data, size);
+	return TRUE;
+}
+
+static BOOL bench_progressive_decode(void* context, const BYTE* data, size_t length, BYTE* dst,
+                                     UINT32 stride, UINT32 width, UINT32 height)
+{
+	INT32 rc;
+	REGION16 region;
+	BENCH_PROGRESSIVE* progressive = context;
+
+	WINPR_UNUSED(width);
+	WINPR_UNUSED(height);
+	region16_init(&region);
+	rc = progressive_decompress(progressive->decoder, data, (UINT32)length, dst, BENCH_FORMAT,
+	                            stride, 0, 0, &region, 0, progressive->frameId++);
+	region16_uninit(&region);
+	return rc >= 0;
+}
+
+/* ClearCodec, the library has no encoder so tiles are sent as residual runs -- */
+typedef struct
+{
+	CLEAR_CONTEXT* decoder;
+	BYTE seqNumber;
+} BENCH_CLEAR;
+
+static void bench_clear_free(void* context)
+{
+	BENCH_CLEAR* clear = context;
+
+	if (!clear)
+		return;
+
+	clear_context_free(clear->decoder);
+	free(clear);
+}
+
+static void* bench_clear_new(UINT32 width, UINT32 height)
+{
+	BENCH_CLEAR* clear = calloc(1, sizeof(BENCH_CLEAR));
+
+	WINPR_UNUSED(width);
+	WINPR_UNUSED(height);
+
+	if (!clear)
+		return NULL;
+
+	clear->decoder = clear_context_new(FALSE);
+
+	if (!clear->decoder)
+	{
+		bench_clear_free(clear);
+		return NULL;
+	}
+
+	return clear;
+}
+
+static BOOL bench_clear_encode_tile(void* context, const BYTE* src, UINT32 stride, UINT32 width,
+                                    UINT32 height, BYTE* dst, UINT32* size)
+{
+	UINT32 x, y;
+	UINT32 run = 0;
+	UINT32 color = 0;
+	BENCH_CLEAR* clear = context;
+	wStream sbuffer = { 0 };
+	wStream* s = &sbuffer;
+
+	Stream_StaticInit(s, dst, *size);
+	/* glyphFlags, seqNumber, residual, bands and subcodec byte counts */
+	Stream_Write_UINT8(s, 0);
+	Stream_Write_UINT8(s, clear->seqNumber++);
+	Stream_Seek(s, 12);
+
+	for (y = 0; y <= height; y++)
+	{
+		for (x = 0; x < width; x++)
+		{
+			const UINT32 pixel = (y < height) ? ReadColor(&src[y * stride + x * 4],
+			                                                     BENCH_FORMAT)
+			                                  : ~color;
+
+			if ((run > 0) && (pixel == color))
+			{
+				run++;
+				continue;
+			}
+
+			if (run > 0)
+			{
+				BYTE r, g, b;
+
+				if (Stream_GetRemainingCapacity(s) < 13)
+					return FALSE;
+
+				SplitColor(color, BENCH_FORMAT, &r, &g, &b, NULL, NULL);
+				Stream_Write_UINT8(s, b);
+				Stream_Write_UINT8(s, g);
+				Stream_Write_UINT8(s, r);
+
+				if (run < 0xFF)
+					Stream_Write_UINT8(s, (BYTE)run);
+				else
+				{
+					Stream_Write_UINT8(s, 0xFF);
+
+					if (run < 0xFFFF)
+						Stream_Write_UINT16(s, (UINT16)run);
+					else
+					{
+						Stream_Write_UINT16(s, 0xFFFF);
+						Stream_Write_UINT32(s, run);
+					}
+				}
+			}
+
+			if (y == height)
+				break;
+
+			color = pixel;
+			run = 1;
+		}
+	}
+
+	*size = (UINT32)Stream_GetPosition(s);
+	Stream_SetPosition(s, 2);
+	Stream_Write_UINT32(s, *size - 14);
+	Stream_Write_UINT32(s, 0);
+	Stream_Write_UINT32(s, 0);
+	return TRUE;
+}
+
+static BOOL bench_clear_decode_tile(void* context, const BYTE* data, UINT32 size, BYTE* dst,
+                                    UINT32 stride, UINT32 width, UINT32 height)
+{
+	BENCH_CLEAR* clear = context;
+	return clear_decompress(clear->decoder, data, size, width, height, dst, BENCH_FORMAT, stride,
+	                        0, 0, width, height, NULL) >= 0;
+}
+
+static BOOL bench_clear_encode(void* context, const BYTE* src, UINT32 stride, UINT32 width,
+                               UINT32 height, wStream* s)
+{
+	return bench_encode_tiles(context, bench_clear_encode_tile, src, stride, width, height, s);
+}
+
+static BOOL bench_clear_decode(void* context, const BYTE* data, size_t length, BYTE* dst,
+                               UINT32 stride, UINT32 width, UINT32 height)
+{
+	return bench_decode_tiles(context, bench_clear_decode_tile, data, length, dst, stride, width,
+	                          height);
+}
+
+/* AVC420, only if an H.264 backend with an encoder is available -------------- */
+typedef struct
+{
+	H264_CONTEXT* encoder;
+	H264_CONTEXT* decoder;
+} BENCH_AVC420;
+
+static void bench_avc420_free(void* context)
+{
+	BENCH_AVC420* avc = context;
+
+	if (!avc)
+		return;
+
+	h264_context_free(avc->encoder);
+	h264_context_free(avc->decoder);
+	free(avc);
+}
+
+static void* bench_avc420_new(UINT32 width, UINT32 height)
+{
+	BENCH_AVC420* avc = calloc(1, sizeof(BENCH_AVC420));
+
+	if (!avc)
+		return NULL;
+
+	avc->encoder = h264_context_new(TRUE);
+	avc->decoder = h264_context_new(FALSE);
+
+	if (!avc->encoder || !avc->decoder || !h264_context_reset(avc->encoder, width, height) ||
+	    !h264_context_reset(avc->decoder, width, height))
+	{
+		bench_avc420_free(avc);
+		return NULL;
+	}
+
+	return avc;
+}
+
+static BOOL bench_avc420_encode(void* context, const BYTE* src, UINT32 stride, UINT32 width,
+                                UINT32 height, wStream* s)
+{
+	INT32 rc;
+	BYTE* data = NULL;
+	UINT32 size = 0;
+	RDPGFX_H264_METABLOCK meta = { 0 };
+	BENCH_AVC420* avc = context;
+	const RECTANGLE_16 rect = { 0, 0, (UINT16)width, (UINT16)height };
+
+	rc = avc420_compress(avc->encoder, src, BENCH_FORMAT, stride, width, height, &rect, &data,
+	                     &size, &meta);
+	free_h264_metablock(&meta);
+
+	if ((rc < 0) || !Stream_EnsureRemainingCapacity(s, size))
+		return FALSE;
+
+	Stream_Write(s, data, size);
+	return TRUE;
+}
+
+static BOOL bench_avc420_decode(void* context, const BYTE* data, size_t length, BYTE* dst,
+                                UINT32 stride, UINT32 width, UINT32 height)
+{
+	BENCH_AVC420* avc = context;
+	const RECTANGLE_16 rect = { 0, 0, (UINT16)width, (UINT16)height };
+	return avc420_decompress(avc->decoder, data, (UINT32)length, dst, BENCH_FORMAT, stride, width,
+	                         height, &rect, 1) >= 0;
+}
+
+static const BENCH_CODEC codecs[] = {
+	{ "rfx", bench_rfx_new, bench_rfx_free, bench_rfx_encode, bench_rfx_decode, FALSE },
+	{ "nsc", bench_nsc_new, bench_nsc_free, bench_nsc_encode, bench_nsc_decode, FALSE },
+	{ "planar", bench_planar_new, bench_planar_free, bench_planar_encode, bench_planar_decode,
+	  FALSE },
+	{ "interleaved", bench_interleaved_new, bench_interleaved_free, bench_interleaved_encode,
+	  bench_interleaved_decode, FALSE },
+	{ "progressive", bench_progressive_new, bench_progressive_free, bench_progressive_encode,
+	  bench_progressive_decode, FALSE },
+	{ "clear", bench_clear_new, bench_clear_free, bench_clear_encode, bench_clear_decode, TRUE },
+	{ "avc420", bench_avc420_new, bench_avc420_free, bench_avc420_encode, bench_avc420_decode,
+	  FALSE }
+};
+
+static void bench_compare(BENCH_RESULT* result, const BENCH_CORPUS* corpus, const BYTE* src,
+                          const BYTE* dst)
+{
+	UINT32 x, y;
+
+	for (y = 0; y < corpus->height; y++)
+	{
+		for (x = 0; x < corpus->width; x++)
+		{
+			BYTE r[2], g[2], b[2];
+			const size_t offset = 1ull * y * corpus->stride + x * 4ull;
+			SplitColor(ReadColor(&src[offset], BENCH_FORMAT), BENCH_FORMAT, &r[0],
+			                  &g[0], &b[0], NULL, NULL);
+			SplitColor(ReadColor(&dst[offset], BENCH_FORMAT), BENCH_FORMAT, &r[1],
+			                  &g[1], &b[1], NULL, NULL);
+			result->squaredError += (r[0] - r[1]) * (r[0] - r[1]) +
+			                        (g[0] - g[1]) * (g[0] - g[1]) + (b[0] - b[1]) * (b[0] - b[1]);
+		}
+	}
+
+	result->samples += 3ull * corpus->width * corpus->height;
+}
+
+/* Encodes and decodes every frame of the corpus, the error is taken from the last pass */
+static BOOL bench_run(const BENCH_CODEC* codec, void* context, const BENCH_CORPUS* corpus,
+                      UINT32 iterations, BENCH_RESULT* result)
+{
+	UINT32 i, frame;
+	BOOL rc = FALSE;
+	const size_t frameSize = 1ull * corpus->stride * corpus->height;
+	const UINT64 tiles = 1ull * ((corpus->width + BENCH_TILE - 1) / BENCH_TILE) *
+	                     ((corpus->height + BENCH_TILE - 1) / BENCH_TILE);
+	wStream* s = Stream_New(NULL, frameSize);
+	BYTE* dst = _aligned_malloc(frameSize, 16);
+
+	if (!s || !dst)
+		goto fail;
+
+	for (i = 0; i < iterations; i++)
+	{
+		for (frame = 0; frame < corpus->frameCount; frame++)
+		{
+			const BYTE* src = corpus->frames[frame];
+			UINT64 start;
+
+			Stream_SetPosition(s, 0);
+			start = bench_time_ns();
+
+			if (!codec->encode(context, src, corpus->stride, corpus->width, corpus->height, s))
+				goto fail;
+
+			result->encodeTime += bench_time_ns() - start;
+			memset(dst, 0, frameSize);
+			start = bench_time_ns();
+
+			if (!codec->decode(context, Stream_Buffer(s), Stream_GetPosition(s), dst,
+			                   corpus->stride, corpus->width, corpus->height))
+				goto fail;
+
+			result->decodeTime += bench_time_ns() - start;
+			result->rawBytes += frameSize;
+			result->encodedBytes += Stream_GetPosition(s);
+			result->tiles += tiles;
+
+			if (i + 1 == iterations)
+				bench_compare(result, corpus, src, dst);
+		}
+	}
+
+	rc = TRUE;
+fail:
+	Stream_Free(s, TRUE);
+	_aligned_free(dst);
+	return rc;
+}
+
+static double bench_rate(UINT64 amount, UINT64 ns)
+{
+	return (ns > 0) ? (double)amount * 1000000000.0 / (double)ns : 0.0;
+}
+
+static void bench_print_result(FILE* fp, const BENCH_CODEC* codec, const BENCH_CORPUS* corpus,
+                               const BENCH_RESULT* result, BOOL first)
+{
+	const double mse = (result->samples > 0) ? result->squaredError / result->samples : 0.0;
+
+	fprintf(fp, "%s\n    { \"codec\": \"%s\", \"corpus\": \"%s\", \"frames\": %" PRIu32 ", ",
+	        first ? "" : ",", codec->name, corpus->name, corpus->frameCount);
+
+	if (codec->decodeOnly)
+		fprintf(fp, "\"encode_mbps\": null, \"encode_tiles_per_sec\": null, ");
+	else
+		fprintf(fp, "\"encode_mbps\": %.2f, \"encode_tiles_per_sec\": %.1f, ",
+		        bench_rate(result->rawBytes, result->encodeTime) / 1000000.0,
+		        bench_rate(result->tiles, result->encodeTime));
+
+	fprintf(fp, "\"decode_mbps\": %.2f, \"decode_tiles_per_sec\": %.1f, ",
+	        bench_rate(result->rawBytes, result->decodeTime) / 1000000.0,
+	        bench_rate(result->tiles, result->decodeTime));
+	fprintf(fp, "\"ratio\": %.3f, ",
+	        (result->encodedBytes > 0) ? (double)result->rawBytes / result->encodedBytes : 0.0);
+
+	/* identical output has no finite PSNR */
+	if (mse > 0.0)
+		fprintf(fp, "\"psnr\": %.3f, \"lossless\": false }", 10.0 * log10(255.0 * 255.0 / mse));
+	else
+		fprintf(fp, "\"psnr\": null, \"lossless\": true }");
+}
+
+static WINPR_NORETURN(void usage_and_exit(void))
+{
+	size_t i;
+
+	printf("freerdp-codec-bench: codec benchmark on a synthetic corpus\n");
+	printf("Usage: freerdp-codec-bench [-w <width>] [-h <height>] [-f <scroll frames>] "
+	       "[-n <iterations>] [-s <seed>] [-c <codec>] [-o <file>]\n");
+	printf("Codecs:");
+
+	for (i = 0; i < ARRAYSIZE(codecs); i++)
+		printf(" %s", codecs[i].name);
+
+	printf("\n");
+	exit(1);
+}
+
+static UINT32 parse_uint(int argc, char* argv[], int index, const char* what, UINT32 min,
+                         UINT32 max)
+{
+	unsigned long value;
+	char* end = NULL;
+
+	if (index == argc)
+	{
+		printf("missing %s\n\n", what);
+		usage_and_exit();
+	}
+
+	errno = 0;
+	value = strtoul(argv[index], &end, 0);
+
+	if ((errno != 0) || !end || (*end != '\0') || (value < min) || (value > max))
+	{
+		printf("invalid %s %s\n\n", what, argv[index]);
+		usage_and_exit();
+	}
+
+	return (UINT32)value;
+}
+
+int main(int argc, char* argv[])
+{
+	int rc = 1;
+	int index = 1;
+	size_t i, j;
+	BOOL first = TRUE;
+	UINT32 width = 1024;
+	UINT32 height = 768;
+	UINT32 frames = 16;
+	UINT32 iterations = 3;
+	UINT32 seed = 1;
+	const char* filter = NULL;
+	const char* output = NULL;
+	FILE* fp = stdout;
+	wLog* root;
+	BENCH_CORPUS corpus[4] = { 0 };
+	size_t skippedCount = 0;
+	struct
+	{
+		const char* codec;
+		const char* reason;
+	} skipped[ARRAYSIZE(codecs)] = { 0 };
+
+	while (index < argc)
+	{
+		if (strcmp("-w", argv[index]) == 0)
+			width = parse_uint(argc, argv, ++index, "width", 64, 4096);
+		else if (strcmp("-h", argv[index]) == 0)
+			height = parse_uint(argc, argv, ++index, "height", 64, 4096);
+		else if (strcmp("-f", argv[index]) == 0)
+			frames = parse_uint(argc, argv, ++index, "frame count", 1, 1024);
+		else if (strcmp("-n", argv[index]) == 0)
+			iterations = parse_uint(argc, argv, ++index, "iteration count", 1, 100000);
+		else if (strcmp("-s", argv[index]) == 0)
+			seed = parse_uint(argc, argv, ++index, "seed", 0, UINT32_MAX);
+		else if (strcmp("-c", argv[index]) == 0)
+		{
+			if (++index == argc)
+			{
+				printf("missing codec\n\n");
+				usage_and_exit();
+			}
+
+			filter = argv[index];
+		}
+		else if (strcmp("-o", argv[index]) == 0)
+		{
+			if (++index == argc)
+			{
+				printf("missing output file\n\n");
+				usage_and_exit();
+			}
+
+			output = argv[index];
+		}
+		else
+			usage_and_exit();
+
+		index++;
+	}
+
+	/* interleaved tiles must be a multiple of 4 pixels wide, AVC420 needs even sizes */
+	if ((width % 4) || (height % 2))
+	{
+		printf("width must be a multiple of 4 and height a multiple of 2\n\n");
+		usage_and_exit();
+	}
+
+	/* Keep stdout for the report */
+	root = WLog_GetRoot();
+
+	if (!WLog_SetLogAppenderType(root, WLOG_APPENDER_CONSOLE) ||
+	    !WLog_ConfigureAppender(WLog_GetLogAppender(root), "outputstream", (void*)"stderr"))
+		return 1;
+
+	if (output && !(fp = fopen(output, "w")))
+	{
+		fprintf(stderr, "failed to open %s\n", output);
+		return 1;
+	}
+
+	if (!bench_corpus_init(corpus, width, height, frames, seed))
+	{
+		fprintf(stderr, "failed to generate the corpus\n");
+		goto fail;
+	}
+
+	rc = 0;
+	fprintf(fp, "{\n  \"width\": %" PRIu32 ",\n  \"height\": %" PRIu32 ",\n", width, height);
+	fprintf(fp, "  \"seed\": %" PRIu32 ",\n  \"iterations\": %" PRIu32 ",\n", seed, iterations);
+	fprintf(fp, "  \"results\": [");
+
+	for (i = 0; i < ARRAYSIZE(codecs); i++)
+	{
+		const BENCH_CODEC* codec = &codecs[i];
+
+		if (filter && (strcmp(filter, codec->name) != 0))
+			continue;
+
+		for (j = 0; j < ARRAYSIZE(corpus); j++)
+		{
+			BENCH_RESULT result = { 0 };
+			void* context = codec->create(width, height);
+
+			if (!context)
+			{
+				skipped[skippedCount].codec = codec->name;
+				skipped[skippedCount++].reason = "not available in this build";
+				break;
+			}
+
+			if (!bench_run(codec, context, &corpus[j], iterations, &result))
+			{
+				fprintf(stderr, "%s failed on %s\n", codec->name, corpus[j].name);
+				rc = 1;
+			}
+			else
+			{
+				bench_print_result(fp, codec, &corpus[j], &result, first);
+				first = FALSE;
+			}
+
+			codec->free(context);
+		}
+	}
+
+	fprintf(fp, "\n  ],\n  \"skipped\": [");
+
+	for (i = 0; i < skippedCount; i++)
+		fprintf(fp, "%s\n    { \"codec\": \"%s\", \"reason\": \"%s\" }", (i > 0) ? "," : "",
+		        skipped[i].codec, skipped[i].reason);
+
+	fprintf(fp, "\n  ]\n}\n");
+fail:
+	for (j = 0; j < ARRAYSIZE(corpus); j++)
+		bench_corpus_free(&corpus[j]);
+
+	if (fp != stdout)
+		fclose(fp);
+
+	return rc;
+}
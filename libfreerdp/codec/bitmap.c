@@ -182,7 +182,7 @@ static INLINE UINT16 out_copy_count_3(UINT16 in_count, wStream* in_s, wStream* i
 			Stream_Write_UINT16(in_s, in_count);
 		}
 
-		Stream_Write(in_s, Stream_Pointer(in_data), in_count * 3);
+		Stream_Write(in_s, Stream_Buffer(in_data), in_count * 3);
 	}
 
 	Stream_SetPosition(in_data, 0);
@@ -561,7 +561,10 @@ static SSIZE_T freerdp_bitmap_compress_24(const void* srcData, UINT32 width, UIN
 				    bicolor_count >= color_count && bicolor_count >= mix_count &&
 				    bicolor_count >= fom_count)
 				{
-					if ((bicolor_count % 2) != 0)
+					/* An odd run leaves its first pixel to the copy, the rest starts at bicolor2 */
+					const BOOL swap = (bicolor_count % 2) != 0;
+
+					if (swap)
 						bicolor_count--;
 
 					if (bicolor_count > count)
@@ -569,7 +572,8 @@ static SSIZE_T freerdp_bitmap_compress_24(const void* srcData, UINT32 width, UIN
 
 					count -= bicolor_count;
 					OUT_COPY_COUNT3(count, s, temp_s);
-					OUT_BICOLOR_COUNT3(bicolor_count, s, bicolor2, bicolor1);
+					OUT_BICOLOR_COUNT3(bicolor_count, s, swap ? bicolor2 : bicolor1,
+					                   swap ? bicolor1 : bicolor2);
 					RESET_COUNTS;
 				}
 
@@ -730,7 +734,9 @@ static SSIZE_T freerdp_bitmap_compress_24(const void* srcData, UINT32 width, UIN
 	else if (bicolor_count > 3 && bicolor_count >= mix_count && bicolor_count >= color_count &&
 	         bicolor_count >= fill_count && bicolor_count >= fom_count)
 	{
-		if ((bicolor_count % 2) != 0)
+		const BOOL swap = (bicolor_count % 2) != 0;
+
+		if (swap)
 			bicolor_count--;
 
 		if (bicolor_count > count)
@@ -738,7 +744,8 @@ static SSIZE_T freerdp_bitmap_compress_24(const void* srcData, UINT32 width, UIN
 
 		count -= bicolor_count;
 		OUT_COPY_COUNT3(count, s, temp_s);
-		OUT_BICOLOR_COUNT3(bicolor_count, s, bicolor2, bicolor1);
+		OUT_BICOLOR_COUNT3(bicolor_count, s, swap ? bicolor2 : bicolor1,
+		                   swap ? bicolor1 : bicolor2);
 
 		if (bicolor_count > count)
 			return -1;
@@ -867,7 +874,9 @@ static SSIZE_T freerdp_bitmap_compress_16(const void* srcData, UINT32 width, UIN
 				    (bicolor_count >= color_count) && (bicolor_count >= mix_count) &&
 				    (bicolor_count >= fom_count))
 				{
-					if ((bicolor_count % 2) != 0)
+					const BOOL swap = (bicolor_count % 2) != 0;
+
+					if (swap)
 						bicolor_count--;
 
 					if (bicolor_count > count)
@@ -875,7 +884,8 @@ static SSIZE_T freerdp_bitmap_compress_16(const void* srcData, UINT32 width, UIN
 
 					count -= bicolor_count;
 					OUT_COPY_COUNT2(count, s, temp_s);
-					OUT_BICOLOR_COUNT2(bicolor_count, s, bicolor2, bicolor1);
+					OUT_BICOLOR_COUNT2(bicolor_count, s, swap ? bicolor2 : bicolor1,
+					                   swap ? bicolor1 : bicolor2);
 					RESET_COUNTS;
 				}
 
@@ -1034,7 +1044,9 @@ static SSIZE_T freerdp_bitmap_compress_16(const void* srcData, UINT32 width, UIN
 	else if (bicolor_count > 3 && bicolor_count >= mix_count && bicolor_count >= color_count &&
 	         bicolor_count >= fill_count && bicolor_count >= fom_count)
 	{
-		if ((bicolor_count % 2) != 0)
+		const BOOL swap = (bicolor_count % 2) != 0;
+
+		if (swap)
 			bicolor_count--;
 
 		if (bicolor_count > count)
@@ -1042,7 +1054,8 @@ static SSIZE_T freerdp_bitmap_compress_16(const void* srcData, UINT32 width, UIN
 
 		count -= bicolor_count;
 		OUT_COPY_COUNT2(count, s, temp_s);
-		OUT_BICOLOR_COUNT2(bicolor_count, s, bicolor2, bicolor1);
+		OUT_BICOLOR_COUNT2(bicolor_count, s, swap ? bicolor2 : bicolor1,
+		                   swap ? bicolor1 : bicolor2);
 
 		if (bicolor_count > count)
 			return -1;
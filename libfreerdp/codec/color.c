@@ -696,6 +696,21 @@ BOOL freerdp_image_copy(BYTE* pDstData, DWORD DstFormat, UINT32 nDstStep, UINT32
 	{
 		UINT32 x, y;
 
+		if (!overlapping(pDstData, nXDst, nYDst, nDstStep, dstByte, pSrcData, nXSrc, nYSrc,
+		                 nSrcStep, srcByte, nWidth, nHeight))
+		{
+			/* Table driven row kernels for the common RGB formats */
+			const primitives_t* prims = primitives_get();
+			const BYTE* srcLine = &pSrcData[nYSrc * nSrcStep * srcVMultiplier + srcVOffset];
+			BYTE* dstLine = &pDstData[nYDst * nDstStep * dstVMultiplier + dstVOffset];
+
+			if (prims->copy_convert_8u(&srcLine[xSrcOffset], SrcFormat,
+			                           (INT32)nSrcStep * srcVMultiplier, &dstLine[xDstOffset],
+			                           DstFormat, (INT32)nDstStep * dstVMultiplier, nWidth,
+			                           nHeight) == PRIMITIVES_SUCCESS)
+				return TRUE;
+		}
+
 		for (y = 0; y < nHeight; y++)
 		{
 			const BYTE* srcLine = &pSrcData[(y + nYSrc) * nSrcStep * srcVMultiplier + srcVOffset];
@@ -771,6 +786,36 @@ static int av_format_for_buffer(UINT32 format)
 }
 #endif
 
+/* Scales in the source pixel layout and swizzles the result in place if required */
+static BOOL freerdp_image_scale_builtin(BYTE* pDstData, DWORD DstFormat, UINT32 nDstStep,
+                                        UINT32 nXDst, UINT32 nYDst, UINT32 nDstWidth,
+                                        UINT32 nDstHeight, const BYTE* pSrcData, DWORD SrcFormat,
+                                        UINT32 nSrcStep, UINT32 nXSrc, UINT32 nYSrc,
+                                        UINT32 nSrcWidth, UINT32 nSrcHeight)
+{
+	const primitives_t* prims = primitives_get();
+	const BYTE* src = &pSrcData[nXSrc * 4ull + nYSrc * 1ull * nSrcStep];
+	BYTE* dst = &pDstData[nXDst * 4ull + nYDst * 1ull * nDstStep];
+
+	if ((nSrcStep > INT32_MAX) || (nDstStep > INT32_MAX))
+		return FALSE;
+
+	if (prims->scale_8u_C4R(src, (INT32)nSrcStep, nSrcWidth, nSrcHeight, dst, (INT32)nDstStep,
+	                        nDstWidth, nDstHeight) != PRIMITIVES_SUCCESS)
+		return FALSE;
+
+	if (AreColorFormatsEqualNoAlpha(SrcFormat, DstFormat))
+		return TRUE;
+
+	if (prims->copy_convert_8u(dst, SrcFormat, (INT32)nDstStep, dst, DstFormat, (INT32)nDstStep,
+	                           nDstWidth, nDstHeight) == PRIMITIVES_SUCCESS)
+		return TRUE;
+
+	return freerdp_image_copy(pDstData, DstFormat, nDstStep, nXDst, nYDst, nDstWidth, nDstHeight,
+	                          pDstData, SrcFormat, nDstStep, nXDst, nYDst, NULL,
+	                          FREERDP_FLIP_NONE);
+}
+
 BOOL freerdp_image_scale(BYTE* pDstData, DWORD DstFormat, UINT32 nDstStep, UINT32 nXDst,
                          UINT32 nYDst, UINT32 nDstWidth, UINT32 nDstHeight, const BYTE* pSrcData,
                          DWORD SrcFormat, UINT32 nSrcStep, UINT32 nXSrc, UINT32 nYSrc,
@@ -796,6 +841,12 @@ BOOL freerdp_image_scale(BYTE* pDstData, DWORD DstFormat, UINT32 nDstStep, UINT3
 		                          nDstHeight, pSrcData, SrcFormat, nSrcStep, nXSrc, nYSrc, NULL,
 		                          FREERDP_FLIP_NONE);
 	}
+	else if ((GetBitsPerPixel(SrcFormat) == 32) && (GetBitsPerPixel(DstFormat) == 32))
+	{
+		return freerdp_image_scale_builtin(pDstData, DstFormat, nDstStep, nXDst, nYDst, nDstWidth,
+		                                   nDstHeight, pSrcData, SrcFormat, nSrcStep, nXSrc,
+		                                   nYSrc, nSrcWidth, nSrcHeight);
+	}
 	else
 #if defined(SWSCALE_FOUND)
 	{
@@ -860,7 +911,8 @@ BOOL freerdp_image_scale(BYTE* pDstData, DWORD DstFormat, UINT32 nDstStep, UINT3
 	}
 #else
 	{
-		WLog_WARN(TAG, "SmartScaling requested but compiled without libcairo support!");
+		WLog_WARN(TAG, "Scaling %s to %s requires libswscale or libcairo support!",
+		          FreeRDPGetColorFormatName(SrcFormat), FreeRDPGetColorFormatName(DstFormat));
 	}
 #endif
 	return rc;
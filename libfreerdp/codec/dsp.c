@@ -49,10 +49,21 @@
 #include <faac.h>
 #endif
 
+#if defined(WITH_OPUS)
+#include <opus/opus.h>
+
+/* Opus packets are framed with a 16 bit little endian length, 20ms per packet */
+#define OPUS_FRAMES_PER_SECOND 50
+#define OPUS_MAX_PACKET_SIZE 4000
+#define OPUS_MAX_FRAME_MS 120
+#endif
+
 #if defined(WITH_SOXR)
 #include <soxr.h>
 #endif
 
+#include "dsp_resample.h"
+
 #else
 #include "dsp_ffmpeg.h"
 #endif
@@ -107,8 +118,19 @@ struct _FREERDP_DSP_CONTEXT
 	unsigned long faacMaxOutputBytes;
 #endif
 
+#if defined(WITH_OPUS)
+	OpusEncoder* opusEncoder;
+	OpusDecoder* opusDecoder;
+	UINT32 opusFrameSize;
+#endif
+
+	UINT32 bitrate;
+	UINT32 complexity;
+
 #if defined(WITH_SOXR)
 	soxr_t sox;
+#else
+	FREERDP_DSP_RESAMPLER* resampler;
 #endif
 };
 
@@ -158,6 +180,17 @@ static BOOL freerdp_dsp_channel_mix(FREERDP_DSP_CONTEXT* context, const BYTE* sr
 				if (!Stream_EnsureCapacity(context->channelmix, size * 2))
 					return FALSE;
 
+				if ((bpp == 2) && (context->format.nChannels == 2))
+				{
+					const FREERDP_DSP_KERNELS* kernels = freerdp_dsp_get_kernels();
+					kernels->mono_to_stereo(src, Stream_Buffer(context->channelmix), samples);
+					Stream_SetPosition(context->channelmix, samples * 4);
+					Stream_SealLength(context->channelmix);
+					*data = Stream_Buffer(context->channelmix);
+					*length = Stream_Length(context->channelmix);
+					return TRUE;
+				}
+
 				for (x = 0; x < samples; x++)
 				{
 					for (y = 0; y < bpp; y++)
@@ -185,14 +218,21 @@ static BOOL freerdp_dsp_channel_mix(FREERDP_DSP_CONTEXT* context, const BYTE* sr
 			if (!Stream_EnsureCapacity(context->channelmix, size / 2))
 				return FALSE;
 
-			/* Simply drop second channel.
-			 * TODO: Calculate average */
-			for (x = 0; x < samples; x++)
+			if (bpp == 2)
 			{
-				for (y = 0; y < bpp; y++)
-					Stream_Write_UINT8(context->channelmix, src[2 * x * bpp + y]);
+				const FREERDP_DSP_KERNELS* kernels = freerdp_dsp_get_kernels();
+				kernels->stereo_to_mono(src, Stream_Buffer(context->channelmix), samples);
+				Stream_SetPosition(context->channelmix, samples * 2);
+				Stream_SealLength(context->channelmix);
+				*data = Stream_Buffer(context->channelmix);
+				*length = Stream_Length(context->channelmix);
+				return TRUE;
 			}
 
+			/* 8 bit samples are unsigned, average both channels */
+			for (x = 0; x < samples; x++)
+				Stream_Write_UINT8(context->channelmix, (BYTE)((src[2 * x] + src[2 * x + 1]) / 2));
+
 			Stream_SealLength(context->channelmix);
 			*data = Stream_Buffer(context->channelmix);
 			*length = Stream_Length(context->channelmix);
@@ -268,11 +308,209 @@ static BOOL freerdp_dsp_resample(FREERDP_DSP_CONTEXT* context, const BYTE* src,
 	*length = Stream_Length(context->resample);
 	return (error == 0) ? TRUE : FALSE;
 #else
-	WLog_ERR(TAG, "Missing resample support, recompile -DWITH_SOXR=ON or -DWITH_DSP_FFMPEG=ON");
-	return FALSE;
+	if ((srcBytesPerFrame != 2) || (srcChannels != dstChannels))
+	{
+		WLog_ERR(TAG, "Built-in resampler requires 16 bit samples with matching channel count");
+		return FALSE;
+	}
+
+	if (!freerdp_dsp_resampler_matches(context->resampler, srcFormat->nSamplesPerSec,
+	                                   context->format.nSamplesPerSec, dstChannels))
+	{
+		freerdp_dsp_resampler_free(context->resampler);
+		context->resampler = freerdp_dsp_resampler_new(
+		    srcFormat->nSamplesPerSec, context->format.nSamplesPerSec, (UINT32)dstChannels);
+
+		if (!context->resampler)
+			return FALSE;
+	}
+
+	Stream_SetPosition(context->resample, 0);
+
+	if (!freerdp_dsp_resampler_process(context->resampler, src, size / (2 * srcChannels),
+	                                   context->resample))
+		return FALSE;
+
+	Stream_SealLength(context->resample);
+	*data = Stream_Buffer(context->resample);
+	*length = Stream_Length(context->resample);
+	return TRUE;
 #endif
 }
 
+#if defined(WITH_OPUS)
+static BOOL freerdp_dsp_encode_opus(FREERDP_DSP_CONTEXT* context, const BYTE* src, size_t size,
+                                    wStream* out)
+{
+	size_t x;
+	size_t frameBytes;
+
+	if (!context || !src || !out || !context->opusEncoder)
+		return FALSE;
+
+	frameBytes = context->opusFrameSize * context->format.nChannels * sizeof(INT16);
+
+	if (!Stream_EnsureRemainingCapacity(context->buffer, frameBytes))
+		return FALSE;
+
+	for (x = 0; x < size;)
+	{
+		const size_t missing = frameBytes - Stream_GetPosition(context->buffer);
+		const size_t count = MIN(missing, size - x);
+		Stream_Write(context->buffer, &src[x], count);
+		x += count;
+
+		if (Stream_GetPosition(context->buffer) == frameBytes)
+		{
+			opus_int32 rc;
+
+			if (!Stream_EnsureRemainingCapacity(out, OPUS_MAX_PACKET_SIZE + 2))
+				return FALSE;
+
+			rc = opus_encode(context->opusEncoder,
+			                 (const opus_int16*)Stream_Buffer(context->buffer),
+			                 (int)context->opusFrameSize, Stream_Pointer(out) + 2,
+			                 OPUS_MAX_PACKET_SIZE);
+
+			if (rc < 0)
+			{
+				WLog_ERR(TAG, "opus_encode failed with %s", opus_strerror(rc));
+				return FALSE;
+			}
+
+			Stream_Write_UINT16(out, (UINT16)rc);
+			Stream_Seek(out, (size_t)rc);
+			Stream_SetPosition(context->buffer, 0);
+		}
+	}
+
+	return TRUE;
+}
+
+static BOOL freerdp_dsp_decode_opus(FREERDP_DSP_CONTEXT* context, const BYTE* src, size_t size,
+                                    wStream* out)
+{
+	size_t offset = 0;
+	size_t maxFrames;
+
+	if (!context || !src || !out || !context->opusDecoder)
+		return FALSE;
+
+	maxFrames = context->format.nSamplesPerSec * OPUS_MAX_FRAME_MS / 1000;
+
+	while (offset + 2 <= size)
+	{
+		int rc;
+		const UINT16 length = (UINT16)(src[offset] | (src[offset + 1] << 8));
+		offset += 2;
+
+		if (offset + length > size)
+			return FALSE;
+
+		if (!Stream_EnsureRemainingCapacity(out,
+		                                    maxFrames * context->format.nChannels * sizeof(INT16)))
+			return FALSE;
+
+		rc = opus_decode(context->opusDecoder, &src[offset], length,
+		                 (opus_int16*)Stream_Pointer(out), (int)maxFrames, 0);
+
+		if (rc < 0)
+		{
+			WLog_ERR(TAG, "opus_decode failed with %s", opus_strerror(rc));
+			return FALSE;
+		}
+
+		Stream_Seek(out, (size_t)rc * context->format.nChannels * sizeof(INT16));
+		offset += length;
+	}
+
+	return offset == size;
+}
+
+static BOOL freerdp_dsp_opus_supported(const AUDIO_FORMAT* format)
+{
+	if ((format->nChannels < 1) || (format->nChannels > 2))
+		return FALSE;
+
+	switch (format->nSamplesPerSec)
+	{
+		case 8000:
+		case 12000:
+		case 16000:
+		case 24000:
+		case 48000:
+			return TRUE;
+
+		default:
+			return FALSE;
+	}
+}
+
+static BOOL freerdp_dsp_opus_apply_options(FREERDP_DSP_CONTEXT* context)
+{
+	int rc;
+	opus_int32 bitrate = OPUS_AUTO;
+
+	if (!context->opusEncoder)
+		return TRUE;
+
+	if (context->bitrate > 0)
+		bitrate = (opus_int32)context->bitrate;
+	else if (context->format.nAvgBytesPerSec > 0)
+		bitrate = (opus_int32)context->format.nAvgBytesPerSec * 8;
+
+	rc = opus_encoder_ctl(context->opusEncoder, OPUS_SET_BITRATE(bitrate));
+
+	if (rc != OPUS_OK)
+		return FALSE;
+
+	rc = opus_encoder_ctl(context->opusEncoder,
+	                      OPUS_SET_COMPLEXITY((opus_int32)MIN(context->complexity, 10)));
+	return rc == OPUS_OK;
+}
+
+static void freerdp_dsp_opus_free(FREERDP_DSP_CONTEXT* context)
+{
+	if (context->opusEncoder)
+		opus_encoder_destroy(context->opusEncoder);
+
+	if (context->opusDecoder)
+		opus_decoder_destroy(context->opusDecoder);
+
+	context->opusEncoder = NULL;
+	context->opusDecoder = NULL;
+}
+
+static BOOL freerdp_dsp_opus_reset(FREERDP_DSP_CONTEXT* context)
+{
+	int error = OPUS_OK;
+	const opus_int32 rate = (opus_int32)context->format.nSamplesPerSec;
+	const int channels = context->format.nChannels;
+
+	freerdp_dsp_opus_free(context);
+
+	if (!freerdp_dsp_opus_supported(&context->format))
+		return FALSE;
+
+	context->opusFrameSize = context->format.nSamplesPerSec / OPUS_FRAMES_PER_SECOND;
+	Stream_SetPosition(context->buffer, 0);
+
+	if (context->encoder)
+	{
+		context->opusEncoder =
+		    opus_encoder_create(rate, channels, OPUS_APPLICATION_AUDIO, &error);
+
+		if (!context->opusEncoder || (error != OPUS_OK))
+			return FALSE;
+
+		return freerdp_dsp_opus_apply_options(context);
+	}
+
+	context->opusDecoder = opus_decoder_create(rate, channels, &error);
+	return context->opusDecoder && (error == OPUS_OK);
+}
+#endif
+
 /**
  * Microsoft IMA ADPCM specification:
  *
@@ -1051,6 +1289,7 @@ FREERDP_DSP_CONTEXT* freerdp_dsp_context_new(BOOL encoder)
 		goto fail;
 
 	context->encoder = encoder;
+	context->complexity = 10;
 #if defined(WITH_GSM)
 	context->gsm = gsm_create();
 
@@ -1136,8 +1375,13 @@ void freerdp_dsp_context_free(FREERDP_DSP_CONTEXT* context)
 			faacEncClose(context->faac);
 
 #endif
+#if defined(WITH_OPUS)
+		freerdp_dsp_opus_free(context);
+#endif
 #if defined(WITH_SOXR)
 		soxr_delete(context->sox);
+#else
+		freerdp_dsp_resampler_free(context->resampler);
 #endif
 		free(context);
 	}
@@ -1197,6 +1441,11 @@ BOOL freerdp_dsp_encode(FREERDP_DSP_CONTEXT* context, const AUDIO_FORMAT* srcFor
 		case WAVE_FORMAT_AAC_MS:
 			return freerdp_dsp_encode_faac(context, data, length, out);
 #endif
+#if defined(WITH_OPUS)
+
+		case WAVE_FORMAT_OPUS:
+			return freerdp_dsp_encode_opus(context, data, length, out);
+#endif
 
 		default:
 			return FALSE;
@@ -1245,6 +1494,11 @@ BOOL freerdp_dsp_decode(FREERDP_DSP_CONTEXT* context, const AUDIO_FORMAT* srcFor
 		case WAVE_FORMAT_AAC_MS:
 			return freerdp_dsp_decode_faad(context, data, length, out);
 #endif
+#if defined(WITH_OPUS)
+
+		case WAVE_FORMAT_OPUS:
+			return freerdp_dsp_decode_opus(context, data, length, out);
+#endif
 
 		default:
 			return FALSE;
@@ -1304,6 +1558,12 @@ BOOL freerdp_dsp_supports_format(const AUDIO_FORMAT* format, BOOL encode)
 			if (encode)
 				return TRUE;
 
+#endif
+			return FALSE;
+#if defined(WITH_OPUS)
+
+		case WAVE_FORMAT_OPUS:
+			return freerdp_dsp_opus_supported(format);
 #endif
 
 		default:
@@ -1344,6 +1604,15 @@ BOOL freerdp_dsp_context_reset(FREERDP_DSP_CONTEXT* context, const AUDIO_FORMAT*
 #if defined(WITH_FAAD2)
 	context->faadSetup = FALSE;
 #endif
+#if defined(WITH_OPUS)
+
+	if (context->format.wFormatTag == WAVE_FORMAT_OPUS)
+	{
+		if (!freerdp_dsp_opus_reset(context))
+			return FALSE;
+	}
+
+#endif
 #if defined(WITH_FAAC)
 
 	if (context->encoder)
@@ -1380,7 +1649,48 @@ BOOL freerdp_dsp_context_reset(FREERDP_DSP_CONTEXT* context, const AUDIO_FORMAT*
 		if (!context->sox || (error != 0))
 			return FALSE;
 	}
+#else
+	freerdp_dsp_resampler_free(context->resampler);
+	context->resampler = NULL;
 #endif
 	return TRUE;
 #endif
 }
+
+BOOL freerdp_dsp_context_set_option(FREERDP_DSP_CONTEXT* context, FREERDP_DSP_OPTION option,
+                                    UINT32 value)
+{
+#if defined(WITH_DSP_FFMPEG)
+	WINPR_UNUSED(context);
+	WINPR_UNUSED(option);
+	WINPR_UNUSED(value);
+	return FALSE;
+#else
+
+	if (!context)
+		return FALSE;
+
+	switch (option)
+	{
+		case FREERDP_DSP_OPTION_BITRATE:
+			context->bitrate = value;
+			break;
+
+		case FREERDP_DSP_OPTION_COMPLEXITY:
+			if (value > 10)
+				return FALSE;
+
+			context->complexity = value;
+			break;
+
+		default:
+			return FALSE;
+	}
+
+#if defined(WITH_OPUS)
+	return freerdp_dsp_opus_apply_options(context);
+#else
+	return TRUE;
+#endif
+#endif
+}
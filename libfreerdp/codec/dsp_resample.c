@@ -0,0 +1,382 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * Digital Sound Processing - built-in resampler and channel mixer
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <math.h>
+
+#include <winpr/crt.h>
+#include <winpr/synch.h>
+
+#include <freerdp/log.h>
+
+#include "dsp_resample.h"
+
+#define TAG FREERDP_TAG("dsp")
+
+/* Filter coefficients are stored as Q14 fixed point values. */
+#define DSP_COEFF_BITS 14
+#define DSP_BASE_TAPS 16
+#define DSP_MAX_TAPS 128
+#define DSP_MAX_PHASES 256
+#define DSP_PI 3.14159265358979323846
+
+/**
+ * Polyphase windowed sinc resampler.
+ *
+ * The conversion ratio is reduced to up / down, output frame n is located at input
+ * position n * down / up. Rates with more than DSP_MAX_PHASES interpolation phases use the
+ * nearest precomputed phase.
+ */
+struct _FREERDP_DSP_RESAMPLER
+{
+	UINT32 srcRate;
+	UINT32 dstRate;
+	UINT32 channels;
+
+	UINT32 up;
+	UINT32 down;
+	UINT32 taps;
+	UINT32 phases;
+	INT16* coeffs;
+
+	INT16* history[2];
+	size_t historyLength;
+	size_t historySize;
+	UINT64 position;
+};
+
+static INIT_ONCE dsp_kernels_once = INIT_ONCE_STATIC_INIT;
+static FREERDP_DSP_KERNELS dsp_kernels;
+
+static INT16 read_int16(const BYTE* src)
+{
+	return (INT16)(src[0] | (src[1] << 8));
+}
+
+static void write_int16(BYTE* dst, INT32 val)
+{
+	dst[1] = (val >> 8) & 0xFF;
+	dst[0] = val & 0xFF;
+}
+
+static INT32 dsp_dot_product_generic(const INT16* a, const INT16* b, size_t count)
+{
+	size_t x;
+	INT32 sum = 0;
+
+	for (x = 0; x < count; x++)
+		sum += a[x] * b[x];
+
+	return sum;
+}
+
+static void dsp_mono_to_stereo_generic(const BYTE* src, BYTE* dst, size_t frames)
+{
+	size_t x;
+
+	for (x = 0; x < frames; x++)
+	{
+		dst[4 * x + 0] = src[2 * x + 0];
+		dst[4 * x + 1] = src[2 * x + 1];
+		dst[4 * x + 2] = src[2 * x + 0];
+		dst[4 * x + 3] = src[2 * x + 1];
+	}
+}
+
+static void dsp_stereo_to_mono_generic(const BYTE* src, BYTE* dst, size_t frames)
+{
+	size_t x;
+
+	for (x = 0; x < frames; x++)
+	{
+		const INT32 left = read_int16(&src[4 * x]);
+		const INT32 right = read_int16(&src[4 * x + 2]);
+		write_int16(&dst[2 * x], (left + right) >> 1);
+	}
+}
+
+static BOOL CALLBACK freerdp_dsp_init_kernels(PINIT_ONCE once, PVOID param, PVOID* context)
+{
+	WINPR_UNUSED(once);
+	WINPR_UNUSED(param);
+	WINPR_UNUSED(context);
+
+	dsp_kernels.dot_product = dsp_dot_product_generic;
+	dsp_kernels.mono_to_stereo = dsp_mono_to_stereo_generic;
+	dsp_kernels.stereo_to_mono = dsp_stereo_to_mono_generic;
+#if defined(WITH_SSE2)
+	freerdp_dsp_init_kernels_sse2(&dsp_kernels);
+#endif
+#if defined(WITH_NEON)
+	freerdp_dsp_init_kernels_neon(&dsp_kernels);
+#endif
+	return TRUE;
+}
+
+const FREERDP_DSP_KERNELS* freerdp_dsp_get_kernels(void)
+{
+	InitOnceExecuteOnce(&dsp_kernels_once, freerdp_dsp_init_kernels, NULL, NULL);
+	return &dsp_kernels;
+}
+
+static UINT32 dsp_gcd(UINT32 a, UINT32 b)
+{
+	while (b != 0)
+	{
+		const UINT32 t = a % b;
+		a = b;
+		b = t;
+	}
+
+	return a;
+}
+
+static BOOL resampler_init_filter(FREERDP_DSP_RESAMPLER* resampler)
+{
+	UINT32 p, k;
+	double cutoff = 1.0;
+	double h[DSP_MAX_TAPS];
+	size_t taps;
+	size_t center;
+
+	/* Downsampling must remove everything above the destination nyquist frequency */
+	if (resampler->up < resampler->down)
+		cutoff = 0.95 * resampler->up / resampler->down;
+
+	taps = (size_t)ceil(DSP_BASE_TAPS / cutoff);
+	taps = (taps + 7) & ~7;
+
+	if (taps > DSP_MAX_TAPS)
+		taps = DSP_MAX_TAPS;
+
+	center = taps / 2 - 1;
+	resampler->taps = (UINT32)taps;
+	resampler->phases = MIN(resampler->up, DSP_MAX_PHASES);
+	resampler->coeffs =
+	    _aligned_malloc((resampler->phases + 1ull) * resampler->taps * sizeof(INT16), 16);
+
+	if (!resampler->coeffs)
+		return FALSE;
+
+	/* One additional phase for a fractional position rounded up to 1.0 */
+	for (p = 0; p <= resampler->phases; p++)
+	{
+		const double frac = (double)p / resampler->phases;
+		INT16* coeffs = &resampler->coeffs[p * taps];
+		double sum = 0.0;
+		INT32 total = 0;
+		size_t peak = center;
+
+		for (k = 0; k < taps; k++)
+		{
+			const double x = (double)k - center - frac;
+			const double t = x / (taps / 2.0);
+			double s = cutoff;
+			double w = 0.0;
+
+			if (fabs(x) > 1e-9)
+				s = sin(DSP_PI * cutoff * x) / (DSP_PI * x);
+
+			/* Blackman window */
+			if (fabs(t) < 1.0)
+				w = 0.42 + 0.5 * cos(DSP_PI * t) + 0.08 * cos(2.0 * DSP_PI * t);
+
+			h[k] = s * w;
+			sum += h[k];
+		}
+
+		for (k = 0; k < taps; k++)
+		{
+			coeffs[k] = (INT16)lrint(h[k] / sum * (1 << DSP_COEFF_BITS));
+			total += coeffs[k];
+
+			if (coeffs[k] > coeffs[peak])
+				peak = k;
+		}
+
+		/* Keep unity gain for DC exact after rounding */
+		coeffs[peak] += (INT16)((1 << DSP_COEFF_BITS) - total);
+	}
+
+	return TRUE;
+}
+
+static BOOL resampler_ensure_history(FREERDP_DSP_RESAMPLER* resampler, size_t length)
+{
+	UINT32 c;
+
+	if (length <= resampler->historySize)
+		return TRUE;
+
+	for (c = 0; c < resampler->channels; c++)
+	{
+		INT16* tmp = realloc(resampler->history[c], length * sizeof(INT16));
+
+		if (!tmp)
+			return FALSE;
+
+		resampler->history[c] = tmp;
+	}
+
+	resampler->historySize = length;
+	return TRUE;
+}
+
+FREERDP_DSP_RESAMPLER* freerdp_dsp_resampler_new(UINT32 srcRate, UINT32 dstRate, UINT32 channels)
+{
+	UINT32 c;
+	UINT32 gcd;
+	FREERDP_DSP_RESAMPLER* resampler;
+
+	if ((srcRate == 0) || (dstRate == 0) || (channels == 0) || (channels > 2))
+	{
+		WLog_ERR(TAG, "Unsupported resampler configuration %" PRIu32 " -> %" PRIu32 " [%" PRIu32
+		              " channels]",
+		         srcRate, dstRate, channels);
+		return NULL;
+	}
+
+	resampler = calloc(1, sizeof(FREERDP_DSP_RESAMPLER));
+
+	if (!resampler)
+		return NULL;
+
+	gcd = dsp_gcd(srcRate, dstRate);
+	resampler->srcRate = srcRate;
+	resampler->dstRate = dstRate;
+	resampler->channels = channels;
+	resampler->up = dstRate / gcd;
+	resampler->down = srcRate / gcd;
+
+	if (!resampler_init_filter(resampler))
+		goto fail;
+
+	/* Prime the history so that the first output frame is centered on the first input frame */
+	if (!resampler_ensure_history(resampler, 4096))
+		goto fail;
+
+	resampler->historyLength = resampler->taps / 2 - 1;
+
+	for (c = 0; c < channels; c++)
+		memset(resampler->history[c], 0, resampler->historyLength * sizeof(INT16));
+
+	return resampler;
+fail:
+	freerdp_dsp_resampler_free(resampler);
+	return NULL;
+}
+
+void freerdp_dsp_resampler_free(FREERDP_DSP_RESAMPLER* resampler)
+{
+	if (!resampler)
+		return;
+
+	free(resampler->history[0]);
+	free(resampler->history[1]);
+	_aligned_free(resampler->coeffs);
+	free(resampler);
+}
+
+BOOL freerdp_dsp_resampler_matches(const FREERDP_DSP_RESAMPLER* resampler, UINT32 srcRate,
+                                   UINT32 dstRate, UINT32 channels)
+{
+	if (!resampler)
+		return FALSE;
+
+	return (resampler->srcRate == srcRate) && (resampler->dstRate == dstRate) &&
+	       (resampler->channels == channels);
+}
+
+BOOL freerdp_dsp_resampler_process(FREERDP_DSP_RESAMPLER* resampler, const BYTE* src,
+                                   size_t frames, wStream* out)
+{
+	size_t x;
+	UINT32 c;
+	size_t drop;
+	size_t outFrames = 0;
+	const FREERDP_DSP_KERNELS* kernels = freerdp_dsp_get_kernels();
+
+	if (!resampler || (!src && (frames > 0)) || !out)
+		return FALSE;
+
+	if (!resampler_ensure_history(resampler, resampler->historyLength + frames))
+		return FALSE;
+
+	for (x = 0; x < frames; x++)
+	{
+		for (c = 0; c < resampler->channels; c++)
+		{
+			const BYTE* sample = &src[(x * resampler->channels + c) * sizeof(INT16)];
+			resampler->history[c][resampler->historyLength + x] = read_int16(sample);
+		}
+	}
+
+	resampler->historyLength += frames;
+
+	if (resampler->historyLength >= resampler->taps)
+	{
+		const UINT64 end = (resampler->historyLength - resampler->taps + 1ull) * resampler->up;
+
+		if (resampler->position < end)
+			outFrames = (end - resampler->position + resampler->down - 1) / resampler->down;
+	}
+
+	if (!Stream_EnsureRemainingCapacity(out, outFrames * resampler->channels * sizeof(INT16)))
+		return FALSE;
+
+	for (x = 0; x < outFrames; x++)
+	{
+		const size_t index = resampler->position / resampler->up;
+		const size_t phase =
+		    ((resampler->position % resampler->up) * resampler->phases + resampler->up / 2) /
+		    resampler->up;
+		const INT16* coeffs = &resampler->coeffs[phase * resampler->taps];
+
+		for (c = 0; c < resampler->channels; c++)
+		{
+			INT32 val =
+			    kernels->dot_product(&resampler->history[c][index], coeffs, resampler->taps);
+			val = (val + (1 << (DSP_COEFF_BITS - 1))) >> DSP_COEFF_BITS;
+
+			if (val > INT16_MAX)
+				val = INT16_MAX;
+			else if (val < INT16_MIN)
+				val = INT16_MIN;
+
+			Stream_Write_INT16(out, (INT16)val);
+		}
+
+		resampler->position += resampler->down;
+	}
+
+	/* Discard input that is no longer needed by any upcoming output frame */
+	drop = resampler->position / resampler->up;
+
+	if (drop > resampler->historyLength)
+		drop = resampler->historyLength;
+
+	for (c = 0; c < resampler->channels; c++)
+		memmove(resampler->history[c], &resampler->history[c][drop],
+		        (resampler->historyLength - drop) * sizeof(INT16));
+
+	resampler->historyLength -= drop;
+	resampler->position -= (UINT64)drop * resampler->up;
+	return TRUE;
+}
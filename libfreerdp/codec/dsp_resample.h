@@ -0,0 +1,54 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * Digital Sound Processing - built-in resampler and channel mixer
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FREERDP_LIB_CODEC_DSP_RESAMPLE_H
+#define FREERDP_LIB_CODEC_DSP_RESAMPLE_H
+
+#include <winpr/stream.h>
+
+#include <freerdp/api.h>
+#include <freerdp/types.h>
+
+typedef struct _FREERDP_DSP_RESAMPLER FREERDP_DSP_RESAMPLER;
+
+/* Sample processing kernels, 16 bit little endian samples. */
+typedef INT32 (*pfnDspDotProduct)(const INT16* a, const INT16* b, size_t count);
+typedef void (*pfnDspChannelMix)(const BYTE* src, BYTE* dst, size_t frames);
+
+struct _FREERDP_DSP_KERNELS
+{
+	/* count is a multiple of 8, b is 16 byte aligned */
+	pfnDspDotProduct dot_product;
+	pfnDspChannelMix mono_to_stereo;
+	pfnDspChannelMix stereo_to_mono;
+};
+typedef struct _FREERDP_DSP_KERNELS FREERDP_DSP_KERNELS;
+
+FREERDP_LOCAL const FREERDP_DSP_KERNELS* freerdp_dsp_get_kernels(void);
+
+FREERDP_LOCAL void freerdp_dsp_init_kernels_sse2(FREERDP_DSP_KERNELS* kernels);
+FREERDP_LOCAL void freerdp_dsp_init_kernels_neon(FREERDP_DSP_KERNELS* kernels);
+
+FREERDP_LOCAL FREERDP_DSP_RESAMPLER* freerdp_dsp_resampler_new(UINT32 srcRate, UINT32 dstRate,
+                                                               UINT32 channels);
+FREERDP_LOCAL void freerdp_dsp_resampler_free(FREERDP_DSP_RESAMPLER* resampler);
+FREERDP_LOCAL BOOL freerdp_dsp_resampler_matches(const FREERDP_DSP_RESAMPLER* resampler,
+                                                 UINT32 srcRate, UINT32 dstRate, UINT32 channels);
+FREERDP_LOCAL BOOL freerdp_dsp_resampler_process(FREERDP_DSP_RESAMPLER* resampler,
+                                                 const BYTE* src, size_t frames, wStream* out);
+
+#endif /* FREERDP_LIB_CODEC_DSP_RESAMPLE_H */
@@ -0,0 +1,107 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * Digital Sound Processing - NEON resampler and channel mixer kernels
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <winpr/sysinfo.h>
+
+#include "dsp_resample.h"
+
+#if defined(__ARM_NEON)
+
+#include <arm_neon.h>
+
+static INT32 dsp_dot_product_neon(const INT16* a, const INT16* b, size_t count)
+{
+	size_t x;
+	int32x4_t sum = vdupq_n_s32(0);
+	int32x2_t half;
+
+	for (x = 0; x < count; x += 8)
+	{
+		const int16x8_t va = vld1q_s16(&a[x]);
+		const int16x8_t vb = vld1q_s16(&b[x]);
+		sum = vmlal_s16(sum, vget_low_s16(va), vget_low_s16(vb));
+		sum = vmlal_s16(sum, vget_high_s16(va), vget_high_s16(vb));
+	}
+
+	half = vadd_s32(vget_low_s32(sum), vget_high_s32(sum));
+	half = vpadd_s32(half, half);
+	return vget_lane_s32(half, 0);
+}
+
+static void dsp_mono_to_stereo_neon(const BYTE* src, BYTE* dst, size_t frames)
+{
+	size_t x;
+
+	for (x = 0; x + 8 <= frames; x += 8)
+	{
+		int16x8x2_t stereo;
+		stereo.val[0] = vld1q_s16((const INT16*)&src[2 * x]);
+		stereo.val[1] = stereo.val[0];
+		vst2q_s16((INT16*)&dst[4 * x], stereo);
+	}
+
+	for (; x < frames; x++)
+	{
+		dst[4 * x + 0] = src[2 * x + 0];
+		dst[4 * x + 1] = src[2 * x + 1];
+		dst[4 * x + 2] = src[2 * x + 0];
+		dst[4 * x + 3] = src[2 * x + 1];
+	}
+}
+
+static void dsp_stereo_to_mono_neon(const BYTE* src, BYTE* dst, size_t frames)
+{
+	size_t x;
+
+	for (x = 0; x + 8 <= frames; x += 8)
+	{
+		const int16x8x2_t stereo = vld2q_s16((const INT16*)&src[4 * x]);
+		vst1q_s16((INT16*)&dst[2 * x], vhaddq_s16(stereo.val[0], stereo.val[1]));
+	}
+
+	for (; x < frames; x++)
+	{
+		const INT32 left = (INT16)(src[4 * x] | (src[4 * x + 1] << 8));
+		const INT32 right = (INT16)(src[4 * x + 2] | (src[4 * x + 3] << 8));
+		const INT32 val = (left + right) >> 1;
+		dst[2 * x + 0] = val & 0xFF;
+		dst[2 * x + 1] = (val >> 8) & 0xFF;
+	}
+}
+
+void freerdp_dsp_init_kernels_neon(FREERDP_DSP_KERNELS* kernels)
+{
+	if (!IsProcessorFeaturePresent(PF_ARM_NEON_INSTRUCTIONS_AVAILABLE))
+		return;
+
+	kernels->dot_product = dsp_dot_product_neon;
+	kernels->mono_to_stereo = dsp_mono_to_stereo_neon;
+	kernels->stereo_to_mono = dsp_stereo_to_mono_neon;
+}
+
+#else
+
+void freerdp_dsp_init_kernels_neon(FREERDP_DSP_KERNELS* kernels)
+{
+	WINPR_UNUSED(kernels);
+}
+
+#endif
@@ -0,0 +1,98 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * Digital Sound Processing - SSE2 resampler and channel mixer kernels
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <winpr/sysinfo.h>
+
+#include <emmintrin.h>
+
+#include "dsp_resample.h"
+
+static INT32 dsp_dot_product_sse2(const INT16* a, const INT16* b, size_t count)
+{
+	size_t x;
+	__m128i sum = _mm_setzero_si128();
+
+	for (x = 0; x < count; x += 8)
+	{
+		const __m128i va = _mm_loadu_si128((const __m128i*)&a[x]);
+		const __m128i vb = _mm_load_si128((const __m128i*)&b[x]);
+		sum = _mm_add_epi32(sum, _mm_madd_epi16(va, vb));
+	}
+
+	sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+	sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+	return _mm_cvtsi128_si32(sum);
+}
+
+static void dsp_mono_to_stereo_sse2(const BYTE* src, BYTE* dst, size_t frames)
+{
+	size_t x;
+
+	for (x = 0; x + 8 <= frames; x += 8)
+	{
+		const __m128i mono = _mm_loadu_si128((const __m128i*)&src[2 * x]);
+		_mm_storeu_si128((__m128i*)&dst[4 * x], _mm_unpacklo_epi16(mono, mono));
+		_mm_storeu_si128((__m128i*)&dst[4 * x + 16], _mm_unpackhi_epi16(mono, mono));
+	}
+
+	for (; x < frames; x++)
+	{
+		dst[4 * x + 0] = src[2 * x + 0];
+		dst[4 * x + 1] = src[2 * x + 1];
+		dst[4 * x + 2] = src[2 * x + 0];
+		dst[4 * x + 3] = src[2 * x + 1];
+	}
+}
+
+static void dsp_stereo_to_mono_sse2(const BYTE* src, BYTE* dst, size_t frames)
+{
+	size_t x;
+	const __m128i ones = _mm_set1_epi16(1);
+
+	for (x = 0; x + 8 <= frames; x += 8)
+	{
+		/* pmaddwd adds left and right of each frame into a 32 bit lane */
+		const __m128i lo = _mm_loadu_si128((const __m128i*)&src[4 * x]);
+		const __m128i hi = _mm_loadu_si128((const __m128i*)&src[4 * x + 16]);
+		const __m128i sumLo = _mm_srai_epi32(_mm_madd_epi16(lo, ones), 1);
+		const __m128i sumHi = _mm_srai_epi32(_mm_madd_epi16(hi, ones), 1);
+		_mm_storeu_si128((__m128i*)&dst[2 * x], _mm_packs_epi32(sumLo, sumHi));
+	}
+
+	for (; x < frames; x++)
+	{
+		const INT32 left = (INT16)(src[4 * x] | (src[4 * x + 1] << 8));
+		const INT32 right = (INT16)(src[4 * x + 2] | (src[4 * x + 3] << 8));
+		const INT32 val = (left + right) >> 1;
+		dst[2 * x + 0] = val & 0xFF;
+		dst[2 * x + 1] = (val >> 8) & 0xFF;
+	}
+}
+
+void freerdp_dsp_init_kernels_sse2(FREERDP_DSP_KERNELS* kernels)
+{
+	if (!IsProcessorFeaturePresent(PF_XMMI64_INSTRUCTIONS_AVAILABLE))
+		return;
+
+	kernels->dot_product = dsp_dot_product_sse2;
+	kernels->mono_to_stereo = dsp_mono_to_stereo_sse2;
+	kernels->stereo_to_mono = dsp_stereo_to_mono_sse2;
+}
@@ -27,6 +27,8 @@
 #include <winpr/library.h>
 #include <winpr/bitstream.h>
 #include <winpr/synch.h>
+#include <winpr/sysinfo.h>
+#include <winpr/pool.h>
 
 #include <freerdp/primitives.h>
 #include <freerdp/codec/h264.h>
@@ -37,7 +39,19 @@
 
 #define TAG FREERDP_TAG("codec")
 
-static BOOL avc444_ensure_buffer(H264_CONTEXT* h264, DWORD nDstHeight);
+/* The public H264_CONTEXT is the first member, h264_context_new allocates the whole struct */
+struct _H264_CONTEXT_PRIV
+{
+	H264_CONTEXT common;
+
+	BOOL IndependentAuxStream;
+	BOOL useThreads;
+	H264_CONTEXT* aux; /* encoder or decoder instance of the AVC444 chroma stream */
+};
+typedef struct _H264_CONTEXT_PRIV H264_CONTEXT_PRIV;
+
+static BOOL avc444_ensure_buffer(H264_CONTEXT* h264, const UINT32* piMainStride,
+                                 DWORD nDstHeight);
 
 BOOL avc420_ensure_buffer(H264_CONTEXT* h264, UINT32 stride, UINT32 width, UINT32 height)
 {
@@ -273,14 +287,253 @@ INT32 avc420_compress(H264_CONTEXT* h264, const BYTE* pSrcData, DWORD SrcFormat,
 	return rc;
 }
 
+struct _H264_ENCODE_PARAM
+{
+	H264_CONTEXT* h264;
+	const BYTE* pYUVData[3];
+	BYTE* coded;
+	UINT32 codedSize;
+	INT32 rc;
+};
+typedef struct _H264_ENCODE_PARAM H264_ENCODE_PARAM;
+
+static void CALLBACK avc444_compress_work_callback(PTP_CALLBACK_INSTANCE instance, void* context,
+                                                   PTP_WORK work)
+{
+	H264_ENCODE_PARAM* param = (H264_ENCODE_PARAM*)context;
+	H264_CONTEXT* h264 = param->h264;
+	WINPR_UNUSED(instance);
+	WINPR_UNUSED(work);
+
+	param->rc = h264->subsystem->Compress(h264, param->pYUVData, h264->iStride, &param->coded,
+	                                      &param->codedSize);
+}
+
+static void avc444_sync_aux_encoder(H264_CONTEXT* h264, H264_CONTEXT* aux)
+{
+	size_t x;
+
+	aux->width = h264->width;
+	aux->height = h264->height;
+	aux->RateControlMode = h264->RateControlMode;
+	aux->BitRate = h264->BitRate;
+	aux->FrameRate = h264->FrameRate;
+	aux->QP = h264->QP;
+	aux->NumberOfThreads = h264->NumberOfThreads;
+
+	for (x = 0; x < 3; x++)
+		aux->iStride[x] = h264->iStride[x];
+}
+
+static BOOL avc444_select_op(const RDPGFX_H264_METABLOCK* meta,
+                             const RDPGFX_H264_METABLOCK* auxMeta, BYTE* op)
+{
+	/* [MS-RDPEGFX] 2.2.4.5 RFX_AVC444_BITMAP_STREAM
+	 * LC:
+	 * 0 ... Luma & Chroma
+	 * 1 ... Luma
+	 * 2 ... Chroma
+	 */
+	if ((meta->numRegionRects > 0) && (auxMeta->numRegionRects > 0))
+		*op = 0;
+	else if (meta->numRegionRects > 0)
+		*op = 1;
+	else if (auxMeta->numRegionRects > 0)
+		*op = 2;
+	else
+	{
+		WLog_INFO(TAG, "no changes detected for luma or chroma frame");
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+static void h264_aux_context_free(H264_CONTEXT* aux)
+{
+	if (!aux)
+		return;
+
+	if (aux->subsystem)
+		aux->subsystem->Uninit(aux);
+
+	free(aux);
+}
+
+/* A second instance of the subsystem, used for the AVC444 chroma stream only */
+static H264_CONTEXT* h264_aux_context_new(H264_CONTEXT* h264)
+{
+	H264_CONTEXT* aux;
+
+	if (!h264->subsystem)
+		return NULL;
+
+	aux = (H264_CONTEXT*)calloc(1, sizeof(H264_CONTEXT));
+
+	if (!aux)
+		return NULL;
+
+	aux->Compressor = h264->Compressor;
+	aux->BitRate = h264->BitRate;
+	aux->FrameRate = h264->FrameRate;
+	aux->log = h264->log;
+
+	if (!h264->subsystem->Init(aux))
+	{
+		free(aux);
+		return NULL;
+	}
+
+	aux->subsystem = h264->subsystem;
+	return aux;
+}
+
+static void avc444_wait_work(PTP_WORK* work)
+{
+	if (!*work)
+		return;
+
+	WaitForThreadpoolWorkCallbacks(*work, FALSE);
+	CloseThreadpoolWork(*work);
+	*work = NULL;
+}
+
+/* The chroma frame of the last call was encoded, but is not sent because the luma stream
+ * failed. Replace the auxiliary encoder, so that the next chroma frame is a key frame and
+ * does not reference the dropped one. */
+static BOOL avc444_resync_aux_encoder(H264_CONTEXT* h264)
+{
+	H264_CONTEXT_PRIV* priv = (H264_CONTEXT_PRIV*)h264;
+	H264_CONTEXT* aux = h264_aux_context_new(h264);
+
+	if (!aux)
+	{
+		WLog_Print(h264->log, WLOG_ERROR, "Failed to reset the AVC444 auxiliary stream instance");
+		return FALSE;
+	}
+
+	h264_aux_context_free(priv->aux);
+	priv->aux = aux;
+	h264->firstChromaFrameDone = FALSE;
+	return TRUE;
+}
+
+/* The luma stream is encoded in the thread pool as soon as its changes are known, the chroma
+ * change detection runs on the calling thread in the meantime. With independent streams the
+ * chroma stream has its own encoder instance and is encoded in parallel to the luma stream,
+ * otherwise both streams share the encoder and the chroma frame has to wait for the luma one. */
+static INT32 avc444_compress_streams(H264_CONTEXT* h264, const RECTANGLE_16* region,
+                                     BYTE** pYUV444Data, BYTE** pOldYUV444Data, BYTE** pYUVData,
+                                     BYTE** pOldYUVData, BYTE* op, BYTE** ppDstData,
+                                     UINT32* pDstSize, BYTE** ppAuxDstData, UINT32* pAuxDstSize,
+                                     RDPGFX_H264_METABLOCK* meta, RDPGFX_H264_METABLOCK* auxMeta)
+{
+	size_t x;
+	INT32 rc = -1;
+	PTP_WORK work = NULL;
+	H264_ENCODE_PARAM luma = { 0 };
+	H264_ENCODE_PARAM chroma = { 0 };
+	H264_CONTEXT_PRIV* priv = (H264_CONTEXT_PRIV*)h264;
+	const BOOL independent = priv->IndependentAuxStream;
+
+	luma.h264 = h264;
+	chroma.h264 = independent ? priv->aux : h264;
+
+	for (x = 0; x < 3; x++)
+	{
+		luma.pYUVData[x] = pYUV444Data[x];
+		chroma.pYUVData[x] = pYUVData[x];
+	}
+
+	if (independent)
+		avc444_sync_aux_encoder(h264, priv->aux);
+
+	if (!detect_changes(h264->firstLumaFrameDone, h264->QP, region, pYUV444Data, pOldYUV444Data,
+	                    h264->iStride, meta))
+		return -1;
+
+	if (meta->numRegionRects > 0)
+	{
+		if (priv->useThreads)
+		{
+			work = CreateThreadpoolWork(avc444_compress_work_callback, &luma, NULL);
+
+			if (work)
+				SubmitThreadpoolWork(work);
+		}
+
+		if (!work)
+			avc444_compress_work_callback(NULL, &luma, NULL);
+	}
+
+	if (!detect_changes(h264->firstChromaFrameDone, h264->QP, region, pYUVData, pOldYUVData,
+	                    h264->iStride, auxMeta))
+		goto fail;
+
+	if (!avc444_select_op(meta, auxMeta, op))
+	{
+		rc = 0;
+		goto fail;
+	}
+
+	if ((*op == 0) || (*op == 2))
+	{
+		if (!independent)
+		{
+			avc444_wait_work(&work);
+
+			if (luma.rc < 0)
+				goto fail;
+
+			/* the chroma frame reuses the output buffer of the shared encoder */
+			if (*op == 0)
+			{
+				memcpy(h264->lumaData, luma.coded, luma.codedSize);
+				luma.coded = h264->lumaData;
+			}
+		}
+
+		avc444_compress_work_callback(NULL, &chroma, NULL);
+	}
+
+	avc444_wait_work(&work);
+
+	if ((*op == 0) || (*op == 1))
+	{
+		if (luma.rc < 0)
+		{
+			if (independent && (*op == 0) && (chroma.rc >= 0))
+				avc444_resync_aux_encoder(h264);
+			return -1;
+		}
+
+		h264->firstLumaFrameDone = TRUE;
+		*ppDstData = luma.coded;
+		*pDstSize = luma.codedSize;
+	}
+
+	if ((*op == 0) || (*op == 2))
+	{
+		if (chroma.rc < 0)
+			return -1;
+
+		h264->firstChromaFrameDone = TRUE;
+		*ppAuxDstData = chroma.coded;
+		*pAuxDstSize = chroma.codedSize;
+	}
+
+	return 1;
+fail:
+	avc444_wait_work(&work);
+	return rc;
+}
+
 INT32 avc444_compress(H264_CONTEXT* h264, const BYTE* pSrcData, DWORD SrcFormat, UINT32 nSrcStep,
                       UINT32 nSrcWidth, UINT32 nSrcHeight, BYTE version, const RECTANGLE_16* region,
                       BYTE* op, BYTE** ppDstData, UINT32* pDstSize, BYTE** ppAuxDstData,
                       UINT32* pAuxDstSize, RDPGFX_H264_METABLOCK* meta,
                       RDPGFX_H264_METABLOCK* auxMeta)
 {
-	BYTE* coded;
-	UINT32 codedSize;
 	BYTE** pYUV444Data;
 	BYTE** pOldYUV444Data;
 	BYTE** pYUVData;
@@ -295,7 +548,7 @@ INT32 avc444_compress(H264_CONTEXT* h264, const BYTE* pSrcData, DWORD SrcFormat,
 	if (!avc420_ensure_buffer(h264, nSrcStep, nSrcWidth, nSrcHeight))
 		return -1;
 
-	if (!avc444_ensure_buffer(h264, nSrcHeight))
+	if (!avc444_ensure_buffer(h264, h264->iStride, nSrcHeight))
 		return -1;
 
 	if (h264->encodingBuffer)
@@ -318,61 +571,15 @@ INT32 avc444_compress(H264_CONTEXT* h264, const BYTE* pSrcData, DWORD SrcFormat,
 	                           pYUV444Data, pYUVData, region, 1))
 		return -1;
 
-	if (!detect_changes(h264->firstLumaFrameDone, h264->QP, region, pYUV444Data, pOldYUV444Data,
-	                    h264->iStride, meta))
-		return -1;
-	if (!detect_changes(h264->firstChromaFrameDone, h264->QP, region, pYUVData, pOldYUVData,
-	                    h264->iStride, auxMeta))
-		return -1;
-
-	/* [MS-RDPEGFX] 2.2.4.5 RFX_AVC444_BITMAP_STREAM
-	 * LC:
-	 * 0 ... Luma & Chroma
-	 * 1 ... Luma
-	 * 2 ... Chroma
-	 */
-	if ((meta->numRegionRects > 0) && (auxMeta->numRegionRects > 0))
-		*op = 0;
-	else if (meta->numRegionRects > 0)
-		*op = 1;
-	else if (auxMeta->numRegionRects > 0)
-		*op = 2;
-	else
-	{
-		WLog_INFO(TAG, "no changes detected for luma or chroma frame");
-		return 0;
-	}
-
-	if ((*op == 0) || (*op == 1))
-	{
-		const BYTE* pcYUV444Data[3] = { pYUV444Data[0], pYUV444Data[1], pYUV444Data[2] };
-
-		if (h264->subsystem->Compress(h264, pcYUV444Data, h264->iStride, &coded, &codedSize) < 0)
-			return -1;
-		h264->firstLumaFrameDone = TRUE;
-		memcpy(h264->lumaData, coded, codedSize);
-		*ppDstData = h264->lumaData;
-		*pDstSize = codedSize;
-	}
-
-	if ((*op == 0) || (*op == 2))
-	{
-		const BYTE* pcYUVData[3] = { pYUVData[0], pYUVData[1], pYUVData[2] };
-
-		if (h264->subsystem->Compress(h264, pcYUVData, h264->iStride, &coded, &codedSize) < 0)
-			return -1;
-		h264->firstChromaFrameDone = TRUE;
-		*ppAuxDstData = coded;
-		*pAuxDstSize = codedSize;
-	}
-
-	return 1;
+	return avc444_compress_streams(h264, region, pYUV444Data, pOldYUV444Data, pYUVData, pOldYUVData,
+	                               op, ppDstData, pDstSize, ppAuxDstData, pAuxDstSize, meta,
+	                               auxMeta);
 }
 
-static BOOL avc444_ensure_buffer(H264_CONTEXT* h264, DWORD nDstHeight)
+static BOOL avc444_ensure_buffer(H264_CONTEXT* h264, const UINT32* piMainStride,
+                                 DWORD nDstHeight)
 {
 	UINT32 x;
-	const UINT32* piMainStride = h264->iStride;
 	UINT32* piDstSize = h264->iYUV444Size;
 	UINT32* piDstStride = h264->iYUV444Stride;
 	BYTE** ppYUVDstData = h264->pYUV444Data;
@@ -436,15 +643,22 @@ static BOOL avc444_process_rects(H264_CONTEXT* h264, const BYTE* pSrcData, UINT3
 	BYTE* pYUVDstData[3];
 	UINT32* piDstStride = h264->iYUV444Stride;
 	BYTE** ppYUVDstData = h264->pYUV444Data;
-	const UINT32* piStride = h264->iStride;
+	H264_CONTEXT_PRIV* priv = (H264_CONTEXT_PRIV*)h264;
+	H264_CONTEXT* decoder = h264;
+	const UINT32* piStride;
 
-	if (h264->subsystem->Decompress(h264, pSrcData, SrcSize) < 0)
+	/* the chroma stream has its own decoder if it was encoded independently */
+	if (priv->IndependentAuxStream && (type != AVC444_LUMA))
+		decoder = priv->aux;
+
+	if (decoder->subsystem->Decompress(decoder, pSrcData, SrcSize) < 0)
 		return FALSE;
 
-	pYUVData[0] = h264->pYUVData[0];
-	pYUVData[1] = h264->pYUVData[1];
-	pYUVData[2] = h264->pYUVData[2];
-	if (!avc444_ensure_buffer(h264, nDstHeight))
+	piStride = decoder->iStride;
+	pYUVData[0] = decoder->pYUVData[0];
+	pYUVData[1] = decoder->pYUVData[1];
+	pYUVData[2] = decoder->pYUVData[2];
+	if (!avc444_ensure_buffer(h264, piStride, nDstHeight))
 		return FALSE;
 
 	pYUVDstData[0] = ppYUVDstData[0];
@@ -589,7 +803,7 @@ static BOOL CALLBACK h264_register_subsystems(PINIT_ONCE once, PVOID param, PVOI
 	return i > 0;
 }
 
-static BOOL h264_context_init(H264_CONTEXT* h264)
+static BOOL h264_context_init(H264_CONTEXT* h264, H264_CONTEXT_SUBSYSTEM* subsystem)
 {
 	int i;
 
@@ -602,6 +816,16 @@ static BOOL h264_context_init(H264_CONTEXT* h264)
 		return FALSE;
 
 	h264->subsystem = NULL;
+
+	if (subsystem)
+	{
+		if (!subsystem->Init || !subsystem->Init(h264))
+			return FALSE;
+
+		h264->subsystem = subsystem;
+		return TRUE;
+	}
+
 	InitOnceExecuteOnce(&subsystems_once, h264_register_subsystems, NULL, NULL);
 
 	for (i = 0; i < MAX_SUBSYSTEMS; i++)
@@ -633,9 +857,66 @@ BOOL h264_context_reset(H264_CONTEXT* h264, UINT32 width, UINT32 height)
 	return TRUE;
 }
 
+BOOL h264_context_set_option(H264_CONTEXT* h264, H264_CONTEXT_OPTION option, UINT32 value)
+{
+	H264_CONTEXT_PRIV* priv = (H264_CONTEXT_PRIV*)h264;
+
+	if (!h264)
+		return FALSE;
+
+	switch (option)
+	{
+		case H264_CONTEXT_OPTION_INDEPENDENT_AUX_STREAM:
+			if (value && !priv->aux)
+			{
+				priv->aux = h264_aux_context_new(h264);
+
+				if (!priv->aux)
+				{
+					WLog_Print(h264->log, WLOG_ERROR,
+					           "Failed to create the AVC444 auxiliary stream instance");
+					return FALSE;
+				}
+			}
+
+			priv->IndependentAuxStream = (value != 0);
+			return TRUE;
+
+		default:
+			WLog_Print(h264->log, WLOG_WARN, "Unknown H264_CONTEXT_OPTION[0x%08" PRIx32 "]",
+			           (UINT32)option);
+			return FALSE;
+	}
+}
+
+UINT32 h264_context_get_option(H264_CONTEXT* h264, H264_CONTEXT_OPTION option)
+{
+	H264_CONTEXT_PRIV* priv = (H264_CONTEXT_PRIV*)h264;
+
+	if (!h264)
+		return 0;
+
+	switch (option)
+	{
+		case H264_CONTEXT_OPTION_INDEPENDENT_AUX_STREAM:
+			return priv->IndependentAuxStream;
+
+		default:
+			WLog_Print(h264->log, WLOG_WARN, "Unknown H264_CONTEXT_OPTION[0x%08" PRIx32 "]",
+			           (UINT32)option);
+			return 0;
+	}
+}
+
 H264_CONTEXT* h264_context_new(BOOL Compressor)
 {
-	H264_CONTEXT* h264 = (H264_CONTEXT*)calloc(1, sizeof(H264_CONTEXT));
+	return h264_context_new_with_subsystem(Compressor, NULL);
+}
+
+H264_CONTEXT* h264_context_new_with_subsystem(BOOL Compressor, H264_CONTEXT_SUBSYSTEM* subsystem)
+{
+	H264_CONTEXT_PRIV* priv = (H264_CONTEXT_PRIV*)calloc(1, sizeof(H264_CONTEXT_PRIV));
+	H264_CONTEXT* h264 = (H264_CONTEXT*)priv;
 	if (!h264)
 		return NULL;
 
@@ -648,13 +929,20 @@ H264_CONTEXT* h264_context_new(BOOL Compressor)
 		h264->FrameRate = 30;
 	}
 
-	if (!h264_context_init(h264))
+	if (!h264_context_init(h264, subsystem))
 		goto fail;
 
 	h264->yuv = yuv_context_new(Compressor, 0);
 	if (!h264->yuv)
 		goto fail;
 
+	if (Compressor)
+	{
+		SYSTEM_INFO sysInfos;
+		GetNativeSystemInfo(&sysInfos);
+		priv->useThreads = (sysInfos.dwNumberOfProcessors > 1);
+	}
+
 	return h264;
 
 fail:
@@ -667,7 +955,10 @@ void h264_context_free(H264_CONTEXT* h264)
 	if (h264)
 	{
 		size_t x;
-		h264->subsystem->Uninit(h264);
+		h264_aux_context_free(((H264_CONTEXT_PRIV*)h264)->aux);
+
+		if (h264->subsystem)
+			h264->subsystem->Uninit(h264);
 
 		for (x = 0; x < 3; x++)
 		{
@@ -43,4 +43,8 @@ struct _H264_CONTEXT_SUBSYSTEM
 FREERDP_LOCAL BOOL avc420_ensure_buffer(H264_CONTEXT* h264, UINT32 stride, UINT32 width,
                                         UINT32 height);
 
+/* Uses the given subsystem instead of the first available backend, NULL selects a backend */
+FREERDP_LOCAL H264_CONTEXT* h264_context_new_with_subsystem(BOOL Compressor,
+                                                            H264_CONTEXT_SUBSYSTEM* subsystem);
+
 #endif /* FREERDP_LIB_CODEC_H264_H */
@@ -1842,7 +1842,8 @@ static INLINE BOOL progressive_write_wb_sync(PROGRESSIVE_CONTEXT* progressive, w
 	return TRUE;
 }
 
-static INLINE BOOL progressive_write_wb_context(PROGRESSIVE_CONTEXT* progressive, wStream* s)
+static INLINE BOOL progressive_write_wb_context(PROGRESSIVE_CONTEXT* progressive, wStream* s,
+                                                BYTE flags)
 {
 	const UINT32 blockLen = 10;
 	WINPR_ASSERT(progressive);
@@ -1855,7 +1856,7 @@ static INLINE BOOL progressive_write_wb_context(PROGRESSIVE_CONTEXT* progressive
 	Stream_Write_UINT32(s, blockLen);                /* blockLen (4 bytes) */
 	Stream_Write_UINT8(s, 0);                        /* ctxId (1 byte) */
 	Stream_Write_UINT16(s, 64);                      /* tileSize (2 bytes) */
-	Stream_Write_UINT8(s, 0);                        /* flags (1 byte) */
+	Stream_Write_UINT8(s, flags);                    /* flags (1 byte) */
 	return TRUE;
 }
 
@@ -1926,19 +1927,18 @@ static INLINE BOOL progressive_write_region(PROGRESSIVE_CONTEXT* progressive, wS
 }
 
 static INLINE BOOL progressive_write_frame_begin(PROGRESSIVE_CONTEXT* progressive, wStream* s,
-                                                 const RFX_MESSAGE* msg)
+                                                 UINT32 frameIdx)
 {
 	const UINT32 blockLen = 12;
 	WINPR_ASSERT(progressive);
 	WINPR_ASSERT(s);
-	WINPR_ASSERT(msg);
 
 	if (!Stream_EnsureRemainingCapacity(s, blockLen))
 		return FALSE;
 
 	Stream_Write_UINT16(s, PROGRESSIVE_WBT_FRAME_BEGIN); /* blockType (2 bytes) */
 	Stream_Write_UINT32(s, blockLen);                    /* blockLen (4 bytes) */
-	Stream_Write_UINT32(s, msg->frameIdx);               /* frameIndex (4 bytes) */
+	Stream_Write_UINT32(s, frameIdx);                    /* frameIndex (4 bytes) */
 	Stream_Write_UINT16(s, 1);                           /* regionCount (2 bytes) */
 
 	return TRUE;
@@ -2601,10 +2601,10 @@ static BOOL progressive_rfx_write_message_progressive_simple(PROGRESSIVE_CONTEXT
 	if (!progressive_write_wb_sync(progressive, s))
 		return FALSE;
 
-	if (!progressive_write_wb_context(progressive, s))
+	if (!progressive_write_wb_context(progressive, s, 0))
 		return FALSE;
 
-	if (!progressive_write_frame_begin(progressive, s, msg))
+	if (!progressive_write_frame_begin(progressive, s, msg->frameIdx))
 		return FALSE;
 
 	if (!progressive_write_region(progressive, s, msg))
@@ -2623,6 +2623,708 @@ static BOOL progressive_rfx_write_message_progressive_simple(PROGRESSIVE_CONTEXT
 	return TRUE;
 }
 
+/**
+ * Progressive encoder
+ *
+ * With more than one pass tiles are first sent as TILE_FIRST with a reduced quality and refined
+ * by TILE_UPGRADE blocks on the following frames as long as their content does not change. The
+ * coefficients are recomputed from the source surface for every pass, only the number of passes
+ * already sent is kept per tile.
+ */
+
+#define PROGRESSIVE_TILE_DIRTY 0x80
+#define PROGRESSIVE_ENCODE_BUFFER_SIZE 8192
+
+/* quality levels, coarsest first. n passes use the last n - 1 levels followed by full quality */
+static const RFX_PROGRESSIVE_CODEC_QUANT progressive_quant_prog_vals[] = {
+	{ 25,
+	  { 2, 3, 3, 3, 4, 4, 4, 5, 5, 5 },
+	  { 3, 4, 4, 4, 5, 5, 5, 6, 6, 6 },
+	  { 3, 4, 4, 4, 5, 5, 5, 6, 6, 6 } },
+	{ 50,
+	  { 1, 2, 2, 2, 3, 3, 3, 4, 4, 4 },
+	  { 2, 3, 3, 3, 4, 4, 4, 5, 5, 5 },
+	  { 2, 3, 3, 3, 4, 4, 4, 5, 5, 5 } },
+	{ 75,
+	  { 0, 1, 1, 1, 1, 1, 1, 2, 2, 2 },
+	  { 1, 1, 1, 1, 2, 2, 2, 3, 3, 3 },
+	  { 1, 1, 1, 1, 2, 2, 2, 3, 3, 3 } }
+};
+
+static const RFX_COMPONENT_CODEC_QUANT progressive_quant_vals = { 6, 6, 6, 6, 7, 7, 8, 8, 8, 9 };
+
+/* sub-band offsets of the reduce extrapolate layout in upgrade order, LL3 is last */
+static const UINT32 progressive_rfx_band_offsets[] = { 0,    1023, 2046, 3007, 3279, 3551,
+	                                                   3807, 3879, 3951, 4015, 4096 };
+
+static INLINE void progressive_rfx_quant_bands(const RFX_COMPONENT_CODEC_QUANT* q, BYTE* bands)
+{
+	bands[0] = q->HL1;
+	bands[1] = q->LH1;
+	bands[2] = q->HH1;
+	bands[3] = q->HL2;
+	bands[4] = q->LH2;
+	bands[5] = q->HH2;
+	bands[6] = q->HL3;
+	bands[7] = q->LH3;
+	bands[8] = q->HH3;
+	bands[9] = q->LL3;
+}
+
+static INLINE void
+progressive_component_codec_quant_write(wStream* s, const RFX_COMPONENT_CODEC_QUANT* quantVal)
+{
+	Stream_Write_UINT8(s, quantVal->LL3 | (quantVal->HL3 << 4));
+	Stream_Write_UINT8(s, quantVal->LH3 | (quantVal->HH3 << 4));
+	Stream_Write_UINT8(s, quantVal->HL2 | (quantVal->LH2 << 4));
+	Stream_Write_UINT8(s, quantVal->HH2 | (quantVal->HL1 << 4));
+	Stream_Write_UINT8(s, quantVal->LH1 | (quantVal->HH1 << 4));
+}
+
+static INLINE BYTE progressive_get_pass_quality(const PROGRESSIVE_CONTEXT* progressive, UINT32 pass)
+{
+	if (pass + 1 >= progressive->numPasses)
+		return 0xFF;
+
+	return (BYTE)pass;
+}
+
+static INLINE const RFX_PROGRESSIVE_CODEC_QUANT*
+progressive_get_quant_prog_val(const PROGRESSIVE_CONTEXT* progressive, BYTE quality)
+{
+	const size_t first = ARRAYSIZE(progressive_quant_prog_vals) + 1 - progressive->numPasses;
+
+	if (quality == 0xFF)
+		return &progressive->quantProgValFull;
+
+	return &progressive_quant_prog_vals[first + quality];
+}
+
+/* forward transform of progressive_rfx_idwt_x / progressive_rfx_idwt_y for a single line */
+static INLINE void progressive_rfx_dwt_encode_line(const INT16* pSrc, size_t nSrcStep, INT16* pLow,
+                                                   size_t nLowStep, INT16* pHigh, size_t nHighStep,
+                                                   size_t nLowCount, size_t nHighCount)
+{
+	size_t k;
+	INT32 X0, X1, X2;
+
+	for (k = 0; k < nHighCount; k++)
+	{
+		X0 = pSrc[(2 * k) * nSrcStep];
+		X1 = pSrc[(2 * k + 1) * nSrcStep];
+		X2 = pSrc[(2 * k + 2) * nSrcStep];
+		pHigh[k * nHighStep] = (INT16)((X1 - ((X0 + X2) / 2)) / 2);
+	}
+
+	pLow[0] = (INT16)(pSrc[0] + pHigh[0]);
+
+	for (k = 1; k < nHighCount; k++)
+	{
+		X0 = pSrc[(2 * k) * nSrcStep];
+		pLow[k * nLowStep] =
+		    (INT16)(X0 + ((pHigh[(k - 1) * nHighStep] + pHigh[k * nHighStep]) / 2));
+	}
+
+	X0 = pSrc[(2 * nHighCount) * nSrcStep];
+
+	if (nLowCount <= (nHighCount + 1))
+	{
+		pLow[nHighCount * nLowStep] = (INT16)(X0 + pHigh[(nHighCount - 1) * nHighStep]);
+	}
+	else
+	{
+		X1 = pSrc[(2 * nHighCount + 1) * nSrcStep];
+		pLow[nHighCount * nLowStep] = (INT16)(X0 + (pHigh[(nHighCount - 1) * nHighStep] / 2));
+		pLow[(nHighCount + 1) * nLowStep] = (INT16)(2 * X1 - X0);
+	}
+}
+
+static INLINE void progressive_rfx_dwt_2d_encode_block(INT16* buffer, INT16* temp, size_t level)
+{
+	size_t i;
+	INT16 *HL, *LH;
+	INT16 *HH, *LL;
+	INT16 *L, *H, *X;
+
+	const size_t nBandL = progressive_rfx_get_band_l_count(level);
+	const size_t nBandH = progressive_rfx_get_band_h_count(level);
+	const size_t nCount = nBandL + nBandH;
+
+	HL = &buffer[0];
+	LH = &HL[nBandL * nBandH];
+	HH = &LH[nBandH * nBandL];
+	LL = &HH[nBandH * nBandH];
+	X = &temp[0];
+	L = &X[nCount * nCount];
+	H = &L[nBandL * nCount];
+	CopyMemory(X, buffer, nCount * nCount * sizeof(INT16));
+
+	/* vertical (X -> L + H) */
+	for (i = 0; i < nCount; i++)
+		progressive_rfx_dwt_encode_line(&X[i], nCount, &L[i], nCount, &H[i], nCount, nBandL,
+		                                nBandH);
+
+	/* horizontal (L -> LL + HL) */
+	for (i = 0; i < nBandL; i++)
+		progressive_rfx_dwt_encode_line(&L[i * nCount], 1, &LL[i * nBandL], 1, &HL[i * nBandH], 1,
+		                                nBandL, nBandH);
+
+	/* horizontal (H -> LH + HH) */
+	for (i = 0; i < nBandH; i++)
+		progressive_rfx_dwt_encode_line(&H[i * nCount], 1, &LH[i * nBandL], 1, &HH[i * nBandH], 1,
+		                                nBandL, nBandH);
+}
+
+/**
+ * Converts a tile to YCbCr, transforms it and quantizes the coefficients with the region
+ * quantization. Progressive quantization is applied per pass on top of these values.
+ */
+static BOOL progressive_rfx_encode_tile(const BYTE* pSrcData, UINT32 SrcFormat, UINT32 ScanLine,
+                                        UINT32 width, UINT32 height, INT16* pSrcDst[3],
+                                        INT16* temp)
+{
+	UINT32 x, y, i, b;
+	BYTE quant[10];
+	static const prim_size_t roi_64x64 = { 64, 64 };
+	const primitives_t* prims = primitives_get();
+	const UINT32 bpp = GetBytesPerPixel(SrcFormat);
+
+	/* partial tiles are padded with the last row and column */
+	for (y = 0; y < 64; y++)
+	{
+		const BYTE* line = &pSrcData[MIN(y, height - 1) * ScanLine];
+
+		for (x = 0; x < 64; x++)
+		{
+			BYTE r, g, b;
+			const UINT32 color = ReadColor(&line[MIN(x, width - 1) * bpp], SrcFormat);
+			SplitColor(color, SrcFormat, &r, &g, &b, NULL, NULL);
+			pSrcDst[0][y * 64 + x] = r;
+			pSrcDst[1][y * 64 + x] = g;
+			pSrcDst[2][y * 64 + x] = b;
+		}
+	}
+
+	if (prims->RGBToYCbCr_16s16s_P3P3((const INT16* const*)pSrcDst, 64 * sizeof(INT16), pSrcDst,
+	                                  64 * sizeof(INT16), &roi_64x64) != PRIMITIVES_SUCCESS)
+		return FALSE;
+
+	progressive_rfx_quant_bands(&progressive_quant_vals, quant);
+
+	for (i = 0; i < 3; i++)
+	{
+		INT16* buffer = pSrcDst[i];
+		progressive_rfx_dwt_2d_encode_block(&buffer[0], temp, 1);
+		progressive_rfx_dwt_2d_encode_block(&buffer[3007], temp, 2);
+		progressive_rfx_dwt_2d_encode_block(&buffer[3807], temp, 3);
+
+		/* same rounding as rfx_quantization_encode, the input is scaled by << 5 */
+		for (b = 0; b < 10; b++)
+		{
+			const UINT32 shift = quant[b] - 1;
+			const INT32 half = 1 << (shift - 1);
+
+			for (x = progressive_rfx_band_offsets[b]; x < progressive_rfx_band_offsets[b + 1]; x++)
+				buffer[x] = (INT16)((buffer[x] + half) >> shift);
+		}
+	}
+
+	return TRUE;
+}
+
+static INLINE BOOL progressive_write_tile_first(PROGRESSIVE_CONTEXT* progressive, wStream* s,
+                                                UINT16 xIdx, UINT16 yIdx, BYTE quality,
+                                                INT16* const pCoeffs[3], INT16* pValues,
+                                                BYTE* const pData[3])
+{
+	UINT32 i, b, index;
+	UINT32 blockLen = 23;
+	BYTE shift[10];
+	int len[3];
+	const RFX_PROGRESSIVE_CODEC_QUANT* quantProg =
+	    progressive_get_quant_prog_val(progressive, quality);
+	const RFX_COMPONENT_CODEC_QUANT* quantProgVals[3] = { &quantProg->yQuantValues,
+		                                                  &quantProg->cbQuantValues,
+		                                                  &quantProg->crQuantValues };
+
+	for (i = 0; i < 3; i++)
+	{
+		progressive_rfx_quant_bands(quantProgVals[i], shift);
+
+		/* LL3 is truncated towards -infinity, the refinement bits are sent unsigned */
+		for (b = 0; b < 9; b++)
+		{
+			for (index = progressive_rfx_band_offsets[b];
+			     index < progressive_rfx_band_offsets[b + 1]; index++)
+			{
+				const INT16 val = pCoeffs[i][index];
+				pValues[index] = (val < 0) ? -(-val >> shift[b]) : (val >> shift[b]);
+			}
+		}
+
+		for (index = progressive_rfx_band_offsets[9]; index < 4096; index++)
+			pValues[index] = pCoeffs[i][index] >> shift[9];
+
+		rfx_differential_encode(&pValues[4015], 81);
+		len[i] = progressive->rfx_context->rlgr_encode(RLGR1, pValues, 4096, pData[i],
+		                                               PROGRESSIVE_ENCODE_BUFFER_SIZE);
+
+		if ((len[i] < 0) || (len[i] > UINT16_MAX))
+			return FALSE;
+
+		blockLen += (UINT32)len[i];
+	}
+
+	if (!Stream_EnsureRemainingCapacity(s, blockLen))
+		return FALSE;
+
+	Stream_Write_UINT16(s, PROGRESSIVE_WBT_TILE_FIRST); /* blockType (2 bytes) */
+	Stream_Write_UINT32(s, blockLen);                   /* blockLen (4 bytes) */
+	Stream_Write_UINT8(s, 0);                           /* quantIdxY (1 byte) */
+	Stream_Write_UINT8(s, 0);                           /* quantIdxCb (1 byte) */
+	Stream_Write_UINT8(s, 0);                           /* quantIdxCr (1 byte) */
+	Stream_Write_UINT16(s, xIdx);                       /* xIdx (2 bytes) */
+	Stream_Write_UINT16(s, yIdx);                       /* yIdx (2 bytes) */
+	Stream_Write_UINT8(s, 0);                           /* flags (1 byte) */
+	Stream_Write_UINT8(s, quality);                     /* quality (1 byte) */
+	Stream_Write_UINT16(s, (UINT16)len[0]);             /* yLen (2 bytes) */
+	Stream_Write_UINT16(s, (UINT16)len[1]);             /* cbLen (2 bytes) */
+	Stream_Write_UINT16(s, (UINT16)len[2]);             /* crLen (2 bytes) */
+	Stream_Write_UINT16(s, 0);                          /* tailLen (2 bytes) */
+	Stream_Write(s, pData[0], (size_t)len[0]);          /* yData */
+	Stream_Write(s, pData[1], (size_t)len[1]);          /* cbData */
+	Stream_Write(s, pData[2], (size_t)len[2]);          /* crData */
+	return TRUE;
+}
+
+/* BitStream_Write_Bits does not check the capacity of the buffer */
+static INLINE BOOL progressive_bitstream_write(wBitStream* bs, UINT32 bits, UINT32 nbits)
+{
+	if (BitStream_GetRemainingLength(bs) < nbits)
+		return FALSE;
+
+	BitStream_Write_Bits(bs, bits, nbits);
+	return TRUE;
+}
+
+/* inverse of progressive_rfx_srl_read, state->nz counts the pending zero run */
+static INLINE BOOL progressive_rfx_srl_write(RFX_PROGRESSIVE_UPGRADE_STATE* state, INT16 value,
+                                             UINT32 numBits)
+{
+	UINT32 mag;
+	UINT32 zeros;
+	const UINT32 k = state->kp / 8;
+	wBitStream* bs = state->srl;
+
+	if (value == 0)
+	{
+		state->nz++;
+
+		if ((UINT32)state->nz == (1u << k))
+		{
+			/* '0' bit, run of (1 << k) zeros */
+			if (!progressive_bitstream_write(bs, 0, 1))
+				return FALSE;
+
+			state->nz = 0;
+			state->kp = MIN(state->kp + 4, 80);
+		}
+
+		return TRUE;
+	}
+
+	/* '1' bit, remaining zero run in k bits */
+	if (!progressive_bitstream_write(bs, 1, 1))
+		return FALSE;
+
+	if (k && !progressive_bitstream_write(bs, (UINT32)state->nz, k))
+		return FALSE;
+
+	state->nz = 0;
+
+	/* sign bit and unary coded magnitude */
+	if (!progressive_bitstream_write(bs, (value < 0) ? 1 : 0, 1))
+		return FALSE;
+
+	if (state->kp < 6)
+		state->kp = 0;
+	else
+		state->kp -= 6;
+
+	if (numBits == 1)
+		return TRUE;
+
+	mag = (UINT32)abs(value);
+
+	for (zeros = mag - 1; zeros > 0;)
+	{
+		const UINT32 nbits = MIN(zeros, 16);
+
+		if (!progressive_bitstream_write(bs, 0, nbits))
+			return FALSE;
+
+		zeros -= nbits;
+	}
+
+	if (mag < ((1u << numBits) - 1))
+		return progressive_bitstream_write(bs, 1, 1);
+
+	return TRUE;
+}
+
+static INLINE BOOL progressive_rfx_upgrade_encode_component(RFX_PROGRESSIVE_UPGRADE_STATE* state,
+                                                            const INT16* coeffs,
+                                                            const BYTE* prevShift,
+                                                            const BYTE* shift)
+{
+	UINT32 b, index;
+
+	for (b = 0; b < 10; b++)
+	{
+		const UINT32 numBits = prevShift[b] - shift[b];
+
+		if (!numBits)
+			continue;
+
+		for (index = progressive_rfx_band_offsets[b]; index < progressive_rfx_band_offsets[b + 1];
+		     index++)
+		{
+			BOOL rc;
+			const INT16 val = coeffs[index];
+			UINT32 prev, cur;
+
+			if (b == 9)
+			{
+				/* LL3, raw refinement of the truncated value */
+				cur = (UINT32)((val >> shift[b]) - ((val >> prevShift[b]) << numBits));
+				rc = progressive_bitstream_write(state->raw, cur, numBits);
+			}
+			else
+			{
+				prev = (UINT32)abs(val) >> prevShift[b];
+				cur = (UINT32)abs(val) >> shift[b];
+
+				if (prev)
+					rc = progressive_bitstream_write(state->raw, cur - (prev << numBits),
+					                                 numBits);
+				else
+					rc = progressive_rfx_srl_write(state, (val < 0) ? -(INT16)cur : (INT16)cur,
+					                               numBits);
+			}
+
+			if (!rc)
+				return FALSE;
+		}
+	}
+
+	/* a trailing zero run is covered by a single '0' bit */
+	if (state->nz && !progressive_bitstream_write(state->srl, 0, 1))
+		return FALSE;
+
+	BitStream_Flush(state->srl);
+	BitStream_Flush(state->raw);
+	return TRUE;
+}
+
+static INLINE BOOL progressive_write_tile_upgrade(PROGRESSIVE_CONTEXT* progressive, wStream* s,
+                                                  UINT16 xIdx, UINT16 yIdx, BYTE prevQuality,
+                                                  BYTE quality, INT16* const pCoeffs[3],
+                                                  BYTE* const pSrlData[3], BYTE* const pRawData[3])
+{
+	UINT32 i;
+	UINT32 blockLen = 26;
+	UINT32 srlLen[3];
+	UINT32 rawLen[3];
+	BYTE prevShift[10];
+	BYTE shift[10];
+	const RFX_PROGRESSIVE_CODEC_QUANT* prevQuantProg =
+	    progressive_get_quant_prog_val(progressive, prevQuality);
+	const RFX_PROGRESSIVE_CODEC_QUANT* quantProg =
+	    progressive_get_quant_prog_val(progressive, quality);
+	const RFX_COMPONENT_CODEC_QUANT* prevQuantProgVals[3] = { &prevQuantProg->yQuantValues,
+		                                                      &prevQuantProg->cbQuantValues,
+		                                                      &prevQuantProg->crQuantValues };
+	const RFX_COMPONENT_CODEC_QUANT* quantProgVals[3] = { &quantProg->yQuantValues,
+		                                                  &quantProg->cbQuantValues,
+		                                                  &quantProg->crQuantValues };
+
+	for (i = 0; i < 3; i++)
+	{
+		wBitStream s_srl = { 0 };
+		wBitStream s_raw = { 0 };
+		RFX_PROGRESSIVE_UPGRADE_STATE state = { 0 };
+
+		state.kp = 8;
+		state.srl = &s_srl;
+		state.raw = &s_raw;
+		BitStream_Attach(state.srl, pSrlData[i], PROGRESSIVE_ENCODE_BUFFER_SIZE);
+		BitStream_Attach(state.raw, pRawData[i], PROGRESSIVE_ENCODE_BUFFER_SIZE);
+		progressive_rfx_quant_bands(prevQuantProgVals[i], prevShift);
+		progressive_rfx_quant_bands(quantProgVals[i], shift);
+
+		if (!progressive_rfx_upgrade_encode_component(&state, pCoeffs[i], prevShift, shift))
+			return FALSE;
+
+		srlLen[i] = (state.srl->position + 7) / 8;
+		rawLen[i] = (state.raw->position + 7) / 8;
+
+		blockLen += srlLen[i] + rawLen[i];
+	}
+
+	if (!Stream_EnsureRemainingCapacity(s, blockLen))
+		return FALSE;
+
+	Stream_Write_UINT16(s, PROGRESSIVE_WBT_TILE_UPGRADE); /* blockType (2 bytes) */
+	Stream_Write_UINT32(s, blockLen);                     /* blockLen (4 bytes) */
+	Stream_Write_UINT8(s, 0);                             /* quantIdxY (1 byte) */
+	Stream_Write_UINT8(s, 0);                             /* quantIdxCb (1 byte) */
+	Stream_Write_UINT8(s, 0);                             /* quantIdxCr (1 byte) */
+	Stream_Write_UINT16(s, xIdx);                         /* xIdx (2 bytes) */
+	Stream_Write_UINT16(s, yIdx);                         /* yIdx (2 bytes) */
+	Stream_Write_UINT8(s, quality);                       /* quality (1 byte) */
+	Stream_Write_UINT16(s, (UINT16)srlLen[0]);            /* ySrlLen (2 bytes) */
+	Stream_Write_UINT16(s, (UINT16)rawLen[0]);            /* yRawLen (2 bytes) */
+	Stream_Write_UINT16(s, (UINT16)srlLen[1]);            /* cbSrlLen (2 bytes) */
+	Stream_Write_UINT16(s, (UINT16)rawLen[1]);            /* cbRawLen (2 bytes) */
+	Stream_Write_UINT16(s, (UINT16)srlLen[2]);            /* crSrlLen (2 bytes) */
+	Stream_Write_UINT16(s, (UINT16)rawLen[2]);            /* crRawLen (2 bytes) */
+
+	for (i = 0; i < 3; i++)
+	{
+		Stream_Write(s, pSrlData[i], srlLen[i]); /* srlData */
+		Stream_Write(s, pRawData[i], rawLen[i]); /* rawData */
+	}
+
+	return TRUE;
+}
+
+static BOOL progressive_compress_update_grid(PROGRESSIVE_CONTEXT* progressive, UINT32 gridWidth,
+                                             UINT32 gridHeight)
+{
+	BYTE* tilePasses;
+
+	if (progressive->tilePasses && (progressive->gridWidth == gridWidth) &&
+	    (progressive->gridHeight == gridHeight))
+		return TRUE;
+
+	tilePasses = (BYTE*)calloc(gridWidth * gridHeight, sizeof(BYTE));
+
+	if (!tilePasses)
+		return FALSE;
+
+	free(progressive->tilePasses);
+	progressive->tilePasses = tilePasses;
+	progressive->gridWidth = gridWidth;
+	progressive->gridHeight = gridHeight;
+	return TRUE;
+}
+
+static INLINE BOOL progressive_compress_tile_pending(const PROGRESSIVE_CONTEXT* progressive,
+                                                     BYTE passes)
+{
+	if (passes & PROGRESSIVE_TILE_DIRTY)
+		return TRUE;
+
+	return (passes > 0) && (passes < progressive->numPasses);
+}
+
+static int progressive_compress_passes(PROGRESSIVE_CONTEXT* progressive, const BYTE* pSrcData,
+                                       UINT32 SrcFormat, UINT32 Width, UINT32 Height,
+                                       UINT32 ScanLine, const REGION16* invalidRegion,
+                                       BYTE** ppDstData, UINT32* pDstSize)
+{
+	int res = -6;
+	UINT32 i, x, y;
+	UINT32 numTiles = 0;
+	UINT32 blockLen;
+	size_t regionStart, tilesStart, end;
+	BYTE* pBuffer[4] = { 0 };
+	INT16* pCoeffs[3];
+	BYTE* pData[3];
+	BYTE* pRawData[3];
+	INT16* temp;
+	wStream* s = progressive->buffer;
+	const UINT32 bpp = GetBytesPerPixel(SrcFormat);
+	const UINT32 gridWidth = (Width + 63) / 64;
+	const UINT32 gridHeight = (Height + 63) / 64;
+	const UINT32 gridSize = gridWidth * gridHeight;
+	const BYTE numProgQuant = (BYTE)(progressive->numPasses - 1);
+
+	if ((bpp == 0) || (gridSize == 0) || (gridSize > UINT16_MAX))
+		return -2;
+
+	if (!progressive_compress_update_grid(progressive, gridWidth, gridHeight))
+		return -5;
+
+	if (!invalidRegion)
+	{
+		for (i = 0; i < gridSize; i++)
+			progressive->tilePasses[i] |= PROGRESSIVE_TILE_DIRTY;
+	}
+	else
+	{
+		UINT32 nbRects;
+		const RECTANGLE_16* rects = region16_rects(invalidRegion, &nbRects);
+
+		for (i = 0; i < nbRects; i++)
+		{
+			const RECTANGLE_16* rect = &rects[i];
+			const UINT32 right = MIN(rect->right, Width);
+			const UINT32 bottom = MIN(rect->bottom, Height);
+
+			for (y = rect->top / 64; y < (bottom + 63) / 64; y++)
+			{
+				for (x = rect->left / 64; x < (right + 63) / 64; x++)
+					progressive->tilePasses[y * gridWidth + x] |= PROGRESSIVE_TILE_DIRTY;
+			}
+		}
+	}
+
+	for (i = 0; i < gridSize; i++)
+	{
+		if (progressive_compress_tile_pending(progressive, progressive->tilePasses[i]))
+			numTiles++;
+	}
+
+	if (numTiles == 0)
+		return 0;
+
+	for (i = 0; i < ARRAYSIZE(pBuffer); i++)
+	{
+		pBuffer[i] = (BYTE*)BufferPool_Take(progressive->bufferPool, -1);
+
+		if (!pBuffer[i])
+			goto fail;
+	}
+
+	for (i = 0; i < 3; i++)
+	{
+		pCoeffs[i] = (INT16*)&pBuffer[0][((8192 + 32) * i) + 16];
+		pData[i] = &pBuffer[1][((8192 + 32) * i) + 16];
+		pRawData[i] = &pBuffer[2][((8192 + 32) * i) + 16];
+	}
+
+	temp = (INT16*)pBuffer[3];
+	Stream_SetPosition(s, 0);
+
+	if (!progressive_write_wb_sync(progressive, s))
+		goto fail;
+
+	if (!progressive_write_wb_context(progressive, s, RFX_SUBBAND_DIFFING))
+		goto fail;
+
+	if (!progressive_write_frame_begin(progressive, s, progressive->rfx_context->frameIdx++))
+		goto fail;
+
+	/* RFX_PROGRESSIVE_REGION, blockLen and tilesDataSize are updated once the tiles are written */
+	regionStart = Stream_GetPosition(s);
+	blockLen = 18 + numTiles * 8 + 5 + numProgQuant * 16;
+
+	if (!Stream_EnsureRemainingCapacity(s, blockLen))
+		goto fail;
+
+	Stream_Write_UINT16(s, PROGRESSIVE_WBT_REGION);     /* blockType (2 bytes) */
+	Stream_Write_UINT32(s, 0);                          /* blockLen (4 bytes) */
+	Stream_Write_UINT8(s, 64);                          /* tileSize (1 byte) */
+	Stream_Write_UINT16(s, (UINT16)numTiles);           /* numRects (2 bytes) */
+	Stream_Write_UINT8(s, 1);                           /* numQuant (1 byte) */
+	Stream_Write_UINT8(s, numProgQuant);                /* numProgQuant (1 byte) */
+	Stream_Write_UINT8(s, RFX_DWT_REDUCE_EXTRAPOLATE); /* flags (1 byte) */
+	Stream_Write_UINT16(s, (UINT16)numTiles);           /* numTiles (2 bytes) */
+	Stream_Write_UINT32(s, 0);                          /* tilesDataSize (4 bytes) */
+
+	for (i = 0; i < gridSize; i++)
+	{
+		if (!progressive_compress_tile_pending(progressive, progressive->tilePasses[i]))
+			continue;
+
+		x = (i % gridWidth) * 64;
+		y = (i / gridWidth) * 64;
+		/* TS_RFX_RECT */
+		Stream_Write_UINT16(s, (UINT16)x);                     /* x (2 bytes) */
+		Stream_Write_UINT16(s, (UINT16)y);                     /* y (2 bytes) */
+		Stream_Write_UINT16(s, (UINT16)MIN(64, Width - x));  /* width (2 bytes) */
+		Stream_Write_UINT16(s, (UINT16)MIN(64, Height - y)); /* height (2 bytes) */
+	}
+
+	progressive_component_codec_quant_write(s, &progressive_quant_vals);
+
+	for (i = 0; i < numProgQuant; i++)
+	{
+		/* RFX_PROGRESSIVE_CODEC_QUANT */
+		const RFX_PROGRESSIVE_CODEC_QUANT* quantProg =
+		    progressive_get_quant_prog_val(progressive, (BYTE)i);
+		Stream_Write_UINT8(s, quantProg->quality); /* quality (1 byte) */
+		progressive_component_codec_quant_write(s, &quantProg->yQuantValues);
+		progressive_component_codec_quant_write(s, &quantProg->cbQuantValues);
+		progressive_component_codec_quant_write(s, &quantProg->crQuantValues);
+	}
+
+	tilesStart = Stream_GetPosition(s);
+
+	for (i = 0; i < gridSize; i++)
+	{
+		const BYTE passes = progressive->tilePasses[i];
+		const UINT16 xIdx = (UINT16)(i % gridWidth);
+		const UINT16 yIdx = (UINT16)(i / gridWidth);
+		const BYTE* pTileData = &pSrcData[yIdx * 64ULL * ScanLine + xIdx * 64ULL * bpp];
+
+		if (!progressive_compress_tile_pending(progressive, passes))
+			continue;
+
+		if (!progressive_rfx_encode_tile(pTileData, SrcFormat, ScanLine,
+		                                 MIN(64, Width - xIdx * 64), MIN(64, Height - yIdx * 64),
+		                                 pCoeffs, temp))
+			goto fail;
+
+		if (passes & PROGRESSIVE_TILE_DIRTY)
+		{
+			if (!progressive_write_tile_first(progressive, s, xIdx, yIdx,
+			                                  progressive_get_pass_quality(progressive, 0),
+			                                  pCoeffs, temp, pData))
+				goto fail;
+
+			progressive->tilePasses[i] = 1;
+		}
+		else
+		{
+			const BYTE prevQuality = progressive_get_pass_quality(progressive, passes - 1);
+			const BYTE quality = progressive_get_pass_quality(progressive, passes);
+
+			if (!progressive_write_tile_upgrade(progressive, s, xIdx, yIdx, prevQuality, quality,
+			                                    pCoeffs, pData, pRawData))
+				goto fail;
+
+			progressive->tilePasses[i] = passes + 1;
+		}
+	}
+
+	end = Stream_GetPosition(s);
+	Stream_SetPosition(s, regionStart + 2);
+	Stream_Write_UINT32(s, (UINT32)(end - regionStart)); /* blockLen (4 bytes) */
+	Stream_SetPosition(s, regionStart + 14);
+	Stream_Write_UINT32(s, (UINT32)(end - tilesStart)); /* tilesDataSize (4 bytes) */
+	Stream_SetPosition(s, end);
+
+	if (!progressive_write_frame_end(progressive, s))
+		goto fail;
+
+	*pDstSize = Stream_GetPosition(s);
+	*ppDstData = Stream_Buffer(s);
+	res = 1;
+fail:
+	if (res < 0)
+	{
+		/* the client state is unknown, send all tiles again on the next update */
+		ZeroMemory(progressive->tilePasses, gridSize);
+	}
+
+	for (i = 0; i < ARRAYSIZE(pBuffer); i++)
+		BufferPool_Return(progressive->bufferPool, pBuffer[i]);
+
+	return res;
+}
+
 int progressive_compress(PROGRESSIVE_CONTEXT* progressive, const BYTE* pSrcData, UINT32 SrcSize,
                          UINT32 SrcFormat, UINT32 Width, UINT32 Height, UINT32 ScanLine,
                          const REGION16* invalidRegion, BYTE** ppDstData, UINT32* pDstSize)
@@ -2662,6 +3364,10 @@ int progressive_compress(PROGRESSIVE_CONTEXT* progressive, const BYTE* pSrcData,
 	if (SrcSize < Height * ScanLine)
 		return -4;
 
+	if (progressive->numPasses > 1)
+		return progressive_compress_passes(progressive, pSrcData, SrcFormat, Width, Height,
+		                                   ScanLine, invalidRegion, ppDstData, pDstSize);
+
 	if (!invalidRegion)
 	{
 		numRects = (Width + 63) / 64;
@@ -2750,11 +3456,43 @@ fail:
 	return res;
 }
 
+BOOL progressive_context_set_passes(PROGRESSIVE_CONTEXT* progressive, UINT32 numPasses)
+{
+	if (!progressive || (numPasses < 1) || (numPasses > ARRAYSIZE(progressive_quant_prog_vals) + 1))
+		return FALSE;
+
+	progressive->numPasses = numPasses;
+	free(progressive->tilePasses);
+	progressive->tilePasses = NULL;
+	progressive->gridWidth = 0;
+	progressive->gridHeight = 0;
+	return TRUE;
+}
+
+BOOL progressive_compress_pending(PROGRESSIVE_CONTEXT* progressive)
+{
+	UINT32 i;
+
+	if (!progressive || !progressive->tilePasses)
+		return FALSE;
+
+	for (i = 0; i < progressive->gridWidth * progressive->gridHeight; i++)
+	{
+		if (progressive_compress_tile_pending(progressive, progressive->tilePasses[i]))
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
 BOOL progressive_context_reset(PROGRESSIVE_CONTEXT* progressive)
 {
 	if (!progressive)
 		return FALSE;
 
+	if (progressive->tilePasses)
+		ZeroMemory(progressive->tilePasses, progressive->gridWidth * progressive->gridHeight);
+
 	return TRUE;
 }
 
@@ -2766,6 +3504,7 @@ PROGRESSIVE_CONTEXT* progressive_context_new(BOOL Compressor)
 		return NULL;
 
 	progressive->Compressor = Compressor;
+	progressive->numPasses = 1;
 	progressive->quantProgValFull.quality = 100;
 	progressive->log = WLog_Get(TAG);
 	if (!progressive->log)
@@ -2805,6 +3544,7 @@ void progressive_context_free(PROGRESSIVE_CONTEXT* progressive)
 	Stream_Free(progressive->buffer, TRUE);
 	Stream_Free(progressive->rects, TRUE);
 	rfx_context_free(progressive->rfx_context);
+	free(progressive->tilePasses);
 
 	BufferPool_Free(progressive->bufferPool);
 
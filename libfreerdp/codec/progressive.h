@@ -234,6 +234,12 @@ struct _PROGRESSIVE_CONTEXT
 	wStream* buffer;
 	wStream* rects;
 	RFX_CONTEXT* rfx_context;
+
+	/* encoder quality passes, tiles are sent as TILE_SIMPLE if 1 */
+	UINT32 numPasses;
+	UINT32 gridWidth;
+	UINT32 gridHeight;
+	BYTE* tilePasses;
 };
 
 #endif /* INTERNAL_CODEC_PROGRESSIVE_H */
@@ -130,14 +130,6 @@ const RECTANGLE_16* region16_extents(const REGION16* region)
 	return &region->extents;
 }
 
-static RECTANGLE_16* region16_extents_noconst(REGION16* region)
-{
-	if (!region)
-		return NULL;
-
-	return &region->extents;
-}
-
 BOOL rectangle_is_empty(const RECTANGLE_16* rect)
 {
 	/* A rectangle with width = 0 or height = 0 should be regarded
@@ -252,96 +244,6 @@ void region16_print(const REGION16* region)
 	}
 }
 
-static void region16_copy_band_with_union(RECTANGLE_16* dst, const RECTANGLE_16* src,
-                                          const RECTANGLE_16* end, UINT16 newTop, UINT16 newBottom,
-                                          const RECTANGLE_16* unionRect, UINT32* dstCounter,
-                                          const RECTANGLE_16** srcPtr, RECTANGLE_16** dstPtr)
-{
-	UINT16 refY = src->top;
-	const RECTANGLE_16 *startOverlap, *endOverlap;
-
-	/* merges a band with the given rect
-	 * Input:
-	 *                   unionRect
-	 *               |               |
-	 *               |               |
-	 * ==============+===============+================================
-	 *   |Item1|  |Item2| |Item3|  |Item4|    |Item5|            Band
-	 * ==============+===============+================================
-	 *    before     |    overlap    |          after
-	 *
-	 * Resulting band:
-	 *   +-----+  +----------------------+    +-----+
-	 *   |Item1|  |      Item2           |    |Item3|
-	 *   +-----+  +----------------------+    +-----+
-	 *
-	 *  We first copy as-is items that are before Item2, the first overlapping
-	 *  item.
-	 *  Then we find the last one that overlap unionRect to agregate Item2, Item3
-	 *  and Item4 to create Item2.
-	 *  Finally Item5 is copied as Item3.
-	 *
-	 *  When no unionRect is provided, we skip the two first steps to just copy items
-	 */
-
-	if (unionRect)
-	{
-		/* items before unionRect */
-		while ((src < end) && (src->top == refY) && (src->right < unionRect->left))
-		{
-			dst->top = newTop;
-			dst->bottom = newBottom;
-			dst->right = src->right;
-			dst->left = src->left;
-			src++;
-			dst++;
-			*dstCounter += 1;
-		}
-
-		/* treat items overlapping with unionRect */
-		startOverlap = unionRect;
-		endOverlap = unionRect;
-
-		if ((src < end) && (src->top == refY) && (src->left < unionRect->left))
-			startOverlap = src;
-
-		while ((src < end) && (src->top == refY) && (src->right < unionRect->right))
-		{
-			src++;
-		}
-
-		if ((src < end) && (src->top == refY) && (src->left < unionRect->right))
-		{
-			endOverlap = src;
-			src++;
-		}
-
-		dst->bottom = newBottom;
-		dst->top = newTop;
-		dst->left = startOverlap->left;
-		dst->right = endOverlap->right;
-		dst++;
-		*dstCounter += 1;
-	}
-
-	/* treat remaining items on the same band */
-	while ((src < end) && (src->top == refY))
-	{
-		dst->top = newTop;
-		dst->bottom = newBottom;
-		dst->right = src->right;
-		dst->left = src->left;
-		src++;
-		dst++;
-		*dstCounter += 1;
-	}
-
-	if (srcPtr)
-		*srcPtr = src;
-
-	*dstPtr = dst;
-}
-
 static RECTANGLE_16* next_band(RECTANGLE_16* band1, RECTANGLE_16* endPtr, int* nbItems)
 {
 	UINT16 refY = band1->top;
@@ -376,34 +278,6 @@ static BOOL band_match(const RECTANGLE_16* band1, const RECTANGLE_16* band2, REC
 	return (band2 == endPtr) || (band2->top != refBand2);
 }
 
-/** compute if the rectangle is fully included in the band
- * @param band a pointer on the beginning of the band
- * @param endPtr end of the region
- * @param rect the rectangle to test
- * @return if rect is fully included in an item of the band
- */
-static BOOL rectangle_contained_in_band(const RECTANGLE_16* band, const RECTANGLE_16* endPtr,
-                                        const RECTANGLE_16* rect)
-{
-	UINT16 refY = band->top;
-
-	if ((band->top > rect->top) || (rect->bottom > band->bottom))
-		return FALSE;
-
-	/* note: as the band is sorted from left to right, once we've seen an item
-	 * 		that is after rect->left we're sure that the result is False.
-	 */
-	while ((band < endPtr) && (band->top == refY) && (band->left <= rect->left))
-	{
-		if (rect->right <= band->right)
-			return TRUE;
-
-		band++;
-	}
-
-	return FALSE;
-}
-
 static BOOL region16_simplify_bands(REGION16* region)
 {
 	/** Simplify consecutive bands that touch and have the same items
@@ -485,201 +359,527 @@ static BOOL region16_simplify_bands(REGION16* region)
 	return TRUE;
 }
 
-BOOL region16_union_rect(REGION16* dst, const REGION16* src, const RECTANGLE_16* rect)
+/** Band builder used by the sweep line operations.
+ *
+ * Rectangles are appended band by band, from top to bottom. Spans of a band are added from left
+ * to right and joined when they overlap or touch. When a band is finished it is merged into the
+ * previous one if both touch and have the same spans, so the result needs no simplification.
+ */
+typedef struct
 {
-	const RECTANGLE_16* srcExtents;
-	RECTANGLE_16* dstExtents;
-	const RECTANGLE_16 *currentBand, *endSrcRect, *nextBand;
-	REGION16_DATA* newItems = NULL;
-	REGION16_DATA* tmpItems = NULL;
-	RECTANGLE_16* dstRect = NULL;
-	UINT32 usedRects, srcNbRects;
-	UINT16 topInterBand;
-	WINPR_ASSERT(src);
-	WINPR_ASSERT(src->data);
-	WINPR_ASSERT(dst);
-	srcExtents = region16_extents(src);
-	dstExtents = region16_extents_noconst(dst);
+	REGION16_DATA* data;
+	UINT32 capacity;
+	UINT32 nbRects;
+	UINT32 prevBand;
+	UINT32 curBand;
+	BOOL hasPrevBand;
+	UINT16 top;
+	UINT16 bottom;
+	BOOL failed;
+} REGION16_BUILDER;
+
+static RECTANGLE_16* builder_rects(REGION16_BUILDER* builder)
+{
+	return (RECTANGLE_16*)(&builder->data[1]);
+}
 
-	if (!region16_n_rects(src))
-	{
-		/* source is empty, so the union is rect */
-		dst->extents = *rect;
-		dst->data = allocateRegion(1);
+static BOOL builder_init(REGION16_BUILDER* builder, size_t capacity)
+{
+	ZeroMemory(builder, sizeof(REGION16_BUILDER));
 
-		if (!dst->data)
-			return FALSE;
+	if (capacity > UINT32_MAX / 2)
+		return FALSE;
 
-		dstRect = region16_rects_noconst(dst);
-		dstRect->top = rect->top;
-		dstRect->left = rect->left;
-		dstRect->right = rect->right;
-		dstRect->bottom = rect->bottom;
+	builder->capacity = MAX((UINT32)capacity, 8);
+	builder->data = allocateRegion(builder->capacity);
+	return builder->data != NULL;
+}
+
+static BOOL builder_reserve(REGION16_BUILDER* builder, UINT32 count)
+{
+	REGION16_DATA* data;
+	UINT32 capacity = builder->capacity;
+
+	if (builder->nbRects + count <= capacity)
 		return TRUE;
+
+	while (builder->nbRects + count > capacity)
+	{
+		if (capacity > UINT32_MAX / 2)
+		{
+			builder->failed = TRUE;
+			return FALSE;
+		}
+
+		capacity *= 2;
 	}
 
-	newItems = allocateRegion((1 + region16_n_rects(src)) * 4);
+	data = realloc(builder->data, sizeof(REGION16_DATA) + capacity * sizeof(RECTANGLE_16));
 
-	if (!newItems)
+	if (!data)
+	{
+		builder->failed = TRUE;
 		return FALSE;
+	}
 
-	dstRect = (RECTANGLE_16*)(&newItems[1]);
-	usedRects = 0;
+	builder->data = data;
+	builder->capacity = capacity;
+	return TRUE;
+}
 
-	/* adds the piece of rect that is on the top of src */
-	if (rect->top < srcExtents->top)
+static void builder_begin_band(REGION16_BUILDER* builder, UINT16 top, UINT16 bottom)
+{
+	builder->curBand = builder->nbRects;
+	builder->top = top;
+	builder->bottom = bottom;
+}
+
+static void builder_add_span(REGION16_BUILDER* builder, UINT16 left, UINT16 right)
+{
+	RECTANGLE_16* rect;
+
+	if (left >= right)
+		return;
+
+	if (builder->nbRects > builder->curBand)
 	{
-		dstRect->top = rect->top;
-		dstRect->left = rect->left;
-		dstRect->right = rect->right;
-		dstRect->bottom = MIN(srcExtents->top, rect->bottom);
-		usedRects++;
-		dstRect++;
+		rect = &builder_rects(builder)[builder->nbRects - 1];
+
+		if (rect->right >= left)
+		{
+			rect->right = MAX(rect->right, right);
+			return;
+		}
 	}
 
-	/* treat possibly overlapping region */
-	currentBand = region16_rects(src, &srcNbRects);
-	endSrcRect = currentBand + srcNbRects;
+	if (!builder_reserve(builder, 1))
+		return;
+
+	rect = &builder_rects(builder)[builder->nbRects++];
+	rect->left = left;
+	rect->top = builder->top;
+	rect->right = right;
+	rect->bottom = builder->bottom;
+}
+
+static void builder_end_band(REGION16_BUILDER* builder)
+{
+	UINT32 index;
+	RECTANGLE_16* rects = builder_rects(builder);
+	const UINT32 count = builder->nbRects - builder->curBand;
+	const RECTANGLE_16* band = &rects[builder->curBand];
+	RECTANGLE_16* prev;
+
+	if (count == 0)
+		return;
 
-	while (currentBand < endSrcRect)
+	if (builder->hasPrevBand && (builder->curBand - builder->prevBand == count))
 	{
-		if ((currentBand->bottom <= rect->top) || (rect->bottom <= currentBand->top) ||
-		    rectangle_contained_in_band(currentBand, endSrcRect, rect))
+		prev = &rects[builder->prevBand];
+
+		if (prev->bottom == band->top)
 		{
-			/* no overlap between rect and the band, rect is totally below or totally above
-			 * the current band, or rect is already covered by an item of the band.
-			 * let's copy all the rectangles from this band
-			            +----+
-			            |    |   rect (case 1)
-			            +----+
-
-			   =================
-			band of srcRect
-			 =================
-			        +----+
-			        |    |   rect (case 2)
-			        +----+
-			*/
-			region16_copy_band_with_union(dstRect, currentBand, endSrcRect, currentBand->top,
-			                              currentBand->bottom, NULL, &usedRects, &nextBand,
-			                              &dstRect);
-			topInterBand = rect->top;
+			for (index = 0; index < count; index++)
+			{
+				if ((prev[index].left != band[index].left) ||
+				    (prev[index].right != band[index].right))
+					break;
+			}
+
+			if (index == count)
+			{
+				for (index = 0; index < count; index++)
+					prev[index].bottom = band->bottom;
+
+				builder->nbRects = builder->curBand;
+				return;
+			}
 		}
-		else
+	}
+
+	builder->prevBand = builder->curBand;
+	builder->hasPrevBand = TRUE;
+}
+
+/* Replaces the content of dst with the built rectangles. */
+static BOOL builder_finish(REGION16_BUILDER* builder, REGION16* dst)
+{
+	UINT32 index;
+	REGION16_DATA* data;
+	const RECTANGLE_16* rects;
+	RECTANGLE_16 extents = { 0 };
+	const UINT32 nbRects = builder->nbRects;
+
+	if (builder->failed)
+	{
+		free(builder->data);
+		return FALSE;
+	}
+
+	rects = builder_rects(builder);
+
+	if (nbRects > 0)
+	{
+		extents = rects[0];
+		extents.bottom = rects[nbRects - 1].bottom;
+
+		for (index = 1; index < nbRects; index++)
 		{
-			/* rect overlaps the band:
-			           |    |  |    |
-			====^=================|    |==|    |=========================== band
-			|   top split     |    |  |    |
-			v                 | 1  |  | 2  |
-			^                 |    |  |    |  +----+   +----+
-			|   merge zone    |    |  |    |  |    |   | 4  |
-			v                 +----+  |    |  |    |   +----+
-			^                         |    |  | 3  |
-			|   bottom split          |    |  |    |
-			====v=========================|    |==|    |===================
-			           |    |  |    |
-
-			 possible cases:
-			 1) no top split, merge zone then a bottom split. The band will be splitted
-			  in two
-			 2) not band split, only the merge zone, band merged with rect but not splitted
-			 3) a top split, the merge zone and no bottom split. The band will be split
-			 in two
-			 4) a top split, the merge zone and also a bottom split. The band will be
-			 splitted in 3, but the coalesce algorithm may merge the created bands
-			 */
-			UINT16 mergeTop = currentBand->top;
-			UINT16 mergeBottom = currentBand->bottom;
-
-			/* test if we need a top split, case 3 and 4 */
-			if (rect->top > currentBand->top)
+			extents.left = MIN(extents.left, rects[index].left);
+			extents.right = MAX(extents.right, rects[index].right);
+		}
+	}
+
+	region16_clear(dst);
+
+	if (nbRects == 0)
+	{
+		free(builder->data);
+		return TRUE;
+	}
+
+	data = realloc(builder->data, sizeof(REGION16_DATA) + nbRects * sizeof(RECTANGLE_16));
+
+	if (data)
+		builder->data = data;
+
+	builder->data->size = sizeof(REGION16_DATA) + nbRects * sizeof(RECTANGLE_16);
+	builder->data->nbRects = nbRects;
+	dst->data = builder->data;
+	dst->extents = extents;
+	return TRUE;
+}
+
+/* Copies the spans of a band, clipped to a new top and bottom */
+static void builder_copy_band(REGION16_BUILDER* builder, const RECTANGLE_16* band,
+                              const RECTANGLE_16* bandEnd, UINT16 top, UINT16 bottom)
+{
+	if (top >= bottom)
+		return;
+
+	builder_begin_band(builder, top, bottom);
+
+	for (; band < bandEnd; band++)
+		builder_add_span(builder, band->left, band->right);
+
+	builder_end_band(builder);
+}
+
+typedef enum
+{
+	REGION16_OP_UNION,
+	REGION16_OP_SUBTRACT
+} REGION16_OP;
+
+static void region16_op_overlap(REGION16_BUILDER* builder, REGION16_OP op, const RECTANGLE_16* a,
+                                const RECTANGLE_16* aEnd, const RECTANGLE_16* b,
+                                const RECTANGLE_16* bEnd, UINT16 top, UINT16 bottom)
+{
+	builder_begin_band(builder, top, bottom);
+
+	if (op == REGION16_OP_UNION)
+	{
+		/* merge the spans of both bands sorted by their left side */
+		while ((a < aEnd) || (b < bEnd))
+		{
+			if ((b == bEnd) || ((a < aEnd) && (a->left <= b->left)))
 			{
-				region16_copy_band_with_union(dstRect, currentBand, endSrcRect, currentBand->top,
-				                              rect->top, NULL, &usedRects, &nextBand, &dstRect);
-				mergeTop = rect->top;
+				builder_add_span(builder, a->left, a->right);
+				a++;
 			}
+			else
+			{
+				builder_add_span(builder, b->left, b->right);
+				b++;
+			}
+		}
+	}
+	else
+	{
+		/* remove the spans of b from the spans of a */
+		for (; a < aEnd; a++)
+		{
+			UINT16 left = a->left;
 
-			/* do the merge zone (all cases) */
-			if (rect->bottom < currentBand->bottom)
-				mergeBottom = rect->bottom;
-
-			region16_copy_band_with_union(dstRect, currentBand, endSrcRect, mergeTop, mergeBottom,
-			                              rect, &usedRects, &nextBand, &dstRect);
+			while ((b < bEnd) && (b->right <= left))
+				b++;
 
-			/* test if we need a bottom split, case 1 and 4 */
-			if (rect->bottom < currentBand->bottom)
+			while ((b < bEnd) && (b->left < a->right))
 			{
-				region16_copy_band_with_union(dstRect, currentBand, endSrcRect, mergeBottom,
-				                              currentBand->bottom, NULL, &usedRects, &nextBand,
-				                              &dstRect);
+				builder_add_span(builder, left, b->left);
+				left = MAX(left, b->right);
+
+				if (b->right > a->right)
+					break;
+
+				b++;
 			}
 
-			topInterBand = currentBand->bottom;
+			builder_add_span(builder, left, a->right);
 		}
+	}
+
+	builder_end_band(builder);
+}
+
+static const RECTANGLE_16* region16_band_end(const RECTANGLE_16* band, const RECTANGLE_16* end)
+{
+	const UINT16 top = band->top;
+
+	while ((band < end) && (band->top == top))
+		band++;
 
-		/* test if a piece of rect should be inserted as a new band between
-		 * the current band and the next one. band n and n+1 shouldn't touch.
-		 *
-		 * ==============================================================
-		 *                                                        band n
-		 *            +------+                    +------+
-		 * ===========| rect |====================|      |===============
-		 *            |      |    +------+        |      |
-		 *            +------+    | rect |        | rect |
-		 *                        +------+        |      |
-		 * =======================================|      |================
-		 *                                        +------+         band n+1
-		 * ===============================================================
-		 *
-		 */
-		if ((nextBand < endSrcRect) && (nextBand->top != currentBand->bottom) &&
-		    (rect->bottom > currentBand->bottom) && (rect->top < nextBand->top))
+	return band;
+}
+
+/** Applies op to the banded rectangle lists a and b with a single sweep over the bands
+ * (pixman's region_op). Bands are split where the bands of a and b start and end, the builder
+ * joins the pieces again when the result of neighbouring pieces is the same.
+ */
+static BOOL region16_op(REGION16* dst, const RECTANGLE_16* a, UINT32 aCount, const RECTANGLE_16* b,
+                        UINT32 bCount, REGION16_OP op)
+{
+	REGION16_BUILDER builder;
+	const RECTANGLE_16* aEnd = a + aCount;
+	const RECTANGLE_16* bEnd = b + bCount;
+	const BOOL appendB = (op == REGION16_OP_UNION);
+	UINT16 ybot = 0;
+
+	if (!builder_init(&builder, ((size_t)aCount + bCount) * 2))
+		return FALSE;
+
+	if ((a < aEnd) && (b < bEnd))
+		ybot = MIN(a->top, b->top);
+
+	while ((a < aEnd) && (b < bEnd))
+	{
+		UINT16 ytop;
+		const RECTANGLE_16* aBandEnd = region16_band_end(a, aEnd);
+		const RECTANGLE_16* bBandEnd = region16_band_end(b, bEnd);
+
+		if (a->top < b->top)
 		{
-			dstRect->right = rect->right;
-			dstRect->left = rect->left;
-			dstRect->top = topInterBand;
-			dstRect->bottom = MIN(nextBand->top, rect->bottom);
-			dstRect++;
-			usedRects++;
+			/* part of the a band above the b band */
+			builder_copy_band(&builder, a, aBandEnd, MAX(a->top, ybot), MIN(a->bottom, b->top));
+			ytop = b->top;
+		}
+		else if (b->top < a->top)
+		{
+			if (appendB)
+				builder_copy_band(&builder, b, bBandEnd, MAX(b->top, ybot),
+				                  MIN(b->bottom, a->top));
+
+			ytop = a->top;
 		}
+		else
+			ytop = a->top;
+
+		ybot = MIN(a->bottom, b->bottom);
+
+		if (ybot > ytop)
+			region16_op_overlap(&builder, op, a, aBandEnd, b, bBandEnd, ytop, ybot);
 
-		currentBand = nextBand;
+		if (a->bottom == ybot)
+			a = aBandEnd;
+
+		if (b->bottom == ybot)
+			b = bBandEnd;
 	}
 
-	/* adds the piece of rect that is below src */
-	if (srcExtents->bottom < rect->bottom)
+	while (a < aEnd)
 	{
-		dstRect->top = MAX(srcExtents->bottom, rect->top);
-		dstRect->left = rect->left;
-		dstRect->right = rect->right;
-		dstRect->bottom = rect->bottom;
-		usedRects++;
-		dstRect++;
+		const RECTANGLE_16* aBandEnd = region16_band_end(a, aEnd);
+		builder_copy_band(&builder, a, aBandEnd, MAX(a->top, ybot), a->bottom);
+		a = aBandEnd;
 	}
 
-	if ((src == dst) && (src->data->size > 0) && (src->data != &empty_region))
-		free(src->data);
+	while (appendB && (b < bEnd))
+	{
+		const RECTANGLE_16* bBandEnd = region16_band_end(b, bEnd);
+		builder_copy_band(&builder, b, bBandEnd, MAX(b->top, ybot), b->bottom);
+		b = bBandEnd;
+	}
 
-	dstExtents->top = MIN(rect->top, srcExtents->top);
-	dstExtents->left = MIN(rect->left, srcExtents->left);
-	dstExtents->bottom = MAX(rect->bottom, srcExtents->bottom);
-	dstExtents->right = MAX(rect->right, srcExtents->right);
-	newItems->size = sizeof(REGION16_DATA) + (usedRects * sizeof(RECTANGLE_16));
-	tmpItems = realloc(newItems, newItems->size);
-	if (!tmpItems)
-		free(newItems);
-	newItems = tmpItems;
-	dst->data = newItems;
+	return builder_finish(&builder, dst);
+}
 
-	if (!dst->data)
+BOOL region16_union_rect(REGION16* dst, const REGION16* src, const RECTANGLE_16* rect)
+{
+	UINT32 nbRects;
+	const RECTANGLE_16* rects;
+
+	WINPR_ASSERT(src);
+	WINPR_ASSERT(src->data);
+	WINPR_ASSERT(dst);
+	WINPR_ASSERT(rect);
+
+	if (rectangle_is_empty(rect))
+		return region16_copy(dst, src);
+
+	rects = region16_rects(src, &nbRects);
+	return region16_op(dst, rects, nbRects, rect, 1, REGION16_OP_UNION);
+}
+
+BOOL region16_union_region(REGION16* dst, const REGION16* src1, const REGION16* src2)
+{
+	UINT32 nbRects1, nbRects2;
+	const RECTANGLE_16 *rects1, *rects2;
+
+	WINPR_ASSERT(src1);
+	WINPR_ASSERT(src2);
+	WINPR_ASSERT(dst);
+
+	rects1 = region16_rects(src1, &nbRects1);
+	rects2 = region16_rects(src2, &nbRects2);
+	return region16_op(dst, rects1, nbRects1, rects2, nbRects2, REGION16_OP_UNION);
+}
+
+BOOL region16_subtract_rect(REGION16* dst, const REGION16* src, const RECTANGLE_16* rect)
+{
+	UINT32 nbRects;
+	const RECTANGLE_16* rects;
+
+	WINPR_ASSERT(src);
+	WINPR_ASSERT(dst);
+	WINPR_ASSERT(rect);
+
+	if (rectangle_is_empty(rect))
+		return region16_copy(dst, src);
+
+	rects = region16_rects(src, &nbRects);
+	return region16_op(dst, rects, nbRects, rect, 1, REGION16_OP_SUBTRACT);
+}
+
+BOOL region16_subtract_region(REGION16* dst, const REGION16* src1, const REGION16* src2)
+{
+	UINT32 nbRects1, nbRects2;
+	const RECTANGLE_16 *rects1, *rects2;
+
+	WINPR_ASSERT(src1);
+	WINPR_ASSERT(src2);
+	WINPR_ASSERT(dst);
+
+	rects1 = region16_rects(src1, &nbRects1);
+	rects2 = region16_rects(src2, &nbRects2);
+	return region16_op(dst, rects1, nbRects1, rects2, nbRects2, REGION16_OP_SUBTRACT);
+}
+
+static int region16_compare_top(const void* pa, const void* pb)
+{
+	const RECTANGLE_16* a = *(const RECTANGLE_16* const*)pa;
+	const RECTANGLE_16* b = *(const RECTANGLE_16* const*)pb;
+	return (int)a->top - (int)b->top;
+}
+
+static int region16_compare_y(const void* pa, const void* pb)
+{
+	return (int)*(const UINT16*)pa - (int)*(const UINT16*)pb;
+}
+
+/** Bands the (possibly overlapping) rectangles with a sweep from top to bottom. Between two
+ * consecutive edges the rectangles crossing the sweep line, kept sorted by their left side,
+ * make up one band.
+ */
+static BOOL region16_from_rects(REGION16* dst, const RECTANGLE_16* rects, UINT32 count)
+{
+	UINT32 index;
+	UINT32 nbSorted = 0;
+	UINT32 nbEdges = 0;
+	UINT32 nbActive = 0;
+	UINT32 next = 0;
+	BOOL rc = FALSE;
+	REGION16_BUILDER builder = { 0 };
+	/* one scratch allocation holds the sorted rectangles, the active list and the edges */
+	void* scratch = calloc(count, 2 * sizeof(RECTANGLE_16*) + 2 * sizeof(UINT16));
+	const RECTANGLE_16** sorted = (const RECTANGLE_16**)scratch;
+	const RECTANGLE_16** active = sorted + count;
+	UINT16* edges = (UINT16*)(active + count);
+
+	if (!scratch || !builder_init(&builder, (size_t)count * 2))
+		goto fail;
+
+	for (index = 0; index < count; index++)
 	{
-		free(newItems);
-		return FALSE;
+		if (rectangle_is_empty(&rects[index]))
+			continue;
+
+		sorted[nbSorted++] = &rects[index];
+		edges[nbEdges++] = rects[index].top;
+		edges[nbEdges++] = rects[index].bottom;
 	}
 
-	dst->data->nbRects = usedRects;
-	return region16_simplify_bands(dst);
+	qsort((void*)sorted, nbSorted, sizeof(RECTANGLE_16*), region16_compare_top);
+	qsort(edges, nbEdges, sizeof(UINT16), region16_compare_y);
+
+	for (index = 0; index + 1 < nbEdges; index++)
+	{
+		UINT32 i, j;
+		const UINT16 top = edges[index];
+		const UINT16 bottom = edges[index + 1];
+
+		if (top == bottom)
+			continue;
+
+		/* drop rectangles above the sweep line */
+		for (i = 0, j = 0; i < nbActive; i++)
+		{
+			if (active[i]->bottom > top)
+				active[j++] = active[i];
+		}
+
+		nbActive = j;
+
+		/* insert starting rectangles sorted by their left side */
+		for (; (next < nbSorted) && (sorted[next]->top <= top); next++)
+		{
+			const RECTANGLE_16* rect = sorted[next];
+
+			for (i = nbActive; (i > 0) && (active[i - 1]->left > rect->left); i--)
+				active[i] = active[i - 1];
+
+			active[i] = rect;
+			nbActive++;
+		}
+
+		builder_begin_band(&builder, top, bottom);
+
+		for (i = 0; i < nbActive; i++)
+			builder_add_span(&builder, active[i]->left, active[i]->right);
+
+		builder_end_band(&builder);
+	}
+
+	rc = builder_finish(&builder, dst);
+	builder.data = NULL;
+fail:
+	if (builder.data)
+		free(builder.data);
+
+	free(scratch);
+	return rc;
+}
+
+BOOL region16_union_rects(REGION16* dst, const REGION16* src, const RECTANGLE_16* rects,
+                          UINT32 count)
+{
+	BOOL rc;
+	REGION16 added;
+
+	WINPR_ASSERT(src);
+	WINPR_ASSERT(dst);
+	WINPR_ASSERT(rects || (count == 0));
+
+	if (count == 0)
+		return region16_copy(dst, src);
+
+	region16_init(&added);
+
+	if (region16_is_empty(src))
+		return region16_from_rects(dst, rects, count);
+
+	rc = region16_from_rects(&added, rects, count) && region16_union_region(dst, src, &added);
+	region16_uninit(&added);
+	return rc;
 }
 
 BOOL region16_intersects_rect(const REGION16* src, const RECTANGLE_16* arg2)
@@ -227,6 +227,25 @@ static void rfx_dwt_2d_decode_NEON(INT16* buffer, INT16* dwt_buffer)
 	rfx_dwt_2d_decode_block_NEON(buffer, dwt_buffer, 32);
 }
 
+/* Skips blocks of eight zero coefficients, the remainder is checked one by one */
+UINT32 rfx_rlgr_zero_run_neon(const INT16* data, UINT32 size)
+{
+	UINT32 n = 0;
+
+	for (; n + 8 <= size; n += 8)
+	{
+		const uint64x2_t val = vreinterpretq_u64_s16(vld1q_s16(&data[n]));
+
+		if ((vgetq_lane_u64(val, 0) | vgetq_lane_u64(val, 1)) != 0)
+			break;
+	}
+
+	while ((n < size) && (data[n] == 0))
+		n++;
+
+	return n;
+}
+
 void rfx_init_neon(RFX_CONTEXT* context)
 {
 	if (IsProcessorFeaturePresent(PF_ARM_NEON_INSTRUCTIONS_AVAILABLE))
@@ -24,6 +24,7 @@
 #include <freerdp/api.h>
 
 FREERDP_LOCAL void rfx_init_neon(RFX_CONTEXT* context);
+FREERDP_LOCAL UINT32 rfx_rlgr_zero_run_neon(const INT16* data, UINT32 size);
 
 #ifndef RFX_INIT_SIMD
 #if defined(WITH_NEON)
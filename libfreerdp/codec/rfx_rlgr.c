@@ -36,9 +36,9 @@
 #include <winpr/bitstream.h>
 #include <winpr/intrin.h>
 
-#include "rfx_bitstream.h"
-
 #include "rfx_rlgr.h"
+#include "rfx_sse2.h"
+#include "rfx_neon.h"
 
 /* Constants used in RLGR1/RLGR3 algorithm */
 #define KPMAX (80) /* max value for kp or krp */
@@ -48,19 +48,6 @@
 #define UQ_GR (3)  /* increase in kp after nonzero symbol in GR mode */
 #define DQ_GR (3)  /* decrease in kp after zero symbol in GR mode */
 
-/* Returns the least number of bits required to represent a given value */
-#define GetMinBits(_val, _nbits) \
-	do                           \
-	{                            \
-		UINT32 _v = _val;        \
-		_nbits = 0;              \
-		while (_v)               \
-		{                        \
-			_v >>= 1;            \
-			_nbits++;            \
-		}                        \
-	} while (0)
-
 /*
  * Update the passed parameter and clamp it to the range [0, KPMAX]
  * Return the value of parameter right-shifted by LSGR
@@ -76,13 +63,67 @@
 		_k = (_param >> LSGR);           \
 	} while (0)
 
+/* Golomb/Rice codes of small values are looked up, longer codes are built bit by bit */
+#define RLGR_GR_TABLE_VALUES (64)
+
+typedef struct
+{
+	UINT32 bits;
+	UINT32 length; /* 0 if the code is longer than 32 bits */
+} RFX_RLGR_CODE;
+
+typedef UINT32 (*rfx_rlgr_zero_run_fn)(const INT16* data, UINT32 size);
+
+/* Returns the number of leading zero coefficients */
+static UINT32 rfx_rlgr_zero_run_generic(const INT16* data, UINT32 size)
+{
+	UINT32 n = 0;
+
+	while ((n < size) && (data[n] == 0))
+		n++;
+
+	return n;
+}
+
 static BOOL g_LZCNT = FALSE;
+static rfx_rlgr_zero_run_fn g_ZeroRun = rfx_rlgr_zero_run_generic;
+static RFX_RLGR_CODE g_GRCodes[(KPMAX >> LSGR) + 1][RLGR_GR_TABLE_VALUES];
 
 static INIT_ONCE rfx_rlgr_init_once = INIT_ONCE_STATIC_INIT;
 
 static BOOL CALLBACK rfx_rlgr_init(PINIT_ONCE once, PVOID param, PVOID* context)
 {
+	UINT32 kr, val;
+
 	g_LZCNT = IsProcessorFeaturePresentEx(PF_EX_LZCNT);
+#if defined(WITH_SSE2)
+
+	if (IsProcessorFeaturePresent(PF_XMMI64_INSTRUCTIONS_AVAILABLE))
+		g_ZeroRun = rfx_rlgr_zero_run_sse2;
+
+#elif defined(WITH_NEON)
+
+	if (IsProcessorFeaturePresent(PF_ARM_NEON_INSTRUCTIONS_AVAILABLE))
+		g_ZeroRun = rfx_rlgr_zero_run_neon;
+
+#endif
+
+	for (kr = 0; kr < ARRAYSIZE(g_GRCodes); kr++)
+	{
+		for (val = 0; val < RLGR_GR_TABLE_VALUES; val++)
+		{
+			/* vk ones, a zero and the kr bit remainder */
+			const UINT32 vk = val >> kr;
+			const UINT32 length = vk + 1 + kr;
+
+			if (length > 32)
+				continue;
+
+			g_GRCodes[kr][val].bits = (((1u << vk) - 1) << (kr + 1)) | (val & ((1u << kr) - 1));
+			g_GRCodes[kr][val].length = length;
+		}
+	}
+
 	return TRUE;
 }
 
@@ -558,81 +599,130 @@ int rfx_rlgr_decode(RLGR_MODE mode, const BYTE* pSrcData, UINT32 SrcSize, INT16*
 	return 1;
 }
 
-/* Returns the next coefficient (a signed int) to encode, from the input stream */
-#define GetNextInput(_n)   \
-	do                     \
-	{                      \
-		if (data_size > 0) \
-		{                  \
-			_n = *data++;  \
-			data_size--;   \
-		}                  \
-		else               \
-		{                  \
-			_n = 0;        \
-		}                  \
-	} while (0)
+/* Bit writer collecting up to 63 bits in an accumulator, stored 32 bits at a time */
+typedef struct
+{
+	BYTE* buffer;
+	UINT32 length;
+	UINT32 position;
+	UINT64 accumulator;
+	UINT32 count;
+} RFX_RLGR_WRITER;
+
+static INLINE void rfx_rlgr_writer_store(RFX_RLGR_WRITER* writer, UINT32 value, UINT32 bytes)
+{
+	UINT32 index;
 
-/* Emit bitPattern to the output bitstream */
-#define OutputBits(numBits, bitPattern) rfx_bitstream_put_bits(bs, bitPattern, numBits)
-
-/* Emit a bit (0 or 1), count number of times, to the output bitstream */
-#define OutputBit(count, bit)                                    \
-	do                                                           \
-	{                                                            \
-		UINT16 _b = (bit ? 0xFFFF : 0);                          \
-		int _c = (count);                                        \
-		for (; _c > 0; _c -= 16)                                 \
-			rfx_bitstream_put_bits(bs, _b, (_c > 16 ? 16 : _c)); \
-	} while (0)
+	/* Output exceeding the buffer is dropped */
+	if (bytes > writer->length - writer->position)
+		bytes = writer->length - writer->position;
 
-/* Converts the input value to (2 * abs(input) - sign(input)), where sign(input) = (input < 0 ? 1 :
- * 0) and returns it */
-#define Get2MagSign(input) ((input) >= 0 ? 2 * (input) : -2 * (input)-1)
+	for (index = 0; index < bytes; index++)
+		writer->buffer[writer->position++] = (BYTE)(value >> (24 - index * 8));
+}
+
+/* Emits the nbits (<= 32) lowest bits of value, most significant bit first */
+static INLINE void rfx_rlgr_put_bits(RFX_RLGR_WRITER* writer, UINT32 value, UINT32 nbits)
+{
+	writer->accumulator = (writer->accumulator << nbits) | value;
+	writer->count += nbits;
+
+	if (writer->count >= 32)
+	{
+		writer->count -= 32;
+		rfx_rlgr_writer_store(writer, (UINT32)(writer->accumulator >> writer->count), 4);
+	}
+}
 
-/* Outputs the Golomb/Rice encoding of a non-negative integer */
-#define CodeGR(krp, val) rfx_rlgr_code_gr(bs, krp, val)
+static INLINE void rfx_rlgr_put_ones(RFX_RLGR_WRITER* writer, UINT32 count)
+{
+	for (; count > 32; count -= 32)
+		rfx_rlgr_put_bits(writer, 0xFFFFFFFF, 32);
+
+	rfx_rlgr_put_bits(writer, (UINT32)((1ull << count) - 1), count);
+}
+
+static INLINE void rfx_rlgr_put_zeros(RFX_RLGR_WRITER* writer, UINT32 count)
+{
+	for (; count > 32; count -= 32)
+		rfx_rlgr_put_bits(writer, 0, 32);
+
+	rfx_rlgr_put_bits(writer, 0, count);
+}
+
+/* Appends as many zero bits as the last byte holds, which pads it and, if more than half of it
+ * is used, adds a zero byte. Returns the number of bytes written. */
+static INLINE UINT32 rfx_rlgr_writer_flush(RFX_RLGR_WRITER* writer)
+{
+	rfx_rlgr_put_bits(writer, 0, writer->count % 8);
+
+	if (writer->count > 0)
+	{
+		const UINT32 bytes = (writer->count + 7) / 8;
+		const UINT32 value = (UINT32)(writer->accumulator << (32 - writer->count));
+		rfx_rlgr_writer_store(writer, value, bytes);
+		writer->count = 0;
+	}
 
-static void rfx_rlgr_code_gr(RFX_BITSTREAM* bs, int* krp, UINT32 val)
+	return writer->position;
+}
+
+static INLINE UINT32 rfx_rlgr_zero_run(const INT16* data, UINT32 size)
 {
-	int kr = *krp >> LSGR;
+	UINT32 n = 0;
+
+	/* Most runs are short, only longer ones are worth a vector scan */
+	while ((n < size) && (n < 8) && (data[n] == 0))
+		n++;
 
-	/* unary part of GR code */
+	if ((n == 8) && (size > 8))
+		n += g_ZeroRun(&data[8], size - 8);
 
-	UINT32 vk = (val) >> kr;
-	OutputBit(vk, 1);
-	OutputBit(1, 0);
+	return n;
+}
+
+/* Emits the Golomb/Rice code of val and updates krp */
+static INLINE void rfx_rlgr_code_gr(RFX_RLGR_WRITER* writer, INT32* krp, UINT32 val)
+{
+	UINT32 kr = (UINT32)*krp >> LSGR;
+	const UINT32 vk = val >> kr;
 
-	/* remainder part of GR code, if needed */
-	if (kr)
+	if ((val < RLGR_GR_TABLE_VALUES) && (g_GRCodes[kr][val].length > 0))
+		rfx_rlgr_put_bits(writer, g_GRCodes[kr][val].bits, g_GRCodes[kr][val].length);
+	else
 	{
-		OutputBits(kr, val & ((1 << kr) - 1));
+		/* unary part followed by a 0 and the kr bit remainder */
+		rfx_rlgr_put_ones(writer, vk);
+		rfx_rlgr_put_bits(writer, val & ((1u << kr) - 1), kr + 1);
 	}
 
-	/* update krp, only if it is not equal to 1 */
+	/* update krp, only if vk is not equal to 1 */
 	if (vk == 0)
 	{
 		UpdateParam(*krp, -2, kr);
 	}
 	else if (vk > 1)
 	{
-		UpdateParam(*krp, vk, kr);
+		UpdateParam(*krp, (INT32)vk, kr);
 	}
 }
 
+/* Converts the input value to (2 * abs(input) - sign(input)), where sign(input) = (input < 0 ? 1 :
+ * 0) and returns it */
+#define Get2MagSign(input) ((input) >= 0 ? 2 * (input) : -2 * (input)-1)
+
 int rfx_rlgr_encode(RLGR_MODE mode, const INT16* data, UINT32 data_size, BYTE* buffer,
                     UINT32 buffer_size)
 {
-	int k;
-	int kp;
-	int krp;
-	RFX_BITSTREAM* bs;
-	int processed_size;
+	UINT32 k;
+	INT32 kp;
+	INT32 krp;
+	RFX_RLGR_WRITER writer = { 0 };
 
-	if (!(bs = (RFX_BITSTREAM*)calloc(1, sizeof(RFX_BITSTREAM))))
-		return 0;
+	InitOnceExecuteOnce(&rfx_rlgr_init_once, rfx_rlgr_init, NULL, NULL);
 
-	rfx_bitstream_attach(bs, buffer, buffer_size);
+	writer.buffer = buffer;
+	writer.length = buffer_size;
 
 	/* initialize the parameters */
 	k = 1;
@@ -642,51 +732,47 @@ int rfx_rlgr_encode(RLGR_MODE mode, const INT16* data, UINT32 data_size, BYTE* b
 	/* process all the input coefficients */
 	while (data_size > 0)
 	{
-		int input;
+		INT32 input;
 
 		if (k)
 		{
-			int numZeros;
-			int runmax;
-			int mag;
-			int sign;
+			UINT32 numZeros;
+			UINT32 runs = 0;
+			UINT32 mag;
 
 			/* RUN-LENGTH MODE */
 
-			/* collect the run of zeros in the input stream */
-			numZeros = 0;
-			GetNextInput(input);
-			while (input == 0 && data_size > 0)
-			{
-				numZeros++;
-				GetNextInput(input);
-			}
+			/* collect the run of zeros in the input stream, a run reaching the end of the
+			   input is terminated by its last zero */
+			numZeros = rfx_rlgr_zero_run(data, data_size);
+
+			if (numZeros == data_size)
+				numZeros--;
+
+			input = data[numZeros];
+			data += numZeros + 1;
+			data_size -= numZeros + 1;
 
-			// emit output zeros
-			runmax = 1 << k;
-			while (numZeros >= runmax)
+			/* emit a zero bit for every complete run */
+			while (numZeros >= (1u << k))
 			{
-				OutputBit(1, 0); /* output a zero bit */
-				numZeros -= runmax;
+				numZeros -= 1u << k;
+				runs++;
 				UpdateParam(kp, UP_GR, k); /* update kp, k */
-				runmax = 1 << k;
 			}
 
-			/* output a 1 to terminate runs */
-			OutputBit(1, 1);
-
-			/* output the remaining run length using k bits */
-			OutputBits(k, numZeros);
+			rfx_rlgr_put_zeros(&writer, runs);
 
 			/* note: when we reach here and the last byte being encoded is 0, we still
 			   need to output the last two bits, otherwise mstsc will crash */
 
-			/* encode the nonzero value using GR coding */
-			mag = (input < 0 ? -input : input); /* absolute value of input coefficient */
-			sign = (input < 0 ? 1 : 0);         /* sign of input coefficient */
+			/* a 1 terminating the runs, the remaining run length using k bits and the sign */
+			mag = (UINT32)(input < 0 ? -input : input);
+			rfx_rlgr_put_bits(&writer, (1u << (k + 1)) | (numZeros << 1) | (input < 0 ? 1 : 0),
+			                  k + 2);
 
-			OutputBit(1, sign);              /* output the sign bit */
-			CodeGR(&krp, mag ? mag - 1 : 0); /* output GR code for (mag - 1) */
+			/* encode the nonzero value using GR coding */
+			rfx_rlgr_code_gr(&writer, &krp, mag ? mag - 1 : 0);
 
 			UpdateParam(kp, -DN_GR, k);
 		}
@@ -701,9 +787,10 @@ int rfx_rlgr_encode(RLGR_MODE mode, const INT16* data, UINT32 data_size, BYTE* b
 				/* RLGR1 variant */
 
 				/* convert input to (2*magnitude - sign), encode using GR code */
-				GetNextInput(input);
-				twoMs = Get2MagSign(input);
-				CodeGR(&krp, twoMs);
+				input = *data++;
+				data_size--;
+				twoMs = (UINT32)Get2MagSign(input);
+				rfx_rlgr_code_gr(&writer, &krp, twoMs);
 
 				/* update k, kp */
 				/* NOTE: as of Aug 2011, the algorithm is still wrongly documented
@@ -720,29 +807,35 @@ int rfx_rlgr_encode(RLGR_MODE mode, const INT16* data, UINT32 data_size, BYTE* b
 			else /* mode == RLGR3 */
 			{
 				UINT32 twoMs1;
-				UINT32 twoMs2;
+				UINT32 twoMs2 = 0;
 				UINT32 sum2Ms;
-				UINT32 nIdx;
+				UINT32 nIdx = 0;
 
 				/* RLGR3 variant */
 
 				/* convert the next two input values to (2*magnitude - sign) and */
-				/* encode their sum using GR code */
+				/* encode their sum using GR code, missing input is taken as 0 */
+				input = *data++;
+				data_size--;
+				twoMs1 = (UINT32)Get2MagSign(input);
 
-				GetNextInput(input);
-				twoMs1 = Get2MagSign(input);
-				GetNextInput(input);
-				twoMs2 = Get2MagSign(input);
-				sum2Ms = twoMs1 + twoMs2;
+				if (data_size > 0)
+				{
+					input = *data++;
+					data_size--;
+					twoMs2 = (UINT32)Get2MagSign(input);
+				}
 
-				CodeGR(&krp, sum2Ms);
+				sum2Ms = twoMs1 + twoMs2;
+				rfx_rlgr_code_gr(&writer, &krp, sum2Ms);
 
 				/* encode binary representation of the first input (twoMs1). */
-				GetMinBits(sum2Ms, nIdx);
-				OutputBits(nIdx, twoMs1);
+				if (sum2Ms)
+					nIdx = 32 - lzcnt_s(sum2Ms);
 
-				/* update k,kp for the two input values */
+				rfx_rlgr_put_bits(&writer, twoMs1, nIdx);
 
+				/* update k,kp for the two input values */
 				if (twoMs1 && twoMs2)
 				{
 					UpdateParam(kp, -2 * DQ_GR, k);
@@ -755,9 +848,5 @@ int rfx_rlgr_encode(RLGR_MODE mode, const INT16* data, UINT32 data_size, BYTE* b
 		}
 	}
 
-	rfx_bitstream_flush(bs);
-	processed_size = rfx_bitstream_get_processed_bytes(bs);
-	free(bs);
-
-	return processed_size;
+	return (int)rfx_rlgr_writer_flush(&writer);
 }
@@ -455,6 +455,26 @@ static void rfx_dwt_2d_encode_sse2(INT16* buffer, INT16* dwt_buffer)
 	rfx_dwt_2d_encode_block_sse2(buffer + 3840, dwt_buffer, 8);
 }
 
+/* Skips blocks of eight zero coefficients, the remainder is checked one by one */
+UINT32 rfx_rlgr_zero_run_sse2(const INT16* data, UINT32 size)
+{
+	UINT32 n = 0;
+	const __m128i zero = _mm_setzero_si128();
+
+	for (; n + 8 <= size; n += 8)
+	{
+		const __m128i val = _mm_loadu_si128((const __m128i*)&data[n]);
+
+		if (_mm_movemask_epi8(_mm_cmpeq_epi16(val, zero)) != 0xFFFF)
+			break;
+	}
+
+	while ((n < size) && (data[n] == 0))
+		n++;
+
+	return n;
+}
+
 void rfx_init_sse2(RFX_CONTEXT* context)
 {
 	if (!IsProcessorFeaturePresent(PF_XMMI64_INSTRUCTIONS_AVAILABLE))
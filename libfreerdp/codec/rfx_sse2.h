@@ -24,6 +24,7 @@
 #include <freerdp/api.h>
 
 FREERDP_LOCAL void rfx_init_sse2(RFX_CONTEXT* context);
+FREERDP_LOCAL UINT32 rfx_rlgr_zero_run_sse2(const INT16* data, UINT32 size);
 
 #ifdef WITH_SSE2
 #ifndef RFX_INIT_SIMD
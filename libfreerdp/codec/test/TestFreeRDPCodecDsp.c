@@ -0,0 +1,527 @@
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <math.h>
+
+#include <winpr/crt.h>
+#include <winpr/crypto.h>
+#include <winpr/stream.h>
+#include <winpr/sysinfo.h>
+
+#include <freerdp/codec/dsp.h>
+#include <freerdp/codec/audio.h>
+#include <freerdp/utils/profiler.h>
+
+#if !defined(WITH_DSP_FFMPEG) && !defined(WITH_SOXR)
+
+#define TEST_PI 3.14159265358979323846
+#define TEST_AMPLITUDE 16000.0
+#define TEST_FREQUENCY 1000.0
+
+static AUDIO_FORMAT test_pcm_format(UINT32 rate, UINT16 channels)
+{
+	AUDIO_FORMAT format = { 0 };
+	format.wFormatTag = WAVE_FORMAT_PCM;
+	format.nChannels = channels;
+	format.nSamplesPerSec = rate;
+	format.wBitsPerSample = 16;
+	format.nBlockAlign = 2 * channels;
+	format.nAvgBytesPerSec = rate * format.nBlockAlign;
+	return format;
+}
+
+static INT16 test_read_int16(const BYTE* src)
+{
+	return (INT16)(src[0] | (src[1] << 8));
+}
+
+static void test_write_int16(BYTE* dst, INT32 val)
+{
+	dst[1] = (val >> 8) & 0xFF;
+	dst[0] = val & 0xFF;
+}
+
+static BYTE* test_sine(UINT32 rate, UINT16 channels, size_t frames)
+{
+	size_t x, c;
+	BYTE* data = calloc(frames * channels, sizeof(INT16));
+
+	if (!data)
+		return NULL;
+
+	for (x = 0; x < frames; x++)
+	{
+		const double val = TEST_AMPLITUDE * sin(2.0 * TEST_PI * TEST_FREQUENCY * x / rate);
+
+		for (c = 0; c < channels; c++)
+			test_write_int16(&data[(x * channels + c) * 2], (INT32)lrint(val));
+	}
+
+	return data;
+}
+
+static BOOL test_encode(const AUDIO_FORMAT* src, const AUDIO_FORMAT* dst, const BYTE* data,
+                        size_t length, wStream* out)
+{
+	BOOL rc = FALSE;
+	FREERDP_DSP_CONTEXT* context = freerdp_dsp_context_new(TRUE);
+
+	if (!context)
+		return FALSE;
+
+	if (!freerdp_dsp_context_reset(context, dst, 0))
+		goto fail;
+
+	Stream_SetPosition(out, 0);
+
+	if (!freerdp_dsp_encode(context, src, data, length, out))
+		goto fail;
+
+	Stream_SealLength(out);
+	rc = TRUE;
+fail:
+	freerdp_dsp_context_free(context);
+	return rc;
+}
+
+static BOOL test_channel_mix(void)
+{
+	size_t x;
+	BOOL rc = FALSE;
+	const size_t frames = 1021;
+	const AUDIO_FORMAT mono = test_pcm_format(44100, 1);
+	const AUDIO_FORMAT stereo = test_pcm_format(44100, 2);
+	BYTE* data = calloc(frames, 4);
+	wStream* out = Stream_New(NULL, 1024);
+
+	if (!data || !out)
+		goto fail;
+
+	winpr_RAND(data, frames * 4);
+
+	if (!test_encode(&mono, &stereo, data, frames * 2, out))
+		goto fail;
+
+	if (Stream_Length(out) != frames * 4)
+		goto fail;
+
+	for (x = 0; x < frames; x++)
+	{
+		const BYTE* dst = Stream_Buffer(out);
+
+		if ((test_read_int16(&dst[4 * x]) != test_read_int16(&data[2 * x])) ||
+		    (test_read_int16(&dst[4 * x + 2]) != test_read_int16(&data[2 * x])))
+		{
+			fprintf(stderr, "mono to stereo mismatch at frame %" PRIuz "\n", x);
+			goto fail;
+		}
+	}
+
+	if (!test_encode(&stereo, &mono, data, frames * 4, out))
+		goto fail;
+
+	if (Stream_Length(out) != frames * 2)
+		goto fail;
+
+	for (x = 0; x < frames; x++)
+	{
+		const BYTE* dst = Stream_Buffer(out);
+		const INT32 left = test_read_int16(&data[4 * x]);
+		const INT32 right = test_read_int16(&data[4 * x + 2]);
+
+		if (test_read_int16(&dst[2 * x]) != ((left + right) >> 1))
+		{
+			fprintf(stderr, "stereo to mono mismatch at frame %" PRIuz "\n", x);
+			goto fail;
+		}
+	}
+
+	rc = TRUE;
+fail:
+	free(data);
+	Stream_Free(out, TRUE);
+	return rc;
+}
+
+static BOOL test_resample(UINT32 srcRate, UINT32 dstRate, UINT16 channels)
+{
+	size_t x, c;
+	BOOL rc = FALSE;
+	const size_t frames = srcRate / 2;
+	const size_t expected = frames * dstRate / srcRate;
+	const size_t margin = 128 * dstRate / srcRate + 256;
+	const AUDIO_FORMAT src = test_pcm_format(srcRate, channels);
+	const AUDIO_FORMAT dst = test_pcm_format(dstRate, channels);
+	BYTE* data = test_sine(srcRate, channels, frames);
+	wStream* out = Stream_New(NULL, 1024);
+	size_t outFrames;
+	double maxError = 0.0;
+
+	if (!data || !out)
+		goto fail;
+
+	if (!test_encode(&src, &dst, data, frames * channels * 2, out))
+		goto fail;
+
+	outFrames = Stream_Length(out) / channels / 2;
+
+	if ((outFrames > expected + 1) || (outFrames + margin < expected))
+	{
+		fprintf(stderr, "%" PRIu32 " -> %" PRIu32 ": got %" PRIuz " frames, expected %" PRIuz "\n",
+		        srcRate, dstRate, outFrames, expected);
+		goto fail;
+	}
+
+	/* Skip the filter settle time at both ends and compare against the ideal signal */
+	for (x = margin; x + margin < outFrames; x++)
+	{
+		const double ref = TEST_AMPLITUDE * sin(2.0 * TEST_PI * TEST_FREQUENCY * x / dstRate);
+
+		for (c = 0; c < channels; c++)
+		{
+			const INT16 val = test_read_int16(&Stream_Buffer(out)[(x * channels + c) * 2]);
+			const double error = fabs(val - ref);
+
+			if (error > maxError)
+				maxError = error;
+		}
+	}
+
+	if (maxError > TEST_AMPLITUDE * 0.02)
+	{
+		fprintf(stderr, "%" PRIu32 " -> %" PRIu32 ": error %lf too large\n", srcRate, dstRate,
+		        maxError);
+		goto fail;
+	}
+
+	rc = TRUE;
+fail:
+	free(data);
+	Stream_Free(out, TRUE);
+	return rc;
+}
+
+static BOOL test_resample_chunked(void)
+{
+	size_t x;
+	BOOL rc = FALSE;
+	const size_t frames = 48000;
+	const size_t chunk = 441;
+	const AUDIO_FORMAT src = test_pcm_format(48000, 2);
+	const AUDIO_FORMAT dst = test_pcm_format(44100, 2);
+	BYTE* data = test_sine(48000, 2, frames);
+	wStream* single = Stream_New(NULL, 1024);
+	wStream* chunked = Stream_New(NULL, 1024);
+	FREERDP_DSP_CONTEXT* context = freerdp_dsp_context_new(TRUE);
+
+	if (!data || !single || !chunked || !context)
+		goto fail;
+
+	if (!test_encode(&src, &dst, data, frames * 4, single))
+		goto fail;
+
+	if (!freerdp_dsp_context_reset(context, &dst, 0))
+		goto fail;
+
+	/* Feeding the data in small packets must produce the same stream */
+	for (x = 0; x < frames; x += chunk)
+	{
+		const size_t count = MIN(chunk, frames - x);
+
+		if (!freerdp_dsp_encode(context, &src, &data[x * 4], count * 4, chunked))
+			goto fail;
+	}
+
+	Stream_SealLength(chunked);
+
+	if (Stream_Length(single) != Stream_Length(chunked))
+		goto fail;
+
+	if (memcmp(Stream_Buffer(single), Stream_Buffer(chunked), Stream_Length(single)) != 0)
+		goto fail;
+
+	rc = TRUE;
+fail:
+	freerdp_dsp_context_free(context);
+	free(data);
+	Stream_Free(single, TRUE);
+	Stream_Free(chunked, TRUE);
+	return rc;
+}
+
+static BOOL test_resample_performance(void)
+{
+	size_t x;
+	BOOL rc = FALSE;
+	const size_t frames = 48000;
+	const AUDIO_FORMAT src = test_pcm_format(48000, 2);
+	const AUDIO_FORMAT dst = test_pcm_format(44100, 2);
+	BYTE* data = test_sine(48000, 2, frames);
+	wStream* out = Stream_New(NULL, 1024);
+	FREERDP_DSP_CONTEXT* context = freerdp_dsp_context_new(TRUE);
+	UINT64 start, end;
+	PROFILER_DEFINE(profiler)
+	PROFILER_CREATE(profiler, "freerdp_dsp_encode 48000 -> 44100 stereo, 1s")
+
+	if (!data || !out || !context)
+		goto fail;
+
+	if (!freerdp_dsp_context_reset(context, &dst, 0))
+		goto fail;
+
+	start = GetTickCount64();
+
+	for (x = 0; x < 20; x++)
+	{
+		BOOL res;
+		Stream_SetPosition(out, 0);
+		PROFILER_ENTER(profiler)
+		res = freerdp_dsp_encode(context, &src, data, frames * 4, out);
+		PROFILER_EXIT(profiler)
+
+		if (!res)
+			goto fail;
+	}
+
+	end = GetTickCount64();
+	printf("resampled 20s of 48000Hz stereo audio to 44100Hz in %" PRIu64 "ms\n", end - start);
+	rc = TRUE;
+fail:
+	PROFILER_PRINT_HEADER
+	PROFILER_PRINT(profiler);
+	PROFILER_PRINT_FOOTER
+	PROFILER_FREE(profiler);
+	freerdp_dsp_context_free(context);
+	free(data);
+	Stream_Free(out, TRUE);
+	return rc;
+}
+
+#if defined(WITH_OPUS)
+static AUDIO_FORMAT test_opus_format(UINT32 rate, UINT16 channels)
+{
+	AUDIO_FORMAT format = { 0 };
+	format.wFormatTag = WAVE_FORMAT_OPUS;
+	format.nChannels = channels;
+	format.nSamplesPerSec = rate;
+	format.wBitsPerSample = 16;
+	format.nBlockAlign = 2 * channels;
+	format.nAvgBytesPerSec = 16000;
+	return format;
+}
+
+/* Walks the framing documented with WAVE_FORMAT_OPUS, returns the number of packets */
+static size_t test_opus_packets(const BYTE* data, size_t length)
+{
+	size_t count = 0;
+	size_t offset = 0;
+
+	while (offset + 2 <= length)
+	{
+		const size_t packet = (size_t)data[offset] | ((size_t)data[offset + 1] << 8);
+
+		if ((packet == 0) || (offset + 2 + packet > length))
+			return 0;
+
+		offset += 2 + packet;
+		count++;
+	}
+
+	return (offset == length) ? count : 0;
+}
+
+/* Opus is lossy and delays the signal, the decoded sine must match the original at some delay */
+static BOOL test_opus_compare(const BYTE* original, const BYTE* decoded, size_t frames,
+                              UINT32 rate, UINT16 channels)
+{
+	size_t x;
+	size_t delay;
+	double best = 0.0;
+	const size_t maxDelay = rate / 100;
+	const size_t skip = rate / 10; /* the encoder needs a few frames to settle */
+	const size_t count = (frames - skip - maxDelay) * channels;
+
+	for (delay = 0; delay <= maxDelay; delay++)
+	{
+		double sum = 0.0;
+		double energyA = 0.0;
+		double energyB = 0.0;
+		const BYTE* a = &original[skip * channels * sizeof(INT16)];
+		const BYTE* b = &decoded[(skip + delay) * channels * sizeof(INT16)];
+
+		for (x = 0; x < count; x++)
+		{
+			const double va = test_read_int16(&a[x * sizeof(INT16)]);
+			const double vb = test_read_int16(&b[x * sizeof(INT16)]);
+			sum += va * vb;
+			energyA += va * va;
+			energyB += vb * vb;
+		}
+
+		if ((energyA > 0.0) && (energyB > 0.0))
+			best = MAX(best, sum / sqrt(energyA * energyB));
+	}
+
+	if (best < 0.95)
+	{
+		printf("opus %" PRIu32 "Hz %" PRIu16 " channels: decoded signal correlates with %f\n",
+		       rate, channels, best);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+static BOOL test_opus_roundtrip(UINT32 rate, UINT16 channels)
+{
+	size_t x;
+	BOOL rc = FALSE;
+	const size_t frames = rate;
+	const size_t packetFrames = rate / 50;
+	const AUDIO_FORMAT pcm = test_pcm_format(rate, channels);
+	const AUDIO_FORMAT opus = test_opus_format(rate, channels);
+	BYTE* data = test_sine(rate, channels, frames);
+	wStream* encoded = Stream_New(NULL, 1024);
+	wStream* payload = Stream_New(NULL, 1024);
+	wStream* decoded = Stream_New(NULL, 1024);
+	wStream* redecoded = Stream_New(NULL, 1024);
+	FREERDP_DSP_CONTEXT* encoder = freerdp_dsp_context_new(TRUE);
+	FREERDP_DSP_CONTEXT* decoder = freerdp_dsp_context_new(FALSE);
+	UINT64 start, end;
+	PROFILER_DEFINE(encProfiler)
+	PROFILER_DEFINE(decProfiler)
+	PROFILER_CREATE(encProfiler, "opus encode 20ms")
+	PROFILER_CREATE(decProfiler, "opus decode 20ms")
+
+	if (!data || !encoded || !payload || !decoded || !redecoded || !encoder || !decoder)
+		goto fail;
+
+	if (!freerdp_dsp_supports_format(&opus, TRUE) || !freerdp_dsp_supports_format(&opus, FALSE))
+		goto fail;
+
+	if (!freerdp_dsp_context_reset(encoder, &opus, 0) ||
+	    !freerdp_dsp_context_reset(decoder, &opus, 0))
+		goto fail;
+
+	if (!freerdp_dsp_context_set_option(encoder, FREERDP_DSP_OPTION_COMPLEXITY, 5))
+		goto fail;
+
+	start = GetTickCount64();
+
+	/* Encode and decode packet by packet to measure the latency of a single frame */
+	for (x = 0; x + packetFrames <= frames; x += packetFrames)
+	{
+		BOOL res;
+		const size_t bytes = packetFrames * channels * sizeof(INT16);
+		Stream_SetPosition(encoded, 0);
+		PROFILER_ENTER(encProfiler)
+		res = freerdp_dsp_encode(encoder, &pcm, &data[x * channels * sizeof(INT16)], bytes,
+		                         encoded);
+		PROFILER_EXIT(encProfiler)
+
+		if (!res || (Stream_GetPosition(encoded) == 0) ||
+		    !Stream_EnsureRemainingCapacity(payload, Stream_GetPosition(encoded)))
+			goto fail;
+
+		Stream_Write(payload, Stream_Buffer(encoded), Stream_GetPosition(encoded));
+
+		PROFILER_ENTER(decProfiler)
+		res = freerdp_dsp_decode(decoder, &opus, Stream_Buffer(encoded),
+		                         Stream_GetPosition(encoded), decoded);
+		PROFILER_EXIT(decProfiler)
+
+		if (!res)
+			goto fail;
+	}
+
+	end = GetTickCount64();
+
+	if ((Stream_GetPosition(decoded) != frames * channels * sizeof(INT16)) ||
+	    !test_opus_compare(data, Stream_Buffer(decoded), frames, rate, channels))
+		goto fail;
+
+	/* All packets in one payload decode to the same samples as one packet per call */
+	if ((test_opus_packets(Stream_Buffer(payload), Stream_GetPosition(payload)) !=
+	     frames / packetFrames) ||
+	    !freerdp_dsp_context_reset(decoder, &opus, 0) ||
+	    !freerdp_dsp_decode(decoder, &opus, Stream_Buffer(payload), Stream_GetPosition(payload),
+	                        redecoded) ||
+	    (Stream_GetPosition(redecoded) != Stream_GetPosition(decoded)) ||
+	    (memcmp(Stream_Buffer(redecoded), Stream_Buffer(decoded), Stream_GetPosition(decoded)) !=
+	     0))
+	{
+		printf("opus %" PRIu32 "Hz %" PRIu16 " channels: payload framing broken\n", rate,
+		       channels);
+		goto fail;
+	}
+
+	printf("opus %" PRIu32 "Hz %" PRIu16 " channels: 1s round trip in %" PRIu64 "ms\n", rate,
+	       channels, end - start);
+	rc = TRUE;
+fail:
+	PROFILER_PRINT_HEADER
+	PROFILER_PRINT(encProfiler);
+	PROFILER_PRINT(decProfiler);
+	PROFILER_PRINT_FOOTER
+	PROFILER_FREE(encProfiler);
+	PROFILER_FREE(decProfiler);
+	freerdp_dsp_context_free(encoder);
+	freerdp_dsp_context_free(decoder);
+	free(data);
+	Stream_Free(encoded, TRUE);
+	Stream_Free(payload, TRUE);
+	Stream_Free(decoded, TRUE);
+	Stream_Free(redecoded, TRUE);
+	return rc;
+}
+#endif
+
+#endif
+
+int TestFreeRDPCodecDsp(int argc, char* argv[])
+{
+	WINPR_UNUSED(argc);
+	WINPR_UNUSED(argv);
+#if !defined(WITH_DSP_FFMPEG) && !defined(WITH_SOXR)
+
+	if (!test_channel_mix())
+		return -1;
+
+	if (!test_resample(48000, 44100, 2))
+		return -1;
+
+	if (!test_resample(44100, 48000, 2))
+		return -1;
+
+	if (!test_resample(8000, 48000, 1))
+		return -1;
+
+	if (!test_resample(48000, 16000, 1))
+		return -1;
+
+	if (!test_resample(11025, 44100, 2))
+		return -1;
+
+	if (!test_resample(22050, 48000, 1))
+		return -1;
+
+	if (!test_resample_chunked())
+		return -1;
+
+	if (!test_resample_performance())
+		return -1;
+
+#if defined(WITH_OPUS)
+
+	if (!test_opus_roundtrip(48000, 2))
+		return -1;
+
+	if (!test_opus_roundtrip(16000, 1))
+		return -1;
+
+#endif
+
+#endif
+	return 0;
+}
@@ -0,0 +1,467 @@
+#include <math.h>
+
+#include <winpr/crt.h>
+
+#include <freerdp/codec/color.h>
+#include <freerdp/codec/h264.h>
+
+#include "../h264.h"
+
+#define TEST_WIDTH 256
+#define TEST_HEIGHT 128
+#define TEST_FRAMES 8
+
+/* A lossless stand in for the H.264 backends, so the AVC444 stream handling is tested without
+ * an encoder library as well. Each frame carries a sequence number and the decoder only accepts
+ * the successor of the last frame it has seen, or frame 0 of a new encoder instance, like a
+ * real decoder that lacks the reference of a predicted frame. */
+struct _H264_STUB
+{
+	UINT32 frame;
+	wStream* s;
+	BYTE* planes[3];
+};
+typedef struct _H264_STUB H264_STUB;
+
+static H264_CONTEXT* stub_failing_encoder = NULL;
+
+static BOOL stub_init(H264_CONTEXT* h264)
+{
+	H264_STUB* stub = calloc(1, sizeof(H264_STUB));
+
+	if (!stub)
+		return FALSE;
+
+	stub->s = Stream_New(NULL, 1024);
+
+	if (!stub->s)
+	{
+		free(stub);
+		return FALSE;
+	}
+
+	h264->pSystemData = stub;
+	return TRUE;
+}
+
+static void stub_uninit(H264_CONTEXT* h264)
+{
+	size_t x;
+	H264_STUB* stub = (H264_STUB*)h264->pSystemData;
+
+	if (!stub)
+		return;
+
+	for (x = 0; x < 3; x++)
+		free(stub->planes[x]);
+
+	Stream_Free(stub->s, TRUE);
+	free(stub);
+	h264->pSystemData = NULL;
+}
+
+static void stub_plane_size(UINT32 width, UINT32 height, size_t plane, UINT32* pw, UINT32* ph)
+{
+	*pw = (plane == 0) ? width : (width + 1) / 2;
+	*ph = (plane == 0) ? height : (height + 1) / 2;
+}
+
+static int stub_compress(H264_CONTEXT* h264, const BYTE** pSrcYuv, const UINT32* pStride,
+                         BYTE** ppDstData, UINT32* pDstSize)
+{
+	size_t x, y;
+	H264_STUB* stub = (H264_STUB*)h264->pSystemData;
+
+	if (h264 == stub_failing_encoder)
+		return -1;
+
+	if (!Stream_EnsureCapacity(stub->s, 12ull + 2ull * h264->width * h264->height))
+		return -1;
+
+	Stream_SetPosition(stub->s, 0);
+	Stream_Write_UINT32(stub->s, stub->frame++);
+	Stream_Write_UINT32(stub->s, h264->width);
+	Stream_Write_UINT32(stub->s, h264->height);
+
+	for (x = 0; x < 3; x++)
+	{
+		UINT32 pw, ph;
+		stub_plane_size(h264->width, h264->height, x, &pw, &ph);
+
+		for (y = 0; y < ph; y++)
+			Stream_Write(stub->s, &pSrcYuv[x][y * pStride[x]], pw);
+	}
+
+	*ppDstData = Stream_Buffer(stub->s);
+	*pDstSize = (UINT32)Stream_GetPosition(stub->s);
+	return 1;
+}
+
+static int stub_decompress(H264_CONTEXT* h264, const BYTE* pSrcData, UINT32 SrcSize)
+{
+	size_t x;
+	UINT32 frame, width, height;
+	wStream sbuffer = { 0 };
+	wStream* s = &sbuffer;
+	H264_STUB* stub = (H264_STUB*)h264->pSystemData;
+
+	Stream_StaticInit(s, (BYTE*)pSrcData, SrcSize);
+
+	if (Stream_GetRemainingLength(s) < 12)
+		return -1;
+
+	Stream_Read_UINT32(s, frame);
+	Stream_Read_UINT32(s, width);
+	Stream_Read_UINT32(s, height);
+
+	if ((frame != 0) && (frame != stub->frame))
+	{
+		fprintf(stderr, "stub decoder got frame %" PRIu32 ", expected %" PRIu32 "\n", frame,
+		        stub->frame);
+		return -1;
+	}
+
+	stub->frame = frame + 1;
+
+	for (x = 0; x < 3; x++)
+	{
+		UINT32 pw, ph;
+		BYTE* plane;
+		stub_plane_size(width, height, x, &pw, &ph);
+
+		if (Stream_GetRemainingLength(s) < 1ull * pw * ph)
+			return -1;
+
+		plane = realloc(stub->planes[x], 1ull * pw * ph);
+
+		if (!plane)
+			return -1;
+
+		Stream_Read(s, plane, 1ull * pw * ph);
+		stub->planes[x] = plane;
+		h264->pYUVData[x] = plane;
+		h264->iStride[x] = pw;
+	}
+
+	return 1;
+}
+
+static H264_CONTEXT_SUBSYSTEM g_Subsystem_Stub = { "stub", stub_init, stub_uninit,
+	                                                stub_decompress, stub_compress };
+
+/* Saturated gradients moving with the frame number, so that both streams change every frame */
+static void fill_frame(BYTE* data, UINT32 step, UINT32 frame)
+{
+	UINT32 x, y;
+
+	for (y = 0; y < TEST_HEIGHT; y++)
+	{
+		BYTE* line = &data[y * step];
+
+		for (x = 0; x < TEST_WIDTH; x++)
+		{
+			const BYTE r = (BYTE)((x + frame * 4) * 255 / (TEST_WIDTH + TEST_FRAMES * 4));
+			const BYTE g = (BYTE)(y * 255 / TEST_HEIGHT);
+			const BYTE b = (BYTE)(255 - (x + y + frame * 2) / 2);
+			WriteColor(&line[x * 4], PIXEL_FORMAT_BGRX32,
+			           FreeRDPGetColor(PIXEL_FORMAT_BGRX32, r, g, b, 0xFF));
+		}
+	}
+}
+
+static double psnr(const BYTE* a, const BYTE* b, UINT32 step)
+{
+	UINT32 x, y;
+	double mse = 0.0;
+
+	for (y = 0; y < TEST_HEIGHT; y++)
+	{
+		for (x = 0; x < TEST_WIDTH; x++)
+		{
+			BYTE ra, ga, ba, rb, gb, bb;
+			SplitColor(ReadColor(&a[y * step + x * 4], PIXEL_FORMAT_BGRX32), PIXEL_FORMAT_BGRX32,
+			           &ra, &ga, &ba, NULL, NULL);
+			SplitColor(ReadColor(&b[y * step + x * 4], PIXEL_FORMAT_BGRX32), PIXEL_FORMAT_BGRX32,
+			           &rb, &gb, &bb, NULL, NULL);
+			mse += (ra - rb) * (ra - rb) + (ga - gb) * (ga - gb) + (ba - bb) * (ba - bb);
+		}
+	}
+
+	mse /= TEST_WIDTH * TEST_HEIGHT * 3.0;
+
+	if (mse == 0.0)
+		return 100.0;
+
+	return 10.0 * log10(255.0 * 255.0 / mse);
+}
+
+static BOOL test_avc444_frame(H264_CONTEXT* encoder, H264_CONTEXT* decoder, BYTE version,
+                              const BYTE* src, BYTE* dst, UINT32 step, BOOL quiet)
+{
+	INT32 status;
+	BOOL rc = FALSE;
+	BYTE op = 0;
+	BYTE* data = NULL;
+	BYTE* auxData = NULL;
+	UINT32 size = 0;
+	UINT32 auxSize = 0;
+	RDPGFX_H264_METABLOCK meta = { 0 };
+	RDPGFX_H264_METABLOCK auxMeta = { 0 };
+	const UINT32 codecId = (version == 2) ? RDPGFX_CODECID_AVC444v2 : RDPGFX_CODECID_AVC444;
+	const RECTANGLE_16 region = { 0, 0, TEST_WIDTH, TEST_HEIGHT };
+
+	status = avc444_compress(encoder, src, PIXEL_FORMAT_BGRX32, step, TEST_WIDTH, TEST_HEIGHT,
+	                         version, &region, &op, &data, &size, &auxData, &auxSize, &meta,
+	                         &auxMeta);
+
+	if (status < 0)
+	{
+		fprintf(stderr, "avc444_compress failed\n");
+		goto fail;
+	}
+
+	/* A chroma only update is sent as the first bitstream */
+	if (op == 2)
+		status = avc444_decompress(decoder, op, auxMeta.regionRects, auxMeta.numRegionRects,
+		                           auxData, auxSize, NULL, 0, NULL, 0, dst, PIXEL_FORMAT_BGRX32,
+		                           step, TEST_WIDTH, TEST_HEIGHT, codecId);
+	else if (status > 0)
+		status = avc444_decompress(decoder, op, meta.regionRects, meta.numRegionRects, data, size,
+		                           auxMeta.regionRects, auxMeta.numRegionRects, auxData, auxSize,
+		                           dst, PIXEL_FORMAT_BGRX32, step, TEST_WIDTH, TEST_HEIGHT,
+		                           codecId);
+
+	if (status < 0)
+	{
+		if (!quiet)
+			fprintf(stderr, "avc444_decompress failed\n");
+		goto fail;
+	}
+
+	rc = TRUE;
+fail:
+	free_h264_metablock(&meta);
+	free_h264_metablock(&auxMeta);
+	return rc;
+}
+
+static BOOL test_avc444_contexts(H264_CONTEXT* encoder, H264_CONTEXT* decoder, BOOL independent,
+                                 BOOL decoderIndependent)
+{
+	encoder->RateControlMode = H264_RATECONTROL_CQP;
+	encoder->QP = 10;
+
+	if (!h264_context_reset(encoder, TEST_WIDTH, TEST_HEIGHT) ||
+	    !h264_context_reset(decoder, TEST_WIDTH, TEST_HEIGHT))
+		return FALSE;
+
+	return h264_context_set_option(encoder, H264_CONTEXT_OPTION_INDEPENDENT_AUX_STREAM,
+	                               independent) &&
+	       h264_context_set_option(decoder, H264_CONTEXT_OPTION_INDEPENDENT_AUX_STREAM,
+	                               decoderIndependent);
+}
+
+/* Encode a few frames as AVC444 and decode them again. With independent streams the chroma
+ * stream has its own encoder and decoder, both sides must agree on the mode. */
+static int test_avc444_roundtrip(H264_CONTEXT_SUBSYSTEM* subsystem, BYTE version,
+                                 BOOL independent)
+{
+	int rc = -1;
+	UINT32 frame;
+	const UINT32 step = TEST_WIDTH * 4;
+	BYTE* src = calloc(TEST_HEIGHT, step);
+	BYTE* dst = calloc(TEST_HEIGHT, step);
+	H264_CONTEXT* encoder = h264_context_new_with_subsystem(TRUE, subsystem);
+	H264_CONTEXT* decoder = h264_context_new_with_subsystem(FALSE, subsystem);
+
+	if (!src || !dst)
+		goto fail;
+
+	if (!encoder || !decoder)
+	{
+		printf("No H.264 backend available, skipping AVC444 round trip\n");
+		rc = 1;
+		goto fail;
+	}
+
+	if (!test_avc444_contexts(encoder, decoder, independent, independent))
+		goto fail;
+
+	if (h264_context_get_option(encoder, H264_CONTEXT_OPTION_INDEPENDENT_AUX_STREAM) !=
+	    (UINT32)independent)
+		goto fail;
+
+	for (frame = 0; frame < TEST_FRAMES; frame++)
+	{
+		double value;
+
+		fill_frame(src, step, frame);
+
+		if (!test_avc444_frame(encoder, decoder, version, src, dst, step, FALSE))
+			goto fail;
+
+		value = psnr(src, dst, step);
+
+		if (value < 30.0)
+		{
+			fprintf(stderr, "AVC444v%" PRIu8 " %s frame %" PRIu32 ": PSNR %lf dB\n", version,
+			        independent ? "independent" : "interleaved", frame, value);
+			goto fail;
+		}
+	}
+
+	rc = 0;
+fail:
+	h264_context_free(encoder);
+	h264_context_free(decoder);
+	free(src);
+	free(dst);
+	return rc;
+}
+
+/* A peer decoding both streams with a single decoder must not be sent independent streams */
+static BOOL test_avc444_independent_mismatch(void)
+{
+	BOOL rc = FALSE;
+	BOOL decoded = TRUE;
+	UINT32 frame;
+	const UINT32 step = TEST_WIDTH * 4;
+	BYTE* src = calloc(TEST_HEIGHT, step);
+	BYTE* dst = calloc(TEST_HEIGHT, step);
+	H264_CONTEXT* encoder = h264_context_new_with_subsystem(TRUE, &g_Subsystem_Stub);
+	H264_CONTEXT* decoder = h264_context_new_with_subsystem(FALSE, &g_Subsystem_Stub);
+
+	if (!src || !dst || !encoder || !decoder)
+		goto fail;
+
+	if (!test_avc444_contexts(encoder, decoder, TRUE, FALSE))
+		goto fail;
+
+	for (frame = 0; decoded && (frame < TEST_FRAMES); frame++)
+	{
+		fill_frame(src, step, frame);
+		decoded = test_avc444_frame(encoder, decoder, 1, src, dst, step, TRUE);
+	}
+
+	if (decoded)
+	{
+		fprintf(stderr, "independent AVC444 streams decoded with a single decoder\n");
+		goto fail;
+	}
+
+	rc = TRUE;
+fail:
+	h264_context_free(encoder);
+	h264_context_free(decoder);
+	free(src);
+	free(dst);
+	return rc;
+}
+
+/* The chroma frame encoded alongside a failing luma frame is never sent, the auxiliary encoder
+ * must not reference it afterwards */
+static BOOL test_avc444_luma_failure(void)
+{
+	BOOL rc = FALSE;
+	UINT32 frame;
+	const UINT32 step = TEST_WIDTH * 4;
+	const RECTANGLE_16 region = { 0, 0, TEST_WIDTH, TEST_HEIGHT };
+	BYTE* src = calloc(TEST_HEIGHT, step);
+	BYTE* dst = calloc(TEST_HEIGHT, step);
+	H264_CONTEXT* encoder = h264_context_new_with_subsystem(TRUE, &g_Subsystem_Stub);
+	H264_CONTEXT* decoder = h264_context_new_with_subsystem(FALSE, &g_Subsystem_Stub);
+
+	if (!src || !dst || !encoder || !decoder)
+		goto fail;
+
+	if (!test_avc444_contexts(encoder, decoder, TRUE, TRUE))
+		goto fail;
+
+	for (frame = 0; frame < TEST_FRAMES; frame++)
+	{
+		fill_frame(src, step, frame);
+
+		if (frame == TEST_FRAMES / 2)
+		{
+			INT32 status;
+			BYTE op = 0;
+			BYTE* data = NULL;
+			BYTE* auxData = NULL;
+			UINT32 size = 0;
+			UINT32 auxSize = 0;
+			RDPGFX_H264_METABLOCK meta = { 0 };
+			RDPGFX_H264_METABLOCK auxMeta = { 0 };
+
+			stub_failing_encoder = encoder;
+			status = avc444_compress(encoder, src, PIXEL_FORMAT_BGRX32, step, TEST_WIDTH,
+			                         TEST_HEIGHT, 1, &region, &op, &data, &size, &auxData,
+			                         &auxSize, &meta, &auxMeta);
+			stub_failing_encoder = NULL;
+			free_h264_metablock(&meta);
+			free_h264_metablock(&auxMeta);
+
+			if (status >= 0)
+			{
+				fprintf(stderr, "avc444_compress succeeded with a failing luma encoder\n");
+				goto fail;
+			}
+
+			continue;
+		}
+
+		if (!test_avc444_frame(encoder, decoder, 1, src, dst, step, FALSE))
+			goto fail;
+
+		if (psnr(src, dst, step) < 30.0)
+		{
+			fprintf(stderr, "AVC444 frame %" PRIu32 " after a luma failure: PSNR too low\n",
+			        frame);
+			goto fail;
+		}
+	}
+
+	rc = TRUE;
+fail:
+	stub_failing_encoder = NULL;
+	h264_context_free(encoder);
+	h264_context_free(decoder);
+	free(src);
+	free(dst);
+	return rc;
+}
+
+int TestFreeRDPCodecH264(int argc, char* argv[])
+{
+	BYTE version;
+	BOOL backend = TRUE;
+
+	WINPR_UNUSED(argc);
+	WINPR_UNUSED(argv);
+
+	for (version = 1; version <= 2; version++)
+	{
+		int rc;
+
+		if ((test_avc444_roundtrip(&g_Subsystem_Stub, version, FALSE) != 0) ||
+		    (test_avc444_roundtrip(&g_Subsystem_Stub, version, TRUE) != 0))
+			return -1;
+
+		if (!backend)
+			continue;
+
+		rc = test_avc444_roundtrip(NULL, version, FALSE);
+
+		if (rc > 0)
+			backend = FALSE;
+		else if ((rc < 0) || (test_avc444_roundtrip(NULL, version, TRUE) != 0))
+			return -1;
+	}
+
+	if (!test_avc444_independent_mismatch())
+		return -1;
+
+	if (!test_avc444_luma_failure())
+		return -1;
+
+	return 0;
+}
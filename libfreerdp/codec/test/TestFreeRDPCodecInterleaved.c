@@ -15,8 +15,109 @@
 #include <winpr/crypto.h>
 #include <freerdp/utils/profiler.h>
 
+static UINT32 random_uint32(void)
+{
+	UINT32 value = 0;
+	winpr_RAND((BYTE*)&value, sizeof(value));
+	return value;
+}
+
+/* Screen like content of few colors, exercising the run, dither and fill/mix orders */
+static void fill_runs(BYTE* data, size_t step, UINT32 width, UINT32 height, UINT32 format)
+{
+	UINT32 x, y, i;
+	UINT32 colors[4];
+	const UINT32 bpp = GetBytesPerPixel(format);
+
+	for (i = 0; i < ARRAYSIZE(colors); i++)
+		colors[i] = random_uint32();
+
+	/* white and black are the implicit colors of the mix and fill orders */
+	colors[0] = FreeRDPGetColor(format, 0, 0, 0, 0xFF);
+	colors[1] = FreeRDPGetColor(format, 0xFF, 0xFF, 0xFF, 0xFF);
+
+	for (y = 0; y < height; y++)
+	{
+		BYTE* line = &data[y * step];
+
+		for (x = 0; x < width;)
+		{
+			const UINT32 kind = random_uint32() % 4;
+			const UINT32 length = 1 + random_uint32() % 24;
+			const UINT32 end = MIN(width, x + length);
+			const UINT32 first = colors[random_uint32() % ARRAYSIZE(colors)];
+			const UINT32 second = colors[random_uint32() % ARRAYSIZE(colors)];
+
+			for (; x < end; x++)
+			{
+				UINT32 color = first;
+
+				if (kind == 1)
+					color = (x % 2) ? second : first;
+				else if ((kind == 2) && (y > 0))
+					color = ReadColor(&line[x * bpp - step], format);
+				else if (kind == 3)
+					color = colors[random_uint32() % ARRAYSIZE(colors)];
+
+				WriteColor(&line[x * bpp], format, color);
+			}
+		}
+	}
+}
+
+static void fill_random(BYTE* data, size_t step, UINT32 width, UINT32 height, UINT32 format)
+{
+	WINPR_UNUSED(width);
+	WINPR_UNUSED(format);
+	winpr_RAND(data, step * height);
+}
+
+/* Fixed lines of copy, dithered and solid runs. A copy order directly in front of a run and
+ * dithered runs of odd and even length were encoded wrong by the 15/16 and 24 bpp compressors. */
+static void fill_orders(BYTE* data, size_t step, UINT32 width, UINT32 height, UINT32 format)
+{
+	UINT32 x, y, i;
+	UINT32 seed = 0x2545F491;
+	const UINT32 bpp = GetBytesPerPixel(format);
+
+	for (y = 0; y < height; y++)
+	{
+		BYTE* line = &data[y * step];
+
+		for (x = 0; x < width;)
+		{
+			UINT32 color[2];
+			const UINT32 copy = 3 + y % 5;
+			const UINT32 dither = 4 + y % 9;
+
+			for (i = 0; i < ARRAYSIZE(color); i++)
+			{
+				seed = seed * 1103515245 + 12345;
+				color[i] = FreeRDPGetColor(format, (BYTE)(seed >> 24), (BYTE)(seed >> 16),
+				                           (BYTE)(seed >> 8), 0xFF);
+			}
+
+			for (i = 0; (i < copy) && (x < width); i++, x++)
+			{
+				seed = seed * 1103515245 + 12345;
+				WriteColor(&line[x * bpp], format,
+				           FreeRDPGetColor(format, (BYTE)(seed >> 24), (BYTE)(seed >> 16),
+				                           (BYTE)(seed >> 8), 0xFF));
+			}
+
+			for (i = 0; (i < dither) && (x < width); i++, x++)
+				WriteColor(&line[x * bpp], format, color[i % 2]);
+
+			for (i = 0; (i < 5) && (x < width); i++, x++)
+				WriteColor(&line[x * bpp], format, color[0]);
+		}
+	}
+}
+
+typedef void (*fill_fn_t)(BYTE* data, size_t step, UINT32 width, UINT32 height, UINT32 format);
+
 static BOOL run_encode_decode_single(UINT16 bpp, BITMAP_INTERLEAVED_CONTEXT* encoder,
-                                     BITMAP_INTERLEAVED_CONTEXT* decoder
+                                     BITMAP_INTERLEAVED_CONTEXT* decoder, fill_fn_t fill
 #if defined(WITH_PROFILER)
                                      ,
                                      PROFILER* profiler_comp, PROFILER* profiler_decomp
@@ -43,7 +144,7 @@ static BOOL run_encode_decode_single(UINT16 bpp, BITMAP_INTERLEAVED_CONTEXT* enc
 	if (!pSrcData || !pDstData || !tmp)
 		goto fail;
 
-	winpr_RAND(pSrcData, SrcSize);
+	fill(pSrcData, step, w, h, format);
 
 	if (!bitmap_interleaved_context_reset(encoder) || !bitmap_interleaved_context_reset(decoder))
 		goto fail;
@@ -133,9 +234,14 @@ static BOOL run_encode_decode(UINT16 bpp, BITMAP_INTERLEAVED_CONTEXT* encoder,
 	PROFILER_CREATE(profiler_comp, get_profiler_name(TRUE, bpp))
 	PROFILER_CREATE(profiler_decomp, get_profiler_name(FALSE, bpp))
 
-	for (x = 0; x < 50; x++)
+	for (x = 0; x < 51; x++)
 	{
-		if (!run_encode_decode_single(bpp, encoder, decoder
+		fill_fn_t fill = (x % 2) ? fill_runs : fill_random;
+
+		if (x == 50)
+			fill = fill_orders;
+
+		if (!run_encode_decode_single(bpp, encoder, decoder, fill
 #if defined(WITH_PROFILER)
 		                              ,
 		                              profiler_comp, profiler_decomp
@@ -1120,6 +1120,155 @@ fail:
 	return res;
 }
 
+static UINT64 test_image_error(const wImage* image, const BYTE* data, BOOL* match)
+{
+	int x, y;
+	UINT64 error = 0;
+	const UINT32 ColorFormat = PIXEL_FORMAT_BGRX32;
+
+	*match = TRUE;
+
+	for (y = 0; y < image->height; y++)
+	{
+		const BYTE* orig = &image->data[y * image->scanline];
+		const BYTE* dec = &data[y * image->scanline];
+
+		for (x = 0; x < image->width; x++)
+		{
+			BYTE ar, ag, ab, br, bg, bb;
+			const DWORD a = ReadColor(&orig[x * 4], ColorFormat);
+			const DWORD b = ReadColor(&dec[x * 4], ColorFormat);
+			SplitColor(a, ColorFormat, &ar, &ag, &ab, NULL, NULL);
+			SplitColor(b, ColorFormat, &br, &bg, &bb, NULL, NULL);
+			error += (UINT64)abs(ar - br) + abs(ag - bg) + abs(ab - bb);
+
+			if (!colordiff(ColorFormat, a, b))
+				*match = FALSE;
+		}
+	}
+
+	return error;
+}
+
+static BOOL test_encode_decode_passes(const char* path)
+{
+	int x, y;
+	int rc;
+	BOOL res = FALSE;
+	BOOL match;
+	UINT32 frameId = 0;
+	UINT32 pass;
+	UINT64 error, lastError;
+	BYTE* resultData = NULL;
+	BYTE* dstData = NULL;
+	UINT32 dstSize = 0;
+	const UINT32 ColorFormat = PIXEL_FORMAT_BGRX32;
+	const RECTANGLE_16 tile = { 64, 64, 128, 128 };
+	REGION16 invalidRegion = { 0 };
+	REGION16 updateRegion = { 0 };
+	wImage* image = winpr_image_new();
+	char* name = GetCombinedPath(path, "progressive.bmp");
+	PROGRESSIVE_CONTEXT* progressiveEnc = progressive_context_new(TRUE);
+	PROGRESSIVE_CONTEXT* progressiveDec = progressive_context_new(FALSE);
+
+	region16_init(&invalidRegion);
+	region16_init(&updateRegion);
+	if (!image || !name || !progressiveEnc || !progressiveDec)
+		goto fail;
+
+	if (winpr_image_read(image, name) <= 0)
+		goto fail;
+
+	resultData = calloc(image->scanline, image->height);
+	if (!resultData)
+		goto fail;
+
+	if (progressive_context_set_passes(progressiveEnc, 0) ||
+	    progressive_context_set_passes(progressiveEnc, 5))
+		goto fail;
+
+	if (!progressive_context_set_passes(progressiveEnc, 3))
+		goto fail;
+
+	if (progressive_create_surface_context(progressiveDec, 0, image->width, image->height) <= 0)
+		goto fail;
+
+	/* first pass of all tiles, followed by upgrades without any damage */
+	lastError = UINT64_MAX;
+	for (pass = 0; pass < 3; pass++)
+	{
+		rc = progressive_compress(progressiveEnc, image->data, image->scanline * image->height,
+		                          ColorFormat, image->width, image->height, image->scanline,
+		                          (pass == 0) ? NULL : &updateRegion, &dstData, &dstSize);
+		if (rc != 1)
+			goto fail;
+
+		rc = progressive_decompress(progressiveDec, dstData, dstSize, resultData, ColorFormat,
+		                            image->scanline, 0, 0, &invalidRegion, 0, frameId++);
+		if (rc < 0)
+			goto fail;
+
+		error = test_image_error(image, resultData, &match);
+		printf("pass %" PRIu32 ": %" PRIu32 " bytes, error %" PRIu64 "\n", pass, dstSize, error);
+		if (error > lastError)
+			goto fail;
+		lastError = error;
+	}
+
+	if (!match || progressive_compress_pending(progressiveEnc))
+		goto fail;
+
+	rc = progressive_compress(progressiveEnc, image->data, image->scanline * image->height,
+	                          ColorFormat, image->width, image->height, image->scanline,
+	                          &updateRegion, &dstData, &dstSize);
+	if (rc != 0)
+		goto fail;
+
+	/* damage a single tile, only this tile is sent again and upgraded */
+	for (y = tile.top; y < tile.bottom; y++)
+	{
+		for (x = tile.left; x < tile.right; x++)
+			image->data[y * image->scanline + x * 4 + 1] ^= 0xFF;
+	}
+
+	if (!region16_union_rect(&updateRegion, &updateRegion, &tile))
+		goto fail;
+
+	for (pass = 0; pass < 3; pass++)
+	{
+		rc = progressive_compress(progressiveEnc, image->data, image->scanline * image->height,
+		                          ColorFormat, image->width, image->height, image->scanline,
+		                          &updateRegion, &dstData, &dstSize);
+		if (rc != 1)
+			goto fail;
+
+		region16_clear(&updateRegion);
+		region16_clear(&invalidRegion);
+		rc = progressive_decompress(progressiveDec, dstData, dstSize, resultData, ColorFormat,
+		                            image->scanline, 0, 0, &invalidRegion, 0, frameId++);
+		if (rc < 0)
+			goto fail;
+
+		if (!rectangles_equal(region16_extents(&invalidRegion), &tile))
+			goto fail;
+	}
+
+	test_image_error(image, resultData, &match);
+	if (!match || progressive_compress_pending(progressiveEnc))
+		goto fail;
+
+	res = TRUE;
+fail:
+	region16_uninit(&invalidRegion);
+	region16_uninit(&updateRegion);
+	progressive_context_free(progressiveEnc);
+	progressive_context_free(progressiveDec);
+	winpr_image_free(image, TRUE);
+	free(resultData);
+	free(name);
+	return res;
+}
+
 int TestFreeRDPCodecProgressive(int argc, char* argv[])
 {
 	int rc = -1;
@@ -1151,6 +1300,8 @@ int TestFreeRDPCodecProgressive(int argc, char* argv[])
 		    */
 		if (!test_encode_decode(ms_sample_path))
 			goto fail;
+		if (!test_encode_decode_passes(ms_sample_path))
+			goto fail;
 		rc = 0;
 	}
 
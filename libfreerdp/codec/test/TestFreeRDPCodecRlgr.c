@@ -0,0 +1,325 @@
+#include <winpr/crt.h>
+#include <winpr/sysinfo.h>
+
+#include <freerdp/codec/rfx.h>
+
+#include "../rfx_rlgr.h"
+#include "../rfx_dwt.h"
+#include "../rfx_quantization.h"
+
+#define TILE_COEFFS 4096
+#define BUFFER_SIZE (TILE_COEFFS * 4)
+
+/* The RLGR encoder as specified in [MS-RDPRFX] 3.1.8.1.7.3, writing one bit at a time */
+typedef struct
+{
+	BYTE* buffer;
+	UINT32 length;
+	UINT64 bits;
+} REF_WRITER;
+
+static void ref_put_bits(REF_WRITER* w, UINT32 value, UINT32 nbits)
+{
+	while (nbits-- > 0)
+	{
+		const UINT64 pos = w->bits / 8;
+
+		if (pos >= w->length)
+			return;
+
+		if ((value >> nbits) & 1)
+			w->buffer[pos] |= 0x80 >> (w->bits % 8);
+
+		w->bits++;
+	}
+}
+
+static void ref_update(INT32* param, INT32 delta, UINT32* k)
+{
+	*param += delta;
+	*param = MIN(MAX(*param, 0), 80);
+	*k = (UINT32)*param >> 3;
+}
+
+static void ref_code_gr(REF_WRITER* w, INT32* krp, UINT32 val)
+{
+	UINT32 kr = (UINT32)*krp >> 3;
+	const UINT32 vk = val >> kr;
+	UINT32 i;
+
+	for (i = 0; i < vk; i++)
+		ref_put_bits(w, 1, 1);
+
+	ref_put_bits(w, 0, 1);
+	ref_put_bits(w, val & ((1u << kr) - 1), kr);
+
+	if (vk == 0)
+		ref_update(krp, -2, &kr);
+	else if (vk > 1)
+		ref_update(krp, (INT32)vk, &kr);
+}
+
+static INT32 ref_next(const INT16** data, UINT32* size)
+{
+	if (*size == 0)
+		return 0;
+
+	(*size)--;
+	return *(*data)++;
+}
+
+static UINT32 ref_two_mag_sign(INT32 input)
+{
+	return (UINT32)(input >= 0 ? 2 * input : -2 * input - 1);
+}
+
+static int ref_rlgr_encode(RLGR_MODE mode, const INT16* data, UINT32 size, BYTE* buffer,
+                           UINT32 length)
+{
+	UINT32 k = 1;
+	INT32 kp = 8;
+	INT32 krp = 8;
+	REF_WRITER w = { buffer, length, 0 };
+
+	ZeroMemory(buffer, length);
+
+	while (size > 0)
+	{
+		if (k)
+		{
+			UINT32 numZeros = 0;
+			UINT32 mag;
+			INT32 input = ref_next(&data, &size);
+
+			while ((input == 0) && (size > 0))
+			{
+				numZeros++;
+				input = ref_next(&data, &size);
+			}
+
+			while (numZeros >= (1u << k))
+			{
+				ref_put_bits(&w, 0, 1);
+				numZeros -= 1u << k;
+				ref_update(&kp, 4, &k);
+			}
+
+			ref_put_bits(&w, 1, 1);
+			ref_put_bits(&w, numZeros, k);
+			mag = (UINT32)(input < 0 ? -input : input);
+			ref_put_bits(&w, input < 0 ? 1 : 0, 1);
+			ref_code_gr(&w, &krp, mag ? mag - 1 : 0);
+			ref_update(&kp, -6, &k);
+		}
+		else if (mode == RLGR1)
+		{
+			const UINT32 twoMs = ref_two_mag_sign(ref_next(&data, &size));
+			ref_code_gr(&w, &krp, twoMs);
+			ref_update(&kp, twoMs ? -3 : 3, &k);
+		}
+		else
+		{
+			const UINT32 twoMs1 = ref_two_mag_sign(ref_next(&data, &size));
+			const UINT32 twoMs2 = ref_two_mag_sign(ref_next(&data, &size));
+			const UINT32 sum2Ms = twoMs1 + twoMs2;
+			UINT32 nIdx = 0;
+
+			ref_code_gr(&w, &krp, sum2Ms);
+
+			while ((sum2Ms >> nIdx) != 0)
+				nIdx++;
+
+			ref_put_bits(&w, twoMs1, nIdx);
+
+			if (twoMs1 && twoMs2)
+				ref_update(&kp, -6, &k);
+			else if (!twoMs1 && !twoMs2)
+				ref_update(&kp, 6, &k);
+		}
+	}
+
+	/* The final padding repeats the bits used in the last byte */
+	ref_put_bits(&w, 0, w.bits % 8);
+	return (int)MIN((w.bits + 7) / 8, length);
+}
+
+static UINT32 prand(UINT32* state)
+{
+	*state ^= *state << 13;
+	*state ^= *state >> 17;
+	*state ^= *state << 5;
+	return *state;
+}
+
+/* Encodes with both encoders and decodes the result again */
+static BOOL test_rlgr_data(RLGR_MODE mode, const INT16* data, UINT32 size, UINT32 length,
+                           BOOL decode, const char* name)
+{
+	BOOL rc = FALSE;
+	int refLength, outLength;
+	BYTE* ref = calloc(1, BUFFER_SIZE);
+	BYTE* out = malloc(BUFFER_SIZE);
+	INT16* decoded = calloc(TILE_COEFFS, sizeof(INT16));
+
+	if (!ref || !out || !decoded)
+		goto fail;
+
+	/* The encoder must not depend on a zeroed output buffer */
+	memset(out, 0xCD, BUFFER_SIZE);
+	refLength = ref_rlgr_encode(mode, data, size, ref, length);
+	outLength = rfx_rlgr_encode(mode, data, size, out, length);
+
+	if ((outLength != refLength) || (memcmp(out, ref, (size_t)refLength) != 0))
+	{
+		fprintf(stderr, "%s RLGR%d: encoded %d bytes, expected %d\n", name,
+		        (mode == RLGR1) ? 1 : 3, outLength, refLength);
+		goto fail;
+	}
+
+	/* Truncated output can not be decoded */
+	if (decode && ((UINT32)outLength < length))
+	{
+		/* A trailing zero ending a zero run is sent as magnitude 1 */
+		const size_t count = (data[size - 1] == 0) ? size - 1 : size;
+
+		if (rfx_rlgr_decode(mode, out, (UINT32)outLength, decoded, size) < 0)
+			goto fail;
+
+		if (memcmp(decoded, data, count * sizeof(INT16)) != 0)
+		{
+			fprintf(stderr, "%s RLGR%d: round trip mismatch\n", name, (mode == RLGR1) ? 1 : 3);
+			goto fail;
+		}
+	}
+
+	rc = TRUE;
+fail:
+	free(ref);
+	free(out);
+	free(decoded);
+	return rc;
+}
+
+static BOOL test_rlgr_modes(const INT16* data, UINT32 size, UINT32 length, BOOL decode,
+                            const char* name)
+{
+	return test_rlgr_data(RLGR1, data, size, length, decode, name) &&
+	       test_rlgr_data(RLGR3, data, size, length, decode, name);
+}
+
+/* Runs a synthetic 64x64 tile through the RemoteFX transform and quantization */
+static void test_real_tile(INT16* data, UINT32 seed)
+{
+	UINT32 x, y, i;
+	INT16 dwt[TILE_COEFFS];
+	static const UINT32 quant[10] = { 6, 6, 6, 6, 7, 7, 8, 8, 8, 9 };
+
+	for (y = 0; y < 64; y++)
+	{
+		for (x = 0; x < 64; x++)
+		{
+			/* gradient background with a few hard edged glyph like blocks */
+			INT32 pixel = (INT32)(x * 2 + y + (seed & 0x3F));
+
+			if (((x / 6 + y / 9 + seed) % 5 == 0) && (y % 9 < 7))
+				pixel = (seed & 1) ? 250 : 10;
+
+			pixel += (INT32)(prand(&seed) % 3);
+			data[y * 64 + x] = (INT16)((MIN(pixel, 255) - 128) << 5);
+		}
+	}
+
+	rfx_dwt_2d_encode(data, dwt);
+	rfx_quantization_encode(data, quant);
+
+	for (i = TILE_COEFFS - 1; i > 4032; i--)
+		data[i] -= data[i - 1];
+}
+
+int TestFreeRDPCodecRlgr(int argc, char* argv[])
+{
+	int rc = -1;
+	UINT32 seed = 0x2545F491;
+	UINT32 i, n;
+	UINT64 start, refTime, outTime;
+	BYTE* buffer = calloc(1, BUFFER_SIZE);
+	INT16* data = calloc(TILE_COEFFS, sizeof(INT16));
+
+	WINPR_UNUSED(argc);
+	WINPR_UNUSED(argv);
+
+	if (!buffer || !data)
+		goto fail;
+
+	/* Edge cases: no nonzero value, trailing zeros, odd sizes and extreme magnitudes */
+	if (!test_rlgr_modes(data, TILE_COEFFS, BUFFER_SIZE, TRUE, "zero"))
+		goto fail;
+
+	data[0] = 1;
+
+	if (!test_rlgr_modes(data, 1, BUFFER_SIZE, TRUE, "single") ||
+	    !test_rlgr_modes(data, 2001, BUFFER_SIZE, TRUE, "trailing zeros"))
+		goto fail;
+
+	for (i = 0; i < TILE_COEFFS; i++)
+		data[i] = (INT16)((i & 1) ? -1000 - i : 1000 + i);
+
+	if (!test_rlgr_modes(data, 1023, BUFFER_SIZE, TRUE, "odd"))
+		goto fail;
+
+	/* The decoder does not handle unary codes of 32 bits or more */
+	for (i = 0; i < TILE_COEFFS; i++)
+		data[i] = (i & 1) ? INT16_MIN : INT16_MAX;
+
+	if (!test_rlgr_modes(data, TILE_COEFFS, BUFFER_SIZE, FALSE, "extreme"))
+		goto fail;
+
+	/* Random sets from sparse to dense with magnitudes up to 2^11 */
+	for (n = 0; n < 200; n++)
+	{
+		const UINT32 density = n % 10;
+		const UINT32 bits = 1 + (n / 10) % 12;
+		const UINT32 size = 1 + prand(&seed) % TILE_COEFFS;
+
+		for (i = 0; i < size; i++)
+		{
+			if (prand(&seed) % 10 < density)
+				data[i] = (INT16)(prand(&seed) & ((1u << bits) - 1)) - (INT16)(1 << (bits - 1));
+			else
+				data[i] = 0;
+		}
+
+		if (!test_rlgr_modes(data, size, BUFFER_SIZE, TRUE, "random") ||
+		    !test_rlgr_modes(data, size, 1 + prand(&seed) % 64, FALSE, "truncated"))
+			goto fail;
+	}
+
+	/* Coefficient sets produced by the tile encoder */
+	for (n = 0; n < 32; n++)
+	{
+		test_real_tile(data, n * 7919);
+
+		if (!test_rlgr_modes(data, TILE_COEFFS, BUFFER_SIZE, TRUE, "tile"))
+			goto fail;
+	}
+
+	start = GetTickCount64();
+
+	for (n = 0; n < 2000; n++)
+		ref_rlgr_encode(RLGR1, data, TILE_COEFFS, buffer, BUFFER_SIZE);
+
+	refTime = GetTickCount64() - start;
+	start = GetTickCount64();
+
+	for (n = 0; n < 2000; n++)
+		rfx_rlgr_encode(RLGR1, data, TILE_COEFFS, buffer, BUFFER_SIZE);
+
+	outTime = GetTickCount64() - start;
+	printf("RLGR1 encoding 2000 tiles: %" PRIu64 " ms, bitwise reference %" PRIu64 " ms\n",
+	       outTime, refTime);
+	rc = 0;
+fail:
+	free(buffer);
+	free(data);
+	return rc;
+}
@@ -253,6 +253,124 @@ fail:
 	return rc;
 }
 
+static UINT32 test_random(UINT32* state)
+{
+	*state ^= *state << 13;
+	*state ^= *state >> 17;
+	*state ^= *state << 5;
+	return *state;
+}
+
+/* Screen like data: runs, repeated rows, text and noise */
+static void test_fill(BYTE* data, UINT32 size, UINT32* state)
+{
+	UINT32 x = 0;
+
+	while (x < size)
+	{
+		UINT32 length = 1 + test_random(state) % 300;
+		const UINT32 kind = test_random(state) % 4;
+
+		if (length > size - x)
+			length = size - x;
+
+		if ((kind == 0) || (x < 1024))
+			memset(&data[x], (int)(test_random(state) & 0xFF), length);
+		else if (kind == 1)
+			memmove(&data[x], &data[test_random(state) % (x - length / 2)], length);
+		else if (kind == 2)
+		{
+			UINT32 y;
+
+			for (y = 0; y < length; y++)
+				data[x + y] = (BYTE)(test_random(state) & 0xFF);
+		}
+		else
+		{
+			UINT32 y;
+
+			for (y = 0; y < length; y++)
+				data[x + y] = TEST_FOX_DATA[(x + y) % (sizeof(TEST_FOX_DATA) - 1)];
+		}
+
+		x += length;
+	}
+}
+
+static int test_ZGfxCompressRoundTrip(void)
+{
+	int rc = -1;
+	UINT32 index;
+	UINT32 state = 0x1234567;
+	UINT64 totalIn = 0;
+	UINT64 totalOut = 0;
+	const UINT32 maxSize = 200000;
+	BYTE* pSrcData = malloc(maxSize);
+	ZGFX_CONTEXT* compressor = zgfx_context_new(TRUE);
+	ZGFX_CONTEXT* decompressor = zgfx_context_new(FALSE);
+
+	if (!pSrcData || !compressor || !decompressor)
+		goto fail;
+
+	/* Later calls reference the history of earlier ones, large ones are multipart */
+	for (index = 0; index < 112; index++)
+	{
+		int status;
+		UINT32 Flags = 0;
+		UINT32 DstSize = 0;
+		UINT32 OutSize = 0;
+		BYTE* pDstData = NULL;
+		BYTE* pOutData = NULL;
+		const UINT32 SrcSize = (index % 8 == 7) ? maxSize - index : 1 + test_random(&state) % 20000;
+
+		test_fill(pSrcData, SrcSize, &state);
+
+		/* Incompressible data must not expand beyond the segment headers */
+		if (index % 16 == 5)
+		{
+			UINT32 x;
+
+			for (x = 0; x < SrcSize; x++)
+				pSrcData[x] = (BYTE)(test_random(&state) & 0xFF);
+		}
+
+		status = zgfx_compress(compressor, pSrcData, SrcSize, &pDstData, &DstSize, &Flags);
+
+		if ((status >= 0) &&
+		    (DstSize <= SrcSize + 7 + 5 * ((SrcSize + ZGFX_SEGMENTED_MAXSIZE - 1) /
+		                                   ZGFX_SEGMENTED_MAXSIZE)))
+			status = zgfx_decompress(decompressor, pDstData, DstSize, &pOutData, &OutSize, Flags);
+		else
+			status = -1;
+
+		if ((status < 0) || (OutSize != SrcSize) || (memcmp(pOutData, pSrcData, SrcSize) != 0))
+		{
+			printf("%s: round trip %" PRIu32 " of %" PRIu32 " bytes failed\n", __FUNCTION__,
+			       index, SrcSize);
+			free(pDstData);
+			free(pOutData);
+			goto fail;
+		}
+
+		totalIn += SrcSize;
+		totalOut += DstSize;
+		free(pDstData);
+		free(pOutData);
+	}
+
+	printf("%s: %" PRIu64 " bytes compressed to %" PRIu64 "\n", __FUNCTION__, totalIn, totalOut);
+
+	if (totalOut * 2 > totalIn)
+		goto fail;
+
+	rc = 0;
+fail:
+	free(pSrcData);
+	zgfx_context_free(compressor);
+	zgfx_context_free(decompressor);
+	return rc;
+}
+
 int TestFreeRDPCodecZGfx(int argc, char* argv[])
 {
 	WINPR_UNUSED(argc);
@@ -270,5 +388,8 @@ int TestFreeRDPCodecZGfx(int argc, char* argv[])
 	if (test_ZGfxCompressConsistent() < 0)
 		return -1;
 
+	if (test_ZGfxCompressRoundTrip() < 0)
+		return -1;
+
 	return 0;
 }
@@ -19,6 +19,7 @@
 
 #include <winpr/crt.h>
 #include <winpr/print.h>
+#include <winpr/sysinfo.h>
 
 #include <freerdp/codec/region.h>
 
@@ -814,6 +815,306 @@ out:
 	return retCode;
 }
 
+#define BITMAP_WIDTH 96
+#define BITMAP_HEIGHT 64
+
+static UINT32 randomState = 0x2545F491;
+
+static UINT32 test_random(UINT32 max)
+{
+	/* xorshift, reproducible across platforms */
+	randomState ^= randomState << 13;
+	randomState ^= randomState >> 17;
+	randomState ^= randomState << 5;
+	return randomState % max;
+}
+
+static void random_rectangle(RECTANGLE_16* rect, UINT32 width, UINT32 height)
+{
+	const UINT32 x1 = test_random(width);
+	const UINT32 x2 = test_random(width + 1);
+	const UINT32 y1 = test_random(height);
+	const UINT32 y2 = test_random(height + 1);
+	rect->left = (UINT16)MIN(x1, x2);
+	rect->right = (UINT16)MAX(x1, x2);
+	rect->top = (UINT16)MIN(y1, y2);
+	rect->bottom = (UINT16)MAX(y1, y2);
+}
+
+static void bitmap_fill(BYTE* bitmap, const RECTANGLE_16* rect, BYTE value)
+{
+	UINT32 x, y;
+
+	for (y = rect->top; y < rect->bottom; y++)
+	{
+		for (x = rect->left; x < rect->right; x++)
+			bitmap[y * BITMAP_WIDTH + x] = value;
+	}
+}
+
+static void bitmap_from_region(BYTE* bitmap, const REGION16* region)
+{
+	UINT32 i, nbRects;
+	const RECTANGLE_16* rects = region16_rects(region, &nbRects);
+	memset(bitmap, 0, BITMAP_WIDTH * BITMAP_HEIGHT);
+
+	for (i = 0; i < nbRects; i++)
+		bitmap_fill(bitmap, &rects[i], 1);
+}
+
+/* checks the y-x banded form: sorted disjoint bands, sorted spans that do not touch, no two
+ * touching bands with the same spans and exact extents */
+static BOOL region_is_canonical(const REGION16* region)
+{
+	UINT32 i, nbRects;
+	const RECTANGLE_16* rects = region16_rects(region, &nbRects);
+	const RECTANGLE_16* extents = region16_extents(region);
+	const RECTANGLE_16* prevBand = NULL;
+	UINT32 prevCount = 0;
+	UINT32 bandStart = 0;
+	RECTANGLE_16 computed = { 0 };
+
+	for (i = 0; i < nbRects; i++)
+	{
+		const RECTANGLE_16* rect = &rects[i];
+
+		if (rectangle_is_empty(rect))
+			return FALSE;
+
+		if (i == 0)
+			computed = *rect;
+
+		computed.left = MIN(computed.left, rect->left);
+		computed.right = MAX(computed.right, rect->right);
+		computed.bottom = rect->bottom;
+
+		if ((i > bandStart) && (rect->top == rects[i - 1].top))
+		{
+			if ((rect->bottom != rects[i - 1].bottom) || (rect->left <= rects[i - 1].right))
+				return FALSE;
+		}
+		else if (i > 0)
+		{
+			const RECTANGLE_16* band = &rects[bandStart];
+
+			if (rect->top < band->bottom)
+				return FALSE;
+
+			if (prevBand && (prevBand->bottom == band->top) && (prevCount == i - bandStart))
+			{
+				UINT32 k;
+
+				for (k = 0; k < prevCount; k++)
+				{
+					if ((prevBand[k].left != band[k].left) || (prevBand[k].right != band[k].right))
+						break;
+				}
+
+				if (k == prevCount)
+					return FALSE;
+			}
+
+			prevBand = band;
+			prevCount = i - bandStart;
+			bandStart = i;
+		}
+	}
+
+	if (nbRects == 0)
+		return rectangle_is_empty(extents);
+
+	return compareRectangles(extents, &computed, 1);
+}
+
+static BOOL region_matches_bitmap(const REGION16* region, const BYTE* expected)
+{
+	BYTE actual[BITMAP_WIDTH * BITMAP_HEIGHT];
+
+	if (!region_is_canonical(region))
+	{
+		fprintf(stderr, "region is not y-x banded\n");
+		return FALSE;
+	}
+
+	bitmap_from_region(actual, region);
+
+	if (memcmp(actual, expected, sizeof(actual)) != 0)
+	{
+		fprintf(stderr, "region does not cover the expected pixels\n");
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+static BOOL regions_equal(const REGION16* r1, const REGION16* r2)
+{
+	UINT32 nb1, nb2;
+	const RECTANGLE_16* rects1 = region16_rects(r1, &nb1);
+	const RECTANGLE_16* rects2 = region16_rects(r2, &nb2);
+
+	if (nb1 != nb2)
+	{
+		fprintf(stderr, "expecting %" PRIu32 " rectangles and have %" PRIu32 "\n", nb2, nb1);
+		return FALSE;
+	}
+
+	return compareRectangles(rects1, rects2, (int)nb1) &&
+	       compareRectangles(region16_extents(r1), region16_extents(r2), 1);
+}
+
+static int test_random_operations(void)
+{
+	int retCode = -1;
+	UINT32 iteration, i;
+	REGION16 region1, region2, region, single;
+	RECTANGLE_16 rects[32];
+	BYTE bitmap1[BITMAP_WIDTH * BITMAP_HEIGHT];
+	BYTE bitmap2[BITMAP_WIDTH * BITMAP_HEIGHT];
+	BYTE expected[BITMAP_WIDTH * BITMAP_HEIGHT];
+	region16_init(&region1);
+	region16_init(&region2);
+	region16_init(&region);
+	region16_init(&single);
+
+	for (iteration = 0; iteration < 500; iteration++)
+	{
+		const UINT32 count1 = test_random(ARRAYSIZE(rects)) + 1;
+		const UINT32 count2 = test_random(8) + 1;
+		RECTANGLE_16 rect;
+		memset(bitmap1, 0, sizeof(bitmap1));
+		memset(bitmap2, 0, sizeof(bitmap2));
+
+		/* bulk union against one by one union */
+		region16_clear(&single);
+
+		for (i = 0; i < count1; i++)
+		{
+			random_rectangle(&rects[i], BITMAP_WIDTH, BITMAP_HEIGHT);
+			bitmap_fill(bitmap1, &rects[i], 1);
+
+			if (!region16_union_rect(&single, &single, &rects[i]))
+				goto out;
+		}
+
+		region16_clear(&region1);
+
+		if (!region16_union_rects(&region1, &region1, rects, count1))
+			goto out;
+
+		if (!region_matches_bitmap(&region1, bitmap1) || !region_matches_bitmap(&single, bitmap1) ||
+		    !regions_equal(&region1, &single))
+			goto out;
+
+		region16_clear(&region2);
+
+		for (i = 0; i < count2; i++)
+		{
+			random_rectangle(&rects[i], BITMAP_WIDTH, BITMAP_HEIGHT);
+			bitmap_fill(bitmap2, &rects[i], 1);
+		}
+
+		if (!region16_union_rects(&region2, &region2, rects, count2))
+			goto out;
+
+		/* union of regions */
+		for (i = 0; i < ARRAYSIZE(expected); i++)
+			expected[i] = bitmap1[i] | bitmap2[i];
+
+		if (!region16_union_region(&region, &region1, &region2) ||
+		    !region_matches_bitmap(&region, expected))
+			goto out;
+
+		/* bulk union into a non empty region */
+		if (!region16_copy(&region, &region1) ||
+		    !region16_union_rects(&region, &region, rects, count2) ||
+		    !region_matches_bitmap(&region, expected))
+			goto out;
+
+		/* subtraction of regions */
+		for (i = 0; i < ARRAYSIZE(expected); i++)
+			expected[i] = bitmap1[i] & !bitmap2[i];
+
+		if (!region16_subtract_region(&region, &region1, &region2) ||
+		    !region_matches_bitmap(&region, expected))
+			goto out;
+
+		/* subtraction of a rectangle, in place */
+		random_rectangle(&rect, BITMAP_WIDTH, BITMAP_HEIGHT);
+		memcpy(expected, bitmap1, sizeof(expected));
+		bitmap_fill(expected, &rect, 0);
+
+		if (!region16_subtract_rect(&region1, &region1, &rect) ||
+		    !region_matches_bitmap(&region1, expected))
+			goto out;
+	}
+
+	retCode = 0;
+out:
+	if (retCode)
+		fprintf(stderr, "random operations failed in iteration %" PRIu32 "\n", iteration);
+
+	region16_uninit(&single);
+	region16_uninit(&region);
+	region16_uninit(&region2);
+	region16_uninit(&region1);
+	return retCode;
+}
+
+static int test_union_rects_speed(void)
+{
+	int retCode = -1;
+	UINT32 i;
+	UINT64 start, bulk, single;
+	REGION16 region1, region2;
+	const UINT32 count = 10000;
+	RECTANGLE_16* rects = calloc(count, sizeof(RECTANGLE_16));
+	region16_init(&region1);
+	region16_init(&region2);
+
+	if (!rects)
+		goto out;
+
+	/* small damage rectangles scattered over a full HD screen */
+	for (i = 0; i < count; i++)
+	{
+		rects[i].left = (UINT16)test_random(1920 - 64);
+		rects[i].top = (UINT16)test_random(1080 - 64);
+		rects[i].right = rects[i].left + (UINT16)test_random(64) + 1;
+		rects[i].bottom = rects[i].top + (UINT16)test_random(64) + 1;
+	}
+
+	start = GetTickCount64();
+
+	if (!region16_union_rects(&region1, &region1, rects, count))
+		goto out;
+
+	bulk = GetTickCount64() - start;
+	start = GetTickCount64();
+
+	for (i = 0; i < count; i++)
+	{
+		if (!region16_union_rect(&region2, &region2, &rects[i]))
+			goto out;
+	}
+
+	single = GetTickCount64() - start;
+	fprintf(stderr,
+	        "%" PRIu32 " rectangles: region16_union_rects %" PRIu64 " ms, "
+	        "region16_union_rect %" PRIu64 " ms, %d rectangles in the region\n",
+	        count, bulk, single, region16_n_rects(&region1));
+
+	if (!regions_equal(&region1, &region2))
+		goto out;
+
+	retCode = 0;
+out:
+	free(rects);
+	region16_uninit(&region2);
+	region16_uninit(&region1);
+	return retCode;
+}
+
 typedef int (*TestFunction)(void);
 struct UnitaryTest
 {
@@ -835,6 +1136,8 @@ static struct UnitaryTest tests[] = { { "Basic trivial tests", test_basic },
 	                                  { "norbert's case", test_norbert_case },
 	                                  { "norbert's case 2", test_norbert2_case },
 	                                  { "empty rectangle case", test_empty_rectangle },
+	                                  { "random operations", test_random_operations },
+	                                  { "10k rectangles union speed", test_union_rects_speed },
 
 	                                  { NULL, NULL } };
 
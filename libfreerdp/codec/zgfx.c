@@ -70,8 +70,27 @@ struct _ZGFX_CONTEXT
 	BYTE HistoryBuffer[2500000];
 	UINT32 HistoryIndex;
 	UINT32 HistoryBufferSize;
+
+	/* Compressor only: recent positions of each 3 byte hash, stored as position + 1 */
+	UINT32* MatchTable;
+	UINT32 LiteralCodes[256];
+	BYTE LiteralBits[256];
 };
 
+#define ZGFX_HASH_BITS 15
+#define ZGFX_HASH_WAYS 4
+#define ZGFX_MIN_MATCH 3
+
+typedef struct
+{
+	BYTE* data;
+	size_t size;
+	size_t position;
+	UINT64 accumulator;
+	UINT32 bits;
+	BOOL overflow;
+} ZGFX_BIT_WRITER;
+
 static const ZGFX_TOKEN ZGFX_TOKEN_TABLE[] = {
 	// len code vbits type  vbase
 	{ 1, 0, 8, 0, 0 },           // 0
@@ -452,10 +471,216 @@ fail:
 	return status;
 }
 
+static INLINE void zgfx_put_bits(ZGFX_BIT_WRITER* w, UINT32 value, UINT32 nbits)
+{
+	if (nbits == 0)
+		return;
+
+	w->accumulator = (w->accumulator << nbits) | (value & (0xFFFFFFFFu >> (32 - nbits)));
+	w->bits += nbits;
+
+	while (w->bits >= 8)
+	{
+		w->bits -= 8;
+
+		if (w->position < w->size)
+			w->data[w->position++] = (BYTE)(w->accumulator >> w->bits);
+		else
+			w->overflow = TRUE;
+	}
+}
+
+static void zgfx_init_literal_codes(ZGFX_CONTEXT* zgfx)
+{
+	size_t index;
+
+	/* Every byte can be sent with the generic 9 bit literal, some have shorter codes */
+	for (index = 0; index < 256; index++)
+	{
+		zgfx->LiteralCodes[index] = index;
+		zgfx->LiteralBits[index] = 9;
+	}
+
+	for (index = 1; ZGFX_TOKEN_TABLE[index].prefixLength != 0; index++)
+	{
+		const ZGFX_TOKEN* token = &ZGFX_TOKEN_TABLE[index];
+
+		if (token->tokenType == 0)
+		{
+			zgfx->LiteralCodes[token->valueBase] = token->prefixCode;
+			zgfx->LiteralBits[token->valueBase] = (BYTE)token->prefixLength;
+		}
+	}
+}
+
+static const ZGFX_TOKEN* zgfx_distance_token(UINT32 distance)
+{
+	const ZGFX_TOKEN* token;
+
+	for (token = ZGFX_TOKEN_TABLE; token->prefixLength != 0; token++)
+	{
+		if ((token->tokenType == 1) && (distance >= token->valueBase) &&
+		    (distance - token->valueBase < (1u << token->valueBits)))
+			return token;
+	}
+
+	return NULL;
+}
+
+/* A match of 3 is a single 0 bit, longer ones have a unary exponent and the mantissa */
+static UINT32 zgfx_length_bits(UINT32 length)
+{
+	UINT32 exponent = 2;
+
+	if (length < 4)
+		return 1;
+
+	while ((length >> (exponent + 1)) != 0)
+		exponent++;
+
+	return 2 * exponent;
+}
+
+static void zgfx_put_match(ZGFX_BIT_WRITER* w, const ZGFX_TOKEN* token, UINT32 distance,
+                           UINT32 length)
+{
+	UINT32 exponent = 2;
+
+	zgfx_put_bits(w, token->prefixCode, token->prefixLength);
+	zgfx_put_bits(w, distance - token->valueBase, token->valueBits);
+
+	if (length < 4)
+	{
+		zgfx_put_bits(w, 0, 1);
+		return;
+	}
+
+	while ((length >> (exponent + 1)) != 0)
+		exponent++;
+
+	zgfx_put_bits(w, ((1u << (exponent - 1)) - 1) << 1, exponent);
+	zgfx_put_bits(w, length - (1u << exponent), exponent);
+}
+
+static INLINE UINT32 zgfx_hash(const BYTE* data)
+{
+	const UINT32 value = ((UINT32)data[0] << 16) | ((UINT32)data[1] << 8) | data[2];
+	return (value * 2654435761u) >> (32 - ZGFX_HASH_BITS);
+}
+
+static INLINE void zgfx_insert_position(ZGFX_CONTEXT* zgfx, UINT32 position)
+{
+	UINT32* bucket = &zgfx->MatchTable[zgfx_hash(&zgfx->HistoryBuffer[position]) * ZGFX_HASH_WAYS];
+	MoveMemory(&bucket[1], bucket, (ZGFX_HASH_WAYS - 1) * sizeof(UINT32));
+	bucket[0] = position + 1;
+}
+
+/* Encodes the segment at the end of the history, returns FALSE if it does not get smaller */
+static BOOL zgfx_encode_segment(ZGFX_CONTEXT* zgfx, UINT32 start, UINT32 size, BYTE* pDstData,
+                                size_t DstSize, size_t* pLength)
+{
+	UINT32 position = start;
+	const UINT32 end = start + size;
+	const BYTE* history = zgfx->HistoryBuffer;
+	ZGFX_BIT_WRITER w = { pDstData, DstSize, 0, 0, 0, FALSE };
+
+	while ((position < end) && !w.overflow)
+	{
+		UINT32 way;
+		UINT32 bestLength = 0;
+		UINT32 bestDistance = 0;
+		const ZGFX_TOKEN* bestToken = NULL;
+
+		if (end - position >= ZGFX_MIN_MATCH)
+		{
+			const UINT32* bucket =
+			    &zgfx->MatchTable[zgfx_hash(&history[position]) * ZGFX_HASH_WAYS];
+
+			for (way = 0; way < ZGFX_HASH_WAYS; way++)
+			{
+				UINT32 length = 0;
+				UINT32 bits, literalBits = 0;
+				const ZGFX_TOKEN* token;
+				const UINT32 candidate = bucket[way];
+
+				if ((candidate == 0) || (candidate > position))
+					break;
+
+				while ((position + length < end) &&
+				       (history[candidate - 1 + length] == history[position + length]))
+					length++;
+
+				if (length < ZGFX_MIN_MATCH)
+					continue;
+
+				token = zgfx_distance_token(position - candidate + 1);
+
+				if (!token)
+					continue;
+
+				bits = token->prefixLength + token->valueBits + zgfx_length_bits(length);
+
+				if (length > bestLength)
+				{
+					UINT32 x;
+
+					for (x = 0; x < length; x++)
+						literalBits += zgfx->LiteralBits[history[position + x]];
+
+					/* Short matches far away cost more than the literals */
+					if (bits >= literalBits)
+						continue;
+
+					bestLength = length;
+					bestDistance = position - candidate + 1;
+					bestToken = token;
+				}
+			}
+
+			zgfx_insert_position(zgfx, position);
+		}
+
+		if (bestLength > 0)
+		{
+			UINT32 x;
+
+			zgfx_put_match(&w, bestToken, bestDistance, bestLength);
+
+			for (x = 1; x < bestLength; x++)
+			{
+				if (end - (position + x) >= ZGFX_MIN_MATCH)
+					zgfx_insert_position(zgfx, position + x);
+			}
+
+			position += bestLength;
+		}
+		else
+		{
+			const BYTE c = history[position++];
+			zgfx_put_bits(&w, zgfx->LiteralCodes[c], zgfx->LiteralBits[c]);
+		}
+	}
+
+	/* The last byte holds the number of unused bits in the byte before */
+	if (w.bits > 0)
+	{
+		const UINT32 pad = 8 - w.bits;
+		zgfx_put_bits(&w, 0, pad);
+		zgfx_put_bits(&w, pad, 8);
+	}
+	else
+		zgfx_put_bits(&w, 0, 8);
+
+	*pLength = w.position;
+	return !w.overflow;
+}
+
 static BOOL zgfx_compress_segment(ZGFX_CONTEXT* zgfx, wStream* s, const BYTE* pSrcData,
                                   UINT32 SrcSize, UINT32* pFlags)
 {
-	/* FIXME: Currently compression not implemented. Just copy the raw source */
+	size_t length = 0;
+	UINT32 start;
+
 	if (!Stream_EnsureRemainingCapacity(s, SrcSize + 1))
 	{
 		WLog_ERR(TAG, "Stream_EnsureRemainingCapacity failed!");
@@ -463,7 +688,25 @@ static BOOL zgfx_compress_segment(ZGFX_CONTEXT* zgfx, wStream* s, const BYTE* pS
 	}
 
 	(*pFlags) |= ZGFX_PACKET_COMPR_TYPE_RDP8; /* RDP 8.0 compression format */
-	Stream_Write_UINT8(s, (*pFlags));         /* header (1 byte) */
+
+	/* The history is kept linear, matches do not reach back beyond a restart */
+	if (zgfx->HistoryIndex + SrcSize > zgfx->HistoryBufferSize)
+		zgfx_context_reset(zgfx, FALSE);
+
+	start = zgfx->HistoryIndex;
+	CopyMemory(&zgfx->HistoryBuffer[start], pSrcData, SrcSize);
+	zgfx->HistoryIndex += SrcSize;
+
+	/* Compressed segments are only sent if they are smaller than the data */
+	if ((SrcSize > ZGFX_MIN_MATCH) && zgfx->MatchTable &&
+	    zgfx_encode_segment(zgfx, start, SrcSize, Stream_Pointer(s) + 1, SrcSize - 1, &length))
+	{
+		Stream_Write_UINT8(s, (*pFlags) | PACKET_COMPRESSED); /* header (1 byte) */
+		Stream_Seek(s, length);
+		return TRUE;
+	}
+
+	Stream_Write_UINT8(s, (*pFlags)); /* header (1 byte) */
 	Stream_Write(s, pSrcData, SrcSize);
 	return TRUE;
 }
@@ -565,6 +808,10 @@ int zgfx_compress(ZGFX_CONTEXT* zgfx, const BYTE* pSrcData, UINT32 SrcSize, BYTE
 void zgfx_context_reset(ZGFX_CONTEXT* zgfx, BOOL flush)
 {
 	zgfx->HistoryIndex = 0;
+
+	if (zgfx->MatchTable)
+		ZeroMemory(zgfx->MatchTable,
+		           sizeof(UINT32) * ZGFX_HASH_WAYS * (1 << ZGFX_HASH_BITS));
 }
 
 ZGFX_CONTEXT* zgfx_context_new(BOOL Compressor)
@@ -576,6 +823,20 @@ ZGFX_CONTEXT* zgfx_context_new(BOOL Compressor)
 	{
 		zgfx->Compressor = Compressor;
 		zgfx->HistoryBufferSize = sizeof(zgfx->HistoryBuffer);
+
+		if (Compressor)
+		{
+			zgfx->MatchTable = calloc(ZGFX_HASH_WAYS * (1 << ZGFX_HASH_BITS), sizeof(UINT32));
+
+			if (!zgfx->MatchTable)
+			{
+				free(zgfx);
+				return NULL;
+			}
+
+			zgfx_init_literal_codes(zgfx);
+		}
+
 		zgfx_context_reset(zgfx, FALSE);
 	}
 
@@ -584,5 +845,9 @@ ZGFX_CONTEXT* zgfx_context_new(BOOL Compressor)
 
 void zgfx_context_free(ZGFX_CONTEXT* zgfx)
 {
+	if (!zgfx)
+		return;
+
+	free(zgfx->MatchTable);
 	free(zgfx);
 }
@@ -231,6 +231,9 @@ BOOL freerdp_settings_get_bool(const rdpSettings* settings, size_t id)
 		case FreeRDP_GfxAVC444:
 			return settings->GfxAVC444;
 
+		case FreeRDP_GfxAVC444IndependentAux:
+			return settings->GfxAVC444IndependentAux;
+
 		case FreeRDP_GfxAVC444v2:
 			return settings->GfxAVC444v2;
 
@@ -510,6 +513,9 @@ BOOL freerdp_settings_get_bool(const rdpSettings* settings, size_t id)
 		case FreeRDP_ToggleFullscreen:
 			return settings->ToggleFullscreen;
 
+		case FreeRDP_TransportDump:
+			return settings->TransportDump;
+
 		case FreeRDP_UnicodeInput:
 			return settings->UnicodeInput;
 
@@ -821,6 +827,10 @@ BOOL freerdp_settings_set_bool(rdpSettings* settings, size_t id, BOOL val)
 			settings->GfxAVC444 = val;
 			break;
 
+		case FreeRDP_GfxAVC444IndependentAux:
+			settings->GfxAVC444IndependentAux = val;
+			break;
+
 		case FreeRDP_GfxAVC444v2:
 			settings->GfxAVC444v2 = val;
 			break;
@@ -1193,6 +1203,10 @@ BOOL freerdp_settings_set_bool(rdpSettings* settings, size_t id, BOOL val)
 			settings->ToggleFullscreen = val;
 			break;
 
+		case FreeRDP_TransportDump:
+			settings->TransportDump = val;
+			break;
+
 		case FreeRDP_UnicodeInput:
 			settings->UnicodeInput = val;
 			break;
@@ -1531,6 +1545,9 @@ UINT32 freerdp_settings_get_uint32(const rdpSettings* settings, size_t id)
 		case FreeRDP_PreconnectionId:
 			return settings->PreconnectionId;
 
+		case FreeRDP_PrinterSpoolLimit:
+			return settings->PrinterSpoolLimit;
+
 		case FreeRDP_ProxyType:
 			return settings->ProxyType;
 
@@ -1960,6 +1977,10 @@ BOOL freerdp_settings_set_uint32(rdpSettings* settings, size_t id, UINT32 val)
 			settings->PreconnectionId = val;
 			break;
 
+		case FreeRDP_PrinterSpoolLimit:
+			settings->PrinterSpoolLimit = val;
+			break;
+
 		case FreeRDP_ProxyType:
 			settings->ProxyType = val;
 			break;
@@ -2420,6 +2441,9 @@ const char* freerdp_settings_get_string(const rdpSettings* settings, size_t id)
 		case FreeRDP_TargetNetAddress:
 			return settings->TargetNetAddress;
 
+		case FreeRDP_TransportDumpFile:
+			return settings->TransportDumpFile;
+
 		case FreeRDP_Username:
 			return settings->Username;
 
@@ -2637,6 +2661,9 @@ BOOL freerdp_settings_set_string_(rdpSettings* settings, size_t id, const char*
 		case FreeRDP_TargetNetAddress:
 			return update_string(&settings->TargetNetAddress, val, len, cleanup);
 
+		case FreeRDP_TransportDumpFile:
+			return update_string(&settings->TransportDumpFile, val, len, cleanup);
+
 		case FreeRDP_Username:
 			return update_string(&settings->Username, val, len, cleanup);
 
@@ -82,6 +82,7 @@ static const struct settings_str_entry settings_map[] = {
 	{ FreeRDP_GatewayUdpTransport, 0, "FreeRDP_GatewayUdpTransport" },
 	{ FreeRDP_GatewayUseSameCredentials, 0, "FreeRDP_GatewayUseSameCredentials" },
 	{ FreeRDP_GfxAVC444, 0, "FreeRDP_GfxAVC444" },
+	{ FreeRDP_GfxAVC444IndependentAux, 0, "FreeRDP_GfxAVC444IndependentAux" },
 	{ FreeRDP_GfxAVC444v2, 0, "FreeRDP_GfxAVC444v2" },
 	{ FreeRDP_GfxH264, 0, "FreeRDP_GfxH264" },
 	{ FreeRDP_GfxPlanar, 0, "FreeRDP_GfxPlanar" },
@@ -175,6 +176,7 @@ static const struct settings_str_entry settings_map[] = {
 	{ FreeRDP_TcpKeepAlive, 0, "FreeRDP_TcpKeepAlive" },
 	{ FreeRDP_TlsSecurity, 0, "FreeRDP_TlsSecurity" },
 	{ FreeRDP_ToggleFullscreen, 0, "FreeRDP_ToggleFullscreen" },
+	{ FreeRDP_TransportDump, 0, "FreeRDP_TransportDump" },
 	{ FreeRDP_UnicodeInput, 0, "FreeRDP_UnicodeInput" },
 	{ FreeRDP_UnmapButtons, 0, "FreeRDP_UnmapButtons" },
 	{ FreeRDP_UseMultimon, 0, "FreeRDP_UseMultimon" },
@@ -261,6 +263,7 @@ static const struct settings_str_entry settings_map[] = {
 	{ FreeRDP_PerformanceFlags, 3, "FreeRDP_PerformanceFlags" },
 	{ FreeRDP_PointerCacheSize, 3, "FreeRDP_PointerCacheSize" },
 	{ FreeRDP_PreconnectionId, 3, "FreeRDP_PreconnectionId" },
+	{ FreeRDP_PrinterSpoolLimit, 3, "FreeRDP_PrinterSpoolLimit" },
 	{ FreeRDP_ProxyType, 3, "FreeRDP_ProxyType" },
 	{ FreeRDP_RdpVersion, 3, "FreeRDP_RdpVersion" },
 	{ FreeRDP_ReceivedCapabilitiesSize, 3, "FreeRDP_ReceivedCapabilitiesSize" },
@@ -368,6 +371,7 @@ static const struct settings_str_entry settings_map[] = {
 	{ FreeRDP_ServerHostname, 7, "FreeRDP_ServerHostname" },
 	{ FreeRDP_ShellWorkingDirectory, 7, "FreeRDP_ShellWorkingDirectory" },
 	{ FreeRDP_TargetNetAddress, 7, "FreeRDP_TargetNetAddress" },
+	{ FreeRDP_TransportDumpFile, 7, "FreeRDP_TransportDumpFile" },
 	{ FreeRDP_Username, 7, "FreeRDP_Username" },
 	{ FreeRDP_WindowTitle, 7, "FreeRDP_WindowTitle" },
 	{ FreeRDP_WmClass, 7, "FreeRDP_WmClass" },
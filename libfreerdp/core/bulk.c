@@ -25,6 +25,12 @@
 
 #define TAG "com.freerdp.core"
 
+/* Payloads saving less than 1/BULK_MISS_RATIO are misses. After BULK_MAX_MISSES misses in a
+ * row compression is skipped for a number of payloads, doubled on each further miss. */
+#define BULK_MISS_RATIO 16
+#define BULK_MAX_MISSES 4
+#define BULK_MAX_BACKOFF 256
+
 //#define WITH_BULK_DEBUG		1
 struct rdp_bulk
 {
@@ -37,6 +43,13 @@ struct rdp_bulk
 	NCRUSH_CONTEXT* ncrushSend;
 	XCRUSH_CONTEXT* xcrushRecv;
 	XCRUSH_CONTEXT* xcrushSend;
+	ZGFX_CONTEXT* zgfxRecv;
+	ZGFX_CONTEXT* zgfxSend;
+	wStream* zgfxOutput;
+	BYTE* zgfxDecompressed;
+	UINT32 Misses;
+	UINT32 Backoff;
+	UINT32 Skip;
 	BYTE OutputBuffer[65536];
 };
 
@@ -69,19 +82,99 @@ static INLINE const char* bulk_get_compression_flags_string(UINT32 flags)
 static UINT32 bulk_compression_level(rdpBulk* bulk)
 {
 	rdpSettings* settings = bulk->context->settings;
-	bulk->CompressionLevel = (settings->CompressionLevel >= PACKET_COMPR_TYPE_RDP61)
-	                             ? PACKET_COMPR_TYPE_RDP61
+	bulk->CompressionLevel = (settings->CompressionLevel >= PACKET_COMPR_TYPE_RDP8)
+	                             ? PACKET_COMPR_TYPE_RDP8
 	                             : settings->CompressionLevel;
 	return bulk->CompressionLevel;
 }
 
+/* The largest payload compressed as a whole, RDP8 splits larger ones into segments.
+ * The RDP6 and RDP6.1 encoders only handle up to 16K at once. */
 UINT32 bulk_compression_max_size(rdpBulk* bulk)
 {
 	bulk_compression_level(bulk);
-	bulk->CompressionMaxSize = (bulk->CompressionLevel < PACKET_COMPR_TYPE_64K) ? 8192 : 65536;
+
+	switch (bulk->CompressionLevel)
+	{
+		case PACKET_COMPR_TYPE_8K:
+			bulk->CompressionMaxSize = 8192;
+			break;
+
+		case PACKET_COMPR_TYPE_RDP6:
+		case PACKET_COMPR_TYPE_RDP61:
+			bulk->CompressionMaxSize = 16384;
+			break;
+
+		default:
+			bulk->CompressionMaxSize = 65536;
+			break;
+	}
+
 	return bulk->CompressionMaxSize;
 }
 
+static BOOL bulk_zgfx_init(rdpBulk* bulk, BOOL compressor)
+{
+	if (compressor && !bulk->zgfxSend)
+	{
+		bulk->zgfxSend = zgfx_context_new(TRUE);
+		bulk->zgfxOutput = Stream_New(NULL, sizeof(bulk->OutputBuffer));
+	}
+	else if (!compressor && !bulk->zgfxRecv)
+		bulk->zgfxRecv = zgfx_context_new(FALSE);
+
+	return compressor ? (bulk->zgfxSend && bulk->zgfxOutput) : (bulk->zgfxRecv != NULL);
+}
+
+static int bulk_compress_rdp8(rdpBulk* bulk, const BYTE* pSrcData, UINT32 SrcSize,
+                              BYTE** ppDstData, UINT32* pDstSize, UINT32* pFlags)
+{
+	UINT32 flags = 0;
+
+	if (!bulk_zgfx_init(bulk, TRUE))
+		return -1;
+
+	Stream_SetPosition(bulk->zgfxOutput, 0);
+
+	if (zgfx_compress_to_stream(bulk->zgfxSend, bulk->zgfxOutput, pSrcData, SrcSize, &flags) < 0)
+		return -1;
+
+	/* The segmented data is always parsed by the receiver, even if sent unencoded */
+	*ppDstData = Stream_Buffer(bulk->zgfxOutput);
+	*pDstSize = (UINT32)Stream_GetPosition(bulk->zgfxOutput);
+	*pFlags = PACKET_COMPRESSED | PACKET_COMPR_TYPE_RDP8;
+	return 1;
+}
+
+/* Tracks the compression ratio, returns TRUE while compression is skipped */
+static BOOL bulk_compression_skipped(rdpBulk* bulk)
+{
+	if (bulk->Skip == 0)
+		return FALSE;
+
+	bulk->Skip--;
+	return TRUE;
+}
+
+static void bulk_compression_result(rdpBulk* bulk, UINT32 SrcSize, UINT32 DstSize, UINT32 flags)
+{
+	const BOOL compressed = (flags & PACKET_COMPRESSED) != 0;
+
+	if (compressed && (DstSize + SrcSize / BULK_MISS_RATIO < SrcSize))
+	{
+		bulk->Misses = 0;
+		bulk->Backoff = 0;
+		return;
+	}
+
+	if (++bulk->Misses < BULK_MAX_MISSES)
+		return;
+
+	bulk->Backoff = (bulk->Backoff == 0) ? 1 : MIN(bulk->Backoff * 2, BULK_MAX_BACKOFF);
+	bulk->Skip = bulk->Backoff;
+	bulk->Misses = BULK_MAX_MISSES - 1;
+}
+
 #if WITH_BULK_DEBUG
 static INLINE int bulk_compress_validate(rdpBulk* bulk, BYTE* pSrcData, UINT32 SrcSize,
                                          BYTE** ppDstData, UINT32* pDstSize, UINT32* pFlags)
@@ -169,9 +262,18 @@ int bulk_decompress(rdpBulk* bulk, BYTE* pSrcData, UINT32 SrcSize, BYTE** ppDstD
 				break;
 
 			case PACKET_COMPR_TYPE_RDP8:
-				WLog_ERR(TAG, "Unsupported bulk compression type %08" PRIx32,
-				         bulk->CompressionLevel);
-				status = -1;
+				free(bulk->zgfxDecompressed);
+				bulk->zgfxDecompressed = NULL;
+
+				if (!bulk_zgfx_init(bulk, FALSE))
+					break;
+
+				status = zgfx_decompress(bulk->zgfxRecv, pSrcData, SrcSize, ppDstData, pDstSize,
+				                         flags);
+
+				if (status >= 0)
+					bulk->zgfxDecompressed = *ppDstData;
+
 				break;
 			default:
 				WLog_ERR(TAG, "Unknown bulk compression type %08" PRIx32, bulk->CompressionLevel);
@@ -223,7 +325,11 @@ int bulk_compress(rdpBulk* bulk, BYTE* pSrcData, UINT32 SrcSize, BYTE** ppDstDat
 	double CompressionRatio;
 	metrics = bulk->context->metrics;
 
-	if ((SrcSize <= 50) || (SrcSize >= 16384))
+	bulk_compression_max_size(bulk);
+
+	if ((SrcSize <= 50) || bulk_compression_skipped(bulk) ||
+	    ((SrcSize > bulk->CompressionMaxSize) &&
+	     (bulk->CompressionLevel != PACKET_COMPR_TYPE_RDP8)))
 	{
 		*ppDstData = pSrcData;
 		*pDstSize = SrcSize;
@@ -232,8 +338,6 @@ int bulk_compress(rdpBulk* bulk, BYTE* pSrcData, UINT32 SrcSize, BYTE** ppDstDat
 
 	*ppDstData = bulk->OutputBuffer;
 	*pDstSize = sizeof(bulk->OutputBuffer);
-	bulk_compression_level(bulk);
-	bulk_compression_max_size(bulk);
 
 	switch (bulk->CompressionLevel)
 	{
@@ -251,8 +355,7 @@ int bulk_compress(rdpBulk* bulk, BYTE* pSrcData, UINT32 SrcSize, BYTE** ppDstDat
 			    xcrush_compress(bulk->xcrushSend, pSrcData, SrcSize, ppDstData, pDstSize, pFlags);
 			break;
 		case PACKET_COMPR_TYPE_RDP8:
-			WLog_ERR(TAG, "Unsupported bulk compression type %08" PRIx32, bulk->CompressionLevel);
-			status = -1;
+			status = bulk_compress_rdp8(bulk, pSrcData, SrcSize, ppDstData, pDstSize, pFlags);
 			break;
 		default:
 			WLog_ERR(TAG, "Unknown bulk compression type %08" PRIx32, bulk->CompressionLevel);
@@ -262,6 +365,7 @@ int bulk_compress(rdpBulk* bulk, BYTE* pSrcData, UINT32 SrcSize, BYTE** ppDstDat
 
 	if (status >= 0)
 	{
+		bulk_compression_result(bulk, SrcSize, *pDstSize, *pFlags);
 		CompressedBytes = *pDstSize;
 		UncompressedBytes = SrcSize;
 		CompressionRatio = metrics_write_bytes(metrics, UncompressedBytes, CompressedBytes);
@@ -300,6 +404,16 @@ void bulk_reset(rdpBulk* bulk)
 	ncrush_context_reset(bulk->ncrushSend, FALSE);
 	xcrush_context_reset(bulk->xcrushRecv, FALSE);
 	xcrush_context_reset(bulk->xcrushSend, FALSE);
+
+	if (bulk->zgfxRecv)
+		zgfx_context_reset(bulk->zgfxRecv, FALSE);
+
+	if (bulk->zgfxSend)
+		zgfx_context_reset(bulk->zgfxSend, FALSE);
+
+	bulk->Misses = 0;
+	bulk->Backoff = 0;
+	bulk->Skip = 0;
 }
 
 rdpBulk* bulk_new(rdpContext* context)
@@ -333,5 +447,9 @@ void bulk_free(rdpBulk* bulk)
 	ncrush_context_free(bulk->ncrushSend);
 	xcrush_context_free(bulk->xcrushRecv);
 	xcrush_context_free(bulk->xcrushSend);
+	zgfx_context_free(bulk->zgfxRecv);
+	zgfx_context_free(bulk->zgfxSend);
+	Stream_Free(bulk->zgfxOutput, TRUE);
+	free(bulk->zgfxDecompressed);
 	free(bulk);
 }
@@ -28,6 +28,7 @@ typedef struct rdp_bulk rdpBulk;
 #include <freerdp/codec/mppc.h>
 #include <freerdp/codec/ncrush.h>
 #include <freerdp/codec/xcrush.h>
+#include <freerdp/codec/zgfx.h>
 
 #define BULK_COMPRESSION_FLAGS_MASK 0xE0
 #define BULK_COMPRESSION_TYPE_MASK 0x0F
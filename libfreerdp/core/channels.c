@@ -304,3 +304,27 @@ BOOL freerdp_channel_send_packet(rdpRdp* rdp, UINT16 channelId, size_t totalSize
 	/* WLog_DBG(TAG, "%s: sending data (flags=0x%x size=%d)", __FUNCTION__, flags, size); */
 	return rdp_send(rdp, s, channelId);
 }
+
+/* Sends a PDU fitting in a single packet, the header is written in front of the data so neither
+ * has to be copied to a buffer of its own before. */
+BOOL freerdp_channel_send_chunk(rdpRdp* rdp, UINT16 channelId, const BYTE* header,
+                                size_t headerLength, const BYTE* data, size_t length)
+{
+	wStream* s = rdp_send_stream_init(rdp);
+
+	if (!s)
+		return FALSE;
+
+	Stream_Write_UINT32(s, headerLength + length);
+	Stream_Write_UINT32(s, CHANNEL_FLAG_FIRST | CHANNEL_FLAG_LAST);
+
+	if (!Stream_EnsureRemainingCapacity(s, headerLength + length))
+	{
+		Stream_Release(s);
+		return FALSE;
+	}
+
+	Stream_Write(s, header, headerLength);
+	Stream_Write(s, data, length);
+	return rdp_send(rdp, s, channelId);
+}
@@ -27,6 +27,9 @@ FREERDP_LOCAL BOOL freerdp_channel_send(rdpRdp* rdp, UINT16 channelId, const BYT
                                         size_t size);
 FREERDP_LOCAL BOOL freerdp_channel_send_packet(rdpRdp* rdp, UINT16 channelId, size_t totalSize,
                                                UINT32 flags, const BYTE* data, size_t chunkSize);
+FREERDP_LOCAL BOOL freerdp_channel_send_chunk(rdpRdp* rdp, UINT16 channelId, const BYTE* header,
+                                              size_t headerLength, const BYTE* data,
+                                              size_t length);
 FREERDP_LOCAL BOOL freerdp_channel_process(freerdp* instance, wStream* s, UINT16 channelId,
                                            size_t packetLength);
 FREERDP_LOCAL BOOL freerdp_channel_peer_process(freerdp_peer* client, wStream* s, UINT16 channelId);
@@ -1290,10 +1290,26 @@ BOOL rdp_server_accept_nego(rdpRdp* rdp, wStream* s)
 		return FALSE;
 
 	transport_set_blocking_mode(rdp->transport, FALSE);
-	rdp_server_transition_to_state(rdp, CONNECTION_STATE_NEGO);
+
+	/* NLA continues with the next requests of the client, see rdp_server_accept_nla */
+	if ((SelectedProtocol & PROTOCOL_HYBRID) && transport_get_nla(rdp->transport))
+		rdp_server_transition_to_state(rdp, CONNECTION_STATE_NLA);
+	else
+		rdp_server_transition_to_state(rdp, CONNECTION_STATE_NEGO);
+
 	return TRUE;
 }
 
+int rdp_server_accept_nla(rdpRdp* rdp, wStream* s)
+{
+	const int status = transport_accept_nla_recv(rdp->transport, s);
+
+	if (status > 0)
+		rdp_server_transition_to_state(rdp, CONNECTION_STATE_NEGO);
+
+	return status;
+}
+
 BOOL rdp_server_accept_mcs_connect_initial(rdpRdp* rdp, wStream* s)
 {
 	UINT32 i;
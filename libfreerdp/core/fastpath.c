@@ -41,6 +41,7 @@
 #include "surface.h"
 #include "fastpath.h"
 #include "rdp.h"
+#include "window.h"
 
 #include "../cache/pointer.h"
 #include "../cache/palette.h"
@@ -225,6 +226,7 @@ BOOL fastpath_read_header_rdp(rdpFastPath* fastpath, wStream* s, UINT16* length)
 
 static BOOL fastpath_recv_orders(rdpFastPath* fastpath, wStream* s)
 {
+	BOOL rc = TRUE;
 	rdpUpdate* update;
 	UINT16 numberOrders;
 
@@ -249,16 +251,23 @@ static BOOL fastpath_recv_orders(rdpFastPath* fastpath, wStream* s)
 	}
 
 	Stream_Read_UINT16(s, numberOrders); /* numberOrders (2 bytes) */
+	update_begin_window_orders(update);
 
 	while (numberOrders > 0)
 	{
 		if (!update_recv_order(update, s))
-			return FALSE;
+		{
+			rc = FALSE;
+			break;
+		}
 
 		numberOrders--;
 	}
 
-	return TRUE;
+	if (!update_end_window_orders(update, rc))
+		return FALSE;
+
+	return rc;
 }
 
 static BOOL fastpath_recv_update_common(rdpFastPath* fastpath, wStream* s)
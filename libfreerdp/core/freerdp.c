@@ -138,6 +138,14 @@ BOOL freerdp_connect(freerdp* instance)
 			if (rdp->update->pcap_rfx)
 				rdp->update->dump_rfx = TRUE;
 		}
+
+		if (rdp->settings->TransportDump)
+		{
+			rdp->transportDump = pcap_open(rdp->settings->TransportDumpFile, TRUE);
+
+			if (!rdp->transportDump)
+				WLog_WARN(TAG, "failed to open PDU dump file %s", rdp->settings->TransportDumpFile);
+		}
 	}
 
 	if (status)
@@ -493,6 +501,14 @@ BOOL freerdp_disconnect(freerdp* instance)
 		instance->update->pcap_rfx = NULL;
 	}
 
+	if (rdp->transportDump)
+	{
+		EnterCriticalSection(&rdp->critical);
+		pcap_close(rdp->transportDump);
+		rdp->transportDump = NULL;
+		LeaveCriticalSection(&rdp->critical);
+	}
+
 	freerdp_channels_close(instance->context->channels, instance);
 	return rc;
 }
@@ -776,6 +792,43 @@ BOOL freerdp_send_error_info(rdpRdp* rdp)
 	return rdp_send_error_info(rdp);
 }
 
+BOOL freerdp_send_pdu(rdpContext* context, const BYTE* data, size_t length)
+{
+	int status;
+	wStream* s;
+	rdpRdp* rdp;
+
+	if (!context || !context->rdp || !data || (length == 0))
+		return FALSE;
+
+	rdp = context->rdp;
+
+	/* PDUs can only be sent as they are without RDP security */
+	if (rdp->do_crypt)
+		return FALSE;
+
+	s = Stream_New(NULL, length);
+
+	if (!s)
+		return FALSE;
+
+	Stream_Write(s, data, length);
+
+	/* Slow path data is sent on behalf of the MCS user of this session */
+	if ((length >= 10) && (data[0] == 0x03) &&
+	    ((data[7] >> 2) == DomainMCSPDU_SendDataRequest))
+	{
+		BYTE* initiator = Stream_Buffer(s) + 8;
+		const UINT16 userId = rdp->mcs->userId - MCS_BASE_CHANNEL_ID;
+		initiator[0] = userId >> 8;
+		initiator[1] = userId & 0xFF;
+	}
+
+	status = transport_write(rdp->transport, s);
+	Stream_Free(s, TRUE);
+	return status >= 0;
+}
+
 UINT32 freerdp_get_last_error(rdpContext* context)
 {
 	return context->LastError;
@@ -42,6 +42,7 @@
 #include <winpr/dsparse.h>
 #include <winpr/library.h>
 #include <winpr/registry.h>
+#include <winpr/sysinfo.h>
 
 #include "nla.h"
 #include "utils.h"
@@ -97,6 +98,9 @@
 
 #define TERMSRV_SPN_PREFIX "TERMSRV/"
 
+/* Milliseconds a client gets for each step of the exchange before the server gives up */
+#define NLA_SERVER_STATE_TIMEOUT 60000
+
 struct rdp_nla
 {
 	BOOL server;
@@ -120,6 +124,9 @@ struct rdp_nla
 	BOOL haveInputBuffer;
 	BOOL havePubKeyAuth;
 	SECURITY_STATUS status;
+	UINT64 stateTime;
+	DWORD stateTimeout;
+	wStream* recvBuffer;
 	CredHandle credentials;
 	TimeStamp expiration;
 
@@ -140,7 +147,7 @@ struct rdp_nla
 };
 
 static BOOL nla_send(rdpNla* nla);
-static int nla_server_recv(rdpNla* nla);
+static int nla_decode_ts_request(rdpNla* nla, wStream* s);
 static void nla_buffer_free(rdpNla* nla);
 static SECURITY_STATUS nla_encrypt_public_key_echo(rdpNla* nla);
 static SECURITY_STATUS nla_encrypt_public_key_hash(rdpNla* nla);
@@ -1062,255 +1069,205 @@ static int nla_server_init(rdpNla* nla)
 	return 1;
 }
 
-static wStream* nla_server_recv_stream(rdpNla* nla)
+/* Server side of the exchange, each state waits for the next TSRequest of the client:
+ *
+ * -- NLA_STATE_NEGO_TOKEN
+ * <<----- receiving...
+ *    <<----- nego token
+ * ----->> sending...
+ *    ----->> nego token
+ * -- NLA_STATE_NEGO_TOKEN until the security context is complete
+ * -- NLA_STATE_PUB_KEY_AUTH if the last nego token had to be answered
+ * <<----- receiving...
+ *    <<----- public key info (otherwise with the last nego token)
+ * ----->> sending...
+ *    ----->> public key auth
+ * -- NLA_STATE_AUTH_INFO
+ * <<----- receiving...
+ *    <<----- auth info
+ * -- NLA_STATE_FINAL
+ */
+
+static int nla_server_recv_pub_key_auth(rdpNla* nla)
 {
-	wStream* s = NULL;
-	int status = -1;
-	s = Stream_New(NULL, 4096);
+	nla->havePubKeyAuth = TRUE;
+	nla->status = nla_query_context_sizes(nla);
 
-	if (!s)
-		goto fail;
+	if (nla->status != SEC_E_OK)
+		return -1;
 
-	status = transport_read_pdu(nla->transport, s);
+	if (nla->peerVersion < 5)
+		nla->status = nla_decrypt_public_key_echo(nla);
+	else
+		nla->status = nla_decrypt_public_key_hash(nla);
 
-fail:
-	if (status < 0)
+	if (nla->status != SEC_E_OK)
 	{
-		WLog_ERR(TAG, "nla_recv() error: %d", status);
-		Stream_Free(s, TRUE);
-		return NULL;
+		WLog_ERR(TAG, "Error: could not verify client's public key echo %s [0x%08" PRIX32 "]",
+		         GetSecurityStatusString(nla->status), nla->status);
+		return -1;
 	}
 
-	return s;
-}
-
-/**
- * Authenticate with client using CredSSP (server).
- * @param credssp
- * @return 1 if authentication is successful
- */
-
-static int nla_server_authenticate(rdpNla* nla)
-{
-	int res = -1;
-	if (nla_server_init(nla) < 1)
-		goto fail_auth;
-
-	/* Client is starting, here es the state machine:
-	 *
-	 *  -- NLA_STATE_INITIAL	--> NLA_STATE_INITIAL
-	 * ----->> sending...
-	 *    ----->> protocol version 6
-	 *    ----->> nego token
-	 *    ----->> client nonce
-	 * <<----- receiving...
-	 *    <<----- protocol version 6
-	 *    <<----- nego token
-	 * ----->> sending...
-	 *    ----->> protocol version 6
-	 *    ----->> nego token
-	 *    ----->> public key auth
-	 *    ----->> client nonce
-	 * -- NLA_STATE_NEGO_TOKEN	--> NLA_STATE_PUB_KEY_AUTH
-	 * <<----- receiving...
-	 *    <<----- protocol version 6
-	 *    <<----- public key info
-	 * ----->> sending...
-	 *    ----->> protocol version 6
-	 *    ----->> auth info
-	 *    ----->> client nonce
-	 * -- NLA_STATE_PUB_KEY_AUTH	--> NLA_STATE
-	 */
-
-	while (TRUE)
-	{
-		SecBuffer inputBuffer = { 0 };
-		SecBuffer outputBuffer = { 0 };
-		SecBufferDesc inputBufferDesc = { 0 };
-		SecBufferDesc outputBufferDesc = { 0 };
+	sspi_SecBufferFree(&nla->negoToken);
 
-		/* receive authentication token */
-		inputBufferDesc.ulVersion = SECBUFFER_VERSION;
-		inputBufferDesc.cBuffers = 1;
-		inputBufferDesc.pBuffers = &inputBuffer;
+	if (nla->peerVersion < 5)
+		nla->status = nla_encrypt_public_key_echo(nla);
+	else
+		nla->status = nla_encrypt_public_key_hash(nla);
 
-		if (nla_server_recv(nla) < 0)
-			goto fail_auth;
+	if (nla->status != SEC_E_OK)
+		return -1;
 
-		WLog_DBG(TAG, "Receiving Authentication Token");
-		if (!nla_sec_buffer_alloc_from_buffer(&inputBuffer, &nla->negoToken, 0))
-		{
-			WLog_ERR(TAG, "CredSSP: invalid negoToken!");
-			goto fail_auth;
-		}
+	WLog_DBG(TAG, "Sending Authentication Token");
 
-		outputBufferDesc.ulVersion = SECBUFFER_VERSION;
-		outputBufferDesc.cBuffers = 1;
-		outputBufferDesc.pBuffers = &outputBuffer;
+	if (!nla_send(nla))
+		return -1;
 
-		if (!nla_sec_buffer_alloc(&outputBuffer, nla->cbMaxToken))
-			goto fail_auth;
+	nla_set_state(nla, NLA_STATE_AUTH_INFO);
+	return 0;
+}
 
-		nla->status = nla->table->AcceptSecurityContext(
-		    &nla->credentials, nla->haveContext ? &nla->context : NULL, &inputBufferDesc,
-		    nla->fContextReq, SECURITY_NATIVE_DREP, &nla->context, &outputBufferDesc,
-		    &nla->pfContextAttr, &nla->expiration);
-		WLog_VRB(TAG, "AcceptSecurityContext status %s [0x%08" PRIX32 "]",
-		         GetSecurityStatusString(nla->status), nla->status);
+static int nla_server_recv_nego_token(rdpNla* nla)
+{
+	int rc = -1;
+	SecBuffer inputBuffer = { 0 };
+	SecBuffer outputBuffer = { 0 };
+	SecBufferDesc inputBufferDesc = { 0 };
+	SecBufferDesc outputBufferDesc = { 0 };
 
-		if (!nla_sec_buffer_alloc_from_buffer(&nla->negoToken, &outputBuffer, 0))
-			goto fail_auth;
+	inputBufferDesc.ulVersion = SECBUFFER_VERSION;
+	inputBufferDesc.cBuffers = 1;
+	inputBufferDesc.pBuffers = &inputBuffer;
 
-		if ((nla->status == SEC_I_COMPLETE_AND_CONTINUE) || (nla->status == SEC_I_COMPLETE_NEEDED))
-		{
-			freerdp_peer* peer = nla->instance->context->peer;
+	WLog_DBG(TAG, "Receiving Authentication Token");
+	if (!nla_sec_buffer_alloc_from_buffer(&inputBuffer, &nla->negoToken, 0))
+	{
+		WLog_ERR(TAG, "CredSSP: invalid negoToken!");
+		goto fail;
+	}
 
-			if (peer->ComputeNtlmHash)
-			{
-				SECURITY_STATUS status;
-				status = nla->table->SetContextAttributes(
-				    &nla->context, SECPKG_ATTR_AUTH_NTLM_HASH_CB, (void*)peer->ComputeNtlmHash, 0);
+	outputBufferDesc.ulVersion = SECBUFFER_VERSION;
+	outputBufferDesc.cBuffers = 1;
+	outputBufferDesc.pBuffers = &outputBuffer;
 
-				if (status != SEC_E_OK)
-				{
-					WLog_ERR(TAG, "SetContextAttributesA(hash cb) status %s [0x%08" PRIX32 "]",
-					         GetSecurityStatusString(status), status);
-				}
+	if (!nla_sec_buffer_alloc(&outputBuffer, nla->cbMaxToken))
+		goto fail;
 
-				status = nla->table->SetContextAttributes(
-				    &nla->context, SECPKG_ATTR_AUTH_NTLM_HASH_CB_DATA, peer, 0);
+	nla->status = nla->table->AcceptSecurityContext(
+	    &nla->credentials, nla->haveContext ? &nla->context : NULL, &inputBufferDesc,
+	    nla->fContextReq, SECURITY_NATIVE_DREP, &nla->context, &outputBufferDesc,
+	    &nla->pfContextAttr, &nla->expiration);
+	WLog_VRB(TAG, "AcceptSecurityContext status %s [0x%08" PRIX32 "]",
+	         GetSecurityStatusString(nla->status), nla->status);
 
-				if (status != SEC_E_OK)
-				{
-					WLog_ERR(TAG, "SetContextAttributesA(hash cb data) status %s [0x%08" PRIX32 "]",
-					         GetSecurityStatusString(status), status);
-				}
-			}
-			else if (nla->SamFile)
-			{
-				nla->table->SetContextAttributes(&nla->context, SECPKG_ATTR_AUTH_NTLM_SAM_FILE,
-				                                 nla->SamFile, strlen(nla->SamFile) + 1);
-			}
+	if (!nla_sec_buffer_alloc_from_buffer(&nla->negoToken, &outputBuffer, 0))
+		goto fail;
 
-			if (!nla_complete_auth(nla, &outputBufferDesc))
-				goto fail_auth;
-		}
+	if ((nla->status == SEC_I_COMPLETE_AND_CONTINUE) || (nla->status == SEC_I_COMPLETE_NEEDED))
+	{
+		freerdp_peer* peer = nla->instance->context->peer;
 
-		if (nla->status == SEC_E_OK)
+		if (peer && peer->ComputeNtlmHash)
 		{
-			int rc = -1;
+			SECURITY_STATUS status;
+			status = nla->table->SetContextAttributes(
+			    &nla->context, SECPKG_ATTR_AUTH_NTLM_HASH_CB, (void*)peer->ComputeNtlmHash, 0);
 
-			if (outputBuffer.cbBuffer != 0)
+			if (status != SEC_E_OK)
 			{
-				if (!nla_send(nla))
-				{
-					nla_buffer_free(nla);
-					goto fail;
-				}
-
-				if (nla_server_recv(nla) < 0)
-					goto fail;
-
-				WLog_DBG(TAG, "Receiving pubkey Token");
+				WLog_ERR(TAG, "SetContextAttributesA(hash cb) status %s [0x%08" PRIX32 "]",
+				         GetSecurityStatusString(status), status);
 			}
 
-			nla->havePubKeyAuth = TRUE;
-			nla->status = nla_query_context_sizes(nla);
-
-			if (nla->status != SEC_E_OK)
-				goto fail;
+			status = nla->table->SetContextAttributes(
+			    &nla->context, SECPKG_ATTR_AUTH_NTLM_HASH_CB_DATA, peer, 0);
 
-			if (nla->peerVersion < 5)
-				nla->status = nla_decrypt_public_key_echo(nla);
-			else
-				nla->status = nla_decrypt_public_key_hash(nla);
-
-			if (nla->status != SEC_E_OK)
+			if (status != SEC_E_OK)
 			{
-				WLog_ERR(TAG,
-				         "Error: could not verify client's public key echo %s [0x%08" PRIX32 "]",
-				         GetSecurityStatusString(nla->status), nla->status);
-				goto fail;
+				WLog_ERR(TAG, "SetContextAttributesA(hash cb data) status %s [0x%08" PRIX32 "]",
+				         GetSecurityStatusString(status), status);
 			}
+		}
+		else if (nla->SamFile)
+		{
+			nla->table->SetContextAttributes(&nla->context, SECPKG_ATTR_AUTH_NTLM_SAM_FILE,
+			                                 nla->SamFile, strlen(nla->SamFile) + 1);
+		}
 
-			sspi_SecBufferFree(&nla->negoToken);
-
-			if (nla->peerVersion < 5)
-				nla->status = nla_encrypt_public_key_echo(nla);
-			else
-				nla->status = nla_encrypt_public_key_hash(nla);
+		if (!nla_complete_auth(nla, &outputBufferDesc))
+			goto fail;
+	}
 
-			if (nla->status != SEC_E_OK)
+	if (nla->status == SEC_E_OK)
+	{
+		/* The public key info is sent with the last nego token or in the next request */
+		if (outputBuffer.cbBuffer != 0)
+		{
+			if (!nla_send(nla))
 				goto fail;
 
-			rc = 1;
-		fail:
-			sspi_SecBufferFree(&inputBuffer);
-			sspi_SecBufferFree(&outputBuffer);
-			if (rc < 0)
-			{
-				res = rc;
-				goto fail_auth;
-			}
+			nla_set_state(nla, NLA_STATE_PUB_KEY_AUTH);
+			rc = 0;
 		}
+		else
+			rc = nla_server_recv_pub_key_auth(nla);
 
-		if ((nla->status != SEC_E_OK) && (nla->status != SEC_I_CONTINUE_NEEDED))
-		{
-			/* Special handling of these specific error codes as NTSTATUS_FROM_WIN32
-			   unfortunately does not map directly to the corresponding NTSTATUS values
-			 */
-			switch (GetLastError())
-			{
-				case ERROR_PASSWORD_MUST_CHANGE:
-					nla->errorCode = STATUS_PASSWORD_MUST_CHANGE;
-					break;
-
-				case ERROR_PASSWORD_EXPIRED:
-					nla->errorCode = STATUS_PASSWORD_EXPIRED;
-					break;
-
-				case ERROR_ACCOUNT_DISABLED:
-					nla->errorCode = STATUS_ACCOUNT_DISABLED;
-					break;
+		goto fail;
+	}
 
-				default:
-					nla->errorCode = NTSTATUS_FROM_WIN32(GetLastError());
-					break;
-			}
+	if (nla->status != SEC_I_CONTINUE_NEEDED)
+	{
+		/* Special handling of these specific error codes as NTSTATUS_FROM_WIN32
+		   unfortunately does not map directly to the corresponding NTSTATUS values
+		 */
+		switch (GetLastError())
+		{
+			case ERROR_PASSWORD_MUST_CHANGE:
+				nla->errorCode = STATUS_PASSWORD_MUST_CHANGE;
+				break;
 
-			WLog_ERR(TAG, "AcceptSecurityContext status %s [0x%08" PRIX32 "]",
-			         GetSecurityStatusString(nla->status), nla->status);
-			nla_send(nla);
-			goto fail_auth; /* Access Denied */
-		}
+			case ERROR_PASSWORD_EXPIRED:
+				nla->errorCode = STATUS_PASSWORD_EXPIRED;
+				break;
 
-		/* send authentication token */
-		WLog_DBG(TAG, "Sending Authentication Token");
+			case ERROR_ACCOUNT_DISABLED:
+				nla->errorCode = STATUS_ACCOUNT_DISABLED;
+				break;
 
-		if (!nla_send(nla))
-		{
-			nla_buffer_free(nla);
-			goto fail_auth;
+			default:
+				nla->errorCode = NTSTATUS_FROM_WIN32(GetLastError());
+				break;
 		}
 
-		if (nla->status != SEC_I_CONTINUE_NEEDED)
-			break;
-
-		nla->haveContext = TRUE;
+		WLog_ERR(TAG, "AcceptSecurityContext status %s [0x%08" PRIX32 "]",
+		         GetSecurityStatusString(nla->status), nla->status);
+		nla_send(nla);
+		goto fail; /* Access Denied */
 	}
 
-	/* Receive encrypted credentials */
+	/* send authentication token */
+	WLog_DBG(TAG, "Sending Authentication Token");
+
+	if (!nla_send(nla))
+		goto fail;
 
-	if (nla_server_recv(nla) < 0)
-		goto fail_auth;
+	nla->haveContext = TRUE;
+	rc = 0;
+fail:
+	sspi_SecBufferFree(&inputBuffer);
+	sspi_SecBufferFree(&outputBuffer);
+	return rc;
+}
 
+static int nla_server_recv_auth_info(rdpNla* nla)
+{
 	nla->status = nla_decrypt_ts_credentials(nla);
 
 	if (nla->status != SEC_E_OK)
 	{
 		WLog_ERR(TAG, "Could not decrypt TSCredentials status %s [0x%08" PRIX32 "]",
 		         GetSecurityStatusString(nla->status), nla->status);
-		goto fail_auth;
+		return -1;
 	}
 
 	nla->status = nla->table->ImpersonateSecurityContext(&nla->context);
@@ -1319,24 +1276,183 @@ static int nla_server_authenticate(rdpNla* nla)
 	{
 		WLog_ERR(TAG, "ImpersonateSecurityContext status %s [0x%08" PRIX32 "]",
 		         GetSecurityStatusString(nla->status), nla->status);
-		goto fail_auth;
+		return -1;
 	}
-	else
+
+	nla->status = nla->table->RevertSecurityContext(&nla->context);
+
+	if (nla->status != SEC_E_OK)
 	{
-		nla->status = nla->table->RevertSecurityContext(&nla->context);
+		WLog_ERR(TAG, "RevertSecurityContext status %s [0x%08" PRIX32 "]",
+		         GetSecurityStatusString(nla->status), nla->status);
+		return -1;
+	}
 
-		if (nla->status != SEC_E_OK)
-		{
-			WLog_ERR(TAG, "RevertSecurityContext status %s [0x%08" PRIX32 "]",
-			         GetSecurityStatusString(nla->status), nla->status);
-			goto fail_auth;
-		}
+	nla_set_state(nla, NLA_STATE_FINAL);
+	return 1;
+}
+
+static int nla_server_recv_pdu(rdpNla* nla, wStream* s)
+{
+	if (nla_decode_ts_request(nla, s) < 1)
+		return -1;
+
+	switch (nla_get_state(nla))
+	{
+		case NLA_STATE_NEGO_TOKEN:
+			return nla_server_recv_nego_token(nla);
+
+		case NLA_STATE_PUB_KEY_AUTH:
+			WLog_DBG(TAG, "Receiving pubkey Token");
+			return nla_server_recv_pub_key_auth(nla);
+
+		case NLA_STATE_AUTH_INFO:
+			return nla_server_recv_auth_info(nla);
+
+		default:
+			WLog_ERR(TAG, "Invalid NLA server state %s", nla_get_state_str(nla_get_state(nla)));
+			return -1;
+	}
+}
+
+/**
+ * Start the authentication of a client (server).
+ * @param nla
+ * @return 0 if waiting for data of the client, -1 on failure
+ */
+
+int nla_server_begin(rdpNla* nla)
+{
+	if (!nla || !nla->server || (nla_get_state(nla) != NLA_STATE_INITIAL))
+		return -1;
+
+	if (!nla->recvBuffer)
+		nla->recvBuffer = Stream_New(NULL, 4096);
+
+	if (!nla->recvBuffer || (nla_server_init(nla) < 1))
+	{
+		nla_buffer_free(nla);
+		return -1;
 	}
 
-	res = 1;
-fail_auth:
+	Stream_SetPosition(nla->recvBuffer, 0);
+	nla_set_state(nla, NLA_STATE_NEGO_TOKEN);
+	return 0;
+}
+
+/**
+ * Continue the authentication with data received from the client (server).
+ * Data can be fed in arbitrary fragments, the bytes following the final TSRequest are not
+ * consumed. Without data only the timeout of the current state is checked.
+ * @param nla
+ * @param data received data
+ * @param length length of data
+ * @param used optional, receives the number of bytes consumed
+ * @return 1 if authentication is successful, 0 if more data is required, -1 on failure
+ */
+
+int nla_server_feed(rdpNla* nla, const BYTE* data, size_t length, size_t* used)
+{
+	int status = 0;
+	size_t offset = 0;
+
+	if (used)
+		*used = 0;
+
+	if (!nla || !nla->server || !nla->recvBuffer || (!data && (length > 0)))
+		return -1;
+
+	if (nla_get_state(nla) == NLA_STATE_FINAL)
+		return 1;
+
+	if (nla_server_get_timeout(nla) == 0)
+	{
+		WLog_ERR(TAG, "CredSSP timeout in state %s", nla_get_state_str(nla_get_state(nla)));
+		goto fail;
+	}
+
+	while ((status == 0) && (offset < length))
+	{
+		BOOL incomplete;
+		size_t count = 1;
+		wStream* s = nla->recvBuffer;
+		SSIZE_T pduLength = transport_parse_pdu(nla->transport, s, &incomplete);
+
+		if (pduLength < 0)
+			goto fail;
+
+		/* The header is read bytewise until the length of the request is known */
+		if (pduLength > 0)
+			count = (size_t)pduLength - Stream_GetPosition(s);
+
+		if (count > length - offset)
+			count = length - offset;
+
+		if (!Stream_EnsureRemainingCapacity(s, count))
+			goto fail;
+
+		Stream_Write(s, &data[offset], count);
+		offset += count;
+		pduLength = transport_parse_pdu(nla->transport, s, &incomplete);
+
+		if (pduLength < 0)
+			goto fail;
+
+		if ((pduLength == 0) || incomplete)
+			continue;
+
+		Stream_SealLength(s);
+		Stream_SetPosition(s, 0);
+		status = nla_server_recv_pdu(nla, s);
+		Stream_SetPosition(s, 0);
+
+		if (status < 0)
+			goto fail;
+	}
+
+	if (used)
+		*used = offset;
+
+	if (status > 0)
+		nla_buffer_free(nla);
+
+	return status;
+fail:
 	nla_buffer_free(nla);
-	return res;
+	return -1;
+}
+
+/**
+ * Limit the time the server waits for the client in each state, 0 disables the timeout.
+ * Servers start with a timeout of NLA_SERVER_STATE_TIMEOUT.
+ */
+
+BOOL nla_server_set_timeout(rdpNla* nla, DWORD timeout)
+{
+	if (!nla || !nla->server)
+		return FALSE;
+
+	nla->stateTimeout = timeout;
+	return TRUE;
+}
+
+/**
+ * @return the milliseconds left in the current state, INFINITE without a timeout
+ */
+
+DWORD nla_server_get_timeout(rdpNla* nla)
+{
+	UINT64 elapsed;
+
+	if (!nla || (nla->stateTimeout == 0))
+		return INFINITE;
+
+	elapsed = GetTickCount64() - nla->stateTime;
+
+	if (elapsed >= nla->stateTimeout)
+		return 0;
+
+	return nla->stateTimeout - (DWORD)elapsed;
 }
 
 /**
@@ -1347,10 +1463,11 @@ fail_auth:
 
 int nla_authenticate(rdpNla* nla)
 {
+	/* Servers are driven by the requests of the client, see nla_server_feed */
 	if (nla->server)
-		return nla_server_authenticate(nla);
-	else
-		return nla_client_authenticate(nla);
+		return -1;
+
+	return nla_client_authenticate(nla);
 }
 
 static void ap_integer_increment_le(BYTE* number, size_t size)
@@ -2198,19 +2315,6 @@ int nla_recv_pdu(rdpNla* nla, wStream* s)
 	return nla_client_recv(nla);
 }
 
-int nla_server_recv(rdpNla* nla)
-{
-	int status = -1;
-	wStream* s = nla_server_recv_stream(nla);
-	if (!s)
-		goto fail;
-	status = nla_decode_ts_request(nla, s);
-
-fail:
-	Stream_Free(s, TRUE);
-	return status;
-}
-
 void nla_buffer_free(rdpNla* nla)
 {
 	sspi_SecBufferFree(&nla->negoToken);
@@ -2295,6 +2399,7 @@ rdpNla* nla_new(freerdp* instance, rdpTransport* transport, rdpSettings* setting
 	nla->settings = settings;
 	nla->server = settings->ServerMode;
 	nla->transport = transport;
+	nla->stateTimeout = nla->server ? NLA_SERVER_STATE_TIMEOUT : 0;
 	nla->sendSeqNum = 0;
 	nla->recvSeqNum = 0;
 	nla->version = 6;
@@ -2399,6 +2504,7 @@ void nla_free(rdpNla* nla)
 	nla->SamFile = NULL;
 
 	nla_buffer_free(nla);
+	Stream_Free(nla->recvBuffer, TRUE);
 	sspi_SecBufferFree(&nla->ClientNonce);
 	sspi_SecBufferFree(&nla->PublicKey);
 	sspi_SecBufferFree(&nla->tsCredentials);
@@ -2432,6 +2538,7 @@ BOOL nla_set_state(rdpNla* nla, NLA_STATE state)
 
 	WLog_DBG(TAG, "-- %s\t--> %s", nla_get_state_str(nla->state), nla_get_state_str(state));
 	nla->state = state;
+	nla->stateTime = GetTickCount64();
 	return TRUE;
 }
 
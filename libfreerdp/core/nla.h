@@ -53,6 +53,11 @@ FREERDP_LOCAL LPTSTR nla_make_spn(const char* ServiceClass, const char* hostname
 FREERDP_LOCAL int nla_client_begin(rdpNla* nla);
 FREERDP_LOCAL int nla_recv_pdu(rdpNla* nla, wStream* s);
 
+FREERDP_LOCAL int nla_server_begin(rdpNla* nla);
+FREERDP_LOCAL int nla_server_feed(rdpNla* nla, const BYTE* data, size_t length, size_t* used);
+FREERDP_LOCAL BOOL nla_server_set_timeout(rdpNla* nla, DWORD timeout);
+FREERDP_LOCAL DWORD nla_server_get_timeout(rdpNla* nla);
+
 FREERDP_LOCAL SEC_WINNT_AUTH_IDENTITY* nla_get_identity(rdpNla* nla);
 
 FREERDP_LOCAL NLA_STATE nla_get_state(rdpNla* nla);
@@ -308,6 +308,11 @@ static BOOL freerdp_peer_check_fds(freerdp_peer* peer)
 	if (status < 0)
 		return FALSE;
 
+	/* Enforces the timeout of a client that stopped sending during NLA */
+	if ((rdp_get_state(rdp) == CONNECTION_STATE_NLA) &&
+	    (rdp_server_accept_nla(rdp, NULL) < 0))
+		return FALSE;
+
 	return TRUE;
 }
 
@@ -545,6 +550,16 @@ static int peer_recv_pdu(freerdp_peer* client, wStream* s)
 		return peer_recv_fastpath_pdu(client, s);
 }
 
+static void peer_logon_nla(freerdp_peer* client)
+{
+	rdpRdp* rdp = client->context->rdp;
+	SEC_WINNT_AUTH_IDENTITY* identity = nego_get_identity(rdp->nego);
+
+	sspi_CopyAuthIdentity(&client->identity, identity);
+	IFCALLRET(client->Logon, client->authenticated, client, &client->identity, TRUE);
+	nego_free_nla(rdp->nego);
+}
+
 static int peer_recv_callback(rdpTransport* transport, wStream* s, void* extra)
 {
 	UINT32 SelectedProtocol;
@@ -573,13 +588,12 @@ static int peer_recv_callback(rdpTransport* transport, wStream* s, void* extra)
 			client->settings->TlsSecurity = (SelectedProtocol & PROTOCOL_SSL) ? TRUE : FALSE;
 			client->settings->RdpSecurity = (SelectedProtocol == PROTOCOL_RDP) ? TRUE : FALSE;
 
+			/* With NLA the logon follows the authentication */
+			if (rdp_get_state(rdp) == CONNECTION_STATE_NLA)
+				break;
+
 			if (SelectedProtocol & PROTOCOL_HYBRID)
-			{
-				SEC_WINNT_AUTH_IDENTITY* identity = nego_get_identity(rdp->nego);
-				sspi_CopyAuthIdentity(&client->identity, identity);
-				IFCALLRET(client->Logon, client->authenticated, client, &client->identity, TRUE);
-				nego_free_nla(rdp->nego);
-			}
+				peer_logon_nla(client);
 			else
 			{
 				IFCALLRET(client->Logon, client->authenticated, client, &client->identity, FALSE);
@@ -587,6 +601,22 @@ static int peer_recv_callback(rdpTransport* transport, wStream* s, void* extra)
 
 			break;
 
+		case CONNECTION_STATE_NLA:
+		{
+			const int status = rdp_server_accept_nla(rdp, s);
+
+			if (status < 0)
+			{
+				WLog_ERR(TAG, "%s: %s - rdp_server_accept_nla() fail", __FUNCTION__,
+				         rdp_get_state_string(rdp));
+				return -1;
+			}
+
+			if (status > 0)
+				peer_logon_nla(client);
+		}
+		break;
+
 		case CONNECTION_STATE_NEGO:
 			if (!rdp_server_accept_mcs_connect_initial(rdp, s))
 			{
@@ -852,6 +882,38 @@ static BOOL freerdp_peer_send_channel_packet(freerdp_peer* client, UINT16 channe
 	                               chunkSize);
 }
 
+/* TRUE when the application replaced SendChannelData, it must then get every PDU in one piece */
+BOOL freerdp_peer_channel_data_overridden(freerdp_peer* client)
+{
+	WINPR_ASSERT(client);
+	return client->SendChannelData != freerdp_peer_send_channel_data;
+}
+
+BOOL freerdp_peer_send_channel_chunk(freerdp_peer* client, UINT16 channelId, const BYTE* header,
+                                     size_t headerLength, const BYTE* data, size_t length,
+                                     wStream* scratch)
+{
+	WINPR_ASSERT(client);
+	WINPR_ASSERT(client->context);
+	WINPR_ASSERT(scratch);
+
+	if (!freerdp_peer_channel_data_overridden(client))
+		return rdp_channel_send_chunk(client->context->rdp, channelId, header, headerLength, data,
+		                              length);
+
+	/* An application that replaced the callback gets the PDU in one piece */
+	Stream_SetPosition(scratch, 0);
+
+	if (!Stream_EnsureCapacity(scratch, headerLength + length))
+		return FALSE;
+
+	Stream_Write(scratch, header, headerLength);
+	Stream_Write(scratch, data, length);
+	WINPR_ASSERT(client->SendChannelData);
+	return client->SendChannelData(client, channelId, Stream_Buffer(scratch),
+	                               headerLength + length);
+}
+
 static BOOL freerdp_peer_is_write_blocked(freerdp_peer* peer)
 {
 	rdpTransport* transport;
@@ -26,4 +26,10 @@
 
 #include <freerdp/peer.h>
 
+FREERDP_LOCAL BOOL freerdp_peer_channel_data_overridden(freerdp_peer* client);
+FREERDP_LOCAL BOOL freerdp_peer_send_channel_chunk(freerdp_peer* client, UINT16 channelId,
+                                                   const BYTE* header, size_t headerLength,
+                                                   const BYTE* data, size_t length,
+                                                   wStream* scratch);
+
 #endif /* FREERDP_LIB_CORE_PEER_H */
@@ -1699,6 +1699,12 @@ BOOL rdp_channel_send_packet(rdpRdp* rdp, UINT16 channelId, size_t totalSize, UI
 	return freerdp_channel_send_packet(rdp, channelId, totalSize, flags, data, chunkSize);
 }
 
+BOOL rdp_channel_send_chunk(rdpRdp* rdp, UINT16 channelId, const BYTE* header, size_t headerLength,
+                            const BYTE* data, size_t length)
+{
+	return freerdp_channel_send_chunk(rdp, channelId, header, headerLength, data, length);
+}
+
 BOOL rdp_send_error_info(rdpRdp* rdp)
 {
 	wStream* s;
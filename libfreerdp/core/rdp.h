@@ -179,6 +179,7 @@ struct rdp_rdp
 	UINT64 inPackets;
 	UINT64 outBytes;
 	UINT64 outPackets;
+	rdpPcap* transportDump;
 	CRITICAL_SECTION critical;
 	rdpTransportIo* io;
 };
@@ -212,6 +213,8 @@ FREERDP_LOCAL BOOL rdp_send_channel_data(rdpRdp* rdp, UINT16 channelId, const BY
                                          size_t size);
 FREERDP_LOCAL BOOL rdp_channel_send_packet(rdpRdp* rdp, UINT16 channelId, size_t totalSize,
                                            UINT32 flags, const BYTE* data, size_t chunkSize);
+FREERDP_LOCAL BOOL rdp_channel_send_chunk(rdpRdp* rdp, UINT16 channelId, const BYTE* header,
+                                          size_t headerLength, const BYTE* data, size_t length);
 
 FREERDP_LOCAL wStream* rdp_message_channel_pdu_init(rdpRdp* rdp);
 FREERDP_LOCAL BOOL rdp_send_message_channel_pdu(rdpRdp* rdp, wStream* s, UINT16 sec_flags);
@@ -38,6 +38,7 @@
 
 #include "rdp.h"
 
+#include "peer.h"
 #include "server.h"
 
 #define TAG FREERDP_TAG("core.server")
@@ -59,6 +60,37 @@ struct _wtsChannelMessage
 };
 typedef struct _wtsChannelMessage wtsChannelMessage;
 
+/* Command, channel id and length of a DATA_FIRST_PDU */
+#define WTS_DVC_HEADER_MAX 9
+#define WTS_SEND_STRIDE 0x10000
+
+typedef struct _wtsSendBuffer wtsSendBuffer;
+
+/* A part of an outgoing write. Dynamic channel slices carry their PDU header and are sent as
+ * one static channel PDU, static channel slices are split into packets while sending. */
+struct _wtsSendSlice
+{
+	wtsSendBuffer* buffer;
+	const BYTE* data;
+	UINT32 length;
+	UINT32 offset;
+	UINT16 channelId;
+	BYTE headerLength;
+	BYTE header[WTS_DVC_HEADER_MAX];
+};
+typedef struct _wtsSendSlice wtsSendSlice;
+
+/* The data of a write, referenced by each of its slices. */
+struct _wtsSendBuffer
+{
+	LONG refCount;
+	BYTE* data;
+	psWTSVirtualChannelBufferFree fnFree;
+	void* context;
+	size_t count;
+	wtsSendSlice* slices;
+};
+
 static DWORD g_SessionId = 1;
 static wHashTable* g_ServerHandles = NULL;
 
@@ -108,20 +140,6 @@ static BOOL wts_queue_receive_data(rdpPeerChannel* channel, const BYTE* Buffer,
 	return MessageQueue_Post(channel->queue, messageCtx, 0, NULL, NULL);
 }
 
-static BOOL wts_queue_send_item(rdpPeerChannel* channel, BYTE* Buffer, UINT32 Length)
-{
-	BYTE* buffer;
-	UINT32 length;
-	UINT16 channelId;
-	WINPR_ASSERT(channel);
-	WINPR_ASSERT(channel->vcm);
-	buffer = Buffer;
-	length = Length;
-	channelId = channel->channelId;
-	return MessageQueue_Post(channel->vcm->queue, (void*)(UINT_PTR)channelId, 0, (void*)buffer,
-	                         (void*)(UINT_PTR)length);
-}
-
 static int wts_read_variable_uint(wStream* s, int cbLen, UINT32* val)
 {
 	WINPR_ASSERT(s);
@@ -389,6 +407,350 @@ static BOOL wts_write_drdynvc_create_request(wStream* s, UINT32 ChannelId, const
 	return TRUE;
 }
 
+static size_t wts_variable_uint_length(UINT32 val)
+{
+	if (val <= 0xFF)
+		return 1;
+	else if (val <= 0xFFFF)
+		return 2;
+
+	return 4;
+}
+
+static void wts_send_buffer_release(wtsSendBuffer* buffer)
+{
+	if (!buffer || (InterlockedDecrement(&buffer->refCount) > 0))
+		return;
+
+	if (buffer->fnFree)
+		buffer->fnFree(buffer->context, buffer->data);
+
+	free(buffer);
+}
+
+static void wts_send_slice_free(void* obj)
+{
+	wtsSendSlice* slice = (wtsSendSlice*)obj;
+
+	if (slice)
+		wts_send_buffer_release(slice->buffer);
+}
+
+static wtsSendBuffer* wts_send_buffer_alloc(size_t count, size_t dataSize)
+{
+	wtsSendBuffer* buffer =
+	    (wtsSendBuffer*)calloc(1, sizeof(wtsSendBuffer) + count * sizeof(wtsSendSlice) + dataSize);
+
+	if (!buffer)
+		return NULL;
+
+	buffer->refCount = 1;
+	buffer->count = count;
+	buffer->slices = (wtsSendSlice*)(buffer + 1);
+	return buffer;
+}
+
+/* Splits a write into slices. Without a free function the data is copied once, dynamic channel
+ * chunks only reference it and keep their PDU header in the slice. */
+static wtsSendBuffer* wts_send_buffer_new(rdpPeerChannel* channel, BYTE* Buffer, UINT32 Length,
+                                          psWTSVirtualChannelBufferFree fnFree, void* context)
+{
+	size_t index;
+	size_t count = 1;
+	size_t chunk = 0;
+	size_t first = Length;
+	const UINT32 chunkSize = channel->client->settings->VirtualChannelChunkSize;
+	wtsSendBuffer* buffer;
+	const BYTE* data;
+
+	if (channel->channelType == RDP_PEER_CHANNEL_TYPE_DVC)
+	{
+		chunk = chunkSize - 1 - wts_variable_uint_length(channel->channelId);
+
+		if (Length > chunk)
+		{
+			first = chunk - wts_variable_uint_length(Length);
+			count += (Length - first + chunk - 1) / chunk;
+		}
+	}
+
+	buffer = wts_send_buffer_alloc(count, fnFree ? 0 : Length);
+
+	if (!buffer)
+		return NULL;
+
+	if (fnFree)
+	{
+		buffer->data = Buffer;
+		buffer->fnFree = fnFree;
+		buffer->context = context;
+	}
+	else
+	{
+		buffer->data = (BYTE*)&buffer->slices[count];
+		CopyMemory(buffer->data, Buffer, Length);
+	}
+
+	if (channel->channelType == RDP_PEER_CHANNEL_TYPE_SVC)
+	{
+		wtsSendSlice* slice = &buffer->slices[0];
+		slice->buffer = buffer;
+		slice->data = buffer->data;
+		slice->length = Length;
+		slice->channelId = (UINT16)channel->channelId;
+		return buffer;
+	}
+
+	data = buffer->data;
+
+	for (index = 0; index < count; index++)
+	{
+		int cbLen;
+		int cbChId;
+		wStream sbuffer = { 0 };
+		wtsSendSlice* slice = &buffer->slices[index];
+		const size_t left = Length - (size_t)(data - buffer->data);
+
+		Stream_StaticInit(&sbuffer, slice->header, sizeof(slice->header));
+		Stream_Seek_UINT8(&sbuffer);
+		cbChId = wts_write_variable_uint(&sbuffer, channel->channelId);
+
+		if ((index == 0) && (count > 1))
+		{
+			cbLen = wts_write_variable_uint(&sbuffer, Length);
+			slice->header[0] = (DATA_FIRST_PDU << 4) | (cbLen << 2) | cbChId;
+		}
+		else
+			slice->header[0] = (DATA_PDU << 4) | cbChId;
+
+		slice->buffer = buffer;
+		slice->data = data;
+		slice->length = (UINT32)MIN(index == 0 ? first : chunk, left);
+		slice->channelId = (UINT16)channel->vcm->drdynvc_channel->channelId;
+		slice->headerLength = (BYTE)Stream_GetPosition(&sbuffer);
+		data += slice->length;
+	}
+
+	return buffer;
+}
+
+/* Takes over the reference of the caller. */
+static BOOL wts_queue_send_buffer(rdpPeerChannel* channel, wtsSendBuffer* buffer)
+{
+	size_t index;
+	BOOL rc = TRUE;
+	WTSVirtualChannelManager* vcm;
+
+	WINPR_ASSERT(channel);
+	WINPR_ASSERT(buffer);
+	vcm = channel->vcm;
+	WINPR_ASSERT(vcm);
+
+	EnterCriticalSection(&vcm->sendLock);
+
+	if (Queue_Count(channel->sendQueue) == 0)
+	{
+		/* An idle channel must not catch up on the bandwidth it did not use */
+		channel->sendPass = MAX(channel->sendPass, vcm->sendPass);
+		rc = ArrayList_Append(vcm->sendChannels, channel);
+	}
+
+	for (index = 0; rc && (index < buffer->count); index++)
+	{
+		InterlockedIncrement(&buffer->refCount);
+
+		if (!Queue_Enqueue(channel->sendQueue, &buffer->slices[index]))
+		{
+			InterlockedDecrement(&buffer->refCount);
+			rc = FALSE;
+		}
+	}
+
+	if (Queue_Count(channel->sendQueue) > 0)
+		SetEvent(vcm->sendEvent);
+
+	LeaveCriticalSection(&vcm->sendLock);
+	wts_send_buffer_release(buffer);
+
+	if (!rc)
+		WLog_ERR(TAG, "failed to queue %" PRIuz " bytes for channel %" PRIu32 "",
+		         buffer->count, channel->channelId);
+
+	return rc;
+}
+
+static BOOL wts_queue_close_request(rdpPeerChannel* channel)
+{
+	wStream sbuffer = { 0 };
+	wtsSendSlice* slice;
+	wtsSendBuffer* buffer = wts_send_buffer_alloc(1, 0);
+
+	if (!buffer)
+		return FALSE;
+
+	slice = &buffer->slices[0];
+	slice->buffer = buffer;
+	slice->channelId = (UINT16)channel->vcm->drdynvc_channel->channelId;
+	Stream_StaticInit(&sbuffer, slice->header, sizeof(slice->header));
+	wts_write_drdynvc_header(&sbuffer, CLOSE_REQUEST_PDU, channel->channelId);
+	slice->headerLength = (BYTE)Stream_GetPosition(&sbuffer);
+	return wts_queue_send_buffer(channel, buffer);
+}
+
+/* Weighted fair queuing: the channel that got the least bytes relative to its priority goes
+ * next, so a new write waits for at most one chunk of any other channel. */
+static rdpPeerChannel* wts_select_send_channel(WTSVirtualChannelManager* vcm)
+{
+	size_t index;
+	rdpPeerChannel* selected = NULL;
+	const wtsSendSlice* partial = NULL;
+
+	if (vcm->sendPartial)
+		partial = (const wtsSendSlice*)Queue_Peek(vcm->sendPartial->sendQueue);
+
+	for (index = 0; index < ArrayList_Count(vcm->sendChannels); index++)
+	{
+		rdpPeerChannel* channel = (rdpPeerChannel*)ArrayList_GetItem(vcm->sendChannels, index);
+		const wtsSendSlice* slice = (const wtsSendSlice*)Queue_Peek(channel->sendQueue);
+
+		/* Packets of different PDUs must not be interleaved on a static channel */
+		if (partial && (channel != vcm->sendPartial) && (slice->channelId == partial->channelId))
+			continue;
+
+		if (!selected || (channel->sendPass < selected->sendPass))
+			selected = channel;
+	}
+
+	return selected;
+}
+
+/* Called without the lock, only the sending thread changes the head slice of a queue. */
+static BOOL wts_send_chunk(WTSVirtualChannelManager* vcm, const wtsSendSlice* slice, size_t* sent)
+{
+	UINT32 flags = 0;
+	size_t length;
+	freerdp_peer* client = vcm->client;
+
+	WINPR_ASSERT(slice);
+	WINPR_ASSERT(client);
+	WINPR_ASSERT(client->settings);
+
+	if (slice->headerLength > 0)
+	{
+		*sent = slice->length;
+		return freerdp_peer_send_channel_chunk(client, slice->channelId, slice->header,
+		                                       slice->headerLength, slice->data, slice->length,
+		                                       vcm->sendStream);
+	}
+
+	if (freerdp_peer_channel_data_overridden(client))
+	{
+		*sent = slice->length - slice->offset;
+		WINPR_ASSERT(client->SendChannelData);
+		return client->SendChannelData(client, slice->channelId, &slice->data[slice->offset],
+		                               *sent);
+	}
+
+	length = MIN(slice->length - slice->offset, client->settings->VirtualChannelChunkSize);
+
+	if (slice->offset == 0)
+		flags |= CHANNEL_FLAG_FIRST;
+
+	if (slice->offset + length == slice->length)
+		flags |= CHANNEL_FLAG_LAST;
+
+	*sent = length;
+	WINPR_ASSERT(client->SendChannelPacket);
+	return client->SendChannelPacket(client, slice->channelId, slice->length, flags,
+	                                 &slice->data[slice->offset], length);
+}
+
+/* Accounts a sent chunk, must be called with the lock held. */
+static void wts_complete_chunk(WTSVirtualChannelManager* vcm, rdpPeerChannel* channel,
+                               wtsSendSlice* slice, size_t sent)
+{
+	slice->offset += (UINT32)sent;
+	vcm->sendPass = channel->sendPass;
+	channel->sendPass += (sent + slice->headerLength) * WTS_SEND_STRIDE / channel->sendPriority;
+
+	if (slice->offset < slice->length)
+		vcm->sendPartial = channel;
+	else
+	{
+		vcm->sendPartial = NULL;
+		Queue_Discard(channel->sendQueue);
+	}
+}
+
+static void channel_destroy(rdpPeerChannel* channel);
+
+/* Chunks are sent without holding the lock, a slow peer must not block the writers. A chunk that
+ * could not be sent stays queued. */
+static BOOL wts_send_pending(WTSVirtualChannelManager* vcm)
+{
+	BOOL rc = TRUE;
+	size_t credits;
+
+	EnterCriticalSection(&vcm->sendLock);
+
+	/* The thread already sending picks up everything queued meanwhile */
+	if (vcm->sendActive)
+	{
+		LeaveCriticalSection(&vcm->sendLock);
+		return TRUE;
+	}
+
+	credits = vcm->sendCredits;
+
+	while (rc)
+	{
+		size_t sent = 0;
+		wtsSendSlice* slice;
+		rdpPeerChannel* channel = wts_select_send_channel(vcm);
+
+		if (!channel)
+			break;
+
+		slice = (wtsSendSlice*)Queue_Peek(channel->sendQueue);
+		vcm->sendActive = channel;
+		LeaveCriticalSection(&vcm->sendLock);
+		rc = wts_send_chunk(vcm, slice, &sent);
+		EnterCriticalSection(&vcm->sendLock);
+		vcm->sendActive = NULL;
+
+		if (!rc)
+		{
+			WLog_ERR(TAG, "failed to send %" PRIuz " bytes on channel %" PRIu16 "", sent,
+			         slice->channelId);
+			break;
+		}
+
+		wts_complete_chunk(vcm, channel, slice, sent);
+
+		if (Queue_Count(channel->sendQueue) == 0)
+		{
+			ArrayList_Remove(vcm->sendChannels, channel);
+
+			if (channel->sendClosed)
+				channel_destroy(channel);
+		}
+
+		if (vcm->sendCredits > 0)
+		{
+			if (sent >= credits)
+				break;
+
+			credits -= sent;
+		}
+	}
+
+	if (ArrayList_Count(vcm->sendChannels) == 0)
+		ResetEvent(vcm->sendEvent);
+
+	LeaveCriticalSection(&vcm->sendLock);
+	return rc;
+}
+
 static BOOL WTSProcessChannelData(rdpPeerChannel* channel, UINT16 channelId, const BYTE* data,
                                   size_t s, UINT32 flags, size_t t)
 {
@@ -470,7 +832,7 @@ void WTSVirtualChannelManagerGetFileDescriptor(HANDLE hServer, void** fds, int*
 	WINPR_ASSERT(fds);
 	WINPR_ASSERT(fds_count);
 
-	fd = GetEventWaitObject(MessageQueue_Event(vcm->queue));
+	fd = GetEventWaitObject(vcm->sendEvent);
 
 	if (fd)
 	{
@@ -515,6 +877,7 @@ static BOOL WTSVirtualChannelManagerOpen(WTSVirtualChannelManager* vcm)
 		{
 			ULONG written;
 			vcm->drdynvc_channel = channel;
+			channel->sendPriority = WTS_CHANNEL_PRIORITY_HIGH;
 			dynvc_caps = 0x00010050; /* DYNVC_CAPS_VERSION1 (4 bytes) */
 
 			if (!WTSVirtualChannelWrite(channel, (PCHAR)&dynvc_caps, sizeof(dynvc_caps), &written))
@@ -527,8 +890,6 @@ static BOOL WTSVirtualChannelManagerOpen(WTSVirtualChannelManager* vcm)
 
 BOOL WTSVirtualChannelManagerCheckFileDescriptorEx(HANDLE hServer, BOOL autoOpen)
 {
-	wMessage message;
-	BOOL status = TRUE;
 	WTSVirtualChannelManager* vcm;
 
 	if (!hServer || hServer == INVALID_HANDLE_VALUE)
@@ -542,29 +903,7 @@ BOOL WTSVirtualChannelManagerCheckFileDescriptorEx(HANDLE hServer, BOOL autoOpen
 			return FALSE;
 	}
 
-	while (MessageQueue_Peek(vcm->queue, &message, TRUE))
-	{
-		BYTE* buffer;
-		UINT32 length;
-		UINT16 channelId;
-		channelId = (UINT16)(UINT_PTR)message.context;
-		buffer = (BYTE*)message.wParam;
-		length = (UINT32)(UINT_PTR)message.lParam;
-
-		WINPR_ASSERT(vcm->client);
-		WINPR_ASSERT(vcm->client->SendChannelData);
-		if (!vcm->client->SendChannelData(vcm->client, channelId, buffer, length))
-		{
-			status = FALSE;
-		}
-
-		free(buffer);
-
-		if (!status)
-			break;
-	}
-
-	return status;
+	return wts_send_pending(vcm);
 }
 
 BOOL WTSVirtualChannelManagerCheckFileDescriptor(HANDLE hServer)
@@ -576,7 +915,7 @@ HANDLE WTSVirtualChannelManagerGetEventHandle(HANDLE hServer)
 {
 	WTSVirtualChannelManager* vcm = (WTSVirtualChannelManager*)hServer;
 	WINPR_ASSERT(vcm);
-	return MessageQueue_Event(vcm->queue);
+	return vcm->sendEvent;
 }
 
 static rdpMcsChannel* wts_get_joined_channel_by_name(rdpMcs* mcs, const char* channel_name)
@@ -648,6 +987,18 @@ BOOL WTSVirtualChannelManagerIsChannelJoined(HANDLE hServer, const char* name)
 	return wts_get_joined_channel_by_name(vcm->rdp->mcs, name) == NULL ? FALSE : TRUE;
 }
 
+void WTSVirtualChannelManagerSetSendCredits(HANDLE hServer, size_t credits)
+{
+	WTSVirtualChannelManager* vcm = (WTSVirtualChannelManager*)hServer;
+
+	if (!vcm || (vcm == INVALID_HANDLE_VALUE))
+		return;
+
+	EnterCriticalSection(&vcm->sendLock);
+	vcm->sendCredits = credits;
+	LeaveCriticalSection(&vcm->sendLock);
+}
+
 BYTE WTSVirtualChannelManagerGetDrdynvcState(HANDLE hServer)
 {
 	WTSVirtualChannelManager* vcm = (WTSVirtualChannelManager*)hServer;
@@ -837,19 +1188,6 @@ HANDLE WINAPI FreeRDP_WTSOpenServerW(LPWSTR pServerName)
 	return INVALID_HANDLE_VALUE;
 }
 
-static void wts_virtual_channel_manager_free_message(void* obj)
-{
-	wMessage* msg = (wMessage*)obj;
-
-	if (msg)
-	{
-		BYTE* buffer = (BYTE*)msg->wParam;
-
-		if (buffer)
-			free(buffer);
-	}
-}
-
 static void channel_free(rdpPeerChannel* channel);
 
 HANDLE WINAPI FreeRDP_WTSOpenServerA(LPSTR pServerName)
@@ -858,7 +1196,6 @@ HANDLE WINAPI FreeRDP_WTSOpenServerA(LPSTR pServerName)
 	freerdp_peer* client;
 	WTSVirtualChannelManager* vcm;
 	HANDLE hServer = INVALID_HANDLE_VALUE;
-	wObject queueCallbacks = { 0 };
 
 	context = (rdpContext*)pServerName;
 
@@ -893,10 +1230,14 @@ HANDLE WINAPI FreeRDP_WTSOpenServerA(LPSTR pServerName)
 	if (!HashTable_Insert(g_ServerHandles, (void*)(UINT_PTR)vcm->SessionId, (void*)vcm))
 		goto error_free;
 
-	queueCallbacks.fnObjectFree = wts_virtual_channel_manager_free_message;
-	vcm->queue = MessageQueue_New(&queueCallbacks);
+	if (!InitializeCriticalSectionAndSpinCount(&vcm->sendLock, 4000))
+		goto error_lock;
 
-	if (!vcm->queue)
+	vcm->sendEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+	vcm->sendChannels = ArrayList_New(FALSE);
+	vcm->sendStream = Stream_New(NULL, client->settings->VirtualChannelChunkSize);
+
+	if (!vcm->sendEvent || !vcm->sendChannels || !vcm->sendStream)
 		goto error_queue;
 
 	vcm->dvc_channel_id_seq = 0;
@@ -914,8 +1255,15 @@ HANDLE WINAPI FreeRDP_WTSOpenServerA(LPSTR pServerName)
 	hServer = (HANDLE)vcm;
 	return hServer;
 error_dynamicVirtualChannels:
-	MessageQueue_Free(vcm->queue);
 error_queue:
+	Stream_Free(vcm->sendStream, TRUE);
+	ArrayList_Free(vcm->sendChannels);
+
+	if (vcm->sendEvent)
+		CloseHandle(vcm->sendEvent);
+
+	DeleteCriticalSection(&vcm->sendLock);
+error_lock:
 	HashTable_Remove(g_ServerHandles, (void*)(UINT_PTR)vcm->SessionId);
 error_free:
 	free(vcm);
@@ -952,7 +1300,26 @@ VOID WINAPI FreeRDP_WTSCloseServer(HANDLE hServer)
 			vcm->drdynvc_channel = NULL;
 		}
 
-		MessageQueue_Free(vcm->queue);
+		/* Output of channels closed but not yet sent is dropped with the connection */
+		EnterCriticalSection(&vcm->sendLock);
+
+		while (ArrayList_Count(vcm->sendChannels) > 0)
+		{
+			rdpPeerChannel* channel = (rdpPeerChannel*)ArrayList_GetItem(vcm->sendChannels, 0);
+			ArrayList_RemoveAt(vcm->sendChannels, 0);
+			Queue_Clear(channel->sendQueue);
+
+			if (channel->sendClosed)
+				channel_destroy(channel);
+		}
+
+		vcm->sendPartial = NULL;
+		LeaveCriticalSection(&vcm->sendLock);
+
+		ArrayList_Free(vcm->sendChannels);
+		Stream_Free(vcm->sendStream, TRUE);
+		CloseHandle(vcm->sendEvent);
+		DeleteCriticalSection(&vcm->sendLock);
 		free(vcm);
 	}
 }
@@ -1108,14 +1475,41 @@ static void peer_channel_queue_free_message(void* obj)
 	free(msg->context);
 }
 
+void channel_destroy(rdpPeerChannel* channel)
+{
+	if (!channel)
+		return;
+
+	Queue_Free(channel->sendQueue);
+	free(channel);
+}
+
 void channel_free(rdpPeerChannel* channel)
 {
 	if (!channel)
 		return;
 
 	MessageQueue_Free(channel->queue);
+	channel->queue = NULL;
 	Stream_Free(channel->receiveData, TRUE);
-	free(channel);
+	channel->receiveData = NULL;
+
+	if (channel->vcm && channel->sendQueue)
+	{
+		WTSVirtualChannelManager* vcm = channel->vcm;
+		BOOL pending;
+
+		EnterCriticalSection(&vcm->sendLock);
+		pending = Queue_Count(channel->sendQueue) > 0;
+		channel->sendClosed = pending;
+		LeaveCriticalSection(&vcm->sendLock);
+
+		/* Data written before closing is still sent, the manager frees the channel then */
+		if (pending)
+			return;
+	}
+
+	channel_destroy(channel);
 }
 
 static rdpPeerChannel* channel_new(WTSVirtualChannelManager* vcm, freerdp_peer* client,
@@ -1135,6 +1529,7 @@ static rdpPeerChannel* channel_new(WTSVirtualChannelManager* vcm, freerdp_peer*
 	channel->channelId = ChannelId;
 	channel->index = index;
 	channel->channelType = type;
+	channel->sendPriority = WTS_CHANNEL_PRIORITY_NORMAL;
 	channel->receiveData = Stream_New(NULL, chunkSize);
 
 	if (!channel->receiveData)
@@ -1147,6 +1542,12 @@ static rdpPeerChannel* channel_new(WTSVirtualChannelManager* vcm, freerdp_peer*
 	if (!channel->queue)
 		goto fail;
 
+	channel->sendQueue = Queue_New(FALSE, -1, -1);
+
+	if (!channel->sendQueue)
+		goto fail;
+
+	Queue_Object(channel->sendQueue)->fnObjectFree = wts_send_slice_free;
 	return channel;
 fail:
 	channel_free(channel);
@@ -1309,7 +1710,6 @@ fail2:
 
 BOOL WINAPI FreeRDP_WTSVirtualChannelClose(HANDLE hChannelHandle)
 {
-	wStream* s;
 	rdpMcs* mcs;
 
 	rdpPeerChannel* channel = (rdpPeerChannel*)hChannelHandle;
@@ -1335,38 +1735,16 @@ BOOL WINAPI FreeRDP_WTSVirtualChannelClose(HANDLE hChannelHandle)
 		}
 		else
 		{
-			ArrayList_Remove(vcm->dynamicVirtualChannels, channel);
-
+			/* Queued behind the pending data of the channel */
 			if (channel->dvc_open_state == DVC_OPEN_STATE_SUCCEEDED)
-			{
-				ULONG written;
-				s = Stream_New(NULL, 8);
+				ret = wts_queue_close_request(channel);
 
-				if (!s)
-				{
-					WLog_ERR(TAG, "Stream_New failed!");
-					ret = FALSE;
-				}
-				else
-				{
-					wts_write_drdynvc_header(s, CLOSE_REQUEST_PDU, channel->channelId);
-					ret = WTSVirtualChannelWrite(vcm->drdynvc_channel, (PCHAR)Stream_Buffer(s),
-					                             Stream_GetPosition(s), &written);
-					Stream_Free(s, TRUE);
-				}
-			}
-		}
-
-		if (channel->receiveData)
-			Stream_Free(channel->receiveData, TRUE);
-
-		if (channel->queue)
-		{
-			MessageQueue_Free(channel->queue);
-			channel->queue = NULL;
+			/* Frees the channel */
+			ArrayList_Remove(vcm->dynamicVirtualChannels, channel);
+			return ret;
 		}
 
-		free(channel);
+		channel_free(channel);
 	}
 
 	return ret;
@@ -1417,94 +1795,88 @@ BOOL WINAPI FreeRDP_WTSVirtualChannelRead(HANDLE hChannelHandle, ULONG TimeOut,
 	return TRUE;
 }
 
-BOOL WINAPI FreeRDP_WTSVirtualChannelWrite(HANDLE hChannelHandle, PCHAR Buffer, ULONG Length,
-                                           PULONG pBytesWritten)
+static BOOL wts_virtual_channel_write(rdpPeerChannel* channel, BYTE* Buffer, ULONG Length,
+                                      psWTSVirtualChannelBufferFree fnFree, void* context)
 {
-	wStream* s;
-	int cbLen;
-	int cbChId;
-	int first;
-	BYTE* buffer;
-	UINT32 length;
-	UINT32 written;
-	UINT32 totalWritten = 0;
-	rdpPeerChannel* channel = (rdpPeerChannel*)hChannelHandle;
-	BOOL ret = TRUE;
-
-	if (!channel)
-		return FALSE;
+	wtsSendBuffer* buffer;
 
 	WINPR_ASSERT(channel->vcm);
-	if (channel->channelType == RDP_PEER_CHANNEL_TYPE_SVC)
+	WINPR_ASSERT(channel->client);
+	WINPR_ASSERT(channel->client->settings);
+
+	if ((channel->channelType != RDP_PEER_CHANNEL_TYPE_SVC) &&
+	    (!channel->vcm->drdynvc_channel || (channel->vcm->drdynvc_state != DRDYNVC_STATE_READY)))
 	{
-		length = Length;
-		buffer = (BYTE*)malloc(length);
+		DEBUG_DVC("drdynvc not ready");
+		goto fail;
+	}
 
-		if (!buffer)
-		{
-			SetLastError(E_OUTOFMEMORY);
-			return FALSE;
-		}
+	if (Length == 0)
+	{
+		if (fnFree)
+			fnFree(context, Buffer);
 
-		CopyMemory(buffer, Buffer, length);
-		totalWritten = Length;
-		ret = wts_queue_send_item(channel, buffer, length);
+		return TRUE;
 	}
-	else if (!channel->vcm->drdynvc_channel || (channel->vcm->drdynvc_state != DRDYNVC_STATE_READY))
+
+	buffer = wts_send_buffer_new(channel, Buffer, Length, fnFree, context);
+
+	if (!buffer)
 	{
-		DEBUG_DVC("drdynvc not ready");
-		return FALSE;
+		WLog_ERR(TAG, "wts_send_buffer_new failed!");
+		SetLastError(E_OUTOFMEMORY);
+		goto fail;
 	}
-	else
-	{
-		first = TRUE;
-		WINPR_ASSERT(channel->client);
-		WINPR_ASSERT(channel->client->settings);
-		while (Length > 0)
-		{
-			s = Stream_New(NULL, channel->client->settings->VirtualChannelChunkSize);
 
-			if (!s)
-			{
-				WLog_ERR(TAG, "Stream_New failed!");
-				SetLastError(E_OUTOFMEMORY);
-				return FALSE;
-			}
+	return wts_queue_send_buffer(channel, buffer);
+fail:
 
-			buffer = Stream_Buffer(s);
-			Stream_Seek_UINT8(s);
-			cbChId = wts_write_variable_uint(s, channel->channelId);
+	if (fnFree)
+		fnFree(context, Buffer);
 
-			if (first && (Length > (UINT32)Stream_GetRemainingLength(s)))
-			{
-				cbLen = wts_write_variable_uint(s, Length);
-				buffer[0] = (DATA_FIRST_PDU << 4) | (cbLen << 2) | cbChId;
-			}
-			else
-			{
-				buffer[0] = (DATA_PDU << 4) | cbChId;
-			}
+	return FALSE;
+}
 
-			first = FALSE;
-			written = Stream_GetRemainingLength(s);
+BOOL WINAPI FreeRDP_WTSVirtualChannelWrite(HANDLE hChannelHandle, PCHAR Buffer, ULONG Length,
+                                           PULONG pBytesWritten)
+{
+	rdpPeerChannel* channel = (rdpPeerChannel*)hChannelHandle;
 
-			if (written > Length)
-				written = Length;
+	if (!channel)
+		return FALSE;
 
-			Stream_Write(s, Buffer, written);
-			length = Stream_GetPosition(s);
-			Stream_Free(s, FALSE);
-			Length -= written;
-			Buffer += written;
-			totalWritten += written;
-			ret = wts_queue_send_item(channel->vcm->drdynvc_channel, buffer, length);
-		}
-	}
+	if (!wts_virtual_channel_write(channel, (BYTE*)Buffer, Length, NULL, NULL))
+		return FALSE;
 
 	if (pBytesWritten)
-		*pBytesWritten = totalWritten;
+		*pBytesWritten = Length;
 
-	return ret;
+	return TRUE;
+}
+
+BOOL WTSVirtualChannelWriteBuffer(HANDLE hChannelHandle, BYTE* Buffer, ULONG Length,
+                                  psWTSVirtualChannelBufferFree fnFree, void* context)
+{
+	rdpPeerChannel* channel = (rdpPeerChannel*)hChannelHandle;
+
+	if (!channel || !fnFree)
+		return FALSE;
+
+	return wts_virtual_channel_write(channel, Buffer, Length, fnFree, context);
+}
+
+BOOL WTSVirtualChannelSetPriority(HANDLE hChannelHandle, UINT32 priority)
+{
+	rdpPeerChannel* channel = (rdpPeerChannel*)hChannelHandle;
+
+	if (!channel || (priority == 0))
+		return FALSE;
+
+	WINPR_ASSERT(channel->vcm);
+	EnterCriticalSection(&channel->vcm->sendLock);
+	channel->sendPriority = priority;
+	LeaveCriticalSection(&channel->vcm->sendLock);
+	return TRUE;
 }
 
 BOOL WINAPI FreeRDP_WTSVirtualChannelPurgeInput(HANDLE hChannelHandle)
@@ -1514,6 +1886,24 @@ BOOL WINAPI FreeRDP_WTSVirtualChannelPurgeInput(HANDLE hChannelHandle)
 
 BOOL WINAPI FreeRDP_WTSVirtualChannelPurgeOutput(HANDLE hChannelHandle)
 {
+	rdpPeerChannel* channel = (rdpPeerChannel*)hChannelHandle;
+	WTSVirtualChannelManager* vcm;
+
+	if (!channel)
+		return FALSE;
+
+	vcm = channel->vcm;
+	WINPR_ASSERT(vcm);
+	EnterCriticalSection(&vcm->sendLock);
+
+	/* A partially sent PDU has to be completed, a chunk being sent stays queued until it is */
+	if ((vcm->sendPartial != channel) && (vcm->sendActive != channel))
+	{
+		Queue_Clear(channel->sendQueue);
+		ArrayList_Remove(vcm->sendChannels, channel);
+	}
+
+	LeaveCriticalSection(&vcm->sendLock);
 	return TRUE;
 }
 
@@ -63,6 +63,11 @@ struct rdp_peer_channel
 	wStream* receiveData;
 	wMessageQueue* queue;
 
+	wQueue* sendQueue;
+	UINT32 sendPriority;
+	UINT64 sendPass;
+	BOOL sendClosed;
+
 	BYTE dvc_open_state;
 	UINT32 dvc_total_length;
 	rdpMcsChannel* mcsChannel;
@@ -74,7 +79,15 @@ struct WTSVirtualChannelManager
 	freerdp_peer* client;
 
 	DWORD SessionId;
-	wMessageQueue* queue;
+
+	CRITICAL_SECTION sendLock;
+	HANDLE sendEvent;
+	wArrayList* sendChannels;
+	rdpPeerChannel* sendPartial;
+	rdpPeerChannel* sendActive;
+	wStream* sendStream;
+	UINT64 sendPass;
+	size_t sendCredits;
 
 	rdpPeerChannel* drdynvc_channel;
 	BYTE drdynvc_state;
@@ -0,0 +1,203 @@
+#include <winpr/crt.h>
+
+#include <freerdp/freerdp.h>
+
+#include "../bulk.h"
+
+#define MAX_PAYLOAD 100000
+
+static UINT32 prand(UINT32* state)
+{
+	*state ^= *state << 13;
+	*state ^= *state >> 17;
+	*state ^= *state << 5;
+	return *state;
+}
+
+/* Drawing order like data with repeated runs, or noise */
+static void fill_payload(BYTE* data, UINT32 size, BOOL noise, UINT32* state)
+{
+	UINT32 x;
+
+	for (x = 0; x < size; x++)
+	{
+		if (noise)
+			data[x] = (BYTE)prand(state);
+		else
+			data[x] = (BYTE)((x % 97 < 60) ? x / 509 : prand(state) % 4);
+	}
+}
+
+static BOOL test_round_trip(rdpBulk* send, rdpBulk* recv, const BYTE* data, UINT32 size,
+                            BOOL* compressed)
+{
+	UINT32 flags = 0;
+	UINT32 DstSize = 0;
+	UINT32 OutSize = 0;
+	BYTE* pDstData = NULL;
+	BYTE* pOutData = NULL;
+
+	if (bulk_compress(send, (BYTE*)data, size, &pDstData, &DstSize, &flags) < 0)
+		return FALSE;
+
+	*compressed = (flags & PACKET_COMPRESSED) != 0;
+
+	if (bulk_decompress(recv, pDstData, DstSize, &pOutData, &OutSize, flags) < 0)
+		return FALSE;
+
+	return (OutSize == size) && (memcmp(pOutData, data, size) == 0);
+}
+
+static BOOL test_level(rdpContext* context, UINT32 level, BYTE* data)
+{
+	BOOL rc = FALSE;
+	UINT32 index, maxSize;
+	UINT32 state = 0x2545F491 + level;
+	UINT32 compressedCount = 0;
+	rdpBulk* send = NULL;
+	rdpBulk* recv = NULL;
+
+	if (!freerdp_settings_set_uint32(context->settings, FreeRDP_CompressionLevel, level))
+		return FALSE;
+
+	send = bulk_new(context);
+	recv = bulk_new(context);
+
+	if (!send || !recv)
+		goto fail;
+
+	maxSize = bulk_compression_max_size(send);
+
+	/* RDP8 splits payloads that do not fit in a segment */
+	if (level == PACKET_COMPR_TYPE_RDP8)
+		maxSize = MAX_PAYLOAD;
+
+	for (index = 0; index < 40; index++)
+	{
+		BOOL compressed = FALSE;
+		const UINT32 size = (index % 5 == 4) ? maxSize : 51 + prand(&state) % (maxSize - 51);
+
+		fill_payload(data, size, FALSE, &state);
+
+		if (!test_round_trip(send, recv, data, size, &compressed))
+		{
+			fprintf(stderr, "level %" PRIu32 ": round trip of %" PRIu32 " bytes failed\n", level,
+			        size);
+			goto fail;
+		}
+
+		if (compressed)
+			compressedCount++;
+	}
+
+	if (compressedCount == 0)
+	{
+		fprintf(stderr, "level %" PRIu32 ": nothing was compressed\n", level);
+		goto fail;
+	}
+
+	rc = TRUE;
+fail:
+	bulk_free(send);
+	bulk_free(recv);
+	return rc;
+}
+
+/* Incompressible data stops compression, compressible data brings it back */
+static BOOL test_selector(rdpContext* context, UINT32 level, BYTE* data)
+{
+	BOOL rc = FALSE;
+	UINT32 index;
+	UINT32 state = 0x1234567;
+	UINT32 skipped = 0;
+	BOOL compressed = FALSE;
+	rdpBulk* send = NULL;
+	rdpBulk* recv = NULL;
+
+	if (!freerdp_settings_set_uint32(context->settings, FreeRDP_CompressionLevel, level))
+		return FALSE;
+
+	send = bulk_new(context);
+	recv = bulk_new(context);
+
+	if (!send || !recv)
+		goto fail;
+
+	for (index = 0; index < 64; index++)
+	{
+		UINT32 flags = 0;
+		UINT32 DstSize = 0;
+		BYTE* pDstData = NULL;
+
+		fill_payload(data, 4000, TRUE, &state);
+
+		if (bulk_compress(send, data, 4000, &pDstData, &DstSize, &flags) < 0)
+			goto fail;
+
+		if ((pDstData == data) && (flags == 0))
+			skipped++;
+		else if (bulk_decompress(recv, pDstData, DstSize, &pDstData, &DstSize, flags) < 0)
+			goto fail;
+	}
+
+	if (skipped < 32)
+	{
+		fprintf(stderr, "level %" PRIu32 ": only %" PRIu32 " of 64 noise payloads skipped\n", level,
+		        skipped);
+		goto fail;
+	}
+
+	for (index = 0; (index < 300) && !compressed; index++)
+	{
+		fill_payload(data, 4000, FALSE, &state);
+
+		if (!test_round_trip(send, recv, data, 4000, &compressed))
+			goto fail;
+	}
+
+	if (!compressed)
+	{
+		fprintf(stderr, "level %" PRIu32 ": compression was not resumed\n", level);
+		goto fail;
+	}
+
+	rc = TRUE;
+fail:
+	bulk_free(send);
+	bulk_free(recv);
+	return rc;
+}
+
+int TestBulk(int argc, char* argv[])
+{
+	int rc = -1;
+	UINT32 level;
+	rdpContext context = { 0 };
+	BYTE* data = malloc(MAX_PAYLOAD);
+
+	WINPR_UNUSED(argc);
+	WINPR_UNUSED(argv);
+
+	context.settings = freerdp_settings_new(0);
+	context.metrics = metrics_new(&context);
+
+	if (!data || !context.settings || !context.metrics)
+		goto fail;
+
+	for (level = PACKET_COMPR_TYPE_8K; level <= PACKET_COMPR_TYPE_RDP8; level++)
+	{
+		if (!test_level(&context, level, data))
+			goto fail;
+	}
+
+	if (!test_selector(&context, PACKET_COMPR_TYPE_RDP61, data) ||
+	    !test_selector(&context, PACKET_COMPR_TYPE_RDP8, data))
+		goto fail;
+
+	rc = 0;
+fail:
+	metrics_free(context.metrics);
+	freerdp_settings_free(context.settings);
+	free(data);
+	return rc;
+}
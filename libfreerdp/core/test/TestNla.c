@@ -0,0 +1,416 @@
+#include <freerdp/freerdp.h>
+#include <freerdp/settings.h>
+
+#include <winpr/crt.h>
+#include <winpr/file.h>
+#include <winpr/path.h>
+#include <winpr/synch.h>
+#include <winpr/sysinfo.h>
+#include <winpr/thread.h>
+
+#include <openssl/bio.h>
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+#include <openssl/provider.h>
+#endif
+
+#include "../nla.h"
+#include "../transport.h"
+
+#define TEST_NT_HASH "8846F7EAEE8FB117AD06BDD830B7586C" /* password */
+
+typedef struct
+{
+	rdpContext context;
+	freerdp instance;
+	rdpTransport* transport;
+	rdpNla* nla;
+	BIO* wire; /* TSRequests written by this side */
+} TestPeer;
+
+static UINT32 test_random(UINT32* seed)
+{
+	*seed = *seed * 1103515245 + 12345;
+	return (*seed >> 16) & 0x7FFF;
+}
+
+static int test_write_pdu(rdpTransport* transport, wStream* s)
+{
+	TestPeer* peer = (TestPeer*)transport_get_context(transport);
+	const int length = (int)Stream_GetPosition(s);
+
+	if (BIO_write(peer->wire, Stream_Buffer(s), length) != length)
+		return -1;
+
+	return length;
+}
+
+static void test_peer_free(TestPeer* peer)
+{
+	nla_free(peer->nla);
+	transport_free(peer->transport);
+	freerdp_settings_free(peer->context.settings);
+	BIO_free_all(peer->wire);
+	ZeroMemory(peer, sizeof(TestPeer));
+}
+
+static BOOL test_peer_init(TestPeer* peer, BOOL server, const char* password, const char* sam)
+{
+	rdpTls* tls;
+	rdpSettings* settings;
+	rdpTransportIo io;
+	BYTE key[64];
+
+	ZeroMemory(peer, sizeof(TestPeer));
+	FillMemory(key, sizeof(key), 0x5A);
+	peer->context.instance = &peer->instance;
+	peer->instance.context = &peer->context;
+	peer->context.settings = settings =
+	    freerdp_settings_new(server ? FREERDP_SETTINGS_SERVER_MODE : 0);
+	peer->wire = BIO_new(BIO_s_mem());
+
+	if (!settings || !peer->wire)
+		goto fail;
+
+	if (server)
+	{
+		if (!freerdp_settings_set_string(settings, FreeRDP_NtlmSamFile, sam))
+			goto fail;
+	}
+	else if (!freerdp_settings_set_string(settings, FreeRDP_ServerHostname, "localhost") ||
+	         !freerdp_settings_set_string(settings, FreeRDP_Username, "user") ||
+	         !freerdp_settings_set_string(settings, FreeRDP_Domain, "DOMAIN") ||
+	         !freerdp_settings_set_string(settings, FreeRDP_Password, password))
+		goto fail;
+
+	peer->transport = transport_new(&peer->context);
+
+	if (!peer->transport)
+		goto fail;
+
+	io = *transport_get_io_callbacks(peer->transport);
+	io.WritePdu = test_write_pdu;
+	transport_set_io_callbacks(peer->transport, &io);
+	transport_set_nla_mode(peer->transport, TRUE);
+
+	/* Both sides use the public key of the TLS connection */
+	tls = tls_new(settings);
+
+	if (!tls || !transport_set_tls(peer->transport, tls))
+		goto fail;
+
+	tls->PublicKey = malloc(sizeof(key));
+
+	if (!tls->PublicKey)
+		goto fail;
+
+	memcpy(tls->PublicKey, key, sizeof(key));
+	tls->PublicKeyLength = sizeof(key);
+	peer->nla = nla_new(&peer->instance, peer->transport, settings);
+
+	if (!peer->nla)
+		goto fail;
+
+	return TRUE;
+fail:
+	test_peer_free(peer);
+	return FALSE;
+}
+
+/* Feeds the pending data of the client to the server in fragments of up to maxFragment bytes,
+ * the client continues to send data after the final TSRequest */
+static int test_feed_server(TestPeer* client, TestPeer* server, UINT32* seed,
+                            size_t maxFragment)
+{
+	int status = 0;
+	size_t offset = 0;
+	const BYTE trailer[] = { 0x03, 0x00, 0x00, 0x13 };
+	const int pending = BIO_pending(client->wire);
+	const BOOL final = nla_get_state(client->nla) == NLA_STATE_AUTH_INFO;
+	const size_t length = (size_t)pending + (final ? sizeof(trailer) : 0);
+	BYTE* data = malloc(length + 1);
+
+	if (!data || (pending <= 0) || (BIO_read(client->wire, data, pending) != pending))
+		goto fail;
+
+	if (final)
+		memcpy(&data[pending], trailer, sizeof(trailer));
+
+	while ((status == 0) && (offset < length))
+	{
+		size_t used = 0;
+		size_t count = 1 + test_random(seed) % maxFragment;
+
+		if (count > length - offset)
+			count = length - offset;
+
+		status = nla_server_feed(server->nla, &data[offset], count, &used);
+
+		if ((status < 0) || ((status == 0) && (used != count)))
+			goto fail;
+
+		offset += used;
+	}
+
+	/* Only the data of the final TSRequest is consumed */
+	if ((status == 1) && (!final || (offset != (size_t)pending)))
+	{
+		fprintf(stderr, "unexpected end of the authentication\n");
+		status = -1;
+	}
+
+	free(data);
+	return status;
+fail:
+	free(data);
+	return -1;
+}
+
+static BOOL test_feed_client(TestPeer* server, TestPeer* client)
+{
+	int rc = -1;
+	const int pending = BIO_pending(server->wire);
+	wStream* s = (pending > 0) ? Stream_New(NULL, (size_t)pending) : NULL;
+
+	if (!s || (BIO_read(server->wire, Stream_Buffer(s), pending) != pending))
+		goto fail;
+
+	Stream_SetLength(s, (size_t)pending);
+	rc = nla_recv_pdu(client->nla, s);
+fail:
+	Stream_Free(s, TRUE);
+	return rc >= 0;
+}
+
+static BOOL test_authenticate(const char* sam, const char* password, UINT32 seed,
+                              size_t maxFragment)
+{
+	int status = 0;
+	BOOL rc = FALSE;
+	TestPeer client = { 0 };
+	TestPeer server = { 0 };
+	const BOOL valid = strcmp(password, "password") == 0;
+
+	if (!test_peer_init(&client, FALSE, password, NULL) ||
+	    !test_peer_init(&server, TRUE, NULL, sam))
+		goto fail;
+
+	if ((nla_client_begin(client.nla) < 0) || (nla_server_begin(server.nla) != 0))
+		goto fail;
+
+	while (status == 0)
+	{
+		status = test_feed_server(&client, &server, &seed, maxFragment);
+
+		if ((status == 0) && !test_feed_client(&server, &client))
+			break;
+	}
+
+	if (status != (valid ? 1 : -1))
+	{
+		fprintf(stderr, "%s password: authentication returned %d\n", password, status);
+		goto fail;
+	}
+
+	if (valid && ((nla_get_state(server.nla) != NLA_STATE_FINAL) ||
+	              (nla_get_identity(server.nla)->UserLength != 4)))
+	{
+		fprintf(stderr, "credentials not received\n");
+		goto fail;
+	}
+
+	rc = TRUE;
+fail:
+	test_peer_free(&client);
+	test_peer_free(&server);
+	return rc;
+}
+
+static BOOL test_invalid(const char* sam)
+{
+	BOOL rc = FALSE;
+	TestPeer client = { 0 };
+	TestPeer server = { 0 };
+	const BYTE invalid[] = { 0x31, 0x02, 0x00, 0x00 };
+
+	if (!test_peer_init(&client, FALSE, "password", NULL) ||
+	    !test_peer_init(&server, TRUE, NULL, sam))
+		goto fail;
+
+	/* Data is only accepted after the authentication started */
+	if ((nla_server_feed(server.nla, invalid, sizeof(invalid), NULL) >= 0) ||
+	    (nla_server_begin(server.nla) != 0))
+		goto fail;
+
+	if (nla_server_feed(server.nla, invalid, sizeof(invalid), NULL) >= 0)
+	{
+		fprintf(stderr, "invalid TSRequest accepted\n");
+		goto fail;
+	}
+
+	rc = TRUE;
+fail:
+	test_peer_free(&client);
+	test_peer_free(&server);
+	return rc;
+}
+
+static BOOL test_timeout(const char* sam)
+{
+	BOOL rc = FALSE;
+	BYTE data[8];
+	TestPeer client = { 0 };
+	TestPeer server = { 0 };
+
+	if (!test_peer_init(&client, FALSE, "password", NULL) ||
+	    !test_peer_init(&server, TRUE, NULL, sam))
+		goto fail;
+
+	if ((nla_client_begin(client.nla) < 0) || (nla_server_begin(server.nla) != 0) ||
+	    (nla_server_get_timeout(server.nla) == INFINITE) ||
+	    !nla_server_set_timeout(server.nla, 50))
+		goto fail;
+
+	/* A partial request does not restart the timeout of the state */
+	if ((BIO_read(client.wire, data, sizeof(data)) != sizeof(data)) ||
+	    (nla_server_feed(server.nla, data, sizeof(data), NULL) != 0) ||
+	    (nla_server_get_timeout(server.nla) == 0))
+		goto fail;
+
+	Sleep(100);
+
+	if ((nla_server_get_timeout(server.nla) != 0) ||
+	    (nla_server_feed(server.nla, NULL, 0, NULL) >= 0))
+	{
+		fprintf(stderr, "timeout not detected\n");
+		goto fail;
+	}
+
+	rc = TRUE;
+fail:
+	test_peer_free(&client);
+	test_peer_free(&server);
+	return rc;
+}
+
+/* The transport of a peer is given the TSRequests as they arrive and gives up on a client that
+ * stops sending */
+static BOOL test_transport_accept(const char* sam)
+{
+	int status = 0;
+	BOOL rc = FALSE;
+	wStream* s = NULL;
+	TestPeer client = { 0 };
+	TestPeer server = { 0 };
+
+	if (!test_peer_init(&client, FALSE, "password", NULL) ||
+	    !test_peer_init(&server, TRUE, NULL, sam))
+		goto fail;
+
+	/* The transport owns the server context from now on */
+	transport_set_nla(server.transport, server.nla);
+	server.nla = NULL;
+
+	if ((nla_client_begin(client.nla) < 0) ||
+	    (nla_server_begin(transport_get_nla(server.transport)) != 0))
+		goto fail;
+
+	while (status == 0)
+	{
+		const int pending = BIO_pending(client.wire);
+
+		Stream_Free(s, TRUE);
+		s = (pending > 0) ? Stream_New(NULL, (size_t)pending) : NULL;
+
+		if (!s || (BIO_read(client.wire, Stream_Buffer(s), pending) != pending))
+			goto fail;
+
+		Stream_SetLength(s, (size_t)pending);
+
+		/* Without data only the timeout is checked */
+		if (transport_accept_nla_recv(server.transport, NULL) != 0)
+			goto fail;
+
+		status = transport_accept_nla_recv(server.transport, s);
+
+		if ((status == 0) && !test_feed_client(&server, &client))
+			goto fail;
+	}
+
+	if ((status != 1) || !transport_get_nla(server.transport))
+	{
+		fprintf(stderr, "transport authentication returned %d\n", status);
+		goto fail;
+	}
+
+	/* A new exchange times out while the client does not send anything */
+	transport_set_nla(server.transport,
+	                  nla_new(&server.instance, server.transport, server.context.settings));
+
+	if (!transport_get_nla(server.transport) ||
+	    (nla_server_begin(transport_get_nla(server.transport)) < 0) ||
+	    !nla_server_set_timeout(transport_get_nla(server.transport), 50))
+		goto fail;
+
+	Sleep(100);
+
+	if ((transport_accept_nla_recv(server.transport, NULL) >= 0) ||
+	    transport_get_nla(server.transport))
+	{
+		fprintf(stderr, "transport timeout not detected\n");
+		goto fail;
+	}
+
+	rc = TRUE;
+fail:
+	Stream_Free(s, TRUE);
+	test_peer_free(&client);
+	test_peer_free(&server);
+	return rc;
+}
+
+int TestNla(int argc, char* argv[])
+{
+	int rc = -1;
+	size_t x;
+	char name[64];
+	char* sam = NULL;
+	FILE* fp = NULL;
+	const size_t fragments[] = { 1, 7, 100, 100000 };
+
+	WINPR_UNUSED(argc);
+	WINPR_UNUSED(argv);
+
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+	/* NTLM requires MD4 and RC4 */
+	OSSL_PROVIDER_load(NULL, "legacy");
+	OSSL_PROVIDER_load(NULL, "default");
+#endif
+
+	sprintf_s(name, sizeof(name), "TestNla-%" PRIu32, GetCurrentProcessId());
+	sam = GetKnownSubPath(KNOWN_PATH_TEMP, name);
+	fp = sam ? winpr_fopen(sam, "w") : NULL;
+
+	if (!fp)
+		goto fail;
+
+	fputs("user:DOMAIN::" TEST_NT_HASH ":::\n", fp);
+	fclose(fp);
+
+	for (x = 0; x < ARRAYSIZE(fragments); x++)
+	{
+		if (!test_authenticate(sam, "password", (UINT32)x, fragments[x]))
+			goto fail;
+	}
+
+	if (!test_authenticate(sam, "wrong", 42, 13) || !test_invalid(sam) || !test_timeout(sam) ||
+	    !test_transport_accept(sam))
+		goto fail;
+
+	rc = 0;
+fail:
+	if (sam)
+		winpr_DeleteFile(sam);
+
+	free(sam);
+	return rc;
+}
@@ -0,0 +1,344 @@
+#include <winpr/crt.h>
+#include <winpr/synch.h>
+#include <winpr/wtsapi.h>
+
+#include <freerdp/peer.h>
+#include <freerdp/settings.h>
+#include <freerdp/channels/channels.h>
+#include <freerdp/channels/wtsvc.h>
+
+#include "../rdp.h"
+
+#define LOW_CHANNEL_ID 1004
+#define HIGH_CHANNEL_ID 1005
+#define MAX_PACKETS 256
+
+typedef struct
+{
+	UINT16 channelId;
+	UINT32 flags;
+	size_t totalSize;
+	size_t chunkSize;
+	const BYTE* data;
+} TestPacket;
+
+typedef struct
+{
+	TestPacket packets[MAX_PACKETS];
+	size_t count;
+	BYTE received[0x20000];
+	size_t receivedLength;
+	HANDLE writeOnFirst;
+	BYTE* writeData;
+	ULONG writeLength;
+	size_t freed;
+	BOOL failNext;
+} TestPeerState;
+
+static TestPeerState state = { 0 };
+
+static BOOL test_send_channel_packet(freerdp_peer* client, UINT16 channelId, size_t totalSize,
+                                     UINT32 flags, const BYTE* data, size_t chunkSize)
+{
+	TestPacket* packet;
+	WINPR_UNUSED(client);
+
+	if (state.failNext || (state.count >= MAX_PACKETS))
+	{
+		state.failNext = FALSE;
+		return FALSE;
+	}
+
+	packet = &state.packets[state.count++];
+	packet->channelId = channelId;
+	packet->flags = flags;
+	packet->totalSize = totalSize;
+	packet->chunkSize = chunkSize;
+	packet->data = data;
+
+	if ((channelId == LOW_CHANNEL_ID) &&
+	    (state.receivedLength + chunkSize <= sizeof(state.received)))
+	{
+		memcpy(&state.received[state.receivedLength], data, chunkSize);
+		state.receivedLength += chunkSize;
+	}
+
+	/* Simulates another thread writing while a transfer is in progress */
+	if (state.writeOnFirst)
+	{
+		ULONG written;
+		HANDLE channel = state.writeOnFirst;
+		state.writeOnFirst = NULL;
+
+		if (!WTSVirtualChannelWrite(channel, (PCHAR)state.writeData, state.writeLength, &written))
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+static BOOL test_send_channel_data(freerdp_peer* client, UINT16 channelId, const BYTE* data,
+                                   size_t size)
+{
+	return test_send_channel_packet(client, channelId, size, CHANNEL_FLAG_ONLY, data, size);
+}
+
+static void test_buffer_free(void* context, BYTE* buffer)
+{
+	WINPR_UNUSED(context);
+	state.freed++;
+	free(buffer);
+}
+
+static SSIZE_T find_packet(UINT16 channelId)
+{
+	size_t index;
+
+	for (index = 0; index < state.count; index++)
+	{
+		if (state.packets[index].channelId == channelId)
+			return (SSIZE_T)index;
+	}
+
+	return -1;
+}
+
+static BOOL test_low_transfer_complete(const BYTE* data, size_t length)
+{
+	size_t index;
+	size_t offset = 0;
+
+	for (index = 0; index < state.count; index++)
+	{
+		const TestPacket* packet = &state.packets[index];
+
+		if (packet->channelId != LOW_CHANNEL_ID)
+			continue;
+
+		if (packet->totalSize != length)
+			return FALSE;
+
+		if (((packet->flags & CHANNEL_FLAG_FIRST) != 0) != (offset == 0))
+			return FALSE;
+
+		offset += packet->chunkSize;
+
+		if (((packet->flags & CHANNEL_FLAG_LAST) != 0) != (offset == length))
+			return FALSE;
+	}
+
+	return (offset == length) && (state.receivedLength == length) &&
+	       (memcmp(state.received, data, length) == 0);
+}
+
+static void test_reset(void)
+{
+	state.count = 0;
+	state.receivedLength = 0;
+}
+
+int TestServerChannels(int argc, char* argv[])
+{
+	int rc = -1;
+	ULONG written;
+	size_t index;
+	SSIZE_T pos;
+	freerdp_peer* peer = NULL;
+	rdpContext context = { 0 };
+	rdpRdp rdp = { 0 };
+	rdpMcs mcs = { 0 };
+	rdpMcsChannel channels[2] = { 0 };
+	rdpSettings* settings = NULL;
+	HANDLE hServer = INVALID_HANDLE_VALUE;
+	HANDLE low = NULL;
+	HANDLE high = NULL;
+	BYTE* large = NULL;
+	BYTE* shared = NULL;
+	BYTE small[16] = { 0 };
+	const size_t largeLength = 64 * 1024;
+
+	WINPR_UNUSED(argc);
+	WINPR_UNUSED(argv);
+
+	/* Keeps the default SendChannelData, static channels are then sent chunk by chunk */
+	peer = freerdp_peer_new(-1);
+	settings = freerdp_settings_new(FREERDP_SETTINGS_SERVER_MODE);
+	large = malloc(largeLength);
+
+	if (!peer || !settings || !large)
+		goto fail;
+
+	for (index = 0; index < largeLength; index++)
+		large[index] = (BYTE)(index * 7 + index / 251);
+
+	memset(small, 0xA5, sizeof(small));
+
+	strcpy(channels[0].Name, "lowchan");
+	channels[0].ChannelId = LOW_CHANNEL_ID;
+	channels[0].joined = TRUE;
+	strcpy(channels[1].Name, "highchan");
+	channels[1].ChannelId = HIGH_CHANNEL_ID;
+	channels[1].joined = TRUE;
+	mcs.channels = channels;
+	mcs.channelCount = mcs.channelMaxCount = ARRAYSIZE(channels);
+	rdp.mcs = &mcs;
+	rdp.settings = settings;
+	context.rdp = &rdp;
+	context.peer = peer;
+	context.settings = settings;
+	peer->context = &context;
+	peer->settings = settings;
+	peer->SendChannelPacket = test_send_channel_packet;
+
+	WTSRegisterWtsApiFunctionTable(FreeRDP_InitWtsApi());
+	hServer = WTSOpenServerA((LPSTR)&context);
+
+	if (hServer == INVALID_HANDLE_VALUE)
+		goto fail;
+
+	low = WTSVirtualChannelOpen(hServer, WTS_CURRENT_SESSION, "lowchan");
+	high = WTSVirtualChannelOpen(hServer, WTS_CURRENT_SESSION, "highchan");
+
+	if (!low || !high)
+		goto fail;
+
+	if (!WTSVirtualChannelSetPriority(low, WTS_CHANNEL_PRIORITY_LOW) ||
+	    !WTSVirtualChannelSetPriority(high, WTS_CHANNEL_PRIORITY_HIGH))
+		goto fail;
+
+	/* A message queued behind a large transfer overtakes it */
+	test_reset();
+
+	if (!WTSVirtualChannelWrite(low, (PCHAR)large, (ULONG)largeLength, &written) ||
+	    !WTSVirtualChannelWrite(high, (PCHAR)small, sizeof(small), &written))
+		goto fail;
+
+	if (!WTSVirtualChannelManagerCheckFileDescriptorEx(hServer, FALSE))
+		goto fail;
+
+	pos = find_packet(HIGH_CHANNEL_ID);
+
+	if ((pos < 0) || (pos > 1) || (state.packets[pos].chunkSize != sizeof(small)))
+	{
+		fprintf(stderr, "high priority message sent at position %" PRIdz "\n", pos);
+		goto fail;
+	}
+
+	if (!test_low_transfer_complete(large, largeLength))
+	{
+		fprintf(stderr, "low priority transfer corrupted\n");
+		goto fail;
+	}
+
+	/* A message written while the transfer is sent goes out after the current chunk */
+	test_reset();
+	state.writeOnFirst = high;
+	state.writeData = small;
+	state.writeLength = sizeof(small);
+
+	if (!WTSVirtualChannelWrite(low, (PCHAR)large, (ULONG)largeLength, &written))
+		goto fail;
+
+	if (!WTSVirtualChannelManagerCheckFileDescriptorEx(hServer, FALSE))
+		goto fail;
+
+	pos = find_packet(HIGH_CHANNEL_ID);
+
+	if (pos != 1)
+	{
+		fprintf(stderr, "high priority message delayed to position %" PRIdz "\n", pos);
+		goto fail;
+	}
+
+	if (!test_low_transfer_complete(large, largeLength))
+	{
+		fprintf(stderr, "interrupted low priority transfer corrupted\n");
+		goto fail;
+	}
+
+	/* Referenced buffers are sent in place and released once */
+	test_reset();
+	shared = malloc(largeLength);
+
+	if (!shared)
+		goto fail;
+
+	memcpy(shared, large, largeLength);
+
+	if (!WTSVirtualChannelWriteBuffer(low, shared, (ULONG)largeLength, test_buffer_free, NULL))
+		goto fail;
+
+	/* Send credits limit each call to a single chunk */
+	WTSVirtualChannelManagerSetSendCredits(hServer, 1);
+
+	if (!WTSVirtualChannelManagerCheckFileDescriptorEx(hServer, FALSE))
+		goto fail;
+
+	if ((state.count != 1) || (state.packets[0].data != shared) ||
+	    (WaitForSingleObject(WTSVirtualChannelManagerGetEventHandle(hServer), 0) != WAIT_OBJECT_0))
+	{
+		fprintf(stderr, "send credits or zero copy write failed\n");
+		goto fail;
+	}
+
+	WTSVirtualChannelManagerSetSendCredits(hServer, 0);
+
+	if (!WTSVirtualChannelManagerCheckFileDescriptorEx(hServer, FALSE))
+		goto fail;
+
+	if ((state.freed != 1) || !test_low_transfer_complete(large, largeLength) ||
+	    (WaitForSingleObject(WTSVirtualChannelManagerGetEventHandle(hServer), 0) != WAIT_TIMEOUT))
+	{
+		fprintf(stderr, "shared buffer not released\n");
+		goto fail;
+	}
+
+	/* A chunk the peer failed to send stays queued */
+	test_reset();
+	state.failNext = TRUE;
+
+	if (!WTSVirtualChannelWrite(low, (PCHAR)large, (ULONG)largeLength, &written))
+		goto fail;
+
+	if (WTSVirtualChannelManagerCheckFileDescriptorEx(hServer, FALSE) || (state.count != 0) ||
+	    (WaitForSingleObject(WTSVirtualChannelManagerGetEventHandle(hServer), 0) != WAIT_OBJECT_0))
+	{
+		fprintf(stderr, "failed send not reported\n");
+		goto fail;
+	}
+
+	if (!WTSVirtualChannelManagerCheckFileDescriptorEx(hServer, FALSE) ||
+	    !test_low_transfer_complete(large, largeLength))
+	{
+		fprintf(stderr, "transfer not resumed after a failed send\n");
+		goto fail;
+	}
+
+	/* An application that replaced SendChannelData gets whole messages */
+	test_reset();
+	peer->SendChannelData = test_send_channel_data;
+
+	if (!WTSVirtualChannelWrite(low, (PCHAR)large, (ULONG)largeLength, &written) ||
+	    !WTSVirtualChannelManagerCheckFileDescriptorEx(hServer, FALSE))
+		goto fail;
+
+	if ((state.count != 1) || (state.packets[0].flags != CHANNEL_FLAG_ONLY) ||
+	    !test_low_transfer_complete(large, largeLength))
+	{
+		fprintf(stderr, "message not sent through SendChannelData\n");
+		goto fail;
+	}
+
+	rc = 0;
+fail:
+	WTSVirtualChannelClose(low);
+	WTSVirtualChannelClose(high);
+
+	if (hServer != INVALID_HANDLE_VALUE)
+		WTSCloseServer(hServer);
+
+	free(large);
+	freerdp_settings_free(settings);
+	freerdp_peer_free(peer);
+	return rc;
+}
@@ -0,0 +1,449 @@
+#include <stdio.h>
+
+#include <winpr/crt.h>
+#include <winpr/stream.h>
+
+#include <freerdp/freerdp.h>
+#include <freerdp/settings.h>
+#include <freerdp/window.h>
+
+#include "../update.h"
+#include "../window.h"
+
+#define TEST_MAX_EVENTS 32
+
+#define TEST_NOT_CACHED 0xFF
+
+#define TEST_ORDER_TYPES (WINDOW_ORDER_TYPE_WINDOW | WINDOW_ORDER_TYPE_DESKTOP)
+
+/* fields of a window state order written by test_write_state */
+#define TEST_STATE_FIELDS                                                                  \
+	(WINDOW_ORDER_FIELD_STYLE | WINDOW_ORDER_FIELD_TITLE | WINDOW_ORDER_FIELD_WND_OFFSET)
+
+typedef struct
+{
+	char type;
+	UINT32 windowId;
+	UINT32 fieldFlags;
+	char title;
+	UINT32 cacheEntry;
+	BYTE color;
+} TestEvent;
+
+static TestEvent events[TEST_MAX_EVENTS];
+static size_t nevents = 0;
+
+static TestEvent* test_event(char type, const WINDOW_ORDER_INFO* orderInfo)
+{
+	TestEvent* event;
+
+	if (nevents >= TEST_MAX_EVENTS)
+		return NULL;
+
+	event = &events[nevents++];
+	ZeroMemory(event, sizeof(TestEvent));
+	event->type = type;
+	event->windowId = orderInfo->windowId;
+	event->fieldFlags = orderInfo->fieldFlags;
+	return event;
+}
+
+static BOOL test_window_state(char type, const WINDOW_ORDER_INFO* orderInfo,
+                              const WINDOW_STATE_ORDER* window_state)
+{
+	TestEvent* event = test_event(type, orderInfo);
+
+	if (!event)
+		return FALSE;
+
+	if ((orderInfo->fieldFlags & WINDOW_ORDER_FIELD_TITLE) && (window_state->titleInfo.length > 0))
+		event->title = (char)window_state->titleInfo.string[0];
+
+	return TRUE;
+}
+
+static BOOL test_window_create(rdpContext* context, const WINDOW_ORDER_INFO* orderInfo,
+                               const WINDOW_STATE_ORDER* window_state)
+{
+	WINPR_UNUSED(context);
+	return test_window_state('C', orderInfo, window_state);
+}
+
+static BOOL test_window_update(rdpContext* context, const WINDOW_ORDER_INFO* orderInfo,
+                               const WINDOW_STATE_ORDER* window_state)
+{
+	WINPR_UNUSED(context);
+	return test_window_state('U', orderInfo, window_state);
+}
+
+static BOOL test_window_icon(rdpContext* context, const WINDOW_ORDER_INFO* orderInfo,
+                             const WINDOW_ICON_ORDER* window_icon)
+{
+	TestEvent* event = test_event('I', orderInfo);
+	WINPR_UNUSED(context);
+
+	if (!event)
+		return FALSE;
+
+	event->cacheEntry = window_icon->iconInfo->cacheEntry;
+	event->color = window_icon->iconInfo->bitsColor[0];
+	return TRUE;
+}
+
+static BOOL test_window_cached_icon(rdpContext* context, const WINDOW_ORDER_INFO* orderInfo,
+                                    const WINDOW_CACHED_ICON_ORDER* window_cached_icon)
+{
+	TestEvent* event = test_event('c', orderInfo);
+	WINPR_UNUSED(context);
+
+	if (!event)
+		return FALSE;
+
+	event->cacheEntry = window_cached_icon->cachedIcon.cacheEntry;
+	return TRUE;
+}
+
+static BOOL test_window_delete(rdpContext* context, const WINDOW_ORDER_INFO* orderInfo)
+{
+	WINPR_UNUSED(context);
+	return test_event('D', orderInfo) != NULL;
+}
+
+static BOOL test_monitored_desktop(rdpContext* context, const WINDOW_ORDER_INFO* orderInfo,
+                                   const MONITORED_DESKTOP_ORDER* monitored_desktop)
+{
+	TestEvent* event = test_event('M', orderInfo);
+	WINPR_UNUSED(context);
+
+	if (!event)
+		return FALSE;
+
+	event->windowId = monitored_desktop->activeWindowId;
+	return TRUE;
+}
+
+static size_t test_order_begin(wStream* s, UINT32 fieldFlags, UINT32 windowId)
+{
+	const size_t pos = Stream_GetPosition(s);
+
+	Stream_Write_UINT16(s, 0); /* orderSize */
+	Stream_Write_UINT32(s, fieldFlags);
+	Stream_Write_UINT32(s, windowId);
+	return pos;
+}
+
+static void test_order_end(wStream* s, size_t pos)
+{
+	const size_t end = Stream_GetPosition(s);
+
+	Stream_SetPosition(s, pos);
+	Stream_Write_UINT16(s, (UINT16)(end - pos));
+	Stream_SetPosition(s, end);
+}
+
+/* A new window or an update with title, style and the window offset */
+static void test_write_state(wStream* s, UINT32 windowId, BOOL create, UINT32 fields, char title,
+                             INT32 offset)
+{
+	const size_t pos = test_order_begin(
+	    s, WINDOW_ORDER_TYPE_WINDOW | (create ? WINDOW_ORDER_STATE_NEW : 0) | fields, windowId);
+
+	if (fields & WINDOW_ORDER_FIELD_STYLE)
+	{
+		Stream_Write_UINT32(s, 0x14CF0000); /* style */
+		Stream_Write_UINT32(s, 0);          /* extendedStyle */
+	}
+
+	if (fields & WINDOW_ORDER_FIELD_TITLE)
+	{
+		Stream_Write_UINT16(s, 2);
+		Stream_Write_UINT16(s, (UINT16)title);
+	}
+
+	if (fields & WINDOW_ORDER_FIELD_WND_OFFSET)
+	{
+		Stream_Write_INT32(s, offset);
+		Stream_Write_INT32(s, offset);
+	}
+
+	test_order_end(s, pos);
+}
+
+/* A 2x2 32bpp icon filled with color */
+static void test_write_icon(wStream* s, UINT32 windowId, UINT32 slot, UINT16 cacheEntry,
+                            BYTE cacheId, BYTE color)
+{
+	const size_t pos =
+	    test_order_begin(s, WINDOW_ORDER_TYPE_WINDOW | WINDOW_ORDER_ICON | slot, windowId);
+
+	Stream_Write_UINT16(s, cacheEntry);
+	Stream_Write_UINT8(s, cacheId);
+	Stream_Write_UINT8(s, 32); /* bpp */
+	Stream_Write_UINT16(s, 2); /* width */
+	Stream_Write_UINT16(s, 2); /* height */
+	Stream_Write_UINT16(s, 4); /* cbBitsMask */
+	Stream_Write_UINT16(s, 16); /* cbBitsColor */
+	Stream_Write_UINT32(s, 0xFFFFFFFF);
+	Stream_Fill(s, color, 16);
+	test_order_end(s, pos);
+}
+
+static void test_write_cached_icon(wStream* s, UINT32 windowId, UINT16 cacheEntry)
+{
+	const size_t pos =
+	    test_order_begin(s, WINDOW_ORDER_TYPE_WINDOW | WINDOW_ORDER_CACHED_ICON, windowId);
+
+	Stream_Write_UINT16(s, cacheEntry);
+	Stream_Write_UINT8(s, 0); /* cacheId */
+	test_order_end(s, pos);
+}
+
+static void test_write_delete(wStream* s, UINT32 windowId)
+{
+	const size_t pos =
+	    test_order_begin(s, WINDOW_ORDER_TYPE_WINDOW | WINDOW_ORDER_STATE_DELETED, windowId);
+	test_order_end(s, pos);
+}
+
+static void test_write_desktop(wStream* s, UINT32 activeWindowId)
+{
+	const size_t pos = Stream_GetPosition(s);
+
+	Stream_Write_UINT16(s, 0);
+	Stream_Write_UINT32(s, WINDOW_ORDER_TYPE_DESKTOP | WINDOW_ORDER_FIELD_DESKTOP_ACTIVE_WND);
+	Stream_Write_UINT32(s, activeWindowId);
+	test_order_end(s, pos);
+}
+
+/* Receives the orders of s as one update */
+static BOOL test_recv(rdpUpdate* update, wStream* s, BOOL batch)
+{
+	BOOL rc = TRUE;
+
+	Stream_SealLength(s);
+	Stream_SetPosition(s, 0);
+
+	if (batch)
+		update_begin_window_orders(update);
+
+	while (rc && (Stream_GetRemainingLength(s) > 0))
+		rc = update_recv_altsec_window_order(update, s);
+
+	if (batch && !update_end_window_orders(update, rc))
+		rc = FALSE;
+
+	Stream_SetPosition(s, 0);
+	return rc;
+}
+
+/* Compares and consumes the delivered events */
+static BOOL test_events(const char* name, const TestEvent* expected, size_t count)
+{
+	size_t i;
+	const size_t received = nevents;
+
+	nevents = 0;
+
+	if (received != count)
+	{
+		printf("%s: %" PRIuz " events instead of %" PRIuz "\n", name, received, count);
+		return FALSE;
+	}
+
+	for (i = 0; i < count; i++)
+	{
+		const TestEvent* a = &events[i];
+		const TestEvent* b = &expected[i];
+
+		if ((a->type != b->type) || (a->windowId != b->windowId) ||
+		    ((a->fieldFlags & ~TEST_ORDER_TYPES) != b->fieldFlags) ||
+		    (a->title != b->title) || (a->cacheEntry != b->cacheEntry) || (a->color != b->color))
+		{
+			printf("%s: event %" PRIuz " is %c 0x%08" PRIx32 " 0x%08" PRIx32 " '%c' %" PRIu32
+			       " %" PRIu8 "\n",
+			       name, i, a->type, a->windowId, a->fieldFlags, a->title ? a->title : ' ',
+			       a->cacheEntry, a->color);
+			return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
+/* Orders of a new window are merged into one create and its last icon */
+static BOOL test_merge(rdpUpdate* update, wStream* s)
+{
+	const TestEvent expected[] = {
+		{ 'C', 1, WINDOW_ORDER_STATE_NEW | TEST_STATE_FIELDS, 'b', 0, 0 },
+		{ 'I', 1, WINDOW_ORDER_ICON, 0, 0, 2 },
+	};
+
+	test_write_state(s, 1, TRUE, TEST_STATE_FIELDS, 'a', 0);
+	test_write_icon(s, 1, 0, 0, TEST_NOT_CACHED, 1);
+	test_write_state(s, 1, FALSE, WINDOW_ORDER_FIELD_TITLE, 'b', 0);
+	test_write_state(s, 1, FALSE, WINDOW_ORDER_FIELD_WND_OFFSET, 0, 10);
+	test_write_icon(s, 1, 0, 0, TEST_NOT_CACHED, 2);
+
+	return test_recv(update, s, TRUE) && test_events("merge", expected, ARRAYSIZE(expected));
+}
+
+/* Fields and icons the client already has are dropped, the offset is always passed on */
+static BOOL test_unchanged(rdpUpdate* update, wStream* s)
+{
+	const TestEvent expected[] = {
+		{ 'U', 1, WINDOW_ORDER_FIELD_WND_OFFSET, 0, 0, 0 },
+		{ 'I', 1, WINDOW_ORDER_ICON | WINDOW_ORDER_FIELD_ICON_BIG, 0, 0, 2 },
+	};
+
+	test_write_state(s, 1, FALSE, TEST_STATE_FIELDS, 'b', 10);
+	test_write_icon(s, 1, 0, 0, TEST_NOT_CACHED, 2);
+	test_write_icon(s, 1, WINDOW_ORDER_FIELD_ICON_BIG, 0, TEST_NOT_CACHED, 2);
+
+	if (!test_recv(update, s, TRUE) || !test_events("unchanged", expected, ARRAYSIZE(expected)))
+		return FALSE;
+
+	test_write_state(s, 1, FALSE, WINDOW_ORDER_FIELD_TITLE, 'b', 0);
+	return test_recv(update, s, TRUE) && test_events("unchanged title", NULL, 0);
+}
+
+/* Icons stored in the client icon cache are all delivered, cached icons are passed on */
+static BOOL test_icon_cache(rdpUpdate* update, wStream* s)
+{
+	const TestEvent expected[] = {
+		{ 'I', 1, WINDOW_ORDER_ICON, 0, 1, 3 },
+		{ 'I', 1, WINDOW_ORDER_ICON, 0, 2, 4 },
+		{ 'c', 1, WINDOW_ORDER_CACHED_ICON, 0, 1, 0 },
+	};
+
+	test_write_icon(s, 1, 0, 1, 0, 3);
+	test_write_icon(s, 1, 0, 2, 0, 4);
+	test_write_cached_icon(s, 1, 1);
+
+	return test_recv(update, s, TRUE) &&
+	       test_events("icon cache", expected, ARRAYSIZE(expected));
+}
+
+/* An icon cache entry overwritten by another window is sent again */
+static BOOL test_icon_cache_overwritten(rdpUpdate* update, wStream* s)
+{
+	const TestEvent expected[] = {
+		{ 'I', 1, WINDOW_ORDER_ICON, 0, 5, 6 },
+		{ 'I', 2, WINDOW_ORDER_ICON, 0, 5, 7 },
+		{ 'I', 1, WINDOW_ORDER_ICON, 0, 5, 6 },
+	};
+
+	test_write_icon(s, 1, 0, 5, 0, 6);
+
+	if (!test_recv(update, s, TRUE))
+		return FALSE;
+
+	test_write_icon(s, 2, 0, 5, 0, 7);
+
+	if (!test_recv(update, s, TRUE))
+		return FALSE;
+
+	test_write_icon(s, 1, 0, 5, 0, 6);
+
+	if (!test_recv(update, s, TRUE))
+		return FALSE;
+
+	return test_events("icon cache overwritten", expected, ARRAYSIZE(expected));
+}
+
+/* Windows are delivered in the order of their first order, a delete or desktop order
+ * delivers what was received before */
+static BOOL test_order(rdpUpdate* update, wStream* s)
+{
+	const TestEvent expected[] = {
+		{ 'U', 1, WINDOW_ORDER_FIELD_TITLE | WINDOW_ORDER_FIELD_WND_OFFSET, 'c', 0, 0 },
+		{ 'C', 2, WINDOW_ORDER_STATE_NEW | WINDOW_ORDER_FIELD_TITLE, 'x', 0, 0 },
+		{ 'D', 2, WINDOW_ORDER_STATE_DELETED, 0, 0, 0 },
+		{ 'C', 2, WINDOW_ORDER_STATE_NEW | WINDOW_ORDER_FIELD_TITLE, 'x', 0, 0 },
+		{ 'U', 1, WINDOW_ORDER_FIELD_TITLE, 'd', 0, 0 },
+		{ 'M', 1, WINDOW_ORDER_FIELD_DESKTOP_ACTIVE_WND, 0, 0, 0 },
+		{ 'U', 1, WINDOW_ORDER_FIELD_TITLE, 'e', 0, 0 },
+	};
+
+	test_write_state(s, 1, FALSE, WINDOW_ORDER_FIELD_TITLE, 'c', 0);
+	test_write_state(s, 2, TRUE, WINDOW_ORDER_FIELD_TITLE, 'x', 0);
+	test_write_state(s, 1, FALSE, WINDOW_ORDER_FIELD_WND_OFFSET, 0, 20);
+	test_write_delete(s, 2);
+	test_write_state(s, 2, TRUE, WINDOW_ORDER_FIELD_TITLE, 'x', 0);
+	test_write_state(s, 1, FALSE, WINDOW_ORDER_FIELD_TITLE, 'd', 0);
+	test_write_desktop(s, 1);
+	test_write_state(s, 1, FALSE, WINDOW_ORDER_FIELD_TITLE, 'e', 0);
+
+	return test_recv(update, s, TRUE) && test_events("order", expected, ARRAYSIZE(expected));
+}
+
+/* Orders outside of an update are delivered right away */
+static BOOL test_unbatched(rdpUpdate* update, wStream* s)
+{
+	const TestEvent expected[] = {
+		{ 'U', 1, WINDOW_ORDER_FIELD_TITLE, 'f', 0, 0 },
+		{ 'U', 1, WINDOW_ORDER_FIELD_TITLE, 'g', 0, 0 },
+	};
+
+	test_write_state(s, 1, FALSE, WINDOW_ORDER_FIELD_TITLE, 'f', 0);
+	test_write_state(s, 1, FALSE, WINDOW_ORDER_FIELD_TITLE, 'g', 0);
+
+	return test_recv(update, s, FALSE) &&
+	       test_events("unbatched", expected, ARRAYSIZE(expected));
+}
+
+/* The orders of a failed update are dropped */
+static BOOL test_failed(rdpUpdate* update, wStream* s)
+{
+	test_write_state(s, 1, FALSE, WINDOW_ORDER_FIELD_TITLE, 'h', 0);
+	Stream_Write_UINT16(s, 0);
+	Stream_Write_UINT32(s, WINDOW_ORDER_TYPE_WINDOW | WINDOW_ORDER_FIELD_TITLE);
+
+	if (test_recv(update, s, TRUE))
+	{
+		printf("failed: short order accepted\n");
+		return FALSE;
+	}
+
+	return test_events("failed", NULL, 0);
+}
+
+int TestWindowOrders(int argc, char* argv[])
+{
+	int rc = -1;
+	rdpContext context = { 0 };
+	rdpUpdate* update = NULL;
+	wStream* s = Stream_New(NULL, 4096);
+
+	WINPR_UNUSED(argc);
+	WINPR_UNUSED(argv);
+
+	context.settings = freerdp_settings_new(0);
+	update = update_new(NULL);
+
+	if (!s || !context.settings || !update)
+		goto fail;
+
+	if (!freerdp_settings_set_uint32(context.settings, FreeRDP_RemoteWndSupportLevel,
+	                                 WINDOW_LEVEL_SUPPORTED_EX))
+		goto fail;
+
+	update->context = &context;
+	update->window->WindowCreate = test_window_create;
+	update->window->WindowUpdate = test_window_update;
+	update->window->WindowIcon = test_window_icon;
+	update->window->WindowCachedIcon = test_window_cached_icon;
+	update->window->WindowDelete = test_window_delete;
+	update->window->MonitoredDesktop = test_monitored_desktop;
+
+	if (!test_merge(update, s) || !test_unchanged(update, s) || !test_icon_cache(update, s) ||
+	    !test_icon_cache_overwritten(update, s) || !test_order(update, s) ||
+	    !test_unbatched(update, s) || !test_failed(update, s))
+		goto fail;
+
+	rc = 0;
+fail:
+	update_free(update);
+	freerdp_settings_free(context.settings);
+	Stream_Free(s, TRUE);
+	return rc;
+}
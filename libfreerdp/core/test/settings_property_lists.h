@@ -71,6 +71,7 @@ static const size_t bool_list_indices[] = {
 	FreeRDP_GatewayUdpTransport,
 	FreeRDP_GatewayUseSameCredentials,
 	FreeRDP_GfxAVC444,
+	FreeRDP_GfxAVC444IndependentAux,
 	FreeRDP_GfxAVC444v2,
 	FreeRDP_GfxH264,
 	FreeRDP_GfxPlanar,
@@ -164,6 +165,7 @@ static const size_t bool_list_indices[] = {
 	FreeRDP_TcpKeepAlive,
 	FreeRDP_TlsSecurity,
 	FreeRDP_ToggleFullscreen,
+	FreeRDP_TransportDump,
 	FreeRDP_UnicodeInput,
 	FreeRDP_UnmapButtons,
 	FreeRDP_UseMultimon,
@@ -258,6 +260,7 @@ static const size_t uint32_list_indices[] = {
 	FreeRDP_PerformanceFlags,
 	FreeRDP_PointerCacheSize,
 	FreeRDP_PreconnectionId,
+	FreeRDP_PrinterSpoolLimit,
 	FreeRDP_ProxyType,
 	FreeRDP_RdpVersion,
 	FreeRDP_ReceivedCapabilitiesSize,
@@ -377,6 +380,7 @@ static const size_t string_list_indices[] = {
 	FreeRDP_ServerHostname,
 	FreeRDP_ShellWorkingDirectory,
 	FreeRDP_TargetNetAddress,
+	FreeRDP_TransportDumpFile,
 	FreeRDP_Username,
 	FreeRDP_WindowTitle,
 	FreeRDP_WmClass,
@@ -481,6 +481,16 @@ static BOOL transport_default_accept_tls(rdpTransport* transport)
 	return TRUE;
 }
 
+static void transport_accept_nla_fail(rdpTransport* transport)
+{
+	WLog_Print(transport->log, WLOG_ERROR, "client authentication failure");
+	transport_set_nla_mode(transport, FALSE);
+	nla_free(transport->nla);
+	transport->nla = NULL;
+	tls_set_alert_code(transport->tls, TLS_ALERT_LEVEL_FATAL, TLS_ALERT_DESCRIPTION_ACCESS_DENIED);
+	tls_send_alert(transport->tls);
+}
+
 BOOL transport_accept_nla(rdpTransport* transport)
 {
 	rdpSettings* settings;
@@ -505,23 +515,46 @@ BOOL transport_accept_nla(rdpTransport* transport)
 		transport_set_nla_mode(transport, TRUE);
 	}
 
-	if (nla_authenticate(transport->nla) < 0)
+	/* The TSRequests of the client are passed to transport_accept_nla_recv as they arrive */
+	if (nla_server_begin(transport->nla) < 0)
 	{
-		WLog_Print(transport->log, WLOG_ERROR, "client authentication failure");
-		transport_set_nla_mode(transport, FALSE);
-		nla_free(transport->nla);
-		transport->nla = NULL;
-		tls_set_alert_code(transport->tls, TLS_ALERT_LEVEL_FATAL,
-		                   TLS_ALERT_DESCRIPTION_ACCESS_DENIED);
-		tls_send_alert(transport->tls);
+		transport_accept_nla_fail(transport);
 		return FALSE;
 	}
 
-	/* don't free nla module yet, we need to copy the credentials from it first */
-	transport_set_nla_mode(transport, FALSE);
 	return TRUE;
 }
 
+/**
+ * Continue the server side NLA with a TSRequest of the client, without data only the timeout
+ * of the current state is checked.
+ * @return 1 if the client is authenticated, 0 if more data is required, -1 on failure
+ */
+int transport_accept_nla_recv(rdpTransport* transport, wStream* s)
+{
+	int status;
+
+	if (!transport || !transport->nla)
+		return -1;
+
+	if (s)
+		status = nla_server_feed(transport->nla, Stream_Buffer(s), Stream_Length(s), NULL);
+	else
+		status = nla_server_feed(transport->nla, NULL, 0, NULL);
+
+	if (status < 0)
+	{
+		transport_accept_nla_fail(transport);
+		return -1;
+	}
+
+	/* don't free nla module yet, we need to copy the credentials from it first */
+	if (status > 0)
+		transport_set_nla_mode(transport, FALSE);
+
+	return status;
+}
+
 #define WLog_ERR_BIO(transport, biofunc, bio) \
 	transport_bio_error_log(transport, biofunc, bio, __FILE__, __FUNCTION__, __LINE__)
 
@@ -900,6 +933,19 @@ static int transport_default_write(rdpTransport* transport, wStream* s)
 	{
 		rdp->outBytes += length;
 		WLog_Packet(transport->log, WLOG_TRACE, Stream_Buffer(s), length, WLOG_PACKET_OUTBOUND);
+
+		/* Only PDUs of the active session can be replayed on another connection */
+		if (rdp->transportDump && !rdp->do_crypt &&
+		    (rdp_get_state(rdp) == CONNECTION_STATE_ACTIVE))
+		{
+			EnterCriticalSection(&rdp->critical);
+
+			if (rdp->transportDump && pcap_add_record(rdp->transportDump, Stream_Buffer(s),
+			                                          (UINT32)length))
+				pcap_flush(rdp->transportDump);
+
+			LeaveCriticalSection(&rdp->critical);
+		}
 	}
 
 	while (length > 0)
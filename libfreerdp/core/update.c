@@ -57,6 +57,7 @@ static const char* update_type_to_string(UINT16 updateType)
 
 static BOOL update_recv_orders(rdpUpdate* update, wStream* s)
 {
+	BOOL rc = TRUE;
 	UINT16 numberOrders;
 
 	if (Stream_GetRemainingLength(s) < 6)
@@ -68,19 +69,25 @@ static BOOL update_recv_orders(rdpUpdate* update, wStream* s)
 	Stream_Seek_UINT16(s);               /* pad2OctetsA (2 bytes) */
 	Stream_Read_UINT16(s, numberOrders); /* numberOrders (2 bytes) */
 	Stream_Seek_UINT16(s);               /* pad2OctetsB (2 bytes) */
+	update_begin_window_orders(update);
 
 	while (numberOrders > 0)
 	{
 		if (!update_recv_order(update, s))
 		{
 			WLog_ERR(TAG, "update_recv_order() failed");
-			return FALSE;
+			rc = FALSE;
+			break;
 		}
 
 		numberOrders--;
 	}
 
-	return TRUE;
+	/* The window orders of the update are merged and delivered at its end */
+	if (!update_end_window_orders(update, rc))
+		return FALSE;
+
+	return rc;
 }
 
 static BOOL update_read_bitmap_data(rdpUpdate* update, wStream* s, BITMAP_DATA* bitmapData)
@@ -851,6 +858,7 @@ void update_reset_state(rdpUpdate* update)
 		primary->fast_glyph.glyphData.aj = NULL;
 	}
 
+	window_order_cache_reset(update_cast(update)->windowOrders);
 	ZeroMemory(&primary->order_info, sizeof(ORDER_INFO));
 	ZeroMemory(&primary->dstblt, sizeof(DSTBLT_ORDER));
 	ZeroMemory(&primary->patblt, sizeof(PATBLT_ORDER));
@@ -2901,14 +2909,17 @@ void update_free_window_state(WINDOW_STATE_ORDER* window_state)
 rdpUpdate* update_new(rdpRdp* rdp)
 {
 	const wObject cb = { NULL, NULL, NULL, update_free_queued_message, NULL };
+	rdp_update_internal* up;
 	rdpUpdate* update;
 	OFFSCREEN_DELETE_LIST* deleteList;
 	WINPR_UNUSED(rdp);
-	update = (rdpUpdate*)calloc(1, sizeof(rdpUpdate));
+	up = (rdp_update_internal*)calloc(1, sizeof(rdp_update_internal));
 
-	if (!update)
+	if (!up)
 		return NULL;
 
+	update = &up->common;
+
 	update->log = WLog_Get("com.freerdp.core.update");
 	InitializeCriticalSection(&(update->mux));
 	update->pointer = (rdpPointerUpdate*)calloc(1, sizeof(rdpPointerUpdate));
@@ -2952,6 +2963,11 @@ rdpUpdate* update_new(rdpRdp* rdp)
 	if (!update->queue)
 		goto fail;
 
+	up->windowOrders = window_order_cache_new();
+
+	if (!up->windowOrders)
+		goto fail;
+
 	return update;
 fail:
 	update_free(update);
@@ -2985,6 +3001,7 @@ void update_free(rdpUpdate* update)
 			free(update->window);
 		}
 
+		window_order_cache_free(update_cast(update)->windowOrders);
 		MessageQueue_Free(update->queue);
 		DeleteCriticalSection(&update->mux);
 		free(update);
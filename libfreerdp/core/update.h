@@ -38,6 +38,21 @@
 #define BITMAP_COMPRESSION 0x0001
 #define NO_BITMAP_COMPRESSION_HDR 0x0400
 
+typedef struct rdp_window_order_cache rdpWindowOrderCache;
+
+/* core private state of rdpUpdate, allocated by update_new */
+typedef struct
+{
+	rdpUpdate common;
+
+	rdpWindowOrderCache* windowOrders;
+} rdp_update_internal;
+
+static INLINE rdp_update_internal* update_cast(rdpUpdate* update)
+{
+	return (rdp_update_internal*)update;
+}
+
 FREERDP_LOCAL rdpUpdate* update_new(rdpRdp* rdp);
 FREERDP_LOCAL void update_free(rdpUpdate* update);
 FREERDP_LOCAL void update_reset_state(rdpUpdate* update);
@@ -702,6 +702,653 @@ static void dump_window_state_order(wLog* log, const char* msg, const WINDOW_ORD
 	WLog_Print(log, WLOG_DEBUG, buffer);
 }
 
+/* Window order header and icon flags, the remaining bits are window state fields */
+#define WINDOW_ORDER_HEADER_FLAGS                                                          \
+	(WINDOW_ORDER_TYPE_WINDOW | WINDOW_ORDER_TYPE_NOTIFY | WINDOW_ORDER_TYPE_DESKTOP |     \
+	 WINDOW_ORDER_STATE_NEW | WINDOW_ORDER_STATE_DELETED | WINDOW_ORDER_ICON |              \
+	 WINDOW_ORDER_CACHED_ICON | WINDOW_ORDER_FIELD_ICON_BIG | WINDOW_ORDER_FIELD_ICON_OVERLAY)
+
+/* Fields only the server changes, re-sends of the value known to the client are dropped.
+ * Geometry and show state are always passed on as the client changes them locally. */
+#define WINDOW_ORDER_CACHED_FIELDS                                                           \
+	(WINDOW_ORDER_FIELD_OWNER | WINDOW_ORDER_FIELD_STYLE | WINDOW_ORDER_FIELD_TITLE |        \
+	 WINDOW_ORDER_FIELD_RESIZE_MARGIN_X | WINDOW_ORDER_FIELD_RESIZE_MARGIN_Y |               \
+	 WINDOW_ORDER_FIELD_RP_CONTENT | WINDOW_ORDER_FIELD_ROOT_PARENT |                        \
+	 WINDOW_ORDER_FIELD_OVERLAY_DESCRIPTION | WINDOW_ORDER_FIELD_TASKBAR_BUTTON |            \
+	 WINDOW_ORDER_FIELD_ENFORCE_SERVER_ZORDER | WINDOW_ORDER_FIELD_APPBAR_STATE |            \
+	 WINDOW_ORDER_FIELD_APPBAR_EDGE)
+
+/* [MS-RDPERP] 2.2.1.2.3 Icon Info (TS_ICON_INFO), icons with this cacheId are not cached */
+#define WINDOW_ICON_NOT_CACHED 0xFF
+
+/* small, big and overlay icon of a window */
+#define WINDOW_ICON_SLOTS 3
+
+typedef struct
+{
+	BOOL valid;
+	UINT32 cacheEntry;
+	UINT32 cacheId;
+	UINT64 hash;
+} WINDOW_ICON_STATE;
+
+typedef struct
+{
+	UINT32 fieldFlags; /* of the icon or cached icon order, 0 if none */
+	ICON_INFO icon;
+	CACHED_ICON_INFO cachedIcon;
+} WINDOW_PENDING_ICON;
+
+typedef struct
+{
+	UINT32 windowId;
+
+	/* state delivered to the client */
+	UINT32 knownFields;
+	WINDOW_STATE_ORDER known;
+	WINDOW_ICON_STATE icons[WINDOW_ICON_SLOTS];
+
+	/* orders of the current batch */
+	BOOL queued;
+	UINT32 fieldFlags;
+	WINDOW_STATE_ORDER state;
+	WINDOW_PENDING_ICON pendingIcons[WINDOW_ICON_SLOTS];
+} WINDOW_CACHE_ENTRY;
+
+struct rdp_window_order_cache
+{
+	BOOL batch;
+
+	WINDOW_CACHE_ENTRY** entries;
+	size_t count;
+	size_t size;
+
+	/* entries with orders of the current batch, in the order they were received */
+	WINDOW_CACHE_ENTRY** queue;
+	size_t queued;
+};
+
+static size_t window_icon_slot(UINT32 fieldFlags)
+{
+	if (fieldFlags & WINDOW_ORDER_FIELD_ICON_OVERLAY)
+		return 2;
+
+	return (fieldFlags & WINDOW_ORDER_FIELD_ICON_BIG) ? 1 : 0;
+}
+
+static UINT64 window_icon_hash_update(UINT64 hash, const BYTE* data, size_t length)
+{
+	size_t i;
+
+	/* FNV-1a */
+	for (i = 0; i < length; i++)
+	{
+		hash ^= data[i];
+		hash *= 0x100000001B3ULL;
+	}
+
+	return hash;
+}
+
+static void window_icon_state(const ICON_INFO* iconInfo, WINDOW_ICON_STATE* state)
+{
+	const UINT32 header[] = { iconInfo->bpp,          iconInfo->width,
+		                      iconInfo->height,       iconInfo->cbColorTable,
+		                      iconInfo->cbBitsMask,   iconInfo->cbBitsColor };
+	UINT64 hash = 0xCBF29CE484222325ULL;
+
+	hash = window_icon_hash_update(hash, (const BYTE*)header, sizeof(header));
+
+	if (iconInfo->colorTable)
+		hash = window_icon_hash_update(hash, iconInfo->colorTable, iconInfo->cbColorTable);
+
+	if (iconInfo->bitsMask)
+		hash = window_icon_hash_update(hash, iconInfo->bitsMask, iconInfo->cbBitsMask);
+
+	if (iconInfo->bitsColor)
+		hash = window_icon_hash_update(hash, iconInfo->bitsColor, iconInfo->cbBitsColor);
+
+	state->valid = TRUE;
+	state->cacheEntry = iconInfo->cacheEntry;
+	state->cacheId = iconInfo->cacheId;
+	state->hash = hash;
+}
+
+static BOOL rail_string_equal(const RAIL_UNICODE_STRING* a, const RAIL_UNICODE_STRING* b)
+{
+	if (a->length != b->length)
+		return FALSE;
+
+	return (a->length == 0) || (memcmp(a->string, b->string, a->length) == 0);
+}
+
+static void rail_string_swap(RAIL_UNICODE_STRING* a, RAIL_UNICODE_STRING* b)
+{
+	const RAIL_UNICODE_STRING tmp = *a;
+	*a = *b;
+	*b = tmp;
+}
+
+static void window_rects_swap(UINT32* na, RECTANGLE_16** a, UINT32* nb, RECTANGLE_16** b)
+{
+	const UINT32 n = *na;
+	RECTANGLE_16* rects = *a;
+	*na = *nb;
+	*a = *b;
+	*nb = n;
+	*b = rects;
+}
+
+/* Moves the fields of src to dst, src keeps the replaced strings and rectangles of dst */
+static void window_state_merge(WINDOW_STATE_ORDER* dst, WINDOW_STATE_ORDER* src, UINT32 fields)
+{
+	if (fields & WINDOW_ORDER_FIELD_OWNER)
+		dst->ownerWindowId = src->ownerWindowId;
+
+	if (fields & WINDOW_ORDER_FIELD_STYLE)
+	{
+		dst->style = src->style;
+		dst->extendedStyle = src->extendedStyle;
+	}
+
+	if (fields & WINDOW_ORDER_FIELD_SHOW)
+		dst->showState = src->showState;
+
+	if (fields & WINDOW_ORDER_FIELD_TITLE)
+		rail_string_swap(&dst->titleInfo, &src->titleInfo);
+
+	if (fields & WINDOW_ORDER_FIELD_CLIENT_AREA_OFFSET)
+	{
+		dst->clientOffsetX = src->clientOffsetX;
+		dst->clientOffsetY = src->clientOffsetY;
+	}
+
+	if (fields & WINDOW_ORDER_FIELD_CLIENT_AREA_SIZE)
+	{
+		dst->clientAreaWidth = src->clientAreaWidth;
+		dst->clientAreaHeight = src->clientAreaHeight;
+	}
+
+	if (fields & WINDOW_ORDER_FIELD_RESIZE_MARGIN_X)
+	{
+		dst->resizeMarginLeft = src->resizeMarginLeft;
+		dst->resizeMarginRight = src->resizeMarginRight;
+	}
+
+	if (fields & WINDOW_ORDER_FIELD_RESIZE_MARGIN_Y)
+	{
+		dst->resizeMarginTop = src->resizeMarginTop;
+		dst->resizeMarginBottom = src->resizeMarginBottom;
+	}
+
+	if (fields & WINDOW_ORDER_FIELD_RP_CONTENT)
+		dst->RPContent = src->RPContent;
+
+	if (fields & WINDOW_ORDER_FIELD_ROOT_PARENT)
+		dst->rootParentHandle = src->rootParentHandle;
+
+	if (fields & WINDOW_ORDER_FIELD_WND_OFFSET)
+	{
+		dst->windowOffsetX = src->windowOffsetX;
+		dst->windowOffsetY = src->windowOffsetY;
+	}
+
+	if (fields & WINDOW_ORDER_FIELD_WND_CLIENT_DELTA)
+	{
+		dst->windowClientDeltaX = src->windowClientDeltaX;
+		dst->windowClientDeltaY = src->windowClientDeltaY;
+	}
+
+	if (fields & WINDOW_ORDER_FIELD_WND_SIZE)
+	{
+		dst->windowWidth = src->windowWidth;
+		dst->windowHeight = src->windowHeight;
+	}
+
+	if (fields & WINDOW_ORDER_FIELD_WND_RECTS)
+		window_rects_swap(&dst->numWindowRects, &dst->windowRects, &src->numWindowRects,
+		                  &src->windowRects);
+
+	if (fields & WINDOW_ORDER_FIELD_VIS_OFFSET)
+	{
+		dst->visibleOffsetX = src->visibleOffsetX;
+		dst->visibleOffsetY = src->visibleOffsetY;
+	}
+
+	if (fields & WINDOW_ORDER_FIELD_VISIBILITY)
+		window_rects_swap(&dst->numVisibilityRects, &dst->visibilityRects,
+		                  &src->numVisibilityRects, &src->visibilityRects);
+
+	if (fields & WINDOW_ORDER_FIELD_OVERLAY_DESCRIPTION)
+		rail_string_swap(&dst->OverlayDescription, &src->OverlayDescription);
+
+	if (fields & WINDOW_ORDER_FIELD_TASKBAR_BUTTON)
+		dst->TaskbarButton = src->TaskbarButton;
+
+	if (fields & WINDOW_ORDER_FIELD_ENFORCE_SERVER_ZORDER)
+		dst->EnforceServerZOrder = src->EnforceServerZOrder;
+
+	if (fields & WINDOW_ORDER_FIELD_APPBAR_STATE)
+		dst->AppBarState = src->AppBarState;
+
+	if (fields & WINDOW_ORDER_FIELD_APPBAR_EDGE)
+		dst->AppBarEdge = src->AppBarEdge;
+}
+
+/* Returns the fields of state the client already knows */
+static UINT32 window_state_unchanged(const WINDOW_CACHE_ENTRY* entry,
+                                     const WINDOW_STATE_ORDER* state, UINT32 fields)
+{
+	UINT32 unchanged = 0;
+	const WINDOW_STATE_ORDER* known = &entry->known;
+
+	fields &= entry->knownFields & WINDOW_ORDER_CACHED_FIELDS;
+
+	if ((fields & WINDOW_ORDER_FIELD_OWNER) && (known->ownerWindowId == state->ownerWindowId))
+		unchanged |= WINDOW_ORDER_FIELD_OWNER;
+
+	if ((fields & WINDOW_ORDER_FIELD_STYLE) && (known->style == state->style) &&
+	    (known->extendedStyle == state->extendedStyle))
+		unchanged |= WINDOW_ORDER_FIELD_STYLE;
+
+	if ((fields & WINDOW_ORDER_FIELD_TITLE) &&
+	    rail_string_equal(&known->titleInfo, &state->titleInfo))
+		unchanged |= WINDOW_ORDER_FIELD_TITLE;
+
+	if ((fields & WINDOW_ORDER_FIELD_RESIZE_MARGIN_X) &&
+	    (known->resizeMarginLeft == state->resizeMarginLeft) &&
+	    (known->resizeMarginRight == state->resizeMarginRight))
+		unchanged |= WINDOW_ORDER_FIELD_RESIZE_MARGIN_X;
+
+	if ((fields & WINDOW_ORDER_FIELD_RESIZE_MARGIN_Y) &&
+	    (known->resizeMarginTop == state->resizeMarginTop) &&
+	    (known->resizeMarginBottom == state->resizeMarginBottom))
+		unchanged |= WINDOW_ORDER_FIELD_RESIZE_MARGIN_Y;
+
+	if ((fields & WINDOW_ORDER_FIELD_RP_CONTENT) && (known->RPContent == state->RPContent))
+		unchanged |= WINDOW_ORDER_FIELD_RP_CONTENT;
+
+	if ((fields & WINDOW_ORDER_FIELD_ROOT_PARENT) &&
+	    (known->rootParentHandle == state->rootParentHandle))
+		unchanged |= WINDOW_ORDER_FIELD_ROOT_PARENT;
+
+	if ((fields & WINDOW_ORDER_FIELD_OVERLAY_DESCRIPTION) &&
+	    rail_string_equal(&known->OverlayDescription, &state->OverlayDescription))
+		unchanged |= WINDOW_ORDER_FIELD_OVERLAY_DESCRIPTION;
+
+	if ((fields & WINDOW_ORDER_FIELD_TASKBAR_BUTTON) &&
+	    (known->TaskbarButton == state->TaskbarButton))
+		unchanged |= WINDOW_ORDER_FIELD_TASKBAR_BUTTON;
+
+	if ((fields & WINDOW_ORDER_FIELD_ENFORCE_SERVER_ZORDER) &&
+	    (known->EnforceServerZOrder == state->EnforceServerZOrder))
+		unchanged |= WINDOW_ORDER_FIELD_ENFORCE_SERVER_ZORDER;
+
+	if ((fields & WINDOW_ORDER_FIELD_APPBAR_STATE) && (known->AppBarState == state->AppBarState))
+		unchanged |= WINDOW_ORDER_FIELD_APPBAR_STATE;
+
+	if ((fields & WINDOW_ORDER_FIELD_APPBAR_EDGE) && (known->AppBarEdge == state->AppBarEdge))
+		unchanged |= WINDOW_ORDER_FIELD_APPBAR_EDGE;
+
+	return unchanged;
+}
+
+static void window_cache_entry_clear(WINDOW_CACHE_ENTRY* entry)
+{
+	size_t i;
+
+	for (i = 0; i < WINDOW_ICON_SLOTS; i++)
+	{
+		update_free_window_icon_info(&entry->pendingIcons[i].icon);
+		ZeroMemory(&entry->pendingIcons[i], sizeof(WINDOW_PENDING_ICON));
+	}
+
+	update_free_window_state(&entry->state);
+	entry->fieldFlags = 0;
+	entry->queued = FALSE;
+}
+
+static void window_cache_entry_forget(WINDOW_CACHE_ENTRY* entry)
+{
+	update_free_window_state(&entry->known);
+	entry->knownFields = 0;
+	ZeroMemory(entry->icons, sizeof(entry->icons));
+}
+
+static void window_cache_entry_free(WINDOW_CACHE_ENTRY* entry)
+{
+	if (!entry)
+		return;
+
+	window_cache_entry_clear(entry);
+	window_cache_entry_forget(entry);
+	free(entry);
+}
+
+static WINDOW_CACHE_ENTRY* window_cache_get(rdpWindowOrderCache* cache, UINT32 windowId)
+{
+	size_t i;
+	WINDOW_CACHE_ENTRY* entry;
+
+	for (i = 0; i < cache->count; i++)
+	{
+		if (cache->entries[i]->windowId == windowId)
+			return cache->entries[i];
+	}
+
+	if (cache->count == cache->size)
+	{
+		const size_t size = MAX(16, cache->size * 2);
+		WINDOW_CACHE_ENTRY** entries =
+		    (WINDOW_CACHE_ENTRY**)realloc(cache->entries, size * sizeof(WINDOW_CACHE_ENTRY*));
+		WINDOW_CACHE_ENTRY** queue;
+
+		if (!entries)
+			return NULL;
+
+		cache->entries = entries;
+		queue = (WINDOW_CACHE_ENTRY**)realloc(cache->queue, size * sizeof(WINDOW_CACHE_ENTRY*));
+
+		if (!queue)
+			return NULL;
+
+		cache->queue = queue;
+		cache->size = size;
+	}
+
+	entry = (WINDOW_CACHE_ENTRY*)calloc(1, sizeof(WINDOW_CACHE_ENTRY));
+
+	if (!entry)
+		return NULL;
+
+	entry->windowId = windowId;
+	cache->entries[cache->count++] = entry;
+	return entry;
+}
+
+static void window_cache_remove(rdpWindowOrderCache* cache, UINT32 windowId)
+{
+	size_t i;
+
+	for (i = 0; i < cache->count; i++)
+	{
+		WINDOW_CACHE_ENTRY* entry = cache->entries[i];
+
+		if (entry->windowId != windowId)
+			continue;
+
+		cache->entries[i] = cache->entries[--cache->count];
+		window_cache_entry_free(entry);
+		return;
+	}
+}
+
+static void window_cache_queue(rdpWindowOrderCache* cache, WINDOW_CACHE_ENTRY* entry)
+{
+	/* the queue has room for every entry */
+	if (!entry->queued)
+	{
+		cache->queue[cache->queued++] = entry;
+		entry->queued = TRUE;
+	}
+}
+
+/* An icon order overwrites the client icon cache entry, other windows showing the
+ * former icon of that entry have to get the next one */
+static void window_cache_icon_stored(rdpWindowOrderCache* cache, const ICON_INFO* iconInfo)
+{
+	size_t i, j;
+
+	if (iconInfo->cacheId == WINDOW_ICON_NOT_CACHED)
+		return;
+
+	for (i = 0; i < cache->count; i++)
+	{
+		for (j = 0; j < WINDOW_ICON_SLOTS; j++)
+		{
+			WINDOW_ICON_STATE* icon = &cache->entries[i]->icons[j];
+
+			if ((icon->cacheId == iconInfo->cacheId) && (icon->cacheEntry == iconInfo->cacheEntry))
+				icon->valid = FALSE;
+		}
+	}
+}
+
+static BOOL window_cache_deliver_icon(rdpUpdate* update, WINDOW_CACHE_ENTRY* entry,
+                                      size_t slot)
+{
+	BOOL result = TRUE;
+	rdpContext* context = update->context;
+	rdpWindowUpdate* window = update->window;
+	WINDOW_PENDING_ICON* pending = &entry->pendingIcons[slot];
+	WINDOW_ICON_STATE* known = &entry->icons[slot];
+	WINDOW_ORDER_INFO orderInfo = { 0 };
+
+	orderInfo.windowId = entry->windowId;
+	orderInfo.fieldFlags = pending->fieldFlags;
+
+	if (pending->fieldFlags & WINDOW_ORDER_ICON)
+	{
+		WINDOW_ICON_STATE state;
+		WINDOW_ICON_ORDER window_icon = { 0 };
+
+		window_icon_state(&pending->icon, &state);
+
+		if (!(pending->fieldFlags & WINDOW_ORDER_STATE_NEW) && known->valid &&
+		    (known->cacheId == state.cacheId) && (known->cacheEntry == state.cacheEntry) &&
+		    (known->hash == state.hash))
+		{
+			WLog_Print(update->log, WLOG_DEBUG, "WindowIcon windowId=0x%" PRIx32 " unchanged",
+			           orderInfo.windowId);
+			return TRUE;
+		}
+
+		window_icon.iconInfo = &pending->icon;
+		WLog_Print(update->log, WLOG_DEBUG, "WindowIcon windowId=0x%" PRIx32 "",
+		           orderInfo.windowId);
+		IFCALLRET(window->WindowIcon, result, context, &orderInfo, &window_icon);
+		window_cache_icon_stored(update_cast(update)->windowOrders, &pending->icon);
+		*known = state;
+	}
+	else if (pending->fieldFlags & WINDOW_ORDER_CACHED_ICON)
+	{
+		WINDOW_CACHED_ICON_ORDER window_cached_icon = { 0 };
+
+		window_cached_icon.cachedIcon = pending->cachedIcon;
+		WLog_Print(update->log, WLOG_DEBUG, "WindowCachedIcon windowId=0x%" PRIx32 "",
+		           orderInfo.windowId);
+		IFCALLRET(window->WindowCachedIcon, result, context, &orderInfo, &window_cached_icon);
+		known->valid = FALSE;
+	}
+
+	return result;
+}
+
+static BOOL window_cache_deliver(rdpUpdate* update, WINDOW_CACHE_ENTRY* entry)
+{
+	size_t i;
+	BOOL result = TRUE;
+	rdpContext* context = update->context;
+	rdpWindowUpdate* window = update->window;
+	const BOOL create = (entry->fieldFlags & WINDOW_ORDER_STATE_NEW) != 0;
+	UINT32 fields = entry->fieldFlags & ~WINDOW_ORDER_HEADER_FLAGS;
+	WINDOW_ORDER_INFO orderInfo = { 0 };
+
+	orderInfo.windowId = entry->windowId;
+
+	if (create)
+		window_cache_entry_forget(entry);
+	else
+		fields &= ~window_state_unchanged(entry, &entry->state, fields);
+
+	if (create || (fields != 0))
+	{
+		orderInfo.fieldFlags = WINDOW_ORDER_TYPE_WINDOW | fields;
+
+		if (create)
+		{
+			orderInfo.fieldFlags |= WINDOW_ORDER_STATE_NEW;
+			dump_window_state_order(update->log, "WindowCreate", &orderInfo, &entry->state);
+			IFCALLRET(window->WindowCreate, result, context, &orderInfo, &entry->state);
+		}
+		else
+		{
+			dump_window_state_order(update->log, "WindowUpdate", &orderInfo, &entry->state);
+			IFCALLRET(window->WindowUpdate, result, context, &orderInfo, &entry->state);
+		}
+
+		if (fields & WINDOW_ORDER_FIELD_ICON_OVERLAY_NULL)
+			entry->icons[window_icon_slot(WINDOW_ORDER_FIELD_ICON_OVERLAY)].valid = FALSE;
+
+		window_state_merge(&entry->known, &entry->state, fields & WINDOW_ORDER_CACHED_FIELDS);
+		entry->knownFields |= fields & WINDOW_ORDER_CACHED_FIELDS;
+	}
+
+	for (i = 0; result && (i < WINDOW_ICON_SLOTS); i++)
+		result = window_cache_deliver_icon(update, entry, i);
+
+	return result;
+}
+
+static BOOL window_cache_flush(rdpUpdate* update, BOOL deliver)
+{
+	size_t i;
+	BOOL result = TRUE;
+	rdpWindowOrderCache* cache = update_cast(update)->windowOrders;
+
+	for (i = 0; i < cache->queued; i++)
+	{
+		WINDOW_CACHE_ENTRY* entry = cache->queue[i];
+
+		if (deliver && result)
+			result = window_cache_deliver(update, entry);
+
+		window_cache_entry_clear(entry);
+	}
+
+	cache->queued = 0;
+	return result;
+}
+
+/* Orders outside of a batch are delivered right away */
+static BOOL window_cache_queued(rdpUpdate* update)
+{
+	if (update_cast(update)->windowOrders->batch)
+		return TRUE;
+
+	return window_cache_flush(update, TRUE);
+}
+
+static BOOL window_cache_state_order(rdpUpdate* update, const WINDOW_ORDER_INFO* orderInfo,
+                                     WINDOW_STATE_ORDER* windowState)
+{
+	rdpWindowOrderCache* cache = update_cast(update)->windowOrders;
+	const UINT32 fields = orderInfo->fieldFlags & ~WINDOW_ORDER_HEADER_FLAGS;
+	WINDOW_CACHE_ENTRY* entry = window_cache_get(cache, orderInfo->windowId);
+
+	if (!entry)
+		return FALSE;
+
+	/* A new window with the same id or an overlay reset after a pending overlay icon
+	 * can not be merged */
+	if (entry->queued &&
+	    ((orderInfo->fieldFlags & WINDOW_ORDER_STATE_NEW) ||
+	     ((fields & WINDOW_ORDER_FIELD_ICON_OVERLAY_NULL) &&
+	      entry->pendingIcons[window_icon_slot(WINDOW_ORDER_FIELD_ICON_OVERLAY)].fieldFlags)))
+	{
+		if (!window_cache_flush(update, TRUE))
+			return FALSE;
+	}
+
+	window_state_merge(&entry->state, windowState, fields);
+	entry->fieldFlags |= fields | (orderInfo->fieldFlags & WINDOW_ORDER_STATE_NEW);
+	window_cache_queue(cache, entry);
+	return window_cache_queued(update);
+}
+
+static BOOL window_cache_icon_order(rdpUpdate* update, const WINDOW_ORDER_INFO* orderInfo,
+                                    ICON_INFO* iconInfo, const CACHED_ICON_INFO* cachedIcon)
+{
+	WINDOW_PENDING_ICON* pending;
+	rdpWindowOrderCache* cache = update_cast(update)->windowOrders;
+	WINDOW_CACHE_ENTRY* entry = window_cache_get(cache, orderInfo->windowId);
+
+	if (!entry)
+		return FALSE;
+
+	pending = &entry->pendingIcons[window_icon_slot(orderInfo->fieldFlags)];
+
+	/* Only the last icon is shown, but an icon stored in the client icon cache or one
+	 * replacing all icons of the window has to be delivered */
+	if ((pending->fieldFlags & WINDOW_ORDER_STATE_NEW) ||
+	    ((pending->fieldFlags & WINDOW_ORDER_ICON) &&
+	     (pending->icon.cacheId != WINDOW_ICON_NOT_CACHED)))
+	{
+		if (!window_cache_flush(update, TRUE))
+			return FALSE;
+	}
+
+	update_free_window_icon_info(&pending->icon);
+	ZeroMemory(pending, sizeof(WINDOW_PENDING_ICON));
+	pending->fieldFlags = orderInfo->fieldFlags;
+
+	if (iconInfo)
+	{
+		pending->icon = *iconInfo;
+		ZeroMemory(iconInfo, sizeof(ICON_INFO));
+	}
+	else
+		pending->cachedIcon = *cachedIcon;
+
+	window_cache_queue(cache, entry);
+	return window_cache_queued(update);
+}
+
+rdpWindowOrderCache* window_order_cache_new(void)
+{
+	return (rdpWindowOrderCache*)calloc(1, sizeof(rdpWindowOrderCache));
+}
+
+void window_order_cache_reset(rdpWindowOrderCache* cache)
+{
+	size_t i;
+
+	if (!cache)
+		return;
+
+	for (i = 0; i < cache->count; i++)
+		window_cache_entry_free(cache->entries[i]);
+
+	cache->count = 0;
+	cache->queued = 0;
+}
+
+void window_order_cache_free(rdpWindowOrderCache* cache)
+{
+	if (!cache)
+		return;
+
+	window_order_cache_reset(cache);
+	free(cache->entries);
+	free(cache->queue);
+	free(cache);
+}
+
+void update_begin_window_orders(rdpUpdate* update)
+{
+	if (update && update_cast(update)->windowOrders)
+		update_cast(update)->windowOrders->batch = TRUE;
+}
+
+BOOL update_end_window_orders(rdpUpdate* update, BOOL deliver)
+{
+	if (!update || !update_cast(update)->windowOrders)
+		return FALSE;
+
+	update_cast(update)->windowOrders->batch = FALSE;
+	return window_cache_flush(update, deliver);
+}
+
 static BOOL update_recv_window_info_order(rdpUpdate* update, wStream* s,
                                           WINDOW_ORDER_INFO* orderInfo)
 {
@@ -720,11 +1367,7 @@ static BOOL update_recv_window_info_order(rdpUpdate* update, wStream* s,
 		result = update_read_window_icon_order(s, orderInfo, &window_icon);
 
 		if (result)
-		{
-			WLog_Print(update->log, WLOG_DEBUG, "WindowIcon windowId=0x%" PRIx32 "",
-			           orderInfo->windowId);
-			IFCALLRET(window->WindowIcon, result, context, orderInfo, &window_icon);
-		}
+			result = window_cache_icon_order(update, orderInfo, window_icon.iconInfo, NULL);
 
 		update_free_window_icon_info(window_icon.iconInfo);
 		free(window_icon.iconInfo);
@@ -735,15 +1378,17 @@ static BOOL update_recv_window_info_order(rdpUpdate* update, wStream* s,
 		result = update_read_window_cached_icon_order(s, orderInfo, &window_cached_icon);
 
 		if (result)
-		{
-			WLog_Print(update->log, WLOG_DEBUG, "WindowCachedIcon windowId=0x%" PRIx32 "",
-			           orderInfo->windowId);
-			IFCALLRET(window->WindowCachedIcon, result, context, orderInfo, &window_cached_icon);
-		}
+			result = window_cache_icon_order(update, orderInfo, NULL,
+			                                 &window_cached_icon.cachedIcon);
 	}
 	else if (orderInfo->fieldFlags & WINDOW_ORDER_STATE_DELETED)
 	{
 		update_read_window_delete_order(s, orderInfo);
+
+		if (!window_cache_flush(update, TRUE))
+			return FALSE;
+
+		window_cache_remove(update_cast(update)->windowOrders, orderInfo->windowId);
 		WLog_Print(update->log, WLOG_DEBUG, "WindowDelete windowId=0x%" PRIx32 "",
 		           orderInfo->windowId);
 		IFCALLRET(window->WindowDelete, result, context, orderInfo);
@@ -754,20 +1399,9 @@ static BOOL update_recv_window_info_order(rdpUpdate* update, wStream* s,
 		result = update_read_window_state_order(s, orderInfo, &windowState);
 
 		if (result)
-		{
-			if (orderInfo->fieldFlags & WINDOW_ORDER_STATE_NEW)
-			{
-				dump_window_state_order(update->log, "WindowCreate", orderInfo, &windowState);
-				IFCALLRET(window->WindowCreate, result, context, orderInfo, &windowState);
-			}
-			else
-			{
-				dump_window_state_order(update->log, "WindowUpdate", orderInfo, &windowState);
-				IFCALLRET(window->WindowUpdate, result, context, orderInfo, &windowState);
-			}
+			result = window_cache_state_order(update, orderInfo, &windowState);
 
-			update_free_window_state(&windowState);
-		}
+		update_free_window_state(&windowState);
 	}
 
 	return result;
@@ -849,6 +1483,10 @@ static BOOL update_recv_notification_icon_info_order(rdpUpdate* update, wStream*
 	Stream_Read_UINT32(s, orderInfo->windowId);     /* windowId (4 bytes) */
 	Stream_Read_UINT32(s, orderInfo->notifyIconId); /* notifyIconId (4 bytes) */
 
+	/* Notification icons are not merged, the window orders before them are delivered first */
+	if (!window_cache_flush(update, TRUE))
+		return FALSE;
+
 	if (orderInfo->fieldFlags & WINDOW_ORDER_STATE_DELETED)
 	{
 		update_read_notification_icon_delete_order(s, orderInfo);
@@ -863,6 +1501,9 @@ static BOOL update_recv_notification_icon_info_order(rdpUpdate* update, wStream*
 		if (!result)
 			goto fail;
 
+		if (orderInfo->fieldFlags & WINDOW_ORDER_ICON)
+			window_cache_icon_stored(update_cast(update)->windowOrders, &notify_icon_state.icon);
+
 		if (orderInfo->fieldFlags & WINDOW_ORDER_STATE_NEW)
 		{
 			WLog_Print(update->log, WLOG_DEBUG, "NotifyIconCreate");
@@ -968,6 +1609,10 @@ static BOOL update_recv_desktop_info_order(rdpUpdate* update, wStream* s,
 	rdpWindowUpdate* window = update->window;
 	BOOL result = TRUE;
 
+	/* The desktop order refers to the windows of the orders before it */
+	if (!window_cache_flush(update, TRUE))
+		return FALSE;
+
 	if (orderInfo->fieldFlags & WINDOW_ORDER_FIELD_DESKTOP_NONE)
 	{
 		update_read_desktop_non_monitored_order(s, orderInfo);
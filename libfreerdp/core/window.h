@@ -30,6 +30,15 @@
 FREERDP_LOCAL BOOL update_recv_altsec_window_order(rdpUpdate* update, wStream* s);
 FREERDP_LOCAL void update_free_window_state(WINDOW_STATE_ORDER* window_state);
 
+/* Window orders received between update_begin_window_orders and update_end_window_orders
+ * are merged per window and delivered by update_end_window_orders. */
+FREERDP_LOCAL rdpWindowOrderCache* window_order_cache_new(void);
+FREERDP_LOCAL void window_order_cache_free(rdpWindowOrderCache* cache);
+FREERDP_LOCAL void window_order_cache_reset(rdpWindowOrderCache* cache);
+
+FREERDP_LOCAL void update_begin_window_orders(rdpUpdate* update);
+FREERDP_LOCAL BOOL update_end_window_orders(rdpUpdate* update, BOOL deliver);
+
 #define WND_TAG FREERDP_TAG("core.wnd")
 #ifdef WITH_DEBUG_WND
 #define DEBUG_WND(...) WLog_DBG(WND_TAG, __VA_ARGS__)
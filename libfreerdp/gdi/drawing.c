@@ -124,6 +124,38 @@ INT32 gdi_SetBkMode(HGDI_DC hdc, INT32 iBkMode)
 	return TRUE;
 }
 
+/**
+ * Get the current polygon fill mode.\n
+ * @msdn{dd144866}
+ * @param hdc device context
+ * @return polygon fill mode
+ */
+
+INT32 gdi_GetPolyFillMode(HGDI_DC hdc)
+{
+	return (hdc->polyFillMode == GDI_FILL_WINDING) ? GDI_FILL_WINDING : GDI_FILL_ALTERNATE;
+}
+
+/**
+ * Set the current polygon fill mode.\n
+ * @msdn{dd145040}
+ * @param hdc device context
+ * @param iMode polygon fill mode
+ * @return previous polygon fill mode on success, 0 on failure
+ */
+
+INT32 gdi_SetPolyFillMode(HGDI_DC hdc, INT32 iMode)
+{
+	if (iMode == GDI_FILL_ALTERNATE || iMode == GDI_FILL_WINDING)
+	{
+		INT32 previousMode = gdi_GetPolyFillMode(hdc);
+		hdc->polyFillMode = iMode;
+		return previousMode;
+	}
+
+	return 0;
+}
+
 /**
  * Set the current text color.\n
  * @msdn{dd145093}
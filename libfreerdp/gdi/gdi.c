@@ -44,6 +44,7 @@
 #include "brush.h"
 #include "line.h"
 #include "gdi.h"
+#include "graphics.h"
 #include "../core/graphics.h"
 
 #define TAG FREERDP_TAG("gdi")
@@ -944,28 +945,272 @@ out_fail:
 	return ret;
 }
 
+/**
+ * Create the brush of a polygon or ellipse order. Hatched and monochrome brushes are kept as
+ * PIXEL_FORMAT_MONO with a byte per pixel, so a transparent background can be skipped.
+ * data must hold 8 * 8 * 4 bytes and back the pattern bitmap until the brush is deleted.
+ */
+static HGDI_BRUSH gdi_create_order_brush(rdpContext* context, const rdpBrush* brush,
+                                         UINT32 foreColor, BYTE* data, HGDI_BITMAP* phBmp)
+{
+	UINT32 x, y;
+	HGDI_BRUSH hbrush = NULL;
+	const BYTE* monoBits = NULL;
+	rdpGdi* gdi = context->gdi;
+
+	*phBmp = NULL;
+
+	switch (brush->style)
+	{
+		case GDI_BS_SOLID:
+			hbrush = gdi_CreateSolidBrush(foreColor);
+			break;
+
+		case GDI_BS_HATCHED:
+			if (brush->hatch >= sizeof(GDI_BS_HATCHED_PATTERNS) / 8)
+				return NULL;
+
+			monoBits = GDI_BS_HATCHED_PATTERNS + (8 * brush->hatch);
+			break;
+
+		case GDI_BS_PATTERN:
+			if (brush->bpp > 1)
+			{
+				UINT32 bpp = brush->bpp;
+
+				if ((bpp == 16) && (context->settings->ColorDepth == 15))
+					bpp = 15;
+
+				if (!freerdp_image_copy(data, gdi->drawing->hdc->format, 0, 0, 0, 8, 8,
+				                        brush->data, gdi_get_pixel_format(bpp), 0, 0, 0,
+				                        &gdi->palette, FREERDP_FLIP_NONE))
+					return NULL;
+
+				*phBmp = gdi_CreateBitmapEx(8, 8, gdi->drawing->hdc->format, 0, data, NULL);
+
+				if (*phBmp)
+					hbrush = gdi_CreatePatternBrush(*phBmp);
+			}
+			else
+				monoBits = brush->data;
+
+			break;
+
+		default:
+			WLog_ERR(TAG, "unimplemented brush style:%" PRIu32 "", brush->style);
+			return NULL;
+	}
+
+	if (monoBits)
+	{
+		/* A set bit selects the background color, as for PatBlt */
+		for (y = 0; y < 8; y++)
+		{
+			for (x = 0; x < 8; x++)
+				data[y * 8 + x] = (monoBits[y] & (0x80 >> x)) ? 0 : 1;
+		}
+
+		*phBmp = gdi_CreateBitmapEx(8, 8, PIXEL_FORMAT_MONO, 0, data, NULL);
+
+		if (*phBmp)
+			hbrush = (brush->style == GDI_BS_HATCHED) ? gdi_CreateHatchBrush(*phBmp)
+			                                          : gdi_CreatePatternBrush(*phBmp);
+	}
+
+	if (hbrush)
+	{
+		hbrush->nXOrg = brush->x;
+		hbrush->nYOrg = brush->y;
+	}
+
+	return hbrush;
+}
+
+/* Fill the polygon of an order with hbrush, the points are given as deltas to the start */
+static BOOL gdi_fill_order_polygon(rdpGdi* gdi, INT32 xStart, INT32 yStart,
+                                   const DELTA_POINT* deltas, UINT32 numPoints, UINT32 bRop2,
+                                   UINT32 fillMode, HGDI_BRUSH hbrush)
+{
+	UINT32 i;
+	BOOL ret;
+	INT32 rop2, mode;
+	HGDI_BRUSH originalBrush;
+	HGDI_DC hdc = gdi->drawing->hdc;
+	GDI_POINT* points = calloc(numPoints + 1, sizeof(GDI_POINT));
+
+	if (!points)
+		return FALSE;
+
+	points[0].x = xStart;
+	points[0].y = yStart;
+
+	for (i = 0; i < numPoints; i++)
+	{
+		points[i + 1].x = points[i].x + deltas[i].x;
+		points[i + 1].y = points[i].y + deltas[i].y;
+	}
+
+	originalBrush = hdc->brush;
+	hdc->brush = hbrush;
+	rop2 = gdi_SetROP2(hdc, bRop2);
+	mode = gdi_SetPolyFillMode(hdc, fillMode);
+	ret = gdi_Polygon(hdc, points, numPoints + 1);
+	gdi_SetPolyFillMode(hdc, mode);
+	gdi_SetROP2(hdc, rop2);
+	hdc->brush = originalBrush;
+	free(points);
+	return ret;
+}
+
 static BOOL gdi_polygon_sc(rdpContext* context, const POLYGON_SC_ORDER* polygon_sc)
 {
-	WLog_WARN(TAG, "%s: not implemented", __FUNCTION__);
-	return FALSE;
+	UINT32 brushColor;
+	HGDI_BRUSH hbrush;
+	BOOL ret;
+	rdpGdi* gdi = context->gdi;
+
+	if (!gdi_decode_color(gdi, polygon_sc->brushColor, &brushColor, NULL))
+		return FALSE;
+
+	if (!(hbrush = gdi_CreateSolidBrush(brushColor)))
+		return FALSE;
+
+	ret = gdi_fill_order_polygon(gdi, polygon_sc->xStart, polygon_sc->yStart, polygon_sc->points,
+	                             polygon_sc->numPoints, polygon_sc->bRop2, polygon_sc->fillMode,
+	                             hbrush);
+	gdi_DeleteObject((HGDIOBJECT)hbrush);
+	return ret;
 }
 
 static BOOL gdi_polygon_cb(rdpContext* context, POLYGON_CB_ORDER* polygon_cb)
 {
-	WLog_WARN(TAG, "%s: not implemented", __FUNCTION__);
-	return FALSE;
+	UINT32 foreColor;
+	UINT32 backColor;
+	UINT32 originalColor;
+	UINT32 originalBkColor;
+	INT32 originalBkMode;
+	HGDI_BRUSH hbrush;
+	HGDI_BITMAP hBmp = NULL;
+	BYTE data[8 * 8 * 4];
+	BOOL ret = FALSE;
+	rdpGdi* gdi = context->gdi;
+	HGDI_DC hdc = gdi->drawing->hdc;
+
+	if (!gdi_decode_color(gdi, polygon_cb->foreColor, &foreColor, NULL))
+		return FALSE;
+
+	if (!gdi_decode_color(gdi, polygon_cb->backColor, &backColor, NULL))
+		return FALSE;
+
+	hbrush = gdi_create_order_brush(context, &polygon_cb->brush, foreColor, data, &hBmp);
+
+	if (!hbrush)
+		goto out_fail;
+
+	originalColor = gdi_SetTextColor(hdc, foreColor);
+	originalBkColor = gdi_SetBkColor(hdc, backColor);
+	originalBkMode = hdc->bkMode;
+	gdi_SetBkMode(hdc, (polygon_cb->backMode == BACKMODE_TRANSPARENT) ? GDI_TRANSPARENT
+	                                                                   : GDI_OPAQUE);
+	ret = gdi_fill_order_polygon(gdi, polygon_cb->xStart, polygon_cb->yStart, polygon_cb->points,
+	                             polygon_cb->numPoints, polygon_cb->bRop2, polygon_cb->fillMode,
+	                             hbrush);
+	hdc->bkMode = originalBkMode;
+	gdi_SetBkColor(hdc, originalBkColor);
+	gdi_SetTextColor(hdc, originalColor);
+out_fail:
+	gdi_DeleteObject((HGDIOBJECT)hbrush);
+	gdi_DeleteObject((HGDIOBJECT)hBmp);
+	return ret;
+}
+
+/* Draw the ellipse of an order, a NULL pen fills the outline with the brush as well */
+static BOOL gdi_draw_order_ellipse(rdpGdi* gdi, INT32 left, INT32 top, INT32 right, INT32 bottom,
+                                   UINT32 bRop2, HGDI_PEN hpen, HGDI_BRUSH hbrush)
+{
+	BOOL ret;
+	INT32 rop2;
+	HGDI_DC hdc = gdi->drawing->hdc;
+	HGDI_PEN originalPen = hdc->pen;
+	HGDI_BRUSH originalBrush = hdc->brush;
+
+	hdc->pen = hpen;
+	hdc->brush = hbrush;
+	rop2 = gdi_SetROP2(hdc, bRop2);
+	ret = gdi_Ellipse(hdc, left, top, right, bottom);
+	gdi_SetROP2(hdc, rop2);
+	hdc->brush = originalBrush;
+	hdc->pen = originalPen;
+	return ret;
 }
 
 static BOOL gdi_ellipse_sc(rdpContext* context, const ELLIPSE_SC_ORDER* ellipse_sc)
 {
-	WLog_WARN(TAG, "%s: not implemented", __FUNCTION__);
-	return FALSE;
+	UINT32 color;
+	BOOL ret;
+	HGDI_PEN hpen = NULL;
+	HGDI_BRUSH hbrush = NULL;
+	rdpGdi* gdi = context->gdi;
+
+	if (!gdi_decode_color(gdi, ellipse_sc->color, &color, NULL))
+		return FALSE;
+
+	/* A fill mode of zero draws the outline only */
+	if (ellipse_sc->fillMode == 0)
+		hpen = gdi_CreatePen(GDI_PS_SOLID, 1, color, gdi->drawing->hdc->format, &gdi->palette);
+	else
+		hbrush = gdi_CreateSolidBrush(color);
+
+	if (!hpen && !hbrush)
+		return FALSE;
+
+	ret = gdi_draw_order_ellipse(gdi, ellipse_sc->leftRect, ellipse_sc->topRect,
+	                             ellipse_sc->rightRect, ellipse_sc->bottomRect, ellipse_sc->bRop2,
+	                             hpen, hbrush);
+	gdi_DeleteObject((HGDIOBJECT)hpen);
+	gdi_DeleteObject((HGDIOBJECT)hbrush);
+	return ret;
 }
 
 static BOOL gdi_ellipse_cb(rdpContext* context, const ELLIPSE_CB_ORDER* ellipse_cb)
 {
-	WLog_WARN(TAG, "%s: not implemented", __FUNCTION__);
-	return FALSE;
+	UINT32 foreColor;
+	UINT32 backColor;
+	UINT32 originalColor;
+	UINT32 originalBkColor;
+	INT32 originalBkMode;
+	HGDI_BRUSH hbrush;
+	HGDI_BITMAP hBmp = NULL;
+	BYTE data[8 * 8 * 4];
+	BOOL ret = FALSE;
+	rdpGdi* gdi = context->gdi;
+	HGDI_DC hdc = gdi->drawing->hdc;
+
+	if (!gdi_decode_color(gdi, ellipse_cb->foreColor, &foreColor, NULL))
+		return FALSE;
+
+	if (!gdi_decode_color(gdi, ellipse_cb->backColor, &backColor, NULL))
+		return FALSE;
+
+	hbrush = gdi_create_order_brush(context, &ellipse_cb->brush, foreColor, data, &hBmp);
+
+	if (!hbrush)
+		goto out_fail;
+
+	originalColor = gdi_SetTextColor(hdc, foreColor);
+	originalBkColor = gdi_SetBkColor(hdc, backColor);
+	originalBkMode = hdc->bkMode;
+	gdi_SetBkMode(hdc, GDI_OPAQUE);
+	ret = gdi_draw_order_ellipse(gdi, ellipse_cb->leftRect, ellipse_cb->topRect,
+	                             ellipse_cb->rightRect, ellipse_cb->bottomRect, ellipse_cb->bRop2,
+	                             NULL, hbrush);
+	hdc->bkMode = originalBkMode;
+	gdi_SetBkColor(hdc, originalBkColor);
+	gdi_SetTextColor(hdc, originalColor);
+out_fail:
+	gdi_DeleteObject((HGDIOBJECT)hbrush);
+	gdi_DeleteObject((HGDIOBJECT)hBmp);
+	return ret;
 }
 
 static BOOL gdi_frame_marker(rdpContext* context, const FRAME_MARKER_ORDER* frameMarker)
@@ -1329,6 +1574,7 @@ void gdi_free(freerdp* instance)
 	{
 		gdi_bitmap_free_ex(gdi->primary);
 		gdi_DeleteDC(gdi->hdc);
+		gdi_glyph_run_free(gdi->glyphRun);
 		free(gdi);
 	}
 
@@ -379,7 +379,7 @@ static UINT gdi_SurfaceCommand_RemoteFX(rdpGdi* gdi, RdpgfxClientContext* contex
 	gdiGfxSurface* surface;
 	REGION16 invalidRegion;
 	const RECTANGLE_16* rects;
-	UINT32 nrRects, x;
+	UINT32 nrRects;
 	WINPR_ASSERT(gdi);
 	WINPR_ASSERT(context);
 	WINPR_ASSERT(cmd);
@@ -411,8 +411,7 @@ static UINT gdi_SurfaceCommand_RemoteFX(rdpGdi* gdi, RdpgfxClientContext* contex
 	if (status != CHANNEL_RC_OK)
 		goto fail;
 
-	for (x = 0; x < nrRects; x++)
-		region16_union_rect(&surface->invalidRegion, &surface->invalidRegion, &rects[x]);
+	region16_union_region(&surface->invalidRegion, &surface->invalidRegion, &invalidRegion);
 
 	if (!gdi->inGfxFrame)
 	{
@@ -597,11 +596,8 @@ static UINT gdi_SurfaceCommand_AVC420(rdpGdi* gdi, RdpgfxClientContext* context,
 		return CHANNEL_RC_OK;
 	}
 
-	for (i = 0; i < meta->numRegionRects; i++)
-	{
-		region16_union_rect(&(surface->invalidRegion), &(surface->invalidRegion),
-		                    (RECTANGLE_16*)&(meta->regionRects[i]));
-	}
+	region16_union_rects(&(surface->invalidRegion), &(surface->invalidRegion), meta->regionRects,
+	                     meta->numRegionRects);
 
 	status = IFCALLRESULT(CHANNEL_RC_OK, context->UpdateSurfaceArea, context, surface->surfaceId,
 	                      meta->numRegionRects, meta->regionRects);
@@ -669,6 +665,11 @@ static UINT gdi_SurfaceCommand_AVC444(rdpGdi* gdi, RdpgfxClientContext* context,
 	if (!surface->h264)
 		return ERROR_NOT_SUPPORTED;
 
+	if (!h264_context_set_option(
+	        surface->h264, H264_CONTEXT_OPTION_INDEPENDENT_AUX_STREAM,
+	        freerdp_settings_get_bool(gdi->context->settings, FreeRDP_GfxAVC444IndependentAux)))
+		return ERROR_INTERNAL_ERROR;
+
 	bs = (RDPGFX_AVC444_BITMAP_STREAM*)cmd->extra;
 
 	if (!bs)
@@ -689,11 +690,8 @@ static UINT gdi_SurfaceCommand_AVC444(rdpGdi* gdi, RdpgfxClientContext* context,
 		return CHANNEL_RC_OK;
 	}
 
-	for (i = 0; i < meta1->numRegionRects; i++)
-	{
-		region16_union_rect(&(surface->invalidRegion), &(surface->invalidRegion),
-		                    &(meta1->regionRects[i]));
-	}
+	region16_union_rects(&(surface->invalidRegion), &(surface->invalidRegion), meta1->regionRects,
+	                     meta1->numRegionRects);
 
 	status = IFCALLRESULT(CHANNEL_RC_OK, context->UpdateSurfaceArea, context, surface->surfaceId,
 	                      meta1->numRegionRects, meta1->regionRects);
@@ -701,11 +699,8 @@ static UINT gdi_SurfaceCommand_AVC444(rdpGdi* gdi, RdpgfxClientContext* context,
 	if (status != CHANNEL_RC_OK)
 		goto fail;
 
-	for (i = 0; i < meta2->numRegionRects; i++)
-	{
-		region16_union_rect(&(surface->invalidRegion), &(surface->invalidRegion),
-		                    &(meta2->regionRects[i]));
-	}
+	region16_union_rects(&(surface->invalidRegion), &(surface->invalidRegion), meta2->regionRects,
+	                     meta2->numRegionRects);
 
 	status = IFCALLRESULT(CHANNEL_RC_OK, context->UpdateSurfaceArea, context, surface->surfaceId,
 	                      meta2->numRegionRects, meta2->regionRects);
@@ -909,7 +904,7 @@ static UINT gdi_SurfaceCommand_Progressive(rdpGdi* gdi, RdpgfxClientContext* con
 	gdiGfxSurface* surface;
 	REGION16 invalidRegion;
 	const RECTANGLE_16* rects;
-	UINT32 nrRects, x;
+	UINT32 nrRects;
 	/**
 	 * Note: Since this comes via a Wire-To-Surface-2 PDU the
 	 * cmd's top/left/right/bottom/width/height members are always zero!
@@ -960,8 +955,7 @@ static UINT gdi_SurfaceCommand_Progressive(rdpGdi* gdi, RdpgfxClientContext* con
 	if (status != CHANNEL_RC_OK)
 		goto fail;
 
-	for (x = 0; x < nrRects; x++)
-		region16_union_rect(&surface->invalidRegion, &surface->invalidRegion, &rects[x]);
+	region16_union_region(&surface->invalidRegion, &surface->invalidRegion, &invalidRegion);
 
 	region16_uninit(&invalidRegion);
 
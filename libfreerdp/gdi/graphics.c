@@ -30,6 +30,7 @@
 #include <freerdp/gdi/shape.h>
 #include <freerdp/gdi/region.h>
 #include <freerdp/gdi/bitmap.h>
+#include <freerdp/primitives.h>
 
 #include "clipping.h"
 #include "drawing.h"
@@ -37,6 +38,25 @@
 #include "graphics.h"
 
 #define TAG FREERDP_TAG("gdi")
+
+typedef struct
+{
+	const gdiGlyph* glyph;
+	INT32 x;
+	INT32 y;
+	INT32 w;
+	INT32 h;
+	INT32 sx;
+	INT32 sy;
+} gdiGlyphRunEntry;
+
+struct gdi_glyph_run
+{
+	gdiGlyphRunEntry* entries;
+	size_t count;
+	size_t size;
+};
+
 /* Bitmap Class */
 
 HGDI_BITMAP gdi_create_bitmap(rdpGdi* gdi, UINT32 nWidth, UINT32 nHeight, UINT32 SrcFormat,
@@ -275,39 +295,17 @@ static BOOL gdi_Glyph_Draw(rdpContext* context, const rdpGlyph* glyph, INT32 x,
 	HGDI_BRUSH brush;
 	BOOL rc = FALSE;
 
+	WINPR_UNUSED(fOpRedundant);
+
 	if (!context || !glyph)
 		return FALSE;
 
 	gdi = context->gdi;
 	gdi_glyph = (const gdiGlyph*)glyph;
 
-	if (!fOpRedundant && 0)
-	{
-		GDI_RECT rect = { 0 };
-
-		if (x > 0)
-			rect.left = x;
-
-		if (y > 0)
-			rect.top = y;
-
-		if (x + w > 0)
-			rect.right = x + w - 1;
-
-		if (y + h > 0)
-			rect.bottom = y + h - 1;
-
-		if ((rect.left < rect.right) && (rect.top < rect.bottom))
-		{
-			brush = gdi_CreateSolidBrush(gdi->drawing->hdc->bkColor);
-
-			if (!brush)
-				return FALSE;
-
-			gdi_FillRect(gdi->drawing->hdc, &rect, brush);
-			gdi_DeleteObject((HGDIOBJECT)brush);
-		}
-	}
+	/* The glyphs of an order are composited by EndDraw */
+	if (gdi->glyphRun)
+		return gdi_glyph_run_add(gdi->glyphRun, gdi_glyph, x, y, w, h, sx, sy);
 
 	brush = gdi_CreateSolidBrush(gdi->drawing->hdc->textColor);
 
@@ -340,6 +338,7 @@ static BOOL gdi_Glyph_BeginDraw(rdpContext* context, INT32 x, INT32 y, INT32 wid
                                 UINT32 bgcolor, UINT32 fgcolor, BOOL fOpRedundant)
 {
 	rdpGdi* gdi;
+	HGDI_DC hdc;
 
 	if (!context || !context->gdi)
 		return FALSE;
@@ -349,42 +348,52 @@ static BOOL gdi_Glyph_BeginDraw(rdpContext* context, INT32 x, INT32 y, INT32 wid
 	if (!gdi->drawing || !gdi->drawing->hdc)
 		return FALSE;
 
-	if (!fOpRedundant)
+	hdc = gdi->drawing->hdc;
+
+	if (!gdi->glyphRun)
 	{
-		if (!gdi_decode_color(gdi, bgcolor, &bgcolor, NULL))
-			return FALSE;
+		gdi->glyphRun = gdi_glyph_run_new();
 
-		if (!gdi_decode_color(gdi, fgcolor, &fgcolor, NULL))
+		if (!gdi->glyphRun)
 			return FALSE;
+	}
 
-		gdi_SetClipRgn(gdi->drawing->hdc, x, y, width, height);
-		gdi_SetTextColor(gdi->drawing->hdc, bgcolor);
-		gdi_SetBkColor(gdi->drawing->hdc, fgcolor);
+	gdi_glyph_run_reset(gdi->glyphRun);
 
-		if (1)
-		{
-			GDI_RECT rect = { 0 };
-			HGDI_BRUSH brush = gdi_CreateSolidBrush(fgcolor);
+	if (!gdi_decode_color(gdi, bgcolor, &bgcolor, NULL))
+		return FALSE;
 
-			if (!brush)
-				return FALSE;
+	if (!gdi_decode_color(gdi, fgcolor, &fgcolor, NULL))
+		return FALSE;
 
-			if (x > 0)
-				rect.left = x;
+	/* The text color is required for redundant opaque rectangles as well */
+	gdi_SetTextColor(hdc, bgcolor);
+	gdi_SetBkColor(hdc, fgcolor);
 
-			if (y > 0)
-				rect.top = y;
+	if (!fOpRedundant)
+	{
+		GDI_RECT rect = { 0 };
+		HGDI_BRUSH brush = gdi_CreateSolidBrush(fgcolor);
 
-			rect.right = x + width - 1;
-			rect.bottom = y + height - 1;
+		if (!brush)
+			return FALSE;
 
-			if ((x + width > rect.left) && (y + height > rect.top))
-				gdi_FillRect(gdi->drawing->hdc, &rect, brush);
+		gdi_SetClipRgn(hdc, x, y, width, height);
 
-			gdi_DeleteObject((HGDIOBJECT)brush);
-		}
+		if (x > 0)
+			rect.left = x;
 
-		return gdi_SetNullClipRgn(gdi->drawing->hdc);
+		if (y > 0)
+			rect.top = y;
+
+		rect.right = x + width - 1;
+		rect.bottom = y + height - 1;
+
+		if ((x + width > rect.left) && (y + height > rect.top))
+			gdi_FillRect(hdc, &rect, brush);
+
+		gdi_DeleteObject((HGDIOBJECT)brush);
+		return gdi_SetNullClipRgn(hdc);
 	}
 
 	return TRUE;
@@ -394,6 +403,14 @@ static BOOL gdi_Glyph_EndDraw(rdpContext* context, INT32 x, INT32 y, INT32 width
                               UINT32 bgcolor, UINT32 fgcolor)
 {
 	rdpGdi* gdi;
+	BOOL rc = TRUE;
+
+	WINPR_UNUSED(x);
+	WINPR_UNUSED(y);
+	WINPR_UNUSED(width);
+	WINPR_UNUSED(height);
+	WINPR_UNUSED(bgcolor);
+	WINPR_UNUSED(fgcolor);
 
 	if (!context || !context->gdi)
 		return FALSE;
@@ -403,10 +420,158 @@ static BOOL gdi_Glyph_EndDraw(rdpContext* context, INT32 x, INT32 y, INT32 width
 	if (!gdi->drawing || !gdi->drawing->hdc)
 		return FALSE;
 
+	if (gdi->glyphRun)
+	{
+		rc = gdi_glyph_run_draw(gdi->glyphRun, gdi->drawing->hdc, gdi->drawing->hdc->textColor);
+		gdi_glyph_run_reset(gdi->glyphRun);
+	}
+
 	gdi_SetNullClipRgn(gdi->drawing->hdc);
+	return rc;
+}
+
+/* Glyph Run */
+
+gdiGlyphRun* gdi_glyph_run_new(void)
+{
+	return calloc(1, sizeof(gdiGlyphRun));
+}
+
+void gdi_glyph_run_free(gdiGlyphRun* run)
+{
+	if (!run)
+		return;
+
+	free(run->entries);
+	free(run);
+}
+
+void gdi_glyph_run_reset(gdiGlyphRun* run)
+{
+	if (run)
+		run->count = 0;
+}
+
+BOOL gdi_glyph_run_add(gdiGlyphRun* run, const gdiGlyph* glyph, INT32 x, INT32 y, INT32 w,
+                       INT32 h, INT32 sx, INT32 sy)
+{
+	gdiGlyphRunEntry* entry;
+
+	if (!run || !glyph || !glyph->bitmap)
+		return FALSE;
+
+	if (run->count == run->size)
+	{
+		const size_t size = (run->size > 0) ? run->size * 2 : 64;
+		gdiGlyphRunEntry* tmp = realloc(run->entries, size * sizeof(gdiGlyphRunEntry));
+
+		if (!tmp)
+			return FALSE;
+
+		run->entries = tmp;
+		run->size = size;
+	}
+
+	entry = &run->entries[run->count++];
+	entry->glyph = glyph;
+	entry->x = x;
+	entry->y = y;
+	entry->w = w;
+	entry->h = h;
+	entry->sx = sx;
+	entry->sy = sy;
 	return TRUE;
 }
 
+BOOL gdi_glyph_run_draw(const gdiGlyphRun* run, HGDI_DC hdc, UINT32 color)
+{
+	size_t i;
+	UINT32 pixel = 0;
+	BOOL empty = TRUE;
+	GDI_RECT bounds = { 0 };
+	HGDI_BITMAP hBmp;
+	const primitives_t* prims = primitives_get();
+	const UINT32 bpp = hdc ? GetBytesPerPixel(hdc->format) : 0;
+
+	if (!run || !hdc)
+		return FALSE;
+
+	hBmp = (HGDI_BITMAP)hdc->selectedObject;
+
+	if (!hBmp)
+		return FALSE;
+
+	/* Byte order of the pixel in memory, so it can be stored as an UINT32 */
+	if ((bpp == 4) && !WriteColor((BYTE*)&pixel, hdc->format, color))
+		return FALSE;
+
+	for (i = 0; i < run->count; i++)
+	{
+		const gdiGlyphRunEntry* entry = &run->entries[i];
+		const HGDI_BITMAP glyph = entry->glyph->bitmap;
+		INT32 x = entry->x;
+		INT32 y = entry->y;
+		INT32 w = entry->w;
+		INT32 h = entry->h;
+		INT32 sx = entry->sx;
+		INT32 sy = entry->sy;
+		INT32 line;
+
+		if (!gdi_ClipCoords(hdc, &x, &y, &w, &h, &sx, &sy))
+			continue;
+
+		if ((sx < 0) || (sy < 0))
+			continue;
+
+		w = MIN(w, glyph->width - sx);
+		h = MIN(h, glyph->height - sy);
+
+		if ((w <= 0) || (h <= 0))
+			continue;
+
+		for (line = 0; line < h; line++)
+		{
+			const BYTE* mask = &glyph->data[(sy + line) * glyph->scanline + sx];
+			BYTE* dst = &hBmp->data[(y + line) * hBmp->scanline + x * bpp];
+
+			if (bpp == 4)
+				prims->set_32u_masked(pixel, mask, (UINT32*)dst, (UINT32)w);
+			else
+			{
+				INT32 px;
+
+				for (px = 0; px < w; px++)
+				{
+					if (mask[px])
+						WriteColor(&dst[px * bpp], hdc->format, color);
+				}
+			}
+		}
+
+		if (empty)
+		{
+			bounds.left = x;
+			bounds.top = y;
+			bounds.right = x + w - 1;
+			bounds.bottom = y + h - 1;
+			empty = FALSE;
+		}
+		else
+		{
+			bounds.left = MIN(bounds.left, x);
+			bounds.top = MIN(bounds.top, y);
+			bounds.right = MAX(bounds.right, x + w - 1);
+			bounds.bottom = MAX(bounds.bottom, y + h - 1);
+		}
+	}
+
+	if (empty)
+		return TRUE;
+
+	return gdi_InvalidateRegion(hdc, bounds.left, bounds.top, bounds.right - bounds.left + 1,
+	                            bounds.bottom - bounds.top + 1);
+}
+
 /* Graphics Module */
 BOOL gdi_register_graphics(rdpGraphics* graphics)
 {
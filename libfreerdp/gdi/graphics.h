@@ -31,4 +31,14 @@ FREERDP_LOCAL HGDI_BITMAP gdi_create_bitmap(rdpGdi* gdi, UINT32 width, UINT32 he
 
 FREERDP_LOCAL BOOL gdi_register_graphics(rdpGraphics* graphics);
 
+/* Collects the glyphs of a text order so they are composited in a single pass.
+ * Glyph bitmaps are PIXEL_FORMAT_MONO with a byte per pixel. */
+FREERDP_LOCAL gdiGlyphRun* gdi_glyph_run_new(void);
+FREERDP_LOCAL void gdi_glyph_run_free(gdiGlyphRun* run);
+FREERDP_LOCAL void gdi_glyph_run_reset(gdiGlyphRun* run);
+FREERDP_LOCAL BOOL gdi_glyph_run_add(gdiGlyphRun* run, const gdiGlyph* glyph, INT32 x, INT32 y,
+                                     INT32 w, INT32 h, INT32 sx, INT32 sy);
+/* Sets the pixels of all glyphs to color, clipped to the region of hdc */
+FREERDP_LOCAL BOOL gdi_glyph_run_draw(const gdiGlyphRun* run, HGDI_DC hdc, UINT32 color);
+
 #endif /* FREERDP_LIB_GDI_GRAPHICS_H */
@@ -38,14 +38,14 @@
 #include "line.h"
 
 /**
- * Draw a line from the current position to the given position.\n
- * @msdn{dd145029}
- * @param hdc device context
- * @param nXEnd ending x position
- * @param nYEnd ending y position
+ * Combine a pen color with the pixel at pixelPtr according to a binary raster operation.
+ * @param rop binary raster operation (GDI_R2_*)
+ * @param pixelPtr destination pixel
+ * @param pen pen color in format
+ * @param format pixel format of the destination
  * @return nonzero if successful, 0 otherwise
  */
-static BOOL gdi_rop_color(UINT32 rop, BYTE* pixelPtr, UINT32 pen, UINT32 format)
+BOOL gdi_rop_color(UINT32 rop, BYTE* pixelPtr, UINT32 pen, UINT32 format)
 {
 	const UINT32 srcPixel = ReadColor(pixelPtr, format);
 	UINT32 dstPixel;
@@ -105,7 +105,7 @@ static BOOL gdi_rop_color(UINT32 rop, BYTE* pixelPtr, UINT32 pen, UINT32 format)
 			break;
 
 		case GDI_R2_MERGEPENNOT: /* LineTo_MERGEPENNOT */
-			dstPixel = srcPixel | ~pen;
+			dstPixel = pen | ~srcPixel;
 			break;
 
 		case GDI_R2_MERGEPEN: /* LineTo_MERGEPEN */
@@ -123,6 +123,14 @@ static BOOL gdi_rop_color(UINT32 rop, BYTE* pixelPtr, UINT32 pen, UINT32 format)
 	return WriteColor(pixelPtr, format, dstPixel);
 }
 
+/**
+ * Draw a line from the current position to the given position.\n
+ * @msdn{dd145029}
+ * @param hdc device context
+ * @param nXEnd ending x position
+ * @param nYEnd ending y position
+ * @return nonzero if successful, 0 otherwise
+ */
 BOOL gdi_LineTo(HGDI_DC hdc, UINT32 nXEnd, UINT32 nYEnd)
 {
 	INT32 x, y;
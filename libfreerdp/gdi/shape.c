@@ -33,73 +33,585 @@
 #include <freerdp/gdi/bitmap.h>
 #include <freerdp/gdi/region.h>
 #include <freerdp/gdi/shape.h>
+#include <freerdp/gdi/pen.h>
+#include <freerdp/primitives.h>
 
 #include <freerdp/log.h>
 
 #include "clipping.h"
+#include "drawing.h"
+#include "line.h"
 #include "../gdi/gdi.h"
 
 #define TAG FREERDP_TAG("gdi.shape")
 
-static void Ellipse_Bresenham(HGDI_DC hdc, int x1, int y1, int x2, int y2)
+typedef struct
 {
-	INT32 e, e2;
-	INT32 dx, dy;
-	INT32 a, b, c;
-	a = (x1 < x2) ? x2 - x1 : x1 - x2;
-	b = (y1 < y2) ? y2 - y1 : y1 - y2;
-	c = b & 1;
-	dx = 4 * (1 - a) * b * b;
-	dy = 4 * (c + 1) * a * a;
-	e = dx + dy + c * a * a;
+	HGDI_DC hdc;
+	INT32 rop2;
+	UINT32 style;
+	UINT32 color;
+	UINT32 pixel;
+	BOOL monochrome;
+	UINT32 patternFormat;
+	const primitives_t* prims;
+} GDI_SPAN_FILLER;
+
+typedef struct
+{
+	INT32 yTop;
+	INT32 yBottom;
+	INT32 dir;
+	INT64 x0;
+	INT64 y0;
+	INT64 dx;
+	INT64 dy;
+	INT64 x;
+	INT64 r;
+	INT64 q;
+	INT64 rs;
+} GDI_POLYGON_EDGE;
+
+typedef struct
+{
+	INT32 top;
+	INT32 count;
+	INT32* left;
+	INT32* right;
+} GDI_ELLIPSE_ROWS;
+
+static BOOL gdi_span_filler_init(GDI_SPAN_FILLER* filler, HGDI_DC hdc, HGDI_BRUSH hbr)
+{
+	ZeroMemory(filler, sizeof(GDI_SPAN_FILLER));
+
+	if (!hdc || !hdc->selectedObject || !hbr)
+		return FALSE;
+
+	filler->hdc = hdc;
+	filler->rop2 = gdi_GetROP2(hdc);
+	filler->style = hbr->style;
+	filler->color = hbr->color;
+	filler->prims = primitives_get();
+
+	switch (hbr->style)
+	{
+		case GDI_BS_SOLID:
+			/* The color as stored in memory for set_32u */
+			if (GetBytesPerPixel(hdc->format) == 4)
+				WriteColor((BYTE*)&filler->pixel, hdc->format, hbr->color);
+
+			break;
+
+		case GDI_BS_HATCHED:
+		case GDI_BS_PATTERN:
+			if (!hbr->pattern)
+				return FALSE;
+
+			filler->patternFormat = hbr->pattern->format;
+			filler->monochrome = (hbr->pattern->format == PIXEL_FORMAT_MONO);
+			break;
+
+		default:
+			return FALSE;
+	}
+
+	/* GDI_R2_NOP leaves the destination untouched */
+	return filler->rop2 != GDI_R2_NOP;
+}
+
+/**
+ * Fill width pixels starting at (x, y), the span must be clipped already.
+ * Solid copies take the SIMD set_32u primitive on 32bpp surfaces.
+ */
+static void gdi_fill_span(const GDI_SPAN_FILLER* filler, INT32 x, INT32 y, INT32 width)
+{
+	INT32 i;
+	HGDI_DC hdc = filler->hdc;
+	const UINT32 bpp = GetBytesPerPixel(hdc->format);
+	BYTE* dstp = gdi_get_bitmap_pointer(hdc, x, y);
+
+	if (!dstp || (width <= 0))
+		return;
+
+	if ((filler->style == GDI_BS_SOLID) && (filler->rop2 == GDI_R2_COPYPEN))
+	{
+		if (bpp == 4)
+		{
+			filler->prims->set_32u(filler->pixel, (UINT32*)dstp, (UINT32)width);
+			return;
+		}
+
+		for (i = 0; i < width; i++)
+			WriteColor(&dstp[i * bpp], hdc->format, filler->color);
+
+		return;
+	}
+
+	for (i = 0; i < width; i++)
+	{
+		UINT32 color = filler->color;
+
+		if (filler->style != GDI_BS_SOLID)
+		{
+			const BYTE* patp = gdi_get_brush_pointer(hdc, x + i, y);
+
+			if (filler->monochrome)
+			{
+				if (*patp != 0)
+					color = hdc->textColor;
+				else if (hdc->bkMode == GDI_TRANSPARENT)
+					continue;
+				else
+					color = hdc->bkColor;
+			}
+			else
+			{
+				color = ReadColor(patp, filler->patternFormat);
+				color = FreeRDPConvertColor(color, filler->patternFormat, hdc->format, NULL);
+			}
+		}
+
+		if (filler->rop2 == GDI_R2_COPYPEN)
+			WriteColor(&dstp[i * bpp], hdc->format, color);
+		else
+			gdi_rop_color(filler->rop2, &dstp[i * bpp], color, hdc->format);
+	}
+}
+
+/* Clip a span of row y against the clipping rectangle and fill it */
+static void gdi_fill_clipped_span(const GDI_SPAN_FILLER* filler, const GDI_RECT* clip, INT32 left,
+                                  INT32 right, INT32 y)
+{
+	if (left < clip->left)
+		left = clip->left;
+
+	if (right > clip->right)
+		right = clip->right;
+
+	if (left <= right)
+		gdi_fill_span(filler, left, y, right - left + 1);
+}
+
+/* Get the clipping rectangle of a shape with the given inclusive bounds */
+static BOOL gdi_shape_clip(HGDI_DC hdc, INT32 left, INT32 top, INT32 right, INT32 bottom,
+                           GDI_RECT* clip)
+{
+	INT32 x = left;
+	INT32 y = top;
+	INT32 w = right - left + 1;
+	INT32 h = bottom - top + 1;
+
+	if ((w <= 0) || (h <= 0))
+		return FALSE;
+
+	if (!gdi_ClipCoords(hdc, &x, &y, &w, &h, NULL, NULL))
+		return FALSE;
+
+	if ((w <= 0) || (h <= 0))
+		return FALSE;
+
+	return gdi_CRgnToRect(x, y, w, h, clip);
+}
+
+static INT64 gdi_div_ceil(INT64 num, INT64 den)
+{
+	const INT64 q = num / den;
+	return ((num % den) > 0) ? q + 1 : q;
+}
+
+static INT64 gdi_div_floor(INT64 num, INT64 den)
+{
+	const INT64 q = num / den;
+	return ((num % den) < 0) ? q - 1 : q;
+}
+
+/**
+ * Start an edge at scanline y.\n
+ * A pixel is inside if its center lies right of or on the crossing of the scanline center
+ * with the edge, so the first pixel of a span is ceil(X - 0.5). With 2 * dy as denominator
+ * the crossing is tracked exactly as an integer and a remainder.
+ */
+static void gdi_edge_start(GDI_POLYGON_EDGE* edge, INT32 y)
+{
+	const INT64 den = 2 * edge->dy;
+	const INT64 num = (2 * edge->x0 - 1) * edge->dy + edge->dx * (2 * (y - edge->y0) + 1);
+	edge->x = gdi_div_ceil(num, den);
+	edge->r = edge->x * den - num;
+	edge->q = gdi_div_floor(2 * edge->dx, den);
+	edge->rs = 2 * edge->dx - edge->q * den;
+}
+
+static void gdi_edge_step(GDI_POLYGON_EDGE* edge)
+{
+	edge->x += edge->q;
+	edge->r -= edge->rs;
+
+	if (edge->r < 0)
+	{
+		edge->r += 2 * edge->dy;
+		edge->x++;
+	}
+}
+
+static int gdi_edge_compare(const void* a, const void* b)
+{
+	const GDI_POLYGON_EDGE* ea = (const GDI_POLYGON_EDGE*)a;
+	const GDI_POLYGON_EDGE* eb = (const GDI_POLYGON_EDGE*)b;
+
+	if (ea->yTop != eb->yTop)
+		return (ea->yTop < eb->yTop) ? -1 : 1;
+
+	return 0;
+}
+
+/**
+ * Fill the polygons with an active edge table, horizontal edges do not contribute.
+ * The spans of every scanline are handed to the span filler.
+ */
+static BOOL gdi_fill_polygons(HGDI_DC hdc, const GDI_POINT* lpPoints, const int* lpPolyCounts,
+                              int nCount)
+{
+	int i, j;
+	BOOL rc = FALSE;
+	size_t total = 0;
+	size_t nEdges = 0;
+	size_t next = 0;
+	size_t nActive = 0;
+	INT32 y;
+	INT32 left = INT32_MAX;
+	INT32 top = INT32_MAX;
+	INT32 right = INT32_MIN;
+	INT32 bottom = INT32_MIN;
+	INT32 fillMode;
+	GDI_RECT clip;
+	GDI_SPAN_FILLER filler;
+	GDI_POLYGON_EDGE* edges = NULL;
+	GDI_POLYGON_EDGE** active = NULL;
+	const GDI_POINT* points = lpPoints;
+
+	if (!hdc || !lpPoints || !lpPolyCounts || (nCount < 0))
+		return FALSE;
+
+	for (i = 0; i < nCount; i++)
+	{
+		if (lpPolyCounts[i] < 0)
+			return FALSE;
+
+		total += (size_t)lpPolyCounts[i];
+	}
+
+	if (!gdi_span_filler_init(&filler, hdc, hdc->brush))
+		return TRUE;
+
+	if (total < 3)
+		return TRUE;
+
+	edges = calloc(total, sizeof(GDI_POLYGON_EDGE));
+	active = calloc(total, sizeof(GDI_POLYGON_EDGE*));
+
+	if (!edges || !active)
+		goto fail;
+
+	for (i = 0; i < nCount; points += lpPolyCounts[i], i++)
+	{
+		for (j = 0; j < lpPolyCounts[i]; j++)
+		{
+			/* Every polygon is closed */
+			const GDI_POINT* a = &points[j];
+			const GDI_POINT* b = &points[(j + 1) % lpPolyCounts[i]];
+			GDI_POLYGON_EDGE* edge = &edges[nEdges];
+
+			left = MIN(left, a->x);
+			right = MAX(right, a->x);
+			top = MIN(top, a->y);
+			bottom = MAX(bottom, a->y);
+
+			if (a->y == b->y)
+				continue;
+
+			if (a->y < b->y)
+			{
+				edge->dir = 1;
+				edge->x0 = a->x;
+				edge->y0 = a->y;
+				edge->dx = (INT64)b->x - a->x;
+				edge->dy = (INT64)b->y - a->y;
+			}
+			else
+			{
+				edge->dir = -1;
+				edge->x0 = b->x;
+				edge->y0 = b->y;
+				edge->dx = (INT64)a->x - b->x;
+				edge->dy = (INT64)a->y - b->y;
+			}
+
+			edge->yTop = (INT32)edge->y0;
+			edge->yBottom = (INT32)(edge->y0 + edge->dy);
+			nEdges++;
+		}
+	}
+
+	/* Pixel centers on the bottom and right border are outside */
+	if (!gdi_shape_clip(hdc, left, top, right - 1, bottom - 1, &clip))
+	{
+		rc = TRUE;
+		goto fail;
+	}
+
+	qsort(edges, nEdges, sizeof(GDI_POLYGON_EDGE), gdi_edge_compare);
+	fillMode = gdi_GetPolyFillMode(hdc);
+
+	for (y = clip.top; y <= clip.bottom; y++)
+	{
+		size_t k, n = 0;
+
+		/* Drop finished edges and advance the remaining ones */
+		for (k = 0; k < nActive; k++)
+		{
+			if (active[k]->yBottom <= y)
+				continue;
+
+			gdi_edge_step(active[k]);
+			active[n++] = active[k];
+		}
+
+		nActive = n;
+
+		for (; (next < nEdges) && (edges[next].yTop <= y); next++)
+		{
+			if (edges[next].yBottom <= y)
+				continue;
+
+			gdi_edge_start(&edges[next], y);
+			active[nActive++] = &edges[next];
+		}
+
+		/* The order changes only where edges cross, insertion sort is close to linear */
+		for (k = 1; k < nActive; k++)
+		{
+			GDI_POLYGON_EDGE* edge = active[k];
+			size_t l = k;
+
+			while ((l > 0) && (active[l - 1]->x > edge->x))
+			{
+				active[l] = active[l - 1];
+				l--;
+			}
+
+			active[l] = edge;
+		}
+
+		if (fillMode == GDI_FILL_WINDING)
+		{
+			INT32 winding = 0;
+
+			for (k = 0; k + 1 < nActive; k++)
+			{
+				winding += active[k]->dir;
+
+				if ((winding != 0) && (active[k + 1]->x > active[k]->x))
+					gdi_fill_clipped_span(&filler, &clip, (INT32)MAX(active[k]->x, INT32_MIN),
+					                      (INT32)MIN(active[k + 1]->x - 1, INT32_MAX), y);
+			}
+		}
+		else
+		{
+			for (k = 0; k + 1 < nActive; k += 2)
+			{
+				if (active[k + 1]->x > active[k]->x)
+					gdi_fill_clipped_span(&filler, &clip, (INT32)MAX(active[k]->x, INT32_MIN),
+					                      (INT32)MIN(active[k + 1]->x - 1, INT32_MAX), y);
+			}
+		}
+	}
+
+	rc = gdi_InvalidateRegion(hdc, clip.left, clip.top, clip.right - clip.left + 1,
+	                          clip.bottom - clip.top + 1);
+fail:
+	free(edges);
+	free(active);
+	return rc;
+}
+
+/**
+ * Get the leftmost and rightmost pixel of every row of an ellipse outline.\n
+ * The outline is traced with the Bresenham type algorithm of Alois Zingl.
+ */
+static BOOL gdi_ellipse_rows(INT32 x1, INT32 y1, INT32 x2, INT32 y2, GDI_ELLIPSE_ROWS* rows)
+{
+	INT32 i;
+	INT64 e, e2;
+	INT64 dx, dy;
+	INT64 a, b, c;
+	INT64 px1, px2, py1, py2;
 
 	if (x1 > x2)
 	{
+		const INT32 t = x1;
 		x1 = x2;
-		x2 += a;
+		x2 = t;
 	}
 
 	if (y1 > y2)
+	{
+		const INT32 t = y1;
 		y1 = y2;
+		y2 = t;
+	}
+
+	/* Keeps the error terms of the tracer within 64 bit */
+	if (((INT64)x2 - x1 > UINT16_MAX) || ((INT64)y2 - y1 > UINT16_MAX))
+		return FALSE;
+
+	rows->top = y1;
+	rows->count = y2 - y1 + 1;
+	rows->left = calloc((size_t)rows->count, sizeof(INT32));
+	rows->right = calloc((size_t)rows->count, sizeof(INT32));
+
+	if (!rows->left || !rows->right)
+		return FALSE;
+
+	for (i = 0; i < rows->count; i++)
+	{
+		rows->left[i] = INT32_MAX;
+		rows->right[i] = INT32_MIN;
+	}
 
-	y1 += (b + 1) / 2;
-	y2 = y1 - c;
+	a = (INT64)x2 - x1;
+	b = (INT64)y2 - y1;
+	c = b & 1;
+	dx = 4 * (1 - a) * b * b;
+	dy = 4 * (c + 1) * a * a;
+	e = dx + dy + c * a * a;
+	px1 = x1;
+	px2 = x2;
+	py1 = y1 + (b + 1) / 2;
+	py2 = py1 - c;
 	a *= 8 * a;
 	c = 8 * b * b;
 
 	do
 	{
-		gdi_SetPixel(hdc, x2, y1, 0);
-		gdi_SetPixel(hdc, x1, y1, 0);
-		gdi_SetPixel(hdc, x1, y2, 0);
-		gdi_SetPixel(hdc, x2, y2, 0);
+		for (i = 0; i < 2; i++)
+		{
+			const INT64 row = ((i == 0) ? py1 : py2) - y1;
+
+			if ((row >= 0) && (row < rows->count))
+			{
+				rows->left[row] = (INT32)MIN(rows->left[row], px1);
+				rows->right[row] = (INT32)MAX(rows->right[row], px2);
+			}
+		}
+
 		e2 = 2 * e;
 
 		if (e2 >= dx)
 		{
-			x1++;
-			x2--;
+			px1++;
+			px2--;
 			e += dx += c;
 		}
 
 		if (e2 <= dy)
 		{
-			y1++;
-			y2--;
+			py1++;
+			py2--;
 			e += dy += a;
 		}
-	} while (x1 <= x2);
+	} while (px1 <= px2);
+
+	/* Flat ellipses end with the tips of the long axis */
+	while (py1 - py2 < b)
+	{
+		const INT64 r1 = ++py1 - y1;
+		const INT64 r2 = --py2 - y1;
+
+		if ((r1 >= 0) && (r1 < rows->count))
+		{
+			rows->left[r1] = (INT32)MIN(rows->left[r1], px1 - 1);
+			rows->right[r1] = (INT32)MAX(rows->right[r1], px1 - 1);
+		}
+
+		if ((r2 >= 0) && (r2 < rows->count))
+		{
+			rows->left[r2] = (INT32)MIN(rows->left[r2], px1 - 1);
+			rows->right[r2] = (INT32)MAX(rows->right[r2], px1 - 1);
+		}
+	}
+
+	return TRUE;
+}
+
+/**
+ * Draw an ellipse with inclusive bounds. The outline pixels of a row reach from its end to
+ * where the neighbouring rows begin, the pixels in between are the interior.
+ * Either filler may be NULL, every pixel is drawn at most once.
+ */
+static BOOL gdi_draw_ellipse(HGDI_DC hdc, INT32 x1, INT32 y1, INT32 x2, INT32 y2,
+                             const GDI_SPAN_FILLER* outline, const GDI_SPAN_FILLER* interior)
+{
+	INT32 i;
+	BOOL rc = FALSE;
+	GDI_RECT clip;
+	GDI_ELLIPSE_ROWS rows = { 0 };
+
+	if (!gdi_shape_clip(hdc, MIN(x1, x2), MIN(y1, y2), MAX(x1, x2), MAX(y1, y2), &clip))
+		return TRUE;
+
+	if (!gdi_ellipse_rows(x1, y1, x2, y2, &rows))
+		goto fail;
 
-	while (y1 - y2 < b)
+	for (i = 0; i < rows.count; i++)
 	{
-		gdi_SetPixel(hdc, x1 - 1, ++y1, 0);
-		gdi_SetPixel(hdc, x1 - 1, --y2, 0);
+		INT32 innerLeft = INT32_MIN;
+		INT32 innerRight = INT32_MAX;
+		INT32 outerLeft, outerRight;
+		const INT32 y = rows.top + i;
+
+		if ((y < clip.top) || (y > clip.bottom) || (rows.left[i] > rows.right[i]))
+			continue;
+
+		if ((i > 0) && (i + 1 < rows.count))
+		{
+			innerLeft = MIN(rows.left[i - 1], rows.left[i + 1]);
+			innerRight = MAX(rows.right[i - 1], rows.right[i + 1]);
+		}
+
+		outerLeft = MAX(rows.left[i], innerLeft - 1);
+		outerRight = MIN(rows.right[i], innerRight + 1);
+
+		if (outerLeft + 1 >= outerRight)
+		{
+			if (outline)
+				gdi_fill_clipped_span(outline, &clip, rows.left[i], rows.right[i], y);
+
+			continue;
+		}
+
+		if (outline)
+		{
+			gdi_fill_clipped_span(outline, &clip, rows.left[i], outerLeft, y);
+			gdi_fill_clipped_span(outline, &clip, outerRight, rows.right[i], y);
+		}
+
+		if (interior)
+			gdi_fill_clipped_span(interior, &clip, outerLeft + 1, outerRight - 1, y);
 	}
+
+	rc = gdi_InvalidateRegion(hdc, clip.left, clip.top, clip.right - clip.left + 1,
+	                          clip.bottom - clip.top + 1);
+fail:
+	free(rows.left);
+	free(rows.right);
+	return rc;
 }
 
 /**
  * Draw an ellipse
  * @msdn{dd162510}
+ * The interior is filled with the selected brush and the outline drawn with the selected pen,
+ * both with the current ROP2. Without a pen the brush fills the outline as well.
  * @param hdc device context
  * @param nLeftRect x1
  * @param nTopRect y1
@@ -109,8 +621,30 @@ static void Ellipse_Bresenham(HGDI_DC hdc, int x1, int y1, int x2, int y2)
  */
 BOOL gdi_Ellipse(HGDI_DC hdc, int nLeftRect, int nTopRect, int nRightRect, int nBottomRect)
 {
-	Ellipse_Bresenham(hdc, nLeftRect, nTopRect, nRightRect, nBottomRect);
-	return TRUE;
+	GDI_BRUSH penBrush = { 0 };
+	GDI_SPAN_FILLER outline, interior;
+	BOOL hasOutline = FALSE;
+	BOOL hasInterior;
+
+	if (!hdc)
+		return FALSE;
+
+	hasInterior = gdi_span_filler_init(&interior, hdc, hdc->brush);
+
+	if (hdc->pen && (hdc->pen->style != GDI_PS_NULL))
+	{
+		penBrush.style = GDI_BS_SOLID;
+		penBrush.color = gdi_GetPenColor(hdc->pen, hdc->format);
+		hasOutline = gdi_span_filler_init(&outline, hdc, &penBrush);
+	}
+	else if (hasInterior)
+	{
+		outline = interior;
+		hasOutline = TRUE;
+	}
+
+	return gdi_draw_ellipse(hdc, nLeftRect, nTopRect, nRightRect, nBottomRect,
+	                        hasOutline ? &outline : NULL, hasInterior ? &interior : NULL);
 }
 
 /**
@@ -215,6 +749,8 @@ BOOL gdi_FillRect(HGDI_DC hdc, const HGDI_RECT rect, HGDI_BRUSH hbr)
 /**
  * Draw a polygon
  * @msdn{dd162814}
+ * The polygon is filled with the selected brush according to the polygon fill mode and the
+ * current ROP2, the outline is not drawn.
  * @param hdc device context
  * @param lpPoints array of points
  * @param nCount number of points
@@ -222,13 +758,13 @@ BOOL gdi_FillRect(HGDI_DC hdc, const HGDI_RECT rect, HGDI_BRUSH hbr)
  */
 BOOL gdi_Polygon(HGDI_DC hdc, GDI_POINT* lpPoints, int nCount)
 {
-	WLog_ERR(TAG, "Not implemented!");
-	return FALSE;
+	return gdi_fill_polygons(hdc, lpPoints, &nCount, 1);
 }
 
 /**
  * Draw a series of closed polygons
  * @msdn{dd162818}
+ * The polygons are filled as a single shape, overlapping areas depend on the fill mode.
  * @param hdc device context
  * @param lpPoints array of series of points
  * @param lpPolyCounts array of number of points in each series
@@ -237,8 +773,7 @@ BOOL gdi_Polygon(HGDI_DC hdc, GDI_POINT* lpPoints, int nCount)
  */
 BOOL gdi_PolyPolygon(HGDI_DC hdc, GDI_POINT* lpPoints, int* lpPolyCounts, int nCount)
 {
-	WLog_ERR(TAG, "Not implemented!");
-	return FALSE;
+	return gdi_fill_polygons(hdc, lpPoints, lpPolyCounts, nCount);
 }
 
 BOOL gdi_Rectangle(HGDI_DC hdc, INT32 nXDst, INT32 nYDst, INT32 nWidth, INT32 nHeight)
@@ -13,6 +13,7 @@
 #include "line.h"
 #include "brush.h"
 #include "clipping.h"
+#include "drawing.h"
 #include "helpers.h"
 
 /* Ellipse() Test Data */
@@ -94,6 +95,7 @@ int TestGdiEllipse(int argc, char* argv[])
 	{
 		HGDI_DC hdc = NULL;
 		HGDI_PEN pen = NULL;
+		HGDI_BRUSH brush = NULL;
 		HGDI_BITMAP hBmp = NULL;
 		HGDI_BITMAP hBmp_Ellipse_1 = NULL;
 		HGDI_BITMAP hBmp_Ellipse_2 = NULL;
@@ -103,7 +105,7 @@ int TestGdiEllipse(int argc, char* argv[])
 		g.format = format;
 
 		for (j = 0; j < 256; j++)
-			g.palette[i] = FreeRDPGetColor(format, j, j, j, 0xFF);
+			g.palette[j] = FreeRDPGetColor(format, j, j, j, 0xFF);
 
 		rc = -1;
 
@@ -116,13 +118,18 @@ int TestGdiEllipse(int argc, char* argv[])
 		hdc->format = format;
 		gdi_SetNullClipRgn(hdc);
 
-		if (!(pen = gdi_CreatePen(1, 1, 0, format, hPalette)))
+		if (!(pen = gdi_CreatePen(1, 1, FreeRDPGetColor(format, 0, 0, 0, 0xFF), format, hPalette)))
 		{
 			printf("gdi_CreatePen failed\n");
 			goto fail;
 		}
 
+		if (!(brush = gdi_CreateSolidBrush(FreeRDPGetColor(format, 0, 0, 0, 0xFF))))
+			goto fail;
+
 		gdi_SelectObject(hdc, (HGDIOBJECT)pen);
+		gdi_SelectObject(hdc, (HGDIOBJECT)brush);
+		gdi_SetROP2(hdc, GDI_R2_COPYPEN);
 		hBmp = gdi_CreateCompatibleBitmap(hdc, 16, 16);
 		gdi_SelectObject(hdc, (HGDIOBJECT)hBmp);
 		hBmp_Ellipse_1 = test_convert_to_bitmap(ellipse_case_1, RawFormat, 0, 0, 0, format, 0, 0, 0,
@@ -153,12 +160,16 @@ int TestGdiEllipse(int argc, char* argv[])
 		if (!gdi_Ellipse(hdc, 0, 0, 15, 15))
 			goto fail;
 
+		if (!test_assert_bitmaps_equal(hBmp, hBmp_Ellipse_1, "Ellipse_1", hPalette))
+			goto fail;
+
 		rc = 0;
 	fail:
 		gdi_DeleteObject((HGDIOBJECT)hBmp_Ellipse_1);
 		gdi_DeleteObject((HGDIOBJECT)hBmp_Ellipse_2);
 		gdi_DeleteObject((HGDIOBJECT)hBmp_Ellipse_3);
 		gdi_DeleteObject((HGDIOBJECT)hBmp);
+		gdi_DeleteObject((HGDIOBJECT)brush);
 		gdi_DeleteObject((HGDIOBJECT)pen);
 		gdi_DeleteDC(hdc);
 
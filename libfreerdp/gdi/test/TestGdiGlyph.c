@@ -0,0 +1,300 @@
+#include <freerdp/gdi/gdi.h>
+
+#include <freerdp/gdi/dc.h>
+#include <freerdp/gdi/region.h>
+#include <freerdp/gdi/bitmap.h>
+#include <freerdp/codec/color.h>
+
+#include <winpr/crt.h>
+#include <winpr/sysinfo.h>
+
+#include "brush.h"
+#include "graphics.h"
+#include "clipping.h"
+
+#define TEST_WIDTH 256
+#define TEST_HEIGHT 32
+#define TEST_GLYPHS 8
+#define TEST_BENCHMARK_RUNS 2000
+
+typedef struct
+{
+	INT32 x;
+	INT32 y;
+	INT32 sx;
+	INT32 sy;
+} TestPlacement;
+
+static UINT32 test_random(UINT32* seed)
+{
+	*seed = *seed * 1103515245 + 12345;
+	return (*seed >> 16) & 0x7FFF;
+}
+
+static void test_glyphs_free(gdiGlyph** glyphs, size_t count)
+{
+	size_t x;
+
+	for (x = 0; x < count; x++)
+	{
+		gdiGlyph* glyph = glyphs[x];
+
+		if (!glyph)
+			continue;
+
+		gdi_DeleteObject((HGDIOBJECT)glyph->bitmap);
+		gdi_DeleteDC(glyph->hdc);
+		free(glyph);
+	}
+}
+
+/* 1 bpp glyphs of varying size, expanded like the glyph cache does */
+static BOOL test_glyphs_new(gdiGlyph** glyphs, size_t count)
+{
+	size_t x;
+	UINT32 seed = 42;
+
+	for (x = 0; x < count; x++)
+	{
+		size_t i;
+		BYTE aj[64 * 4] = { 0 };
+		const UINT32 cx = 5 + (UINT32)x * 4;
+		const UINT32 cy = 7 + (UINT32)x * 3;
+		BYTE* data;
+		gdiGlyph* glyph = calloc(1, sizeof(gdiGlyph));
+
+		glyphs[x] = glyph;
+
+		if (!glyph)
+			return FALSE;
+
+		for (i = 0; i < ((cx + 7) / 8) * cy; i++)
+			aj[i] = (BYTE)test_random(&seed);
+
+		glyph->hdc = gdi_GetDC();
+		data = freerdp_glyph_convert(cx, cy, aj);
+
+		if (!glyph->hdc || !data)
+		{
+			_aligned_free(data);
+			return FALSE;
+		}
+
+		glyph->hdc->format = PIXEL_FORMAT_MONO;
+		glyph->bitmap = gdi_CreateBitmap(cx, cy, PIXEL_FORMAT_MONO, data);
+
+		if (!glyph->bitmap)
+		{
+			_aligned_free(data);
+			return FALSE;
+		}
+
+		gdi_SelectObject(glyph->hdc, (HGDIOBJECT)glyph->bitmap);
+	}
+
+	return TRUE;
+}
+
+static HGDI_DC test_dc_new(UINT32 format)
+{
+	UINT32 x, y;
+	HGDI_BITMAP hBmp;
+	HGDI_DC hdc = gdi_GetDC();
+
+	if (!hdc)
+		return NULL;
+
+	hdc->format = format;
+	hBmp = gdi_CreateCompatibleBitmap(hdc, TEST_WIDTH, TEST_HEIGHT);
+
+	if (!hBmp)
+	{
+		gdi_DeleteDC(hdc);
+		return NULL;
+	}
+
+	gdi_SelectObject(hdc, (HGDIOBJECT)hBmp);
+
+	for (y = 0; y < TEST_HEIGHT; y++)
+	{
+		for (x = 0; x < TEST_WIDTH; x++)
+			gdi_SetPixel(hdc, x, y, FreeRDPGetColor(format, x, y * 8, x ^ y, 0xFF));
+	}
+
+	return hdc;
+}
+
+static void test_dc_free(HGDI_DC hdc)
+{
+	if (!hdc)
+		return;
+
+	gdi_DeleteObject(hdc->selectedObject);
+	gdi_DeleteDC(hdc);
+}
+
+/* The previous rendering, a BitBlt with the glyph as a mono source per glyph */
+static BOOL test_draw_bitblt(HGDI_DC hdc, gdiGlyph** glyphs, const TestPlacement* placements,
+                             size_t count, UINT32 color)
+{
+	size_t x;
+	BOOL rc = FALSE;
+	gdiPalette palette = { 0 };
+	HGDI_BRUSH brush = gdi_CreateSolidBrush(color);
+
+	if (!brush)
+		return FALSE;
+
+	gdi_SelectObject(hdc, (HGDIOBJECT)brush);
+
+	for (x = 0; x < count; x++)
+	{
+		const TestPlacement* p = &placements[x];
+		const HGDI_BITMAP bmp = glyphs[x % TEST_GLYPHS]->bitmap;
+
+		if (!gdi_BitBlt(hdc, p->x, p->y, bmp->width - p->sx, bmp->height - p->sy,
+		                glyphs[x % TEST_GLYPHS]->hdc, p->sx, p->sy, GDI_GLYPH_ORDER, &palette))
+			goto fail;
+	}
+
+	rc = TRUE;
+fail:
+	hdc->brush = NULL;
+	gdi_DeleteObject((HGDIOBJECT)brush);
+	return rc;
+}
+
+static BOOL test_draw_run(gdiGlyphRun* run, HGDI_DC hdc, gdiGlyph** glyphs,
+                          const TestPlacement* placements, size_t count, UINT32 color)
+{
+	size_t x;
+
+	gdi_glyph_run_reset(run);
+
+	for (x = 0; x < count; x++)
+	{
+		const TestPlacement* p = &placements[x];
+		const gdiGlyph* glyph = glyphs[x % TEST_GLYPHS];
+
+		if (!gdi_glyph_run_add(run, glyph, p->x, p->y, glyph->bitmap->width - p->sx,
+		                       glyph->bitmap->height - p->sy, p->sx, p->sy))
+			return FALSE;
+	}
+
+	return gdi_glyph_run_draw(run, hdc, color);
+}
+
+static BOOL test_compare(HGDI_DC hdc1, HGDI_DC hdc2, const char* name)
+{
+	const HGDI_BITMAP bmp1 = (HGDI_BITMAP)hdc1->selectedObject;
+	const HGDI_BITMAP bmp2 = (HGDI_BITMAP)hdc2->selectedObject;
+
+	if (memcmp(bmp1->data, bmp2->data, 1ull * bmp1->scanline * bmp1->height) != 0)
+	{
+		fprintf(stderr, "%s: %s glyph run differs from BitBlt\n", name,
+		        FreeRDPGetColorFormatName(hdc1->format));
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+static BOOL test_set_clip(HGDI_DC hdc1, HGDI_DC hdc2, INT32 x, INT32 y, INT32 w, INT32 h)
+{
+	if ((w == 0) || (h == 0))
+		return gdi_SetNullClipRgn(hdc1) && gdi_SetNullClipRgn(hdc2);
+
+	return gdi_SetClipRgn(hdc1, x, y, w, h) && gdi_SetClipRgn(hdc2, x, y, w, h);
+}
+
+static BOOL test_format(UINT32 format, gdiGlyph** glyphs, gdiGlyphRun* run, BOOL benchmark)
+{
+	size_t x;
+	BOOL rc = FALSE;
+	UINT32 seed = 7;
+	TestPlacement placements[48];
+	const UINT32 color = FreeRDPGetColor(format, 0x20, 0xC0, 0x60, 0xFF);
+	HGDI_DC hdcBitBlt = test_dc_new(format);
+	HGDI_DC hdcRun = test_dc_new(format);
+
+	if (!hdcBitBlt || !hdcRun)
+		goto fail;
+
+	/* Overlapping glyphs crossing the surface edges, some with a source offset */
+	for (x = 0; x < ARRAYSIZE(placements); x++)
+	{
+		placements[x].x = (INT32)x * 6 - 8;
+		placements[x].y = (INT32)(test_random(&seed) % 40) - 8;
+		placements[x].sx = (x % 5 == 0) ? 2 : 0;
+		placements[x].sy = (x % 7 == 0) ? 3 : 0;
+	}
+
+	if (!test_set_clip(hdcBitBlt, hdcRun, 0, 0, 0, 0) ||
+	    !test_draw_bitblt(hdcBitBlt, glyphs, placements, ARRAYSIZE(placements), color) ||
+	    !test_draw_run(run, hdcRun, glyphs, placements, ARRAYSIZE(placements), color) ||
+	    !test_compare(hdcBitBlt, hdcRun, "unclipped"))
+		goto fail;
+
+	if (!test_set_clip(hdcBitBlt, hdcRun, 13, 5, 170, 19) ||
+	    !test_draw_bitblt(hdcBitBlt, glyphs, placements, ARRAYSIZE(placements), color ^ 0xFF) ||
+	    !test_draw_run(run, hdcRun, glyphs, placements, ARRAYSIZE(placements), color ^ 0xFF) ||
+	    !test_compare(hdcBitBlt, hdcRun, "clipped"))
+		goto fail;
+
+	if (benchmark)
+	{
+		UINT64 start, bitblt, glyphRun;
+
+		start = GetTickCount64();
+
+		for (x = 0; x < TEST_BENCHMARK_RUNS; x++)
+			test_draw_bitblt(hdcBitBlt, glyphs, placements, ARRAYSIZE(placements), color);
+
+		bitblt = GetTickCount64() - start;
+		start = GetTickCount64();
+
+		for (x = 0; x < TEST_BENCHMARK_RUNS; x++)
+			test_draw_run(run, hdcRun, glyphs, placements, ARRAYSIZE(placements), color);
+
+		glyphRun = GetTickCount64() - start;
+		printf("%-24s %" PRIuz " runs of %" PRIuz " glyphs: BitBlt %" PRIu64 "ms, "
+		       "glyph run %" PRIu64 "ms\n",
+		       FreeRDPGetColorFormatName(format), (size_t)TEST_BENCHMARK_RUNS,
+		       ARRAYSIZE(placements), bitblt, glyphRun);
+	}
+
+	rc = TRUE;
+fail:
+	test_dc_free(hdcBitBlt);
+	test_dc_free(hdcRun);
+	return rc;
+}
+
+/* Pass "benchmark" as argument to compare the speed of both paths */
+int TestGdiGlyph(int argc, char* argv[])
+{
+	int rc = -1;
+	size_t x;
+	gdiGlyph* glyphs[TEST_GLYPHS] = { 0 };
+	gdiGlyphRun* run = gdi_glyph_run_new();
+	const BOOL benchmark = (argc > 1) && (strcmp(argv[argc - 1], "benchmark") == 0);
+	/* The BitBlt path clears the alpha of unset pixels, formats with alpha are not compared */
+	const UINT32 formats[] = { PIXEL_FORMAT_RGB16,  PIXEL_FORMAT_BGR24,  PIXEL_FORMAT_RGB24,
+		                       PIXEL_FORMAT_XRGB32, PIXEL_FORMAT_XBGR32, PIXEL_FORMAT_BGRX32,
+		                       PIXEL_FORMAT_RGBX32 };
+
+	if (!run || !test_glyphs_new(glyphs, ARRAYSIZE(glyphs)))
+		goto fail;
+
+	for (x = 0; x < ARRAYSIZE(formats); x++)
+	{
+		if (!test_format(formats[x], glyphs, run, benchmark))
+			goto fail;
+	}
+
+	rc = 0;
+fail:
+	test_glyphs_free(glyphs, ARRAYSIZE(glyphs));
+	gdi_glyph_run_free(run);
+	return rc;
+}
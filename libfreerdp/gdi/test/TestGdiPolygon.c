@@ -0,0 +1,269 @@
+#include <freerdp/gdi/gdi.h>
+
+#include <freerdp/gdi/dc.h>
+#include <freerdp/gdi/shape.h>
+#include <freerdp/gdi/region.h>
+#include <freerdp/gdi/bitmap.h>
+
+#include <winpr/crt.h>
+
+#include "brush.h"
+#include "drawing.h"
+#include "clipping.h"
+
+/* Reference renderings, a pixel is set if its center is inside the polygon.
+ * Centers on a left or top edge are inside, on a right or bottom edge outside. */
+
+static const GDI_POINT star_points[] = { { 8, 0 }, { 13, 16 }, { 0, 6 }, { 16, 6 }, { 3, 16 } };
+
+static const char* star_alternate[16] = {
+	"................", "................", ".......##.......", ".......##.......",
+	".......##.......", "......####......", ".#####....#####.", "..####....####..",
+	"...##......##...", "................", ".....#....#.....", "....###..###....",
+	"....########....", "....##....##....", "...##......##...", "...#........#..."
+};
+
+static const char* star_winding[16] = {
+	"................", "................", ".......##.......", ".......##.......",
+	".......##.......", "......####......", ".##############.", "..############..",
+	"...##########...", ".....######.....", ".....######.....", "....########....",
+	"....########....", "....##....##....", "...##......##...", "...#........#..."
+};
+
+/* Two squares of the same orientation, the inner one is a hole with the alternate mode only */
+static const GDI_POINT frame_points[] = { { 1, 1 },   { 15, 1 }, { 15, 15 }, { 1, 15 },
+	                                      { 5, 5 },   { 11, 5 }, { 11, 11 }, { 5, 11 } };
+
+static const char* frame_alternate[16] = {
+	"................", ".##############.", ".##############.", ".##############.",
+	".##############.", ".####......####.", ".####......####.", ".####......####.",
+	".####......####.", ".####......####.", ".####......####.", ".##############.",
+	".##############.", ".##############.", ".##############.", "................"
+};
+
+static const char* frame_winding[16] = {
+	"................", ".##############.", ".##############.", ".##############.",
+	".##############.", ".##############.", ".##############.", ".##############.",
+	".##############.", ".##############.", ".##############.", ".##############.",
+	".##############.", ".##############.", ".##############.", "................"
+};
+
+/* Partially outside of the bitmap */
+static const GDI_POINT clipped_points[] = { { -6, -4 }, { 20, 3 }, { 9, 22 } };
+
+static const char* clipped_alternate[16] = {
+	"###########.....", "##############..", "################", "################",
+	"################", "################", "################", ".###############",
+	".###############", "..##############", "..##############", "...############.",
+	"....##########..", "....##########..", ".....########...", ".....########..."
+};
+
+static const BYTE pattern_bits[8 * 8] = {
+	1, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 1,
+	1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 0, 1, 0, 1, 0, 1, 0, 0, 1, 0, 1, 0, 1, 0, 1
+};
+
+static const GDI_POINT square_points[] = { { 0, 0 }, { 16, 0 }, { 16, 16 }, { 0, 16 } };
+
+static BOOL test_clear(HGDI_DC hdc, UINT32 color)
+{
+	UINT32 x, y;
+
+	for (y = 0; y < 16; y++)
+	{
+		for (x = 0; x < 16; x++)
+			gdi_SetPixel(hdc, x, y, color);
+	}
+
+	return TRUE;
+}
+
+static BOOL test_compare(HGDI_DC hdc, const char* const* expected, UINT32 fg, UINT32 bg,
+                         const char* name)
+{
+	UINT32 x, y;
+
+	for (y = 0; y < 16; y++)
+	{
+		for (x = 0; x < 16; x++)
+		{
+			const UINT32 color = (expected[y][x] == '#') ? fg : bg;
+
+			if (gdi_GetPixel(hdc, x, y) != color)
+			{
+				fprintf(stderr, "%s: %s mismatch at %" PRIu32 "x%" PRIu32 "\n", name,
+				        FreeRDPGetColorFormatName(hdc->format), x, y);
+				return FALSE;
+			}
+		}
+	}
+
+	return TRUE;
+}
+
+static BOOL test_fill_modes(HGDI_DC hdc, UINT32 fg, UINT32 bg)
+{
+	int counts[] = { 4, 4 };
+
+	gdi_SetPolyFillMode(hdc, GDI_FILL_ALTERNATE);
+	test_clear(hdc, bg);
+
+	if (!gdi_Polygon(hdc, (GDI_POINT*)star_points, ARRAYSIZE(star_points)) ||
+	    !test_compare(hdc, star_alternate, fg, bg, "star alternate"))
+		return FALSE;
+
+	test_clear(hdc, bg);
+
+	if (!gdi_PolyPolygon(hdc, (GDI_POINT*)frame_points, counts, ARRAYSIZE(counts)) ||
+	    !test_compare(hdc, frame_alternate, fg, bg, "frame alternate"))
+		return FALSE;
+
+	test_clear(hdc, bg);
+
+	if (!gdi_Polygon(hdc, (GDI_POINT*)clipped_points, ARRAYSIZE(clipped_points)) ||
+	    !test_compare(hdc, clipped_alternate, fg, bg, "clipped"))
+		return FALSE;
+
+	gdi_SetPolyFillMode(hdc, GDI_FILL_WINDING);
+	test_clear(hdc, bg);
+
+	if (!gdi_Polygon(hdc, (GDI_POINT*)star_points, ARRAYSIZE(star_points)) ||
+	    !test_compare(hdc, star_winding, fg, bg, "star winding"))
+		return FALSE;
+
+	test_clear(hdc, bg);
+
+	if (!gdi_PolyPolygon(hdc, (GDI_POINT*)frame_points, counts, ARRAYSIZE(counts)) ||
+	    !test_compare(hdc, frame_winding, fg, bg, "frame winding"))
+		return FALSE;
+
+	gdi_SetPolyFillMode(hdc, GDI_FILL_ALTERNATE);
+	return TRUE;
+}
+
+/* A monochrome pattern is anchored at the brush origin, the background is skipped when
+ * transparent */
+static BOOL test_pattern(HGDI_DC hdc, UINT32 fg, UINT32 bg, UINT32 bk, INT32 bkMode)
+{
+	UINT32 x, y;
+	BOOL rc = FALSE;
+	HGDI_BITMAP hBmp = gdi_CreateBitmapEx(8, 8, PIXEL_FORMAT_MONO, 0, (BYTE*)pattern_bits, NULL);
+	HGDI_BRUSH hBrush = hBmp ? gdi_CreatePatternBrush(hBmp) : NULL;
+	HGDI_BRUSH original = hdc->brush;
+
+	if (!hBrush)
+		goto fail;
+
+	hBrush->nXOrg = 3;
+	hBrush->nYOrg = 5;
+	hdc->brush = hBrush;
+	gdi_SetTextColor(hdc, fg);
+	gdi_SetBkColor(hdc, bk);
+	gdi_SetBkMode(hdc, bkMode);
+	test_clear(hdc, bg);
+
+	if (!gdi_Polygon(hdc, (GDI_POINT*)square_points, ARRAYSIZE(square_points)))
+		goto fail;
+
+	for (y = 0; y < 16; y++)
+	{
+		for (x = 0; x < 16; x++)
+		{
+			const BYTE bit = pattern_bits[((y + 8 - 5) % 8) * 8 + (x + 8 - 3) % 8];
+			const UINT32 color = bit ? fg : ((bkMode == GDI_TRANSPARENT) ? bg : bk);
+
+			if (gdi_GetPixel(hdc, x, y) != color)
+			{
+				fprintf(stderr, "pattern: %s mismatch at %" PRIu32 "x%" PRIu32 "\n",
+				        FreeRDPGetColorFormatName(hdc->format), x, y);
+				goto fail;
+			}
+		}
+	}
+
+	rc = TRUE;
+fail:
+	hdc->brush = original;
+	gdi_DeleteObject((HGDIOBJECT)hBrush);
+	gdi_DeleteObject((HGDIOBJECT)hBmp);
+	return rc;
+}
+
+/* R2_XORPEN applied twice restores the destination, R2_NOP leaves it untouched */
+static BOOL test_rop2(HGDI_DC hdc, UINT32 fg, UINT32 bg)
+{
+	gdi_SetROP2(hdc, GDI_R2_XORPEN);
+	test_clear(hdc, bg);
+
+	if (!gdi_Polygon(hdc, (GDI_POINT*)star_points, ARRAYSIZE(star_points)) ||
+	    !test_compare(hdc, star_alternate, bg ^ fg, bg, "xor"))
+		return FALSE;
+
+	if (!gdi_Polygon(hdc, (GDI_POINT*)star_points, ARRAYSIZE(star_points)) ||
+	    !test_compare(hdc, star_alternate, bg, bg, "xor twice"))
+		return FALSE;
+
+	gdi_SetROP2(hdc, GDI_R2_NOP);
+
+	if (!gdi_Polygon(hdc, (GDI_POINT*)star_points, ARRAYSIZE(star_points)) ||
+	    !test_compare(hdc, star_alternate, bg, bg, "nop"))
+		return FALSE;
+
+	gdi_SetROP2(hdc, GDI_R2_COPYPEN);
+	return TRUE;
+}
+
+int TestGdiPolygon(int argc, char* argv[])
+{
+	int rc = -1;
+	UINT32 i;
+	const UINT32 colorFormats[] = { PIXEL_FORMAT_RGB16, PIXEL_FORMAT_RGB24, PIXEL_FORMAT_XRGB32,
+		                            PIXEL_FORMAT_BGRA32 };
+
+	WINPR_UNUSED(argc);
+	WINPR_UNUSED(argv);
+
+	for (i = 0; i < ARRAYSIZE(colorFormats); i++)
+	{
+		HGDI_DC hdc = NULL;
+		HGDI_BITMAP hBmp = NULL;
+		HGDI_BRUSH hBrush = NULL;
+		const UINT32 format = colorFormats[i];
+		const UINT32 fg = FreeRDPGetColor(format, 0x20, 0x80, 0xF0, 0xFF);
+		const UINT32 bg = FreeRDPGetColor(format, 0xF8, 0xF8, 0xF8, 0xFF);
+		const UINT32 bk = FreeRDPGetColor(format, 0x80, 0x00, 0x00, 0xFF);
+
+		rc = -1;
+
+		if (!(hdc = gdi_GetDC()))
+			goto fail;
+
+		hdc->format = format;
+		gdi_SetNullClipRgn(hdc);
+		hBmp = gdi_CreateCompatibleBitmap(hdc, 16, 16);
+		hBrush = gdi_CreateSolidBrush(fg);
+
+		if (!hBmp || !hBrush)
+			goto fail;
+
+		gdi_SelectObject(hdc, (HGDIOBJECT)hBmp);
+		gdi_SelectObject(hdc, (HGDIOBJECT)hBrush);
+		gdi_SetROP2(hdc, GDI_R2_COPYPEN);
+
+		if (!test_fill_modes(hdc, fg, bg) || !test_rop2(hdc, fg, bg) ||
+		    !test_pattern(hdc, fg, bg, bk, GDI_OPAQUE) ||
+		    !test_pattern(hdc, fg, bg, bk, GDI_TRANSPARENT))
+			goto fail;
+
+		rc = 0;
+	fail:
+		gdi_DeleteObject((HGDIOBJECT)hBrush);
+		gdi_DeleteObject((HGDIOBJECT)hBmp);
+		gdi_DeleteDC(hdc);
+
+		if (rc != 0)
+			break;
+	}
+
+	return rc;
+}
@@ -18,6 +18,7 @@
 #endif
 
 #include <string.h>
+#include <winpr/synch.h>
 #include <freerdp/types.h>
 #include <freerdp/primitives.h>
 #ifdef WITH_IPP
@@ -134,6 +135,229 @@ static pstatus_t general_copy_8u_AC4r(const BYTE* pSrc, INT32 srcStep, BYTE* pDs
 	return PRIMITIVES_SUCCESS;
 }
 
+/* ------------------------------------------------------------------------- */
+/* Byte positions of the color channels as stored in memory, 16 bpp formats use the
+ * position of the 5-6-5 bit field counted from the most significant one.
+ */
+typedef struct
+{
+	UINT32 format;
+	BYTE r;
+	BYTE g;
+	BYTE b;
+	BYTE a;
+	BOOL writeAlpha;
+} PRIM_COLOR_LAYOUT;
+
+static const PRIM_COLOR_LAYOUT color_layouts[] = {
+	{ PIXEL_FORMAT_ARGB32, 1, 2, 3, 0, TRUE },  { PIXEL_FORMAT_XRGB32, 1, 2, 3, 0, FALSE },
+	{ PIXEL_FORMAT_ABGR32, 3, 2, 1, 0, TRUE },  { PIXEL_FORMAT_XBGR32, 3, 2, 1, 0, FALSE },
+	{ PIXEL_FORMAT_RGBA32, 0, 1, 2, 3, TRUE },  { PIXEL_FORMAT_RGBX32, 0, 1, 2, 3, TRUE },
+	{ PIXEL_FORMAT_BGRA32, 2, 1, 0, 3, TRUE },  { PIXEL_FORMAT_BGRX32, 2, 1, 0, 3, TRUE },
+	{ PIXEL_FORMAT_RGB24, 0, 1, 2, 0, FALSE },  { PIXEL_FORMAT_BGR24, 2, 1, 0, 0, FALSE },
+	{ PIXEL_FORMAT_RGB16, 0, 1, 2, 0, FALSE },  { PIXEL_FORMAT_BGR16, 2, 1, 0, 0, FALSE }
+};
+
+#define COLOR_LAYOUT_COUNT ARRAYSIZE(color_layouts)
+
+static INIT_ONCE color_conversions_once = INIT_ONCE_STATIC_INIT;
+static PRIM_COLOR_CONVERSION color_conversions[COLOR_LAYOUT_COUNT][COLOR_LAYOUT_COUNT];
+
+static void color_conversion_init(PRIM_COLOR_CONVERSION* conv, const PRIM_COLOR_LAYOUT* src,
+                                  const PRIM_COLOR_LAYOUT* dst)
+{
+	size_t x;
+	BYTE alpha = PRIM_CONVERT_FILL;
+
+	/* Mirrors SplitColor / FreeRDPGetColor: formats without alpha read as opaque,
+	 * XRGB32 and XBGR32 always write 0 to the unused byte. */
+	if (ColorHasAlpha(src->format))
+		alpha = src->a;
+
+	conv->SrcFormat = src->format;
+	conv->DstFormat = dst->format;
+	conv->srcBytes = GetBytesPerPixel(src->format);
+	conv->dstBytes = GetBytesPerPixel(dst->format);
+
+	for (x = 0; x < 4; x++)
+	{
+		conv->shuffle[x] = PRIM_CONVERT_FILL;
+		conv->fill[x] = 0;
+	}
+
+	conv->shuffle[dst->r] = src->r;
+	conv->shuffle[dst->g] = src->g;
+	conv->shuffle[dst->b] = src->b;
+
+	if ((conv->dstBytes == 4) && dst->writeAlpha)
+	{
+		conv->shuffle[dst->a] = alpha;
+
+		if (alpha == PRIM_CONVERT_FILL)
+			conv->fill[dst->a] = 0xFF;
+	}
+}
+
+static BOOL CALLBACK color_conversions_init(PINIT_ONCE once, PVOID param, PVOID* context)
+{
+	size_t x, y;
+	WINPR_UNUSED(once);
+	WINPR_UNUSED(param);
+	WINPR_UNUSED(context);
+
+	for (y = 0; y < COLOR_LAYOUT_COUNT; y++)
+	{
+		for (x = 0; x < COLOR_LAYOUT_COUNT; x++)
+			color_conversion_init(&color_conversions[y][x], &color_layouts[y], &color_layouts[x]);
+	}
+
+	return TRUE;
+}
+
+static const PRIM_COLOR_LAYOUT* color_layout_index(UINT32 format, size_t* index)
+{
+	size_t x;
+
+	for (x = 0; x < COLOR_LAYOUT_COUNT; x++)
+	{
+		if (color_layouts[x].format == format)
+		{
+			*index = x;
+			return &color_layouts[x];
+		}
+	}
+
+	return NULL;
+}
+
+const PRIM_COLOR_CONVERSION* primitives_get_color_conversion(UINT32 SrcFormat, UINT32 DstFormat)
+{
+	size_t src, dst;
+
+	if (!color_layout_index(SrcFormat, &src) || !color_layout_index(DstFormat, &dst))
+		return NULL;
+
+	InitOnceExecuteOnce(&color_conversions_once, color_conversions_init, NULL, NULL);
+	return &color_conversions[src][dst];
+}
+
+static INLINE BYTE expand_5bit(UINT32 c)
+{
+	return (BYTE)((c << 3) + (c >> 2));
+}
+
+static INLINE BYTE expand_6bit(UINT32 c)
+{
+	const UINT32 val = (c << 2) + (c >> 3);
+	return (BYTE)(val > 255 ? 255 : val);
+}
+
+static INLINE void general_convert_pixel(const PRIM_COLOR_CONVERSION* conv, const BYTE* src,
+                                         BYTE* dst, UINT32 srcBytes, UINT32 dstBytes)
+{
+	UINT32 x;
+	BYTE px[4] = { 0 };
+	BYTE out[4];
+
+	if (srcBytes == 2)
+	{
+		const UINT32 val = ((UINT32)src[1] << 8) | src[0];
+		px[0] = expand_5bit((val >> 11) & 0x1F);
+		px[1] = expand_6bit((val >> 5) & 0x3F);
+		px[2] = expand_5bit(val & 0x1F);
+	}
+	else
+	{
+		for (x = 0; x < srcBytes; x++)
+			px[x] = src[x];
+	}
+
+	for (x = 0; x < 4; x++)
+	{
+		const BYTE pos = conv->shuffle[x];
+		out[x] = (pos == PRIM_CONVERT_FILL) ? conv->fill[x] : px[pos];
+	}
+
+	if (dstBytes == 2)
+	{
+		const UINT32 val = ((UINT32)(out[0] >> 3) << 11) | ((UINT32)(out[1] >> 2) << 5) |
+		                   (out[2] >> 3);
+		dst[0] = (BYTE)val;
+		dst[1] = (BYTE)(val >> 8);
+	}
+	else
+	{
+		for (x = 0; x < dstBytes; x++)
+			dst[x] = out[x];
+	}
+}
+
+#define GENERAL_CONVERT_ROW(_src_, _dst_)                                                        \
+	static void general_convert_row_##_src_##_##_dst_(const PRIM_COLOR_CONVERSION* conv,         \
+	                                                  const BYTE* pSrc, BYTE* pDst, UINT32 width) \
+	{                                                                                            \
+		UINT32 x;                                                                                \
+		for (x = 0; x < width; x++)                                                              \
+			general_convert_pixel(conv, &pSrc[x * _src_], &pDst[x * _dst_], _src_, _dst_);       \
+	}
+
+GENERAL_CONVERT_ROW(2, 2)
+GENERAL_CONVERT_ROW(2, 3)
+GENERAL_CONVERT_ROW(2, 4)
+GENERAL_CONVERT_ROW(3, 2)
+GENERAL_CONVERT_ROW(3, 3)
+GENERAL_CONVERT_ROW(3, 4)
+GENERAL_CONVERT_ROW(4, 2)
+GENERAL_CONVERT_ROW(4, 3)
+GENERAL_CONVERT_ROW(4, 4)
+
+static const PRIM_CONVERT_ROWS general_convert_rows = {
+	{ general_convert_row_2_2, general_convert_row_2_3, general_convert_row_2_4 },
+	{ general_convert_row_3_2, general_convert_row_3_3, general_convert_row_3_4 },
+	{ general_convert_row_4_2, general_convert_row_4_3, general_convert_row_4_4 }
+};
+
+void primitives_convert_row_generic(const PRIM_COLOR_CONVERSION* conv, const BYTE* pSrc, BYTE* pDst,
+                                    UINT32 width)
+{
+	general_convert_rows[conv->srcBytes - 2][conv->dstBytes - 2](conv, pSrc, pDst, width);
+}
+
+/* ------------------------------------------------------------------------- */
+pstatus_t primitives_copy_convert(const PRIM_CONVERT_ROWS rows, const BYTE* pSrc,
+                                  UINT32 SrcFormat, INT32 srcStep, BYTE* pDst, UINT32 DstFormat,
+                                  INT32 dstStep, UINT32 width, UINT32 height)
+{
+	UINT32 y;
+	__convert_row_t row;
+	const PRIM_COLOR_CONVERSION* conv = primitives_get_color_conversion(SrcFormat, DstFormat);
+
+	if (!conv || !pSrc || !pDst)
+		return -1;
+
+	row = rows[conv->srcBytes - 2][conv->dstBytes - 2];
+
+	if (!row)
+		row = general_convert_rows[conv->srcBytes - 2][conv->dstBytes - 2];
+
+	for (y = 0; y < height; y++)
+	{
+		row(conv, pSrc, pDst, width);
+		pSrc += srcStep;
+		pDst += dstStep;
+	}
+
+	return PRIMITIVES_SUCCESS;
+}
+
+static pstatus_t general_copy_convert_8u(const BYTE* pSrc, UINT32 SrcFormat, INT32 srcStep,
+                                         BYTE* pDst, UINT32 DstFormat, INT32 dstStep,
+                                         UINT32 width, UINT32 height)
+{
+	return primitives_copy_convert(general_convert_rows, pSrc, SrcFormat, srcStep, pDst,
+	                               DstFormat, dstStep, width, height);
+}
+
 #ifdef WITH_IPP
 /* ------------------------------------------------------------------------- */
 /* This is just ippiCopy_8u_AC4R without the IppiSize structure parameter.   */
@@ -153,6 +377,7 @@ void primitives_init_copy(primitives_t* prims)
 	/* Start with the default. */
 	prims->copy_8u = general_copy_8u;
 	prims->copy_8u_AC4r = general_copy_8u_AC4r;
+	prims->copy_convert_8u = general_copy_convert_8u;
 	/* This is just an alias with void* parameters */
 	prims->copy = (__copy_t)(prims->copy_8u);
 }
@@ -173,6 +398,11 @@ void primitives_init_copy_opt(primitives_t* prims)
 	 * Hence, no SSE version is used here unless once can be written that
 	 * is consistently faster than memcpy.
 	 */
+#if defined(WITH_SSE2)
+	primitives_init_copy_ssse3(prims);
+#elif defined(WITH_NEON)
+	primitives_init_copy_neon(prims);
+#endif
 	/* This is just an alias with void* parameters */
 	prims->copy = (__copy_t)(prims->copy_8u);
 }
@@ -0,0 +1,204 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * Optimized pixel format conversion operations
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <winpr/sysinfo.h>
+#include <freerdp/types.h>
+#include <freerdp/primitives.h>
+
+#include "prim_internal.h"
+
+#if !defined(WITH_NEON)
+#error "This file must only be included if WITH_NEON is active!"
+#endif
+
+#include <arm_neon.h>
+
+/* De-interleaved loads give one register per channel, the conversion just picks the
+ * registers in destination order. */
+static INLINE uint8x16_t neon_convert_channel(const PRIM_COLOR_CONVERSION* conv,
+                                              const uint8x16_t* src, UINT32 index)
+{
+	const BYTE pos = conv->shuffle[index];
+
+	if (pos == PRIM_CONVERT_FILL)
+		return vdupq_n_u8(conv->fill[index]);
+
+	return src[pos];
+}
+
+/* Expands 8 5-6-5 pixels to high, middle and low field */
+static INLINE void neon_expand_565(const BYTE* src, uint8x8_t* channels)
+{
+	const uint16x8_t val = vld1q_u16((const UINT16*)src);
+	const uint16x8_t h = vshrq_n_u16(val, 11);
+	const uint16x8_t m = vandq_u16(vshrq_n_u16(val, 5), vdupq_n_u16(0x3F));
+	const uint16x8_t l = vandq_u16(val, vdupq_n_u16(0x1F));
+	const uint16x8_t m8 = vaddq_u16(vshlq_n_u16(m, 2), vshrq_n_u16(m, 3));
+	channels[0] = vmovn_u16(vorrq_u16(vshlq_n_u16(h, 3), vshrq_n_u16(h, 2)));
+	channels[1] = vqmovn_u16(m8);
+	channels[2] = vmovn_u16(vorrq_u16(vshlq_n_u16(l, 3), vshrq_n_u16(l, 2)));
+	channels[3] = vdup_n_u8(0);
+}
+
+static INLINE uint8x8_t neon_convert_channel_half(const PRIM_COLOR_CONVERSION* conv,
+                                                  const uint8x8_t* src, UINT32 index)
+{
+	const BYTE pos = conv->shuffle[index];
+
+	if (pos == PRIM_CONVERT_FILL)
+		return vdup_n_u8(conv->fill[index]);
+
+	return src[pos];
+}
+
+static void neon_convert_row_4_4(const PRIM_COLOR_CONVERSION* conv, const BYTE* pSrc,
+                                 BYTE* pDst, UINT32 width)
+{
+	UINT32 x;
+
+	for (x = 0; x + 16 <= width; x += 16)
+	{
+		const uint8x16x4_t src = vld4q_u8(&pSrc[x * 4]);
+		uint8x16x4_t dst;
+		dst.val[0] = neon_convert_channel(conv, src.val, 0);
+		dst.val[1] = neon_convert_channel(conv, src.val, 1);
+		dst.val[2] = neon_convert_channel(conv, src.val, 2);
+		dst.val[3] = neon_convert_channel(conv, src.val, 3);
+		vst4q_u8(&pDst[x * 4], dst);
+	}
+
+	primitives_convert_row_generic(conv, &pSrc[x * 4], &pDst[x * 4], width - x);
+}
+
+static void neon_convert_row_3_4(const PRIM_COLOR_CONVERSION* conv, const BYTE* pSrc,
+                                 BYTE* pDst, UINT32 width)
+{
+	UINT32 x;
+
+	for (x = 0; x + 16 <= width; x += 16)
+	{
+		const uint8x16x3_t src = vld3q_u8(&pSrc[x * 3]);
+		uint8x16x4_t dst;
+		dst.val[0] = neon_convert_channel(conv, src.val, 0);
+		dst.val[1] = neon_convert_channel(conv, src.val, 1);
+		dst.val[2] = neon_convert_channel(conv, src.val, 2);
+		dst.val[3] = neon_convert_channel(conv, src.val, 3);
+		vst4q_u8(&pDst[x * 4], dst);
+	}
+
+	primitives_convert_row_generic(conv, &pSrc[x * 3], &pDst[x * 4], width - x);
+}
+
+static void neon_convert_row_4_3(const PRIM_COLOR_CONVERSION* conv, const BYTE* pSrc,
+                                 BYTE* pDst, UINT32 width)
+{
+	UINT32 x;
+
+	for (x = 0; x + 16 <= width; x += 16)
+	{
+		const uint8x16x4_t src = vld4q_u8(&pSrc[x * 4]);
+		uint8x16x3_t dst;
+		dst.val[0] = neon_convert_channel(conv, src.val, 0);
+		dst.val[1] = neon_convert_channel(conv, src.val, 1);
+		dst.val[2] = neon_convert_channel(conv, src.val, 2);
+		vst3q_u8(&pDst[x * 3], dst);
+	}
+
+	primitives_convert_row_generic(conv, &pSrc[x * 4], &pDst[x * 3], width - x);
+}
+
+static void neon_convert_row_3_3(const PRIM_COLOR_CONVERSION* conv, const BYTE* pSrc,
+                                 BYTE* pDst, UINT32 width)
+{
+	UINT32 x;
+
+	for (x = 0; x + 16 <= width; x += 16)
+	{
+		const uint8x16x3_t src = vld3q_u8(&pSrc[x * 3]);
+		uint8x16x3_t dst;
+		dst.val[0] = neon_convert_channel(conv, src.val, 0);
+		dst.val[1] = neon_convert_channel(conv, src.val, 1);
+		dst.val[2] = neon_convert_channel(conv, src.val, 2);
+		vst3q_u8(&pDst[x * 3], dst);
+	}
+
+	primitives_convert_row_generic(conv, &pSrc[x * 3], &pDst[x * 3], width - x);
+}
+
+static void neon_convert_row_2_4(const PRIM_COLOR_CONVERSION* conv, const BYTE* pSrc,
+                                 BYTE* pDst, UINT32 width)
+{
+	UINT32 x;
+
+	for (x = 0; x + 8 <= width; x += 8)
+	{
+		uint8x8_t src[4];
+		uint8x8x4_t dst;
+		neon_expand_565(&pSrc[x * 2], src);
+		dst.val[0] = neon_convert_channel_half(conv, src, 0);
+		dst.val[1] = neon_convert_channel_half(conv, src, 1);
+		dst.val[2] = neon_convert_channel_half(conv, src, 2);
+		dst.val[3] = neon_convert_channel_half(conv, src, 3);
+		vst4_u8(&pDst[x * 4], dst);
+	}
+
+	primitives_convert_row_generic(conv, &pSrc[x * 2], &pDst[x * 4], width - x);
+}
+
+static void neon_convert_row_2_3(const PRIM_COLOR_CONVERSION* conv, const BYTE* pSrc,
+                                 BYTE* pDst, UINT32 width)
+{
+	UINT32 x;
+
+	for (x = 0; x + 8 <= width; x += 8)
+	{
+		uint8x8_t src[4];
+		uint8x8x3_t dst;
+		neon_expand_565(&pSrc[x * 2], src);
+		dst.val[0] = neon_convert_channel_half(conv, src, 0);
+		dst.val[1] = neon_convert_channel_half(conv, src, 1);
+		dst.val[2] = neon_convert_channel_half(conv, src, 2);
+		vst3_u8(&pDst[x * 3], dst);
+	}
+
+	primitives_convert_row_generic(conv, &pSrc[x * 2], &pDst[x * 3], width - x);
+}
+
+/* Packing to 16 bpp is left to the generic kernels */
+static const PRIM_CONVERT_ROWS neon_convert_rows = {
+	{ NULL, neon_convert_row_2_3, neon_convert_row_2_4 },
+	{ NULL, neon_convert_row_3_3, neon_convert_row_3_4 },
+	{ NULL, neon_convert_row_4_3, neon_convert_row_4_4 }
+};
+
+static pstatus_t neon_copy_convert_8u(const BYTE* pSrc, UINT32 SrcFormat, INT32 srcStep,
+                                      BYTE* pDst, UINT32 DstFormat, INT32 dstStep, UINT32 width,
+                                      UINT32 height)
+{
+	return primitives_copy_convert(neon_convert_rows, pSrc, SrcFormat, srcStep, pDst, DstFormat,
+	                               dstStep, width, height);
+}
+
+void primitives_init_copy_neon(primitives_t* prims)
+{
+	if (IsProcessorFeaturePresent(PF_ARM_NEON_INSTRUCTIONS_AVAILABLE))
+		prims->copy_convert_8u = neon_copy_convert_8u;
+}
@@ -0,0 +1,218 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * Optimized pixel format conversion operations
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+#include <winpr/sysinfo.h>
+#include <freerdp/types.h>
+#include <freerdp/primitives.h>
+
+#include "prim_internal.h"
+
+#include <emmintrin.h>
+#include <tmmintrin.h>
+
+#if !defined(WITH_SSE2)
+#error "This file needs WITH_SSE2 enabled!"
+#endif
+
+/* Builds the pshufb mask converting 4 pixels, unused destination bytes and filled channels
+ * are zeroed by the shuffle. */
+static INLINE __m128i ssse3_convert_mask(const PRIM_COLOR_CONVERSION* conv, UINT32 srcBytes,
+                                         UINT32 dstBytes)
+{
+	BYTE PRIM_ALIGN_128 mask[16];
+	UINT32 pixel;
+
+	memset(mask, 0x80, sizeof(mask));
+
+	for (pixel = 0; pixel < 4; pixel++)
+	{
+		UINT32 i;
+
+		for (i = 0; i < dstBytes; i++)
+		{
+			const BYTE pos = conv->shuffle[i];
+
+			if (pos != PRIM_CONVERT_FILL)
+				mask[pixel * dstBytes + i] = (BYTE)(pixel * srcBytes + pos);
+		}
+	}
+
+	return _mm_load_si128((const __m128i*)mask);
+}
+
+static INLINE __m128i ssse3_convert_fill(const PRIM_COLOR_CONVERSION* conv)
+{
+	UINT32 fill;
+	memcpy(&fill, conv->fill, sizeof(fill));
+	return _mm_set1_epi32((int)fill);
+}
+
+static INLINE void ssse3_store_12(BYTE* dst, __m128i val)
+{
+	const int last = _mm_cvtsi128_si32(_mm_srli_si128(val, 8));
+	_mm_storel_epi64((__m128i*)dst, val);
+	memcpy(&dst[8], &last, sizeof(last));
+}
+
+/* Expands 8 5-6-5 pixels to 8 four byte pixels (high, middle, low field, 0) */
+static INLINE void ssse3_expand_565(const BYTE* src, __m128i* lo, __m128i* hi)
+{
+	const __m128i mask5 = _mm_set1_epi16(0x1F);
+	const __m128i mask6 = _mm_set1_epi16(0x3F);
+	const __m128i max = _mm_set1_epi16(0xFF);
+	const __m128i val = _mm_loadu_si128((const __m128i*)src);
+	const __m128i h = _mm_srli_epi16(val, 11);
+	const __m128i m = _mm_and_si128(_mm_srli_epi16(val, 5), mask6);
+	const __m128i l = _mm_and_si128(val, mask5);
+	const __m128i h8 = _mm_or_si128(_mm_slli_epi16(h, 3), _mm_srli_epi16(h, 2));
+	const __m128i m10 = _mm_add_epi16(_mm_slli_epi16(m, 2), _mm_srli_epi16(m, 3));
+	const __m128i m8 = _mm_min_epi16(m10, max);
+	const __m128i l8 = _mm_or_si128(_mm_slli_epi16(l, 3), _mm_srli_epi16(l, 2));
+	const __m128i hm = _mm_unpacklo_epi8(_mm_packus_epi16(h8, h8), _mm_packus_epi16(m8, m8));
+	const __m128i l0 = _mm_unpacklo_epi8(_mm_packus_epi16(l8, l8), _mm_setzero_si128());
+	*lo = _mm_unpacklo_epi16(hm, l0);
+	*hi = _mm_unpackhi_epi16(hm, l0);
+}
+
+static void ssse3_convert_row_4_4(const PRIM_COLOR_CONVERSION* conv, const BYTE* pSrc,
+                                  BYTE* pDst, UINT32 width)
+{
+	UINT32 x;
+	const __m128i mask = ssse3_convert_mask(conv, 4, 4);
+	const __m128i fill = ssse3_convert_fill(conv);
+
+	for (x = 0; x + 4 <= width; x += 4)
+	{
+		const __m128i val = _mm_loadu_si128((const __m128i*)&pSrc[x * 4]);
+		_mm_storeu_si128((__m128i*)&pDst[x * 4], _mm_or_si128(_mm_shuffle_epi8(val, mask), fill));
+	}
+
+	primitives_convert_row_generic(conv, &pSrc[x * 4], &pDst[x * 4], width - x);
+}
+
+static void ssse3_convert_row_3_4(const PRIM_COLOR_CONVERSION* conv, const BYTE* pSrc,
+                                  BYTE* pDst, UINT32 width)
+{
+	UINT32 x;
+	const __m128i mask = ssse3_convert_mask(conv, 3, 4);
+	const __m128i fill = ssse3_convert_fill(conv);
+
+	/* A 16 byte load covers 4 pixels, keep it inside of the row */
+	for (x = 0; x + 6 <= width; x += 4)
+	{
+		const __m128i val = _mm_loadu_si128((const __m128i*)&pSrc[x * 3]);
+		_mm_storeu_si128((__m128i*)&pDst[x * 4], _mm_or_si128(_mm_shuffle_epi8(val, mask), fill));
+	}
+
+	primitives_convert_row_generic(conv, &pSrc[x * 3], &pDst[x * 4], width - x);
+}
+
+static void ssse3_convert_row_4_3(const PRIM_COLOR_CONVERSION* conv, const BYTE* pSrc,
+                                  BYTE* pDst, UINT32 width)
+{
+	UINT32 x;
+	const __m128i mask = ssse3_convert_mask(conv, 4, 3);
+
+	for (x = 0; x + 4 <= width; x += 4)
+	{
+		const __m128i val = _mm_loadu_si128((const __m128i*)&pSrc[x * 4]);
+		ssse3_store_12(&pDst[x * 3], _mm_shuffle_epi8(val, mask));
+	}
+
+	primitives_convert_row_generic(conv, &pSrc[x * 4], &pDst[x * 3], width - x);
+}
+
+static void ssse3_convert_row_3_3(const PRIM_COLOR_CONVERSION* conv, const BYTE* pSrc,
+                                  BYTE* pDst, UINT32 width)
+{
+	UINT32 x;
+	const __m128i mask = ssse3_convert_mask(conv, 3, 3);
+
+	for (x = 0; x + 6 <= width; x += 4)
+	{
+		const __m128i val = _mm_loadu_si128((const __m128i*)&pSrc[x * 3]);
+		ssse3_store_12(&pDst[x * 3], _mm_shuffle_epi8(val, mask));
+	}
+
+	primitives_convert_row_generic(conv, &pSrc[x * 3], &pDst[x * 3], width - x);
+}
+
+static void ssse3_convert_row_2_4(const PRIM_COLOR_CONVERSION* conv, const BYTE* pSrc,
+                                  BYTE* pDst, UINT32 width)
+{
+	UINT32 x;
+	const __m128i mask = ssse3_convert_mask(conv, 4, 4);
+	const __m128i fill = ssse3_convert_fill(conv);
+
+	for (x = 0; x + 8 <= width; x += 8)
+	{
+		__m128i lo, hi;
+		ssse3_expand_565(&pSrc[x * 2], &lo, &hi);
+		lo = _mm_or_si128(_mm_shuffle_epi8(lo, mask), fill);
+		hi = _mm_or_si128(_mm_shuffle_epi8(hi, mask), fill);
+		_mm_storeu_si128((__m128i*)&pDst[x * 4], lo);
+		_mm_storeu_si128((__m128i*)&pDst[x * 4 + 16], hi);
+	}
+
+	primitives_convert_row_generic(conv, &pSrc[x * 2], &pDst[x * 4], width - x);
+}
+
+static void ssse3_convert_row_2_3(const PRIM_COLOR_CONVERSION* conv, const BYTE* pSrc,
+                                  BYTE* pDst, UINT32 width)
+{
+	UINT32 x;
+	const __m128i mask = ssse3_convert_mask(conv, 4, 3);
+
+	for (x = 0; x + 8 <= width; x += 8)
+	{
+		__m128i lo, hi;
+		ssse3_expand_565(&pSrc[x * 2], &lo, &hi);
+		ssse3_store_12(&pDst[x * 3], _mm_shuffle_epi8(lo, mask));
+		ssse3_store_12(&pDst[x * 3 + 12], _mm_shuffle_epi8(hi, mask));
+	}
+
+	primitives_convert_row_generic(conv, &pSrc[x * 2], &pDst[x * 3], width - x);
+}
+
+/* Packing to 16 bpp is left to the generic kernels */
+static const PRIM_CONVERT_ROWS ssse3_convert_rows = {
+	{ NULL, ssse3_convert_row_2_3, ssse3_convert_row_2_4 },
+	{ NULL, ssse3_convert_row_3_3, ssse3_convert_row_3_4 },
+	{ NULL, ssse3_convert_row_4_3, ssse3_convert_row_4_4 }
+};
+
+static pstatus_t ssse3_copy_convert_8u(const BYTE* pSrc, UINT32 SrcFormat, INT32 srcStep,
+                                       BYTE* pDst, UINT32 DstFormat, INT32 dstStep, UINT32 width,
+                                       UINT32 height)
+{
+	return primitives_copy_convert(ssse3_convert_rows, pSrc, SrcFormat, srcStep, pDst, DstFormat,
+	                               dstStep, width, height);
+}
+
+void primitives_init_copy_ssse3(primitives_t* prims)
+{
+	if (IsProcessorFeaturePresentEx(PF_EX_SSSE3) &&
+	    IsProcessorFeaturePresent(PF_SSE3_INSTRUCTIONS_AVAILABLE))
+	{
+		prims->copy_convert_8u = ssse3_copy_convert_8u;
+	}
+}
@@ -252,6 +252,70 @@ static INLINE BYTE YUV2B(INT32 Y, INT32 U, INT32 V)
 	return CLIP(b8);
 }
 
+/* Pixel format conversion used by copy_convert_8u.
+ * Every pixel is loaded into up to four channel bytes (memory order, 16 bpp formats are
+ * expanded to high, middle and low field), destination byte i is then taken from channel
+ * shuffle[i] or set to fill[i] if shuffle[i] is PRIM_CONVERT_FILL.
+ * Converting in place is supported for formats of the same size.
+ */
+#define PRIM_CONVERT_FILL 0x80
+
+typedef struct
+{
+	UINT32 SrcFormat;
+	UINT32 DstFormat;
+	UINT32 srcBytes;
+	UINT32 dstBytes;
+	BYTE shuffle[4];
+	BYTE fill[4];
+} PRIM_COLOR_CONVERSION;
+
+typedef void (*__convert_row_t)(const PRIM_COLOR_CONVERSION* conv, const BYTE* pSrc, BYTE* pDst,
+                                UINT32 width);
+
+/* Row kernels indexed by [srcBytes - 2][dstBytes - 2], NULL entries use the generic kernel */
+typedef __convert_row_t PRIM_CONVERT_ROWS[3][3];
+
+FREERDP_LOCAL const PRIM_COLOR_CONVERSION* primitives_get_color_conversion(UINT32 SrcFormat,
+                                                                            UINT32 DstFormat);
+FREERDP_LOCAL void primitives_convert_row_generic(const PRIM_COLOR_CONVERSION* conv,
+                                                 const BYTE* pSrc, BYTE* pDst, UINT32 width);
+FREERDP_LOCAL pstatus_t primitives_copy_convert(const PRIM_CONVERT_ROWS rows, const BYTE* pSrc,
+                                                UINT32 SrcFormat, INT32 srcStep, BYTE* pDst,
+                                                UINT32 DstFormat, INT32 dstStep, UINT32 width,
+                                                UINT32 height);
+
+/* Separable image scaling used by scale_8u_C4R.
+ * Every destination pixel is the weighted sum of taps consecutive source pixels starting at
+ * offsets[x], weights are fixed point values with PRIM_SCALE_BITS fractional bits adding up
+ * to PRIM_SCALE_ONE. The vertical pass keeps PRIM_SCALE_BITS - PRIM_SCALE_ROW_SHIFT
+ * fractional bits in the intermediate row.
+ */
+#define PRIM_SCALE_BITS 14
+#define PRIM_SCALE_ONE (1 << PRIM_SCALE_BITS)
+#define PRIM_SCALE_ROW_SHIFT 7
+
+typedef struct
+{
+	UINT32 taps;
+	UINT32* offsets;
+	INT16* weights;
+} PRIM_SCALE_COEFFS;
+
+typedef void (*__scale_vertical_t)(const BYTE* const* rows, const INT16* weights, UINT32 taps,
+                                   UINT16* pDst, UINT32 count);
+typedef void (*__scale_horizontal_t)(const UINT16* pSrc, const PRIM_SCALE_COEFFS* coeffs,
+                                     BYTE* pDst, UINT32 width);
+
+FREERDP_LOCAL BOOL primitives_scale_coeffs_init(PRIM_SCALE_COEFFS* coeffs, UINT32 srcSize,
+                                                UINT32 dstSize);
+FREERDP_LOCAL void primitives_scale_coeffs_free(PRIM_SCALE_COEFFS* coeffs);
+FREERDP_LOCAL pstatus_t primitives_scale(__scale_vertical_t vertical,
+                                         __scale_horizontal_t horizontal, const BYTE* pSrc,
+                                         INT32 srcStep, UINT32 srcWidth, UINT32 srcHeight,
+                                         BYTE* pDst, INT32 dstStep, UINT32 dstWidth,
+                                         UINT32 dstHeight);
+
 /* Function prototypes for all the init/deinit routines. */
 FREERDP_LOCAL void primitives_init_copy(primitives_t* prims);
 FREERDP_LOCAL void primitives_init_set(primitives_t* prims);
@@ -263,9 +327,12 @@ FREERDP_LOCAL void primitives_init_alphaComp(primitives_t* prims);
 FREERDP_LOCAL void primitives_init_colors(primitives_t* prims);
 FREERDP_LOCAL void primitives_init_YCoCg(primitives_t* prims);
 FREERDP_LOCAL void primitives_init_YUV(primitives_t* prims);
+FREERDP_LOCAL void primitives_init_scale(primitives_t* prims);
 
 #if defined(WITH_SSE2) || defined(WITH_NEON)
 FREERDP_LOCAL void primitives_init_copy_opt(primitives_t* prims);
+FREERDP_LOCAL void primitives_init_copy_ssse3(primitives_t* prims);
+FREERDP_LOCAL void primitives_init_copy_neon(primitives_t* prims);
 FREERDP_LOCAL void primitives_init_set_opt(primitives_t* prims);
 FREERDP_LOCAL void primitives_init_add_opt(primitives_t* prims);
 FREERDP_LOCAL void primitives_init_andor_opt(primitives_t* prims);
@@ -275,6 +342,7 @@ FREERDP_LOCAL void primitives_init_alphaComp_opt(primitives_t* prims);
 FREERDP_LOCAL void primitives_init_colors_opt(primitives_t* prims);
 FREERDP_LOCAL void primitives_init_YCoCg_opt(primitives_t* prims);
 FREERDP_LOCAL void primitives_init_YUV_opt(primitives_t* prims);
+FREERDP_LOCAL void primitives_init_scale_opt(primitives_t* prims);
 #endif
 
 #if defined(WITH_OPENCL)
@@ -0,0 +1,243 @@
+/* FreeRDP: A Remote Desktop Protocol Client
+ * Image scaling operations.
+ * vi:ts=4 sw=4:
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0.
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express
+ * or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <winpr/crt.h>
+
+#include <freerdp/types.h>
+#include <freerdp/primitives.h>
+
+#include "prim_internal.h"
+
+/* ------------------------------------------------------------------------- */
+/* Bilinear interpolation with pixel centers aligned, used for magnification. */
+static void scale_coeffs_bilinear(PRIM_SCALE_COEFFS* coeffs, UINT32 srcSize, UINT32 dstSize)
+{
+	UINT32 x;
+	const UINT64 den = 2ull * dstSize;
+
+	for (x = 0; x < dstSize; x++)
+	{
+		INT16* weights = &coeffs->weights[x * coeffs->taps];
+		/* Source position of the pixel center in 1 / (2 * dstSize) units */
+		INT64 pos = (2ll * x + 1) * srcSize - dstSize;
+		UINT64 index, frac;
+
+		if (pos < 0)
+			pos = 0;
+
+		index = (UINT64)pos / den;
+		frac = (UINT64)pos % den;
+
+		if (coeffs->taps == 1)
+		{
+			coeffs->offsets[x] = 0;
+			weights[0] = PRIM_SCALE_ONE;
+			continue;
+		}
+
+		if (index >= srcSize - 1)
+		{
+			index = srcSize - 2;
+			frac = den;
+		}
+
+		coeffs->offsets[x] = (UINT32)index;
+		weights[1] = (INT16)((frac * PRIM_SCALE_ONE + den / 2) / den);
+		weights[0] = (INT16)(PRIM_SCALE_ONE - weights[1]);
+	}
+}
+
+/* Box filter weighting every source pixel by its coverage, used for minification. */
+static void scale_coeffs_area(PRIM_SCALE_COEFFS* coeffs, UINT32 srcSize, UINT32 dstSize)
+{
+	UINT32 x, k;
+
+	for (x = 0; x < dstSize; x++)
+	{
+		INT16* weights = &coeffs->weights[x * coeffs->taps];
+		/* Covered source span in 1 / dstSize units */
+		const UINT64 start = (UINT64)x * srcSize;
+		const UINT64 end = start + srcSize;
+		UINT64 first = start / dstSize;
+		INT32 sum = 0;
+		UINT32 peak = 0;
+
+		if (first + coeffs->taps > srcSize)
+			first = srcSize - coeffs->taps;
+
+		coeffs->offsets[x] = (UINT32)first;
+
+		for (k = 0; k < coeffs->taps; k++)
+		{
+			const UINT64 lo = MAX((first + k) * dstSize, start);
+			const UINT64 hi = MIN((first + k + 1) * dstSize, end);
+			UINT64 weight = 0;
+
+			if (hi > lo)
+				weight = ((hi - lo) * PRIM_SCALE_ONE + srcSize / 2) / srcSize;
+
+			weights[k] = (INT16)weight;
+			sum += weights[k];
+
+			if (weights[k] > weights[peak])
+				peak = k;
+		}
+
+		/* Rounding must not change the brightness */
+		weights[peak] += (INT16)(PRIM_SCALE_ONE - sum);
+	}
+}
+
+BOOL primitives_scale_coeffs_init(PRIM_SCALE_COEFFS* coeffs, UINT32 srcSize, UINT32 dstSize)
+{
+	if (!coeffs || (srcSize == 0) || (dstSize == 0))
+		return FALSE;
+
+	if (srcSize > dstSize)
+		coeffs->taps = (srcSize + dstSize - 1) / dstSize + 1;
+	else
+		coeffs->taps = 2;
+
+	coeffs->taps = MIN(coeffs->taps, srcSize);
+	coeffs->offsets = calloc(dstSize, sizeof(UINT32));
+	coeffs->weights = calloc(1ull * dstSize * coeffs->taps, sizeof(INT16));
+
+	if (!coeffs->offsets || !coeffs->weights)
+	{
+		primitives_scale_coeffs_free(coeffs);
+		return FALSE;
+	}
+
+	if (srcSize > dstSize)
+		scale_coeffs_area(coeffs, srcSize, dstSize);
+	else
+		scale_coeffs_bilinear(coeffs, srcSize, dstSize);
+
+	return TRUE;
+}
+
+void primitives_scale_coeffs_free(PRIM_SCALE_COEFFS* coeffs)
+{
+	if (!coeffs)
+		return;
+
+	free(coeffs->offsets);
+	free(coeffs->weights);
+	coeffs->offsets = NULL;
+	coeffs->weights = NULL;
+}
+
+/* ------------------------------------------------------------------------- */
+static void general_scale_vertical(const BYTE* const* rows, const INT16* weights, UINT32 taps,
+                                   UINT16* pDst, UINT32 count)
+{
+	UINT32 x, k;
+
+	for (x = 0; x < count; x++)
+	{
+		INT32 sum = 0;
+
+		for (k = 0; k < taps; k++)
+			sum += weights[k] * rows[k][x];
+
+		pDst[x] = (UINT16)((sum + (1 << (PRIM_SCALE_ROW_SHIFT - 1))) >> PRIM_SCALE_ROW_SHIFT);
+	}
+}
+
+static void general_scale_horizontal(const UINT16* pSrc, const PRIM_SCALE_COEFFS* coeffs,
+                                     BYTE* pDst, UINT32 width)
+{
+	const UINT32 shift = 2 * PRIM_SCALE_BITS - PRIM_SCALE_ROW_SHIFT;
+	UINT32 x, k, c;
+
+	for (x = 0; x < width; x++)
+	{
+		const UINT16* src = &pSrc[coeffs->offsets[x] * 4];
+		const INT16* weights = &coeffs->weights[x * coeffs->taps];
+
+		for (c = 0; c < 4; c++)
+		{
+			INT32 sum = 0;
+
+			for (k = 0; k < coeffs->taps; k++)
+				sum += weights[k] * src[k * 4 + c];
+
+			sum = (sum + (1 << (shift - 1))) >> shift;
+			pDst[x * 4 + c] = (BYTE)MIN(sum, 255);
+		}
+	}
+}
+
+/* ------------------------------------------------------------------------- */
+pstatus_t primitives_scale(__scale_vertical_t vertical, __scale_horizontal_t horizontal,
+                           const BYTE* pSrc, INT32 srcStep, UINT32 srcWidth, UINT32 srcHeight,
+                           BYTE* pDst, INT32 dstStep, UINT32 dstWidth, UINT32 dstHeight)
+{
+	UINT32 y, k;
+	pstatus_t status = -1;
+	PRIM_SCALE_COEFFS xCoeffs = { 0 };
+	PRIM_SCALE_COEFFS yCoeffs = { 0 };
+	const BYTE** rows = NULL;
+	UINT16* row = NULL;
+
+	if (!pSrc || !pDst)
+		return -1;
+
+	if (!primitives_scale_coeffs_init(&xCoeffs, srcWidth, dstWidth) ||
+	    !primitives_scale_coeffs_init(&yCoeffs, srcHeight, dstHeight))
+		goto fail;
+
+	rows = calloc(yCoeffs.taps, sizeof(BYTE*));
+	row = _aligned_malloc(4ull * srcWidth * sizeof(UINT16), 16);
+
+	if (!rows || !row)
+		goto fail;
+
+	for (y = 0; y < dstHeight; y++)
+	{
+		const UINT32 first = yCoeffs.offsets[y];
+
+		for (k = 0; k < yCoeffs.taps; k++)
+			rows[k] = &pSrc[(INT64)(first + k) * srcStep];
+
+		vertical(rows, &yCoeffs.weights[y * yCoeffs.taps], yCoeffs.taps, row, srcWidth * 4);
+		horizontal(row, &xCoeffs, &pDst[(INT64)y * dstStep], dstWidth);
+	}
+
+	status = PRIMITIVES_SUCCESS;
+fail:
+	primitives_scale_coeffs_free(&xCoeffs);
+	primitives_scale_coeffs_free(&yCoeffs);
+	free((void*)rows);
+	_aligned_free(row);
+	return status;
+}
+
+static pstatus_t general_scale_8u_C4R(const BYTE* pSrc, INT32 srcStep, UINT32 srcWidth,
+                                      UINT32 srcHeight, BYTE* pDst, INT32 dstStep, UINT32 dstWidth,
+                                      UINT32 dstHeight)
+{
+	return primitives_scale(general_scale_vertical, general_scale_horizontal, pSrc, srcStep,
+	                        srcWidth, srcHeight, pDst, dstStep, dstWidth, dstHeight);
+}
+
+/* ------------------------------------------------------------------------- */
+void primitives_init_scale(primitives_t* prims)
+{
+	prims->scale_8u_C4R = general_scale_8u_C4R;
+}
@@ -0,0 +1,225 @@
+/* FreeRDP: A Remote Desktop Protocol Client
+ * Optimized image scaling operations.
+ * vi:ts=4 sw=4:
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0.
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express
+ * or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+
+#include <freerdp/types.h>
+#include <freerdp/primitives.h>
+#include <winpr/sysinfo.h>
+
+#ifdef WITH_SSE2
+#include <emmintrin.h>
+#elif defined(WITH_NEON)
+#include <arm_neon.h>
+#endif /* WITH_SSE2 else WITH_NEON */
+
+#include "prim_internal.h"
+
+#define SCALE_HORIZONTAL_SHIFT (2 * PRIM_SCALE_BITS - PRIM_SCALE_ROW_SHIFT)
+
+/* Scalar tails shared by the SIMD kernels */
+static INLINE void scale_vertical_tail(const BYTE* const* rows, const INT16* weights, UINT32 taps,
+                                       UINT16* pDst, UINT32 x, UINT32 count)
+{
+	UINT32 k;
+
+	for (; x < count; x++)
+	{
+		INT32 sum = 0;
+
+		for (k = 0; k < taps; k++)
+			sum += weights[k] * rows[k][x];
+
+		pDst[x] = (UINT16)((sum + (1 << (PRIM_SCALE_ROW_SHIFT - 1))) >> PRIM_SCALE_ROW_SHIFT);
+	}
+}
+
+#ifdef WITH_SSE2
+/* ------------------------------------------------------------------------- */
+/* Two taps are combined per pmaddwd by interleaving their rows. */
+static void sse2_scale_vertical(const BYTE* const* rows, const INT16* weights, UINT32 taps,
+                                UINT16* pDst, UINT32 count)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i round = _mm_set1_epi32(1 << (PRIM_SCALE_ROW_SHIFT - 1));
+	UINT32 x, k;
+
+	for (x = 0; x + 16 <= count; x += 16)
+	{
+		__m128i acc[4] = { round, round, round, round };
+
+		for (k = 0; k < taps; k += 2)
+		{
+			const __m128i p0 = _mm_loadu_si128((const __m128i*)&rows[k][x]);
+			__m128i p1 = zero;
+			__m128i w;
+			__m128i lo, hi;
+
+			if (k + 1 < taps)
+			{
+				p1 = _mm_loadu_si128((const __m128i*)&rows[k + 1][x]);
+				w = _mm_set1_epi32((INT32)((UINT16)weights[k] | ((UINT32)weights[k + 1] << 16)));
+			}
+			else
+				w = _mm_set1_epi32((UINT16)weights[k]);
+
+			/* p0 and p1 widened to 16 bit and interleaved: p0[i], p1[i] */
+			lo = _mm_unpacklo_epi8(p0, p1);
+			hi = _mm_unpackhi_epi8(p0, p1);
+			acc[0] = _mm_add_epi32(acc[0], _mm_madd_epi16(_mm_unpacklo_epi8(lo, zero), w));
+			acc[1] = _mm_add_epi32(acc[1], _mm_madd_epi16(_mm_unpackhi_epi8(lo, zero), w));
+			acc[2] = _mm_add_epi32(acc[2], _mm_madd_epi16(_mm_unpacklo_epi8(hi, zero), w));
+			acc[3] = _mm_add_epi32(acc[3], _mm_madd_epi16(_mm_unpackhi_epi8(hi, zero), w));
+		}
+
+		for (k = 0; k < 4; k++)
+			acc[k] = _mm_srai_epi32(acc[k], PRIM_SCALE_ROW_SHIFT);
+
+		_mm_storeu_si128((__m128i*)&pDst[x], _mm_packs_epi32(acc[0], acc[1]));
+		_mm_storeu_si128((__m128i*)&pDst[x + 8], _mm_packs_epi32(acc[2], acc[3]));
+	}
+
+	scale_vertical_tail(rows, weights, taps, pDst, x, count);
+}
+
+/* One destination pixel per iteration, the four channels fill the 32 bit lanes. */
+static void sse2_scale_horizontal(const UINT16* pSrc, const PRIM_SCALE_COEFFS* coeffs,
+                                  BYTE* pDst, UINT32 width)
+{
+	const __m128i round = _mm_set1_epi32(1 << (SCALE_HORIZONTAL_SHIFT - 1));
+	UINT32 x, k;
+
+	for (x = 0; x < width; x++)
+	{
+		const UINT16* src = &pSrc[coeffs->offsets[x] * 4];
+		const INT16* weights = &coeffs->weights[x * coeffs->taps];
+		__m128i acc = round;
+		INT32 val;
+
+		for (k = 0; k + 1 < coeffs->taps; k += 2)
+		{
+			const __m128i p0 = _mm_loadl_epi64((const __m128i*)&src[k * 4]);
+			const __m128i p1 = _mm_loadl_epi64((const __m128i*)&src[k * 4 + 4]);
+			const __m128i w =
+			    _mm_set1_epi32((INT32)((UINT16)weights[k] | ((UINT32)weights[k + 1] << 16)));
+			acc = _mm_add_epi32(acc, _mm_madd_epi16(_mm_unpacklo_epi16(p0, p1), w));
+		}
+
+		if (k < coeffs->taps)
+		{
+			const __m128i p0 = _mm_loadl_epi64((const __m128i*)&src[k * 4]);
+			const __m128i p1 = _mm_setzero_si128();
+			const __m128i w = _mm_set1_epi32((UINT16)weights[k]);
+			acc = _mm_add_epi32(acc, _mm_madd_epi16(_mm_unpacklo_epi16(p0, p1), w));
+		}
+
+		acc = _mm_srai_epi32(acc, SCALE_HORIZONTAL_SHIFT);
+		acc = _mm_packs_epi32(acc, acc);
+		val = _mm_cvtsi128_si32(_mm_packus_epi16(acc, acc));
+		memcpy(&pDst[x * 4], &val, sizeof(val));
+	}
+}
+
+static pstatus_t sse2_scale_8u_C4R(const BYTE* pSrc, INT32 srcStep, UINT32 srcWidth,
+                                   UINT32 srcHeight, BYTE* pDst, INT32 dstStep, UINT32 dstWidth,
+                                   UINT32 dstHeight)
+{
+	return primitives_scale(sse2_scale_vertical, sse2_scale_horizontal, pSrc, srcStep, srcWidth,
+	                        srcHeight, pDst, dstStep, dstWidth, dstHeight);
+}
+#endif /* WITH_SSE2 */
+
+#ifdef WITH_NEON
+/* ------------------------------------------------------------------------- */
+static void neon_scale_vertical(const BYTE* const* rows, const INT16* weights, UINT32 taps,
+                                UINT16* pDst, UINT32 count)
+{
+	UINT32 x, k;
+
+	for (x = 0; x + 16 <= count; x += 16)
+	{
+		const uint32x4_t round = vdupq_n_u32(1 << (PRIM_SCALE_ROW_SHIFT - 1));
+		uint32x4_t acc[4] = { round, round, round, round };
+
+		for (k = 0; k < taps; k++)
+		{
+			const uint8x16_t p = vld1q_u8(&rows[k][x]);
+			const uint16x8_t lo = vmovl_u8(vget_low_u8(p));
+			const uint16x8_t hi = vmovl_u8(vget_high_u8(p));
+			const UINT16 w = (UINT16)weights[k];
+			acc[0] = vmlal_n_u16(acc[0], vget_low_u16(lo), w);
+			acc[1] = vmlal_n_u16(acc[1], vget_high_u16(lo), w);
+			acc[2] = vmlal_n_u16(acc[2], vget_low_u16(hi), w);
+			acc[3] = vmlal_n_u16(acc[3], vget_high_u16(hi), w);
+		}
+
+		vst1q_u16(&pDst[x], vcombine_u16(vshrn_n_u32(acc[0], PRIM_SCALE_ROW_SHIFT),
+		                                 vshrn_n_u32(acc[1], PRIM_SCALE_ROW_SHIFT)));
+		vst1q_u16(&pDst[x + 8], vcombine_u16(vshrn_n_u32(acc[2], PRIM_SCALE_ROW_SHIFT),
+		                                     vshrn_n_u32(acc[3], PRIM_SCALE_ROW_SHIFT)));
+	}
+
+	scale_vertical_tail(rows, weights, taps, pDst, x, count);
+}
+
+static void neon_scale_horizontal(const UINT16* pSrc, const PRIM_SCALE_COEFFS* coeffs,
+                                  BYTE* pDst, UINT32 width)
+{
+	UINT32 x, k;
+
+	for (x = 0; x < width; x++)
+	{
+		const UINT16* src = &pSrc[coeffs->offsets[x] * 4];
+		const INT16* weights = &coeffs->weights[x * coeffs->taps];
+		uint32x4_t acc = vdupq_n_u32(1 << (SCALE_HORIZONTAL_SHIFT - 1));
+		uint8x8_t val;
+
+		for (k = 0; k < coeffs->taps; k++)
+			acc = vmlal_n_u16(acc, vld1_u16(&src[k * 4]), (UINT16)weights[k]);
+
+		acc = vshrq_n_u32(acc, SCALE_HORIZONTAL_SHIFT);
+		val = vqmovn_u16(vcombine_u16(vqmovn_u32(acc), vdup_n_u16(0)));
+		vst1_lane_u32((uint32_t*)&pDst[x * 4], vreinterpret_u32_u8(val), 0);
+	}
+}
+
+static pstatus_t neon_scale_8u_C4R(const BYTE* pSrc, INT32 srcStep, UINT32 srcWidth,
+                                   UINT32 srcHeight, BYTE* pDst, INT32 dstStep, UINT32 dstWidth,
+                                   UINT32 dstHeight)
+{
+	return primitives_scale(neon_scale_vertical, neon_scale_horizontal, pSrc, srcStep, srcWidth,
+	                        srcHeight, pDst, dstStep, dstWidth, dstHeight);
+}
+#endif /* WITH_NEON */
+
+/* ------------------------------------------------------------------------- */
+void primitives_init_scale_opt(primitives_t* prims)
+{
+	primitives_init_scale(prims);
+#if defined(WITH_SSE2)
+
+	if (IsProcessorFeaturePresent(PF_SSE2_INSTRUCTIONS_AVAILABLE))
+		prims->scale_8u_C4R = sse2_scale_8u_C4R;
+
+#elif defined(WITH_NEON)
+
+	if (IsProcessorFeaturePresent(PF_ARM_NEON_INSTRUCTIONS_AVAILABLE))
+		prims->scale_8u_C4R = neon_scale_8u_C4R;
+
+#endif /* WITH_SSE2 */
+}
@@ -111,6 +111,20 @@ static pstatus_t general_set_32u(UINT32 val, UINT32* pDst, UINT32 len)
 	return PRIMITIVES_SUCCESS;
 }
 
+/* ------------------------------------------------------------------------- */
+static pstatus_t general_set_32u_masked(UINT32 val, const BYTE* pMask, UINT32* pDst, UINT32 len)
+{
+	UINT32 x;
+
+	for (x = 0; x < len; x++)
+	{
+		if (pMask[x])
+			pDst[x] = val;
+	}
+
+	return PRIMITIVES_SUCCESS;
+}
+
 /* ------------------------------------------------------------------------- */
 void primitives_init_set(primitives_t* prims)
 {
@@ -118,5 +132,6 @@ void primitives_init_set(primitives_t* prims)
 	prims->set_8u = general_set_8u;
 	prims->set_32s = general_set_32s;
 	prims->set_32u = general_set_32u;
+	prims->set_32u_masked = general_set_32u_masked;
 	prims->zero = general_zero;
 }
@@ -25,7 +25,9 @@
 
 #ifdef WITH_SSE2
 #include <emmintrin.h>
-#endif /* WITH_SSE2 */
+#elif defined(WITH_NEON)
+#include <arm_neon.h>
+#endif /* WITH_SSE2 else WITH_NEON */
 #ifdef WITH_IPP
 #include <ipps.h>
 #endif /* WITH_IPP */
@@ -221,8 +223,92 @@ static pstatus_t sse2_set_32s(INT32 val, INT32* pDst, UINT32 len)
 	return sse2_set_32u(uval, (UINT32*)pDst, len);
 }
 #endif /* !defined(WITH_IPP) || defined(ALL_PRIMITIVES_VERSIONS) */
+
+/* ------------------------------------------------------------------------- */
+/* 16 mask bytes are widened to four pixel masks, runs of clear or set pixels
+ * skip the blend. */
+static pstatus_t sse2_set_32u_masked(UINT32 val, const BYTE* pMask, UINT32* pDst, UINT32 len)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i value = _mm_set1_epi32((int)val);
+	UINT32 x, i;
+
+	for (x = 0; x + 16 <= len; x += 16)
+	{
+		/* 0xFF where the destination is kept */
+		const __m128i keep = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)&pMask[x]), zero);
+		const int bits = _mm_movemask_epi8(keep);
+		__m128i keep16[2];
+
+		if (bits == 0xFFFF)
+			continue;
+
+		if (bits == 0)
+		{
+			for (i = 0; i < 16; i += 4)
+				_mm_storeu_si128((__m128i*)&pDst[x + i], value);
+
+			continue;
+		}
+
+		keep16[0] = _mm_unpacklo_epi8(keep, keep);
+		keep16[1] = _mm_unpackhi_epi8(keep, keep);
+
+		for (i = 0; i < 4; i++)
+		{
+			const __m128i k = (i & 1) ? _mm_unpackhi_epi16(keep16[i / 2], keep16[i / 2])
+			                          : _mm_unpacklo_epi16(keep16[i / 2], keep16[i / 2]);
+			__m128i* dst = (__m128i*)&pDst[x + i * 4];
+			const __m128i d = _mm_loadu_si128(dst);
+			_mm_storeu_si128(dst, _mm_or_si128(_mm_and_si128(k, d), _mm_andnot_si128(k, value)));
+		}
+	}
+
+	for (; x < len; x++)
+	{
+		if (pMask[x])
+			pDst[x] = val;
+	}
+
+	return PRIMITIVES_SUCCESS;
+}
 #endif /* WITH_SSE2 */
 
+#ifdef WITH_NEON
+/* ------------------------------------------------------------------------- */
+static pstatus_t neon_set_32u_masked(UINT32 val, const BYTE* pMask, UINT32* pDst, UINT32 len)
+{
+	const uint32x4_t value = vdupq_n_u32(val);
+	UINT32 x, i;
+
+	for (x = 0; x + 16 <= len; x += 16)
+	{
+		const uint8x16_t mask = vld1q_u8(&pMask[x]);
+		/* 0xFF where the pixel is set */
+		const uint8x16_t set = vtstq_u8(mask, mask);
+		const uint8x16x2_t set16 = vzipq_u8(set, set);
+
+		for (i = 0; i < 2; i++)
+		{
+			const uint16x8_t s = vreinterpretq_u16_u8(set16.val[i]);
+			const uint16x8x2_t set32 = vzipq_u16(s, s);
+			uint32_t* dst = &pDst[x + i * 8];
+			vst1q_u32(dst, vbslq_u32(vreinterpretq_u32_u16(set32.val[0]), value, vld1q_u32(dst)));
+			vst1q_u32(dst + 4,
+			          vbslq_u32(vreinterpretq_u32_u16(set32.val[1]), value, vld1q_u32(dst + 4)));
+		}
+	}
+
+	for (; x < len; x++)
+	{
+		if (pMask[x])
+			pDst[x] = val;
+	}
+
+	return PRIMITIVES_SUCCESS;
+}
+#endif /* WITH_NEON */
+
 #ifdef WITH_IPP
 /* ------------------------------------------------------------------------- */
 static pstatus_t ipp_wrapper_set_32u(UINT32 val, UINT32* pDst, INT32 len)
@@ -253,5 +339,16 @@ void primitives_init_set_opt(primitives_t* prims)
 		prims->set_32u = sse2_set_32u;
 	}
 
+#endif
+#if defined(WITH_SSE2)
+
+	if (IsProcessorFeaturePresent(PF_SSE2_INSTRUCTIONS_AVAILABLE))
+		prims->set_32u_masked = sse2_set_32u_masked;
+
+#elif defined(WITH_NEON)
+
+	if (IsProcessorFeaturePresent(PF_ARM_NEON_INSTRUCTIONS_AVAILABLE))
+		prims->set_32u_masked = neon_set_32u_masked;
+
 #endif
 }
@@ -17,6 +17,7 @@
 #endif
 
 #include <winpr/sysinfo.h>
+#include <freerdp/codec/color.h>
 #include "prim_test.h"
 
 #define COPY_TESTSIZE (256 * 2 + 16 * 2 + 15 + 15)
@@ -79,6 +80,164 @@ static BOOL test_copy8u_speed(void)
 	return TRUE;
 }
 
+/* ------------------------------------------------------------------------- */
+static const UINT32 convert_formats[] = { PIXEL_FORMAT_ARGB32, PIXEL_FORMAT_XRGB32,
+	                                      PIXEL_FORMAT_ABGR32, PIXEL_FORMAT_XBGR32,
+	                                      PIXEL_FORMAT_RGBA32, PIXEL_FORMAT_RGBX32,
+	                                      PIXEL_FORMAT_BGRA32, PIXEL_FORMAT_BGRX32,
+	                                      PIXEL_FORMAT_RGB24,  PIXEL_FORMAT_BGR24,
+	                                      PIXEL_FORMAT_RGB16,  PIXEL_FORMAT_BGR16 };
+
+static void copy_convert_reference(const BYTE* pSrc, UINT32 SrcFormat, UINT32 srcStep, BYTE* pDst,
+                                   UINT32 DstFormat, UINT32 dstStep, UINT32 width, UINT32 height)
+{
+	UINT32 x, y;
+	const UINT32 srcByte = GetBytesPerPixel(SrcFormat);
+	const UINT32 dstByte = GetBytesPerPixel(DstFormat);
+
+	for (y = 0; y < height; y++)
+	{
+		for (x = 0; x < width; x++)
+		{
+			const UINT32 color = ReadColor(&pSrc[y * srcStep + x * srcByte], SrcFormat);
+			WriteColor(&pDst[y * dstStep + x * dstByte], DstFormat,
+			           FreeRDPConvertColor(color, SrcFormat, DstFormat, NULL));
+		}
+	}
+}
+
+static BOOL test_copy_convert_prim(const char* name, const primitives_t* prims, const BYTE* src,
+                                   UINT32 SrcFormat, UINT32 srcStep, BYTE* dst,
+                                   const BYTE* expected, UINT32 DstFormat, UINT32 dstStep,
+                                   UINT32 width, UINT32 height)
+{
+	UINT32 y;
+	const UINT32 rowBytes = width * GetBytesPerPixel(DstFormat);
+
+	memset(dst, 0xA5, dstStep * height);
+
+	if (prims->copy_convert_8u(src, SrcFormat, (INT32)srcStep, dst, DstFormat, (INT32)dstStep,
+	                           width, height) != PRIMITIVES_SUCCESS)
+	{
+		printf("COPY_CONVERT FAIL [%s]: %s -> %s not supported\n", name,
+		       FreeRDPGetColorFormatName(SrcFormat), FreeRDPGetColorFormatName(DstFormat));
+		return FALSE;
+	}
+
+	for (y = 0; y < height; y++)
+	{
+		const BYTE* line = &dst[y * dstStep];
+
+		if (memcmp(line, &expected[y * dstStep], rowBytes) != 0)
+		{
+			printf("COPY_CONVERT FAIL [%s]: %s -> %s width=%" PRIu32 " line %" PRIu32 "\n", name,
+			       FreeRDPGetColorFormatName(SrcFormat), FreeRDPGetColorFormatName(DstFormat),
+			       width, y);
+			return FALSE;
+		}
+
+		/* Padding behind the row must not be touched */
+		if ((dstStep > rowBytes) && (line[rowBytes] != 0xA5))
+		{
+			printf("COPY_CONVERT FAIL [%s]: %s -> %s wrote beyond the row\n", name,
+			       FreeRDPGetColorFormatName(SrcFormat), FreeRDPGetColorFormatName(DstFormat));
+			return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
+static BOOL test_copy_convert_func(void)
+{
+	const UINT32 widths[] = { 1, 3, 7, 16, 33, 67 };
+	const UINT32 height = 5;
+	const UINT32 step = 67 * 4 + 16;
+	BOOL rc = FALSE;
+	size_t s, d, w;
+	BYTE* src = calloc(height, step);
+	BYTE* dst = calloc(height, step);
+	BYTE* expected = calloc(height, step);
+
+	if (!src || !dst || !expected)
+		goto fail;
+
+	winpr_RAND(src, height * step);
+
+	for (s = 0; s < ARRAYSIZE(convert_formats); s++)
+	{
+		for (d = 0; d < ARRAYSIZE(convert_formats); d++)
+		{
+			const UINT32 SrcFormat = convert_formats[s];
+			const UINT32 DstFormat = convert_formats[d];
+
+			for (w = 0; w < ARRAYSIZE(widths); w++)
+			{
+				memset(expected, 0xA5, height * step);
+				copy_convert_reference(src, SrcFormat, step, expected, DstFormat, step, widths[w],
+				                       height);
+
+				if (!test_copy_convert_prim("generic", generic, src, SrcFormat, step, dst,
+				                            expected, DstFormat, step, widths[w], height))
+					goto fail;
+
+				if (!test_copy_convert_prim("optimized", optimized, src, SrcFormat, step, dst,
+				                            expected, DstFormat, step, widths[w], height))
+					goto fail;
+			}
+		}
+	}
+
+	/* Formats without a conversion table entry are left to the caller */
+	if (generic->copy_convert_8u(src, PIXEL_FORMAT_RGB8, (INT32)step, dst, PIXEL_FORMAT_BGRX32,
+	                             (INT32)step, 1, 1) == PRIMITIVES_SUCCESS)
+		goto fail;
+
+	rc = TRUE;
+fail:
+	free(src);
+	free(dst);
+	free(expected);
+	return rc;
+}
+
+/* ------------------------------------------------------------------------- */
+static BOOL test_copy_convert_speed(void)
+{
+	const UINT32 width = 1024;
+	const UINT32 height = 16;
+	BOOL rc = FALSE;
+	BYTE* src = calloc(height, width * 4);
+	BYTE* dst = calloc(height, width * 4);
+
+	if (!src || !dst)
+		goto fail;
+
+	if (!speed_test("copy_convert_8u", "BGRX32 -> RGBX32", g_Iterations,
+	                (speed_test_fkt)generic->copy_convert_8u,
+	                (speed_test_fkt)optimized->copy_convert_8u, src, PIXEL_FORMAT_BGRX32,
+	                width * 4, dst, PIXEL_FORMAT_RGBX32, width * 4, width, height))
+		goto fail;
+
+	if (!speed_test("copy_convert_8u", "RGB16 -> BGRX32", g_Iterations,
+	                (speed_test_fkt)generic->copy_convert_8u,
+	                (speed_test_fkt)optimized->copy_convert_8u, src, PIXEL_FORMAT_RGB16,
+	                width * 2, dst, PIXEL_FORMAT_BGRX32, width * 4, width, height))
+		goto fail;
+
+	if (!speed_test("copy_convert_8u", "BGR24 -> BGRX32", g_Iterations,
+	                (speed_test_fkt)generic->copy_convert_8u,
+	                (speed_test_fkt)optimized->copy_convert_8u, src, PIXEL_FORMAT_BGR24,
+	                width * 3, dst, PIXEL_FORMAT_BGRX32, width * 4, width, height))
+		goto fail;
+
+	rc = TRUE;
+fail:
+	free(src);
+	free(dst);
+	return rc;
+}
+
 int TestPrimitivesCopy(int argc, char* argv[])
 {
 	WINPR_UNUSED(argc);
@@ -88,10 +247,16 @@ int TestPrimitivesCopy(int argc, char* argv[])
 	if (!test_copy8u_func())
 		return 1;
 
+	if (!test_copy_convert_func())
+		return 1;
+
 	if (g_TestPrimitivesPerformance)
 	{
 		if (!test_copy8u_speed())
 			return 1;
+
+		if (!test_copy_convert_speed())
+			return 1;
 	}
 
 	return 0;
@@ -0,0 +1,281 @@
+/* test_scale.c
+ * vi:ts=4 sw=4
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0.
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express
+ * or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <math.h>
+
+#include <winpr/sysinfo.h>
+#include "prim_test.h"
+
+/* ------------------------------------------------------------------------- */
+/* Smooth gradients with some detail, every channel differs */
+static BYTE* scale_create_image(UINT32 width, UINT32 height)
+{
+	UINT32 x, y;
+	BYTE* image = calloc(height, width * 4ull);
+
+	if (!image)
+		return NULL;
+
+	for (y = 0; y < height; y++)
+	{
+		for (x = 0; x < width; x++)
+		{
+			BYTE* px = &image[(y * width + x) * 4];
+			px[0] = (BYTE)(x * 255 / width);
+			px[1] = (BYTE)(y * 255 / height);
+			px[2] = (BYTE)(127.5 + 127.5 * sin(x / 7.0) * cos(y / 5.0));
+			px[3] = (BYTE)((x + y) & 0xFF);
+		}
+	}
+
+	return image;
+}
+
+/* Double precision filter weights of source pixel i for destination pixel x */
+static double scale_reference_weight(UINT32 i, UINT32 x, UINT32 srcSize, UINT32 dstSize)
+{
+	const double scale = (double)srcSize / dstSize;
+
+	if (srcSize > dstSize)
+	{
+		const double lo = MAX(x * scale, (double)i);
+		const double hi = MIN((x + 1) * scale, i + 1.0);
+		return (hi > lo) ? (hi - lo) / scale : 0.0;
+	}
+	else
+	{
+		double pos = (x + 0.5) * scale - 0.5;
+		double index;
+
+		if (srcSize == 1)
+			return 1.0;
+
+		pos = MIN(MAX(pos, 0.0), srcSize - 1.0);
+		index = MIN(floor(pos), srcSize - 2.0);
+
+		if (i == index)
+			return 1.0 - (pos - index);
+
+		if (i == index + 1)
+			return pos - index;
+
+		return 0.0;
+	}
+}
+
+static BOOL scale_compare_reference(const BYTE* src, UINT32 srcWidth, UINT32 srcHeight,
+                                    const BYTE* dst, UINT32 dstWidth, UINT32 dstHeight)
+{
+	UINT32 x, y, i, j, c;
+	BOOL rc = FALSE;
+	double* tmp = calloc(srcWidth * 4ull, sizeof(double));
+
+	if (!tmp)
+		return FALSE;
+
+	for (y = 0; y < dstHeight; y++)
+	{
+		memset(tmp, 0, srcWidth * 4ull * sizeof(double));
+
+		for (j = 0; j < srcHeight; j++)
+		{
+			const double w = scale_reference_weight(j, y, srcHeight, dstHeight);
+
+			if (w == 0.0)
+				continue;
+
+			for (i = 0; i < srcWidth * 4; i++)
+				tmp[i] += w * src[j * srcWidth * 4 + i];
+		}
+
+		for (x = 0; x < dstWidth; x++)
+		{
+			double val[4] = { 0 };
+
+			for (i = 0; i < srcWidth; i++)
+			{
+				const double w = scale_reference_weight(i, x, srcWidth, dstWidth);
+
+				for (c = 0; c < 4; c++)
+					val[c] += w * tmp[i * 4 + c];
+			}
+
+			for (c = 0; c < 4; c++)
+			{
+				const double diff = fabs(val[c] - dst[(y * dstWidth + x) * 4 + c]);
+
+				/* Fixed point weights and rounding of the intermediate row */
+				if (diff > 1.5)
+				{
+					printf("SCALE FAIL: %" PRIu32 "x%" PRIu32 " -> %" PRIu32 "x%" PRIu32
+					       " pixel %" PRIu32 ",%" PRIu32 " channel %" PRIu32
+					       " got %" PRIu8 " expected %f\n",
+					       srcWidth, srcHeight, dstWidth, dstHeight, x, y, c,
+					       dst[(y * dstWidth + x) * 4 + c], val[c]);
+					goto fail;
+				}
+			}
+		}
+	}
+
+	rc = TRUE;
+fail:
+	free(tmp);
+	return rc;
+}
+
+static BOOL test_scale_func(void)
+{
+	const UINT32 sizes[][4] = { { 64, 48, 128, 96 }, { 64, 48, 97, 61 }, { 97, 61, 64, 48 },
+		                        { 128, 96, 37, 21 }, { 200, 10, 3, 1 },  { 1, 1, 16, 9 },
+		                        { 33, 17, 33, 40 },  { 40, 33, 17, 33 }, { 15, 15, 16, 16 } };
+	size_t i;
+
+	for (i = 0; i < ARRAYSIZE(sizes); i++)
+	{
+		BOOL rc = FALSE;
+		const UINT32 srcWidth = sizes[i][0];
+		const UINT32 srcHeight = sizes[i][1];
+		const UINT32 dstWidth = sizes[i][2];
+		const UINT32 dstHeight = sizes[i][3];
+		const size_t dstSize = dstWidth * dstHeight * 4ull;
+		BYTE* src = scale_create_image(srcWidth, srcHeight);
+		BYTE* dstGeneric = calloc(1, dstSize);
+		BYTE* dstOptimized = calloc(1, dstSize);
+
+		if (!src || !dstGeneric || !dstOptimized)
+			goto fail;
+
+		if (generic->scale_8u_C4R(src, (INT32)srcWidth * 4, srcWidth, srcHeight, dstGeneric,
+		                          (INT32)dstWidth * 4, dstWidth, dstHeight) != PRIMITIVES_SUCCESS)
+			goto fail;
+
+		if (optimized->scale_8u_C4R(src, (INT32)srcWidth * 4, srcWidth, srcHeight, dstOptimized,
+		                            (INT32)dstWidth * 4, dstWidth,
+		                            dstHeight) != PRIMITIVES_SUCCESS)
+			goto fail;
+
+		if (memcmp(dstGeneric, dstOptimized, dstSize) != 0)
+		{
+			printf("SCALE FAIL: optimized %" PRIu32 "x%" PRIu32 " -> %" PRIu32 "x%" PRIu32
+			       " differs from generic\n",
+			       srcWidth, srcHeight, dstWidth, dstHeight);
+			goto fail;
+		}
+
+		if (!scale_compare_reference(src, srcWidth, srcHeight, dstGeneric, dstWidth, dstHeight))
+			goto fail;
+
+		rc = TRUE;
+	fail:
+		free(src);
+		free(dstGeneric);
+		free(dstOptimized);
+
+		if (!rc)
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+/* A flat image must stay exactly flat, independent of the filter */
+static BOOL test_scale_flat(void)
+{
+	UINT32 x;
+	BOOL rc = FALSE;
+	BYTE* src = malloc(77 * 53 * 4);
+	BYTE* dst = malloc(31 * 120 * 4);
+
+	if (!src || !dst)
+		goto fail;
+
+	for (x = 0; x < 77 * 53; x++)
+	{
+		src[x * 4 + 0] = 0x12;
+		src[x * 4 + 1] = 0x80;
+		src[x * 4 + 2] = 0xFE;
+		src[x * 4 + 3] = 0xFF;
+	}
+
+	if (optimized->scale_8u_C4R(src, 77 * 4, 77, 53, dst, 31 * 4, 31, 120) != PRIMITIVES_SUCCESS)
+		goto fail;
+
+	for (x = 0; x < 31 * 120; x++)
+	{
+		if ((dst[x * 4 + 0] != 0x12) || (dst[x * 4 + 1] != 0x80) || (dst[x * 4 + 2] != 0xFE) ||
+		    (dst[x * 4 + 3] != 0xFF))
+		{
+			printf("SCALE FAIL: flat image changed at pixel %" PRIu32 "\n", x);
+			goto fail;
+		}
+	}
+
+	rc = TRUE;
+fail:
+	free(src);
+	free(dst);
+	return rc;
+}
+
+/* ------------------------------------------------------------------------- */
+static BOOL test_scale_speed(void)
+{
+	BOOL rc = FALSE;
+	BYTE* src = scale_create_image(1920, 1080);
+	BYTE* dst = calloc(1920 * 1080, 4);
+
+	if (!src || !dst)
+		goto fail;
+
+	if (!speed_test("scale_8u_C4R", "1920x1080 -> 1600x900", g_Iterations,
+	                (speed_test_fkt)generic->scale_8u_C4R, (speed_test_fkt)optimized->scale_8u_C4R,
+	                src, 1920 * 4, 1920, 1080, dst, 1600 * 4, 1600, 900))
+		goto fail;
+
+	if (!speed_test("scale_8u_C4R", "1600x900 -> 1920x1080", g_Iterations,
+	                (speed_test_fkt)generic->scale_8u_C4R, (speed_test_fkt)optimized->scale_8u_C4R,
+	                src, 1920 * 4, 1600, 900, dst, 1920 * 4, 1920, 1080))
+		goto fail;
+
+	rc = TRUE;
+fail:
+	free(src);
+	free(dst);
+	return rc;
+}
+
+int TestPrimitivesScale(int argc, char* argv[])
+{
+	WINPR_UNUSED(argc);
+	WINPR_UNUSED(argv);
+	prim_test_setup(FALSE);
+
+	if (!test_scale_func())
+		return 1;
+
+	if (!test_scale_flat())
+		return 1;
+
+	if (g_TestPrimitivesPerformance)
+	{
+		if (!test_scale_speed())
+			return 1;
+	}
+
+	return 0;
+}
@@ -226,6 +226,54 @@ static BOOL test_set32u_func(void)
 	return TRUE;
 }
 
+/* ------------------------------------------------------------------------- */
+static BOOL test_set32u_masked_func(void)
+{
+	pstatus_t status;
+	UINT32 off, len, x;
+	BYTE mask[64];
+	UINT32 dest[64];
+	UINT32 expected[64];
+	const UINT32 value = 0xABCDEF12;
+
+	winpr_RAND(mask, sizeof(mask));
+
+	/* Runs of clear and set mask bytes */
+	for (x = 0; x < 16; x++)
+	{
+		mask[16 + x] = 0;
+		mask[32 + x] = 0xFF;
+	}
+
+	for (off = 0; off < 16; ++off)
+	{
+		for (len = 1; len < 48; ++len)
+		{
+			for (x = 0; x < 64; x++)
+				dest[x] = expected[x] = x;
+
+			for (x = 0; x < len; x++)
+			{
+				if (mask[off + x])
+					expected[off + x] = value;
+			}
+
+			status = optimized->set_32u_masked(value, mask + off, dest + off, len);
+
+			if (status != PRIMITIVES_SUCCESS)
+				return FALSE;
+
+			if (memcmp(dest, expected, sizeof(dest)) != 0)
+			{
+				printf("SET32U_MASKED FAILED: off=%" PRIu32 " len=%" PRIu32 "\n", off, len);
+				return FALSE;
+			}
+		}
+	}
+
+	return TRUE;
+}
+
 /* ------------------------------------------------------------------------- */
 static BOOL test_set32u_speed(void)
 {
@@ -264,6 +312,21 @@ static BOOL test_set32s_speed(void)
 	return TRUE;
 }
 
+/* ------------------------------------------------------------------------- */
+static BOOL test_set32u_masked_speed(void)
+{
+	UINT32 dest[1024];
+	BYTE mask[1024];
+	UINT32 value;
+
+	winpr_RAND((BYTE*)&value, sizeof(value));
+	winpr_RAND(mask, sizeof(mask));
+
+	return speed_test("set_32u_masked", "", g_Iterations,
+	                  (speed_test_fkt)generic->set_32u_masked,
+	                  (speed_test_fkt)optimized->set_32u_masked, value, mask, dest, 1024);
+}
+
 int TestPrimitivesSet(int argc, char* argv[])
 {
 	WINPR_UNUSED(argc);
@@ -279,6 +342,9 @@ int TestPrimitivesSet(int argc, char* argv[])
 	if (!test_set32u_func())
 		return -1;
 
+	if (!test_set32u_masked_func())
+		return -1;
+
 	if (g_TestPrimitivesPerformance)
 	{
 		if (!test_set8u_speed())
@@ -289,6 +355,9 @@ int TestPrimitivesSet(int argc, char* argv[])
 
 		if (!test_set32u_speed())
 			return -1;
+
+		if (!test_set32u_masked_speed())
+			return -1;
 	}
 
 	return 0;
@@ -72,6 +72,8 @@ size_t server_audin_get_formats(AUDIO_FORMAT** dst_formats)
 		{ WAVE_FORMAT_GSM610, 1, 11025, 2239, 65, 0, 2, gsm610_data },
 		{ WAVE_FORMAT_GSM610, 1, 8000, 1625, 65, 0, 2, gsm610_data },
 		/* Formats added for others */
+		{ WAVE_FORMAT_OPUS, 2, 48000, 12000, 4, 16, 0, NULL },
+		{ WAVE_FORMAT_OPUS, 1, 16000, 3000, 2, 16, 0, NULL },
 
 		{ WAVE_FORMAT_MSG723, 2, 44100, 0, 4, 16, 0, NULL },
 		{ WAVE_FORMAT_MSG723, 2, 22050, 0, 4, 16, 0, NULL },
@@ -127,6 +129,7 @@ size_t server_rdpsnd_get_formats(AUDIO_FORMAT** dst_formats)
 	size_t x, y = 0;
 	/* Default supported audio formats */
 	static const AUDIO_FORMAT default_supported_audio_formats[] = {
+		{ WAVE_FORMAT_OPUS, 2, 48000, 16000, 4, 16, 0, NULL },
 		{ WAVE_FORMAT_AAC_MS, 2, 44100, 176400, 4, 16, 0, NULL },
 		{ WAVE_FORMAT_MPEGLAYER3, 2, 44100, 176400, 4, 16, 0, NULL },
 		{ WAVE_FORMAT_MSG723, 2, 44100, 176400, 4, 16, 0, NULL },
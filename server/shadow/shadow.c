@@ -81,6 +81,8 @@ int main(int argc, char** argv)
 		  "NTLM SAM file for NLA authentication" },
 		{ "gfx-progressive", COMMAND_LINE_VALUE_BOOL, NULL, BoolValueTrue, NULL, -1, NULL,
 		  "Allow GFX progressive codec" },
+		{ "gfx-progressive-passes", COMMAND_LINE_VALUE_REQUIRED, "<1-4>", NULL, NULL, -1, NULL,
+		  "Send GFX progressive tiles in up to this many quality passes" },
 		{ "gfx-rfx", COMMAND_LINE_VALUE_BOOL, NULL, BoolValueTrue, NULL, -1, NULL,
 		  "Allow GFX RFX codec" },
 		{ "gfx-planar", COMMAND_LINE_VALUE_BOOL, NULL, BoolValueTrue, NULL, -1, NULL,
@@ -89,6 +91,10 @@ int main(int argc, char** argv)
 		  "Allow GFX AVC420 codec" },
 		{ "gfx-avc444", COMMAND_LINE_VALUE_BOOL, NULL, BoolValueTrue, NULL, -1, NULL,
 		  "Allow GFX AVC444 codec" },
+		{ "audio-bitrate", COMMAND_LINE_VALUE_REQUIRED, "<bitrate>", NULL, NULL, -1, NULL,
+		  "Audio encoder bitrate in bits per second" },
+		{ "audio-complexity", COMMAND_LINE_VALUE_REQUIRED, "<0-10>", NULL, NULL, -1, NULL,
+		  "Audio encoder complexity" },
 		{ "version", COMMAND_LINE_VALUE_FLAG | COMMAND_LINE_PRINT_VERSION, NULL, NULL, NULL, -1,
 		  NULL, "Print version" },
 		{ "buildconfig", COMMAND_LINE_VALUE_FLAG | COMMAND_LINE_PRINT_BUILDCONFIG, NULL, NULL, NULL,
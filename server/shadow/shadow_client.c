@@ -285,7 +285,6 @@ static void shadow_client_context_free(freerdp_peer* peer, rdpContext* context)
 static INLINE void shadow_client_mark_invalid(rdpShadowClient* client, UINT32 numRects,
                                               const RECTANGLE_16* rects)
 {
-	UINT32 index;
 	RECTANGLE_16 screenRegion;
 	rdpSettings* settings;
 
@@ -300,10 +299,7 @@ static INLINE void shadow_client_mark_invalid(rdpShadowClient* client, UINT32 nu
 	/* Mark client invalid region. No rectangle means full screen */
 	if (numRects > 0)
 	{
-		for (index = 0; index < numRects; index++)
-		{
-			region16_union_rect(&(client->invalidRegion), &(client->invalidRegion), &rects[index]);
-		}
+		region16_union_rects(&(client->invalidRegion), &(client->invalidRegion), rects, numRects);
 	}
 	else
 	{
@@ -999,7 +995,8 @@ static INLINE UINT32 rdpgfx_estimate_h264_avc420(RDPGFX_AVC420_BITMAP_STREAM* ha
  */
 static BOOL shadow_client_send_surface_gfx(rdpShadowClient* client, const BYTE* pSrcData,
                                            UINT32 nSrcStep, UINT32 SrcFormat, UINT16 nXSrc,
-                                           UINT16 nYSrc, UINT16 nWidth, UINT16 nHeight)
+                                           UINT16 nYSrc, UINT16 nWidth, UINT16 nHeight,
+                                           const REGION16* invalidRegion)
 {
 	UINT32 id;
 	UINT error = CHANNEL_RC_OK;
@@ -1211,7 +1208,13 @@ static BOOL shadow_client_send_surface_gfx(rdpShadowClient* client, const BYTE*
 		regionRect.right = (UINT16)cmd.right;
 		regionRect.bottom = (UINT16)cmd.bottom;
 		region16_init(&region);
-		region16_union_rect(&region, &region, &regionRect);
+
+		/* With several passes only the damaged tiles restart, the others get their next pass */
+		if (client->server->progressivePasses > 1)
+			region16_copy(&region, invalidRegion);
+		else
+			region16_union_rect(&region, &region, &regionRect);
+
 		rc = progressive_compress(encoder->progressive, pSrcData, nSrcStep * nHeight, cmd.format,
 		                          nWidth, nHeight, nSrcStep, &region, &cmd.data, &cmd.length);
 		region16_uninit(&region);
@@ -1685,6 +1688,44 @@ out:
  *
  * @return TRUE on success (or nothing need to be updated)
  */
+/* Upgrade passes of the progressive codec are still to be sent for unchanged tiles */
+static BOOL shadow_client_progressive_pending(rdpShadowClient* client,
+                                             const SHADOW_GFX_STATUS* pStatus)
+{
+	const rdpSettings* settings = ((rdpContext*)client)->settings;
+
+	if (!pStatus->gfxOpened || !pStatus->gfxSurfaceCreated || !client->encoder)
+		return FALSE;
+
+	if (!freerdp_settings_get_bool(settings, FreeRDP_GfxProgressive))
+		return FALSE;
+
+	return progressive_compress_pending(client->encoder->progressive);
+}
+
+/* The GFX surface starts at the origin of the shared sub rectangle */
+static BOOL shadow_client_offset_region(REGION16* dst, const REGION16* src, UINT16 dx, UINT16 dy)
+{
+	UINT32 x, nbRects;
+	const RECTANGLE_16* rects = region16_rects(src, &nbRects);
+
+	for (x = 0; x < nbRects; x++)
+	{
+		RECTANGLE_16 rect;
+		WINPR_ASSERT(rects[x].left >= dx);
+		WINPR_ASSERT(rects[x].top >= dy);
+		rect.left = rects[x].left - dx;
+		rect.top = rects[x].top - dy;
+		rect.right = rects[x].right - dx;
+		rect.bottom = rects[x].bottom - dy;
+
+		if (!region16_union_rect(dst, dst, &rect))
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
 static BOOL shadow_client_send_surface_update(rdpShadowClient* client, SHADOW_GFX_STATUS* pStatus)
 {
 	BOOL ret = TRUE;
@@ -1695,13 +1736,11 @@ static BOOL shadow_client_send_surface_update(rdpShadowClient* client, SHADOW_GF
 	rdpShadowServer* server;
 	rdpShadowSurface* surface;
 	REGION16 invalidRegion;
+	REGION16 gfxRegion;
 	RECTANGLE_16 surfaceRect;
 	const RECTANGLE_16* extents;
 	BYTE* pSrcData;
 	UINT32 nSrcStep, SrcFormat;
-	UINT32 index;
-	UINT32 numRects = 0;
-	const RECTANGLE_16* rects;
 
 	if (!context || !pStatus)
 		return FALSE;
@@ -1719,15 +1758,13 @@ static BOOL shadow_client_send_surface_update(rdpShadowClient* client, SHADOW_GF
 
 	EnterCriticalSection(&(client->lock));
 	region16_init(&invalidRegion);
+	region16_init(&gfxRegion);
 	region16_copy(&invalidRegion, &(client->invalidRegion));
 	region16_clear(&(client->invalidRegion));
 	LeaveCriticalSection(&(client->lock));
 
 	EnterCriticalSection(&surface->lock);
-	rects = region16_rects(&(surface->invalidRegion), &numRects);
-
-	for (index = 0; index < numRects; index++)
-		region16_union_rect(&invalidRegion, &invalidRegion, &rects[index]);
+	region16_union_region(&invalidRegion, &invalidRegion, &(surface->invalidRegion));
 
 	surfaceRect.left = 0;
 	surfaceRect.top = 0;
@@ -1742,7 +1779,7 @@ static BOOL shadow_client_send_surface_update(rdpShadowClient* client, SHADOW_GF
 		region16_intersect_rect(&invalidRegion, &invalidRegion, &(server->subRect));
 	}
 
-	if (region16_is_empty(&invalidRegion))
+	if (region16_is_empty(&invalidRegion) && !shadow_client_progressive_pending(client, pStatus))
 	{
 		/* No image region need to be updated. Success */
 		goto out;
@@ -1798,8 +1835,16 @@ static BOOL shadow_client_send_surface_update(rdpShadowClient* client, SHADOW_GF
 		WINPR_ASSERT(nWidth <= UINT16_MAX);
 		WINPR_ASSERT(nHeight >= 0);
 		WINPR_ASSERT(nHeight <= UINT16_MAX);
-		ret = shadow_client_send_surface_gfx(client, pSrcData, nSrcStep, SrcFormat, 0, 0,
-		                                     (UINT16)nWidth, (UINT16)nHeight);
+
+		if (server->shareSubRect)
+			ret = shadow_client_offset_region(&gfxRegion, &invalidRegion, server->subRect.left,
+			                                  server->subRect.top);
+		else
+			ret = region16_copy(&gfxRegion, &invalidRegion);
+
+		if (ret)
+			ret = shadow_client_send_surface_gfx(client, pSrcData, nSrcStep, SrcFormat, 0, 0,
+			                                     (UINT16)nWidth, (UINT16)nHeight, &gfxRegion);
 	}
 	else if (settings->RemoteFxCodec || freerdp_settings_get_bool(settings, FreeRDP_NSCodec))
 	{
@@ -1831,6 +1876,7 @@ static BOOL shadow_client_send_surface_update(rdpShadowClient* client, SHADOW_GF
 out:
 	LeaveCriticalSection(&surface->lock);
 	region16_uninit(&invalidRegion);
+	region16_uninit(&gfxRegion);
 	return ret;
 }
 
@@ -2044,6 +2090,7 @@ static DWORD WINAPI shadow_client_thread(LPVOID arg)
 	BOOL rc;
 	DWORD status;
 	DWORD nCount;
+	DWORD timeout;
 	wMessage message;
 	wMessage pointerPositionMsg;
 	wMessage pointerAlphaMsg;
@@ -2129,11 +2176,29 @@ static DWORD WINAPI shadow_client_thread(LPVOID arg)
 		}
 		events[nCount++] = ChannelEvent;
 		events[nCount++] = MessageQueue_Event(MsgQueue);
-		status = WaitForMultipleObjects(nCount, events, FALSE, INFINITE);
+
+		/* Without screen updates the pending progressive passes are sent one frame apart */
+		if (shadow_client_progressive_pending(client, &gfxstatus))
+			timeout = 1000 / MAX(1, shadow_encoder_preferred_fps(client->encoder));
+		else if (freerdp_get_state(peer->context) == CONNECTION_STATE_NLA)
+			timeout = 1000; /* CheckFileDescriptor enforces the NLA timeout */
+		else
+			timeout = INFINITE;
+
+		status = WaitForMultipleObjects(nCount, events, FALSE, timeout);
 
 		if (status == WAIT_FAILED)
 			goto fail;
 
+		if ((status == WAIT_TIMEOUT) && client->activated && !client->suppressOutput)
+		{
+			if (!shadow_client_send_surface_update(client, &gfxstatus))
+			{
+				WLog_ERR(TAG, "Failed to send progressive upgrade");
+				break;
+			}
+		}
+
 		if (WaitForSingleObject(UpdateEvent, 0) == WAIT_OBJECT_0)
 		{
 			/* The UpdateEvent means to start sending current frame. It is
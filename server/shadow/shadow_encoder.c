@@ -263,6 +263,9 @@ static int shadow_encoder_init_progressive(rdpShadowEncoder* encoder)
 	if (!encoder->progressive)
 		goto fail;
 
+	if (!progressive_context_set_passes(encoder->progressive, encoder->server->progressivePasses))
+		goto fail;
+
 	if (!progressive_context_reset(encoder->progressive))
 		goto fail;
 
@@ -270,6 +273,7 @@ static int shadow_encoder_init_progressive(rdpShadowEncoder* encoder)
 	return 1;
 fail:
 	progressive_context_free(encoder->progressive);
+	encoder->progressive = NULL;
 	return -1;
 }
 
@@ -72,6 +72,12 @@ int shadow_client_rdpsnd_init(rdpShadowClient* client)
 
 	rdpsnd->data = client;
 
+	if (!rdpsnd_server_set_dsp_option(rdpsnd, FREERDP_DSP_OPTION_BITRATE,
+	                                  client->server->audioBitRate) ||
+	    !rdpsnd_server_set_dsp_option(rdpsnd, FREERDP_DSP_OPTION_COMPLEXITY,
+	                                  client->server->audioComplexity))
+		WLog_WARN(TAG, "Audio encoder options not supported, using the encoder defaults");
+
 	if (client->subsystem->rdpsndFormats)
 	{
 		rdpsnd->server_formats = client->subsystem->rdpsndFormats;
@@ -395,6 +395,33 @@ int shadow_server_parse_command_line(rdpShadowServer* server, int argc, char** a
 			if (!freerdp_settings_set_bool(settings, FreeRDP_GfxAVC444, arg->Value ? TRUE : FALSE))
 				return COMMAND_LINE_ERROR;
 		}
+		CommandLineSwitchCase(arg, "gfx-progressive-passes")
+		{
+			unsigned long val = strtoul(arg->Value, NULL, 0);
+
+			if ((errno != 0) || (val < 1) || (val > 4))
+				return COMMAND_LINE_ERROR;
+
+			server->progressivePasses = (UINT32)val;
+		}
+		CommandLineSwitchCase(arg, "audio-bitrate")
+		{
+			unsigned long val = strtoul(arg->Value, NULL, 0);
+
+			if ((errno != 0) || (val > UINT32_MAX))
+				return COMMAND_LINE_ERROR;
+
+			server->audioBitRate = (UINT32)val;
+		}
+		CommandLineSwitchCase(arg, "audio-complexity")
+		{
+			unsigned long val = strtoul(arg->Value, NULL, 0);
+
+			if ((errno != 0) || (val > 10))
+				return COMMAND_LINE_ERROR;
+
+			server->audioComplexity = (UINT32)val;
+		}
 		CommandLineSwitchDefault(arg)
 		{
 		}
@@ -909,6 +936,9 @@ rdpShadowServer* shadow_server_new(void)
 	server->h264BitRate = 10000000;
 	server->h264FrameRate = 30;
 	server->h264QP = 0;
+	server->audioBitRate = 0;
+	server->audioComplexity = 10;
+	server->progressivePasses = 1;
 	server->authentication = FALSE;
 	server->settings = freerdp_settings_new(FREERDP_SETTINGS_SERVER_MODE);
 	return server;
@@ -534,7 +534,7 @@ extern "C"
 	 *
 	 * @param window the UwacWindow to refresh
 	 * @param copyContentForNextFrame if true the content to display is copied in the next drawing
-	 *buffer
+	 *buffer, only the areas that changed since that buffer was last up to date are copied
 	 * @return UWAC_SUCCESS if the operation was successful
 	 */
 	UWAC_API UwacReturnCode UwacWindowSubmitBuffer(UwacWindow* window,
@@ -0,0 +1,279 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "../uwac-utils.h"
+#include "wayland-stub.h"
+
+#define TEST_WIDTH 64
+#define TEST_HEIGHT 32
+
+#define TEST_JUNK 0xE0E0E000
+
+static const StubRect full = { 0, 0, TEST_WIDTH, TEST_HEIGHT };
+static const StubRect half = { 0, 0, TEST_WIDTH / 2, TEST_HEIGHT / 2 };
+static const StubRect rect1 = { 0, 0, 16, 16 };
+static const StubRect rect2 = { 32, 16, 16, 16 };
+static const StubRect rect3 = { 8, 8, 8, 8 };
+static const StubRect rect4 = { 60, 30, 4, 2 };
+
+static uint32_t* pixel(const UwacWindow* window, const void* data, int32_t x, int32_t y)
+{
+	return (uint32_t*)((const char*)data + y * window->stride) + x;
+}
+
+static void fill(const UwacWindow* window, void* data, const StubRect* rect, uint32_t color)
+{
+	int32_t x, y;
+
+	for (y = rect->y; y < rect->y + rect->height; y++)
+	{
+		for (x = rect->x; x < rect->x + rect->width; x++)
+			*pixel(window, data, x, y) = color;
+	}
+}
+
+static bool inside(const StubRect* rect, int32_t x, int32_t y)
+{
+	return (x >= rect->x) && (x < rect->x + rect->width) && (y >= rect->y) &&
+	       (y < rect->y + rect->height);
+}
+
+static char* test_snapshot(const UwacWindow* window)
+{
+	int i;
+	const size_t size = window->stride * 1ULL * window->height;
+	char* copy = malloc(size * window->nbuffers);
+
+	for (i = 0; copy && (i < window->nbuffers); i++)
+		memcpy(copy + size * i, window->buffers[i].data, size);
+
+	return copy;
+}
+
+/* data must hold the pixels of src in the copied areas and those of before elsewhere */
+static bool test_buffer(const UwacWindow* window, const void* data, const void* before,
+                        const void* src, const StubRect** copied, size_t count)
+{
+	size_t i;
+	int32_t x, y;
+
+	for (y = 0; y < window->height; y++)
+	{
+		for (x = 0; x < window->width; x++)
+		{
+			bool isCopied = false;
+			uint32_t expected;
+			const uint32_t value = *pixel(window, data, x, y);
+
+			for (i = 0; i < count; i++)
+				isCopied |= inside(copied[i], x, y);
+
+			if (!isCopied && !before)
+				return false;
+
+			expected = *pixel(window, isCopied ? src : before, x, y);
+
+			if (value != expected)
+			{
+				printf("pixel %" PRId32 "x%" PRId32 " is 0x%08" PRIx32 " instead of 0x%08" PRIx32
+				       "\n",
+				       x, y, value, expected);
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+/* Draws a frame and submits it, the next drawing buffer must be next and hold the frame in
+ * the copied areas and its former content elsewhere */
+static bool test_frame(UwacWindow* window, const StubRect* rect, uint32_t color, ssize_t next,
+                       const StubRect** copied, size_t count)
+{
+	bool rc = false;
+	size_t ndamage;
+	char* before;
+	const StubRect* damage;
+	const int nbuffers = window->nbuffers;
+	const size_t size = window->stride * 1ULL * window->height;
+	UwacBuffer* buffer = &window->buffers[window->drawingBufferIdx];
+	struct wl_buffer* presented = buffer->wayland_buffer;
+	void* src = buffer->data;
+
+	fill(window, src, rect, color);
+	before = test_snapshot(window);
+
+	if (!before)
+		return false;
+
+	if ((UwacWindowAddDamage(window, rect->x, rect->y, rect->width, rect->height) !=
+	     UWAC_SUCCESS) ||
+	    (UwacWindowSubmitBuffer(window, true) != UWAC_SUCCESS))
+		goto fail;
+
+	ndamage = stub_surface_committed_damage(window->surface, &damage);
+
+	if ((stub_surface_committed_buffer(window->surface) != presented) || (ndamage != 1) ||
+	    (damage->x != rect->x) || (damage->y != rect->y) || (damage->width != rect->width) ||
+	    (damage->height != rect->height))
+	{
+		printf("frame not committed with its damage\n");
+		goto fail;
+	}
+
+	if (window->drawingBufferIdx != next)
+	{
+		printf("drawing buffer %d instead of %d\n", (int)window->drawingBufferIdx, (int)next);
+		goto fail;
+	}
+
+	if (!test_buffer(window, window->buffers[next].data,
+	                 (next < nbuffers) ? before + size * next : NULL, src, copied, count))
+		goto fail;
+
+	rc = stub_surface_frame_done(window->surface);
+fail:
+	free(before);
+	return rc;
+}
+
+static bool test_buffers(UwacDisplay* display)
+{
+	int i;
+	int32_t y;
+	bool rc = false;
+	void* data;
+	char* before = NULL;
+	size_t stride;
+	UwacWindow* window =
+	    UwacCreateWindowShm(display, TEST_WIDTH, TEST_HEIGHT, WL_SHM_FORMAT_XRGB8888);
+
+	if (!window || (window->nbuffers != 3) || (window->drawingBufferIdx != 0))
+		goto fail;
+
+	/* Junk in every buffer shows what was copied */
+	for (i = 0; i < window->nbuffers; i++)
+		fill(window, window->buffers[i].data, &full, TEST_JUNK + i);
+
+	{
+		const StubRect* copied[] = { &rect1 };
+
+		if (!test_frame(window, &rect1, 0x11111111, 1, copied, ARRAY_LENGTH(copied)))
+			goto fail;
+	}
+
+	/* buffer 0 is not released, buffer 2 missed both frames */
+	{
+		const StubRect* copied[] = { &rect1, &rect2 };
+
+		if (!test_frame(window, &rect2, 0x22222222, 2, copied, ARRAY_LENGTH(copied)))
+			goto fail;
+	}
+
+	/* buffer 0 was presented with rect1 and only missed the frames after it */
+	stub_buffer_release(window->buffers[0].wayland_buffer);
+
+	{
+		const StubRect* copied[] = { &rect2, &rect3 };
+
+		if (!test_frame(window, &rect3, 0x33333333, 0, copied, ARRAY_LENGTH(copied)))
+			goto fail;
+	}
+
+	/* All buffers are in use, the new ones get the whole frame */
+	{
+		const StubRect* copied[] = { &full };
+
+		if (!test_frame(window, &rect4, 0x44444444, 3, copied, ARRAY_LENGTH(copied)))
+			goto fail;
+	}
+
+	if (window->nbuffers != 5)
+		goto fail;
+
+	/* Release events still reach the buffers once the array was reallocated */
+	stub_buffer_release(window->buffers[1].wayland_buffer);
+
+	if (window->buffers[1].used)
+	{
+		printf("buffer release lost\n");
+		goto fail;
+	}
+
+	/* A configure without a size change keeps the buffers */
+	data = UwacWindowGetDrawingBuffer(window);
+	stub_shell_surface_configure(window->shell_surface, TEST_WIDTH, TEST_HEIGHT);
+
+	if ((UwacWindowGetDrawingBuffer(window) != data) || (window->nbuffers != 5))
+	{
+		printf("buffers reallocated without a size change\n");
+		goto fail;
+	}
+
+	/* A smaller window keeps what fits of the drawing buffer */
+	stride = window->stride;
+	before = malloc(stride * window->height);
+
+	if (!before)
+		goto fail;
+
+	memcpy(before, data, stride * window->height);
+	stub_shell_surface_configure(window->shell_surface, TEST_WIDTH / 2, TEST_HEIGHT / 2);
+
+	if ((window->nbuffers != 3) || (window->drawingBufferIdx != 0) ||
+	    (window->width != TEST_WIDTH / 2) || (window->height != TEST_HEIGHT / 2))
+		goto fail;
+
+	for (y = 0; y < window->height; y++)
+	{
+		if (memcmp((char*)window->buffers[0].data + y * window->stride, before + y * stride,
+		           window->stride) != 0)
+		{
+			printf("content lost on resize\n");
+			goto fail;
+		}
+	}
+
+	{
+		const StubRect* copied[] = { &half };
+
+		if (!test_frame(window, &rect3, 0x55555555, 1, copied, ARRAY_LENGTH(copied)))
+			goto fail;
+	}
+
+	rc = true;
+fail:
+	free(before);
+
+	if (window)
+		UwacDestroyWindow(&window);
+
+	return rc;
+}
+
+int TestUwacWindowBuffers(int argc, char* argv[])
+{
+	int rc = -1;
+	UwacDisplay display;
+
+	/* the shm pools are created there */
+	if (!getenv("XDG_RUNTIME_DIR"))
+		setenv("XDG_RUNTIME_DIR", "/tmp", 0);
+
+	memset(&display, 0, sizeof(display));
+	wl_list_init(&display.windows);
+	display.compositor = (struct wl_compositor*)stub_proxy_new(&wl_compositor_interface);
+	display.shm = (struct wl_shm*)stub_proxy_new(&wl_shm_interface);
+	display.shell = (struct wl_shell*)stub_proxy_new(&wl_shell_interface);
+
+	if (display.compositor && display.shm && display.shell && test_buffers(&display))
+		rc = 0;
+
+	stub_proxy_free((struct wl_proxy*)display.compositor);
+	stub_proxy_free((struct wl_proxy*)display.shm);
+	stub_proxy_free((struct wl_proxy*)display.shell);
+	return rc;
+}
@@ -0,0 +1,276 @@
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "wayland-stub.h"
+
+#define STUB_INTERFACE(name) \
+	const struct wl_interface name##_interface = { #name, 1, 0, NULL, 0, NULL }
+
+STUB_INTERFACE(wl_buffer);
+STUB_INTERFACE(wl_callback);
+STUB_INTERFACE(wl_compositor);
+STUB_INTERFACE(wl_output);
+STUB_INTERFACE(wl_pointer);
+STUB_INTERFACE(wl_region);
+STUB_INTERFACE(wl_seat);
+STUB_INTERFACE(wl_shell);
+STUB_INTERFACE(wl_shell_surface);
+STUB_INTERFACE(wl_shm);
+STUB_INTERFACE(wl_shm_pool);
+STUB_INTERFACE(wl_surface);
+
+struct wl_proxy
+{
+	const struct wl_interface* interface;
+	const void* implementation;
+	void* user_data;
+
+	/* wl_surface */
+	struct wl_proxy* attached;
+	struct wl_proxy* committed;
+	struct wl_proxy* frame;
+	StubRect damage[STUB_MAX_DAMAGE];
+	size_t ndamage;
+	StubRect committedDamage[STUB_MAX_DAMAGE];
+	size_t ncommittedDamage;
+};
+
+static bool stub_error_handler(UwacDisplay* d, UwacReturnCode code, const char* msg, ...)
+{
+	return true;
+}
+
+UwacErrorHandler uwacErrorHandler = stub_error_handler;
+
+UwacEvent* UwacDisplayNewEvent(UwacDisplay* display, int type)
+{
+	static UwacEvent event;
+
+	memset(&event, 0, sizeof(event));
+	event.type = type;
+	return &event;
+}
+
+struct wl_proxy* stub_proxy_new(const struct wl_interface* interface)
+{
+	struct wl_proxy* proxy = calloc(1, sizeof(struct wl_proxy));
+
+	if (proxy)
+		proxy->interface = interface;
+
+	return proxy;
+}
+
+void stub_proxy_free(struct wl_proxy* proxy)
+{
+	if (proxy && proxy->frame)
+		stub_proxy_free(proxy->frame);
+
+	free(proxy);
+}
+
+static void stub_surface_request(struct wl_proxy* surface, uint32_t opcode,
+                                 struct wl_proxy* created, va_list args)
+{
+	StubRect* rect;
+
+	switch (opcode)
+	{
+		case WL_SURFACE_ATTACH:
+			surface->attached = va_arg(args, struct wl_proxy*);
+			break;
+
+		case WL_SURFACE_DAMAGE:
+			if (surface->ndamage >= STUB_MAX_DAMAGE)
+				break;
+
+			rect = &surface->damage[surface->ndamage++];
+			rect->x = va_arg(args, int32_t);
+			rect->y = va_arg(args, int32_t);
+			rect->width = va_arg(args, int32_t);
+			rect->height = va_arg(args, int32_t);
+			break;
+
+		case WL_SURFACE_FRAME:
+			stub_proxy_free(surface->frame);
+			surface->frame = created;
+			break;
+
+		case WL_SURFACE_COMMIT:
+			surface->committed = surface->attached;
+			surface->attached = NULL;
+			memcpy(surface->committedDamage, surface->damage, sizeof(surface->damage));
+			surface->ncommittedDamage = surface->ndamage;
+			surface->ndamage = 0;
+			break;
+
+		default:
+			break;
+	}
+}
+
+static struct wl_proxy* stub_request(struct wl_proxy* proxy, uint32_t opcode,
+                                     const struct wl_interface* interface, va_list args)
+{
+	struct wl_proxy* created = NULL;
+
+	if (interface)
+		created = stub_proxy_new(interface);
+
+	if (proxy->interface == &wl_surface_interface)
+		stub_surface_request(proxy, opcode, created, args);
+
+	return created;
+}
+
+struct wl_proxy* wl_proxy_marshal_flags(struct wl_proxy* proxy, uint32_t opcode,
+                                        const struct wl_interface* interface, uint32_t version,
+                                        uint32_t flags, ...)
+{
+	va_list args;
+	struct wl_proxy* created;
+
+	va_start(args, flags);
+	created = stub_request(proxy, opcode, interface, args);
+	va_end(args);
+
+#ifdef WL_MARSHAL_FLAG_DESTROY
+	if (flags & WL_MARSHAL_FLAG_DESTROY)
+		stub_proxy_free(proxy);
+#endif
+
+	return created;
+}
+
+void wl_proxy_marshal(struct wl_proxy* proxy, uint32_t opcode, ...)
+{
+	va_list args;
+
+	va_start(args, opcode);
+	stub_request(proxy, opcode, NULL, args);
+	va_end(args);
+}
+
+struct wl_proxy* wl_proxy_marshal_constructor(struct wl_proxy* proxy, uint32_t opcode,
+                                              const struct wl_interface* interface, ...)
+{
+	va_list args;
+	struct wl_proxy* created;
+
+	va_start(args, interface);
+	created = stub_request(proxy, opcode, interface, args);
+	va_end(args);
+	return created;
+}
+
+struct wl_proxy* wl_proxy_marshal_constructor_versioned(struct wl_proxy* proxy, uint32_t opcode,
+                                                        const struct wl_interface* interface,
+                                                        uint32_t version, ...)
+{
+	va_list args;
+	struct wl_proxy* created;
+
+	va_start(args, version);
+	created = stub_request(proxy, opcode, interface, args);
+	va_end(args);
+	return created;
+}
+
+void wl_proxy_destroy(struct wl_proxy* proxy)
+{
+	stub_proxy_free(proxy);
+}
+
+int wl_proxy_add_listener(struct wl_proxy* proxy, void (**implementation)(void), void* data)
+{
+	proxy->implementation = implementation;
+	proxy->user_data = data;
+	return 0;
+}
+
+void wl_proxy_set_user_data(struct wl_proxy* proxy, void* user_data)
+{
+	proxy->user_data = user_data;
+}
+
+void* wl_proxy_get_user_data(struct wl_proxy* proxy)
+{
+	return proxy->user_data;
+}
+
+uint32_t wl_proxy_get_version(struct wl_proxy* proxy)
+{
+	return proxy->interface->version;
+}
+
+int wl_display_roundtrip(struct wl_display* display)
+{
+	return 0;
+}
+
+void wl_list_init(struct wl_list* list)
+{
+	list->prev = list;
+	list->next = list;
+}
+
+void wl_list_insert(struct wl_list* list, struct wl_list* elm)
+{
+	elm->prev = list;
+	elm->next = list->next;
+	list->next = elm;
+	elm->next->prev = elm;
+}
+
+void wl_list_remove(struct wl_list* elm)
+{
+	elm->prev->next = elm->next;
+	elm->next->prev = elm->prev;
+	elm->next = NULL;
+	elm->prev = NULL;
+}
+
+struct wl_buffer* stub_surface_committed_buffer(struct wl_surface* surface)
+{
+	return (struct wl_buffer*)((struct wl_proxy*)surface)->committed;
+}
+
+size_t stub_surface_committed_damage(struct wl_surface* surface, const StubRect** rects)
+{
+	struct wl_proxy* proxy = (struct wl_proxy*)surface;
+
+	*rects = proxy->committedDamage;
+	return proxy->ncommittedDamage;
+}
+
+bool stub_surface_frame_done(struct wl_surface* surface)
+{
+	const struct wl_callback_listener* listener;
+	struct wl_proxy* frame = ((struct wl_proxy*)surface)->frame;
+
+	if (!frame || !frame->implementation)
+		return false;
+
+	((struct wl_proxy*)surface)->frame = NULL;
+	listener = frame->implementation;
+	listener->done(frame->user_data, (struct wl_callback*)frame, 0);
+	return true;
+}
+
+void stub_buffer_release(struct wl_buffer* buffer)
+{
+	struct wl_proxy* proxy = (struct wl_proxy*)buffer;
+	const struct wl_buffer_listener* listener = proxy->implementation;
+
+	listener->release(proxy->user_data, buffer);
+}
+
+void stub_shell_surface_configure(struct wl_shell_surface* shell_surface, int32_t width,
+                                  int32_t height)
+{
+	struct wl_proxy* proxy = (struct wl_proxy*)shell_surface;
+	const struct wl_shell_surface_listener* listener = proxy->implementation;
+
+	listener->configure(proxy->user_data, shell_surface, 0, width, height);
+}
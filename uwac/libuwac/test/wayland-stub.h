@@ -0,0 +1,32 @@
+#ifndef UWAC_TEST_WAYLAND_STUB_H_
+#define UWAC_TEST_WAYLAND_STUB_H_
+
+#include "../uwac-priv.h"
+
+/*
+ * A stub of the libwayland-client proxy API. Requests are not sent anywhere, the stub keeps
+ * the state of wl_surface so tests can check what was committed and fire the events a
+ * compositor would send.
+ */
+
+#define STUB_MAX_DAMAGE 16
+
+typedef struct
+{
+	int32_t x, y, width, height;
+} StubRect;
+
+struct wl_proxy* stub_proxy_new(const struct wl_interface* interface);
+void stub_proxy_free(struct wl_proxy* proxy);
+
+/* the buffer and damage of the last commit of surface */
+struct wl_buffer* stub_surface_committed_buffer(struct wl_surface* surface);
+size_t stub_surface_committed_damage(struct wl_surface* surface, const StubRect** rects);
+
+/* events of the compositor */
+bool stub_surface_frame_done(struct wl_surface* surface);
+void stub_buffer_release(struct wl_buffer* buffer);
+void stub_shell_surface_configure(struct wl_shell_surface* shell_surface, int32_t width,
+                                  int32_t height);
+
+#endif /* UWAC_TEST_WAYLAND_STUB_H_ */
@@ -215,8 +215,10 @@ struct uwac_buffer
 	bool dirty;
 #ifdef HAVE_PIXMAN_REGION
 	pixman_region32_t damage;
+	pixman_region32_t stale; /* window content changed since the buffer was up to date */
 #else
 	REGION16 damage;
+	REGION16 stale; /* window content changed since the buffer was up to date */
 #endif
 	struct wl_buffer* wayland_buffer;
 	void* data;
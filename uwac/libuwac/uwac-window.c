@@ -52,30 +52,213 @@ static void buffer_release(void* data, struct wl_buffer* buffer)
 
 static const struct wl_buffer_listener buffer_listener = { buffer_release };
 
-static void UwacWindowDestroyBuffers(UwacWindow* w)
+/*
+ * Every buffer tracks in stale the window areas that were presented from another buffer since
+ * it was up to date. When a buffer becomes the drawing buffer only these areas are copied from
+ * the last presented one.
+ */
+#ifdef HAVE_PIXMAN_REGION
+static void UwacBufferInitRegions(UwacBuffer* buffer)
+{
+	pixman_region32_init(&buffer->damage);
+	pixman_region32_init(&buffer->stale);
+}
+
+static void UwacBufferFreeRegions(UwacBuffer* buffer)
+{
+	pixman_region32_fini(&buffer->damage);
+	pixman_region32_fini(&buffer->stale);
+}
+
+static bool UwacBufferAddStale(UwacBuffer* buffer, uint32_t width, uint32_t height)
+{
+	return pixman_region32_union_rect(&buffer->stale, &buffer->stale, 0, 0, width, height);
+}
+
+static bool UwacWindowMarkStale(UwacWindow* w, UwacBuffer* presented)
 {
 	int i;
 
 	for (i = 0; i < w->nbuffers; i++)
 	{
 		UwacBuffer* buffer = &w->buffers[i];
+
+		if (buffer == presented)
+			continue;
+
+		if (!pixman_region32_union(&buffer->stale, &buffer->stale, &presented->damage))
+			return false;
+	}
+
+	return true;
+}
+#else
+static void UwacBufferInitRegions(UwacBuffer* buffer)
+{
+	region16_init(&buffer->damage);
+	region16_init(&buffer->stale);
+}
+
+static void UwacBufferFreeRegions(UwacBuffer* buffer)
+{
+	region16_uninit(&buffer->damage);
+	region16_uninit(&buffer->stale);
+}
+
+static bool UwacBufferAddStale(UwacBuffer* buffer, uint32_t width, uint32_t height)
+{
+	RECTANGLE_16 box;
+
+	box.left = 0;
+	box.top = 0;
+	box.right = width;
+	box.bottom = height;
+	return region16_union_rect(&buffer->stale, &buffer->stale, &box);
+}
+
+static bool UwacWindowMarkStale(UwacWindow* w, UwacBuffer* presented)
+{
+	int i;
+
+	for (i = 0; i < w->nbuffers; i++)
+	{
+		UwacBuffer* buffer = &w->buffers[i];
+
+		if (buffer == presented)
+			continue;
+
+		if (!region16_union_region(&buffer->stale, &buffer->stale, &presented->damage))
+			return false;
+	}
+
+	return true;
+}
+#endif
+
+static void UwacBufferCopyRect(const UwacWindow* w, UwacBuffer* dst, const UwacBuffer* src,
+                               uint32_t x1, uint32_t y1, uint32_t x2, uint32_t y2)
+{
+	uint32_t y;
+	const size_t bpp = bppFromShmFormat(w->format);
+
+	x2 = min(x2, (uint32_t)w->width);
+	y2 = min(y2, (uint32_t)w->height);
+
+	if ((x1 >= x2) || (y1 >= y2))
+		return;
+
+	for (y = y1; y < y2; y++)
+	{
+		const size_t offset = y * 1ULL * w->stride + x1 * bpp;
+		memcpy((char*)dst->data + offset, (const char*)src->data + offset, (x2 - x1) * bpp);
+	}
+}
+
 #ifdef HAVE_PIXMAN_REGION
-		pixman_region32_fini(&buffer->damage);
+static void UwacBufferCopyStale(const UwacWindow* w, UwacBuffer* dst, const UwacBuffer* src)
+{
+	int nrects, i;
+	const pixman_box32_t* box;
+
+	pixman_region32_intersect_rect(&dst->stale, &dst->stale, 0, 0, w->width, w->height);
+	box = pixman_region32_rectangles(&dst->stale, &nrects);
+
+	for (i = 0; i < nrects; i++, box++)
+		UwacBufferCopyRect(w, dst, src, box->x1, box->y1, box->x2, box->y2);
+
+	pixman_region32_clear(&dst->stale);
+}
 #else
-		region16_uninit(&buffer->damage);
+static void UwacBufferCopyStale(const UwacWindow* w, UwacBuffer* dst, const UwacBuffer* src)
+{
+	uint32_t nrects, i;
+	const RECTANGLE_16* box = region16_rects(&dst->stale, &nrects);
+
+	for (i = 0; i < nrects; i++, box++)
+		UwacBufferCopyRect(w, dst, src, box->left, box->top, box->right, box->bottom);
+
+	region16_clear(&dst->stale);
+}
 #endif
+
+static void UwacBuffersFree(UwacBuffer* buffers, int nbuffers)
+{
+	int i;
+
+	for (i = 0; i < nbuffers; i++)
+	{
+		UwacBuffer* buffer = &buffers[i];
+		UwacBufferFreeRegions(buffer);
 		wl_buffer_destroy(buffer->wayland_buffer);
 		munmap(buffer->data, buffer->size);
 	}
 
+	free(buffers);
+}
+
+static void UwacWindowDestroyBuffers(UwacWindow* w)
+{
+	UwacBuffersFree(w->buffers, w->nbuffers);
 	w->nbuffers = 0;
-	free(w->buffers);
 	w->buffers = NULL;
 }
 
 static int UwacWindowShmAllocBuffers(UwacWindow* w, int nbuffers, int allocSize, uint32_t width,
                                      uint32_t height, enum wl_shm_format format);
 
+/* Reallocates the buffers for a new window size, the content of the drawing buffer is kept
+ * where it still fits. Nothing is done if the size did not change. */
+static int UwacWindowResizeBuffers(UwacWindow* w, int32_t width, int32_t height)
+{
+	int i, ret;
+	uint32_t y, copyWidth, copyHeight;
+	UwacBuffer* oldBuffers = w->buffers;
+	const int oldCount = w->nbuffers;
+	const size_t oldStride = w->stride;
+	const UwacBuffer* drawing = NULL;
+
+	if ((w->width == width) && (w->height == height) && (w->drawingBufferIdx >= 0))
+		return UWAC_SUCCESS;
+
+	if (w->drawingBufferIdx >= 0)
+		drawing = &oldBuffers[w->drawingBufferIdx];
+
+	copyWidth = min(width, w->width);
+	copyHeight = min(height, w->height);
+	w->buffers = NULL;
+	w->nbuffers = 0;
+	w->width = width;
+	w->stride = width * bppFromShmFormat(w->format);
+	w->height = height;
+	ret = UwacWindowShmAllocBuffers(w, UWAC_INITIAL_BUFFERS, w->stride * height, width, height,
+	                                w->format);
+
+	if (ret == UWAC_SUCCESS)
+	{
+		if (drawing)
+		{
+			for (y = 0; y < copyHeight; y++)
+				memcpy((char*)w->buffers[0].data + y * 1ULL * w->stride,
+				       (const char*)drawing->data + y * oldStride,
+				       copyWidth * 1ULL * bppFromShmFormat(w->format));
+
+			for (i = 1; i < w->nbuffers; i++)
+			{
+				if (!UwacBufferAddStale(&w->buffers[i], copyWidth, copyHeight))
+					ret = UWAC_ERROR_NOMEMORY;
+			}
+		}
+
+		w->buffers[0].used = true;
+		w->drawingBufferIdx = 0;
+		if (w->pendingBufferIdx != -1)
+			w->pendingBufferIdx = w->drawingBufferIdx;
+	}
+
+	UwacBuffersFree(oldBuffers, oldCount);
+	return ret;
+}
+
 static void xdg_handle_toplevel_configure(void* data, struct xdg_toplevel* xdg_toplevel,
                                           int32_t width, int32_t height, struct wl_array* states)
 {
@@ -125,12 +308,7 @@ static void xdg_handle_toplevel_configure(void* data, struct xdg_toplevel* xdg_t
 	{
 		event->width = width;
 		event->height = height;
-		UwacWindowDestroyBuffers(window);
-		window->width = width;
-		window->stride = width * bppFromShmFormat(window->format);
-		window->height = height;
-		ret = UwacWindowShmAllocBuffers(window, UWAC_INITIAL_BUFFERS, window->stride * height,
-		                                width, height, window->format);
+		ret = UwacWindowResizeBuffers(window, width, height);
 
 		if (ret != UWAC_SUCCESS)
 		{
@@ -139,10 +317,6 @@ static void xdg_handle_toplevel_configure(void* data, struct xdg_toplevel* xdg_t
 			window->drawingBufferIdx = window->pendingBufferIdx = -1;
 			return;
 		}
-
-		window->drawingBufferIdx = 0;
-		if (window->pendingBufferIdx != -1)
-			window->pendingBufferIdx = window->drawingBufferIdx;
 	}
 	else
 	{
@@ -206,12 +380,7 @@ static void ivi_handle_configure(void* data, struct ivi_surface* surface, int32_
 	{
 		event->width = width;
 		event->height = height;
-		UwacWindowDestroyBuffers(window);
-		window->width = width;
-		window->stride = width * bppFromShmFormat(window->format);
-		window->height = height;
-		ret = UwacWindowShmAllocBuffers(window, UWAC_INITIAL_BUFFERS, window->stride * height,
-		                                width, height, window->format);
+		ret = UwacWindowResizeBuffers(window, width, height);
 
 		if (ret != UWAC_SUCCESS)
 		{
@@ -220,10 +389,6 @@ static void ivi_handle_configure(void* data, struct ivi_surface* surface, int32_
 			window->drawingBufferIdx = window->pendingBufferIdx = -1;
 			return;
 		}
-
-		window->drawingBufferIdx = 0;
-		if (window->pendingBufferIdx != -1)
-			window->pendingBufferIdx = window->drawingBufferIdx;
 	}
 	else
 	{
@@ -264,12 +429,7 @@ static void shell_configure(void* data, struct wl_shell_surface* surface, uint32
 	{
 		event->width = width;
 		event->height = height;
-		UwacWindowDestroyBuffers(window);
-		window->width = width;
-		window->stride = width * bppFromShmFormat(window->format);
-		window->height = height;
-		ret = UwacWindowShmAllocBuffers(window, UWAC_INITIAL_BUFFERS, window->stride * height,
-		                                width, height, window->format);
+		ret = UwacWindowResizeBuffers(window, width, height);
 
 		if (ret != UWAC_SUCCESS)
 		{
@@ -278,10 +438,6 @@ static void shell_configure(void* data, struct wl_shell_surface* surface, uint32
 			window->drawingBufferIdx = window->pendingBufferIdx = -1;
 			return;
 		}
-
-		window->drawingBufferIdx = 0;
-		if (window->pendingBufferIdx != -1)
-			window->pendingBufferIdx = window->drawingBufferIdx;
 	}
 	else
 	{
@@ -311,6 +467,10 @@ int UwacWindowShmAllocBuffers(UwacWindow* w, int nbuffers, int allocSize, uint32
 	if (!newBuffers)
 		return UWAC_ERROR_NOMEMORY;
 
+	/* the release listeners still point to the old array */
+	for (i = 0; i < w->nbuffers; i++)
+		wl_buffer_set_user_data(newBuffers[i].wayland_buffer, &newBuffers[i]);
+
 	/* round up to a multiple of PAGESIZE to page align data for each buffer */
 	allocSize = (allocSize + pagesize - 1) & ~(pagesize - 1);
 
@@ -343,11 +503,12 @@ int UwacWindowShmAllocBuffers(UwacWindow* w, int nbuffers, int allocSize, uint32
 	for (i = 0; i < nbuffers; i++)
 	{
 		UwacBuffer* buffer = &w->buffers[w->nbuffers + i];
-#ifdef HAVE_PIXMAN_REGION
-		pixman_region32_init(&buffer->damage);
-#else
-		region16_init(&buffer->damage);
-#endif
+		UwacBufferInitRegions(buffer);
+
+		/* added to a window with content, nothing of it is in the new buffer yet */
+		if ((w->nbuffers > 0) && !UwacBufferAddStale(buffer, width, height))
+			ret = UWAC_ERROR_NOMEMORY;
+
 		buffer->data = data + (allocSize * i);
 		buffer->size = allocSize;
 		buffer->wayland_buffer =
@@ -759,9 +920,11 @@ UwacReturnCode UwacWindowSubmitBuffer(UwacWindow* window, bool copyContentForNex
 	if ((!nextDrawingBuffer) || (window->drawingBufferIdx < 0))
 		return UWAC_ERROR_NOMEMORY;
 
+	if (!UwacWindowMarkStale(window, pendingBuffer))
+		return UWAC_ERROR_NOMEMORY;
+
 	if (copyContentForNextFrame)
-		memcpy(nextDrawingBuffer->data, pendingBuffer->data,
-		       window->stride * window->height * 1ULL);
+		UwacBufferCopyStale(window, nextDrawingBuffer, pendingBuffer);
 
 	UwacSubmitBufferPtr(window, pendingBuffer);
 	return UWAC_SUCCESS;
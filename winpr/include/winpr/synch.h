@@ -417,6 +417,23 @@ extern "C"
 
 	WINPR_API void* GetEventWaitObject(HANDLE hEvent);
 
+	/* Wait set, a persistent set of handles waited on together without the
+	 * MAXIMUM_WAIT_OBJECTS limit. Each handle is added with a key returned when it is
+	 * signalled, the handles must be removed before they are closed. */
+	typedef struct _wWaitSet wWaitSet;
+
+	WINPR_API wWaitSet* WaitSet_New(void);
+	WINPR_API void WaitSet_Free(wWaitSet* set);
+
+	WINPR_API BOOL WaitSet_Add(wWaitSet* set, HANDLE handle, ULONG_PTR key);
+	WINPR_API BOOL WaitSet_Remove(wWaitSet* set, HANDLE handle);
+	WINPR_API size_t WaitSet_Count(wWaitSet* set);
+
+	/* Waits until at least one handle is signalled and stores the keys of up to nCount
+	 * signalled handles in keys. Returns WAIT_OBJECT_0, WAIT_TIMEOUT or WAIT_FAILED. */
+	WINPR_API DWORD WaitSet_Wait(wWaitSet* set, DWORD dwMilliseconds, ULONG_PTR* keys,
+	                             DWORD nCount, DWORD* pSignalled);
+
 #ifdef __cplusplus
 }
 #endif
@@ -26,6 +26,10 @@
 #include <winpr/user.h>
 
 #include "clipboard.h"
+#include "../utils/lodepng/lodepng.h"
+
+/* Largest image/png accepted for conversion, 64 megapixels (256 MiB decoded) */
+#define CLIPBOARD_PNG_MAX_PIXELS (8192ull * 8192ull)
 
 /**
  * Standard Clipboard Formats:
@@ -325,6 +329,264 @@ static void* clipboard_synthesize_image_bmp(wClipboard* clipboard, UINT32 format
 	return NULL;
 }
 
+/**
+ * "image/png" / "PNG":
+ *
+ * Portable Network Graphics, transferred instead of the raw DIB where both sides support it.
+ */
+
+static BOOL clipboard_is_png_format(wClipboard* clipboard, UINT32 formatId)
+{
+	return (formatId == ClipboardGetFormatId(clipboard, "image/png")) ||
+	       (formatId == ClipboardGetFormatId(clipboard, "PNG"));
+}
+
+static const BYTE* clipboard_dib_get_bits(const void* data, UINT32 SrcSize, UINT32* pWidth,
+                                          UINT32* pHeight, UINT32* pBpp, size_t* pStride,
+                                          BOOL* pTopDown)
+{
+	size_t offset;
+	UINT64 length;
+	const BITMAPINFOHEADER* pInfoHeader;
+
+	if (SrcSize < sizeof(BITMAPINFOHEADER))
+		return NULL;
+
+	pInfoHeader = (const BITMAPINFOHEADER*)data;
+
+	if ((pInfoHeader->biSize < sizeof(BITMAPINFOHEADER)) || (pInfoHeader->biWidth <= 0) ||
+	    (pInfoHeader->biHeight == 0) || (pInfoHeader->biHeight == INT32_MIN))
+		return NULL;
+
+	if ((pInfoHeader->biBitCount != 24) && (pInfoHeader->biBitCount != 32))
+		return NULL;
+
+	offset = pInfoHeader->biSize;
+
+	if (pInfoHeader->biCompression == BI_BITFIELDS)
+	{
+		/* Only the default BGRA masks are supported */
+		if (pInfoHeader->biBitCount != 32)
+			return NULL;
+
+		if (pInfoHeader->biSize == sizeof(BITMAPINFOHEADER))
+			offset += 3 * sizeof(DWORD);
+	}
+	else if (pInfoHeader->biCompression != BI_RGB)
+		return NULL;
+
+	offset += pInfoHeader->biClrUsed * sizeof(RGBQUAD);
+	*pWidth = (UINT32)pInfoHeader->biWidth;
+	*pHeight = (UINT32)abs(pInfoHeader->biHeight);
+	*pBpp = pInfoHeader->biBitCount;
+	*pStride = ((*pWidth * (size_t)*pBpp + 31) / 32) * 4;
+	*pTopDown = pInfoHeader->biHeight < 0;
+	length = (UINT64)*pStride * *pHeight;
+
+	if ((offset > SrcSize) || (length > SrcSize - offset))
+		return NULL;
+
+	return &((const BYTE*)data)[offset];
+}
+
+static void* clipboard_synthesize_image_png(wClipboard* clipboard, UINT32 formatId,
+                                            const void* data, UINT32* pSize)
+{
+	UINT32 SrcSize;
+	size_t DstSize = 0;
+	BYTE* pDstData = NULL;
+	SrcSize = *pSize;
+
+	if (clipboard_is_png_format(clipboard, formatId))
+	{
+		pDstData = (BYTE*)malloc(SrcSize);
+
+		if (!pDstData)
+			return NULL;
+
+		CopyMemory(pDstData, data, SrcSize);
+		return pDstData;
+	}
+	else if (formatId == ClipboardGetFormatId(clipboard, "image/bmp"))
+	{
+		const BITMAPFILEHEADER* pFileHeader;
+
+		if (SrcSize < sizeof(BITMAPFILEHEADER))
+			return NULL;
+
+		pFileHeader = (const BITMAPFILEHEADER*)data;
+
+		if (pFileHeader->bfType != 0x4D42)
+			return NULL;
+
+		data = (const void*)&((const BYTE*)data)[sizeof(BITMAPFILEHEADER)];
+		SrcSize -= sizeof(BITMAPFILEHEADER);
+		formatId = CF_DIB;
+	}
+
+	if (formatId == CF_DIB)
+	{
+		UINT32 x, y;
+		UINT32 width, height, bpp;
+		size_t stride;
+		BOOL topDown;
+		BOOL hasAlpha = FALSE;
+		BYTE* pRgba;
+		const BYTE* pBits =
+		    clipboard_dib_get_bits(data, SrcSize, &width, &height, &bpp, &stride, &topDown);
+
+		if (!pBits)
+			return NULL;
+
+		pRgba = (BYTE*)calloc(height, width * 4ull);
+
+		if (!pRgba)
+			return NULL;
+
+		for (y = 0; y < height; y++)
+		{
+			const BYTE* pSrc = &pBits[(topDown ? y : height - y - 1) * stride];
+			BYTE* pDst = &pRgba[y * width * 4ull];
+
+			for (x = 0; x < width; x++)
+			{
+				pDst[0] = pSrc[2];
+				pDst[1] = pSrc[1];
+				pDst[2] = pSrc[0];
+				pDst[3] = (bpp == 32) ? pSrc[3] : 0xFF;
+				hasAlpha |= pDst[3] != 0;
+				pSrc += bpp / 8;
+				pDst += 4;
+			}
+		}
+
+		/* Most 32bpp DIBs leave the reserved byte zero, treat those as opaque */
+		if (!hasAlpha)
+		{
+			for (x = 0; x < width * height; x++)
+				pRgba[x * 4ull + 3] = 0xFF;
+		}
+
+		if (lodepng_encode32(&pDstData, &DstSize, pRgba, width, height) || (DstSize > UINT32_MAX))
+		{
+			free(pDstData);
+			pDstData = NULL;
+		}
+		else
+			*pSize = (UINT32)DstSize;
+
+		free(pRgba);
+	}
+
+	return pDstData;
+}
+
+static BYTE* clipboard_png_to_dib(const void* data, UINT32 SrcSize, size_t headerSize,
+                                  UINT32* pSize)
+{
+	UINT32 x, y;
+	unsigned width = 0;
+	unsigned height = 0;
+	BYTE* pRgba = NULL;
+	BYTE* pDstData = NULL;
+	BITMAPINFOHEADER* pInfoHeader;
+	UINT64 DstSize;
+	LodePNGState state;
+
+	/* Signature and IHDR chunk */
+	if (SrcSize < 33)
+		return NULL;
+
+	/* Check the dimensions from the header before decoding anything */
+	lodepng_state_init(&state);
+	lodepng_inspect(&width, &height, &state, data, SrcSize);
+	lodepng_state_cleanup(&state);
+
+	if (state.error || (width == 0) || (height == 0) ||
+	    (1ull * width * height > CLIPBOARD_PNG_MAX_PIXELS))
+		return NULL;
+
+	if (lodepng_decode32(&pRgba, &width, &height, data, SrcSize))
+		goto fail;
+
+	DstSize = headerSize + sizeof(BITMAPINFOHEADER) + 4ull * width * height;
+
+	if ((width == 0) || (height == 0) || (width > INT32_MAX) || (height > INT32_MAX) ||
+	    (DstSize > UINT32_MAX))
+		goto fail;
+
+	pDstData = (BYTE*)calloc(1, (size_t)DstSize);
+
+	if (!pDstData)
+		goto fail;
+
+	pInfoHeader = (BITMAPINFOHEADER*)&pDstData[headerSize];
+	pInfoHeader->biSize = sizeof(BITMAPINFOHEADER);
+	pInfoHeader->biWidth = (LONG)width;
+	pInfoHeader->biHeight = (LONG)height;
+	pInfoHeader->biPlanes = 1;
+	pInfoHeader->biBitCount = 32;
+	pInfoHeader->biCompression = BI_RGB;
+	pInfoHeader->biSizeImage = 4 * width * height;
+
+	/* Bottom-up BGRA rows */
+	for (y = 0; y < height; y++)
+	{
+		const BYTE* pSrc = &pRgba[(height - y - 1) * width * 4ull];
+		BYTE* pDst = &pDstData[headerSize + sizeof(BITMAPINFOHEADER) + y * width * 4ull];
+
+		for (x = 0; x < width; x++)
+		{
+			pDst[0] = pSrc[2];
+			pDst[1] = pSrc[1];
+			pDst[2] = pSrc[0];
+			pDst[3] = pSrc[3];
+			pSrc += 4;
+			pDst += 4;
+		}
+	}
+
+	free(pRgba);
+	*pSize = (UINT32)DstSize;
+	return pDstData;
+fail:
+	free(pRgba);
+	free(pDstData);
+	return NULL;
+}
+
+static void* clipboard_synthesize_cf_dib_from_png(wClipboard* clipboard, UINT32 formatId,
+                                                  const void* data, UINT32* pSize)
+{
+	if (!clipboard_is_png_format(clipboard, formatId))
+		return NULL;
+
+	return clipboard_png_to_dib(data, *pSize, 0, pSize);
+}
+
+static void* clipboard_synthesize_image_bmp_from_png(wClipboard* clipboard, UINT32 formatId,
+                                                     const void* data, UINT32* pSize)
+{
+	BYTE* pDstData;
+	BITMAPFILEHEADER* pFileHeader;
+
+	if (!clipboard_is_png_format(clipboard, formatId))
+		return NULL;
+
+	pDstData = clipboard_png_to_dib(data, *pSize, sizeof(BITMAPFILEHEADER), pSize);
+
+	if (!pDstData)
+		return NULL;
+
+	pFileHeader = (BITMAPFILEHEADER*)pDstData;
+	pFileHeader->bfType = 0x4D42;
+	pFileHeader->bfSize = *pSize;
+	pFileHeader->bfReserved1 = 0;
+	pFileHeader->bfReserved2 = 0;
+	pFileHeader->bfOffBits = sizeof(BITMAPFILEHEADER) + sizeof(BITMAPINFOHEADER);
+	return pDstData;
+}
+
 /**
  * "HTML Format":
  *
@@ -608,6 +870,46 @@ BOOL ClipboardInitSynthesizers(wClipboard* clipboard)
 	{
 		ClipboardRegisterSynthesizer(clipboard, formatId, CF_DIB, clipboard_synthesize_cf_dib);
 		ClipboardRegisterSynthesizer(clipboard, formatId, CF_DIBV5, clipboard_synthesize_cf_dibv5);
+		altFormatId = ClipboardRegisterFormat(clipboard, "image/png");
+		ClipboardRegisterSynthesizer(clipboard, formatId, altFormatId,
+		                             clipboard_synthesize_image_png);
+		altFormatId = ClipboardRegisterFormat(clipboard, "PNG");
+		ClipboardRegisterSynthesizer(clipboard, formatId, altFormatId,
+		                             clipboard_synthesize_image_png);
+	}
+
+	/**
+	 * CF_DIB to PNG
+	 */
+	formatId = ClipboardRegisterFormat(clipboard, "image/png");
+	altFormatId = ClipboardRegisterFormat(clipboard, "PNG");
+
+	if (formatId && altFormatId)
+	{
+		ClipboardRegisterSynthesizer(clipboard, CF_DIB, formatId, clipboard_synthesize_image_png);
+		ClipboardRegisterSynthesizer(clipboard, CF_DIB, altFormatId,
+		                             clipboard_synthesize_image_png);
+	}
+
+	/**
+	 * image/png and PNG
+	 */
+
+	if (formatId && altFormatId)
+	{
+		const UINT32 bmpFormatId = ClipboardRegisterFormat(clipboard, "image/bmp");
+		ClipboardRegisterSynthesizer(clipboard, formatId, altFormatId,
+		                             clipboard_synthesize_image_png);
+		ClipboardRegisterSynthesizer(clipboard, formatId, CF_DIB,
+		                             clipboard_synthesize_cf_dib_from_png);
+		ClipboardRegisterSynthesizer(clipboard, formatId, bmpFormatId,
+		                             clipboard_synthesize_image_bmp_from_png);
+		ClipboardRegisterSynthesizer(clipboard, altFormatId, formatId,
+		                             clipboard_synthesize_image_png);
+		ClipboardRegisterSynthesizer(clipboard, altFormatId, CF_DIB,
+		                             clipboard_synthesize_cf_dib_from_png);
+		ClipboardRegisterSynthesizer(clipboard, altFormatId, bmpFormatId,
+		                             clipboard_synthesize_image_bmp_from_png);
 	}
 
 	/**
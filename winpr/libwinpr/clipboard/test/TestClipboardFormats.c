@@ -2,6 +2,109 @@
 #include <winpr/crt.h>
 #include <winpr/print.h>
 #include <winpr/clipboard.h>
+#include <winpr/user.h>
+
+static BOOL test_png_round_trip(wClipboard* clipboard)
+{
+	UINT32 x;
+	BOOL rc = FALSE;
+	const UINT32 width = 37;
+	const UINT32 height = 19;
+	const UINT32 stride = ((width * 24 + 31) / 32) * 4;
+	const UINT32 SrcSize = sizeof(BITMAPINFOHEADER) + stride * height;
+	const UINT32 pngFormatId = ClipboardGetFormatId(clipboard, "image/png");
+	BYTE* pSrcData = calloc(1, SrcSize);
+	BYTE* pPngData = NULL;
+	BYTE* pDstData = NULL;
+	BITMAPINFOHEADER* pInfoHeader = (BITMAPINFOHEADER*)pSrcData;
+	const BITMAPINFOHEADER* pDstHeader;
+	UINT32 PngSize = 0;
+	UINT32 DstSize = 0;
+
+	if (!pSrcData || !pngFormatId)
+		goto fail;
+
+	pInfoHeader->biSize = sizeof(BITMAPINFOHEADER);
+	pInfoHeader->biWidth = width;
+	pInfoHeader->biHeight = height;
+	pInfoHeader->biPlanes = 1;
+	pInfoHeader->biBitCount = 24;
+	pInfoHeader->biCompression = BI_RGB;
+
+	for (x = 0; x < stride * height; x++)
+		pSrcData[sizeof(BITMAPINFOHEADER) + x] = (BYTE)(x * 7);
+
+	/* CF_DIB -> image/png */
+	if (!ClipboardSetData(clipboard, CF_DIB, pSrcData, SrcSize))
+		goto fail;
+
+	pPngData = ClipboardGetData(clipboard, pngFormatId, &PngSize);
+
+	if (!pPngData || (PngSize < 8) || (memcmp(pPngData, "\x89PNG", 4) != 0))
+		goto fail;
+
+	/* image/png -> CF_DIB, always 32bpp bottom-up */
+	if (!ClipboardSetData(clipboard, pngFormatId, pPngData, PngSize))
+		goto fail;
+
+	pDstData = ClipboardGetData(clipboard, CF_DIB, &DstSize);
+
+	if (!pDstData || (DstSize != sizeof(BITMAPINFOHEADER) + width * height * 4))
+		goto fail;
+
+	pDstHeader = (const BITMAPINFOHEADER*)pDstData;
+
+	if ((pDstHeader->biWidth != (LONG)width) || (pDstHeader->biHeight != (LONG)height) ||
+	    (pDstHeader->biBitCount != 32))
+		goto fail;
+
+	for (x = 0; x < width * height; x++)
+	{
+		const UINT32 offset = (x / width) * stride + (x % width) * 3;
+		const BYTE* src = &pSrcData[sizeof(BITMAPINFOHEADER) + offset];
+		const BYTE* dst = &pDstData[sizeof(BITMAPINFOHEADER) + x * 4];
+
+		if ((memcmp(src, dst, 3) != 0) || (dst[3] != 0xFF))
+		{
+			fprintf(stderr, "PNG round trip mismatch at pixel %" PRIu32 "\n", x);
+			goto fail;
+		}
+	}
+
+	fprintf(stderr, "CF_DIB %" PRIu32 " bytes -> image/png %" PRIu32 " bytes\n", SrcSize, PngSize);
+	rc = TRUE;
+fail:
+	free(pSrcData);
+	free(pPngData);
+	free(pDstData);
+	return rc;
+}
+
+/* A 65536x65536 RGBA header without image data must be refused before decoding */
+static BOOL test_png_too_large(wClipboard* clipboard)
+{
+	static const BYTE png[] = { 0x89, 0x50, 0x4E, 0x47, 0x0D, 0x0A, 0x1A, 0x0A, 0x00, 0x00, 0x00,
+		                        0x0D, 0x49, 0x48, 0x44, 0x52, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01,
+		                        0x00, 0x00, 0x08, 0x06, 0x00, 0x00, 0x00, 0x6C, 0x84, 0x30, 0xE3,
+		                        0x00, 0x00, 0x00, 0x00, 0x49, 0x45, 0x4E, 0x44, 0xAE, 0x42, 0x60,
+		                        0x82 };
+	const UINT32 pngFormatId = ClipboardGetFormatId(clipboard, "image/png");
+	UINT32 DstSize = 0;
+	void* pDstData;
+
+	if (!ClipboardSetData(clipboard, pngFormatId, png, sizeof(png)))
+		return FALSE;
+
+	pDstData = ClipboardGetData(clipboard, CF_DIB, &DstSize);
+
+	if (pDstData)
+	{
+		free(pDstData);
+		return FALSE;
+	}
+
+	return TRUE;
+}
 
 int TestClipboardFormats(int argc, char* argv[])
 {
@@ -73,6 +176,12 @@ int TestClipboardFormats(int argc, char* argv[])
 		free(pSrcData);
 	}
 
+	if (!test_png_round_trip(clipboard) || !test_png_too_large(clipboard))
+	{
+		ClipboardDestroy(clipboard);
+		return -1;
+	}
+
 	pFormatIds = NULL;
 	count = ClipboardGetFormatIds(clipboard, &pFormatIds);
 
@@ -40,6 +40,8 @@
 #include <winpr/crt.h>
 #include <winpr/assert.h>
 #include <winpr/synch.h>
+#include <winpr/thread.h>
+#include <winpr/sysinfo.h>
 #include <winpr/library.h>
 #include <winpr/smartcard.h>
 #include <winpr/collections.h>
@@ -239,6 +241,7 @@ static LONG WINAPI PCSC_SCardEstablishContext_Internal(DWORD dwScope, LPCVOID pv
                                                        LPCVOID pvReserved2,
                                                        LPSCARDCONTEXT phContext);
 static LONG WINAPI PCSC_SCardReleaseContext_Internal(SCARDCONTEXT hContext);
+static void PCSC_StatusMonitorReleaseContext(SCARDCONTEXT hContext);
 
 static LONG PCSC_SCard_LogError(const char* what)
 {
@@ -744,9 +747,10 @@ static LONG WINAPI PCSC_SCardReleaseContext(SCARDCONTEXT hContext)
 
 	status = PCSC_SCardReleaseContext_Internal(hContext);
 
-	if (status != SCARD_S_SUCCESS)
+	if (status == SCARD_S_SUCCESS)
 		PCSC_ReleaseCardContext(hContext);
 
+	PCSC_StatusMonitorReleaseContext(hContext);
 	return status;
 }
 
@@ -1398,6 +1402,605 @@ static LONG WINAPI PCSC_SCardLocateCardsByATRW(SCARDCONTEXT hContext, LPSCARD_AT
 	return SCARD_E_UNSUPPORTED_FEATURE;
 }
 
+/**
+ * Reader state cache
+ *
+ * A single monitor thread waits for reader changes on its own PC/SC context and caches the
+ * last known state of every reader. SCardGetStatusChange is answered from the cache, so any
+ * number of callers waiting for the same readers share one PC/SC call and a caller does not
+ * hold its context lock while waiting. Calls the cache cannot answer fall back to PC/SC.
+ */
+
+#define PCSC_STATE_MASK                                                                  \
+	(SCARD_STATE_UNKNOWN | SCARD_STATE_UNAVAILABLE | SCARD_STATE_EMPTY | SCARD_STATE_PRESENT | \
+	 SCARD_STATE_EXCLUSIVE | SCARD_STATE_INUSE | SCARD_STATE_MUTE | SCARD_STATE_UNPOWERED)
+
+typedef struct
+{
+	char* szReader;
+	DWORD dwEventState;
+	DWORD cbAtr;
+	BYTE rgbAtr[PCSC_MAX_ATR_SIZE];
+} PCSC_READER_CACHE_ITEM;
+
+typedef struct _PCSC_STATUS_WAITER PCSC_STATUS_WAITER;
+
+struct _PCSC_STATUS_WAITER
+{
+	SCARDCONTEXT hContext;
+	HANDLE event;
+	BOOL cancelled;
+	PCSC_STATUS_WAITER* next;
+};
+
+typedef struct
+{
+	CRITICAL_SECTION runLock; /* serializes starting and stopping the monitor */
+	CRITICAL_SECTION lock;    /* protects everything below */
+	HANDLE thread;
+	HANDLE stopEvent;
+	SCARDCONTEXT hContext;
+	BOOL valid;
+	DWORD dwPnPState;
+	PCSC_READER_CACHE_ITEM* readers;
+	DWORD cReaders;
+	PCSC_STATUS_WAITER* waiters;
+} PCSC_STATUS_MONITOR;
+
+static INIT_ONCE g_StatusMonitorInitialized = INIT_ONCE_STATIC_INIT;
+static PCSC_STATUS_MONITOR g_StatusMonitor = { 0 };
+
+static BOOL CALLBACK PCSC_StatusMonitorInit(PINIT_ONCE once, PVOID param, PVOID* context)
+{
+	WINPR_UNUSED(once);
+	WINPR_UNUSED(param);
+	WINPR_UNUSED(context);
+
+	if (!InitializeCriticalSectionAndSpinCount(&g_StatusMonitor.runLock, 4000))
+		return FALSE;
+
+	if (!InitializeCriticalSectionAndSpinCount(&g_StatusMonitor.lock, 4000))
+	{
+		DeleteCriticalSection(&g_StatusMonitor.runLock);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+static void PCSC_StatusMonitorFreeReaders(PCSC_READER_CACHE_ITEM* readers, DWORD cReaders)
+{
+	DWORD index;
+
+	if (!readers)
+		return;
+
+	for (index = 0; index < cReaders; index++)
+		free(readers[index].szReader);
+
+	free(readers);
+}
+
+static PCSC_READER_CACHE_ITEM* PCSC_StatusMonitorFindReader(PCSC_STATUS_MONITOR* monitor,
+                                                            const char* szReader)
+{
+	DWORD index;
+
+	for (index = 0; index < monitor->cReaders; index++)
+	{
+		if (strcmp(monitor->readers[index].szReader, szReader) == 0)
+			return &monitor->readers[index];
+	}
+
+	return NULL;
+}
+
+/* Wakes all waiters, which check the cache again. Must be called with the lock held. */
+static void PCSC_StatusMonitorNotify(PCSC_STATUS_MONITOR* monitor)
+{
+	PCSC_STATUS_WAITER* waiter;
+
+	for (waiter = monitor->waiters; waiter; waiter = waiter->next)
+		SetEvent(waiter->event);
+}
+
+static LONG PCSC_StatusMonitorListReaders(SCARDCONTEXT hContext, char** pmszReaders)
+{
+	LONG status;
+	PCSC_DWORD cchReaders = 0;
+	char* mszReaders;
+
+	*pmszReaders = NULL;
+	status = PCSC_MapErrorCodeToWinSCard(
+	    g_PCSC.pfnSCardListReaders(hContext, NULL, NULL, &cchReaders));
+
+	if (status == SCARD_E_NO_READERS_AVAILABLE)
+		return SCARD_S_SUCCESS;
+
+	if (status != SCARD_S_SUCCESS)
+		return status;
+
+	mszReaders = calloc(cchReaders + 1, sizeof(char));
+
+	if (!mszReaders)
+		return SCARD_E_NO_MEMORY;
+
+	status = PCSC_MapErrorCodeToWinSCard(
+	    g_PCSC.pfnSCardListReaders(hContext, NULL, mszReaders, &cchReaders));
+
+	if (status == SCARD_E_NO_READERS_AVAILABLE)
+		status = SCARD_S_SUCCESS;
+
+	if (status != SCARD_S_SUCCESS)
+	{
+		free(mszReaders);
+		return status;
+	}
+
+	*pmszReaders = mszReaders;
+	return SCARD_S_SUCCESS;
+}
+
+/**
+ * Waits for a change of any reader and stores the result in the cache. The readers are listed
+ * on every call, changes of the reader list are reported by the PnP notification reader or,
+ * where that is not supported, picked up by the next call after a timeout.
+ */
+static LONG PCSC_StatusMonitorRefresh(PCSC_STATUS_MONITOR* monitor, SCARDCONTEXT hContext,
+                                      PCSC_DWORD dwTimeout)
+{
+	char* p;
+	DWORD index;
+	DWORD cReaders = 0;
+	BOOL unchanged = FALSE;
+	PCSC_DWORD cStates = 0;
+	char* mszReaders = NULL;
+	PCSC_SCARD_READERSTATE* states = NULL;
+	PCSC_READER_CACHE_ITEM* readers = NULL;
+	LONG status = PCSC_StatusMonitorListReaders(hContext, &mszReaders);
+
+	if (status != SCARD_S_SUCCESS)
+		return status;
+
+	for (p = mszReaders; p && *p; p += strlen(p) + 1)
+		cReaders++;
+
+	status = SCARD_E_NO_MEMORY;
+	states = calloc(cReaders + 1, sizeof(PCSC_SCARD_READERSTATE));
+	readers = calloc(cReaders + 1, sizeof(PCSC_READER_CACHE_ITEM));
+
+	if (!states || !readers)
+		goto fail;
+
+	EnterCriticalSection(&monitor->lock);
+
+	if (g_PnP_Notification)
+	{
+		states[cStates].szReader = SMARTCARD_PNP_NOTIFICATION_A;
+		states[cStates].dwCurrentState = monitor->valid ? monitor->dwPnPState : 0;
+		cStates++;
+	}
+
+	for (p = mszReaders; p && *p; p += strlen(p) + 1)
+	{
+		const PCSC_READER_CACHE_ITEM* cached = NULL;
+
+		if (monitor->valid)
+			cached = PCSC_StatusMonitorFindReader(monitor, p);
+
+		states[cStates].szReader = p;
+		states[cStates].dwCurrentState = cached ? cached->dwEventState : SCARD_STATE_UNAWARE;
+		cStates++;
+	}
+
+	/* Without readers or PnP notification there is nothing PC/SC could wait for */
+	unchanged = (cStates == 0) && monitor->valid && (monitor->cReaders == 0);
+	LeaveCriticalSection(&monitor->lock);
+
+	if (cStates > 0)
+		status = PCSC_MapErrorCodeToWinSCard(
+		    g_PCSC.pfnSCardGetStatusChange(hContext, dwTimeout, states, cStates));
+	else if (unchanged)
+		status = (WaitForSingleObject(monitor->stopEvent, 1000) == WAIT_OBJECT_0)
+		             ? SCARD_E_CANCELLED
+		             : SCARD_E_TIMEOUT;
+	else
+		status = SCARD_S_SUCCESS;
+
+	if (status != SCARD_S_SUCCESS)
+		goto fail;
+
+	for (index = 0; index < cReaders; index++)
+	{
+		PCSC_READER_CACHE_ITEM* reader = &readers[index];
+		const PCSC_SCARD_READERSTATE* state = &states[cStates - cReaders + index];
+
+		reader->szReader = _strdup(state->szReader);
+
+		if (!reader->szReader)
+		{
+			status = SCARD_E_NO_MEMORY;
+			goto fail;
+		}
+
+		reader->dwEventState = (DWORD)state->dwEventState & ~SCARD_STATE_CHANGED;
+		reader->cbAtr =
+		    (state->cbAtr < PCSC_MAX_ATR_SIZE) ? (DWORD)state->cbAtr : PCSC_MAX_ATR_SIZE;
+		CopyMemory(reader->rgbAtr, state->rgbAtr, reader->cbAtr);
+	}
+
+	EnterCriticalSection(&monitor->lock);
+	PCSC_StatusMonitorFreeReaders(monitor->readers, monitor->cReaders);
+	monitor->readers = readers;
+	monitor->cReaders = cReaders;
+	monitor->dwPnPState =
+	    g_PnP_Notification ? (DWORD)states[0].dwEventState & ~SCARD_STATE_CHANGED : 0;
+	monitor->valid = TRUE;
+	PCSC_StatusMonitorNotify(monitor);
+	LeaveCriticalSection(&monitor->lock);
+	readers = NULL;
+fail:
+	PCSC_StatusMonitorFreeReaders(readers, cReaders);
+	free(states);
+	free(mszReaders);
+	return status;
+}
+
+static DWORD WINAPI PCSC_StatusMonitorThread(LPVOID arg)
+{
+	PCSC_STATUS_MONITOR* monitor = (PCSC_STATUS_MONITOR*)arg;
+	SCARDCONTEXT hContext = monitor->hContext;
+	/* Without PnP notification new readers are only found by listing them again */
+	const PCSC_DWORD dwTimeout = g_PnP_Notification ? INFINITE : 1000;
+
+	while (WaitForSingleObject(monitor->stopEvent, 0) == WAIT_TIMEOUT)
+	{
+		LONG status = PCSC_StatusMonitorRefresh(monitor, hContext, dwTimeout);
+
+		if ((status == SCARD_S_SUCCESS) || (status == SCARD_E_TIMEOUT) ||
+		    (status == SCARD_E_CANCELLED))
+			continue;
+
+		/* A reader was removed after it was listed */
+		if (status == SCARD_E_UNKNOWN_READER)
+			continue;
+
+		WLog_WARN(TAG, "reader state monitor failed with 0x%08" PRIX32 ", retrying",
+		          (UINT32)status);
+		EnterCriticalSection(&monitor->lock);
+		monitor->valid = FALSE;
+		PCSC_StatusMonitorNotify(monitor);
+		LeaveCriticalSection(&monitor->lock);
+
+		if (WaitForSingleObject(monitor->stopEvent, 1000) != WAIT_TIMEOUT)
+			break;
+
+		/* The resource manager might have been restarted */
+		if (hContext)
+			g_PCSC.pfnSCardReleaseContext(hContext);
+
+		hContext = 0;
+
+		if (g_PCSC.pfnSCardEstablishContext(SCARD_SCOPE_SYSTEM, NULL, NULL, &hContext) !=
+		    SCARD_S_SUCCESS)
+			hContext = 0;
+
+		EnterCriticalSection(&monitor->lock);
+		monitor->hContext = hContext;
+		LeaveCriticalSection(&monitor->lock);
+	}
+
+	return 0;
+}
+
+static BOOL PCSC_StatusMonitorStart(PCSC_STATUS_MONITOR* monitor)
+{
+	BOOL rc = FALSE;
+	SCARDCONTEXT hContext = 0;
+
+	if (!g_PCSC.pfnSCardEstablishContext || !g_PCSC.pfnSCardReleaseContext ||
+	    !g_PCSC.pfnSCardListReaders || !g_PCSC.pfnSCardGetStatusChange || !g_PCSC.pfnSCardCancel)
+		return FALSE;
+
+	if (!InitOnceExecuteOnce(&g_StatusMonitorInitialized, PCSC_StatusMonitorInit, NULL, NULL))
+		return FALSE;
+
+	EnterCriticalSection(&monitor->runLock);
+
+	if (monitor->thread)
+	{
+		LeaveCriticalSection(&monitor->runLock);
+		return TRUE;
+	}
+
+	if (g_PCSC.pfnSCardEstablishContext(SCARD_SCOPE_SYSTEM, NULL, NULL, &hContext) !=
+	    SCARD_S_SUCCESS)
+		goto fail;
+
+	monitor->stopEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+
+	if (!monitor->stopEvent)
+		goto fail;
+
+	/* Fill the cache before the first caller looks at it, unaware readers return at once */
+	if (PCSC_StatusMonitorRefresh(monitor, hContext, 1) != SCARD_S_SUCCESS)
+		goto fail;
+
+	monitor->hContext = hContext;
+	monitor->thread = CreateThread(NULL, 0, PCSC_StatusMonitorThread, monitor, 0, NULL);
+
+	if (!monitor->thread)
+		goto fail;
+
+	rc = TRUE;
+fail:
+
+	if (!rc)
+	{
+		EnterCriticalSection(&monitor->lock);
+		monitor->valid = FALSE;
+		monitor->hContext = 0;
+		LeaveCriticalSection(&monitor->lock);
+
+		if (monitor->stopEvent)
+			CloseHandle(monitor->stopEvent);
+
+		monitor->stopEvent = NULL;
+
+		if (hContext)
+			g_PCSC.pfnSCardReleaseContext(hContext);
+	}
+
+	LeaveCriticalSection(&monitor->runLock);
+	return rc;
+}
+
+static void PCSC_StatusMonitorStop(PCSC_STATUS_MONITOR* monitor)
+{
+	if (!InitOnceExecuteOnce(&g_StatusMonitorInitialized, PCSC_StatusMonitorInit, NULL, NULL))
+		return;
+
+	EnterCriticalSection(&monitor->runLock);
+
+	if (!monitor->thread)
+	{
+		LeaveCriticalSection(&monitor->runLock);
+		return;
+	}
+
+	SetEvent(monitor->stopEvent);
+
+	/* Repeat the cancel, the monitor might not have been waiting in PC/SC the first time */
+	do
+	{
+		SCARDCONTEXT hContext;
+		EnterCriticalSection(&monitor->lock);
+		hContext = monitor->hContext;
+		LeaveCriticalSection(&monitor->lock);
+
+		if (hContext)
+			g_PCSC.pfnSCardCancel(hContext);
+	} while (WaitForSingleObject(monitor->thread, 100) == WAIT_TIMEOUT);
+
+	CloseHandle(monitor->thread);
+	CloseHandle(monitor->stopEvent);
+	monitor->thread = NULL;
+	monitor->stopEvent = NULL;
+
+	if (monitor->hContext)
+		g_PCSC.pfnSCardReleaseContext(monitor->hContext);
+
+	EnterCriticalSection(&monitor->lock);
+	monitor->hContext = 0;
+	monitor->valid = FALSE;
+	PCSC_StatusMonitorFreeReaders(monitor->readers, monitor->cReaders);
+	monitor->readers = NULL;
+	monitor->cReaders = 0;
+	PCSC_StatusMonitorNotify(monitor);
+	LeaveCriticalSection(&monitor->lock);
+	LeaveCriticalSection(&monitor->runLock);
+}
+
+static void PCSC_StatusMonitorCancel(PCSC_STATUS_MONITOR* monitor, SCARDCONTEXT hContext)
+{
+	PCSC_STATUS_WAITER* waiter;
+
+	if (!InitOnceExecuteOnce(&g_StatusMonitorInitialized, PCSC_StatusMonitorInit, NULL, NULL))
+		return;
+
+	EnterCriticalSection(&monitor->lock);
+
+	for (waiter = monitor->waiters; waiter; waiter = waiter->next)
+	{
+		if (waiter->hContext == hContext)
+		{
+			waiter->cancelled = TRUE;
+			SetEvent(waiter->event);
+		}
+	}
+
+	LeaveCriticalSection(&monitor->lock);
+}
+
+static void PCSC_StatusMonitorReleaseContext(SCARDCONTEXT hContext)
+{
+	PCSC_StatusMonitorCancel(&g_StatusMonitor, hContext);
+
+	/* The monitor is only kept running while contexts are in use */
+	if (!g_CardContexts || (ListDictionary_Count(g_CardContexts) == 0))
+		PCSC_StatusMonitorStop(&g_StatusMonitor);
+}
+
+/**
+ * Compares the states the caller knows with the cache and fills in the event states.
+ * Returns -1 if a reader is not in the cache, 1 if any reader changed and 0 otherwise.
+ * Must be called with the lock held.
+ */
+static int PCSC_StatusMonitorCompare(PCSC_STATUS_MONITOR* monitor,
+                                     LPSCARD_READERSTATEA rgReaderStates, DWORD cReaders)
+{
+	DWORD index;
+	int changed = 0;
+
+	for (index = 0; index < cReaders; index++)
+	{
+		BOOL readerChanged;
+		LPSCARD_READERSTATEA state = &rgReaderStates[index];
+		const DWORD dwCurrentState = state->dwCurrentState;
+		const PCSC_READER_CACHE_ITEM* reader;
+
+		if (!state->szReader)
+			return -1;
+
+		if (dwCurrentState & SCARD_STATE_IGNORE)
+		{
+			state->dwEventState = SCARD_STATE_IGNORE;
+			continue;
+		}
+
+		/* The PnP notification reader reports the number of readers in the high word */
+		if (_stricmp(state->szReader, SMARTCARD_PNP_NOTIFICATION_A) == 0)
+		{
+			const DWORD dwEventState = monitor->cReaders << 16;
+			readerChanged = (dwCurrentState & 0xFFFF0000) != dwEventState;
+			state->dwEventState = dwEventState | (readerChanged ? SCARD_STATE_CHANGED : 0);
+
+			if (readerChanged)
+				changed = 1;
+
+			continue;
+		}
+
+		reader = PCSC_StatusMonitorFindReader(monitor, state->szReader);
+
+		if (!reader)
+			return -1;
+
+		/* Like pcsc-lite the event counter is only compared if the caller provided one */
+		readerChanged = (dwCurrentState == SCARD_STATE_UNAWARE) ||
+		                (((dwCurrentState ^ reader->dwEventState) & PCSC_STATE_MASK) != 0);
+
+		if ((dwCurrentState & 0xFFFF0000) &&
+		    ((dwCurrentState & 0xFFFF0000) != (reader->dwEventState & 0xFFFF0000)))
+			readerChanged = TRUE;
+
+		state->dwEventState = reader->dwEventState | (readerChanged ? SCARD_STATE_CHANGED : 0);
+		state->cbAtr = reader->cbAtr;
+		CopyMemory(state->rgbAtr, reader->rgbAtr, reader->cbAtr);
+
+		if (readerChanged)
+			changed = 1;
+	}
+
+	return changed;
+}
+
+/**
+ * Answers SCardGetStatusChange from the reader state cache. Returns FALSE if the cache can not
+ * answer the call, dwTimeout is then updated to the time left for the call to PC/SC.
+ */
+static BOOL PCSC_StatusMonitorGetStatusChange(SCARDCONTEXT hContext, DWORD* dwTimeout,
+                                              LPSCARD_READERSTATEA rgReaderStates,
+                                              DWORD cReaders, LONG* status)
+{
+	BOOL rc = FALSE;
+	BOOL registered;
+	PCSC_STATUS_MONITOR* monitor = &g_StatusMonitor;
+	PCSC_STATUS_WAITER waiter = { 0 };
+	PCSC_STATUS_WAITER** pwaiter;
+	const ULONGLONG start = GetTickCount64();
+
+	if (!cReaders || !rgReaderStates)
+		return FALSE;
+
+	if (!PCSC_StatusMonitorStart(monitor))
+		return FALSE;
+
+	waiter.hContext = hContext;
+	waiter.event = CreateEvent(NULL, TRUE, FALSE, NULL);
+
+	if (!waiter.event)
+		return FALSE;
+
+	/**
+	 * SCardReleaseContext removes the context before it cancels the waiters under the lock,
+	 * checking the context and registering the waiter together can not miss the cancel.
+	 */
+	EnterCriticalSection(&monitor->lock);
+
+	registered = PCSC_GetCardContextData(hContext) != NULL;
+
+	if (registered)
+	{
+		waiter.next = monitor->waiters;
+		monitor->waiters = &waiter;
+	}
+
+	while (registered && monitor->valid)
+	{
+		int changed;
+		DWORD elapsed;
+
+		if (waiter.cancelled)
+		{
+			*status = SCARD_E_CANCELLED;
+			rc = TRUE;
+			break;
+		}
+
+		changed = PCSC_StatusMonitorCompare(monitor, rgReaderStates, cReaders);
+
+		if (changed < 0)
+			break;
+
+		if (changed > 0)
+		{
+			*status = SCARD_S_SUCCESS;
+			rc = TRUE;
+			break;
+		}
+
+		elapsed = (DWORD)(GetTickCount64() - start);
+
+		if ((*dwTimeout != INFINITE) && (elapsed >= *dwTimeout))
+		{
+			*status = SCARD_E_TIMEOUT;
+			rc = TRUE;
+			break;
+		}
+
+		ResetEvent(waiter.event);
+		LeaveCriticalSection(&monitor->lock);
+		WaitForSingleObject(waiter.event,
+		                    (*dwTimeout == INFINITE) ? INFINITE : *dwTimeout - elapsed);
+		EnterCriticalSection(&monitor->lock);
+	}
+
+	for (pwaiter = &monitor->waiters; *pwaiter; pwaiter = &(*pwaiter)->next)
+	{
+		if (*pwaiter == &waiter)
+		{
+			*pwaiter = waiter.next;
+			break;
+		}
+	}
+
+	LeaveCriticalSection(&monitor->lock);
+	CloseHandle(waiter.event);
+
+	/* The context was released before the call, do not keep a monitor started for it */
+	if (!registered)
+		PCSC_StatusMonitorReleaseContext(hContext);
+
+	if (!rc && (*dwTimeout != INFINITE))
+	{
+		const ULONGLONG elapsed = GetTickCount64() - start;
+		*dwTimeout = (elapsed < *dwTimeout) ? *dwTimeout - (DWORD)elapsed : 0;
+	}
+
+	return rc;
+}
+
 static LONG WINAPI PCSC_SCardGetStatusChange_Internal(SCARDCONTEXT hContext, DWORD dwTimeout,
                                                       LPSCARD_READERSTATEA rgReaderStates,
                                                       DWORD cReaders)
@@ -1501,6 +2104,10 @@ static LONG WINAPI PCSC_SCardGetStatusChangeA(SCARDCONTEXT hContext, DWORD dwTim
 {
 	LONG status = SCARD_S_SUCCESS;
 
+	if (PCSC_StatusMonitorGetStatusChange(hContext, &dwTimeout, rgReaderStates, cReaders,
+	                                      &status))
+		return status;
+
 	if (!PCSC_LockCardContext(hContext))
 		return SCARD_E_INVALID_HANDLE;
 
@@ -1522,16 +2129,10 @@ static LONG WINAPI PCSC_SCardGetStatusChangeW(SCARDCONTEXT hContext, DWORD dwTim
 	if (!g_PCSC.pfnSCardGetStatusChange)
 		return PCSC_SCard_LogError("g_PCSC.pfnSCardGetStatusChange");
 
-	if (!PCSC_LockCardContext(hContext))
-		return SCARD_E_INVALID_HANDLE;
-
 	states = (LPSCARD_READERSTATEA)calloc(cReaders, sizeof(SCARD_READERSTATEA));
 
 	if (!states)
-	{
-		PCSC_UnlockCardContext(hContext);
 		return SCARD_E_NO_MEMORY;
-	}
 
 	for (index = 0; index < cReaders; index++)
 	{
@@ -1545,7 +2146,7 @@ static LONG WINAPI PCSC_SCardGetStatusChangeW(SCARDCONTEXT hContext, DWORD dwTim
 		CopyMemory(&(states[index].rgbAtr), &(rgReaderStates[index].rgbAtr), 36);
 	}
 
-	status = PCSC_SCardGetStatusChange_Internal(hContext, dwTimeout, states, cReaders);
+	status = PCSC_SCardGetStatusChangeA(hContext, dwTimeout, states, cReaders);
 
 	for (index = 0; index < cReaders; index++)
 	{
@@ -1558,10 +2159,6 @@ static LONG WINAPI PCSC_SCardGetStatusChangeW(SCARDCONTEXT hContext, DWORD dwTim
 	}
 
 	free(states);
-
-	if (!PCSC_UnlockCardContext(hContext))
-		return SCARD_E_INVALID_HANDLE;
-
 	return status;
 }
 
@@ -1572,6 +2169,8 @@ static LONG WINAPI PCSC_SCardCancel(SCARDCONTEXT hContext)
 	if (!g_PCSC.pfnSCardCancel)
 		return PCSC_SCard_LogError("g_PCSC.pfnSCardCancel");
 
+	PCSC_StatusMonitorCancel(&g_StatusMonitor, hContext);
+
 	status = g_PCSC.pfnSCardCancel(hContext);
 	return PCSC_MapErrorCodeToWinSCard(status);
 }
@@ -0,0 +1,425 @@
+/**
+ * A minimal PC/SC resource manager with the ABI of pcsc-lite. It is built as libpcsclite.so.1
+ * in a directory of its own, the test puts that directory in LD_LIBRARY_PATH so that WinPR
+ * loads it in place of pcsc-lite. Readers and cards are controlled by the MockPCSC_ functions.
+ *
+ * winpr/smartcard.h declares the same functions with the WinSCard ABI, so the pcsc-lite
+ * types are defined here.
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#include <winpr/spec.h>
+
+typedef long MOCK_LONG;
+typedef unsigned long MOCK_DWORD;
+typedef long MOCK_SCARDCONTEXT;
+
+typedef struct
+{
+	const char* szReader;
+	void* pvUserData;
+	MOCK_DWORD dwCurrentState;
+	MOCK_DWORD dwEventState;
+	MOCK_DWORD cbAtr;
+	unsigned char rgbAtr[33];
+} MOCK_READERSTATE;
+
+#define MOCK_S_SUCCESS ((MOCK_LONG)0x00000000)
+#define MOCK_E_CANCELLED ((MOCK_LONG)0x80100002)
+#define MOCK_E_INVALID_HANDLE ((MOCK_LONG)0x80100003)
+#define MOCK_E_INVALID_PARAMETER ((MOCK_LONG)0x80100004)
+#define MOCK_E_NO_MEMORY ((MOCK_LONG)0x80100006)
+#define MOCK_E_INSUFFICIENT_BUFFER ((MOCK_LONG)0x80100008)
+#define MOCK_E_UNKNOWN_READER ((MOCK_LONG)0x80100009)
+#define MOCK_E_TIMEOUT ((MOCK_LONG)0x8010000A)
+#define MOCK_E_NO_READERS_AVAILABLE ((MOCK_LONG)0x8010002E)
+
+#define MOCK_STATE_UNAWARE 0x0000
+#define MOCK_STATE_IGNORE 0x0001
+#define MOCK_STATE_CHANGED 0x0002
+#define MOCK_STATE_EMPTY 0x0010
+#define MOCK_STATE_PRESENT 0x0020
+
+#define MOCK_INFINITE 0xFFFFFFFF
+#define MOCK_MAX_READERS 4
+#define MOCK_MAX_CONTEXTS 16
+
+typedef struct
+{
+	char name[64];
+	int present;
+	unsigned int counter;
+} MockReader;
+
+typedef struct
+{
+	int used;
+	int waiting;
+	int cancelled;
+} MockContext;
+
+static pthread_mutex_t mock_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t mock_cond = PTHREAD_COND_INITIALIZER;
+static MockReader mock_readers[MOCK_MAX_READERS];
+static size_t mock_reader_count = 0;
+static MockContext mock_contexts[MOCK_MAX_CONTEXTS];
+static long mock_status_change_calls = 0;
+static long mock_waiting = 0;
+
+static const unsigned char mock_atr[] = { 0x3B, 0x8F, 0x80, 0x01, 0x80, 0x4F, 0x0C, 0xA0,
+	                                      0x00, 0x00, 0x03, 0x06, 0x03, 0x00, 0x03, 0x00,
+	                                      0x00, 0x00, 0x00, 0x68 };
+
+static const char mock_pnp_reader[] = "\\\\?PnP?\\Notification";
+
+DECLSPEC_EXPORT MOCK_LONG SCardEstablishContext(MOCK_DWORD dwScope, const void* pvReserved1,
+                                                const void* pvReserved2,
+                                                MOCK_SCARDCONTEXT* phContext);
+DECLSPEC_EXPORT MOCK_LONG SCardReleaseContext(MOCK_SCARDCONTEXT hContext);
+DECLSPEC_EXPORT MOCK_LONG SCardIsValidContext(MOCK_SCARDCONTEXT hContext);
+DECLSPEC_EXPORT MOCK_LONG SCardListReaders(MOCK_SCARDCONTEXT hContext, const char* mszGroups,
+                                           char* mszReaders, MOCK_DWORD* pcchReaders);
+DECLSPEC_EXPORT MOCK_LONG SCardGetStatusChange(MOCK_SCARDCONTEXT hContext, MOCK_DWORD dwTimeout,
+                                               MOCK_READERSTATE* rgReaderStates,
+                                               MOCK_DWORD cReaders);
+DECLSPEC_EXPORT MOCK_LONG SCardCancel(MOCK_SCARDCONTEXT hContext);
+
+DECLSPEC_EXPORT int MockPCSC_AddReader(const char* name);
+DECLSPEC_EXPORT int MockPCSC_SetCard(const char* name, int present);
+DECLSPEC_EXPORT long MockPCSC_GetStatusChangeCalls(void);
+DECLSPEC_EXPORT long MockPCSC_GetWaiting(void);
+
+static MockContext* mock_context(MOCK_SCARDCONTEXT hContext)
+{
+	if ((hContext < 1) || (hContext > MOCK_MAX_CONTEXTS))
+		return NULL;
+
+	if (!mock_contexts[hContext - 1].used)
+		return NULL;
+
+	return &mock_contexts[hContext - 1];
+}
+
+static MockReader* mock_reader(const char* name)
+{
+	size_t index;
+
+	for (index = 0; index < mock_reader_count; index++)
+	{
+		if (strcmp(mock_readers[index].name, name) == 0)
+			return &mock_readers[index];
+	}
+
+	return NULL;
+}
+
+MOCK_LONG SCardEstablishContext(MOCK_DWORD dwScope, const void* pvReserved1,
+                                const void* pvReserved2, MOCK_SCARDCONTEXT* phContext)
+{
+	size_t index;
+	MOCK_LONG status = MOCK_E_NO_MEMORY;
+
+	(void)dwScope;
+	(void)pvReserved1;
+	(void)pvReserved2;
+
+	if (!phContext)
+		return MOCK_E_INVALID_PARAMETER;
+
+	pthread_mutex_lock(&mock_lock);
+
+	for (index = 0; index < MOCK_MAX_CONTEXTS; index++)
+	{
+		if (!mock_contexts[index].used && !mock_contexts[index].waiting)
+		{
+			memset(&mock_contexts[index], 0, sizeof(MockContext));
+			mock_contexts[index].used = 1;
+			*phContext = (MOCK_SCARDCONTEXT)index + 1;
+			status = MOCK_S_SUCCESS;
+			break;
+		}
+	}
+
+	pthread_mutex_unlock(&mock_lock);
+	return status;
+}
+
+MOCK_LONG SCardReleaseContext(MOCK_SCARDCONTEXT hContext)
+{
+	MockContext* context;
+	MOCK_LONG status = MOCK_E_INVALID_HANDLE;
+
+	pthread_mutex_lock(&mock_lock);
+	context = mock_context(hContext);
+
+	if (context)
+	{
+		context->used = 0;
+		context->cancelled = context->waiting;
+		pthread_cond_broadcast(&mock_cond);
+		status = MOCK_S_SUCCESS;
+	}
+
+	pthread_mutex_unlock(&mock_lock);
+	return status;
+}
+
+MOCK_LONG SCardIsValidContext(MOCK_SCARDCONTEXT hContext)
+{
+	MOCK_LONG status;
+
+	pthread_mutex_lock(&mock_lock);
+	status = mock_context(hContext) ? MOCK_S_SUCCESS : MOCK_E_INVALID_HANDLE;
+	pthread_mutex_unlock(&mock_lock);
+	return status;
+}
+
+MOCK_LONG SCardListReaders(MOCK_SCARDCONTEXT hContext, const char* mszGroups, char* mszReaders,
+                           MOCK_DWORD* pcchReaders)
+{
+	size_t index;
+	MOCK_DWORD cchReaders = 1;
+	MOCK_LONG status = MOCK_S_SUCCESS;
+
+	(void)mszGroups;
+
+	if (!pcchReaders)
+		return MOCK_E_INVALID_PARAMETER;
+
+	pthread_mutex_lock(&mock_lock);
+
+	for (index = 0; index < mock_reader_count; index++)
+		cchReaders += strlen(mock_readers[index].name) + 1;
+
+	if (!mock_context(hContext))
+		status = MOCK_E_INVALID_HANDLE;
+	else if (mock_reader_count == 0)
+		status = MOCK_E_NO_READERS_AVAILABLE;
+	else if (mszReaders && (*pcchReaders < cchReaders))
+		status = MOCK_E_INSUFFICIENT_BUFFER;
+	else if (mszReaders)
+	{
+		char* p = mszReaders;
+
+		for (index = 0; index < mock_reader_count; index++)
+		{
+			const size_t length = strlen(mock_readers[index].name) + 1;
+			memcpy(p, mock_readers[index].name, length);
+			p += length;
+		}
+
+		*p = '\0';
+	}
+
+	*pcchReaders = cchReaders;
+	pthread_mutex_unlock(&mock_lock);
+	return status;
+}
+
+/* Fills in the event states and sets changed if any reader changed */
+static MOCK_LONG mock_status_compare(MOCK_READERSTATE* rgReaderStates, MOCK_DWORD cReaders,
+                                     int* changed)
+{
+	MOCK_DWORD index;
+
+	*changed = 0;
+
+	for (index = 0; index < cReaders; index++)
+	{
+		int readerChanged;
+		MOCK_DWORD dwEventState;
+		MOCK_READERSTATE* state = &rgReaderStates[index];
+		const MOCK_DWORD dwCurrentState = state->dwCurrentState;
+		const MockReader* reader;
+
+		if (!state->szReader)
+			return MOCK_E_INVALID_PARAMETER;
+
+		if (dwCurrentState & MOCK_STATE_IGNORE)
+		{
+			state->dwEventState = MOCK_STATE_IGNORE;
+			continue;
+		}
+
+		if (strcmp(state->szReader, mock_pnp_reader) == 0)
+		{
+			dwEventState = (MOCK_DWORD)mock_reader_count << 16;
+			readerChanged = (dwCurrentState & 0xFFFF0000) != dwEventState;
+		}
+		else
+		{
+			reader = mock_reader(state->szReader);
+
+			if (!reader)
+				return MOCK_E_UNKNOWN_READER;
+
+			dwEventState = ((MOCK_DWORD)reader->counter << 16) |
+			               (reader->present ? MOCK_STATE_PRESENT : MOCK_STATE_EMPTY);
+			readerChanged = (dwCurrentState == MOCK_STATE_UNAWARE) ||
+			                ((dwCurrentState ^ dwEventState) &
+			                 (MOCK_STATE_PRESENT | MOCK_STATE_EMPTY)) ||
+			                ((dwCurrentState & 0xFFFF0000) &&
+			                 ((dwCurrentState ^ dwEventState) & 0xFFFF0000));
+			state->cbAtr = reader->present ? sizeof(mock_atr) : 0;
+			memcpy(state->rgbAtr, mock_atr, state->cbAtr);
+		}
+
+		state->dwEventState = dwEventState | (readerChanged ? MOCK_STATE_CHANGED : 0);
+
+		if (readerChanged)
+			*changed = 1;
+	}
+
+	return MOCK_S_SUCCESS;
+}
+
+MOCK_LONG SCardGetStatusChange(MOCK_SCARDCONTEXT hContext, MOCK_DWORD dwTimeout,
+                               MOCK_READERSTATE* rgReaderStates, MOCK_DWORD cReaders)
+{
+	struct timespec deadline;
+	MockContext* context;
+	MOCK_LONG status;
+
+	pthread_mutex_lock(&mock_lock);
+	mock_status_change_calls++;
+	context = mock_context(hContext);
+
+	if (!context)
+	{
+		pthread_mutex_unlock(&mock_lock);
+		return MOCK_E_INVALID_HANDLE;
+	}
+
+	clock_gettime(CLOCK_REALTIME, &deadline);
+	deadline.tv_sec += (time_t)(dwTimeout / 1000);
+	deadline.tv_nsec += (long)(dwTimeout % 1000) * 1000000L;
+
+	if (deadline.tv_nsec >= 1000000000L)
+	{
+		deadline.tv_sec++;
+		deadline.tv_nsec -= 1000000000L;
+	}
+
+	context->waiting++;
+	mock_waiting++;
+
+	while (1)
+	{
+		int changed = 0;
+		int rc = 0;
+
+		status = mock_status_compare(rgReaderStates, cReaders, &changed);
+
+		if ((status != MOCK_S_SUCCESS) || changed)
+			break;
+
+		if (context->cancelled)
+		{
+			context->cancelled = 0;
+			status = context->used ? MOCK_E_CANCELLED : MOCK_E_INVALID_HANDLE;
+			break;
+		}
+
+		/* Like pcsc-lite a timeout of 0 is infinite */
+		if ((dwTimeout == 0) || (dwTimeout == MOCK_INFINITE))
+			pthread_cond_wait(&mock_cond, &mock_lock);
+		else
+			rc = pthread_cond_timedwait(&mock_cond, &mock_lock, &deadline);
+
+		if (rc == ETIMEDOUT)
+		{
+			status = MOCK_E_TIMEOUT;
+			break;
+		}
+	}
+
+	context->waiting--;
+	mock_waiting--;
+	pthread_mutex_unlock(&mock_lock);
+	return status;
+}
+
+MOCK_LONG SCardCancel(MOCK_SCARDCONTEXT hContext)
+{
+	MockContext* context;
+	MOCK_LONG status = MOCK_E_INVALID_HANDLE;
+
+	pthread_mutex_lock(&mock_lock);
+	context = mock_context(hContext);
+
+	if (context)
+	{
+		/* Only a call in progress is cancelled */
+		if (context->waiting)
+			context->cancelled = 1;
+
+		pthread_cond_broadcast(&mock_cond);
+		status = MOCK_S_SUCCESS;
+	}
+
+	pthread_mutex_unlock(&mock_lock);
+	return status;
+}
+
+int MockPCSC_AddReader(const char* name)
+{
+	int rc = -1;
+
+	pthread_mutex_lock(&mock_lock);
+
+	if ((mock_reader_count < MOCK_MAX_READERS) && (strlen(name) < sizeof(mock_readers[0].name)))
+	{
+		MockReader* reader = &mock_readers[mock_reader_count++];
+		memset(reader, 0, sizeof(MockReader));
+		strcpy(reader->name, name);
+		pthread_cond_broadcast(&mock_cond);
+		rc = 0;
+	}
+
+	pthread_mutex_unlock(&mock_lock);
+	return rc;
+}
+
+int MockPCSC_SetCard(const char* name, int present)
+{
+	int rc = -1;
+	MockReader* reader;
+
+	pthread_mutex_lock(&mock_lock);
+	reader = mock_reader(name);
+
+	if (reader)
+	{
+		reader->present = present;
+		reader->counter++;
+		pthread_cond_broadcast(&mock_cond);
+		rc = 0;
+	}
+
+	pthread_mutex_unlock(&mock_lock);
+	return rc;
+}
+
+long MockPCSC_GetStatusChangeCalls(void)
+{
+	long calls;
+
+	pthread_mutex_lock(&mock_lock);
+	calls = mock_status_change_calls;
+	pthread_mutex_unlock(&mock_lock);
+	return calls;
+}
+
+long MockPCSC_GetWaiting(void)
+{
+	long waiting;
+
+	pthread_mutex_lock(&mock_lock);
+	waiting = mock_waiting;
+	pthread_mutex_unlock(&mock_lock);
+	return waiting;
+}
@@ -0,0 +1,349 @@
+
+#include <stdio.h>
+#include <winpr/crt.h>
+#include <winpr/synch.h>
+#include <winpr/thread.h>
+#include <winpr/library.h>
+#include <winpr/sysinfo.h>
+#include <winpr/smartcard.h>
+
+#define MOCK_READER "Mock Reader 0"
+
+typedef int (*fnMockAddReader)(const char* name);
+typedef int (*fnMockSetCard)(const char* name, int present);
+typedef long (*fnMockGetCount)(void);
+
+typedef struct
+{
+	SCARDCONTEXT hContext;
+	DWORD dwTimeout;
+	SCARD_READERSTATEA state;
+	LONG status;
+} TestStatusChangeCall;
+
+static fnMockAddReader MockAddReader = NULL;
+static fnMockSetCard MockSetCard = NULL;
+static fnMockGetCount MockGetStatusChangeCalls = NULL;
+static fnMockGetCount MockGetWaiting = NULL;
+
+/* The mock is built as libpcsclite.so.1 and found first through LD_LIBRARY_PATH, so WinPR
+ * loads it as the PC/SC library. */
+static HMODULE test_load_mock(void)
+{
+	HMODULE mock = LoadLibraryA("libpcsclite.so.1");
+
+	if (!mock)
+	{
+		printf("LoadLibraryA(libpcsclite.so.1) failed\n");
+		return NULL;
+	}
+
+	MockAddReader = (fnMockAddReader)GetProcAddress(mock, "MockPCSC_AddReader");
+	MockSetCard = (fnMockSetCard)GetProcAddress(mock, "MockPCSC_SetCard");
+	MockGetStatusChangeCalls =
+	    (fnMockGetCount)GetProcAddress(mock, "MockPCSC_GetStatusChangeCalls");
+	MockGetWaiting = (fnMockGetCount)GetProcAddress(mock, "MockPCSC_GetWaiting");
+
+	if (!MockAddReader || !MockSetCard || !MockGetStatusChangeCalls || !MockGetWaiting)
+	{
+		printf("libpcsclite.so.1 is not the mock, LD_LIBRARY_PATH must point to it\n");
+		FreeLibrary(mock);
+		return NULL;
+	}
+
+	return mock;
+}
+
+static DWORD WINAPI test_status_change_thread(LPVOID arg)
+{
+	TestStatusChangeCall* call = (TestStatusChangeCall*)arg;
+	call->status = SCardGetStatusChangeA(call->hContext, call->dwTimeout, &call->state, 1);
+	return 0;
+}
+
+/* Waits until the status monitor is blocked in PC/SC */
+static BOOL test_wait_monitor(void)
+{
+	int retry;
+
+	for (retry = 0; retry < 500; retry++)
+	{
+		if (MockGetWaiting() > 0)
+			return TRUE;
+
+		Sleep(10);
+	}
+
+	printf("reader state monitor not waiting for changes\n");
+	return FALSE;
+}
+
+/* Unchanged states are answered from the cache, without calls to PC/SC */
+static BOOL test_cached(SCARDCONTEXT hContext[2], DWORD dwKnownState)
+{
+	int index;
+	long calls;
+
+	if (!test_wait_monitor())
+		return FALSE;
+
+	calls = MockGetStatusChangeCalls();
+
+	for (index = 0; index < 16; index++)
+	{
+		LONG status;
+		SCARD_READERSTATEA state = { 0 };
+		state.szReader = MOCK_READER;
+		state.dwCurrentState = dwKnownState;
+		status = SCardGetStatusChangeA(hContext[index % 2], 0, &state, 1);
+
+		if ((status != SCARD_E_TIMEOUT) || (state.dwEventState & SCARD_STATE_CHANGED))
+		{
+			printf("unchanged state returned 0x%08" PRIX32 "\n", (UINT32)status);
+			return FALSE;
+		}
+	}
+
+	if (MockGetStatusChangeCalls() != calls)
+	{
+		printf("%ld PC/SC calls for cached states\n", MockGetStatusChangeCalls() - calls);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+static BOOL test_pnp(SCARDCONTEXT hContext)
+{
+	LONG status;
+	SCARD_READERSTATEW state = { 0 };
+	WCHAR* reader = NULL;
+
+	if (ConvertToUnicode(CP_UTF8, 0, "\\\\?PnP?\\Notification", -1, &reader, 0) <= 0)
+		return FALSE;
+
+	state.szReader = reader;
+	state.dwCurrentState = 1 << 16;
+	status = SCardGetStatusChangeW(hContext, 0, &state, 1);
+
+	if (status != SCARD_E_TIMEOUT)
+	{
+		printf("PnP notification with known reader count returned 0x%08" PRIX32 "\n",
+		       (UINT32)status);
+		goto fail;
+	}
+
+	state.dwCurrentState = 0;
+	status = SCardGetStatusChangeW(hContext, 0, &state, 1);
+
+	if ((status != SCARD_S_SUCCESS) || (state.dwEventState != ((1 << 16) | SCARD_STATE_CHANGED)))
+	{
+		printf("PnP notification did not report the reader count\n");
+		goto fail;
+	}
+
+	free(reader);
+	return TRUE;
+fail:
+	free(reader);
+	return FALSE;
+}
+
+static BOOL test_insert(SCARDCONTEXT hContext, DWORD* dwKnownState)
+{
+	HANDLE thread;
+	TestStatusChangeCall call = { 0 };
+
+	call.hContext = hContext;
+	call.dwTimeout = INFINITE;
+	call.state.szReader = MOCK_READER;
+	call.state.dwCurrentState = *dwKnownState;
+	thread = CreateThread(NULL, 0, test_status_change_thread, &call, 0, NULL);
+
+	if (!thread)
+		return FALSE;
+
+	Sleep(50);
+
+	if ((MockSetCard(MOCK_READER, 1) != 0) || (WaitForSingleObject(thread, 5000) != WAIT_OBJECT_0))
+	{
+		printf("card insertion not reported\n");
+		return FALSE;
+	}
+
+	CloseHandle(thread);
+
+	if ((call.status != SCARD_S_SUCCESS) ||
+	    ((call.state.dwEventState & (SCARD_STATE_PRESENT | SCARD_STATE_CHANGED)) !=
+	     (SCARD_STATE_PRESENT | SCARD_STATE_CHANGED)) ||
+	    (call.state.cbAtr == 0))
+	{
+		printf("card insertion returned 0x%08" PRIX32 ", state 0x%08" PRIX32 "\n",
+		       (UINT32)call.status, call.state.dwEventState);
+		return FALSE;
+	}
+
+	*dwKnownState = call.state.dwEventState & ~SCARD_STATE_CHANGED;
+	return TRUE;
+}
+
+/* A waiting call does not block the context and is cancelled by SCardCancel */
+static BOOL test_cancel(SCARDCONTEXT hContext, DWORD dwKnownState)
+{
+	int retry;
+	LONG status;
+	HANDLE thread;
+	ULONGLONG start;
+	SCARD_READERSTATEA state = { 0 };
+	TestStatusChangeCall call = { 0 };
+
+	call.hContext = hContext;
+	call.dwTimeout = INFINITE;
+	call.state.szReader = MOCK_READER;
+	call.state.dwCurrentState = dwKnownState;
+	thread = CreateThread(NULL, 0, test_status_change_thread, &call, 0, NULL);
+
+	if (!thread)
+		return FALSE;
+
+	Sleep(50);
+	state.szReader = MOCK_READER;
+	state.dwCurrentState = dwKnownState;
+	start = GetTickCount64();
+	status = SCardGetStatusChangeA(hContext, 0, &state, 1);
+
+	if ((status != SCARD_E_TIMEOUT) || (GetTickCount64() - start > 1000))
+	{
+		printf("context blocked by a waiting call\n");
+		return FALSE;
+	}
+
+	/* The call might not be waiting yet, cancel until it returns */
+	for (retry = 0; retry < 100; retry++)
+	{
+		SCardCancel(hContext);
+
+		if (WaitForSingleObject(thread, 50) == WAIT_OBJECT_0)
+			break;
+	}
+
+	if (retry == 100)
+	{
+		printf("waiting call not cancelled\n");
+		return FALSE;
+	}
+
+	CloseHandle(thread);
+
+	if (call.status != SCARD_E_CANCELLED)
+	{
+		printf("cancelled call returned 0x%08" PRIX32 "\n", (UINT32)call.status);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+/* A call racing with SCardReleaseContext of its context must not keep waiting */
+static BOOL test_release(DWORD dwKnownState)
+{
+	HANDLE thread;
+	TestStatusChangeCall call = { 0 };
+
+	if (SCardEstablishContext(SCARD_SCOPE_USER, NULL, NULL, &call.hContext) != SCARD_S_SUCCESS)
+		return FALSE;
+
+	call.dwTimeout = INFINITE;
+	call.state.szReader = MOCK_READER;
+	call.state.dwCurrentState = dwKnownState;
+	thread = CreateThread(NULL, 0, test_status_change_thread, &call, 0, NULL);
+
+	if (!thread)
+	{
+		SCardReleaseContext(call.hContext);
+		return FALSE;
+	}
+
+	SCardReleaseContext(call.hContext);
+
+	if (WaitForSingleObject(thread, 5000) != WAIT_OBJECT_0)
+	{
+		printf("waiting call not cancelled by SCardReleaseContext\n");
+		return FALSE;
+	}
+
+	CloseHandle(thread);
+
+	if ((call.status != SCARD_E_CANCELLED) && (call.status != SCARD_E_INVALID_HANDLE))
+	{
+		printf("released call returned 0x%08" PRIX32 "\n", (UINT32)call.status);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+int TestSmartCardStatusCache(int argc, char* argv[])
+{
+	int rc = -1;
+	LONG status;
+	DWORD dwKnownState;
+	HMODULE mock = NULL;
+	SCARDCONTEXT hContext[2] = { 0 };
+	SCARD_READERSTATEA state = { 0 };
+
+	WINPR_UNUSED(argc);
+	WINPR_UNUSED(argv);
+
+	mock = test_load_mock();
+
+	if (!mock || (MockAddReader(MOCK_READER) != 0))
+		goto fail;
+
+	if ((SCardEstablishContext(SCARD_SCOPE_USER, NULL, NULL, &hContext[0]) != SCARD_S_SUCCESS) ||
+	    (SCardEstablishContext(SCARD_SCOPE_USER, NULL, NULL, &hContext[1]) != SCARD_S_SUCCESS))
+	{
+		printf("SCardEstablishContext failed\n");
+		goto fail;
+	}
+
+	/* An unaware caller gets the current state at once */
+	state.szReader = MOCK_READER;
+	state.dwCurrentState = SCARD_STATE_UNAWARE;
+	status = SCardGetStatusChangeA(hContext[0], 0, &state, 1);
+
+	if ((status != SCARD_S_SUCCESS) || !(state.dwEventState & SCARD_STATE_EMPTY) ||
+	    !(state.dwEventState & SCARD_STATE_CHANGED))
+	{
+		printf("initial state not reported\n");
+		goto fail;
+	}
+
+	dwKnownState = state.dwEventState & ~SCARD_STATE_CHANGED;
+
+	if (!test_cached(hContext, dwKnownState) || !test_pnp(hContext[1]) ||
+	    !test_insert(hContext[1], &dwKnownState) || !test_cached(hContext, dwKnownState) ||
+	    !test_cancel(hContext[0], dwKnownState) || !test_release(dwKnownState))
+		goto fail;
+
+	rc = 0;
+fail:
+
+	if (hContext[0])
+		SCardReleaseContext(hContext[0]);
+
+	if (hContext[1])
+		SCardReleaseContext(hContext[1]);
+
+	/* Releasing the last context stops the monitor */
+	if ((rc == 0) && (MockGetWaiting() != 0))
+	{
+		printf("reader state monitor still running\n");
+		rc = -1;
+	}
+
+	if (mock)
+		FreeLibrary(mock);
+
+	return rc;
+}
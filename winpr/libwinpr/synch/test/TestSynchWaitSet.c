@@ -0,0 +1,218 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <winpr/crt.h>
+#include <winpr/synch.h>
+#include <winpr/sysinfo.h>
+
+#define TEST_EVENTS 200
+#define TEST_BENCHMARK_WAITS 10000
+
+static int compare_keys(const void* a, const void* b)
+{
+	const ULONG_PTR ka = *(const ULONG_PTR*)a;
+	const ULONG_PTR kb = *(const ULONG_PTR*)b;
+	return (ka > kb) - (ka < kb);
+}
+
+static BOOL test_wait(wWaitSet* set, DWORD timeout, DWORD nCount, const ULONG_PTR* expected,
+                      DWORD nExpected)
+{
+	DWORD x;
+	DWORD signalled = 0;
+	ULONG_PTR keys[8] = { 0 };
+	const DWORD status = WaitSet_Wait(set, timeout, keys, nCount, &signalled);
+
+	if (status != (nExpected ? WAIT_OBJECT_0 : WAIT_TIMEOUT))
+	{
+		printf("WaitSet_Wait returned 0x%08" PRIx32 "\n", status);
+		return FALSE;
+	}
+
+	if (signalled != nExpected)
+	{
+		printf("WaitSet_Wait returned %" PRIu32 " keys instead of %" PRIu32 "\n", signalled,
+		       nExpected);
+		return FALSE;
+	}
+
+	qsort(keys, signalled, sizeof(ULONG_PTR), compare_keys);
+
+	for (x = 0; x < signalled; x++)
+	{
+		if (keys[x] != expected[x])
+		{
+			printf("WaitSet_Wait returned key %" PRIuz " instead of %" PRIuz "\n",
+			       (size_t)keys[x], (size_t)expected[x]);
+			return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
+static BOOL test_waitset(void)
+{
+	size_t x;
+	BOOL rc = FALSE;
+	HANDLE events[TEST_EVENTS] = { 0 };
+	HANDLE semaphore = CreateSemaphore(NULL, 2, 2, NULL);
+	wWaitSet* set = WaitSet_New();
+	const ULONG_PTR expected[] = { 1003, 1150, 1199 };
+
+	if (!set || !semaphore)
+		goto fail;
+
+	/* More handles than WaitForMultipleObjects supports */
+	for (x = 0; x < TEST_EVENTS; x++)
+	{
+		events[x] = CreateEvent(NULL, TRUE, FALSE, NULL);
+
+		if (!events[x] || !WaitSet_Add(set, events[x], 1000 + x))
+			goto fail;
+	}
+
+	if (WaitSet_Add(set, events[0], 1) || (WaitSet_Count(set) != TEST_EVENTS))
+	{
+		printf("handle added twice\n");
+		goto fail;
+	}
+
+	if (!test_wait(set, 0, 8, NULL, 0))
+		goto fail;
+
+	if (!SetEvent(events[3]) || !SetEvent(events[150]) || !SetEvent(events[199]))
+		goto fail;
+
+	/* Manual reset events stay signalled */
+	if (!test_wait(set, INFINITE, 8, expected, 3) || !test_wait(set, 0, 8, expected, 3))
+		goto fail;
+
+	/* A batch is limited to nCount keys */
+	{
+		ULONG_PTR keys[2];
+		DWORD signalled = 0;
+
+		if ((WaitSet_Wait(set, 0, keys, ARRAYSIZE(keys), &signalled) != WAIT_OBJECT_0) ||
+		    (signalled != ARRAYSIZE(keys)))
+		{
+			printf("WaitSet_Wait batch not limited\n");
+			goto fail;
+		}
+	}
+
+	if (!ResetEvent(events[3]) || !ResetEvent(events[199]))
+		goto fail;
+
+	if (!test_wait(set, 0, 8, &expected[1], 1))
+		goto fail;
+
+	/* Removing a handle moves the last one, its key must not change */
+	if (!WaitSet_Remove(set, events[150]) || WaitSet_Remove(set, events[150]) ||
+	    (WaitSet_Count(set) != TEST_EVENTS - 1))
+		goto fail;
+
+	if (!test_wait(set, 0, 8, NULL, 0) || !SetEvent(events[199]) ||
+	    !test_wait(set, 0, 8, &expected[2], 1) || !ResetEvent(events[199]))
+		goto fail;
+
+	/* A wait acquires a semaphore like WaitForSingleObject */
+	if (!WaitSet_Add(set, semaphore, 42))
+		goto fail;
+
+	{
+		const ULONG_PTR key = 42;
+
+		if (!test_wait(set, 10, 8, &key, 1) || !test_wait(set, 10, 8, &key, 1) ||
+		    !test_wait(set, 10, 8, NULL, 0))
+			goto fail;
+	}
+
+	rc = TRUE;
+fail:
+	WaitSet_Free(set);
+
+	for (x = 0; x < TEST_EVENTS; x++)
+	{
+		if (events[x])
+			CloseHandle(events[x]);
+	}
+
+	if (semaphore)
+		CloseHandle(semaphore);
+
+	return rc;
+}
+
+static BOOL test_benchmark(size_t count)
+{
+	size_t x;
+	BOOL rc = FALSE;
+	UINT64 start;
+	ULONG_PTR key;
+	DWORD signalled;
+	HANDLE* events = calloc(count, sizeof(HANDLE));
+	wWaitSet* set = WaitSet_New();
+
+	if (!events || !set)
+		goto fail;
+
+	for (x = 0; x < count; x++)
+	{
+		events[x] = CreateEvent(NULL, TRUE, FALSE, NULL);
+
+		if (!events[x] || !WaitSet_Add(set, events[x], x))
+		{
+			printf("failed to add %" PRIuz " events, raise the file descriptor limit\n", count);
+			goto fail;
+		}
+	}
+
+	if (!SetEvent(events[count / 2]))
+		goto fail;
+
+	start = GetTickCount64();
+
+	for (x = 0; x < TEST_BENCHMARK_WAITS; x++)
+	{
+		if ((WaitSet_Wait(set, INFINITE, &key, 1, &signalled) != WAIT_OBJECT_0) ||
+		    (key != count / 2))
+			goto fail;
+	}
+
+	printf("%6" PRIuz " handles: %d waits in %" PRIu64 "ms\n", count, TEST_BENCHMARK_WAITS,
+	       GetTickCount64() - start);
+	rc = TRUE;
+fail:
+	WaitSet_Free(set);
+
+	for (x = 0; events && (x < count); x++)
+	{
+		if (events[x])
+			CloseHandle(events[x]);
+	}
+
+	free(events);
+	return rc;
+}
+
+/* Pass "benchmark" as argument to time waits on sets of up to 10000 handles */
+int TestSynchWaitSet(int argc, char* argv[])
+{
+	size_t x;
+	const size_t counts[] = { 10, 100, 1000, 10000 };
+
+	if (!test_waitset())
+		return -1;
+
+	if ((argc > 1) && (strcmp(argv[argc - 1], "benchmark") == 0))
+	{
+		for (x = 0; x < ARRAYSIZE(counts); x++)
+		{
+			if (!test_benchmark(counts[x]))
+				return -1;
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,469 @@
+/**
+ * WinPR: Windows Portable Runtime
+ * Synchronization Functions
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <errno.h>
+
+#include <winpr/crt.h>
+#include <winpr/synch.h>
+#include <winpr/sysinfo.h>
+#include <winpr/collections.h>
+
+#ifndef _WIN32
+#ifdef HAVE_SYS_EPOLL_H
+#include <sys/epoll.h>
+#include <unistd.h>
+#else
+#include "pollset.h"
+#endif
+
+#include "../handle/handle.h"
+#endif
+
+#include "../log.h"
+#define TAG WINPR_TAG("sync.waitset")
+
+/**
+ * The handles of a wait set are registered once, with epoll the cost of a wait only
+ * depends on the number of signalled handles. Elsewhere the registered handles are
+ * polled with a pollset on each wait.
+ */
+
+typedef struct
+{
+	HANDLE handle;
+	ULONG_PTR key;
+	size_t index;
+#ifndef _WIN32
+	int fd;
+	ULONG mode;
+#endif
+} wWaitSetEntry;
+
+struct _wWaitSet
+{
+	wHashTable* table;
+	wWaitSetEntry** entries;
+	size_t count;
+	size_t size;
+#if !defined(_WIN32) && defined(HAVE_SYS_EPOLL_H)
+	int epfd;
+	struct epoll_event* events;
+	size_t eventsSize;
+#elif !defined(_WIN32)
+	WINPR_POLL_SET pollset;
+	size_t pollsetSize;
+#endif
+};
+
+#if !defined(_WIN32) && defined(HAVE_SYS_EPOLL_H)
+static uint32_t waitset_mode_to_events(ULONG mode)
+{
+	uint32_t events = 0;
+
+	if (mode & WINPR_FD_READ)
+		events |= EPOLLIN;
+
+	if (mode & WINPR_FD_WRITE)
+		events |= EPOLLOUT;
+
+	return events;
+}
+#endif
+
+wWaitSet* WaitSet_New(void)
+{
+	wWaitSet* set = calloc(1, sizeof(wWaitSet));
+
+	if (!set)
+		return NULL;
+
+#if !defined(_WIN32) && defined(HAVE_SYS_EPOLL_H)
+	set->epfd = epoll_create1(EPOLL_CLOEXEC);
+
+	if (set->epfd < 0)
+	{
+		WLog_ERR(TAG, "epoll_create1 failed with %s [%d]", strerror(errno), errno);
+		free(set);
+		return NULL;
+	}
+#endif
+
+	set->table = HashTable_New(FALSE);
+
+	if (!set->table)
+		goto fail;
+
+	return set;
+fail:
+	WaitSet_Free(set);
+	return NULL;
+}
+
+void WaitSet_Free(wWaitSet* set)
+{
+	size_t x;
+
+	if (!set)
+		return;
+
+	for (x = 0; x < set->count; x++)
+		free(set->entries[x]);
+
+#if !defined(_WIN32) && defined(HAVE_SYS_EPOLL_H)
+	close(set->epfd);
+	free(set->events);
+#elif !defined(_WIN32)
+	if (set->pollsetSize > 0)
+		pollset_uninit(&set->pollset);
+#endif
+
+	HashTable_Free(set->table);
+	free(set->entries);
+	free(set);
+}
+
+BOOL WaitSet_Add(wWaitSet* set, HANDLE handle, ULONG_PTR key)
+{
+	wWaitSetEntry* entry;
+
+	if (!set || !handle)
+	{
+		SetLastError(ERROR_INVALID_PARAMETER);
+		return FALSE;
+	}
+
+	if (HashTable_Contains(set->table, handle))
+	{
+		SetLastError(ERROR_ALREADY_EXISTS);
+		return FALSE;
+	}
+
+#if defined(_WIN32)
+	if (set->count == MAXIMUM_WAIT_OBJECTS)
+	{
+		SetLastError(ERROR_NOT_SUPPORTED);
+		return FALSE;
+	}
+#endif
+
+	if (set->count == set->size)
+	{
+		const size_t size = (set->size > 0) ? set->size * 2 : 32;
+		wWaitSetEntry** tmp = realloc(set->entries, size * sizeof(wWaitSetEntry*));
+
+		if (!tmp)
+			goto fail_memory;
+
+		set->entries = tmp;
+		set->size = size;
+	}
+
+	entry = calloc(1, sizeof(wWaitSetEntry));
+
+	if (!entry)
+		goto fail_memory;
+
+	entry->handle = handle;
+	entry->key = key;
+	entry->index = set->count;
+
+#ifndef _WIN32
+	{
+		ULONG type;
+		WINPR_HANDLE* object;
+
+		if (!winpr_Handle_GetInfo(handle, &type, &object) ||
+		    ((entry->fd = winpr_Handle_getFd(object)) < 0))
+		{
+			WLog_ERR(TAG, "handle %p can not be waited on", handle);
+			free(entry);
+			SetLastError(ERROR_INVALID_HANDLE);
+			return FALSE;
+		}
+
+		entry->mode = object->Mode;
+	}
+#endif
+
+#if !defined(_WIN32) && defined(HAVE_SYS_EPOLL_H)
+	{
+		struct epoll_event event = { 0 };
+		event.events = waitset_mode_to_events(entry->mode);
+		event.data.ptr = entry;
+
+		/* Fails for a file descriptor shared with a handle already in the set */
+		if (epoll_ctl(set->epfd, EPOLL_CTL_ADD, entry->fd, &event) < 0)
+		{
+			WLog_ERR(TAG, "epoll_ctl(EPOLL_CTL_ADD) for fd %d failed with %s [%d]", entry->fd,
+			         strerror(errno), errno);
+			free(entry);
+			SetLastError(ERROR_INVALID_HANDLE);
+			return FALSE;
+		}
+	}
+#endif
+
+	if (!HashTable_Insert(set->table, handle, entry))
+	{
+#if !defined(_WIN32) && defined(HAVE_SYS_EPOLL_H)
+		epoll_ctl(set->epfd, EPOLL_CTL_DEL, entry->fd, NULL);
+#endif
+		free(entry);
+		goto fail_memory;
+	}
+
+	set->entries[set->count++] = entry;
+	return TRUE;
+
+fail_memory:
+	SetLastError(ERROR_NOT_ENOUGH_MEMORY);
+	return FALSE;
+}
+
+BOOL WaitSet_Remove(wWaitSet* set, HANDLE handle)
+{
+	wWaitSetEntry* entry;
+
+	if (!set || !handle)
+	{
+		SetLastError(ERROR_INVALID_PARAMETER);
+		return FALSE;
+	}
+
+	entry = HashTable_GetItemValue(set->table, handle);
+
+	if (!entry)
+	{
+		SetLastError(ERROR_NOT_FOUND);
+		return FALSE;
+	}
+
+#if !defined(_WIN32) && defined(HAVE_SYS_EPOLL_H)
+	if (epoll_ctl(set->epfd, EPOLL_CTL_DEL, entry->fd, NULL) < 0)
+		WLog_WARN(TAG, "epoll_ctl(EPOLL_CTL_DEL) for fd %d failed with %s [%d]", entry->fd,
+		          strerror(errno), errno);
+#endif
+
+	HashTable_Remove(set->table, handle);
+
+	/* The order of the entries does not matter, move the last one to the gap */
+	set->count--;
+	set->entries[entry->index] = set->entries[set->count];
+	set->entries[entry->index]->index = entry->index;
+	free(entry);
+	return TRUE;
+}
+
+size_t WaitSet_Count(wWaitSet* set)
+{
+	if (!set)
+		return 0;
+
+	return set->count;
+}
+
+/* Resets auto reset objects, like a successful wait does */
+static BOOL waitset_signalled(wWaitSetEntry* entry, ULONG_PTR* keys, DWORD* pSignalled)
+{
+#ifndef _WIN32
+	if (winpr_Handle_cleanup(entry->handle) != WAIT_OBJECT_0)
+	{
+		WLog_ERR(TAG, "error in cleanup function for handle %p", entry->handle);
+		return FALSE;
+	}
+#endif
+
+	keys[(*pSignalled)++] = entry->key;
+	return TRUE;
+}
+
+#if defined(_WIN32)
+static DWORD waitset_wait(wWaitSet* set, DWORD dwMilliseconds, ULONG_PTR* keys, DWORD nCount,
+                          DWORD* pSignalled)
+{
+	size_t x;
+	DWORD status;
+	HANDLE handles[MAXIMUM_WAIT_OBJECTS];
+
+	for (x = 0; x < set->count; x++)
+		handles[x] = set->entries[x]->handle;
+
+	status = WaitForMultipleObjects((DWORD)set->count, handles, FALSE, dwMilliseconds);
+
+	if ((status == WAIT_TIMEOUT) || (status == WAIT_FAILED))
+		return status;
+
+	if (status >= WAIT_OBJECT_0 + set->count)
+		return WAIT_FAILED;
+
+	waitset_signalled(set->entries[status - WAIT_OBJECT_0], keys, pSignalled);
+
+	/* Collect the other signalled handles without waiting */
+	for (x = status - WAIT_OBJECT_0 + 1; (x < set->count) && (*pSignalled < nCount); x++)
+	{
+		if (WaitForSingleObject(handles[x], 0) == WAIT_OBJECT_0)
+			waitset_signalled(set->entries[x], keys, pSignalled);
+	}
+
+	return WAIT_OBJECT_0;
+}
+#elif defined(HAVE_SYS_EPOLL_H)
+static DWORD waitset_wait(wWaitSet* set, DWORD dwMilliseconds, ULONG_PTR* keys, DWORD nCount,
+                          DWORD* pSignalled)
+{
+	int x;
+	int status;
+	UINT64 now, dueTime;
+	const int maxEvents = (nCount > INT32_MAX) ? INT32_MAX : (int)nCount;
+
+	if (set->eventsSize < (size_t)maxEvents)
+	{
+		struct epoll_event* tmp = realloc(set->events, maxEvents * sizeof(struct epoll_event));
+
+		if (!tmp)
+		{
+			SetLastError(ERROR_NOT_ENOUGH_MEMORY);
+			return WAIT_FAILED;
+		}
+
+		set->events = tmp;
+		set->eventsSize = (size_t)maxEvents;
+	}
+
+	now = GetTickCount64();
+
+	if (dwMilliseconds == INFINITE)
+		dueTime = UINT64_MAX;
+	else
+		dueTime = now + dwMilliseconds;
+
+	do
+	{
+		const int timeout = (dwMilliseconds == INFINITE) ? -1 : (int)(dueTime - now);
+		status = epoll_wait(set->epfd, set->events, maxEvents, timeout);
+
+		if ((status >= 0) || (errno != EINTR))
+			break;
+
+		now = GetTickCount64();
+	} while (now < dueTime);
+
+	if (status < 0)
+	{
+		if (errno == EINTR)
+			return WAIT_TIMEOUT;
+
+		WLog_ERR(TAG, "epoll_wait failed with %s [%d]", strerror(errno), errno);
+		SetLastError(ERROR_INTERNAL_ERROR);
+		return WAIT_FAILED;
+	}
+
+	for (x = 0; x < status; x++)
+	{
+		/* Errors are reported as signalled, the owner of the handle sees them on access */
+		if (!waitset_signalled((wWaitSetEntry*)set->events[x].data.ptr, keys, pSignalled))
+		{
+			SetLastError(ERROR_INTERNAL_ERROR);
+			return WAIT_FAILED;
+		}
+	}
+
+	return (status > 0) ? WAIT_OBJECT_0 : WAIT_TIMEOUT;
+}
+#else
+static DWORD waitset_wait(wWaitSet* set, DWORD dwMilliseconds, ULONG_PTR* keys, DWORD nCount,
+                          DWORD* pSignalled)
+{
+	size_t x;
+	int status;
+
+	if (set->pollsetSize < set->count)
+	{
+		if (set->pollsetSize > 0)
+			pollset_uninit(&set->pollset);
+
+		set->pollsetSize = 0;
+
+		if (!pollset_init(&set->pollset, set->size))
+		{
+			SetLastError(ERROR_NOT_ENOUGH_MEMORY);
+			return WAIT_FAILED;
+		}
+
+		set->pollsetSize = set->size;
+	}
+
+	pollset_reset(&set->pollset);
+
+	for (x = 0; x < set->count; x++)
+	{
+		if (!pollset_add(&set->pollset, set->entries[x]->fd, set->entries[x]->mode))
+		{
+			SetLastError(ERROR_INTERNAL_ERROR);
+			return WAIT_FAILED;
+		}
+	}
+
+	status = pollset_poll(&set->pollset, dwMilliseconds);
+
+	if (status < 0)
+	{
+		WLog_ERR(TAG, "pollset_poll failed with %s [%d]", strerror(errno), errno);
+		SetLastError(ERROR_INTERNAL_ERROR);
+		return WAIT_FAILED;
+	}
+
+	for (x = 0; (x < set->count) && (*pSignalled < nCount); x++)
+	{
+		if (!pollset_isSignaled(&set->pollset, x))
+			continue;
+
+		if (!waitset_signalled(set->entries[x], keys, pSignalled))
+		{
+			SetLastError(ERROR_INTERNAL_ERROR);
+			return WAIT_FAILED;
+		}
+	}
+
+	return (*pSignalled > 0) ? WAIT_OBJECT_0 : WAIT_TIMEOUT;
+}
+#endif
+
+DWORD WaitSet_Wait(wWaitSet* set, DWORD dwMilliseconds, ULONG_PTR* keys, DWORD nCount,
+                   DWORD* pSignalled)
+{
+	if (!set || !keys || (nCount == 0) || !pSignalled)
+	{
+		SetLastError(ERROR_INVALID_PARAMETER);
+		return WAIT_FAILED;
+	}
+
+	*pSignalled = 0;
+
+	if (set->count == 0)
+	{
+		WLog_ERR(TAG, "waiting on an empty wait set");
+		SetLastError(ERROR_INVALID_PARAMETER);
+		return WAIT_FAILED;
+	}
+
+	return waitset_wait(set, dwMilliseconds, keys, nCount, pSignalled);
+}
@@ -27,6 +27,9 @@
 
 #include <winpr/collections.h>
 
+/* Number of times a consumer checks the queue before it blocks on the event */
+#define MESSAGE_QUEUE_SPIN_COUNT 64
+
 struct _wMessageQueue
 {
 	size_t head;
@@ -38,6 +41,13 @@ struct _wMessageQueue
 	CRITICAL_SECTION lock;
 	HANDLE event;
 
+	/* The event is only set while a consumer is blocked in MessageQueue_Wait, unless
+	 * the event was handed out and must follow the queue state for any waiter. */
+	BOOL eventSet;
+	BOOL eventShared;
+	size_t waiters;
+	DWORD spinCount;
+
 	wObject object;
 };
 
@@ -56,6 +66,25 @@ wObject* MessageQueue_Object(wMessageQueue* queue)
 	return &queue->object;
 }
 
+/* Both are called with the lock held and only touch the event on a state change */
+static void MessageQueue_Signal(wMessageQueue* queue)
+{
+	if (!queue->eventSet && (queue->size > 0) && (queue->eventShared || (queue->waiters > 0)))
+	{
+		SetEvent(queue->event);
+		queue->eventSet = TRUE;
+	}
+}
+
+static void MessageQueue_Unsignal(wMessageQueue* queue)
+{
+	if (queue->eventSet && (queue->size == 0))
+	{
+		ResetEvent(queue->event);
+		queue->eventSet = FALSE;
+	}
+}
+
 /**
  * Gets an event which is set when the queue is non-empty
  */
@@ -63,6 +92,16 @@ wObject* MessageQueue_Object(wMessageQueue* queue)
 HANDLE MessageQueue_Event(wMessageQueue* queue)
 {
 	WINPR_ASSERT(queue);
+
+	/* The caller may wait on the event directly, keep it in sync with the queue from now on */
+	if (!queue->eventShared)
+	{
+		EnterCriticalSection(&queue->lock);
+		queue->eventShared = TRUE;
+		MessageQueue_Signal(queue);
+		LeaveCriticalSection(&queue->lock);
+	}
+
 	return queue->event;
 }
 
@@ -82,12 +121,34 @@ size_t MessageQueue_Size(wMessageQueue* queue)
 
 BOOL MessageQueue_Wait(wMessageQueue* queue)
 {
+	DWORD spin;
 	BOOL status = FALSE;
 
 	WINPR_ASSERT(queue);
+
+	/* A busy producer usually posts again shortly, check before blocking */
+	for (spin = 0; spin <= queue->spinCount; spin++)
+	{
+		EnterCriticalSection(&queue->lock);
+
+		if (queue->size > 0)
+		{
+			LeaveCriticalSection(&queue->lock);
+			return TRUE;
+		}
+
+		if (spin == queue->spinCount)
+			queue->waiters++;
+
+		LeaveCriticalSection(&queue->lock);
+	}
+
 	if (WaitForSingleObject(queue->event, INFINITE) == WAIT_OBJECT_0)
 		status = TRUE;
 
+	EnterCriticalSection(&queue->lock);
+	queue->waiters--;
+	LeaveCriticalSection(&queue->lock);
 	return status;
 }
 
@@ -146,9 +207,7 @@ BOOL MessageQueue_Dispatch(wMessageQueue* queue, const wMessage* message)
 
 	queue->tail = (queue->tail + 1) % queue->capacity;
 	queue->size++;
-
-	if (queue->size > 0)
-		SetEvent(queue->event);
+	MessageQueue_Signal(queue);
 
 	if (message->id == WMQ_QUIT)
 		queue->closed = TRUE;
@@ -193,8 +252,7 @@ int MessageQueue_Get(wMessageQueue* queue, wMessage* message)
 		queue->head = (queue->head + 1) % queue->capacity;
 		queue->size--;
 
-		if (queue->size < 1)
-			ResetEvent(queue->event);
+		MessageQueue_Unsignal(queue);
 
 		status = (message->id != WMQ_QUIT) ? 1 : 0;
 	}
@@ -222,8 +280,7 @@ int MessageQueue_Peek(wMessageQueue* queue, wMessage* message, BOOL remove)
 			queue->head = (queue->head + 1) % queue->capacity;
 			queue->size--;
 
-			if (queue->size < 1)
-				ResetEvent(queue->event);
+			MessageQueue_Unsignal(queue);
 		}
 	}
 
@@ -247,6 +304,14 @@ wMessageQueue* MessageQueue_New(const wObject* callback)
 	if (!InitializeCriticalSectionAndSpinCount(&queue->lock, 4000))
 		goto fail;
 
+	{
+		SYSTEM_INFO sysinfo;
+
+		/* Spinning only helps if the producer runs at the same time */
+		GetNativeSystemInfo(&sysinfo);
+		queue->spinCount = (sysinfo.dwNumberOfProcessors > 1) ? MESSAGE_QUEUE_SPIN_COUNT : 0;
+	}
+
 	if (!MessageQueue_EnsureCapacity(queue, 32))
 		goto fail;
 
@@ -303,7 +368,7 @@ int MessageQueue_Clear(wMessageQueue* queue)
 		queue->head = (queue->head + 1) % queue->capacity;
 		queue->size--;
 	}
-	ResetEvent(queue->event);
+	MessageQueue_Unsignal(queue);
 	queue->closed = FALSE;
 
 	LeaveCriticalSection(&queue->lock);
@@ -24,12 +24,17 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
 
 #include <winpr/wtypes.h>
 #include <winpr/crt.h>
 #include <winpr/sam.h>
 #include <winpr/print.h>
 #include <winpr/file.h>
+#include <winpr/synch.h>
+#include <winpr/interlocked.h>
+#include <winpr/collections.h>
 
 #include "../log.h"
 
@@ -44,6 +49,17 @@
 #endif
 #define TAG WINPR_TAG("utils")
 
+/* Parsed SAM file shared by all read only handles, replaced when the file changes */
+typedef struct
+{
+	LONG refCount;
+	INT64 mtime;
+	INT64 mtimeNs;
+	INT64 size;
+	UINT64 inode;
+	wHashTable* entries;
+} WINPR_SAM_DB;
+
 struct winpr_sam
 {
 	FILE* fp;
@@ -51,8 +67,16 @@ struct winpr_sam
 	char* buffer;
 	char* context;
 	BOOL readOnly;
+	WINPR_SAM_DB* db;
 };
 
+static INIT_ONCE samCacheOnce = INIT_ONCE_STATIC_INIT;
+static CRITICAL_SECTION samCacheLock;
+static wHashTable* samCache = NULL;
+
+static WINPR_SAM_DB* SamCacheGet(const char* filename);
+static void SamDbUnref(WINPR_SAM_DB* db);
+
 static WINPR_SAM_ENTRY* SamEntryFromDataA(LPCSTR User, DWORD UserLength, LPCSTR Domain,
                                           DWORD DomainLength)
 {
@@ -66,6 +90,28 @@ static WINPR_SAM_ENTRY* SamEntryFromDataA(LPCSTR User, DWORD UserLength, LPCSTR
 	return entry;
 }
 
+/* User and domain are compared ASCII case insensitive, for every kind of handle */
+static char SamFoldA(char c)
+{
+	if ((c >= 'A') && (c <= 'Z'))
+		return (char)(c - 'A' + 'a');
+
+	return c;
+}
+
+static BOOL SamAreStringsEqual(LPCSTR a, LPCSTR b, UINT32 length)
+{
+	UINT32 x;
+
+	for (x = 0; x < length; x++)
+	{
+		if (SamFoldA(a[x]) != SamFoldA(b[x]))
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
 static BOOL SamAreEntriesEqual(const WINPR_SAM_ENTRY* a, const WINPR_SAM_ENTRY* b)
 {
 	if (!a || !b)
@@ -74,9 +120,9 @@ static BOOL SamAreEntriesEqual(const WINPR_SAM_ENTRY* a, const WINPR_SAM_ENTRY*
 		return FALSE;
 	if (a->DomainLength != b->DomainLength)
 		return FALSE;
-	if (strncmp(a->User, b->User, a->UserLength) != 0)
+	if (!SamAreStringsEqual(a->User, b->User, a->UserLength))
 		return FALSE;
-	if (strncmp(a->Domain, b->Domain, a->DomainLength) != 0)
+	if (!SamAreStringsEqual(a->Domain, b->Domain, a->DomainLength))
 		return FALSE;
 	return TRUE;
 }
@@ -90,15 +136,33 @@ WINPR_SAM* SamOpen(const char* filename, BOOL readOnly)
 		filename = WINPR_SAM_FILE;
 
 	if (readOnly)
-		fp = winpr_fopen(filename, "r");
-	else
 	{
-		fp = winpr_fopen(filename, "r+");
+		WINPR_SAM_DB* db = SamCacheGet(filename);
+
+		if (!db)
+		{
+			WLog_DBG(TAG, "Could not open SAM file!");
+			return NULL;
+		}
+
+		sam = (WINPR_SAM*)calloc(1, sizeof(WINPR_SAM));
+
+		if (!sam)
+		{
+			SamDbUnref(db);
+			return NULL;
+		}
 
-		if (!fp)
-			fp = winpr_fopen(filename, "w+");
+		sam->readOnly = TRUE;
+		sam->db = db;
+		return sam;
 	}
 
+	fp = winpr_fopen(filename, "r+");
+
+	if (!fp)
+		fp = winpr_fopen(filename, "w+");
+
 	if (fp)
 	{
 		sam = (WINPR_SAM*)calloc(1, sizeof(WINPR_SAM));
@@ -170,18 +234,18 @@ static void SamLookupFinish(WINPR_SAM* sam)
 	sam->line = NULL;
 }
 
-static BOOL SamReadEntry(WINPR_SAM* sam, WINPR_SAM_ENTRY* entry)
+static BOOL SamReadEntry(const char* line, WINPR_SAM_ENTRY* entry)
 {
-	char* p[5];
+	const char* p[5];
 	size_t LmHashLength;
 	size_t NtHashLength;
 	size_t count = 0;
-	char* cur;
+	const char* cur;
 
-	if (!sam || !entry || !sam->line)
+	if (!entry || !line)
 		return FALSE;
 
-	cur = sam->line;
+	cur = line;
 
 	while ((cur = strchr(cur, ':')) != NULL)
 	{
@@ -192,7 +256,7 @@ static BOOL SamReadEntry(WINPR_SAM* sam, WINPR_SAM_ENTRY* entry)
 	if (count < 4)
 		return FALSE;
 
-	p[0] = sam->line;
+	p[0] = line;
 	p[1] = strchr(p[0], ':') + 1;
 	p[2] = strchr(p[1], ':') + 1;
 	p[3] = strchr(p[2], ':') + 1;
@@ -277,13 +341,276 @@ void SamResetEntry(WINPR_SAM_ENTRY* entry)
 	ZeroMemory(entry->NtHash, sizeof(entry->NtHash));
 }
 
+static void SamFreeEntryObject(void* obj)
+{
+	SamFreeEntry(NULL, (WINPR_SAM_ENTRY*)obj);
+}
+
+/* Folded like SamAreEntriesEqual compares, ':' can not be part of user or domain */
+static char* SamEntryKey(LPCSTR User, UINT32 UserLength, LPCSTR Domain, UINT32 DomainLength)
+{
+	size_t x;
+	char* key;
+	const size_t length = (size_t)UserLength + DomainLength + 1;
+
+	if ((UserLength > 0 && !User) || (DomainLength > 0 && !Domain))
+		return NULL;
+
+	key = malloc(length + 1);
+
+	if (!key)
+		return NULL;
+
+	if (UserLength > 0)
+		memcpy(key, User, UserLength);
+
+	key[UserLength] = ':';
+
+	if (DomainLength > 0)
+		memcpy(&key[UserLength + 1], Domain, DomainLength);
+
+	key[length] = '\0';
+
+	for (x = 0; x < length; x++)
+		key[x] = SamFoldA(key[x]);
+
+	return key;
+}
+
+static WINPR_SAM_ENTRY* SamCopyEntry(const WINPR_SAM_ENTRY* entry)
+{
+	WINPR_SAM_ENTRY* copy = calloc(1, sizeof(WINPR_SAM_ENTRY));
+
+	if (!copy)
+		return NULL;
+
+	*copy = *entry;
+	copy->User = NULL;
+	copy->Domain = NULL;
+
+	if (entry->UserLength > 0)
+	{
+		copy->User = _strdup(entry->User);
+
+		if (!copy->User)
+			goto fail;
+	}
+
+	if (entry->DomainLength > 0)
+	{
+		copy->Domain = _strdup(entry->Domain);
+
+		if (!copy->Domain)
+			goto fail;
+	}
+
+	return copy;
+fail:
+	SamFreeEntry(NULL, copy);
+	return NULL;
+}
+
+static BOOL SamFileStat(const char* filename, WINPR_SAM_DB* info)
+{
+#ifdef _WIN32
+	struct _stat64 st;
+
+	if (_stat64(filename, &st) != 0)
+		return FALSE;
+#else
+	struct stat st;
+
+	if (stat(filename, &st) != 0)
+		return FALSE;
+#endif
+
+	info->mtime = (INT64)st.st_mtime;
+#if defined(__linux__)
+	info->mtimeNs = (INT64)st.st_mtim.tv_nsec;
+#else
+	info->mtimeNs = 0;
+#endif
+	info->size = (INT64)st.st_size;
+	info->inode = (UINT64)st.st_ino;
+	return TRUE;
+}
+
+static void SamDbUnref(WINPR_SAM_DB* db)
+{
+	if (!db || (InterlockedDecrement(&db->refCount) > 0))
+		return;
+
+	HashTable_Free(db->entries);
+	free(db);
+}
+
+/* Parses all entries of the file, the first entry of a user and domain pair is used */
+static WINPR_SAM_DB* SamDbLoad(const char* filename, const WINPR_SAM_DB* info)
+{
+	WINPR_SAM sam = { 0 };
+	WINPR_SAM_DB* db = calloc(1, sizeof(WINPR_SAM_DB));
+
+	if (!db)
+		return NULL;
+
+	db->refCount = 1;
+	db->mtime = info->mtime;
+	db->mtimeNs = info->mtimeNs;
+	db->size = info->size;
+	db->inode = info->inode;
+	db->entries = HashTable_New(FALSE);
+
+	if (!db->entries || !HashTable_SetupForStringData(db->entries, FALSE))
+		goto fail;
+
+	HashTable_ValueObject(db->entries)->fnObjectFree = SamFreeEntryObject;
+	sam.fp = winpr_fopen(filename, "r");
+
+	if (!sam.fp)
+		goto fail;
+
+	/* An empty file has no entries */
+	if ((info->size > 0) && !SamLookupStart(&sam))
+		goto fail;
+
+	for (; sam.line != NULL; sam.line = strtok_s(NULL, "\n", &sam.context))
+	{
+		char* key;
+		BOOL added;
+		WINPR_SAM_ENTRY* entry;
+
+		if ((strlen(sam.line) <= 1) || (sam.line[0] == '#'))
+			continue;
+
+		entry = calloc(1, sizeof(WINPR_SAM_ENTRY));
+
+		if (!entry)
+			goto fail;
+
+		if (!SamReadEntry(sam.line, entry))
+		{
+			WLog_WARN(TAG, "Ignoring invalid entry in SAM file %s", filename);
+			free(entry);
+			continue;
+		}
+
+		key = SamEntryKey(entry->User, entry->UserLength, entry->Domain, entry->DomainLength);
+		added = key && !HashTable_Contains(db->entries, key) &&
+		        HashTable_Insert(db->entries, key, entry);
+
+		if (!added)
+			SamFreeEntry(NULL, entry);
+
+		free(key);
+	}
+
+	SamLookupFinish(&sam);
+	fclose(sam.fp);
+	return db;
+fail:
+	SamLookupFinish(&sam);
+
+	if (sam.fp)
+		fclose(sam.fp);
+
+	SamDbUnref(db);
+	return NULL;
+}
+
+static BOOL CALLBACK SamCacheInit(PINIT_ONCE once, PVOID param, PVOID* context)
+{
+	WINPR_UNUSED(once);
+	WINPR_UNUSED(param);
+	WINPR_UNUSED(context);
+
+	if (!InitializeCriticalSectionAndSpinCount(&samCacheLock, 4000))
+		return FALSE;
+
+	samCache = HashTable_New(FALSE);
+
+	if (!samCache || !HashTable_SetupForStringData(samCache, FALSE))
+	{
+		HashTable_Free(samCache);
+		samCache = NULL;
+		DeleteCriticalSection(&samCacheLock);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+/* Returns a reference to the parsed file, it is parsed again if it changed since the last call */
+static WINPR_SAM_DB* SamCacheGet(const char* filename)
+{
+	WINPR_SAM_DB info = { 0 };
+	WINPR_SAM_DB* db;
+
+	if (!InitOnceExecuteOnce(&samCacheOnce, SamCacheInit, NULL, NULL))
+		return NULL;
+
+	/* Check the file before it is read, so a change while reading triggers another reload */
+	if (!SamFileStat(filename, &info))
+		return NULL;
+
+	EnterCriticalSection(&samCacheLock);
+	db = HashTable_GetItemValue(samCache, filename);
+
+	if (!db || (db->mtime != info.mtime) || (db->mtimeNs != info.mtimeNs) ||
+	    (db->size != info.size) || (db->inode != info.inode))
+	{
+		WINPR_SAM_DB* old = db;
+		db = SamDbLoad(filename, &info);
+
+		if (!db)
+			goto out;
+
+		if (!HashTable_Insert(samCache, filename, db))
+		{
+			SamDbUnref(db);
+			db = NULL;
+			goto out;
+		}
+
+		SamDbUnref(old);
+	}
+
+	InterlockedIncrement(&db->refCount);
+out:
+	LeaveCriticalSection(&samCacheLock);
+	return db;
+}
+
+static WINPR_SAM_ENTRY* SamDbLookup(WINPR_SAM_DB* db, LPCSTR User, UINT32 UserLength,
+                                    LPCSTR Domain, UINT32 DomainLength)
+{
+	const WINPR_SAM_ENTRY* entry;
+	char* key = SamEntryKey(User, UserLength, Domain, DomainLength);
+
+	if (!key)
+		return NULL;
+
+	entry = HashTable_GetItemValue(db->entries, key);
+	free(key);
+
+	if (!entry)
+		return NULL;
+
+	return SamCopyEntry(entry);
+}
+
 WINPR_SAM_ENTRY* SamLookupUserA(WINPR_SAM* sam, LPCSTR User, UINT32 UserLength, LPCSTR Domain,
                                 UINT32 DomainLength)
 {
 	size_t length;
 	BOOL found = FALSE;
-	WINPR_SAM_ENTRY* search = SamEntryFromDataA(User, UserLength, Domain, DomainLength);
-	WINPR_SAM_ENTRY* entry = (WINPR_SAM_ENTRY*)calloc(1, sizeof(WINPR_SAM_ENTRY));
+	WINPR_SAM_ENTRY* search;
+	WINPR_SAM_ENTRY* entry;
+
+	if (sam && sam->db)
+		return SamDbLookup(sam->db, User, UserLength, Domain, DomainLength);
+
+	search = SamEntryFromDataA(User, UserLength, Domain, DomainLength);
+	entry = (WINPR_SAM_ENTRY*)calloc(1, sizeof(WINPR_SAM_ENTRY));
 
 	if (!entry || !search)
 		goto fail;
@@ -299,12 +626,8 @@ WINPR_SAM_ENTRY* SamLookupUserA(WINPR_SAM* sam, LPCSTR User, UINT32 UserLength,
 		{
 			if (sam->line[0] != '#')
 			{
-				if (!SamReadEntry(sam, entry))
-				{
-					goto out_fail;
-				}
-
-				if (SamAreEntriesEqual(entry, search))
+				/* Invalid entries are skipped like in the read only cache */
+				if (SamReadEntry(sam->line, entry) && SamAreEntriesEqual(entry, search))
 				{
 					found = 1;
 					break;
@@ -316,7 +639,6 @@ WINPR_SAM_ENTRY* SamLookupUserA(WINPR_SAM* sam, LPCSTR User, UINT32 UserLength,
 		sam->line = strtok_s(NULL, "\n", &sam->context);
 	}
 
-out_fail:
 	SamLookupFinish(sam);
 fail:
 	SamFreeEntry(sam, search);
@@ -358,7 +680,10 @@ void SamClose(WINPR_SAM* sam)
 {
 	if (sam != NULL)
 	{
-		fclose(sam->fp);
+		if (sam->fp)
+			fclose(sam->fp);
+
+		SamDbUnref(sam->db);
 		free(sam);
 	}
 }
@@ -1,8 +1,20 @@
 
 #include <winpr/crt.h>
 #include <winpr/thread.h>
+#include <winpr/sysinfo.h>
 #include <winpr/collections.h>
 
+#define TEST_PRODUCERS 4
+
+typedef struct
+{
+	wMessageQueue* queue;
+	UINT32 count;
+	BOOL useEvent;
+	UINT64 received;
+	UINT64 sum;
+} TestThroughput;
+
 static DWORD WINAPI message_queue_consumer_thread(LPVOID arg)
 {
 	wMessage message;
@@ -24,13 +36,169 @@ static DWORD WINAPI message_queue_consumer_thread(LPVOID arg)
 	return 0;
 }
 
+static DWORD WINAPI message_queue_producer_thread(LPVOID arg)
+{
+	UINT32 x;
+	TestThroughput* test = (TestThroughput*)arg;
+
+	for (x = 1; x <= test->count; x++)
+	{
+		if (!MessageQueue_Post(test->queue, NULL, x, NULL, NULL))
+			return 1;
+	}
+
+	return 0;
+}
+
+/* Waits on the event handle like WaitForMultipleObjects users do */
+static int message_queue_get(TestThroughput* test, wMessage* message)
+{
+	if (!test->useEvent)
+		return MessageQueue_Get(test->queue, message);
+
+	if (WaitForSingleObject(MessageQueue_Event(test->queue), INFINITE) != WAIT_OBJECT_0)
+		return -1;
+
+	if (!MessageQueue_Peek(test->queue, message, TRUE))
+		return -1;
+
+	return (message->id != WMQ_QUIT) ? 1 : 0;
+}
+
+static DWORD WINAPI message_queue_counting_thread(LPVOID arg)
+{
+	wMessage message;
+	TestThroughput* test = (TestThroughput*)arg;
+
+	while (message_queue_get(test, &message) > 0)
+	{
+		test->received++;
+		test->sum += message.id;
+	}
+
+	return 0;
+}
+
+static BOOL test_throughput(size_t producers, UINT32 count, BOOL useEvent, BOOL benchmark)
+{
+	size_t x;
+	BOOL rc = FALSE;
+	UINT64 start;
+	HANDLE consumer = NULL;
+	HANDLE threads[TEST_PRODUCERS] = { 0 };
+	TestThroughput test = { 0 };
+	const UINT64 sum = producers * ((UINT64)count * (count + 1) / 2);
+
+	test.queue = MessageQueue_New(NULL);
+	test.count = count;
+	test.useEvent = useEvent;
+
+	if (!test.queue)
+		return FALSE;
+
+	start = GetTickCount64();
+	consumer = CreateThread(NULL, 0, message_queue_counting_thread, &test, 0, NULL);
+
+	if (!consumer)
+		goto fail;
+
+	for (x = 0; x < producers; x++)
+	{
+		threads[x] = CreateThread(NULL, 0, message_queue_producer_thread, &test, 0, NULL);
+
+		if (!threads[x])
+			goto fail;
+	}
+
+	if (WaitForMultipleObjects((DWORD)producers, threads, TRUE, INFINITE) != WAIT_OBJECT_0)
+		goto fail;
+
+	if (!MessageQueue_PostQuit(test.queue, 0) ||
+	    (WaitForSingleObject(consumer, INFINITE) != WAIT_OBJECT_0))
+		goto fail;
+
+	if ((test.received != producers * count) || (test.sum != sum))
+	{
+		printf("received %" PRIu64 " of %" PRIuz " messages\n", test.received,
+		       producers * count);
+		goto fail;
+	}
+
+	if (benchmark)
+		printf("%" PRIuz " producer(s), 1 %s consumer: %" PRIu64 " messages in %" PRIu64 "ms\n",
+		       producers, useEvent ? "event" : "MessageQueue_Get", test.received,
+		       GetTickCount64() - start);
+
+	rc = TRUE;
+fail:
+	for (x = 0; x < producers; x++)
+	{
+		if (threads[x])
+			CloseHandle(threads[x]);
+	}
+
+	if (consumer)
+		CloseHandle(consumer);
+
+	MessageQueue_Free(test.queue);
+	return rc;
+}
+
+/* The event handed out by MessageQueue_Event is set while the queue is non-empty */
+static BOOL test_event(void)
+{
+	BOOL rc = FALSE;
+	wMessage message;
+	wMessageQueue* queue = MessageQueue_New(NULL);
+	HANDLE event;
+
+	if (!queue || !MessageQueue_Post(queue, NULL, 1, NULL, NULL))
+		goto fail;
+
+	event = MessageQueue_Event(queue);
+
+	if (WaitForSingleObject(event, 0) != WAIT_OBJECT_0)
+		goto fail;
+
+	if (!MessageQueue_Post(queue, NULL, 2, NULL, NULL) ||
+	    (MessageQueue_Peek(queue, &message, TRUE) != 1) ||
+	    (WaitForSingleObject(event, 0) != WAIT_OBJECT_0))
+		goto fail;
+
+	if ((MessageQueue_Peek(queue, &message, TRUE) != 1) ||
+	    (WaitForSingleObject(event, 0) != WAIT_TIMEOUT))
+		goto fail;
+
+	if (!MessageQueue_Post(queue, NULL, 3, NULL, NULL) ||
+	    (WaitForSingleObject(event, 0) != WAIT_OBJECT_0) || (MessageQueue_Clear(queue) != 0) ||
+	    (WaitForSingleObject(event, 0) != WAIT_TIMEOUT))
+		goto fail;
+
+	rc = TRUE;
+fail:
+	if (!rc)
+		printf("message queue event out of sync\n");
+
+	MessageQueue_Free(queue);
+	return rc;
+}
+
 int TestMessageQueue(int argc, char* argv[])
 {
 	HANDLE thread;
 	wMessageQueue* queue;
+	/* Pass "benchmark" as argument to measure the throughput */
+	const BOOL benchmark = (argc > 1) && (strcmp(argv[argc - 1], "benchmark") == 0);
+	const UINT32 count = benchmark ? 1000000 : 10000;
+
+	if (!test_event())
+		return -1;
 
-	WINPR_UNUSED(argc);
-	WINPR_UNUSED(argv);
+	if (!test_throughput(1, count, FALSE, benchmark) ||
+	    !test_throughput(TEST_PRODUCERS, count, FALSE, benchmark) ||
+	    !test_throughput(1, count, TRUE, benchmark) ||
+	    !test_throughput(TEST_PRODUCERS, count, TRUE, benchmark))
+		return -1;
 
 	if (!(queue = MessageQueue_New(NULL)))
 	{
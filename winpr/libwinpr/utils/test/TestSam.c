@@ -0,0 +1,210 @@
+#include <stdio.h>
+
+#include <winpr/crt.h>
+#include <winpr/sam.h>
+#include <winpr/file.h>
+#include <winpr/path.h>
+#include <winpr/thread.h>
+#include <winpr/sysinfo.h>
+
+#define TEST_NT_HASH "8846F7EAEE8FB117AD06BDD830B7586C"
+#define TEST_BENCHMARK_USERS 100000
+#define TEST_BENCHMARK_LOOKUPS 100
+
+static BOOL test_write_file(const char* file, const char* content)
+{
+	FILE* f = winpr_fopen(file, "w");
+
+	if (!f)
+		return FALSE;
+
+	fputs(content, f);
+	fclose(f);
+	return TRUE;
+}
+
+static BOOL test_lookup(WINPR_SAM* sam, const char* user, const char* domain, BYTE hash)
+{
+	const UINT32 domainLength = domain ? (UINT32)strlen(domain) : 0;
+	WINPR_SAM_ENTRY* entry = SamLookupUserA(sam, user, (UINT32)strlen(user), domain, domainLength);
+	const BOOL found = entry != NULL;
+
+	if (found != (hash != 0))
+	{
+		fprintf(stderr, "%s\\%s %s\n", domain ? domain : "", user,
+		        found ? "found unexpectedly" : "not found");
+		SamFreeEntry(sam, entry);
+		return FALSE;
+	}
+
+	if (entry && (entry->NtHash[0] != hash))
+	{
+		fprintf(stderr, "%s\\%s has the wrong hash\n", domain ? domain : "", user);
+		SamFreeEntry(sam, entry);
+		return FALSE;
+	}
+
+	SamFreeEntry(sam, entry);
+	return TRUE;
+}
+
+/* Read only and writable handles find the same entries */
+static BOOL test_lookups(const char* file, BOOL readOnly)
+{
+	BOOL rc = FALSE;
+	WINPR_SAM_ENTRY* entry = NULL;
+	WINPR_SAM* sam = SamOpen(file, readOnly);
+	const WCHAR user[] = { 'a', 'l', 'i', 'c', 'e' };
+	const WCHAR domain[] = { 'E', 'X', 'A', 'M', 'P', 'L', 'E' };
+
+	if (!sam)
+		goto fail;
+
+	/* User and domain are matched case insensitive, the first matching entry is used */
+	if (!test_lookup(sam, "Alice", "EXAMPLE", 0x88) ||
+	    !test_lookup(sam, "ALICE", "example", 0x88) || !test_lookup(sam, "alice", NULL, 0x11) ||
+	    !test_lookup(sam, "bob", "", 0x22) ||
+	    !test_lookup(sam, "bob", "EXAMPLE", 0) || !test_lookup(sam, "Alic", "EXAMPLE", 0) ||
+	    !test_lookup(sam, "carol", "OTHER", 0x33) || !test_lookup(sam, "mallory", NULL, 0))
+		goto fail;
+
+	entry = SamLookupUserW(sam, user, sizeof(user), domain, sizeof(domain));
+
+	if (!entry || (strcmp(entry->User, "Alice") != 0) || (strcmp(entry->Domain, "EXAMPLE") != 0))
+	{
+		fprintf(stderr, "SamLookupUserW failed\n");
+		goto fail;
+	}
+
+	rc = TRUE;
+fail:
+	SamFreeEntry(sam, entry);
+	SamClose(sam);
+	return rc;
+}
+
+/* A read only handle keeps the content it was opened with, new handles see the changes */
+static BOOL test_reload(const char* file)
+{
+	BOOL rc = FALSE;
+	WINPR_SAM* old = SamOpen(file, TRUE);
+	WINPR_SAM* sam = NULL;
+
+	if (!old || !test_write_file(file, "dave::" TEST_NT_HASH ":" TEST_NT_HASH ":::\n"))
+		goto fail;
+
+	sam = SamOpen(file, TRUE);
+
+	if (!sam || !test_lookup(sam, "dave", NULL, 0x88) || !test_lookup(sam, "alice", NULL, 0) ||
+	    !test_lookup(old, "dave", NULL, 0) || !test_lookup(old, "alice", NULL, 0x11))
+		goto fail;
+
+	SamClose(sam);
+	sam = NULL;
+
+	if (!winpr_DeleteFile(file) || SamOpen(file, TRUE))
+	{
+		fprintf(stderr, "removed SAM file opened\n");
+		goto fail;
+	}
+
+	rc = TRUE;
+fail:
+	SamClose(sam);
+	SamClose(old);
+	return rc;
+}
+
+static BOOL test_benchmark(const char* file)
+{
+	size_t x;
+	BOOL rc = FALSE;
+	UINT64 start, legacy, cached;
+	WINPR_SAM* sam = NULL;
+	FILE* f = winpr_fopen(file, "w");
+
+	if (!f)
+		return FALSE;
+
+	for (x = 0; x < TEST_BENCHMARK_USERS; x++)
+		fprintf(f, "user%" PRIuz ":DOMAIN::" TEST_NT_HASH ":::\n", x);
+
+	fclose(f);
+
+	/* Writable handles parse the file on every lookup */
+	start = GetTickCount64();
+	sam = SamOpen(file, FALSE);
+
+	for (x = 0; sam && (x < TEST_BENCHMARK_LOOKUPS); x++)
+	{
+		if (!test_lookup(sam, "user99999", "DOMAIN", 0x88))
+			goto fail;
+	}
+
+	SamClose(sam);
+	legacy = GetTickCount64() - start;
+	start = GetTickCount64();
+
+	for (x = 0; x < TEST_BENCHMARK_LOOKUPS; x++)
+	{
+		sam = SamOpen(file, TRUE);
+
+		if (!sam || !test_lookup(sam, "user99999", "DOMAIN", 0x88))
+			goto fail;
+
+		SamClose(sam);
+	}
+
+	sam = NULL;
+	cached = GetTickCount64() - start;
+	printf("%d lookups in %d users: parsed %" PRIu64 "ms, cached %" PRIu64 "ms\n",
+	       TEST_BENCHMARK_LOOKUPS, TEST_BENCHMARK_USERS, legacy, cached);
+	rc = TRUE;
+fail:
+	SamClose(sam);
+	winpr_DeleteFile(file);
+	return rc;
+}
+
+/* Pass "benchmark" as argument to compare lookups of read only and writable handles */
+int TestSam(int argc, char* argv[])
+{
+	int rc = -1;
+	char name[64];
+	char* file = NULL;
+
+	sprintf_s(name, sizeof(name), "TestSam-%" PRIu32, GetCurrentProcessId());
+	file = GetKnownSubPath(KNOWN_PATH_TEMP, name);
+
+	if (!file)
+		goto fail;
+
+	if (SamOpen(file, TRUE))
+	{
+		fprintf(stderr, "missing SAM file opened\n");
+		goto fail;
+	}
+
+	if (!test_write_file(file, "# comment\n"
+	                           "Alice:EXAMPLE::" TEST_NT_HASH ":::\n"
+	                           "alice:example::22000000000000000000000000000000:::\n"
+	                           "alice:::11000000000000000000000000000000:::\n"
+	                           "invalid:line\n"
+	                           "bob:::22000000000000000000000000000000:::\n"
+	                           "carol:OTHER::33000000000000000000000000000000:::\n"))
+		goto fail;
+
+	if (!test_lookups(file, TRUE) || !test_lookups(file, FALSE) || !test_reload(file))
+		goto fail;
+
+	if ((argc > 1) && (strcmp(argv[argc - 1], "benchmark") == 0) && !test_benchmark(file))
+		goto fail;
+
+	rc = 0;
+fail:
+	if (file)
+		winpr_DeleteFile(file);
+
+	free(file);
+	return rc;
+}